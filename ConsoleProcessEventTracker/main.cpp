@@ -1,19 +1,31 @@
 /* Process Tracker (c) DX, kaimi.io */
 
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <Windows.h>
 
 #include "event_tracing/elevated_check.h"
+#include "event_tracing/event_collector.h"
+#include "event_tracing/event_forwarder.h"
 #include "event_tracing/event_provider_list.h"
 #include "event_tracing/event_info.h"
 #include "event_tracing/event_trace.h"
 #include "event_tracing/event_trace_session.h"
 #include "event_tracing/event_trace_error.h"
+#include "event_tracing/loss_tracker.h"
+#include "event_tracing/self_profiler.h"
+#include "event_tracing/shared_ring_publisher.h"
 
 event_tracing::event_trace* global_trace = nullptr;
 event_tracing::event_trace_session* global_session = nullptr;
+event_tracing::event_collector* global_collector = nullptr;
 
 BOOL WINAPI console_handler(DWORD signal)
 {
@@ -24,49 +36,186 @@ BOOL WINAPI console_handler(DWORD signal)
 		global_trace = nullptr;
 	}
 
+	if ((signal == CTRL_C_EVENT || signal == CTRL_BREAK_EVENT || signal == CTRL_CLOSE_EVENT)
+		&& global_collector)
+	{
+		global_collector->stop();
+		global_collector = nullptr;
+	}
+
 	if (signal == CTRL_CLOSE_EVENT && global_session)
 		global_session->close_trace_session();
 
 	return TRUE;
 }
 
-int main()
+//--publish <ring> shares the trace session with other processes,
+//--subscribe <ring> prints events published by another process,
+//--forward <host> <port> sends the trace session to a collector,
+//--collect <port> prints events forwarded by other hosts
+int main(int argc, char* argv[])
 {
 	::SetConsoleCtrlHandler(console_handler, TRUE);
 
 	using namespace event_tracing;
 
+	std::string publish_ring;
+	std::string subscribe_ring;
+	std::string forward_host;
+	unsigned short forward_port = 0;
+	unsigned short collect_port = 0;
+	if (argc == 3 && argv[1] == std::string("--publish"))
+	{
+		publish_ring = argv[2];
+	}
+	else if (argc == 3 && argv[1] == std::string("--subscribe"))
+	{
+		subscribe_ring = argv[2];
+	}
+	else if (argc == 4 && argv[1] == std::string("--forward") && std::atoi(argv[3]) > 0)
+	{
+		forward_host = argv[2];
+		forward_port = static_cast<unsigned short>(std::atoi(argv[3]));
+	}
+	else if (argc == 3 && argv[1] == std::string("--collect") && std::atoi(argv[2]) > 0)
+	{
+		collect_port = static_cast<unsigned short>(std::atoi(argv[2]));
+	}
+	else if (argc != 1)
+	{
+		std::cout << "Usage: ConsoleProcessEventTracker [--publish <ring> | --subscribe <ring>"
+			" | --forward <host> <port> | --collect <port>]" << std::endl;
+		return -1;
+	}
+
 	try
 	{
-		if (!is_running_elevated())
-			throw std::runtime_error("You should run the program as administrator");
+		if (collect_port)
+		{
+			event_collector collector("0.0.0.0", collect_port, [](const std::string& host_id,
+				PEVENT_RECORD record, event_schema_cache& schemas)
+			{
+				try
+				{
+					std::cout << host_id << ": ";
+					std::wcout << event_info(record, schemas) << std::endl;
+				}
+				catch (const std::exception& e)
+				{
+					std::cout << "Error parsing event: " << e.what() << std::endl;
+				}
+			});
+
+			global_collector = &collector;
+			collector.run();
+			global_collector = nullptr;
+			return 0;
+		}
 
 		auto process_provider_guid = event_provider_list().get_guid(L"Microsoft-Windows-Kernel-Process");
 
-		event_trace_session session(L"Kaimi.io test session");
-		global_session = &session;
+		//Outlives the trace, which counts its events there
+		loss_tracker losses;
+		std::unique_ptr<event_trace_session> session;
+		std::unique_ptr<event_trace> trace;
+		if (subscribe_ring.empty())
+		{
+			if (!is_running_elevated())
+				throw std::runtime_error("You should run the program as administrator");
+
+			session = std::make_unique<event_trace_session>(L"Kaimi.io test session");
+			global_session = session.get();
+
+			static constexpr const std::uint64_t keyword_process = 0x10;
+			static constexpr const std::uint64_t keyword_thread = 0x20;
+			static constexpr const std::uint64_t keyword_image = 0x40;
+			session->enable_trace(process_provider_guid, event_trace_session::trace_level::verbose,
+				keyword_process | keyword_thread | keyword_image);
+
+			trace = std::make_unique<event_trace>(*session);
+		}
+		else
+		{
+			trace = std::make_unique<event_trace>(std::vector<event_trace_input>{
+				event_trace_input::shared_ring(subscribe_ring) });
+		}
 
-		static constexpr const std::uint64_t keyword_process = 0x10;
-		static constexpr const std::uint64_t keyword_thread = 0x20;
-		static constexpr const std::uint64_t keyword_image = 0x40;
-		session.enable_trace(process_provider_guid, event_trace_session::trace_level::verbose,
-			keyword_process | keyword_thread | keyword_image);
+		trace->enable_loss_accounting(losses);
 
-		event_trace trace(session);
-		trace.on_trace_event(process_provider_guid, [](auto record)
+		static constexpr const std::size_t ring_capacity = 64 * 1024 * 1024;
+		std::unique_ptr<shared_ring_publisher> publisher;
+		std::unique_ptr<event_forwarder> forwarder;
+		event_schema_cache schema_cache;
+		if (!publish_ring.empty())
 		{
-			try
+			publisher = std::make_unique<shared_ring_publisher>(publish_ring, ring_capacity);
+			trace->on_trace_event([&publisher](auto record)
 			{
-				std::wcout << event_info(record) << std::endl;
-			}
-			catch (const std::exception& e)
+				publisher->publish(*record);
+			});
+		}
+		else if (!forward_host.empty())
+		{
+			char computer_name[MAX_COMPUTERNAME_LENGTH + 1];
+			DWORD computer_name_length = MAX_COMPUTERNAME_LENGTH + 1;
+			if (!::GetComputerNameA(computer_name, &computer_name_length))
+				throw event_trace_error("Unable to get computer name", ::GetLastError());
+
+			event_forwarder_options options;
+			options.spill_file_name = "forward_spill.bin";
+			forwarder = std::make_unique<event_forwarder>(
+				std::string(computer_name, computer_name_length), forward_host, forward_port, options);
+			forwarder->run_async();
+			trace->on_trace_event([&forwarder](auto record)
+			{
+				forwarder->forward(record);
+			});
+		}
+		else
+		{
+			trace->on_trace_event(process_provider_guid, [&schema_cache](auto record)
 			{
-				std::cout << "Error parsing event: " << e.what() << std::endl;
-			}
-		});
+				try
+				{
+					std::wcout << event_info(record, schema_cache) << std::endl;
+				}
+				catch (const std::exception& e)
+				{
+					std::cout << "Error parsing event: " << e.what() << std::endl;
+				}
+			});
+		}
+
+		global_trace = trace.get();
+		trace->run();
+		global_trace = nullptr;
+		global_session = nullptr;
 
-		global_trace = &trace;
-		trace.run();
+		auto loss_totals = losses.get_totals();
+		if (loss_totals.has_loss())
+			std::wcout << loss_totals << std::endl;
+
+		if (forwarder)
+		{
+			forwarder->stop(std::chrono::seconds(5));
+			std::cout << "Forwarded: " << forwarder->get_forwarded_count()
+				<< ", acknowledged: " << forwarder->get_acknowledged_count()
+				<< ", dropped: " << forwarder->get_dropped_count() << std::endl;
+		}
+
+#ifdef EVENT_TRACING_PROFILING
+		auto cycles_per_second = get_cycles_per_second();
+		for (const auto& probe : get_profile_statistics())
+		{
+			std::cout << probe.name << ": " << probe.calls << " calls, "
+				<< probe.total_cycles / cycles_per_second * 1000.0 << " ms total, "
+				<< probe.self_cycles / cycles_per_second * 1000.0 << " ms self" << std::endl;
+		}
+
+		std::string stacks;
+		write_folded_stacks(stacks);
+		std::ofstream("profile.folded", std::ios::binary) << stacks;
+#endif
 	}
 	catch (const event_tracing::event_trace_error& e)
 	{
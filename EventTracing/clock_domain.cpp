@@ -0,0 +1,261 @@
+#include "event_tracing/clock_domain.h"
+
+#include <limits>
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace
+{
+constexpr const std::int64_t nanoseconds_per_second = 1000000000;
+constexpr const std::int64_t seconds_per_day = 86400;
+constexpr const std::int64_t max_nanoseconds = (std::numeric_limits<std::int64_t>::max)();
+constexpr const std::int64_t min_nanoseconds = (std::numeric_limits<std::int64_t>::min)();
+constexpr const std::int64_t max_seconds = max_nanoseconds / nanoseconds_per_second;
+//Lower frequencies could make whole seconds of counter differences overflow,
+//higher ones could make their fractions in nanoseconds overflow
+constexpr const std::int64_t min_frequency = 1000;
+constexpr const std::int64_t max_frequency = max_nanoseconds / nanoseconds_per_second;
+
+//Divides rounding down, the remainder is not negative
+void split(std::int64_t value, std::int64_t divisor, std::int64_t& quotient, std::int64_t& remainder) noexcept
+{
+	quotient = value / divisor;
+	remainder = value % divisor;
+	if (remainder < 0)
+	{
+		remainder += divisor;
+		--quotient;
+	}
+}
+
+//Days since the Unix epoch of a proleptic Gregorian date
+std::int64_t days_from_civil(std::int64_t year, unsigned month, unsigned day) noexcept
+{
+	year -= month <= 2;
+	auto era = (year >= 0 ? year : year - 399) / 400;
+	auto year_of_era = static_cast<unsigned>(year - era * 400);
+	auto day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	auto day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+	return era * 146097 + static_cast<std::int64_t>(day_of_era) - 719468;
+}
+
+void civil_from_days(std::int64_t days, std::int64_t& year, unsigned& month, unsigned& day) noexcept
+{
+	days += 719468;
+	auto era = (days >= 0 ? days : days - 146096) / 146097;
+	auto day_of_era = static_cast<unsigned>(days - era * 146097);
+	auto year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	auto day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	auto shifted_month = (5 * day_of_year + 2) / 153;
+	day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+	month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+	year = static_cast<std::int64_t>(year_of_era) + era * 400 + (month <= 2);
+}
+
+unsigned get_days_in_month(unsigned year, unsigned month) noexcept
+{
+	static const unsigned char days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+		return 29;
+
+	return days[month - 1];
+}
+
+//Writes count digits of the value right to left
+wchar_t* write_digits(wchar_t* buffer, std::uint32_t value, unsigned count) noexcept
+{
+	for (auto position = buffer + count; position != buffer; value /= 10)
+		*--position = static_cast<wchar_t>(L'0' + value % 10);
+
+	return buffer + count;
+}
+
+std::int64_t add_saturated(std::int64_t left, std::int64_t right) noexcept
+{
+	if (right > 0 && left > max_nanoseconds - right)
+		return max_nanoseconds;
+	if (right < 0 && left < min_nanoseconds - right)
+		return min_nanoseconds;
+
+	return left + right;
+}
+} //namespace
+
+boost::optional<std::int64_t> filetime_to_unix_nanoseconds(std::uint64_t filetime) noexcept
+{
+	if (filetime > static_cast<std::uint64_t>(max_nanoseconds))
+		return boost::none;
+
+	auto ticks = static_cast<std::int64_t>(filetime) - unix_epoch_filetime;
+	if (ticks > max_nanoseconds / 100 || ticks < min_nanoseconds / 100)
+		return boost::none;
+
+	return ticks * 100;
+}
+
+boost::optional<std::int64_t> systemtime_to_unix_nanoseconds(const SYSTEMTIME& time) noexcept
+{
+	if (time.wMonth < 1 || time.wMonth > 12 || time.wDay < 1
+		|| time.wDay > get_days_in_month(time.wYear, time.wMonth)
+		|| time.wHour > 23 || time.wMinute > 59 || time.wSecond > 59 || time.wMilliseconds > 999)
+	{
+		return boost::none;
+	}
+
+	auto seconds = days_from_civil(time.wYear, time.wMonth, time.wDay) * seconds_per_day
+		+ time.wHour * 3600 + time.wMinute * 60 + time.wSecond;
+	auto milliseconds = seconds * 1000 + time.wMilliseconds;
+	if (milliseconds > max_nanoseconds / 1000000 || milliseconds < min_nanoseconds / 1000000)
+		return boost::none;
+
+	return milliseconds * 1000000;
+}
+
+std::size_t format_iso8601(std::int64_t unix_nanoseconds, unsigned fraction_digits,
+	wchar_t* buffer) noexcept
+{
+	std::int64_t seconds = 0, nanoseconds = 0, days = 0, second_of_day = 0;
+	split(unix_nanoseconds, nanoseconds_per_second, seconds, nanoseconds);
+	split(seconds, seconds_per_day, days, second_of_day);
+
+	std::int64_t year = 0;
+	unsigned month = 0, day = 0;
+	civil_from_days(days, year, month, day);
+
+	//Years of the nanosecond range always have four digits
+	auto position = write_digits(buffer, static_cast<std::uint32_t>(year), 4);
+	*position++ = L'-';
+	position = write_digits(position, month, 2);
+	*position++ = L'-';
+	position = write_digits(position, day, 2);
+	*position++ = L'T';
+	position = write_digits(position, static_cast<std::uint32_t>(second_of_day / 3600), 2);
+	*position++ = L':';
+	position = write_digits(position, static_cast<std::uint32_t>(second_of_day / 60 % 60), 2);
+	*position++ = L':';
+	position = write_digits(position, static_cast<std::uint32_t>(second_of_day % 60), 2);
+	if (fraction_digits)
+	{
+		if (fraction_digits > 9)
+			fraction_digits = 9;
+
+		auto fraction = static_cast<std::uint32_t>(nanoseconds);
+		for (auto i = fraction_digits; i != 9; ++i)
+			fraction /= 10;
+
+		*position++ = L'.';
+		position = write_digits(position, fraction, fraction_digits);
+	}
+
+	*position++ = L'Z';
+	return static_cast<std::size_t>(position - buffer);
+}
+
+void append_iso8601(std::int64_t unix_nanoseconds, unsigned fraction_digits, std::wstring& result)
+{
+	wchar_t buffer[iso8601_max_length];
+	result.append(buffer, format_iso8601(unix_nanoseconds, fraction_digits, buffer));
+}
+
+clock_domain::clock_domain(std::int64_t frequency, std::int64_t counter, std::int64_t base) noexcept
+	: frequency_(frequency)
+	, counter_(counter)
+	, base_(base)
+	, tick_nanoseconds_(frequency && nanoseconds_per_second % frequency == 0
+		? nanoseconds_per_second / frequency : 0)
+	, max_ticks_(tick_nanoseconds_ ? max_nanoseconds / tick_nanoseconds_ : 0)
+{
+	if (frequency_)
+	{
+		split(counter_, frequency_, counter_seconds_, counter_remainder_);
+		split(base_, nanoseconds_per_second, base_seconds_, base_fraction_);
+	}
+}
+
+clock_domain clock_domain::system_time() noexcept
+{
+	return clock_domain(0, 0, 0);
+}
+
+clock_domain clock_domain::query_performance_counter(std::int64_t frequency, std::int64_t counter,
+	std::int64_t system_time)
+{
+	if (frequency < min_frequency || frequency > max_frequency)
+		throw event_trace_error("Counter frequency is out of range");
+
+	auto base = filetime_to_unix_nanoseconds(static_cast<std::uint64_t>(system_time));
+	if (system_time < 0 || !base)
+		throw event_trace_error("Calibration time is out of range");
+
+	return clock_domain(frequency, counter, *base);
+}
+
+clock_domain clock_domain::query_performance_counter()
+{
+	LARGE_INTEGER frequency{}, before{}, after{};
+	if (!::QueryPerformanceFrequency(&frequency))
+		throw event_trace_error("Unable to get performance counter frequency", ::GetLastError());
+
+	//The system time is taken as read in the middle of the counter readings
+	FILETIME now{};
+	::QueryPerformanceCounter(&before);
+	::GetSystemTimePreciseAsFileTime(&now);
+	::QueryPerformanceCounter(&after);
+	auto system_time = static_cast<std::int64_t>(
+		(static_cast<std::uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime);
+	return query_performance_counter(frequency.QuadPart,
+		before.QuadPart + (after.QuadPart - before.QuadPart) / 2, system_time);
+}
+
+std::int64_t clock_domain::to_unix_nanoseconds(std::int64_t timestamp) const noexcept
+{
+	if (!frequency_)
+	{
+		if (timestamp > max_nanoseconds / 100 + unix_epoch_filetime)
+			return max_nanoseconds;
+		if (timestamp < min_nanoseconds / 100 + unix_epoch_filetime)
+			return min_nanoseconds;
+
+		return (timestamp - unix_epoch_filetime) * 100;
+	}
+
+	//Counter values of the same sign can be subtracted, which is the usual case
+	if (tick_nanoseconds_ && (timestamp < 0) == (counter_ < 0))
+	{
+		auto ticks = timestamp - counter_;
+		if (ticks <= max_ticks_ && ticks >= -max_ticks_)
+			return add_saturated(base_, ticks * tick_nanoseconds_);
+	}
+
+	//Whole seconds and their fractions are added separately, so that nothing overflows
+	std::int64_t seconds = 0, remainder = 0;
+	split(timestamp, frequency_, seconds, remainder);
+	seconds -= counter_seconds_;
+	remainder -= counter_remainder_;
+	if (remainder < 0)
+	{
+		remainder += frequency_;
+		--seconds;
+	}
+
+	//Rounded down, remainder * nanoseconds_per_second fits as the frequency is limited
+	seconds += base_seconds_;
+	auto fraction = base_fraction_ + remainder * nanoseconds_per_second / frequency_;
+	if (fraction >= nanoseconds_per_second)
+	{
+		fraction -= nanoseconds_per_second;
+		++seconds;
+	}
+
+	if (seconds > max_seconds)
+		return max_nanoseconds;
+	if (seconds < -max_seconds - 1)
+		return min_nanoseconds;
+	if (seconds < 0)
+		return add_saturated((seconds + 1) * nanoseconds_per_second, fraction - nanoseconds_per_second);
+
+	return add_saturated(seconds * nanoseconds_per_second, fraction);
+}
+} //namespace event_tracing
@@ -0,0 +1,79 @@
+#include "event_tracing/decode_result.h"
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+const char* get_decode_error_text(decode_error error) noexcept
+{
+	switch (error)
+	{
+	case decode_error::none:
+		return "No error";
+
+	case decode_error::schema_not_found:
+		return "Unable to get event information";
+
+	case decode_error::string_only_event:
+		return "Event has not properties, only unicode string. Use get_event_string() to get it";
+
+	case decode_error::property_not_found:
+		return "Property was not found in event";
+
+	case decode_error::structure_expected:
+		return "Expected structure, got plain value";
+
+	case decode_error::struct_property_expected:
+		return "Expected struct property, got single-value property";
+
+	case decode_error::single_value_expected:
+		return "Expected single-value property, got array";
+
+	case decode_error::single_value_member_expected:
+		return "Expected single-value struct member, got array";
+
+	case decode_error::plain_value_expected:
+		return "Expected single-value property, got struct";
+
+	case decode_error::index_out_of_bounds:
+		return "Array index out of bounds";
+
+	case decode_error::property_size_failed:
+		return "Unable to get property size";
+
+	case decode_error::property_read_failed:
+		return "Failed to get property value";
+
+	case decode_error::incorrect_property_type:
+		return "Incorrect property type";
+
+	case decode_error::invalid_value_size:
+		return "Invalid property value size";
+
+	case decode_error::invalid_filetime:
+		return "Invalid filetime or systemtime property value";
+
+	case decode_error::unsupported_type:
+		return "Property type is not supported";
+
+	case decode_error::payload_truncated:
+		return "Event payload is shorter than its schema requires";
+
+	case decode_error::invalid_schema:
+		return "Event schema is inconsistent";
+
+	case decode_error::map_not_found:
+		return "Property has no value map";
+
+	default:
+		break;
+	}
+
+	return "Unknown decoding error";
+}
+
+void throw_decode_error(const decode_failure& failure)
+{
+	throw event_trace_error(get_decode_error_text(failure.error), failure.status_code);
+}
+} //namespace event_tracing
@@ -0,0 +1,148 @@
+#include "event_tracing/event_batch_decoder.h"
+
+#include <cwchar>
+#include <utility>
+
+#include "event_tracing/event_visitor.h"
+
+namespace event_tracing
+{
+const std::uint32_t event_batch_decoder::no_offset;
+
+//Records locations of top-level fields with variable offsets
+class event_batch_decoder::field_locator : public event_visitor
+{
+public:
+	explicit field_locator(std::vector<field_info>& fields)
+		: fields_(fields)
+	{
+	}
+
+	void reset(const EVENT_RECORD& record, std::size_t record_index) noexcept
+	{
+		payload_ = static_cast<const std::uint8_t*>(record.UserData);
+		record_index_ = record_index;
+		depth_ = 0;
+	}
+
+	void begin_struct(const wchar_t*) override
+	{
+		++depth_;
+	}
+
+	void end_struct() override
+	{
+		--depth_;
+	}
+
+	void begin_array(const wchar_t*, ULONG) override
+	{
+		++depth_;
+	}
+
+	void end_array() override
+	{
+		--depth_;
+	}
+
+	void value(const event_property_view& prop) override
+	{
+		if (depth_)
+			return;
+
+		//Names come from the same schema, so pointers identify properties
+		for (auto& field : fields_)
+		{
+			if (!field.fixed && field.name == prop.get_name())
+			{
+				field.offsets[record_index_] = static_cast<std::uint32_t>(prop.get_data() - payload_);
+				field.sizes[record_index_] = static_cast<std::uint32_t>(prop.get_size());
+			}
+		}
+	}
+
+private:
+	std::vector<field_info>& fields_;
+	const std::uint8_t* payload_ = nullptr;
+	std::size_t record_index_ = 0;
+	ULONG depth_ = 0;
+};
+
+event_batch_decoder::event_batch_decoder(std::shared_ptr<const event_schema> schema,
+	const std::vector<std::wstring>& field_names)
+	: schema_(std::move(schema))
+{
+	//Offsets are known up to the first property whose size depends on the payload
+	std::vector<std::uint32_t> prefix_offsets;
+	std::uint32_t offset = 0;
+	for (ULONG index = 0; index != schema_->get_top_level_property_count(); ++index)
+	{
+		const auto& prop = schema_->get_property(index);
+		auto size = get_fixed_type_size(prop.in_type);
+		if (prop.is_struct() || prop.has_count_property() || !size)
+			break;
+
+		prefix_offsets.push_back(offset);
+		offset += static_cast<std::uint32_t>(size * prop.count);
+	}
+
+	for (const auto& field_name : field_names)
+	{
+		ULONG index = 0;
+		while (index != schema_->get_top_level_property_count()
+			&& std::wcscmp(schema_->get_property(index).name, field_name.c_str()))
+		{
+			++index;
+		}
+
+		if (index == schema_->get_top_level_property_count())
+			throw_decode_error({ decode_error::property_not_found, 0u });
+
+		const auto& prop = schema_->get_property(index);
+		if (prop.is_struct())
+			throw_decode_error({ decode_error::plain_value_expected, 0u });
+
+		if (prop.is_array())
+			throw_decode_error({ decode_error::single_value_expected, 0u });
+
+		field_info field{ prop.name, prop.in_type, prop.out_type, index < prefix_offsets.size(),
+			no_offset, 0u, {}, {} };
+		if (field.fixed)
+		{
+			field.offset = prefix_offsets[index];
+			field.size = static_cast<std::uint32_t>(get_fixed_type_size(prop.in_type));
+		}
+		else if (index >= walk_property_count_)
+		{
+			walk_property_count_ = index + 1;
+		}
+
+		fields_.push_back(std::move(field));
+	}
+}
+
+void event_batch_decoder::load(const EVENT_RECORD* const* records, std::size_t count)
+{
+	records_.assign(records, records + count);
+
+	for (auto& field : fields_)
+	{
+		if (!field.fixed)
+		{
+			field.offsets.assign(count, no_offset);
+			field.sizes.assign(count, 0u);
+		}
+	}
+
+	if (!walk_property_count_)
+		return;
+
+	field_locator locator(fields_);
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		//Fields found before a malformed part of the payload are still decoded
+		locator.reset(*records[i], i);
+		visit_event(*schema_, *records[i], locator, walk_property_count_);
+	}
+}
+} //namespace event_tracing
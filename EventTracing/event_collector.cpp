@@ -0,0 +1,346 @@
+#include "event_tracing/event_collector.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "event_tracing/event_record_copy.h"
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/forwarding_protocol.h"
+
+namespace event_tracing
+{
+class event_collector::server
+{
+public:
+	server(const std::string& address, unsigned short port, event_handler&& handler)
+		: handler_(std::move(handler))
+		, acceptor_(io_context_)
+	{
+		boost::system::error_code error;
+		auto ip_address = boost::asio::ip::make_address(address, error);
+		boost::asio::ip::tcp::endpoint endpoint(ip_address, port);
+		if (!error)
+			acceptor_.open(endpoint.protocol(), error);
+		if (!error)
+			acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), error);
+		if (!error)
+			acceptor_.bind(endpoint, error);
+		if (!error)
+			acceptor_.listen(boost::asio::socket_base::max_listen_connections, error);
+		if (error)
+			throw event_trace_error("Unable to open collector port", error.value());
+
+		accept();
+	}
+
+	unsigned short get_port() const noexcept
+	{
+		boost::system::error_code error;
+		return acceptor_.local_endpoint(error).port();
+	}
+
+	void run()
+	{
+		io_context_.run();
+	}
+
+	void stop()
+	{
+		io_context_.stop();
+	}
+
+	std::uint64_t get_received_count() const noexcept
+	{
+		return received_count_;
+	}
+
+	std::uint64_t get_duplicate_batch_count() const noexcept
+	{
+		return duplicate_batch_count_;
+	}
+
+private:
+	struct host_state
+	{
+		//Last batch processed of each stream of the host
+		std::map<std::uint64_t, std::uint64_t> last_sequences;
+		event_schema_cache schemas;
+	};
+
+	class session : public std::enable_shared_from_this<session>
+	{
+	public:
+		session(boost::asio::ip::tcp::socket&& socket, server& owner)
+			: socket_(std::move(socket))
+			, owner_(owner)
+		{
+		}
+
+		void start()
+		{
+			read_header();
+		}
+
+	private:
+		void read_header()
+		{
+			auto self = shared_from_this();
+			boost::asio::async_read(socket_, boost::asio::buffer(&header_, sizeof(header_)),
+				[self](const boost::system::error_code& error, std::size_t)
+			{
+				if (error || !is_valid_forward_frame(self->header_))
+					return;
+
+				self->frame_.resize(self->header_.size);
+				boost::asio::async_read(self->socket_, boost::asio::buffer(self->frame_),
+					[self](const boost::system::error_code& error, std::size_t)
+				{
+					if (!error)
+						self->process_frame();
+				});
+			});
+		}
+
+		void process_frame()
+		{
+			std::uint64_t acknowledged_sequence;
+			try
+			{
+				get_forward_frame_payload(header_, frame_.data(), payload_);
+				if (header_.type == static_cast<std::uint8_t>(forward_frame_type::hello))
+				{
+					if (host_)
+						return;
+
+					host_id_.assign(payload_.cbegin(), payload_.cend());
+					host_ = &owner_.hosts_[host_id_];
+					last_sequence_ = &host_->last_sequences[header_.sequence];
+				}
+				else if (header_.type != static_cast<std::uint8_t>(forward_frame_type::batch) || !host_)
+				{
+					return;
+				}
+				else if (header_.sequence <= *last_sequence_)
+				{
+					++owner_.duplicate_batch_count_;
+				}
+				else
+				{
+					process_batch();
+					*last_sequence_ = header_.sequence;
+				}
+
+				acknowledged_sequence = *last_sequence_;
+			}
+			catch (const std::exception&)
+			{
+				//The connection is closed and the forwarder resends the batch
+				return;
+			}
+
+			std::memset(&ack_, 0, sizeof(ack_));
+			ack_.magic = forward_frame_magic;
+			ack_.type = static_cast<std::uint8_t>(forward_frame_type::ack);
+			ack_.sequence = acknowledged_sequence;
+			auto self = shared_from_this();
+			boost::asio::async_write(socket_, boost::asio::buffer(&ack_, sizeof(ack_)),
+				[self](const boost::system::error_code& error, std::size_t)
+			{
+				if (!error)
+					self->read_header();
+			});
+		}
+
+		//The whole batch is checked before any of it is handled, so a batch
+		//which is rejected and resent is not handled twice
+		void process_batch()
+		{
+			entries_.clear();
+			schemas_.clear();
+			std::size_t offset = 0;
+			while (offset != payload_.size())
+			{
+				if (payload_.size() - offset < forward_entry_header_size)
+					throw event_trace_error("Forwarded batch is truncated");
+
+				auto type = static_cast<forward_entry_type>(payload_[offset]);
+				std::uint32_t size;
+				std::memcpy(&size, payload_.data() + offset + 1u, sizeof(size));
+				offset += forward_entry_header_size;
+				if (payload_.size() - offset < size)
+					throw event_trace_error("Forwarded batch is truncated");
+
+				auto data = payload_.data() + offset;
+				if (type == forward_entry_type::schema)
+				{
+					if (size < sizeof(GUID) + sizeof(EVENT_DESCRIPTOR))
+						throw event_trace_error("Forwarded schema is truncated");
+
+					forwarded_schema schema;
+					std::memcpy(&schema.provider_id, data, sizeof(schema.provider_id));
+					std::memcpy(&schema.descriptor, data + sizeof(schema.provider_id), sizeof(schema.descriptor));
+					auto info = data + sizeof(schema.provider_id) + sizeof(schema.descriptor);
+					std::vector<std::uint8_t> info_data(info, data + size);
+					if (!event_schema::is_valid(info_data))
+						throw event_trace_error("Forwarded schema is invalid");
+
+					schema.value = std::make_shared<const event_schema>(std::move(info_data));
+					schemas_.push_back(std::move(schema));
+					entries_.push_back({ type, offset, size });
+				}
+				else if (type == forward_entry_type::record)
+				{
+					if (!event_record_copy::is_serialized(data, size))
+						throw event_trace_error("Forwarded record is invalid");
+
+					entries_.push_back({ type, offset, size });
+				}
+
+				offset += size;
+			}
+
+			auto schema = schemas_.begin();
+			for (const auto& entry : entries_)
+			{
+				if (entry.type == forward_entry_type::schema)
+				{
+					host_->schemas.add(schema->provider_id, schema->descriptor, std::move(schema->value));
+					++schema;
+					continue;
+				}
+
+				record_.assign_serialized(payload_.data() + entry.offset, entry.size);
+				++owner_.received_count_;
+				try
+				{
+					owner_.handler_(host_id_, record_.get(), host_->schemas);
+				}
+				catch (...)
+				{
+					assert(false);
+				}
+			}
+		}
+
+	private:
+		struct batch_entry
+		{
+			forward_entry_type type;
+			std::size_t offset;
+			std::uint32_t size;
+		};
+
+		struct forwarded_schema
+		{
+			GUID provider_id;
+			EVENT_DESCRIPTOR descriptor;
+			std::shared_ptr<const event_schema> value;
+		};
+
+	private:
+		boost::asio::ip::tcp::socket socket_;
+		server& owner_;
+		forward_frame_header header_;
+		forward_frame_header ack_;
+		std::vector<std::uint8_t> frame_;
+		std::vector<std::uint8_t> payload_;
+		event_record_copy record_;
+		//Entries of the batch being processed, checked before they are handled
+		std::vector<batch_entry> entries_;
+		std::vector<forwarded_schema> schemas_;
+		std::string host_id_;
+		host_state* host_ = nullptr;
+		std::uint64_t* last_sequence_ = nullptr;
+	};
+
+private:
+	void accept()
+	{
+		acceptor_.async_accept([this](const boost::system::error_code& error,
+			boost::asio::ip::tcp::socket socket)
+		{
+			if (error == boost::asio::error::operation_aborted)
+				return;
+
+			if (!error)
+			{
+				boost::system::error_code ignored;
+				socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+				std::make_shared<session>(std::move(socket), *this)->start();
+			}
+
+			accept();
+		});
+	}
+
+private:
+	event_handler handler_;
+	boost::asio::io_context io_context_;
+	boost::asio::ip::tcp::acceptor acceptor_;
+	std::map<std::string, host_state> hosts_;
+	std::atomic<std::uint64_t> received_count_{ 0 };
+	std::atomic<std::uint64_t> duplicate_batch_count_{ 0 };
+};
+
+event_collector::event_collector(const std::string& address, unsigned short port,
+	event_handler handler)
+	: server_(std::make_unique<server>(address, port, std::move(handler)))
+{
+}
+
+event_collector::~event_collector()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+unsigned short event_collector::get_port() const noexcept
+{
+	return server_->get_port();
+}
+
+void event_collector::run()
+{
+	server_->run();
+}
+
+void event_collector::run_async()
+{
+	if (server_thread_.joinable())
+		return;
+
+	server_thread_ = std::thread([this]
+	{
+		server_->run();
+	});
+}
+
+void event_collector::stop()
+{
+	server_->stop();
+	if (server_thread_.joinable())
+		server_thread_.join();
+}
+
+std::uint64_t event_collector::get_received_count() const noexcept
+{
+	return server_->get_received_count();
+}
+
+std::uint64_t event_collector::get_duplicate_batch_count() const noexcept
+{
+	return server_->get_duplicate_batch_count();
+}
+} //namespace event_tracing
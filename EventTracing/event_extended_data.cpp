@@ -0,0 +1,148 @@
+#include "event_tracing/event_extended_data.h"
+
+#include <cstring>
+
+namespace event_tracing
+{
+namespace
+{
+const void* get_item_data(const EVENT_HEADER_EXTENDED_DATA_ITEM& item) noexcept
+{
+	return reinterpret_cast<const void*>(static_cast<std::uintptr_t>(item.DataPtr));
+}
+} //namespace
+
+event_stack_trace::event_stack_trace(std::uint64_t match_id, const void* frames,
+	std::size_t frame_count, bool is_64_bit) noexcept
+	: match_id_(match_id)
+	, frames_(frames)
+	, frame_count_(frame_count)
+	, is_64_bit_(is_64_bit)
+{
+}
+
+std::uint64_t event_stack_trace::operator[](std::size_t index) const noexcept
+{
+	auto frames = static_cast<const std::uint8_t*>(frames_);
+	if (is_64_bit_)
+	{
+		std::uint64_t frame = 0;
+		std::memcpy(&frame, frames + index * sizeof(frame), sizeof(frame));
+		return frame;
+	}
+
+	std::uint32_t frame = 0;
+	std::memcpy(&frame, frames + index * sizeof(frame), sizeof(frame));
+	return frame;
+}
+
+event_extended_data::event_extended_data(const EVENT_RECORD& record) noexcept
+	: items_(record.ExtendedData)
+	, count_(record.ExtendedData ? record.ExtendedDataCount : 0u)
+{
+}
+
+const EVENT_HEADER_EXTENDED_DATA_ITEM* event_extended_data::find(USHORT ext_type) const noexcept
+{
+	for (std::size_t i = 0; i != count_; ++i)
+	{
+		if (items_[i].ExtType == ext_type && items_[i].DataPtr)
+			return &items_[i];
+	}
+
+	return nullptr;
+}
+
+template<typename Value>
+boost::optional<Value> event_extended_data::get_value(USHORT ext_type) const noexcept
+{
+	auto item = find(ext_type);
+	if (!item || item->DataSize < sizeof(Value))
+		return boost::none;
+
+	Value value;
+	std::memcpy(&value, get_item_data(*item), sizeof(value));
+	return value;
+}
+
+boost::optional<GUID> event_extended_data::get_related_activity_id() const noexcept
+{
+	auto value = get_value<EVENT_EXTENDED_ITEM_RELATED_ACTIVITYID>(EVENT_HEADER_EXT_TYPE_RELATED_ACTIVITYID);
+	if (!value)
+		return boost::none;
+
+	return value->RelatedActivityId;
+}
+
+boost::optional<ULONG> event_extended_data::get_terminal_session_id() const noexcept
+{
+	auto value = get_value<EVENT_EXTENDED_ITEM_TS_ID>(EVENT_HEADER_EXT_TYPE_TS_ID);
+	if (!value)
+		return boost::none;
+
+	return value->SessionId;
+}
+
+boost::optional<std::uint64_t> event_extended_data::get_process_start_key() const noexcept
+{
+	auto value = get_value<EVENT_EXTENDED_ITEM_PROCESS_START_KEY>(EVENT_HEADER_EXT_TYPE_PROCESS_START_KEY);
+	if (!value)
+		return boost::none;
+
+	return value->ProcessStartKey;
+}
+
+boost::optional<std::uint64_t> event_extended_data::get_event_key() const noexcept
+{
+	auto value = get_value<EVENT_EXTENDED_ITEM_EVENT_KEY>(EVENT_HEADER_EXT_TYPE_EVENT_KEY);
+	if (!value)
+		return boost::none;
+
+	return value->Key;
+}
+
+boost::optional<event_stack_trace> event_extended_data::get_stack_trace() const noexcept
+{
+	bool is_64_bit = true;
+	auto item = find(EVENT_HEADER_EXT_TYPE_STACK_TRACE64);
+	if (!item)
+	{
+		is_64_bit = false;
+		item = find(EVENT_HEADER_EXT_TYPE_STACK_TRACE32);
+	}
+
+	std::uint64_t match_id = 0;
+	if (!item || item->DataSize < sizeof(match_id))
+		return boost::none;
+
+	auto data = static_cast<const std::uint8_t*>(get_item_data(*item));
+	std::memcpy(&match_id, data, sizeof(match_id));
+
+	std::size_t frame_size = is_64_bit ? sizeof(std::uint64_t) : sizeof(std::uint32_t);
+	std::size_t frame_count = (item->DataSize - sizeof(match_id)) / frame_size;
+	return event_stack_trace(match_id, data + sizeof(match_id), frame_count, is_64_bit);
+}
+
+boost::optional<std::uint64_t> event_extended_data::get_sequence_number() const noexcept
+{
+#ifdef EVENT_HEADER_EXT_TYPE_SEQUENCE_NUMBER
+	return get_value<std::uint64_t>(EVENT_HEADER_EXT_TYPE_SEQUENCE_NUMBER);
+#else
+	return boost::none;
+#endif
+}
+
+const SID* event_extended_data::get_user_sid() const noexcept
+{
+	auto item = find(EVENT_HEADER_EXT_TYPE_SID);
+	auto header_size = offsetof(SID, SubAuthority);
+	if (!item || item->DataSize < header_size)
+		return nullptr;
+
+	auto sid = static_cast<const SID*>(get_item_data(*item));
+	if (item->DataSize < header_size + sid->SubAuthorityCount * sizeof(DWORD))
+		return nullptr;
+
+	return sid;
+}
+} //namespace event_tracing
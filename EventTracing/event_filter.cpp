@@ -0,0 +1,985 @@
+#include "event_tracing/event_filter.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <limits>
+#include <utility>
+
+#include <tdh.h>
+
+#include <boost/optional.hpp>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace
+{
+constexpr const std::uint8_t match_no = static_cast<std::uint8_t>(event_filter::header_match::no);
+constexpr const std::uint8_t match_maybe = static_cast<std::uint8_t>(event_filter::header_match::maybe);
+constexpr const std::uint8_t match_yes = static_cast<std::uint8_t>(event_filter::header_match::yes);
+
+bool is_identifier_char(wchar_t value) noexcept
+{
+	return (value >= L'a' && value <= L'z') || (value >= L'A' && value <= L'Z')
+		|| (value >= L'0' && value <= L'9') || value == L'_';
+}
+
+bool equal_no_case(wchar_t left, wchar_t right) noexcept
+{
+	return std::towupper(left) == std::towupper(right);
+}
+
+bool is_signed_type(std::uint16_t in_type) noexcept
+{
+	switch (in_type)
+	{
+	case TDH_INTYPE_INT8:
+	case TDH_INTYPE_INT16:
+	case TDH_INTYPE_INT32:
+	case TDH_INTYPE_INT64:
+	case TDH_INTYPE_HEXINT32:
+	case TDH_INTYPE_HEXINT64:
+		return true;
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+bool is_string_type(std::uint16_t in_type) noexcept
+{
+	switch (in_type)
+	{
+	case TDH_INTYPE_UNICODESTRING:
+	case TDH_INTYPE_COUNTEDSTRING:
+	case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
+	case TDH_INTYPE_NONNULLTERMINATEDSTRING:
+	case TDH_INTYPE_ANSISTRING:
+	case TDH_INTYPE_COUNTEDANSISTRING:
+	case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
+	case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
+		return true;
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+decode_result<std::wstring> property_to_string(const event_property& prop)
+{
+	switch (prop.get_in_type())
+	{
+	case TDH_INTYPE_ANSISTRING:
+	case TDH_INTYPE_COUNTEDANSISTRING:
+	case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
+	case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
+		{
+			auto value = event_property_converter<std::string>::try_convert(prop);
+			if (!value)
+				return value.get_failure();
+
+			return std::wstring(value->cbegin(), value->cend());
+		}
+
+	default:
+		break;
+	}
+
+	return event_property_converter<std::wstring>::try_convert(prop);
+}
+
+template<typename Source>
+decode_result<std::int64_t> to_integer(const decode_result<Source>& value)
+{
+	if (!value)
+		return value.get_failure();
+
+	return static_cast<std::int64_t>(*value);
+}
+
+decode_result<std::int64_t> property_to_integer(const event_property& prop)
+{
+	switch (prop.get_in_type())
+	{
+	case TDH_INTYPE_BOOLEAN:
+		return to_integer(event_property_converter<bool>::try_convert(prop));
+
+	case TDH_INTYPE_POINTER:
+		return to_integer(event_property_converter<event_type_pointer>::try_convert(prop));
+
+	case TDH_INTYPE_SIZET:
+		return to_integer(event_property_converter<event_type_size_t>::try_convert(prop));
+
+	default:
+		break;
+	}
+
+	if (is_signed_type(prop.get_in_type()))
+		return event_property_converter<std::int64_t>::try_convert(prop);
+
+	return to_integer(event_property_converter<std::uint64_t>::try_convert(prop));
+}
+} //namespace
+
+struct event_filter::property_cache
+{
+	struct value
+	{
+		bool decoded = false;
+		bool valid = false;
+		bool is_signed = false;
+		std::int64_t number = 0;
+		boost::optional<std::wstring> text;
+	};
+
+	property_cache(PEVENT_RECORD record, std::size_t property_count)
+		: info(record)
+		, values(property_count)
+	{
+	}
+
+	//Schema is only looked up when the first property is decoded
+	event_info info;
+	std::vector<value> values;
+};
+
+class event_filter::parser
+{
+public:
+	parser(event_filter& filter, const std::wstring& expression)
+		: filter_(filter)
+		, expression_(expression)
+	{
+	}
+
+	void parse()
+	{
+		parse_expression();
+		skip_spaces();
+		if (position_ != expression_.size())
+			throw_error("Unexpected text");
+	}
+
+private:
+	[[noreturn]] void throw_error(const char* text) const
+	{
+		throw event_trace_error(std::string("Invalid filter expression: ") + text
+			+ " at position " + std::to_string(position_));
+	}
+
+	void skip_spaces() noexcept
+	{
+		while (position_ != expression_.size() && std::iswspace(expression_[position_]))
+			++position_;
+	}
+
+	bool accept(const wchar_t* token)
+	{
+		skip_spaces();
+		auto length = std::char_traits<wchar_t>::length(token);
+		if (expression_.compare(position_, length, token) != 0)
+			return false;
+
+		//Word tokens must not be followed by identifier characters
+		if (is_identifier_char(token[0]) && position_ + length != expression_.size()
+			&& is_identifier_char(expression_[position_ + length]))
+		{
+			return false;
+		}
+
+		position_ += length;
+		return true;
+	}
+
+	bool accept_negation()
+	{
+		skip_spaces();
+		if (position_ == expression_.size() || expression_[position_] != L'!'
+			|| (position_ + 1u != expression_.size() && expression_[position_ + 1u] == L'='))
+		{
+			return false;
+		}
+
+		++position_;
+		return true;
+	}
+
+	void expect(const wchar_t* token, const char* error)
+	{
+		if (!accept(token))
+			throw_error(error);
+	}
+
+	std::wstring read_identifier()
+	{
+		skip_spaces();
+		auto start = position_;
+		while (position_ != expression_.size() && is_identifier_char(expression_[position_]))
+			++position_;
+
+		if (start == position_)
+			throw_error("Expected identifier");
+
+		return expression_.substr(start, position_ - start);
+	}
+
+	struct number
+	{
+		std::uint64_t magnitude;
+		bool negative;
+	};
+
+	number read_number()
+	{
+		skip_spaces();
+		bool negative = accept(L"-");
+		skip_spaces();
+		auto start = position_;
+		std::uint64_t value = 0;
+		auto add_digit = [this, &value](std::uint64_t base, std::uint64_t digit)
+		{
+			if (value > ((std::numeric_limits<std::uint64_t>::max)() - digit) / base)
+				throw_error("Number is out of range");
+
+			value = value * base + digit;
+		};
+
+		if (expression_.compare(position_, 2, L"0x") == 0 || expression_.compare(position_, 2, L"0X") == 0)
+		{
+			position_ += 2;
+			start = position_;
+			while (position_ != expression_.size() && std::iswxdigit(expression_[position_]))
+			{
+				auto digit = expression_[position_++];
+				add_digit(16u, static_cast<std::uint64_t>(std::iswdigit(digit)
+					? digit - L'0' : std::towlower(digit) - L'a' + 10));
+			}
+		}
+		else
+		{
+			while (position_ != expression_.size() && std::iswdigit(expression_[position_]))
+				add_digit(10u, static_cast<std::uint64_t>(expression_[position_++] - L'0'));
+		}
+
+		if (start == position_)
+			throw_error("Expected number");
+
+		if (negative && value > 0x8000000000000000ull)
+			throw_error("Number is out of range");
+
+		return { value, negative && value != 0 };
+	}
+
+	//Header fields are unsigned
+	std::uint64_t read_unsigned_number()
+	{
+		auto value = read_number();
+		if (value.negative)
+			throw_error("Expected non-negative number");
+
+		return value.magnitude;
+	}
+
+	std::wstring read_string()
+	{
+		skip_spaces();
+		if (position_ == expression_.size() || expression_[position_] != L'"')
+			throw_error("Expected string");
+
+		std::wstring result;
+		for (++position_; position_ != expression_.size() && expression_[position_] != L'"'; ++position_)
+		{
+			if (expression_[position_] == L'\\' && position_ + 1 != expression_.size())
+				++position_;
+
+			result.push_back(expression_[position_]);
+		}
+
+		if (position_ == expression_.size())
+			throw_error("Unterminated string");
+
+		++position_;
+		return result;
+	}
+
+	boost::optional<compare_operation> read_compare_operation()
+	{
+		if (accept(L"=="))
+			return compare_operation::equal;
+		if (accept(L"!="))
+			return compare_operation::not_equal;
+		if (accept(L"<="))
+			return compare_operation::less_equal;
+		if (accept(L">="))
+			return compare_operation::greater_equal;
+		if (accept(L"<"))
+			return compare_operation::less;
+		if (accept(L">"))
+			return compare_operation::greater;
+		if (accept(L"contains"))
+			return compare_operation::contains;
+		if (accept(L"starts_with"))
+			return compare_operation::starts_with;
+		if (accept(L"ends_with"))
+			return compare_operation::ends_with;
+
+		return boost::none;
+	}
+
+	void emit(operation op, header_field field = header_field::pid,
+		compare_operation compare = compare_operation::equal,
+		std::uint64_t value = 0, std::size_t index = 0, bool negative = false)
+	{
+		filter_.program_.push_back({ op, field, compare, value, negative, index, 0, 0,
+			op == operation::property_compare || op == operation::property_string_compare });
+		switch (op)
+		{
+		case operation::logical_and:
+		case operation::logical_or:
+			--depth_;
+			break;
+
+		case operation::logical_not:
+			break;
+
+		default:
+			++depth_;
+			filter_.max_stack_depth_ = (std::max)(filter_.max_stack_depth_, depth_);
+			break;
+		}
+	}
+
+	void parse_expression()
+	{
+		parse_term();
+		while (accept(L"or") || accept(L"||"))
+		{
+			parse_term();
+			emit(operation::logical_or);
+		}
+	}
+
+	void parse_term()
+	{
+		parse_factor();
+		while (accept(L"and") || accept(L"&&"))
+		{
+			parse_factor();
+			emit(operation::logical_and);
+		}
+	}
+
+	void parse_factor()
+	{
+		if (accept(L"not") || accept_negation())
+		{
+			parse_factor();
+			emit(operation::logical_not);
+			return;
+		}
+
+		if (accept(L"("))
+		{
+			parse_expression();
+			expect(L")", "Expected ')'");
+			return;
+		}
+
+		if (accept(L"$"))
+		{
+			parse_property_predicate();
+			return;
+		}
+
+		parse_header_predicate();
+	}
+
+	void parse_property_predicate()
+	{
+		auto name = read_identifier();
+		auto property_index = filter_.property_names_.size();
+		auto it = std::find(filter_.property_names_.cbegin(), filter_.property_names_.cend(), name);
+		if (it == filter_.property_names_.cend())
+			filter_.property_names_.push_back(name);
+		else
+			property_index = static_cast<std::size_t>(it - filter_.property_names_.cbegin());
+
+		auto compare = read_compare_operation();
+		if (!compare)
+			throw_error("Expected comparison operator");
+
+		skip_spaces();
+		if (position_ != expression_.size() && expression_[position_] == L'"')
+		{
+			switch (*compare)
+			{
+			case compare_operation::equal:
+			case compare_operation::not_equal:
+			case compare_operation::contains:
+			case compare_operation::starts_with:
+			case compare_operation::ends_with:
+				break;
+
+			default:
+				throw_error("Operator is not supported for strings");
+			}
+
+			filter_.strings_.push_back(read_string());
+			emit(operation::property_string_compare, header_field::pid, *compare,
+				filter_.strings_.size() - 1u, property_index);
+			return;
+		}
+
+		if (*compare > compare_operation::greater_equal)
+			throw_error("Operator is supported for strings only");
+
+		auto value = read_number();
+		emit(operation::property_compare, header_field::pid, *compare, value.magnitude, property_index,
+			value.negative);
+	}
+
+	void parse_header_predicate()
+	{
+		auto name = read_identifier();
+		if (name == L"provider")
+		{
+			compare_operation compare = compare_operation::equal;
+			if (accept(L"!="))
+				compare = compare_operation::not_equal;
+			else
+				expect(L"==", "Expected '==' or '!='");
+
+			skip_spaces();
+			auto end = expression_.find(L'}', position_);
+			if (position_ == expression_.size() || expression_[position_] != L'{' || end == std::wstring::npos)
+				throw_error("Expected GUID");
+
+			try
+			{
+				filter_.guids_.emplace_back(expression_.substr(position_, end - position_ + 1u));
+			}
+			catch (const std::exception&)
+			{
+				throw_error("Invalid GUID");
+			}
+
+			position_ = end + 1u;
+			emit(operation::provider_compare, header_field::pid, compare, 0, filter_.guids_.size() - 1u);
+			return;
+		}
+
+		auto field = parse_field(name);
+		if (accept(L"in"))
+		{
+			expect(L"(", "Expected '('");
+			std::vector<std::uint64_t> values;
+			do
+			{
+				values.push_back(read_unsigned_number());
+			}
+			while (accept(L","));
+			expect(L")", "Expected ')'");
+
+			std::sort(values.begin(), values.end());
+			values.erase(std::unique(values.begin(), values.end()), values.end());
+			filter_.value_sets_.push_back(std::move(values));
+			emit(operation::header_in, field, compare_operation::equal, 0, filter_.value_sets_.size() - 1u);
+			return;
+		}
+
+		if (accept(L"has"))
+		{
+			emit(operation::header_mask, field, compare_operation::equal, read_unsigned_number());
+			return;
+		}
+
+		auto compare = read_compare_operation();
+		if (!compare || *compare > compare_operation::greater_equal)
+			throw_error("Expected comparison operator");
+
+		emit(operation::header_compare, field, *compare, read_unsigned_number());
+	}
+
+	header_field parse_field(const std::wstring& name)
+	{
+		if (name == L"pid")
+			return header_field::pid;
+		if (name == L"tid")
+			return header_field::tid;
+		if (name == L"level")
+			return header_field::level;
+		if (name == L"opcode")
+			return header_field::opcode;
+		if (name == L"id")
+			return header_field::id;
+		if (name == L"version")
+			return header_field::version;
+		if (name == L"task")
+			return header_field::task;
+		if (name == L"channel")
+			return header_field::channel;
+		if (name == L"keyword")
+			return header_field::keyword;
+
+		throw_error("Unknown header field");
+	}
+
+private:
+	event_filter& filter_;
+	const std::wstring& expression_;
+	std::size_t position_ = 0;
+	std::size_t depth_ = 0;
+};
+
+event_filter::event_filter(const std::wstring& expression)
+	: expression_(expression)
+{
+	parser(*this, expression_).parse();
+	link_operands();
+}
+
+void event_filter::link_operands() noexcept
+{
+	//Program is in postfix order, the second operand of an operation ends
+	//right before it and the first one right before the second one starts
+	std::vector<std::size_t> starts(program_.size());
+	for (std::size_t i = 0; i != program_.size(); ++i)
+	{
+		auto& instr = program_[i];
+		starts[i] = i;
+		switch (instr.op)
+		{
+		case operation::logical_and:
+		case operation::logical_or:
+			{
+				auto right = i - 1u;
+				auto left = starts[right] - 1u;
+				starts[i] = starts[left];
+				instr.has_properties = program_[left].has_properties || program_[right].has_properties;
+
+				//Operands which need no decoding go first, they may decide the result
+				bool swap = program_[left].has_properties && !program_[right].has_properties;
+				instr.first_operand = swap ? right : left;
+				instr.second_operand = swap ? left : right;
+			}
+			break;
+
+		case operation::logical_not:
+			starts[i] = starts[i - 1u];
+			instr.has_properties = program_[i - 1u].has_properties;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+std::uint64_t event_filter::get_header_field(const EVENT_HEADER& header, header_field field) noexcept
+{
+	switch (field)
+	{
+	case header_field::pid:
+		return header.ProcessId;
+
+	case header_field::tid:
+		return header.ThreadId;
+
+	case header_field::level:
+		return header.EventDescriptor.Level;
+
+	case header_field::opcode:
+		return header.EventDescriptor.Opcode;
+
+	case header_field::id:
+		return header.EventDescriptor.Id;
+
+	case header_field::version:
+		return header.EventDescriptor.Version;
+
+	case header_field::task:
+		return header.EventDescriptor.Task;
+
+	case header_field::channel:
+		return header.EventDescriptor.Channel;
+
+	case header_field::keyword:
+		return header.EventDescriptor.Keyword;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+bool event_filter::compare_strings(const std::wstring& left, compare_operation compare,
+	const std::wstring& right)
+{
+	switch (compare)
+	{
+	case compare_operation::equal:
+		return left.size() == right.size()
+			&& std::equal(left.cbegin(), left.cend(), right.cbegin(), equal_no_case);
+
+	case compare_operation::not_equal:
+		return !compare_strings(left, compare_operation::equal, right);
+
+	case compare_operation::contains:
+		return std::search(left.cbegin(), left.cend(), right.cbegin(), right.cend(), equal_no_case)
+			!= left.cend() || right.empty();
+
+	case compare_operation::starts_with:
+		return left.size() >= right.size()
+			&& std::equal(right.cbegin(), right.cend(), left.cbegin(), equal_no_case);
+
+	case compare_operation::ends_with:
+		return left.size() >= right.size()
+			&& std::equal(right.crbegin(), right.crend(), left.crbegin(), equal_no_case);
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+bool event_filter::compare_values(std::uint64_t left, compare_operation compare,
+	std::uint64_t right) noexcept
+{
+	switch (compare)
+	{
+	case compare_operation::equal:
+		return left == right;
+
+	case compare_operation::not_equal:
+		return left != right;
+
+	case compare_operation::less:
+		return left < right;
+
+	case compare_operation::less_equal:
+		return left <= right;
+
+	case compare_operation::greater:
+		return left > right;
+
+	case compare_operation::greater_equal:
+		return left >= right;
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+bool event_filter::compare_numbers(bool left_negative, std::uint64_t left, compare_operation compare,
+	bool right_negative, std::uint64_t right) noexcept
+{
+	if (left_negative != right_negative)
+		return compare_values(left_negative ? 0u : 1u, compare, right_negative ? 0u : 1u);
+
+	//The larger magnitude is the smaller negative number
+	if (left_negative)
+		return compare_values(right, compare, left);
+
+	return compare_values(left, compare, right);
+}
+
+std::uint8_t event_filter::evaluate_header_instruction(const instruction& instr,
+	const EVENT_RECORD& record) const noexcept
+{
+	bool result = false;
+	switch (instr.op)
+	{
+	case operation::header_compare:
+		result = compare_values(get_header_field(record.EventHeader, instr.field),
+			instr.compare, instr.value);
+		break;
+
+	case operation::header_in:
+		{
+			const auto& values = value_sets_[instr.index];
+			result = std::binary_search(values.cbegin(), values.cend(),
+				get_header_field(record.EventHeader, instr.field));
+		}
+		break;
+
+	case operation::header_mask:
+		result = (get_header_field(record.EventHeader, instr.field)
+			& instr.value) != 0;
+		break;
+
+	case operation::provider_compare:
+		result = (guids_[instr.index] == record.EventHeader.ProviderId)
+			== (instr.compare == compare_operation::equal);
+		break;
+
+	default:
+		return match_maybe;
+	}
+
+	return result ? match_yes : match_no;
+}
+
+std::uint8_t event_filter::evaluate_header(std::size_t index, const EVENT_RECORD& record) const noexcept
+{
+	const auto& instr = program_[index];
+	switch (instr.op)
+	{
+	case operation::logical_and:
+		{
+			auto first = evaluate_header(instr.first_operand, record);
+			if (first == match_no)
+				return match_no;
+
+			return (std::min)(first, evaluate_header(instr.second_operand, record));
+		}
+
+	case operation::logical_or:
+		{
+			auto first = evaluate_header(instr.first_operand, record);
+			if (first == match_yes)
+				return match_yes;
+
+			return (std::max)(first, evaluate_header(instr.second_operand, record));
+		}
+
+	case operation::logical_not:
+		return static_cast<std::uint8_t>(match_yes - evaluate_header(index - 1u, record));
+
+	default:
+		break;
+	}
+
+	return evaluate_header_instruction(instr, record);
+}
+
+event_filter::header_match event_filter::match_header(const EVENT_RECORD& record) const noexcept
+{
+	return static_cast<header_match>(evaluate_header(program_.size() - 1u, record));
+}
+
+void event_filter::match_headers(const PEVENT_RECORD* records, std::size_t count,
+	header_match* results) const
+{
+	if (!count)
+		return;
+
+	//Column-wise evaluation: every instruction is applied to the whole batch,
+	//so the comparison loops are simple enough to be vectorized
+	std::vector<std::vector<std::uint8_t>> stack(max_stack_depth_, std::vector<std::uint8_t>(count));
+	std::vector<std::uint64_t> column(count);
+	std::size_t depth = 0;
+	for (const auto& instr : program_)
+	{
+		switch (instr.op)
+		{
+		case operation::logical_and:
+			{
+				--depth;
+				auto& left = stack[depth - 1u];
+				const auto& right = stack[depth];
+				for (std::size_t i = 0; i != count; ++i)
+					left[i] = (std::min)(left[i], right[i]);
+			}
+			continue;
+
+		case operation::logical_or:
+			{
+				--depth;
+				auto& left = stack[depth - 1u];
+				const auto& right = stack[depth];
+				for (std::size_t i = 0; i != count; ++i)
+					left[i] = (std::max)(left[i], right[i]);
+			}
+			continue;
+
+		case operation::logical_not:
+			{
+				auto& value = stack[depth - 1u];
+				for (std::size_t i = 0; i != count; ++i)
+					value[i] = static_cast<std::uint8_t>(match_yes - value[i]);
+			}
+			continue;
+
+		default:
+			break;
+		}
+
+		auto& result = stack[depth++];
+		switch (instr.op)
+		{
+		case operation::header_compare:
+		case operation::header_mask:
+			{
+				for (std::size_t i = 0; i != count; ++i)
+					column[i] = get_header_field(records[i]->EventHeader, instr.field);
+
+				auto value = instr.value;
+				auto compare = instr.op == operation::header_mask ? compare_operation::contains : instr.compare;
+				switch (compare)
+				{
+				case compare_operation::equal:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = column[i] == value ? match_yes : match_no;
+					break;
+
+				case compare_operation::not_equal:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = column[i] != value ? match_yes : match_no;
+					break;
+
+				case compare_operation::less:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = column[i] < value ? match_yes : match_no;
+					break;
+
+				case compare_operation::less_equal:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = column[i] <= value ? match_yes : match_no;
+					break;
+
+				case compare_operation::greater:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = column[i] > value ? match_yes : match_no;
+					break;
+
+				case compare_operation::greater_equal:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = column[i] >= value ? match_yes : match_no;
+					break;
+
+				default:
+					for (std::size_t i = 0; i != count; ++i)
+						result[i] = (column[i] & value) ? match_yes : match_no;
+					break;
+				}
+			}
+			break;
+
+		case operation::property_compare:
+		case operation::property_string_compare:
+			std::fill(result.begin(), result.end(), match_maybe);
+			break;
+
+		default:
+			for (std::size_t i = 0; i != count; ++i)
+				result[i] = evaluate_header_instruction(instr, *records[i]);
+			break;
+		}
+	}
+
+	for (std::size_t i = 0; i != count; ++i)
+		results[i] = static_cast<header_match>(stack[0][i]);
+}
+
+bool event_filter::evaluate_property_instruction(const instruction& instr,
+	property_cache& cache) const
+{
+	auto& value = cache.values[instr.index];
+	if (!value.decoded)
+	{
+		value.decoded = true;
+		auto property_index = cache.info.try_find_property_index(property_names_[instr.index]);
+		auto prop = property_index
+			? cache.info.try_get_plain_property_value(*property_index)
+			: decode_result<event_property>(property_index.get_failure());
+		if (prop)
+		{
+			if (is_string_type(prop->get_in_type()))
+			{
+				auto text = property_to_string(*prop);
+				if (text)
+					value.text = std::move(*text);
+
+				value.valid = text.has_value();
+			}
+			else
+			{
+				auto number = property_to_integer(*prop);
+				value.is_signed = is_signed_type(prop->get_in_type());
+				value.number = number.value_or(0);
+				value.valid = number.has_value();
+			}
+		}
+	}
+
+	if (!value.valid)
+		return false;
+
+	if (instr.op == operation::property_string_compare)
+	{
+		if (!value.text)
+			return false;
+
+		return compare_strings(*value.text, instr.compare,
+			strings_[static_cast<std::size_t>(instr.value)]);
+	}
+
+	if (value.text)
+		return false;
+
+	//Numbers of unsigned properties are stored as they are
+	auto magnitude = static_cast<std::uint64_t>(value.number);
+	bool negative = value.is_signed && value.number < 0;
+	if (negative)
+		magnitude = 0u - magnitude;
+
+	return compare_numbers(negative, magnitude, instr.compare, instr.negative, instr.value);
+}
+
+bool event_filter::evaluate(std::size_t index, const EVENT_RECORD& record, property_cache& cache) const
+{
+	const auto& instr = program_[index];
+	if (!instr.has_properties)
+		return evaluate_header(index, record) == match_yes;
+
+	switch (instr.op)
+	{
+	case operation::logical_and:
+		return evaluate(instr.first_operand, record, cache)
+			&& evaluate(instr.second_operand, record, cache);
+
+	case operation::logical_or:
+		return evaluate(instr.first_operand, record, cache)
+			|| evaluate(instr.second_operand, record, cache);
+
+	case operation::logical_not:
+		return !evaluate(index - 1u, record, cache);
+
+	default:
+		break;
+	}
+
+	return evaluate_property_instruction(instr, cache);
+}
+
+bool event_filter::matches(PEVENT_RECORD record) const
+{
+	auto header_result = match_header(*record);
+	if (header_result != header_match::maybe)
+		return header_result == header_match::yes;
+
+	property_cache cache(record, property_names_.size());
+	return evaluate(program_.size() - 1u, *record, cache);
+}
+
+void event_filter::matches(const PEVENT_RECORD* records, std::size_t count, bool* results) const
+{
+	std::vector<header_match> header_results(count);
+	match_headers(records, count, header_results.data());
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		results[i] = header_results[i] == header_match::maybe
+			? matches(records[i]) : header_results[i] == header_match::yes;
+	}
+}
+} //namespace event_tracing
@@ -0,0 +1,437 @@
+#include "event_tracing/event_forwarder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <random>
+
+#include <boost/asio.hpp>
+
+#include "event_tracing/event_record_copy.h"
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/forwarding_protocol.h"
+
+namespace event_tracing
+{
+class event_forwarder::connection
+{
+public:
+	connection(event_forwarder& forwarder, const std::string& host_id,
+		const std::string& collector_host, unsigned short collector_port)
+		: forwarder_(forwarder)
+		, collector_host_(collector_host)
+		, collector_port_(std::to_string(collector_port))
+		, socket_(io_context_)
+		, resolver_(io_context_)
+		, reconnect_timer_(io_context_)
+		, batch_timer_(io_context_)
+		, reconnect_delay_(forwarder.options_.min_reconnect_delay)
+	{
+		//Batch sequence numbers start anew with every forwarder,
+		//so the collector tells streams of the same host apart
+		std::random_device random;
+		auto stream_id = (static_cast<std::uint64_t>(random()) << 32) ^ random()
+			^ static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+		append_forward_frame(hello_frame_, forward_frame_type::hello, stream_id,
+			reinterpret_cast<const std::uint8_t*>(host_id.data()), host_id.size(), false);
+	}
+
+	void run()
+	{
+		connect();
+		wait_for_batch();
+		io_context_.run();
+	}
+
+	void stop()
+	{
+		io_context_.stop();
+	}
+
+	void notify()
+	{
+		boost::asio::post(io_context_, [this]
+		{
+			forwarder_.encode_batches();
+			send_next();
+		});
+	}
+
+private:
+	void connect()
+	{
+		auto generation = generation_;
+		resolver_.async_resolve(collector_host_, collector_port_,
+			[this, generation](const boost::system::error_code& error,
+				boost::asio::ip::tcp::resolver::results_type endpoints)
+		{
+			if (generation != generation_)
+				return;
+
+			if (error)
+			{
+				disconnect(generation);
+				return;
+			}
+
+			boost::asio::async_connect(socket_, endpoints, [this, generation](
+				const boost::system::error_code& error, const boost::asio::ip::tcp::endpoint&)
+			{
+				if (generation != generation_)
+					return;
+
+				if (error)
+				{
+					disconnect(generation);
+					return;
+				}
+
+				boost::system::error_code ignored;
+				socket_.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+				boost::asio::async_write(socket_, boost::asio::buffer(hello_frame_),
+					[this, generation](const boost::system::error_code& error, std::size_t)
+				{
+					if (error)
+						disconnect(generation);
+				});
+
+				read_ack();
+			});
+		});
+	}
+
+	void read_ack()
+	{
+		auto generation = generation_;
+		boost::asio::async_read(socket_, boost::asio::buffer(&ack_header_, sizeof(ack_header_)),
+			[this, generation](const boost::system::error_code& error, std::size_t)
+		{
+			if (generation != generation_)
+				return;
+
+			if (error || !is_valid_forward_frame(ack_header_) || ack_header_.size
+				|| ack_header_.type != static_cast<std::uint8_t>(forward_frame_type::ack))
+			{
+				disconnect(generation);
+				return;
+			}
+
+			auto acknowledged_count = forwarder_.acknowledge(ack_header_.sequence);
+			if (!ready_)
+			{
+				//Reply to hello, batches the collector has not processed are resent
+				ready_ = true;
+				sent_count_ = 0;
+				reconnect_delay_ = forwarder_.options_.min_reconnect_delay;
+				++forwarder_.connection_count_;
+			}
+			else
+			{
+				sent_count_ -= (std::min)(sent_count_, acknowledged_count);
+			}
+
+			send_next();
+			read_ack();
+		});
+	}
+
+	void send_next()
+	{
+		if (!ready_ || writing_ || sent_count_ >= forwarder_.options_.max_unacknowledged_batches)
+			return;
+
+		if (!forwarder_.queue_.get(sent_count_, send_buffer_))
+			return;
+
+		writing_ = true;
+		auto generation = generation_;
+		boost::asio::async_write(socket_, boost::asio::buffer(send_buffer_),
+			[this, generation](const boost::system::error_code& error, std::size_t)
+		{
+			if (generation != generation_)
+				return;
+
+			writing_ = false;
+			if (error)
+			{
+				disconnect(generation);
+				return;
+			}
+
+			++sent_count_;
+			send_next();
+		});
+	}
+
+	//Pending operations of the closed connection complete with errors and are ignored
+	void disconnect(std::uint64_t generation)
+	{
+		if (generation != generation_)
+			return;
+
+		++generation_;
+		boost::system::error_code ignored;
+		socket_.close(ignored);
+		ready_ = false;
+		writing_ = false;
+		sent_count_ = 0;
+
+		reconnect_timer_.expires_after(reconnect_delay_);
+		reconnect_delay_ = (std::min)(reconnect_delay_ * 2, forwarder_.options_.max_reconnect_delay);
+		reconnect_timer_.async_wait([this](const boost::system::error_code& error)
+		{
+			if (!error)
+				connect();
+		});
+	}
+
+	void wait_for_batch()
+	{
+		batch_timer_.expires_after(forwarder_.options_.max_batch_delay / 2);
+		batch_timer_.async_wait([this](const boost::system::error_code& error)
+		{
+			if (error)
+				return;
+
+			forwarder_.seal_expired_batch();
+			forwarder_.encode_batches();
+			send_next();
+			wait_for_batch();
+		});
+	}
+
+private:
+	event_forwarder& forwarder_;
+	std::string collector_host_;
+	std::string collector_port_;
+	boost::asio::io_context io_context_;
+	boost::asio::ip::tcp::socket socket_;
+	boost::asio::ip::tcp::resolver resolver_;
+	boost::asio::steady_timer reconnect_timer_;
+	boost::asio::steady_timer batch_timer_;
+	std::chrono::milliseconds reconnect_delay_;
+	std::vector<std::uint8_t> hello_frame_;
+	std::vector<std::uint8_t> send_buffer_;
+	forward_frame_header ack_header_;
+	std::uint64_t generation_ = 0;
+	bool ready_ = false;
+	bool writing_ = false;
+	//Queued batches sent and not yet acknowledged
+	std::size_t sent_count_ = 0;
+};
+
+event_forwarder::event_forwarder(const std::string& host_id, const std::string& collector_host,
+	unsigned short collector_port, const event_forwarder_options& options)
+	: options_(options)
+	, queue_(options.max_memory_size, options.spill_file_name, options.max_spill_size)
+{
+	//A batch exceeds the size it is sealed at by one record and one schema
+	//at most, which keeps it within the frame size limit
+	options_.max_batch_size = (std::min)(options_.max_batch_size, max_forward_frame_size / 2u);
+	batch_.reserve(options_.max_batch_size + options_.max_batch_size / 4u);
+	connection_ = std::make_unique<connection>(*this, host_id, collector_host, collector_port);
+}
+
+event_forwarder::~event_forwarder()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+void event_forwarder::forward(PEVENT_RECORD record)
+{
+	bool sealed = false;
+	bool over_limit = false;
+	{
+		std::lock_guard<std::mutex> lock(batch_mutex_);
+		if (batch_.empty())
+			batch_started_at_ = std::chrono::steady_clock::now();
+
+		if (event_schema_cache::is_cacheable(*record))
+			add_schema(record);
+
+		auto size = event_record_copy::get_serialized_size(*record);
+		append_forward_entry(batch_, forward_entry_type::record, size);
+		auto offset = batch_.size();
+		batch_.resize(offset + size);
+		event_record_copy::serialize(*record, batch_.data() + offset);
+		++batch_record_count_;
+		++forwarded_count_;
+
+		if (batch_.size() >= options_.max_batch_size)
+		{
+			seal_batch();
+			sealed = true;
+			over_limit = unencoded_size_ > options_.max_memory_size;
+		}
+	}
+
+	//The connection thread does not keep up, batches are spilled from here
+	if (over_limit)
+		encode_batches();
+
+	if (sealed)
+		connection_->notify();
+}
+
+void event_forwarder::flush()
+{
+	{
+		std::lock_guard<std::mutex> lock(batch_mutex_);
+		seal_batch();
+	}
+
+	connection_->notify();
+}
+
+void event_forwarder::run_async()
+{
+	if (connection_thread_.joinable())
+		return;
+
+	connection_thread_ = std::thread([this]
+	{
+		connection_->run();
+	});
+}
+
+void event_forwarder::stop(std::chrono::milliseconds timeout)
+{
+	if (!connection_thread_.joinable())
+		return;
+
+	flush();
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		if (!unencoded_batch_count_ && !queue_.size())
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	connection_->stop();
+	connection_thread_.join();
+}
+
+void event_forwarder::seal_batch()
+{
+	if (batch_.empty())
+		return;
+
+	if (options_.spill_file_name.empty() && unencoded_size_ + batch_.size() > options_.max_memory_size)
+	{
+		dropped_count_ += batch_record_count_;
+		batch_.clear();
+	}
+	else
+	{
+		unencoded_size_ += batch_.size();
+		sealed_batches_.push_back({ std::move(batch_), batch_record_count_ });
+		++unencoded_batch_count_;
+		batch_ = std::vector<std::uint8_t>();
+		batch_.reserve(options_.max_batch_size + options_.max_batch_size / 4u);
+	}
+
+	batch_record_count_ = 0;
+	batch_schemas_.clear();
+}
+
+void event_forwarder::add_schema(PEVENT_RECORD record)
+{
+	const auto& descriptor = record->EventHeader.EventDescriptor;
+	auto it = std::find_if(batch_schemas_.cbegin(), batch_schemas_.cend(), [record, &descriptor](const schema_key& key)
+	{
+		return key.id == descriptor.Id && key.version == descriptor.Version && key.opcode == descriptor.Opcode
+			&& !std::memcmp(&key.provider_id, &record->EventHeader.ProviderId, sizeof(GUID));
+	});
+
+	if (it != batch_schemas_.cend())
+		return;
+
+	//Events without a schema are forwarded anyway
+	batch_schemas_.push_back({ record->EventHeader.ProviderId, descriptor.Id,
+		descriptor.Version, descriptor.Opcode });
+	auto schema = schemas_.get(record);
+	if (!schema)
+		return;
+
+	//A terminating zero lets the collector check that the strings end within the data
+	const wchar_t terminator = 0;
+	auto info_size = (*schema)->get_info_size();
+	append_forward_entry(batch_, forward_entry_type::schema,
+		sizeof(GUID) + sizeof(EVENT_DESCRIPTOR) + info_size + sizeof(terminator));
+	auto append = [this](const void* data, std::size_t size)
+	{
+		auto bytes = static_cast<const std::uint8_t*>(data);
+		batch_.insert(batch_.end(), bytes, bytes + size);
+	};
+
+	append(&record->EventHeader.ProviderId, sizeof(GUID));
+	append(&descriptor, sizeof(descriptor));
+	append((*schema)->get_info(), info_size);
+	append(&terminator, sizeof(terminator));
+}
+
+void event_forwarder::seal_expired_batch()
+{
+	std::lock_guard<std::mutex> lock(batch_mutex_);
+	if (!batch_.empty() && std::chrono::steady_clock::now() - batch_started_at_ >= options_.max_batch_delay)
+		seal_batch();
+}
+
+void event_forwarder::encode_batches()
+{
+	std::lock_guard<std::mutex> encode_lock(encode_mutex_);
+	std::vector<sealed_batch> batches;
+	{
+		std::lock_guard<std::mutex> lock(batch_mutex_);
+		batches.swap(sealed_batches_);
+	}
+
+	for (auto& batch : batches)
+	{
+		std::vector<std::uint8_t> frame;
+		bool encoded = true;
+		try
+		{
+			append_forward_frame(frame, forward_frame_type::batch, next_sequence_,
+				batch.data.data(), batch.data.size(), true);
+		}
+		catch (const event_trace_error&)
+		{
+			encoded = false;
+		}
+
+		if (encoded && queue_.push(next_sequence_, std::move(frame)))
+			queued_record_counts_.emplace_back(next_sequence_++, batch.record_count);
+		else
+			dropped_count_ += batch.record_count;
+
+		{
+			std::lock_guard<std::mutex> lock(batch_mutex_);
+			unencoded_size_ -= batch.data.size();
+		}
+
+		--unencoded_batch_count_;
+	}
+}
+
+std::size_t event_forwarder::acknowledge(std::uint64_t sequence)
+{
+	std::lock_guard<std::mutex> encode_lock(encode_mutex_);
+	while (!queued_record_counts_.empty() && queued_record_counts_.front().first <= sequence)
+	{
+		acknowledged_count_ += queued_record_counts_.front().second;
+		queued_record_counts_.pop_front();
+	}
+
+	return queue_.acknowledge(sequence);
+}
+} //namespace event_tracing
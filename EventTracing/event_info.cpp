@@ -1,12 +1,228 @@
 #include "event_tracing/event_info.h"
 
 #include <cstdint>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "event_tracing/event_message.h"
 #include "event_tracing/event_trace_error.h"
+#include "event_tracing/event_visitor.h"
+#include "event_tracing/self_profiler.h"
 
 namespace event_tracing
 {
+namespace
+{
+const wchar_t* get_schema_property_name(const TRACE_EVENT_INFO* info, ULONG index) noexcept
+{
+	return reinterpret_cast<const WCHAR*>(reinterpret_cast<const BYTE*>(info)
+		+ info->EventPropertyInfoArray[index].NameOffset);
+}
+
+bool is_schema_property_struct(const TRACE_EVENT_INFO* info, ULONG index) noexcept
+{
+	return (info->EventPropertyInfoArray[index].Flags & PropertyStruct) == PropertyStruct;
+}
+
+//Remembers the size of the last top-level array
+class array_size_visitor : public event_visitor
+{
+public:
+	void begin_struct(const wchar_t*) override
+	{
+		++depth_;
+	}
+
+	void end_struct() override
+	{
+		--depth_;
+	}
+
+	void begin_array(const wchar_t*, ULONG size) override
+	{
+		if (!depth_)
+			size_ = size;
+	}
+
+	ULONG get_size() const noexcept
+	{
+		return size_;
+	}
+
+private:
+	ULONG depth_ = 0;
+	ULONG size_ = 0;
+};
+
+//Copies one value of a top-level property, or of a member of a top-level struct,
+//and counts the elements of the property and of the member on the way
+class property_value_visitor : public event_visitor
+{
+public:
+	static constexpr const ULONG no_member = 0xffffffffu;
+
+public:
+	//Member ordinal is the index of the member within the struct, or no_member
+	property_value_visitor(ULONG top_level_index, ULONG element_index,
+		ULONG member_ordinal, ULONG member_element_index) noexcept
+		: top_level_index_(top_level_index)
+		, element_index_(element_index)
+		, member_ordinal_(member_ordinal)
+		, member_element_index_(member_element_index)
+	{
+	}
+
+	void begin_struct(const wchar_t*) override
+	{
+		if (!depth_)
+			begin_top_level(1u, 0u);
+
+		if (in_target_ && depth_ == element_depth_)
+		{
+			in_element_ = element_count_++ == element_index_;
+			member_count_ = 0;
+		}
+		else if (in_element_ && depth_ == element_depth_ + 1u)
+		{
+			begin_member(1u, no_depth);
+		}
+
+		++depth_;
+	}
+
+	void end_struct() override
+	{
+		--depth_;
+		if (in_target_ && depth_ == element_depth_)
+			in_element_ = in_member_ = false;
+	}
+
+	void begin_array(const wchar_t*, ULONG size) override
+	{
+		if (!depth_)
+			begin_top_level(size, 1u);
+		else if (in_element_ && depth_ == element_depth_ + 1u)
+			begin_member(size, depth_ + 1u);
+
+		++depth_;
+	}
+
+	void end_array() override
+	{
+		--depth_;
+	}
+
+	void value(const event_property_view& prop) override
+	{
+		if (!depth_)
+			begin_top_level(1u, 0u);
+		else if (in_element_ && depth_ == element_depth_ + 1u)
+			begin_member(1u, depth_);
+
+		if (member_ordinal_ == no_member)
+		{
+			if (in_target_ && depth_ == element_depth_ && element_count_++ == element_index_)
+				copy(prop);
+		}
+		else if (in_member_ && depth_ == member_element_depth_
+			&& member_element_count_++ == member_element_index_)
+		{
+			copy(prop);
+		}
+	}
+
+	ULONG get_size() const noexcept
+	{
+		return size_;
+	}
+
+	ULONG get_member_size() const noexcept
+	{
+		return member_size_;
+	}
+
+	bool has_value() const noexcept
+	{
+		return has_value_;
+	}
+
+	event_property get_value()
+	{
+		return event_property(in_type_, out_type_, wide_pointer_, std::move(raw_value_),
+			std::wstring(name_ ? name_ : L""), map_);
+	}
+
+private:
+	static constexpr const ULONG no_depth = 0xffffffffu;
+
+private:
+	void begin_top_level(ULONG size, ULONG element_depth) noexcept
+	{
+		in_target_ = top_level_count_++ == top_level_index_;
+		if (in_target_)
+		{
+			size_ = size;
+			element_depth_ = element_depth;
+		}
+	}
+
+	void begin_member(ULONG size, ULONG element_depth) noexcept
+	{
+		in_member_ = member_count_++ == member_ordinal_;
+		if (in_member_)
+		{
+			member_size_ = size;
+			member_element_depth_ = element_depth;
+			member_element_count_ = 0;
+		}
+	}
+
+	void copy(const event_property_view& prop)
+	{
+		has_value_ = true;
+		in_type_ = prop.get_in_type();
+		out_type_ = prop.get_out_type();
+		wide_pointer_ = prop.is_wide_pointer();
+		raw_value_.assign(prop.get_data(), prop.get_data() + prop.get_size());
+		name_ = prop.get_name();
+		map_ = prop.get_map();
+	}
+
+private:
+	ULONG top_level_index_;
+	ULONG element_index_;
+	ULONG member_ordinal_;
+	ULONG member_element_index_;
+
+	ULONG depth_ = 0;
+	ULONG top_level_count_ = 0;
+	bool in_target_ = false;
+	ULONG size_ = 0;
+	//Depth of the target property elements
+	ULONG element_depth_ = no_depth;
+	ULONG element_count_ = 0;
+	//Inside the struct element holding the target member
+	bool in_element_ = false;
+	ULONG member_count_ = 0;
+	bool in_member_ = false;
+	ULONG member_size_ = 0;
+	ULONG member_element_depth_ = no_depth;
+	ULONG member_element_count_ = 0;
+
+	bool has_value_ = false;
+	USHORT in_type_ = 0;
+	USHORT out_type_ = 0;
+	bool wide_pointer_ = false;
+	event_property::raw_value_type raw_value_;
+	const wchar_t* name_ = nullptr;
+	const event_value_map* map_ = nullptr;
+};
+
+constexpr const ULONG property_value_visitor::no_member;
+constexpr const ULONG property_value_visitor::no_depth;
+} //namespace
+
 event_info_structure::event_info_structure(LPCWSTR name,
 	USHORT struct_start_index, USHORT member_count, ULONG top_level_index) noexcept
 	: name_(name)
@@ -16,218 +232,412 @@ event_info_structure::event_info_structure(LPCWSTR name,
 {
 }
 
-event_info::event_info(PEVENT_RECORD record)
-	: data_(sizeof(TRACE_EVENT_INFO))
+event_info::event_info(PEVENT_RECORD record) noexcept
+	: record_(record)
+{
+}
+
+event_info::event_info(PEVENT_RECORD record, event_schema_cache& schema_cache) noexcept
+	: schema_cache_(&schema_cache)
 	, record_(record)
 {
-	auto buffer_size = static_cast<DWORD>(data_.size());
-	auto status = ::TdhGetEventInformation(record, 0, nullptr, *this, &buffer_size);
-	if (ERROR_INSUFFICIENT_BUFFER == status)
+}
+
+decode_result<const event_schema*> event_info::try_get_schema() const
+{
+	//Failure is remembered too, so an event without a schema is looked up once
+	if (!schema_ && schema_failure_.error == decode_error::none)
 	{
-		data_.resize(buffer_size);
-		status = ::TdhGetEventInformation(record, 0, nullptr, *this, &buffer_size);
+		EVENT_TRACING_PROFILE_SCOPE("event_info::try_get_schema");
+		auto schema = schema_cache_ ? schema_cache_->get(record_) : event_schema::load(record_);
+		if (schema)
+			schema_ = std::move(*schema);
+		else
+			schema_failure_ = schema.get_failure();
 	}
 
-	if (status != ERROR_SUCCESS)
-		throw event_trace_error("Unable to get event information", status);
-}
+	if (!schema_)
+		return schema_failure_;
 
-const EVENT_DESCRIPTOR& event_info::get_event_descriptor() const noexcept
-{
-	return static_cast<const TRACE_EVENT_INFO*>(*this)->EventDescriptor;
+	return schema_.get();
 }
 
-USHORT event_info::get_event_id() const noexcept
+decode_result<const TRACE_EVENT_INFO*> event_info::try_get_property_schema() const
 {
-	return get_event_descriptor().Id;
+	if (has_string_only())
+		return decode_error::string_only_event;
+
+	auto schema = try_get_schema();
+	if (!schema)
+		return schema.get_failure();
+
+	return (*schema)->get_info();
 }
 
-ULONG event_info::get_top_level_property_count() const noexcept
+ULONG event_info::get_top_level_property_count() const
 {
-	return static_cast<const TRACE_EVENT_INFO*>(*this)->TopLevelPropertyCount;
+	return get_schema().get_top_level_property_count();
 }
 
-bool event_info::find_property_index(const std::wstring& name, ULONG& top_level_index) const
+decode_result<ULONG> event_info::try_find_property_index(const std::wstring& name) const
 {
-	check_if_has_properties();
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	for (ULONG i = 0; i != info->TopLevelPropertyCount; ++i)
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
+	for (ULONG i = 0; i != (*info)->TopLevelPropertyCount; ++i)
 	{
-		if (name == get_property_name(i))
-		{
-			top_level_index = i;
-			return true;
-		}
+		if (name == get_schema_property_name(*info, i))
+			return i;
 	}
 
-	return false;
+	return decode_error::property_not_found;
 }
 
-bool event_info::find_property_index(const event_info_structure& structure,
-	const std::wstring& name, ULONG& index) const
+decode_result<ULONG> event_info::try_find_property_index(const event_info_structure& structure,
+	const std::wstring& name) const
 {
-	check_if_has_properties();
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
 	ULONG end = structure.get_struct_start_index() + structure.get_member_count();
 	for (ULONG i = structure.get_struct_start_index(); i != end; ++i)
 	{
-		if (name == get_property_name(i))
-		{
-			index = i;
-			return true;
-		}
+		if (name == get_schema_property_name(*info, i))
+			return i;
 	}
 
-	return false;
+	return decode_error::property_not_found;
 }
 
-ULONG event_info::get_array_property_size(ULONG top_level_index) const
+bool event_info::find_property_index(const std::wstring& name, ULONG& top_level_index) const
 {
-	check_if_has_properties();
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	if ((info->EventPropertyInfoArray[top_level_index].Flags & PropertyParamCount) == PropertyParamCount)
+	auto result = try_find_property_index(name);
+	if (!result && result.get_error() != decode_error::property_not_found)
+		throw_decode_error(result.get_failure());
+
+	top_level_index = result.value_or(top_level_index);
+	return result.has_value();
+}
+
+bool event_info::find_property_index(const event_info_structure& structure,
+	const std::wstring& name, ULONG& index) const
+{
+	auto result = try_find_property_index(structure, name);
+	if (!result && result.get_error() != decode_error::property_not_found)
+		throw_decode_error(result.get_failure());
+
+	index = result.value_or(index);
+	return result.has_value();
+}
+
+decode_result<ULONG> event_info::try_get_array_property_size(ULONG top_level_index) const
+{
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
+	const auto& property_info = (*info)->EventPropertyInfoArray[top_level_index];
+	if ((property_info.Flags & PropertyParamCount) == PropertyParamCount
+		&& property_info.countPropertyIndex == payload_count_index)
 	{
-		return get_plain_property_value<std::uint32_t>(
-			info->EventPropertyInfoArray[top_level_index].countPropertyIndex);
+		//The count is stored right before the elements, so the payload is walked up to them
+		if (top_level_index >= (*info)->TopLevelPropertyCount)
+			return decode_error::unsupported_type;
+
+		array_size_visitor visitor;
+		auto result = visit_event(**try_get_schema(), *record_, visitor, top_level_index + 1u);
+		if (!result)
+			return result.get_failure();
+
+		return visitor.get_size();
 	}
 
-	return info->EventPropertyInfoArray[top_level_index].count;
+	if ((property_info.Flags & PropertyParamCount) == PropertyParamCount)
+	{
+		auto count = try_get_plain_property_value<std::uint32_t>(property_info.countPropertyIndex);
+		if (!count)
+			return count.get_failure();
+
+		return static_cast<ULONG>(*count);
+	}
+
+	return static_cast<ULONG>(property_info.count);
+}
+
+decode_result<ULONG> event_info::try_get_array_property_size(const event_info_structure& structure,
+	ULONG struct_member_index) const
+{
+	return try_get_array_property_size(structure.get_struct_start_index() + struct_member_index);
+}
+
+ULONG event_info::get_array_property_size(ULONG top_level_index) const
+{
+	return try_get_array_property_size(top_level_index).value();
 }
 
 ULONG event_info::get_array_property_size(const event_info_structure& structure,
 	ULONG struct_member_index) const
 {
-	return get_array_property_size(structure.get_struct_start_index() + struct_member_index);
+	return try_get_array_property_size(structure, struct_member_index).value();
+}
+
+decode_result<event_property> event_info::try_get_plain_property_value(ULONG top_level_index) const
+{
+	return try_get_property_value(top_level_index, 0u, false);
+}
+
+decode_result<event_property> event_info::try_get_plain_property_value(
+	const event_info_structure& structure, ULONG struct_member_index) const
+{
+	return try_get_property_value(structure, 0u, struct_member_index,
+		0u, false, false);
+}
+
+decode_result<event_property> event_info::try_get_plain_property_value(
+	const event_info_structure& structure, ULONG struct_index, ULONG struct_member_index) const
+{
+	return try_get_property_value(structure, struct_index, struct_member_index,
+		0u, true, false);
+}
+
+decode_result<event_property> event_info::try_get_array_property_value(ULONG top_level_index,
+	ULONG element_index) const
+{
+	return try_get_property_value(top_level_index, element_index, true);
+}
+
+decode_result<event_property> event_info::try_get_array_property_value(
+	const event_info_structure& structure, ULONG struct_index, ULONG struct_member_index,
+	ULONG struct_element_index) const
+{
+	return try_get_property_value(structure, struct_index, struct_member_index,
+		struct_element_index, true, true);
 }
 
 event_property event_info::get_plain_property_value(ULONG top_level_index) const
 {
-	return get_array_property_value(top_level_index, 0u, false);
+	return try_get_plain_property_value(top_level_index).value();
 }
 
 event_property event_info::get_plain_property_value(const event_info_structure& structure,
 	ULONG struct_member_index) const
 {
-	return get_array_property_value(structure, 0u, struct_member_index,
-		0u, false, false);
+	return try_get_plain_property_value(structure, struct_member_index).value();
 }
 
 event_property event_info::get_plain_property_value(const event_info_structure& structure,
 	ULONG struct_index, ULONG struct_member_index) const
 {
-	return get_array_property_value(structure, struct_index, struct_member_index,
-		0u, true, false);
+	return try_get_plain_property_value(structure, struct_index, struct_member_index).value();
 }
 
 event_property event_info::get_array_property_value(ULONG top_level_index, ULONG element_index) const
 {
-	return get_array_property_value(top_level_index, element_index, true);
+	return try_get_array_property_value(top_level_index, element_index).value();
 }
 
 event_property event_info::get_array_property_value(const event_info_structure& structure,
 	ULONG struct_index, ULONG struct_member_index, ULONG struct_element_index) const
 {
-	return get_array_property_value(structure, struct_index, struct_member_index,
-		struct_element_index, true, true);
+	return try_get_array_property_value(structure, struct_index, struct_member_index,
+		struct_element_index).value();
+}
+
+decode_result<bool> event_info::try_is_property_struct(ULONG top_level_index) const
+{
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
+	return is_schema_property_struct(*info, top_level_index);
 }
 
 bool event_info::is_property_struct(ULONG top_level_index) const
 {
-	check_if_has_properties();
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	return (info->EventPropertyInfoArray[top_level_index].Flags & PropertyStruct) == PropertyStruct;
+	return try_is_property_struct(top_level_index).value();
 }
 
-event_info_structure event_info::get_structure(ULONG top_level_index) const
+decode_result<event_info_structure> event_info::try_get_structure(ULONG top_level_index) const
 {
-	if(!is_property_struct(top_level_index))
-		throw event_trace_error("Expected structure, got plain value");
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
 
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	auto struct_start_index = info->EventPropertyInfoArray[top_level_index].structType.StructStartIndex;
-	auto member_count = info->EventPropertyInfoArray[top_level_index].structType.NumOfStructMembers;
-	return event_info_structure(get_property_name(top_level_index),
-		struct_start_index, member_count, top_level_index);
+	if (!is_schema_property_struct(*info, top_level_index))
+		return decode_error::structure_expected;
+
+	const auto& property_info = (*info)->EventPropertyInfoArray[top_level_index];
+	return event_info_structure(get_schema_property_name(*info, top_level_index),
+		property_info.structType.StructStartIndex, property_info.structType.NumOfStructMembers,
+		top_level_index);
 }
 
-event_property event_info::get_array_property_value(const event_info_structure& structure,
+event_info_structure event_info::get_structure(ULONG top_level_index) const
+{
+	return try_get_structure(top_level_index).value();
+}
+
+decode_result<event_property> event_info::try_get_property_value(const event_info_structure& structure,
 	ULONG struct_index, ULONG struct_member_index, ULONG struct_element_index,
 	bool is_array, bool is_struct_member_array) const
 {
+	if (schema_cache_)
+	{
+		return try_decode_property_value(structure.get_top_level_index(), struct_index,
+			structure.get_struct_start_index() + struct_member_index, struct_element_index,
+			is_array, true, is_struct_member_array);
+	}
+
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
 	PROPERTY_DATA_DESCRIPTOR data_descriptors[2]{};
 	data_descriptors[0].PropertyName = reinterpret_cast<ULONGLONG>(structure.get_name());
 	data_descriptors[0].ArrayIndex = struct_index;
 	data_descriptors[1].PropertyName = reinterpret_cast<ULONGLONG>(
-		get_property_name(structure.get_struct_start_index() + struct_member_index));
+		get_schema_property_name(*info, structure.get_struct_start_index() + struct_member_index));
 	data_descriptors[1].ArrayIndex = struct_element_index;
-	return get_array_property_value(structure.get_top_level_index(), struct_index,
+	return try_get_property_value(structure.get_top_level_index(), struct_index,
 		structure.get_struct_start_index() + struct_member_index, is_array,
 		is_struct_member_array, data_descriptors,
 		sizeof(data_descriptors) / sizeof(data_descriptors[0]));
 }
 
-event_property event_info::get_array_property_value(ULONG top_level_index,
+decode_result<event_property> event_info::try_get_property_value(ULONG top_level_index,
 	ULONG element_index, ULONG struct_member_index, bool is_array, bool is_struct_member_array,
 	PROPERTY_DATA_DESCRIPTOR* data_descriptors, ULONG descriptor_count) const
 {
-	check_if_has_properties();
-	auto array_size = get_array_property_size(top_level_index);
-	if (!is_array && array_size != 1)
-		throw event_trace_error("Expected single-value property, got array");
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
+	auto array_size = try_get_array_property_size(top_level_index);
+	if (!array_size)
+		return array_size.get_failure();
+
+	if (!is_array && *array_size != 1)
+		return decode_error::single_value_expected;
 
-	if (element_index >= array_size)
-		throw event_trace_error("Array index out of bounds");
+	if (element_index >= *array_size)
+		return decode_error::index_out_of_bounds;
 
-	bool is_struct = is_property_struct(top_level_index);
+	bool is_struct = is_schema_property_struct(*info, top_level_index);
 	if (is_struct && descriptor_count == 1)
-		throw event_trace_error("Expected single-value property, got struct");
+		return decode_error::plain_value_expected;
 	else if (!is_struct && descriptor_count == 2)
-		throw event_trace_error("Expected struct property, got single-value property");
+		return decode_error::struct_property_expected;
 
 	auto property_index = top_level_index;
 	if (descriptor_count == 2)
 	{
 		property_index = struct_member_index;
-		auto struct_member_array_size = get_array_property_size(property_index);
-		if (!is_struct_member_array && struct_member_array_size != 1)
-			throw event_trace_error("Expected single-value struct member, got array");
+		auto struct_member_array_size = try_get_array_property_size(property_index);
+		if (!struct_member_array_size)
+			return struct_member_array_size.get_failure();
+
+		if (!is_struct_member_array && *struct_member_array_size != 1)
+			return decode_error::single_value_member_expected;
 	}
 
 	ULONG property_size = 0;
 	auto status = ::TdhGetPropertySize(record_, 0, nullptr, descriptor_count, data_descriptors, &property_size);
 	if (ERROR_SUCCESS != status)
-		throw event_trace_error("Unable to get property size", status);
+		return decode_failure{ decode_error::property_size_failed, status };
 
 	event_property::raw_value_type raw_value;
 	raw_value.resize(property_size);
 	status = ::TdhGetProperty(record_, 0, nullptr, descriptor_count, data_descriptors, property_size, raw_value.data());
 	if (ERROR_SUCCESS != status)
-		throw event_trace_error("Failed to get property value", status);
+		return decode_failure{ decode_error::property_read_failed, status };
 
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	return event_property(info->EventPropertyInfoArray[property_index].nonStructType.InType,
-		info->EventPropertyInfoArray[property_index].nonStructType.OutType,
+	const auto& property_info = (*info)->EventPropertyInfoArray[property_index];
+	return event_property(property_info.nonStructType.InType,
+		property_info.nonStructType.OutType,
 		!(record_->EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER),
-		std::move(raw_value), get_property_name(property_index));
+		std::move(raw_value), get_schema_property_name(*info, property_index),
+		schema_->get_property_map(property_index));
 }
 
-event_property event_info::get_array_property_value(ULONG top_level_index,
+decode_result<event_property> event_info::try_get_property_value(ULONG top_level_index,
 	ULONG element_index, bool is_array) const
 {
+	if (schema_cache_)
+		return try_decode_property_value(top_level_index, element_index, 0u, 0u, is_array, false, false);
+
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
 	PROPERTY_DATA_DESCRIPTOR data_descriptor;
-	data_descriptor.PropertyName = reinterpret_cast<ULONGLONG>(get_property_name(top_level_index));
+	data_descriptor.PropertyName = reinterpret_cast<ULONGLONG>(get_schema_property_name(*info, top_level_index));
 	data_descriptor.ArrayIndex = element_index;
-	return get_array_property_value(top_level_index, element_index, 0u, is_array, false, &data_descriptor, 1);
+	return try_get_property_value(top_level_index, element_index, 0u, is_array, false, &data_descriptor, 1);
 }
 
-bool event_info::has_string_only() const noexcept
+decode_result<event_property> event_info::try_decode_property_value(ULONG top_level_index,
+	ULONG element_index, ULONG struct_member_index, ULONG struct_element_index, bool is_array,
+	bool is_struct_member, bool is_struct_member_array) const
 {
-	return (record_->EventHeader.Flags & EVENT_HEADER_FLAG_STRING_ONLY) == EVENT_HEADER_FLAG_STRING_ONLY;
+	auto info = try_get_property_schema();
+	if (!info)
+		return info.get_failure();
+
+	if (top_level_index >= (*info)->TopLevelPropertyCount)
+		return decode_error::index_out_of_bounds;
+
+	bool is_struct = is_schema_property_struct(*info, top_level_index);
+	if (is_struct && !is_struct_member)
+		return decode_error::plain_value_expected;
+	else if (!is_struct && is_struct_member)
+		return decode_error::struct_property_expected;
+
+	auto member_ordinal = property_value_visitor::no_member;
+	if (is_struct_member)
+	{
+		const auto& struct_info = (*info)->EventPropertyInfoArray[top_level_index].structType;
+		if (struct_member_index < struct_info.StructStartIndex
+			|| struct_member_index - struct_info.StructStartIndex >= struct_info.NumOfStructMembers)
+		{
+			return decode_error::index_out_of_bounds;
+		}
+
+		member_ordinal = struct_member_index - struct_info.StructStartIndex;
+	}
+
+	EVENT_TRACING_PROFILE_SCOPE("event_info::try_decode_property_value");
+	property_value_visitor visitor(top_level_index, element_index, member_ordinal, struct_element_index);
+	auto result = visit_event(*schema_, *record_, visitor, top_level_index + 1u);
+	if (!result)
+		return result.get_failure();
+
+	if (!is_array && visitor.get_size() != 1)
+		return decode_error::single_value_expected;
+
+	if (element_index >= visitor.get_size())
+		return decode_error::index_out_of_bounds;
+
+	if (is_struct_member)
+	{
+		if (!is_struct_member_array && visitor.get_member_size() != 1)
+			return decode_error::single_value_member_expected;
+
+		if (struct_element_index >= visitor.get_member_size())
+			return decode_error::index_out_of_bounds;
+	}
+
+	//Found in range, so the property is a nested struct
+	if (!visitor.has_value())
+		return decode_error::plain_value_expected;
+
+	return visitor.get_value();
 }
 
-void event_info::check_if_has_properties() const
+bool event_info::has_string_only() const noexcept
 {
-	if (has_string_only())
-		throw event_trace_error("Event has not properties, only unicode string. Use get_event_string() to get it");
+	return (record_->EventHeader.Flags & EVENT_HEADER_FLAG_STRING_ONLY) == EVENT_HEADER_FLAG_STRING_ONLY;
 }
 
 event_property event_info::get_event_string() const
@@ -241,105 +651,163 @@ event_property event_info::get_event_string() const
 
 const wchar_t* event_info::get_property_name(ULONG top_level_index) const
 {
-	check_if_has_properties();
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	return reinterpret_cast<const WCHAR*>(reinterpret_cast<const BYTE*>(info)
-		+ info->EventPropertyInfoArray[top_level_index].NameOffset);
+	return get_schema_property_name(try_get_property_schema().value(), top_level_index);
 }
 
-const wchar_t* event_info::get_event_message() const noexcept
+const wchar_t* event_info::get_event_message() const
 {
-	auto info = static_cast<const TRACE_EVENT_INFO*>(*this);
-	if (!info->EventMessageOffset)
-		return nullptr;
-
-	return reinterpret_cast<const WCHAR*>(reinterpret_cast<const BYTE*>(info)
-		+ info->EventMessageOffset);
+	return get_schema().get_event_message();
 }
 
-std::wostream& operator<<(std::wostream& stream, const event_info& info)
+namespace
 {
-	stream << "Event ID = " << info.get_event_id();
+//Keeps the layout of the original printer: arrays of one element are printed
+//as plain values, only top-level array elements are numbered
+class event_printer : public event_visitor
+{
+public:
+	explicit event_printer(std::wostream& stream)
+		: stream_(stream)
+	{
+	}
 
+	void begin_struct(const wchar_t* name) override
 	{
-		auto msg = info.get_event_message();
-		if (msg)
-			stream << L", Message = \"" << msg << L"\"";
+		auto parent = frames_.empty() ? nullptr : &frames_.back();
+		if (!parent || parent->type != frame_type::array || !parent->index)
+		{
+			write_header_indent();
+			if (name)
+				stream_ << L"Struct \"" << name << L"\"" << std::endl;
+			else
+				stream_ << L"Struct" << std::endl;
+		}
+
+		if (parent && parent->is_shown_array())
+		{
+			write_indent();
+			stream_ << L"[#" << parent->index << L"]" << std::endl;
+		}
+
+		write_indent();
+		stream_ << L"{" << std::endl;
+		frames_.push_back({ frame_type::structure, 0u, 0u });
 	}
 
-	stream << std::endl;
+	void end_struct() override
+	{
+		frames_.pop_back();
+		write_indent();
+		stream_ << L"}" << std::endl;
+		next_element();
+	}
+
+	void begin_array(const wchar_t* /*name*/, ULONG size) override
+	{
+		if (size > 1)
+		{
+			write_header_indent();
+			stream_ << L"Array[Size=" << size << L"]" << std::endl;
+		}
+
+		frames_.push_back({ frame_type::array, size, 0u });
+	}
+
+	void end_array() override
+	{
+		frames_.pop_back();
+	}
+
+	void value(const event_property_view& prop) override
+	{
+		write_indent();
+		if (frames_.size() == 1 && frames_.back().is_shown_array())
+			stream_ << L"[#" << frames_.back().index << L"] ";
+
+		stream_ << prop << std::endl;
+		next_element();
+	}
+
+private:
+	enum class frame_type
+	{
+		array,
+		structure
+	};
 
-	auto prop_count = info.get_top_level_property_count();
-	for (ULONG top_level_index = 0; top_level_index != prop_count; ++top_level_index)
+	struct frame
 	{
-		auto top_level_element_count = info.get_array_property_size(top_level_index);
-		bool is_array = top_level_element_count > 1;
-		if (is_array)
-			stream << L"Array[Size=" << top_level_element_count << L"]" << std::endl;
+		frame_type type;
+		ULONG size;
+		ULONG index;
 
-		if (info.is_property_struct(top_level_index))
+		bool is_shown_array() const noexcept
 		{
-			auto structure = info.get_structure(top_level_index);
-			auto struct_name = structure.get_name();
-			if(struct_name)
-				stream << L"Struct \"" << struct_name << L"\"" << std::endl;
-			else
-				stream << L"Struct" << std::endl;
-
-			for (ULONG element_index = 0; element_index != top_level_element_count; ++element_index)
-			{
-				if (is_array)
-				{
-					stream << L"  [#" << element_index << L"]" << std::endl;
-					stream << L"  {" << std::endl;
-				}
-				else
-				{
-					stream << L"{" << std::endl;
-				}
-
-				for (USHORT struct_member_index = 0;
-					struct_member_index != structure.get_member_count(); ++struct_member_index)
-				{
-					auto struct_member_array_size = info.get_array_property_size(structure, struct_member_index);
-					bool is_struct_member_array = struct_member_array_size > 1;
-					if (is_struct_member_array)
-					{
-						if (is_array)
-							stream << L"  ";
-
-						stream << L"Array[Size=" << struct_member_array_size << L"]" << std::endl;
-					}
-
-					for (ULONG struct_element_index = 0;
-						struct_element_index != struct_member_array_size; ++struct_element_index)
-					{
-						if (is_array)
-							stream << L"  ";
-						if (is_struct_member_array)
-							stream << L"  ";
-
-						stream << L"  " << info.get_array_property_value(structure,
-							element_index, struct_member_index, struct_element_index) << std::endl;
-					}
-				}
-
-				stream << (is_array ? L"  }" : L"}") << std::endl;
-			}
+			return type == frame_type::array && size > 1;
 		}
-		else
+	};
+
+	std::size_t get_indent() const noexcept
+	{
+		std::size_t indent = 0;
+		for (const auto& value : frames_)
 		{
-			for (ULONG element_index = 0; element_index != top_level_element_count; ++element_index)
-			{
-				if (is_array)
-					stream << L"  [#" << element_index << L"] ";
+			if (value.type == frame_type::structure || value.is_shown_array())
+				indent += 2;
+		}
+
+		return indent;
+	}
 
-				stream << info.get_array_property_value(top_level_index, element_index) << std::endl;
-			}
+	void write_indent()
+	{
+		stream_ << std::wstring(get_indent(), L' ');
+	}
+
+	//Array and struct headers go one level left of their elements
+	void write_header_indent()
+	{
+		auto indent = get_indent();
+		stream_ << std::wstring(indent > 2 ? indent - 2 : 0, L' ');
+	}
+
+	void next_element() noexcept
+	{
+		if (!frames_.empty() && frames_.back().type == frame_type::array)
+			++frames_.back().index;
+	}
+
+private:
+	std::wostream& stream_;
+	std::vector<frame> frames_;
+};
+} //namespace
+
+std::wostream& operator<<(std::wostream& stream, const event_info& info)
+{
+	std::wstring time;
+	append_iso8601(info.get_unix_timestamp(), 7, time);
+	stream << "Event ID = " << info.get_event_id() << L", Time = " << time;
+
+	if (!info.has_string_only())
+	{
+		auto msg = info.get_event_message();
+		if (msg)
+		{
+			//Raw template is printed if the properties cannot be decoded
+			std::wstring text;
+			event_message_renderer renderer;
+			if (!renderer.render(info, text))
+				text = msg;
+
+			stream << L", Message = \"" << text << L"\"";
 		}
 	}
 
+	stream << std::endl;
 
+	event_printer printer(stream);
+	visit_event(info, printer).value();
 	return stream;
 }
 } //namespace event_tracing
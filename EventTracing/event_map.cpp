@@ -0,0 +1,278 @@
+#include "event_tracing/event_map.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <functional>
+
+namespace event_tracing
+{
+namespace
+{
+//Dense tables are used while they are at most this many times larger than the entry list
+constexpr const std::uint32_t dense_table_ratio = 4;
+constexpr const std::uint32_t min_dense_table_size = 256;
+
+void append_number(std::uint32_t value, bool hex, std::wstring& result)
+{
+	wchar_t buffer[16];
+	std::swprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), hex ? L"0x%x" : L"%u", value);
+	result += buffer;
+}
+} //namespace
+
+decode_result<std::shared_ptr<const event_value_map>> event_value_map::load(PEVENT_RECORD record,
+	const wchar_t* map_name)
+{
+	std::vector<std::uint8_t> data(sizeof(EVENT_MAP_INFO));
+	auto buffer_size = static_cast<ULONG>(data.size());
+	auto status = ::TdhGetEventMapInformation(record, const_cast<PWSTR>(map_name),
+		reinterpret_cast<PEVENT_MAP_INFO>(data.data()), &buffer_size);
+	if (ERROR_INSUFFICIENT_BUFFER == status)
+	{
+		data.resize(buffer_size);
+		status = ::TdhGetEventMapInformation(record, const_cast<PWSTR>(map_name),
+			reinterpret_cast<PEVENT_MAP_INFO>(data.data()), &buffer_size);
+	}
+
+	if (status != ERROR_SUCCESS)
+		return decode_failure{ decode_error::map_not_found, status };
+
+	return compile(reinterpret_cast<const EVENT_MAP_INFO*>(data.data()), buffer_size);
+}
+
+decode_result<std::shared_ptr<const event_value_map>> event_value_map::compile(
+	const EVENT_MAP_INFO* info, std::size_t size)
+{
+	auto entries_offset = reinterpret_cast<const std::uint8_t*>(info->MapEntryArray)
+		- reinterpret_cast<const std::uint8_t*>(info);
+	if (size < static_cast<std::size_t>(entries_offset)
+		|| (size - entries_offset) / sizeof(EVENT_MAP_ENTRY) < info->EntryCount)
+	{
+		return decode_error::invalid_schema;
+	}
+
+	bool is_bitmap = false;
+	bool is_bit_positions = false;
+	if (info->Flag & (EVENTMAP_INFO_FLAG_MANIFEST_VALUEMAP | EVENTMAP_INFO_FLAG_MANIFEST_BITMAP))
+	{
+		if (info->MapEntryValueType != EVENTMAP_ENTRY_VALUETYPE_ULONG)
+			return decode_error::unsupported_type;
+
+		is_bitmap = (info->Flag & EVENTMAP_INFO_FLAG_MANIFEST_BITMAP) != 0;
+	}
+	else if (info->Flag & EVENTMAP_INFO_FLAG_WBEM_BITMAP)
+	{
+		//MOF bitmaps list bit positions
+		is_bitmap = true;
+		is_bit_positions = true;
+	}
+	else if (!(info->Flag & EVENTMAP_INFO_FLAG_WBEM_VALUEMAP))
+	{
+		return decode_error::unsupported_type;
+	}
+
+	auto base = reinterpret_cast<const std::uint8_t*>(info);
+	auto string_end = reinterpret_cast<const wchar_t*>(base + size / sizeof(wchar_t) * sizeof(wchar_t));
+	std::vector<entry> entries;
+	entries.reserve(info->EntryCount);
+	for (ULONG i = 0; i != info->EntryCount; ++i)
+	{
+		const auto& map_entry = info->MapEntryArray[i];
+		if (map_entry.OutputOffset >= size)
+			return decode_error::invalid_schema;
+
+		auto name = reinterpret_cast<const wchar_t*>(base + map_entry.OutputOffset);
+		auto name_end = std::find(name, string_end, L'\0');
+		if (name_end == string_end)
+			return decode_error::invalid_schema;
+
+		auto value = map_entry.Value;
+		if (is_bit_positions)
+		{
+			if (value >= 32)
+				continue;
+
+			value = 1u << value;
+		}
+
+		entries.emplace_back(value, std::wstring(name, name_end));
+	}
+
+	return std::shared_ptr<const event_value_map>(
+		std::make_shared<event_value_map>(std::move(entries), is_bitmap));
+}
+
+event_value_map::event_value_map(std::vector<entry> entries, bool is_bitmap)
+	: is_bitmap_(is_bitmap)
+{
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const entry& left, const entry& right) { return left.first < right.first; });
+	//First name wins for duplicate values
+	entries.erase(std::unique(entries.begin(), entries.end(),
+		[](const entry& left, const entry& right) { return left.first == right.first; }), entries.end());
+
+	for (const auto& value : entries)
+	{
+		name_offsets_.push_back(static_cast<std::uint32_t>(names_.size()));
+		//Manifest names often end with a space
+		auto name_end = value.second.find_last_not_of(L' ');
+		names_.append(value.second, 0, name_end == std::wstring::npos ? 0 : name_end + 1);
+		names_.push_back(L'\0');
+	}
+
+	if (entries.empty())
+		return;
+
+	if (is_bitmap_)
+	{
+		for (std::uint32_t i = 0; i != entries.size(); ++i)
+		{
+			auto mask = entries[i].first;
+			if (!mask)
+				zero_name_ = i + 1;
+			else if (!(mask & (mask - 1)))
+			{
+				auto bit = 0u;
+				while (!(mask & (1u << bit)))
+					++bit;
+
+				bits_[bit] = i + 1;
+			}
+			else
+				masks_.emplace_back(mask, i);
+		}
+
+		return;
+	}
+
+	auto range = static_cast<std::uint64_t>(entries.back().first) - entries.front().first + 1;
+	if (range <= std::max<std::uint64_t>(min_dense_table_size,
+		static_cast<std::uint64_t>(entries.size()) * dense_table_ratio))
+	{
+		dense_base_ = entries.front().first;
+		dense_.resize(static_cast<std::size_t>(range));
+		for (std::uint32_t i = 0; i != entries.size(); ++i)
+			dense_[entries[i].first - dense_base_] = i + 1;
+	}
+	else
+	{
+		sorted_.reserve(entries.size());
+		for (std::uint32_t i = 0; i != entries.size(); ++i)
+			sorted_.emplace_back(entries[i].first, i);
+	}
+}
+
+const wchar_t* event_value_map::find(std::uint32_t value) const noexcept
+{
+	if (!dense_.empty())
+	{
+		auto index = value - dense_base_;
+		if (value < dense_base_ || index >= dense_.size() || !dense_[index])
+			return nullptr;
+
+		return get_name(dense_[index] - 1);
+	}
+
+	auto it = std::lower_bound(sorted_.cbegin(), sorted_.cend(), value,
+		[](const std::pair<std::uint32_t, std::uint32_t>& item, std::uint32_t key) { return item.first < key; });
+	if (it == sorted_.cend() || it->first != value)
+		return nullptr;
+
+	return get_name(it->second);
+}
+
+void event_value_map::format(std::uint32_t value, std::wstring& result) const
+{
+	if (!is_bitmap_)
+	{
+		auto name = find(value);
+		if (name)
+			result += name;
+		else
+			append_number(value, false, result);
+
+		return;
+	}
+
+	if (!value)
+	{
+		if (zero_name_)
+			result += get_name(zero_name_ - 1);
+		else
+			result += L'0';
+
+		return;
+	}
+
+	auto start = result.size();
+	auto append_name = [&result, start](const wchar_t* name)
+	{
+		if (result.size() != start)
+			result += L'|';
+
+		result += name;
+	};
+
+	auto remaining = value;
+	for (const auto& mask : masks_)
+	{
+		if ((value & mask.first) == mask.first)
+		{
+			append_name(get_name(mask.second));
+			remaining &= ~mask.first;
+		}
+	}
+
+	for (auto bit = 0u; bit != 32 && remaining; ++bit)
+	{
+		auto mask = 1u << bit;
+		if ((remaining & mask) && bits_[bit])
+		{
+			append_name(get_name(bits_[bit] - 1));
+			remaining &= ~mask;
+		}
+	}
+
+	if (remaining)
+	{
+		if (result.size() != start)
+			result += L'|';
+
+		append_number(remaining, true, result);
+	}
+}
+
+bool event_map_cache::key::operator==(const key& other) const noexcept
+{
+	return !std::memcmp(&provider_id, &other.provider_id, sizeof(provider_id))
+		&& map_name == other.map_name;
+}
+
+std::size_t event_map_cache::key_hash::operator()(const key& value) const noexcept
+{
+	std::uint64_t parts[2];
+	std::memcpy(parts, &value.provider_id, sizeof(parts));
+	auto result = parts[0] ^ (parts[1] * 0x9e3779b97f4a7c15ull);
+	result ^= std::hash<std::wstring>()(value.map_name);
+	return static_cast<std::size_t>(result ^ (result >> 32));
+}
+
+decode_result<std::shared_ptr<const event_value_map>> event_map_cache::get(PEVENT_RECORD record,
+	const wchar_t* map_name)
+{
+	key map_key{ record->EventHeader.ProviderId, map_name };
+	auto it = maps_.find(map_key);
+	if (it == maps_.end())
+	{
+		auto map = event_value_map::load(record, map_name);
+		entry value{ map ? *map : nullptr, map.get_failure() };
+		it = maps_.emplace(std::move(map_key), std::move(value)).first;
+	}
+
+	if (!it->second.map)
+		return it->second.failure;
+
+	return it->second.map;
+}
+} //namespace event_tracing
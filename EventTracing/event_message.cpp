@@ -0,0 +1,207 @@
+#include "event_tracing/event_message.h"
+
+#include <algorithm>
+#include <cwchar>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_schema.h"
+#include "event_tracing/event_visitor.h"
+
+namespace event_tracing
+{
+const ULONG event_message_template::no_argument;
+
+event_message_template::event_message_template(const wchar_t* message)
+{
+	if (!message)
+		return;
+
+	auto literal_start = text_.size();
+	auto flush_literal = [this, &literal_start]()
+	{
+		if (text_.size() != literal_start)
+		{
+			tokens_.push_back({ static_cast<std::uint32_t>(literal_start),
+				static_cast<std::uint32_t>(text_.size() - literal_start), no_argument });
+			//Literals are null-terminated to be usable as C strings
+			text_.push_back(L'\0');
+		}
+
+		literal_start = text_.size();
+	};
+
+	for (auto current = message; *current; ++current)
+	{
+		if (*current != L'%')
+		{
+			text_.push_back(*current);
+			continue;
+		}
+
+		auto next = current[1];
+		if (next >= L'1' && next <= L'9')
+		{
+			ULONG argument = next - L'0';
+			++current;
+			if (current[1] >= L'0' && current[1] <= L'9')
+				argument = argument * 10 + (*++current - L'0');
+
+			//Format specifications are ignored, values are printed the usual way
+			if (current[1] == L'!')
+			{
+				auto end = std::wcschr(current + 2, L'!');
+				if (end)
+					current = end;
+			}
+
+			flush_literal();
+			tokens_.push_back({ 0u, 0u, argument - 1 });
+			argument_count_ = (std::max)(argument_count_, argument);
+			continue;
+		}
+
+		switch (next)
+		{
+		case L'0':
+			//Ends the message
+			flush_literal();
+			return;
+
+		case L'n':
+			text_ += L"\r\n";
+			break;
+
+		case L'r':
+			text_.push_back(L'\r');
+			break;
+
+		case L't':
+			text_.push_back(L'\t');
+			break;
+
+		case L'%':
+		case L' ':
+		case L'.':
+		case L'!':
+			text_.push_back(next);
+			break;
+
+		default:
+			text_.push_back(L'%');
+			continue;
+		}
+
+		++current;
+	}
+
+	flush_literal();
+}
+
+//Renders top-level property values of an event, array elements and struct
+//members are separated with commas
+class event_message_renderer::argument_collector : public event_visitor
+{
+public:
+	argument_collector(std::wstring& values,
+		std::vector<std::pair<std::uint32_t, std::uint32_t>>& ranges)
+		: values_(values)
+		, ranges_(ranges)
+	{
+	}
+
+	void begin_struct(const wchar_t*) override
+	{
+		if (!depth_++)
+			start_argument();
+	}
+
+	void end_struct() override
+	{
+		--depth_;
+	}
+
+	void begin_array(const wchar_t*, ULONG) override
+	{
+		if (!depth_++)
+			start_argument();
+	}
+
+	void end_array() override
+	{
+		--depth_;
+	}
+
+	void value(const event_property_view& prop) override
+	{
+		if (!depth_)
+			start_argument();
+
+		auto& range = ranges_.back();
+		if (values_.size() != range.first)
+			values_ += L", ";
+
+		if (!prop.get_map() || !append_names(prop))
+			prop.try_append_value(values_);
+
+		range.second = static_cast<std::uint32_t>(values_.size() - range.first);
+	}
+
+private:
+	void start_argument()
+	{
+		ranges_.emplace_back(static_cast<std::uint32_t>(values_.size()), 0u);
+	}
+
+	bool append_names(const event_property_view& prop)
+	{
+		auto names = event_property_converter<event_type_map_name>::try_convert(prop);
+		if (!names)
+			return false;
+
+		values_ += *names;
+		return true;
+	}
+
+private:
+	std::wstring& values_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>>& ranges_;
+	ULONG depth_ = 0;
+};
+
+decode_result<std::size_t> event_message_renderer::render(const event_info& info, std::wstring& result)
+{
+	auto schema = info.try_get_schema();
+	if (!schema)
+		return schema.get_failure();
+
+	return render(**schema, *static_cast<const EVENT_RECORD*>(info), result);
+}
+
+decode_result<std::size_t> event_message_renderer::render(const event_schema& schema,
+	const EVENT_RECORD& record, std::wstring& result)
+{
+	const auto& message = schema.get_message_template();
+	values_.clear();
+	ranges_.clear();
+	auto argument_count = (std::min)(message.get_argument_count(),
+		schema.get_top_level_property_count());
+	if (argument_count)
+	{
+		argument_collector collector(values_, ranges_);
+		auto walked = visit_event(schema, record, collector, argument_count);
+		if (!walked)
+			return walked.get_failure();
+	}
+
+	auto start = result.size();
+	for (const auto& token : message.get_tokens())
+	{
+		if (token.argument == event_message_template::no_argument)
+			result.append(message.get_literal(token), token.length);
+		else if (token.argument < ranges_.size())
+			result.append(values_, ranges_[token.argument].first, ranges_[token.argument].second);
+	}
+
+	return result.size() - start;
+}
+} //namespace event_tracing
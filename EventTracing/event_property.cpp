@@ -1,10 +1,8 @@
 #include "event_tracing/event_property.h"
 
 #include <codecvt>
-#include <ctime>
-#include <iomanip>
+#include <cstring>
 #include <locale>
-#include <sstream>
 #include <utility>
 
 #include <Windows.h>
@@ -12,17 +10,20 @@
 
 #include <boost/endian/conversion.hpp>
 
+#include "event_tracing/clock_domain.h"
+#include "event_tracing/event_map.h"
 #include "event_tracing/event_trace_error.h"
 
 namespace event_tracing
 {
 event_property::event_property(std::uint16_t in_type, std::uint16_t out_type, bool wide_pointer,
-	raw_value_type&& value, std::wstring&& name) noexcept
+	raw_value_type&& value, std::wstring&& name, const event_value_map* map) noexcept
 	: in_type_(in_type)
 	, out_type_(out_type)
 	, wide_pointer_(wide_pointer)
 	, value_(std::move(value))
 	, name_(std::move(name))
+	, map_(map)
 {
 }
 
@@ -125,26 +126,83 @@ const wchar_t* get_type_name(std::uint16_t type_id) noexcept
 
 	return nullptr;
 }
+
+//Integers are formatted without std::to_wstring, which goes through swprintf
+void append_decimal(std::uint64_t value, std::wstring& result)
+{
+	wchar_t buffer[20];
+	auto end = buffer + sizeof(buffer) / sizeof(buffer[0]);
+	auto current = end;
+	do
+	{
+		*--current = static_cast<wchar_t>(L'0' + value % 10);
+		value /= 10;
+	} while (value);
+
+	result.append(current, end);
+}
+
+void append_decimal(std::int64_t value, std::wstring& result)
+{
+	if (value < 0)
+	{
+		result.push_back(L'-');
+		append_decimal(0 - static_cast<std::uint64_t>(value), result);
+	}
+	else
+		append_decimal(static_cast<std::uint64_t>(value), result);
+}
 } //namespace
 
-std::wstring event_property::to_wstring() const
+decode_result<std::wstring> event_property_view::try_to_wstring() const
 {
 	auto type_name = get_type_name(in_type_);
 	std::wstring result;
 	if (type_name)
 		result += type_name;
-	result += name_ + L" = ";
+	if (name_)
+		result += name_;
+	result += L" = ";
+	auto value = try_append_value(result);
+	if (!value)
+		return value.get_failure();
+
+	if (map_)
+	{
+		auto names = event_property_converter<event_type_map_name>::try_convert(*this);
+		if (names)
+			result += L" (" + *names + L")";
+	}
+
+	return result;
+}
+
+decode_result<std::size_t> event_property_view::try_append_value(std::wstring& result) const
+{
+	auto start = result.size();
 	switch (in_type_)
 	{
 	case TDH_INTYPE_BOOLEAN:
-		result += (event_property_converter<bool>::convert(*this) ? L"true" : L"false");
+		{
+			auto value = event_property_converter<bool>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result += (*value ? L"true" : L"false");
+		}
 		break;
 
 	case TDH_INTYPE_UINT64:
 	case TDH_INTYPE_UINT32:
 	case TDH_INTYPE_UINT16:
 	case TDH_INTYPE_UINT8:
-		result += std::to_wstring(event_property_converter<std::uint64_t>::convert(*this));
+		{
+			auto value = event_property_converter<std::uint64_t>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			append_decimal(*value, result);
+		}
 		break;
 
 	case TDH_INTYPE_INT64:
@@ -153,22 +211,46 @@ std::wstring event_property::to_wstring() const
 	case TDH_INTYPE_HEXINT32:
 	case TDH_INTYPE_INT16:
 	case TDH_INTYPE_INT8:
-		result += std::to_wstring(event_property_converter<std::int64_t>::convert(*this));
+		{
+			auto value = event_property_converter<std::int64_t>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			append_decimal(*value, result);
+		}
 		break;
 
 	case TDH_INTYPE_DOUBLE:
-		result += std::to_wstring(event_property_converter<double>::convert(*this));
+		{
+			auto value = event_property_converter<double>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result += std::to_wstring(*value);
+		}
 		break;
 
 	case TDH_INTYPE_FLOAT:
-		result += std::to_wstring(event_property_converter<float>::convert(*this));
+		{
+			auto value = event_property_converter<float>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result += std::to_wstring(*value);
+		}
 		break;
 
 	case TDH_INTYPE_UNICODESTRING:
 	case TDH_INTYPE_COUNTEDSTRING:
 	case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
 	case TDH_INTYPE_NONNULLTERMINATEDSTRING:
-		result += event_property_converter<std::wstring>::convert(*this);
+		{
+			auto value = event_property_converter<std::wstring>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result += *value;
+		}
 		break;
 
 	case TDH_INTYPE_ANSISTRING:
@@ -176,45 +258,77 @@ std::wstring event_property::to_wstring() const
 	case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
 	case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
 		{
-			auto prop_string = event_property_converter<std::string>::convert(*this);
-			result += std::wstring(prop_string.cbegin(), prop_string.cend());
+			auto value = event_property_converter<std::string>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result += std::wstring(value->cbegin(), value->cend());
 		}
 		break;
 
 	case TDH_INTYPE_UNICODECHAR:
-		result.push_back(event_property_converter<wchar_t>::convert(*this));
+		{
+			auto value = event_property_converter<wchar_t>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result.push_back(*value);
+		}
 		break;
 
 	case TDH_INTYPE_ANSICHAR:
-		result.push_back(event_property_converter<char>::convert(*this));
+		{
+			auto value = event_property_converter<char>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result.push_back(*value);
+		}
 		break;
 
 	case TDH_INTYPE_NULL:
 		break;
 
 	case TDH_INTYPE_SIZET:
-		result += std::to_wstring(event_property_converter<event_type_size_t>::convert(*this));
+		{
+			auto value = event_property_converter<event_type_size_t>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			append_decimal(*value, result);
+		}
 		break;
 
 	case TDH_INTYPE_POINTER:
-		result += std::to_wstring(event_property_converter<event_type_pointer>::convert(*this));
+		{
+			auto value = event_property_converter<event_type_pointer>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			append_decimal(*value, result);
+		}
 		break;
 
 	case TDH_INTYPE_SYSTEMTIME:
 	case TDH_INTYPE_FILETIME:
 		{
-			auto value = std::chrono::system_clock::to_time_t(
-				event_property_converter<std::chrono::system_clock::time_point>::convert(*this));
-			std::tm tm_value;
-			gmtime_s(&tm_value, &value);
-			std::wstringstream ss;
-			ss << std::put_time(&tm_value, L"%F %T UTC");
-			result += ss.str();
+			auto value = event_property_converter<event_type_unix_nanoseconds>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			//SYSTEMTIME is precise to milliseconds, FILETIME to 100 nanoseconds
+			append_iso8601(*value, in_type_ == TDH_INTYPE_SYSTEMTIME ? 3u : 7u, result);
 		}
 		break;
 
 	case TDH_INTYPE_GUID:
-		result += event_property_converter<ms_guid>::convert(*this).to_wstring();
+		{
+			auto value = event_property_converter<ms_guid>::try_convert(*this);
+			if (!value)
+				return value.get_failure();
+
+			result += value->to_wstring();
+		}
 		break;
 
 	default:
@@ -222,7 +336,7 @@ std::wstring event_property::to_wstring() const
 		break;
 	}
 
-	return result;
+	return result.size() - start;
 }
 
 namespace
@@ -235,34 +349,37 @@ struct EventTypeInfo
 };
 
 template<typename ResultType>
-[[noreturn]] ResultType convert_property_data(const event_property&)
+decode_result<ResultType> convert_property_data(const event_property_view&) noexcept
 {
-	throw event_trace_error("Incorrect property type");
+	return decode_error::incorrect_property_type;
 }
 
 template<typename ResultType, typename EventType, typename... Args>
-ResultType convert_property_data(const event_property& prop)
+decode_result<ResultType> convert_property_data(const event_property_view& prop) noexcept
 {
 	if (prop.get_in_type() == EventType::tdh_type)
 	{
-		using SourceType = EventType::type;
-		if (prop.get_raw_value().size() != sizeof(SourceType))
-			throw event_trace_error("Invalid property value size");
-
-		return static_cast<ResultType>(*reinterpret_cast<const SourceType*>(prop.get_raw_value().data()));
+		using SourceType = typename EventType::type;
+		if (prop.get_size() != sizeof(SourceType))
+			return decode_error::invalid_value_size;
+
+		//Payload values are not aligned
+		SourceType value;
+		std::memcpy(&value, prop.get_data(), sizeof(value));
+		return static_cast<ResultType>(value);
 	}
 
 	return convert_property_data<ResultType, Args...>(prop);
 }
 } //namespace
 
-bool event_property_converter<bool>::convert(const event_property& prop)
+decode_result<bool> event_property_converter<bool>::try_convert(const event_property_view& prop)
 {
-	return !!convert_property_data<std::uint32_t,
+	return convert_property_data<bool,
 		EventTypeInfo<std::uint32_t, TDH_INTYPE_BOOLEAN>>(prop);
 }
 
-std::uint64_t event_property_converter<std::uint64_t>::convert(const event_property& prop)
+decode_result<std::uint64_t> event_property_converter<std::uint64_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::uint64_t,
 		EventTypeInfo<std::uint64_t, TDH_INTYPE_UINT64>,
@@ -271,7 +388,7 @@ std::uint64_t event_property_converter<std::uint64_t>::convert(const event_prope
 		EventTypeInfo<std::uint8_t, TDH_INTYPE_UINT8>>(prop);
 }
 
-std::uint32_t event_property_converter<std::uint32_t>::convert(const event_property& prop)
+decode_result<std::uint32_t> event_property_converter<std::uint32_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::uint32_t,
 		EventTypeInfo<std::uint32_t, TDH_INTYPE_UINT32>,
@@ -279,20 +396,20 @@ std::uint32_t event_property_converter<std::uint32_t>::convert(const event_prope
 		EventTypeInfo<std::uint8_t, TDH_INTYPE_UINT8>>(prop);
 }
 
-std::uint16_t event_property_converter<std::uint16_t>::convert(const event_property& prop)
+decode_result<std::uint16_t> event_property_converter<std::uint16_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::uint16_t,
 		EventTypeInfo<std::uint16_t, TDH_INTYPE_UINT16>,
 		EventTypeInfo<std::uint8_t, TDH_INTYPE_UINT8>>(prop);
 }
 
-std::uint8_t event_property_converter<std::uint8_t>::convert(const event_property& prop)
+decode_result<std::uint8_t> event_property_converter<std::uint8_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::uint8_t,
 		EventTypeInfo<std::uint8_t, TDH_INTYPE_UINT8>>(prop);
 }
 
-std::int64_t event_property_converter<std::int64_t>::convert(const event_property& prop)
+decode_result<std::int64_t> event_property_converter<std::int64_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::int64_t,
 		EventTypeInfo<std::int64_t, TDH_INTYPE_INT64>,
@@ -303,7 +420,7 @@ std::int64_t event_property_converter<std::int64_t>::convert(const event_propert
 		EventTypeInfo<std::int8_t, TDH_INTYPE_INT8>>(prop);
 }
 
-std::int32_t event_property_converter<std::int32_t>::convert(const event_property& prop)
+decode_result<std::int32_t> event_property_converter<std::int32_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::int32_t,
 		EventTypeInfo<std::int32_t, TDH_INTYPE_INT32>,
@@ -312,39 +429,39 @@ std::int32_t event_property_converter<std::int32_t>::convert(const event_propert
 		EventTypeInfo<std::int8_t, TDH_INTYPE_INT8>>(prop);
 }
 
-std::int16_t event_property_converter<std::int16_t>::convert(const event_property& prop)
+decode_result<std::int16_t> event_property_converter<std::int16_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::int16_t,
 		EventTypeInfo<std::int16_t, TDH_INTYPE_INT16>,
 		EventTypeInfo<std::int8_t, TDH_INTYPE_INT8>>(prop);
 }
 
-std::int8_t event_property_converter<std::int8_t>::convert(const event_property& prop)
+decode_result<std::int8_t> event_property_converter<std::int8_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<std::int8_t,
 		EventTypeInfo<std::int8_t, TDH_INTYPE_INT8>>(prop);
 }
 
-float event_property_converter<float>::convert(const event_property& prop)
+decode_result<float> event_property_converter<float>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<float,
 		EventTypeInfo<FLOAT, TDH_INTYPE_FLOAT>>(prop);
 }
 
-double event_property_converter<double>::convert(const event_property& prop)
+decode_result<double> event_property_converter<double>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<double,
 		EventTypeInfo<DOUBLE, TDH_INTYPE_DOUBLE>,
 		EventTypeInfo<FLOAT, TDH_INTYPE_FLOAT>>(prop);
 }
 
-wchar_t event_property_converter<wchar_t>::convert(const event_property& prop)
+decode_result<wchar_t> event_property_converter<wchar_t>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<wchar_t,
 		EventTypeInfo<WCHAR, TDH_INTYPE_UNICODECHAR>>(prop);
 }
 
-char event_property_converter<char>::convert(const event_property& prop)
+decode_result<char> event_property_converter<char>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<char,
 		EventTypeInfo<CHAR, TDH_INTYPE_ANSICHAR>>(prop);
@@ -352,81 +469,96 @@ char event_property_converter<char>::convert(const event_property& prop)
 
 namespace
 {
+//View data points into the event payload and may be unaligned
+template<typename StringType>
+StringType make_string(const std::uint8_t* data, std::size_t length)
+{
+	StringType result(length, typename StringType::value_type());
+	if (length)
+		std::memcpy(&result[0], data, length * sizeof(typename StringType::value_type));
+
+	return result;
+}
+
 template<typename StringType, std::uint16_t UnicodeString,
 	std::uint16_t CountedString, std::uint16_t ReversedCountedString,
 	std::uint16_t NonNullTerminatedString>
-StringType convert_to_string(const event_property& prop)
+decode_result<StringType> convert_to_string(const event_property_view& prop)
 {
-	auto string_start = reinterpret_cast<typename StringType::const_pointer>(prop.get_raw_value().data());
+	using char_type = typename StringType::value_type;
+	auto data = prop.get_data();
 	switch (prop.get_in_type())
 	{
 	case UnicodeString:
 		{
-			if (prop.get_raw_value().empty())
-				return StringType();
-
-			if (prop.get_raw_value().size() % sizeof(typename StringType::value_type))
-				throw event_trace_error("Invalid property value size");
-
-			auto end = string_start + prop.get_raw_value().size() / sizeof(typename StringType::value_type);
-			if (std::find(string_start, end, static_cast<typename StringType::value_type>(0)) == end)
-				return StringType(string_start, end);
-
-			return StringType(string_start);
+			if (prop.get_size() % sizeof(char_type))
+				return decode_error::invalid_value_size;
+
+			std::size_t length = 0;
+			for (auto count = prop.get_size() / sizeof(char_type); length != count; ++length)
+			{
+				char_type value;
+				std::memcpy(&value, data + length * sizeof(char_type), sizeof(value));
+				if (!value)
+					break;
+			}
+
+			return make_string<StringType>(data, length);
 		}
 		break;
 
 	case CountedString:
 	case ReversedCountedString:
 		{
-			if (!prop.get_raw_value().size())
-				throw event_trace_error("Invalid property value size");
+			if (!prop.get_size())
+				return decode_error::invalid_value_size;
 
-			if ((prop.get_raw_value().size() - 1) % sizeof(typename StringType::value_type))
-				throw event_trace_error("Invalid property value size");
+			if ((prop.get_size() - 1) % sizeof(char_type))
+				return decode_error::invalid_value_size;
 
-			auto size = static_cast<std::uint16_t>(*string_start);
+			char_type first;
+			std::memcpy(&first, data, sizeof(first));
+			auto size = static_cast<std::uint16_t>(first);
 			if (prop.get_in_type() == ReversedCountedString)
 				boost::endian::big_to_native_inplace(size);
 
-			if (size * sizeof(typename StringType::value_type) >= prop.get_raw_value().size())
-				throw event_trace_error("Invalid property value size");
+			if (size * sizeof(char_type) >= prop.get_size())
+				return decode_error::invalid_value_size;
 
-			return StringType(string_start + 1, size);
+			return make_string<StringType>(data + sizeof(char_type), size);
 		}
 		break;
 
 	case NonNullTerminatedString:
-		if (prop.get_raw_value().size() % sizeof(typename StringType::value_type))
-			throw event_trace_error("Invalid property value size");
+		if (prop.get_size() % sizeof(char_type))
+			return decode_error::invalid_value_size;
 
-		return StringType(string_start, prop.get_raw_value().size()
-			/ sizeof(typename StringType::value_type));
+		return make_string<StringType>(data, prop.get_size() / sizeof(char_type));
 		break;
 
 	default:
 		break;
 	}
 
-	throw event_trace_error("Incorrect property type");
+	return decode_error::incorrect_property_type;
 }
 } //namespace
 
-std::wstring event_property_converter<std::wstring>::convert(const event_property& prop)
+decode_result<std::wstring> event_property_converter<std::wstring>::try_convert(const event_property_view& prop)
 {
 	return convert_to_string<std::wstring, TDH_INTYPE_UNICODESTRING,
 		TDH_INTYPE_COUNTEDSTRING, TDH_INTYPE_REVERSEDCOUNTEDSTRING,
 		TDH_INTYPE_NONNULLTERMINATEDSTRING>(prop);
 }
 
-std::string event_property_converter<std::string>::convert(const event_property& prop)
+decode_result<std::string> event_property_converter<std::string>::try_convert(const event_property_view& prop)
 {
 	return convert_to_string<std::string, TDH_INTYPE_ANSISTRING,
 		TDH_INTYPE_COUNTEDANSISTRING, TDH_INTYPE_REVERSEDCOUNTEDANSISTRING,
 		TDH_INTYPE_NONNULLTERMINATEDANSISTRING>(prop);
 }
 
-std::uint64_t event_property_converter<event_type_size_t>::convert(const event_property& prop)
+decode_result<std::uint64_t> event_property_converter<event_type_size_t>::try_convert(const event_property_view& prop)
 {
 	if (prop.is_wide_pointer())
 	{
@@ -434,11 +566,11 @@ std::uint64_t event_property_converter<event_type_size_t>::convert(const event_p
 			EventTypeInfo<std::uint64_t, TDH_INTYPE_SIZET>>(prop);
 	}
 
-	return convert_property_data<std::uint32_t,
+	return convert_property_data<std::uint64_t,
 		EventTypeInfo<std::uint32_t, TDH_INTYPE_SIZET>>(prop);
 }
 
-std::uint64_t event_property_converter<event_type_pointer>::convert(const event_property& prop)
+decode_result<std::uint64_t> event_property_converter<event_type_pointer>::try_convert(const event_property_view& prop)
 {
 	if (prop.is_wide_pointer())
 	{
@@ -446,47 +578,79 @@ std::uint64_t event_property_converter<event_type_pointer>::convert(const event_
 			EventTypeInfo<std::uint64_t, TDH_INTYPE_POINTER>>(prop);
 	}
 
-	return convert_property_data<std::uint32_t,
+	return convert_property_data<std::uint64_t,
 		EventTypeInfo<std::uint32_t, TDH_INTYPE_POINTER>>(prop);
 }
 
-std::chrono::system_clock::time_point event_property_converter<
-	std::chrono::system_clock::time_point>::convert(const event_property& prop)
+decode_result<std::wstring> event_property_converter<event_type_map_name>::try_convert(
+	const event_property_view& prop)
+{
+	if (!prop.get_map())
+		return decode_error::map_not_found;
+
+	auto value = convert_property_data<std::uint32_t,
+		EventTypeInfo<std::uint32_t, TDH_INTYPE_UINT32>,
+		EventTypeInfo<std::uint32_t, TDH_INTYPE_HEXINT32>,
+		EventTypeInfo<std::uint16_t, TDH_INTYPE_UINT16>,
+		EventTypeInfo<std::uint8_t, TDH_INTYPE_UINT8>>(prop);
+	if (!value)
+		return value.get_failure();
+
+	return prop.get_map()->format(*value);
+}
+
+decode_result<std::int64_t> event_property_converter<
+	event_type_unix_nanoseconds>::try_convert(const event_property_view& prop)
 {
-	SYSTEMTIME value;
+	boost::optional<std::int64_t> value;
 	switch (prop.get_in_type())
 	{
 	case TDH_INTYPE_SYSTEMTIME:
-		if(prop.get_raw_value().size() != sizeof(SYSTEMTIME))
-			throw event_trace_error("Invalid property value size");
+		{
+			if (prop.get_size() != sizeof(SYSTEMTIME))
+				return decode_error::invalid_value_size;
 
-		value = *reinterpret_cast<const SYSTEMTIME*>(prop.get_raw_value().data());
+			SYSTEMTIME system_time;
+			std::memcpy(&system_time, prop.get_data(), sizeof(system_time));
+			value = systemtime_to_unix_nanoseconds(system_time);
+		}
 		break;
 
 	case TDH_INTYPE_FILETIME:
-		if (prop.get_raw_value().size() != sizeof(FILETIME))
-			throw event_trace_error("Invalid property value size");
+		{
+			if (prop.get_size() != sizeof(FILETIME))
+				return decode_error::invalid_value_size;
 
-		if(!::FileTimeToSystemTime(reinterpret_cast<const FILETIME*>(prop.get_raw_value().data()), &value))
-			throw event_trace_error("Invalid filetime property value", ::GetLastError());
+			FILETIME file_time;
+			std::memcpy(&file_time, prop.get_data(), sizeof(file_time));
+			value = filetime_to_unix_nanoseconds(
+				(static_cast<std::uint64_t>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime);
+		}
 		break;
 
 	default:
-		throw event_trace_error("Incorrect property type");
+		return decode_error::incorrect_property_type;
 		break;
 	}
 
-	std::tm tm_value{};
-	tm_value.tm_hour = value.wHour;
-	tm_value.tm_mday = value.wDay;
-	tm_value.tm_min = value.wMinute;
-	tm_value.tm_mon = value.wMonth - 1;
-	tm_value.tm_sec = value.wSecond;
-	tm_value.tm_year = value.wYear - 1900;
-	return std::chrono::system_clock::from_time_t(_mkgmtime64(&tm_value));
+	if (!value)
+		return decode_error::invalid_filetime;
+
+	return *value;
+}
+
+decode_result<std::chrono::system_clock::time_point> event_property_converter<
+	std::chrono::system_clock::time_point>::try_convert(const event_property_view& prop)
+{
+	auto value = event_property_converter<event_type_unix_nanoseconds>::try_convert(prop);
+	if (!value)
+		return value.get_failure();
+
+	return std::chrono::system_clock::time_point(std::chrono::duration_cast<
+		std::chrono::system_clock::duration>(std::chrono::nanoseconds(*value)));
 }
 
-ms_guid event_property_converter<ms_guid>::convert(const event_property& prop)
+decode_result<ms_guid> event_property_converter<ms_guid>::try_convert(const event_property_view& prop)
 {
 	return convert_property_data<ms_guid,
 		EventTypeInfo<GUID, TDH_INTYPE_GUID>>(prop);
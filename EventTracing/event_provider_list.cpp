@@ -7,6 +7,7 @@
 #include <Windows.h>
 #include <tdh.h>
 
+#include "event_tracing/event_source_guid.h"
 #include "event_tracing/event_trace_error.h"
 
 namespace event_tracing
@@ -47,6 +48,11 @@ const ms_guid& event_provider_list::get_guid(const std::wstring& name) const
 	return (*it).second;
 }
 
+ms_guid event_provider_list::get_event_source_guid(const std::wstring& name)
+{
+	return event_tracing::get_event_source_guid(name);
+}
+
 const std::wstring& event_provider_list::get_name(const ms_guid& guid) const
 {
 	auto it = guid_to_name_.find(guid);
@@ -0,0 +1,159 @@
+#include "event_tracing/event_record_copy.h"
+
+#include <cstring>
+
+namespace event_tracing
+{
+namespace
+{
+constexpr std::size_t align_size(std::size_t size) noexcept
+{
+	return (size + 7u) & ~static_cast<std::size_t>(7u);
+}
+
+//Fixed part of a serialized record, followed by the data laid out as in a copy
+struct serialized_record
+{
+	EVENT_HEADER event_header;
+	ETW_BUFFER_CONTEXT buffer_context;
+	USHORT extended_data_count;
+	USHORT user_data_length;
+};
+
+std::size_t get_data_size(const EVENT_RECORD& record) noexcept
+{
+	auto size = align_size(record.ExtendedDataCount * sizeof(EVENT_HEADER_EXTENDED_DATA_ITEM));
+	for (USHORT i = 0; i != record.ExtendedDataCount; ++i)
+		size += align_size(record.ExtendedData[i].DataSize);
+
+	return size + record.UserDataLength;
+}
+
+//Extended data items without data pointers are followed by their data, then by the user data
+void copy_data(const EVENT_RECORD& record, std::uint8_t* data) noexcept
+{
+	auto extended_data = reinterpret_cast<PEVENT_HEADER_EXTENDED_DATA_ITEM>(data);
+	std::size_t offset = align_size(record.ExtendedDataCount * sizeof(EVENT_HEADER_EXTENDED_DATA_ITEM));
+	for (USHORT i = 0; i != record.ExtendedDataCount; ++i)
+	{
+		extended_data[i] = record.ExtendedData[i];
+		extended_data[i].DataPtr = 0;
+		std::memcpy(data + offset, reinterpret_cast<const void*>(
+			static_cast<ULONG_PTR>(record.ExtendedData[i].DataPtr)), record.ExtendedData[i].DataSize);
+		offset += align_size(record.ExtendedData[i].DataSize);
+	}
+
+	if (record.UserDataLength)
+		std::memcpy(data + offset, record.UserData, record.UserDataLength);
+}
+} //namespace
+
+event_record_copy::event_record_copy() noexcept
+	: record_{}
+{
+}
+
+event_record_copy::event_record_copy(const EVENT_RECORD& record)
+	: record_{}
+{
+	assign(record);
+}
+
+event_record_copy::event_record_copy(const event_record_copy& other)
+	: record_{}
+{
+	assign(other.record_);
+}
+
+event_record_copy& event_record_copy::operator=(const event_record_copy& other)
+{
+	if (this != &other)
+		assign(other.record_);
+
+	return *this;
+}
+
+void event_record_copy::assign(const EVENT_RECORD& record)
+{
+	data_.resize(get_data_size(record));
+	copy_data(record, data_.data());
+	record_ = record;
+	update_pointers();
+}
+
+std::size_t event_record_copy::get_serialized_size(const EVENT_RECORD& record) noexcept
+{
+	return align_size(sizeof(serialized_record)) + get_data_size(record);
+}
+
+void event_record_copy::serialize(const EVENT_RECORD& record, std::uint8_t* data) noexcept
+{
+	serialized_record fixed_part;
+	fixed_part.event_header = record.EventHeader;
+	fixed_part.buffer_context = record.BufferContext;
+	fixed_part.extended_data_count = record.ExtendedDataCount;
+	fixed_part.user_data_length = record.UserDataLength;
+	std::memcpy(data, &fixed_part, sizeof(fixed_part));
+	copy_data(record, data + align_size(sizeof(serialized_record)));
+}
+
+bool event_record_copy::is_serialized(const std::uint8_t* data, std::size_t size) noexcept
+{
+	auto data_offset = align_size(sizeof(serialized_record));
+	if (size < data_offset)
+		return false;
+
+	serialized_record fixed_part;
+	std::memcpy(&fixed_part, data, sizeof(fixed_part));
+	auto data_size = align_size(fixed_part.extended_data_count * sizeof(EVENT_HEADER_EXTENDED_DATA_ITEM));
+	if (size - data_offset < data_size)
+		return false;
+
+	for (USHORT i = 0; i != fixed_part.extended_data_count; ++i)
+	{
+		EVENT_HEADER_EXTENDED_DATA_ITEM item;
+		std::memcpy(&item, data + data_offset + i * sizeof(item), sizeof(item));
+		data_size += align_size(item.DataSize);
+	}
+
+	return size - data_offset == data_size + fixed_part.user_data_length;
+}
+
+bool event_record_copy::assign_serialized(const std::uint8_t* data, std::size_t size)
+{
+	if (!is_serialized(data, size))
+		return false;
+
+	auto data_offset = align_size(sizeof(serialized_record));
+	serialized_record fixed_part;
+	std::memcpy(&fixed_part, data, sizeof(fixed_part));
+	data_.assign(data + data_offset, data + size);
+	record_ = EVENT_RECORD{};
+	record_.EventHeader = fixed_part.event_header;
+	record_.BufferContext = fixed_part.buffer_context;
+	record_.ExtendedDataCount = fixed_part.extended_data_count;
+	record_.UserDataLength = fixed_part.user_data_length;
+	update_pointers();
+	return true;
+}
+
+void event_record_copy::update_pointers() noexcept
+{
+	record_.ExtendedData = nullptr;
+	record_.UserData = nullptr;
+
+	std::size_t offset = align_size(record_.ExtendedDataCount * sizeof(EVENT_HEADER_EXTENDED_DATA_ITEM));
+	if (record_.ExtendedDataCount)
+	{
+		record_.ExtendedData = reinterpret_cast<PEVENT_HEADER_EXTENDED_DATA_ITEM>(data_.data());
+		for (USHORT i = 0; i != record_.ExtendedDataCount; ++i)
+		{
+			record_.ExtendedData[i].DataPtr = reinterpret_cast<ULONGLONG>(data_.data() + offset);
+			offset += align_size(record_.ExtendedData[i].DataSize);
+		}
+	}
+
+	if (record_.UserDataLength)
+		record_.UserData = data_.data() + offset;
+}
+} //namespace event_tracing
@@ -0,0 +1,282 @@
+#include "event_tracing/event_schema.h"
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#include "event_tracing/event_extended_data.h"
+#include "event_tracing/schema_pack.h"
+#include "event_tracing/tracelogging_schema.h"
+
+namespace event_tracing
+{
+namespace
+{
+//FNV-1a
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ull) noexcept
+{
+	auto bytes = static_cast<const std::uint8_t*>(data);
+	for (std::size_t i = 0; i != size; ++i)
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+	return hash;
+}
+} //namespace
+
+std::size_t get_fixed_type_size(USHORT in_type) noexcept
+{
+	switch (in_type)
+	{
+	case TDH_INTYPE_INT8:
+	case TDH_INTYPE_UINT8:
+	case TDH_INTYPE_ANSICHAR:
+		return 1;
+
+	case TDH_INTYPE_INT16:
+	case TDH_INTYPE_UINT16:
+	case TDH_INTYPE_UNICODECHAR:
+		return 2;
+
+	case TDH_INTYPE_INT32:
+	case TDH_INTYPE_UINT32:
+	case TDH_INTYPE_HEXINT32:
+	case TDH_INTYPE_BOOLEAN:
+	case TDH_INTYPE_FLOAT:
+		return 4;
+
+	case TDH_INTYPE_INT64:
+	case TDH_INTYPE_UINT64:
+	case TDH_INTYPE_HEXINT64:
+	case TDH_INTYPE_DOUBLE:
+	case TDH_INTYPE_FILETIME:
+		return 8;
+
+	case TDH_INTYPE_GUID:
+	case TDH_INTYPE_SYSTEMTIME:
+		return 16;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+decode_result<std::shared_ptr<const event_schema>> event_schema::load(PEVENT_RECORD record,
+	event_map_cache* maps)
+{
+	//TraceLogging metadata is parsed natively, which is much cheaper than TDH
+	if (event_extended_data(*record).find(EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL))
+		return parse_tracelogging_schema(*record);
+
+	std::vector<std::uint8_t> data(sizeof(TRACE_EVENT_INFO));
+	auto buffer_size = static_cast<DWORD>(data.size());
+	auto status = ::TdhGetEventInformation(record, 0, nullptr,
+		reinterpret_cast<PTRACE_EVENT_INFO>(data.data()), &buffer_size);
+	if (ERROR_INSUFFICIENT_BUFFER == status)
+	{
+		data.resize(buffer_size);
+		status = ::TdhGetEventInformation(record, 0, nullptr,
+			reinterpret_cast<PTRACE_EVENT_INFO>(data.data()), &buffer_size);
+	}
+
+	if (status != ERROR_SUCCESS)
+		return decode_failure{ decode_error::schema_not_found, status };
+
+	data.resize(buffer_size);
+	auto schema = std::make_shared<event_schema>(std::move(data));
+	if (maps)
+		schema->resolve_maps(record, *maps);
+
+	return std::shared_ptr<const event_schema>(std::move(schema));
+}
+
+event_schema::event_schema(std::vector<std::uint8_t>&& data)
+	: data_(std::move(data))
+	, message_(get_event_message())
+{
+	auto info = get_info();
+	properties_.reserve(info->PropertyCount);
+	for (ULONG i = 0; i != info->PropertyCount; ++i)
+	{
+		const auto& property_info = info->EventPropertyInfoArray[i];
+		event_schema_property prop{};
+		prop.name = get_string(property_info.NameOffset);
+		prop.flags = property_info.Flags;
+		if (prop.is_struct())
+		{
+			prop.struct_start_index = property_info.structType.StructStartIndex;
+			prop.struct_member_count = property_info.structType.NumOfStructMembers;
+		}
+		else
+		{
+			prop.map_name = get_string(property_info.nonStructType.MapNameOffset);
+			prop.in_type = property_info.nonStructType.InType;
+			prop.out_type = property_info.nonStructType.OutType;
+		}
+
+		prop.count = property_info.count;
+		prop.length = property_info.length;
+		properties_.push_back(prop);
+	}
+}
+
+event_schema::event_schema(std::vector<std::uint8_t>&& data,
+	std::vector<std::shared_ptr<const event_value_map>>&& maps)
+	: event_schema(std::move(data))
+{
+	if (maps.size() == properties_.size())
+		maps_ = std::move(maps);
+}
+
+bool event_schema::is_valid(const std::vector<std::uint8_t>& data) noexcept
+{
+	auto properties_offset = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray);
+	if (data.size() < properties_offset + sizeof(wchar_t)
+		|| data[data.size() - 1u] || data[data.size() - 2u])
+	{
+		return false;
+	}
+
+	auto info = reinterpret_cast<const TRACE_EVENT_INFO*>(data.data());
+	if ((data.size() - properties_offset) / sizeof(EVENT_PROPERTY_INFO) < info->PropertyCount
+		|| info->TopLevelPropertyCount > info->PropertyCount
+		|| info->EventMessageOffset >= data.size())
+	{
+		return false;
+	}
+
+	for (ULONG i = 0; i != info->PropertyCount; ++i)
+	{
+		const auto& property_info = info->EventPropertyInfoArray[i];
+		if (property_info.NameOffset >= data.size())
+			return false;
+
+		if ((property_info.Flags & PropertyStruct) == PropertyStruct)
+		{
+			if (static_cast<ULONG>(property_info.structType.StructStartIndex)
+				+ property_info.structType.NumOfStructMembers > info->PropertyCount)
+			{
+				return false;
+			}
+		}
+		else if (property_info.nonStructType.MapNameOffset >= data.size())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void event_schema::resolve_maps(PEVENT_RECORD record, event_map_cache& maps)
+{
+	for (std::size_t i = 0; i != properties_.size(); ++i)
+	{
+		auto map_name = properties_[i].map_name;
+		if (!map_name || !*map_name)
+			continue;
+
+		//Properties whose map cannot be loaded are printed as plain numbers
+		auto map = maps.get(record, map_name);
+		if (!map)
+			continue;
+
+		if (maps_.empty())
+			maps_.resize(properties_.size());
+
+		maps_[i] = std::move(*map);
+	}
+}
+
+bool event_schema_cache::key::operator==(const key& other) const noexcept
+{
+	return id == other.id && version == other.version && opcode == other.opcode
+		&& !std::memcmp(&provider_id, &other.provider_id, sizeof(provider_id));
+}
+
+std::size_t event_schema_cache::key_hash::operator()(const key& value) const noexcept
+{
+	std::uint64_t parts[2];
+	std::memcpy(parts, &value.provider_id, sizeof(parts));
+	auto result = parts[0] ^ (parts[1] * 0x9e3779b97f4a7c15ull);
+	result ^= (static_cast<std::uint64_t>(value.id) << 16)
+		| (static_cast<std::uint64_t>(value.version) << 8) | value.opcode;
+	return static_cast<std::size_t>(result ^ (result >> 32));
+}
+
+decode_result<std::shared_ptr<const event_schema>> event_schema_cache::get(PEVENT_RECORD record)
+{
+	if (!is_cacheable(*record))
+	{
+		auto metadata = event_extended_data(*record).find(EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL);
+		if (metadata)
+			return get_tracelogging(*record, *metadata);
+
+		return event_schema::load(record, &maps_);
+	}
+
+	const auto& descriptor = record->EventHeader.EventDescriptor;
+	key schema_key{ record->EventHeader.ProviderId, descriptor.Id,
+		descriptor.Version, descriptor.Opcode };
+	auto it = schemas_.find(schema_key);
+	if (it == schemas_.end())
+	{
+		decode_result<std::shared_ptr<const event_schema>> schema = decode_error::schema_not_found;
+		if (pack_)
+			schema = pack_->get_schema(record->EventHeader.ProviderId, descriptor);
+		if (!schema)
+			schema = event_schema::load(record, &maps_);
+		entry value{ schema ? *schema : nullptr, schema.get_failure() };
+		it = schemas_.emplace(schema_key, std::move(value)).first;
+	}
+
+	if (!it->second.schema)
+		return it->second.failure;
+
+	return it->second.schema;
+}
+
+decode_result<std::shared_ptr<const event_schema>> event_schema_cache::get_tracelogging(
+	const EVENT_RECORD& record, const EVENT_HEADER_EXTENDED_DATA_ITEM& metadata)
+{
+	auto data = reinterpret_cast<const std::uint8_t*>(metadata.DataPtr);
+	auto hash = hash_bytes(data, metadata.DataSize,
+		hash_bytes(&record.EventHeader.ProviderId, sizeof(GUID)));
+	auto range = tracelogging_schemas_.equal_range(hash);
+	auto it = range.first;
+	while (it != range.second && (it->second.metadata.size() != metadata.DataSize
+		|| std::memcmp(&it->second.provider_id, &record.EventHeader.ProviderId, sizeof(GUID))
+		|| std::memcmp(it->second.metadata.data(), data, metadata.DataSize)))
+	{
+		++it;
+	}
+
+	if (it == range.second)
+	{
+		auto schema = parse_tracelogging_schema(record);
+		tracelogging_entry value{ record.EventHeader.ProviderId,
+			std::vector<std::uint8_t>(data, data + metadata.DataSize),
+			schema ? *schema : nullptr, schema.get_failure() };
+		it = tracelogging_schemas_.emplace(hash, std::move(value));
+	}
+
+	if (!it->second.schema)
+		return it->second.failure;
+
+	return it->second.schema;
+}
+
+void event_schema_cache::add(const GUID& provider_id, const EVENT_DESCRIPTOR& descriptor,
+	std::shared_ptr<const event_schema> schema)
+{
+	key schema_key{ provider_id, descriptor.Id, descriptor.Version, descriptor.Opcode };
+	schemas_[schema_key] = entry{ std::move(schema), decode_failure{ decode_error::none, 0 } };
+}
+
+bool event_schema_cache::is_cacheable(const EVENT_RECORD& record) noexcept
+{
+	return (record.EventHeader.Flags & EVENT_HEADER_FLAG_TRACE_MESSAGE) != EVENT_HEADER_FLAG_TRACE_MESSAGE
+		&& !event_extended_data(record).find(EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL);
+}
+} //namespace event_tracing
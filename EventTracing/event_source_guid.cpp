@@ -0,0 +1,21 @@
+#include "event_tracing/event_source_guid.h"
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+ms_guid get_event_source_guid(const std::wstring& name)
+{
+	if (name.empty())
+		return detail::make_event_source_guid(name.c_str(), 0u, false);
+
+	std::wstring uppercase_name(name.size(), L'\0');
+	auto size = ::LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE,
+		name.c_str(), static_cast<int>(name.size()),
+		&uppercase_name[0], static_cast<int>(uppercase_name.size()), nullptr, nullptr, 0);
+	if (!size)
+		throw event_trace_error("Unable to convert provider name to upper case", ::GetLastError());
+
+	return detail::make_event_source_guid(uppercase_name.c_str(), static_cast<std::size_t>(size), false);
+}
+} //namespace event_tracing
@@ -1,19 +1,75 @@
 #include "event_tracing/event_trace.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 
 #include "event_tracing/guid_helpers.h"
 #include "event_tracing/event_trace_error.h"
 #include "event_tracing/event_trace_session.h"
+#include "event_tracing/self_profiler.h"
 
 namespace event_tracing
 {
+event_trace_input::event_trace_input(const std::wstring& name, bool real_time)
+	: name_(name)
+	, real_time_(real_time)
+{
+}
+
+event_trace_input::event_trace_input(const std::string& ring_name)
+	: real_time_(true)
+	, ring_name_(ring_name)
+{
+}
+
+event_trace_input event_trace_input::real_time_session(const event_trace_session& session)
+{
+	return event_trace_input(session.get_name(), true);
+}
+
+event_trace_input event_trace_input::real_time_session(const std::wstring& session_name)
+{
+	return event_trace_input(session_name, true);
+}
+
+event_trace_input event_trace_input::log_file(const std::wstring& file_name)
+{
+	return event_trace_input(file_name, false);
+}
+
+event_trace_input event_trace_input::shared_ring(const std::string& ring_name)
+{
+	if (ring_name.empty())
+		throw event_trace_error("Shared ring name is empty");
+
+	return event_trace_input(ring_name);
+}
+
 event_trace::event_trace(const event_trace_session& session)
-	: session_name_(session.get_name())
+	: inputs_{ event_trace_input::real_time_session(session) }
 {
 	open_trace();
 }
 
+event_trace::event_trace(const std::vector<event_trace_input>& inputs,
+	std::int64_t merge_lookahead, std::chrono::milliseconds merge_idle_timeout,
+	std::size_t merge_stream_capacity)
+	: inputs_(inputs)
+{
+	if (inputs_.empty())
+		throw event_trace_error("No trace inputs specified");
+
+	if (inputs_.size() > 1)
+	{
+		merger_ = std::make_unique<timestamp_merger<event_record_copy>>(
+			inputs_.size(), merge_lookahead, merge_idle_timeout, merge_stream_capacity);
+		set_release_period(merge_idle_timeout);
+	}
+
+	open_trace();
+}
+
 event_trace::~event_trace()
 {
 	try
@@ -21,6 +77,8 @@ event_trace::~event_trace()
 		on_event_.disconnect_all_slots();
 		for (auto& pair : on_provider_event_)
 			pair.second.disconnect_all_slots();
+		for (auto& processor : on_filtered_event_)
+			processor.signal.disconnect_all_slots();
 		stop();
 	}
 	catch (...)
@@ -29,11 +87,100 @@ event_trace::~event_trace()
 	}
 }
 
+void event_trace::enable_reordering(std::int64_t time_window, std::size_t max_event_count,
+	std::chrono::milliseconds max_delay)
+{
+	if (started_.test_and_set())
+		throw event_trace_error("Reordering must be enabled before the trace is run");
+
+	reorder_buffer_ = std::make_unique<reorder_buffer<event_record_copy>>(time_window,
+		max_event_count, max_delay);
+	free_records_.reserve(max_event_count + 1u);
+	set_release_period(max_delay);
+	started_.clear();
+}
+
+void event_trace::enable_priority_dispatch(std::size_t lane_capacity, std::size_t max_bypass_count)
+{
+	if (started_.test_and_set())
+		throw event_trace_error("Priority dispatch must be enabled before the trace is run");
+
+	lanes_ = std::make_unique<priority_lanes<queued_event>>(
+		static_cast<std::size_t>(event_priority::bulk) + 1u, lane_capacity, max_bypass_count);
+	started_.clear();
+}
+
+void event_trace::enable_overload_control(const overload_policy& policy)
+{
+	if (started_.test_and_set())
+		throw event_trace_error("Overload control must be enabled before the trace is run");
+
+	overload_ = std::make_unique<overload_controller>(policy);
+	for (std::size_t i = 0; i != shed_class_keys_.size(); ++i)
+		overload_->add_class();
+
+	started_.clear();
+}
+
+void event_trace::set_sheddable(const ms_guid& trace_provider, USHORT event_id)
+{
+	event_key key(trace_provider, event_id);
+	if (!shed_classes_.emplace(key, shed_class_keys_.size()).second)
+		return;
+
+	shed_class_keys_.push_back(key);
+	reported_shed_counts_.push_back(0);
+	if (overload_)
+		overload_->add_class();
+}
+
+void event_trace::enable_metrics(metrics_registry& registry)
+{
+	if (started_.test_and_set())
+		throw event_trace_error("Metrics must be enabled before the trace is run");
+
+	static const std::vector<std::uint64_t> queue_time_bounds{
+		10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+	metrics_ = std::make_unique<trace_metrics>();
+	metrics_->received = &registry.add_counter("etw_events_received_total",
+		"Events received from ETW");
+	metrics_->dispatched = &registry.add_counter("etw_events_dispatched_total",
+		"Events passed to handlers");
+	metrics_->late = &registry.add_counter("etw_events_late_total",
+		"Events which arrived too late to be reordered");
+	metrics_->shed = &registry.add_counter("etw_events_shed_total",
+		"Events shed under overload");
+	metrics_->lost = &registry.add_counter("etw_events_lost_total",
+		"Events overwritten in shared rings before they were read");
+	metrics_->handler_errors = &registry.add_counter("etw_handler_errors_total",
+		"Events whose handlers threw");
+	metrics_->queue_depth = &registry.add_gauge("etw_dispatch_queue_depth",
+		"Events queued for priority dispatch");
+	const char* lanes[] = { "lane=\"high\"", "lane=\"normal\"", "lane=\"bulk\"" };
+	for (std::size_t i = 0; i != sizeof(lanes) / sizeof(lanes[0]); ++i)
+	{
+		metrics_->queue_time[i] = &registry.add_histogram("etw_dispatch_queue_time_us",
+			"Time events waited for priority dispatch", queue_time_bounds, lanes[i]);
+	}
+
+	started_.clear();
+}
+
+void event_trace::enable_loss_accounting(loss_tracker& tracker)
+{
+	if (started_.test_and_set())
+		throw event_trace_error("Loss accounting must be enabled before the trace is run");
+
+	loss_ = &tracker;
+	started_.clear();
+}
+
 void event_trace::run_async()
 {
 	if (started_.test_and_set())
 		return;
 
+	rings_stopped_ = false;
 	event_processor_ = std::thread([this]
 	{
 		start_monitoring(false);
@@ -45,12 +192,18 @@ void event_trace::run()
 	if (started_.test_and_set())
 		return;
 
+	rings_stopped_ = false;
 	start_monitoring(true);
 }
 
 void event_trace::stop()
 {
-	if (!trace_handle_.close())
+	rings_stopped_ = true;
+	bool closed = true;
+	for (auto& trace_handle : trace_handles_)
+		closed = trace_handle.close() && closed;
+
+	if (!closed)
 	{
 		assert(false);
 		if(event_processor_.joinable())
@@ -67,28 +220,91 @@ void event_trace::stop()
 
 void event_trace::open_trace()
 {
-	EVENT_TRACE_LOGFILEW trace{};
-	auto session_name = session_name_;
-	trace.LoggerName = &session_name[0];
-	trace.ProcessTraceMode = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
-	trace.EventRecordCallback = static_process_trace_event;
-	trace.Context = this;
+	auto ring_count = std::count_if(inputs_.cbegin(), inputs_.cend(), [](const event_trace_input& input)
+	{
+		return input.is_shared_ring();
+	});
+
+	//Shared rings are read on the same thread, which ProcessTrace does not allow
+	if (ring_count && static_cast<std::size_t>(ring_count) != inputs_.size())
+		throw event_trace_error("Shared ring inputs can not be combined with other inputs");
+
+	input_contexts_.resize(inputs_.size());
+	trace_handles_.resize(inputs_.size());
+	for (std::size_t i = 0; i != inputs_.size(); ++i)
+	{
+		input_contexts_[i].trace = this;
+		input_contexts_[i].index = i;
+
+		if (inputs_[i].is_shared_ring())
+		{
+			ring_sources_.push_back(std::make_unique<shared_ring_event_source>(inputs_[i].get_ring_name()));
+			ring_lost_counts_.push_back(0);
+			continue;
+		}
+
+		EVENT_TRACE_LOGFILEW trace{};
+		auto name = inputs_[i].get_name();
+		if (inputs_[i].is_real_time())
+		{
+			trace.LoggerName = &name[0];
+			trace.ProcessTraceMode = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
+		}
+		else
+		{
+			trace.LogFileName = &name[0];
+			trace.ProcessTraceMode = PROCESS_TRACE_MODE_EVENT_RECORD;
+		}
+
+		trace.EventRecordCallback = static_process_trace_event;
+		trace.Context = &input_contexts_[i];
 
-	trace_handle_.reset(::OpenTraceW(&trace));
-	if (!trace_handle_.is_valid())
-		throw event_trace_error("Unable to open trace", ::GetLastError());
+		trace_handles_[i].reset(::OpenTraceW(&trace));
+		if (!trace_handles_[i].is_valid())
+			throw event_trace_error("Unable to open trace", ::GetLastError());
+	}
 }
 
 void event_trace::start_monitoring(bool throw_error)
 {
-	auto handle = trace_handle_.get();
-	auto result = ::ProcessTrace(&handle, 1, 0, 0);
+	std::vector<TRACEHANDLE> handles;
+	handles.reserve(trace_handles_.size());
+	for (const auto& trace_handle : trace_handles_)
+		handles.push_back(trace_handle.get());
+
+	if (lanes_)
+	{
+		dispatcher_stopped_ = false;
+		dispatcher_ = std::thread([this]
+		{
+			run_dispatcher();
+		});
+	}
+
+	if (release_period_.count())
+	{
+		release_timer_stopped_ = false;
+		release_timer_ = std::thread([this]
+		{
+			run_release_timer();
+		});
+	}
+
+	auto result = ring_sources_.empty()
+		? ::ProcessTrace(handles.data(), static_cast<ULONG>(handles.size()), 0, 0)
+		: read_shared_rings();
+	stop_release_timer();
+	flush_buffered_events();
+	stop_dispatcher();
+	report_shed_events();
+	if (loss_)
+		flush_loss_accounting();
 	if (ERROR_SUCCESS != result && ERROR_CANCELLED != result)
 	{
 		if (throw_error)
 			throw event_trace_error("Unable to start trace monitoring", result);
 
-		process_trace_event(nullptr, result);
+		process_trace_error(result);
 	}
 	else
 	{
@@ -109,25 +325,412 @@ void event_trace::start_monitoring(bool throw_error)
 	}
 }
 
+ULONG event_trace::read_shared_rings() noexcept
+{
+	static constexpr const std::size_t max_poll_count = 256;
+
+	try
+	{
+		while (!rings_stopped_)
+		{
+			std::size_t read_count = 0;
+			bool finished = true;
+			for (std::size_t i = 0; i != ring_sources_.size(); ++i)
+			{
+				read_count += ring_sources_[i]->poll([this, i](PEVENT_RECORD record)
+				{
+					process_trace_event(i, record);
+				}, max_poll_count);
+
+				finished = finished && ring_sources_[i]->is_finished();
+				auto lost_count = ring_sources_[i]->get_lost_count();
+				if (lost_count != ring_lost_counts_[i])
+				{
+					if (metrics_)
+						metrics_->lost->increment(lost_count - ring_lost_counts_[i]);
+					if (loss_)
+						loss_->add_lost_events(i, lost_count - ring_lost_counts_[i]);
+
+					ring_lost_counts_[i] = lost_count;
+				}
+			}
+
+			//All publishers have stopped
+			if (finished)
+				break;
+
+			//Publishers do not signal new records
+			if (!read_count)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	catch (const std::exception&)
+	{
+		return ERROR_INVALID_DATA;
+	}
+
+	return ERROR_SUCCESS;
+}
+
 void __stdcall event_trace::static_process_trace_event(PEVENT_RECORD record)
 {
 	if (record->UserContext)
-		static_cast<event_trace*>(record->UserContext)->process_trace_event(record, 0u);
+	{
+		auto context = static_cast<const input_context*>(record->UserContext);
+		context->trace->process_trace_event(context->index, record);
+	}
+}
+
+void event_trace::process_trace_error(std::uint32_t error) noexcept
+{
+	try
+	{
+		on_error_(error);
+	}
+	catch (...)
+	{
+		assert(false);
+	}
 }
 
-void event_trace::process_trace_event(PEVENT_RECORD record, std::uint32_t error) noexcept
+void event_trace::process_trace_event(std::size_t input_index, PEVENT_RECORD record) noexcept
 {
+	EVENT_TRACING_PROFILE_SCOPE("event_trace::process_trace_event");
+	if (loss_)
+		observe_loss(input_index, *record);
+
+	if (record->EventHeader.ProviderId == EventTraceGuid)
+		return;
+
+	if (metrics_)
+		metrics_->received->increment();
+
+	if (!merger_ && !reorder_buffer_)
+	{
+		schedule_event(record);
+		return;
+	}
+
 	try
 	{
-		if (error)
+		std::lock_guard<std::mutex> lock(buffers_mutex_);
+		auto record_copy = acquire_record(*record);
+		if (!merger_)
 		{
-			on_error_(error);
+			reorder_event(record_copy);
 			return;
 		}
 
-		if (record->EventHeader.ProviderId == EventTraceGuid)
-			return;
+		auto timestamp = record_copy.get_timestamp();
+		merger_->push(input_index, timestamp, std::move(record_copy),
+			[this](std::size_t, event_record_copy& merged_record)
+		{
+			reorder_event(merged_record);
+		});
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+void event_trace::observe_loss(std::size_t input_index, const EVENT_RECORD& record) noexcept
+{
+	try
+	{
+		loss_->observe(input_index, record);
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+void event_trace::flush_loss_accounting() noexcept
+{
+	try
+	{
+		loss_->flush();
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+void event_trace::reorder_event(event_record_copy& record) noexcept
+{
+	if (!reorder_buffer_)
+	{
+		dispatch_ordered_event(record, false);
+		return;
+	}
+
+	auto timestamp = record.get_timestamp();
+	reorder_buffer_->push(timestamp, std::move(record), [this](event_record_copy& ordered_record, bool is_late)
+	{
+		dispatch_ordered_event(ordered_record, is_late);
+	});
+}
+
+void event_trace::dispatch_ordered_event(event_record_copy& record, bool is_late) noexcept
+{
+	if (is_late)
+	{
+		if (metrics_)
+			metrics_->late->increment();
+
+		try
+		{
+			on_late_event_(record.get());
+		}
+		catch (...)
+		{
+			assert(false);
+		}
+	}
+
+	schedule_event(record.get());
+	release_record(std::move(record));
+}
+
+void event_trace::set_release_period(std::chrono::milliseconds hold_time) noexcept
+{
+	//Held events wait at most half the hold time longer than they should
+	auto period = (std::max)(hold_time / 2, std::chrono::milliseconds(1));
+	if (!release_period_.count() || period < release_period_)
+		release_period_ = period;
+}
+
+void event_trace::release_held_events() noexcept
+{
+	try
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex_);
+		if (merger_)
+		{
+			merger_->release_idle([this](std::size_t, event_record_copy& merged_record)
+			{
+				reorder_event(merged_record);
+			});
+		}
+
+		if (reorder_buffer_)
+		{
+			reorder_buffer_->release_expired([this](event_record_copy& ordered_record, bool is_late)
+			{
+				dispatch_ordered_event(ordered_record, is_late);
+			});
+		}
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+void event_trace::run_release_timer() noexcept
+{
+	std::unique_lock<std::mutex> lock(buffers_mutex_);
+	while (!release_timer_changed_.wait_for(lock, release_period_, [this]
+	{
+		return release_timer_stopped_;
+	}))
+	{
+		lock.unlock();
+		release_held_events();
+		lock.lock();
+	}
+}
+
+void event_trace::stop_release_timer() noexcept
+{
+	if (!release_timer_.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex_);
+		release_timer_stopped_ = true;
+	}
+
+	release_timer_changed_.notify_all();
+	release_timer_.join();
+}
+
+void event_trace::flush_buffered_events() noexcept
+{
+	if (merger_)
+	{
+		merger_->flush([this](std::size_t, event_record_copy& merged_record)
+		{
+			reorder_event(merged_record);
+		});
+	}
+
+	if (reorder_buffer_)
+	{
+		reorder_buffer_->flush([this](event_record_copy& ordered_record, bool)
+		{
+			schedule_event(ordered_record.get());
+			release_record(std::move(ordered_record));
+		});
+	}
+}
+
+void event_trace::schedule_event(PEVENT_RECORD record) noexcept
+{
+	if (!lanes_)
+	{
+		dispatch_event(record);
+		return;
+	}
+
+	try
+	{
+		auto priority = get_priority(*record);
+		auto lane = static_cast<std::size_t>(priority);
+		bool admitted = true;
+		bool overload_ended = false;
+		{
+			std::unique_lock<std::mutex> lock(lanes_mutex_);
+			if (overload_)
+			{
+				overload_ended = overload_->observe(lanes_->size(),
+					std::chrono::nanoseconds(dispatch_lag_.load(std::memory_order_relaxed)))
+					&& !overload_->get_level();
+				admitted = admit_event(*record, priority);
+			}
+
+			if (admitted)
+			{
+				lanes_changed_.wait(lock, [this, lane]
+				{
+					return !lanes_->full(lane);
+				});
+
+				//Events of a process keep their order across lanes
+				auto slot = lanes_->push(lane, record->EventHeader.ProcessId);
+				auto& queued = lanes_->get(slot);
+				queued.record.assign(*record);
+				queued.priority = priority;
+				queued.queued_at = std::chrono::steady_clock::now();
+			}
+			else if (metrics_)
+			{
+				metrics_->shed->increment();
+			}
+
+			if (metrics_)
+				metrics_->queue_depth->set(static_cast<std::int64_t>(lanes_->size()));
+		}
+
+		if (admitted)
+			lanes_changed_.notify_all();
+		else
+			on_shed_event_(record);
+
+		if (overload_ended)
+			report_shed_events();
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+void event_trace::run_dispatcher() noexcept
+{
+	std::unique_lock<std::mutex> lock(lanes_mutex_);
+	while (true)
+	{
+		lanes_changed_.wait(lock, [this]
+		{
+			return !lanes_->empty() || dispatcher_stopped_;
+		});
+
+		//Queued events are dispatched before stopping
+		if (lanes_->empty())
+			break;
+
+		auto slot = lanes_->pop();
+		lock.unlock();
+		lanes_changed_.notify_all();
+
+		auto& queued = lanes_->get(slot);
+		auto queue_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - queued.queued_at);
+		dispatch_lag_.store(queue_time.count(), std::memory_order_relaxed);
+		if (metrics_)
+		{
+			metrics_->queue_time[static_cast<std::size_t>(queued.priority)]->observe(
+				static_cast<std::uint64_t>(queue_time.count() / 1000));
+		}
+		dispatch_event(queued.record.get());
+
+		lock.lock();
+		lanes_->release(slot);
+	}
+}
+
+void event_trace::stop_dispatcher() noexcept
+{
+	if (!dispatcher_.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(lanes_mutex_);
+		dispatcher_stopped_ = true;
+	}
+
+	lanes_changed_.notify_all();
+	dispatcher_.join();
+}
+
+bool event_trace::admit_event(const EVENT_RECORD& record, event_priority priority) noexcept
+{
+	if (priority == event_priority::high)
+		return true;
+
+	auto it = shed_classes_.find({ record.EventHeader.ProviderId, record.EventHeader.EventDescriptor.Id });
+	if (it == shed_classes_.cend())
+		return true;
+
+	return overload_->admit(it->second);
+}
+
+void event_trace::report_shed_events() noexcept
+{
+	if (!overload_)
+		return;
+
+	try
+	{
+		for (std::size_t i = 0; i != shed_class_keys_.size(); ++i)
+		{
+			const auto& counters = overload_->get_counters(i);
+			auto shed_count = counters.seen - counters.admitted;
+			if (shed_count == reported_shed_counts_[i])
+				continue;
+
+			reported_shed_counts_[i] = shed_count;
+			const auto& key = shed_class_keys_[i];
+			on_events_shed_(key.guid, *key.event_id, counters.seen, counters.admitted);
+		}
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
 
+void event_trace::dispatch_event(PEVENT_RECORD record) noexcept
+{
+	EVENT_TRACING_PROFILE_SCOPE("event_trace::dispatch_event");
+	if (metrics_)
+		metrics_->dispatched->increment();
+
+	try
+	{
 		on_event_(record);
 
 		auto it = on_provider_event_.find({ record->EventHeader.ProviderId });
@@ -137,10 +740,66 @@ void event_trace::process_trace_event(PEVENT_RECORD record, std::uint32_t error)
 		it = on_provider_event_.find({ record->EventHeader.ProviderId, record->EventHeader.EventDescriptor.Id });
 		if (it != on_provider_event_.cend())
 			(*it).second(record);
+
+		for (auto& processor : on_filtered_event_)
+		{
+			if (!processor.signal.empty() && processor.filter.matches(record))
+				processor.signal(record);
+		}
 	}
 	catch (...)
 	{
+		if (metrics_)
+			metrics_->handler_errors->increment();
+
 		assert(false);
 	}
 }
+
+event_record_copy event_trace::acquire_record(const EVENT_RECORD& record)
+{
+	if (free_records_.empty())
+		return event_record_copy(record);
+
+	auto result = std::move(free_records_.back());
+	free_records_.pop_back();
+	result.assign(record);
+	return result;
+}
+
+void event_trace::release_record(event_record_copy&& record) noexcept
+{
+	try
+	{
+		free_records_.push_back(std::move(record));
+	}
+	catch (...)
+	{
+	}
+}
+
+void event_trace::set_priority(const ms_guid& trace_provider, event_priority priority)
+{
+	auto it = priorities_.emplace(event_key(trace_provider), priority).first;
+	it->second = (std::min)(it->second, priority);
+}
+
+void event_trace::set_priority(const ms_guid& trace_provider, USHORT event_id, event_priority priority)
+{
+	auto it = priorities_.emplace(event_key(trace_provider, event_id), priority).first;
+	it->second = (std::min)(it->second, priority);
+}
+
+event_priority event_trace::get_priority(const EVENT_RECORD& record) const noexcept
+{
+	auto it = priorities_.find({ record.EventHeader.ProviderId, record.EventHeader.EventDescriptor.Id });
+	if (it != priorities_.cend())
+		return it->second;
+
+	it = priorities_.find({ record.EventHeader.ProviderId });
+	if (it != priorities_.cend())
+		return it->second;
+
+	return event_priority::normal;
+}
 } //namespace event_tracing
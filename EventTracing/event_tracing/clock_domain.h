@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <Windows.h>
+
+#include <boost/optional.hpp>
+
+namespace event_tracing
+{
+//Timestamps are unified as nanoseconds since 1970-01-01 00:00:00 UTC, which
+//covers years 1678 to 2261. Conversions use integer arithmetic only and are exact.
+
+//FILETIME of the Unix epoch
+constexpr const std::int64_t unix_epoch_filetime = 116444736000000000ll;
+
+//none if out of the nanosecond range
+boost::optional<std::int64_t> filetime_to_unix_nanoseconds(std::uint64_t filetime) noexcept;
+//Day of week is ignored, none if the fields are invalid or out of the nanosecond range
+boost::optional<std::int64_t> systemtime_to_unix_nanoseconds(const SYSTEMTIME& time) noexcept;
+
+//Longest result of format_iso8601, "YYYY-MM-DDThh:mm:ss.fffffffffZ"
+constexpr const std::size_t iso8601_max_length = 30;
+
+//Writes the time as YYYY-MM-DDThh:mm:ss[.f...]Z with up to nine fraction
+//digits, truncated, to a buffer of at least iso8601_max_length characters.
+//Returns the number of characters written, no terminating null is added.
+std::size_t format_iso8601(std::int64_t unix_nanoseconds, unsigned fraction_digits,
+	wchar_t* buffer) noexcept;
+void append_iso8601(std::int64_t unix_nanoseconds, unsigned fraction_digits, std::wstring& result);
+
+//Converts event timestamps of a trace to Unix nanoseconds. ProcessTrace
+//delivers FILETIME timestamps unless raw timestamps are requested, raw
+//QueryPerformanceCounter timestamps are converted with a frequency and a
+//counter value taken at a known system time, calibrated once per session.
+class clock_domain
+{
+public:
+	//FILETIME timestamps
+	static clock_domain system_time() noexcept;
+	//counter was read at system_time (FILETIME). The frequency must be
+	//from 1 kHz to 9.2 GHz, results are rounded down to nanoseconds.
+	static clock_domain query_performance_counter(std::int64_t frequency, std::int64_t counter,
+		std::int64_t system_time);
+	//Calibrated against the current system time
+	static clock_domain query_performance_counter();
+
+	bool is_system_time() const noexcept
+	{
+		return !frequency_;
+	}
+
+	std::int64_t get_frequency() const noexcept
+	{
+		return frequency_;
+	}
+
+	//Results out of the nanosecond range are clamped to it
+	std::int64_t to_unix_nanoseconds(std::int64_t timestamp) const noexcept;
+
+private:
+	clock_domain(std::int64_t frequency, std::int64_t counter, std::int64_t base) noexcept;
+
+private:
+	//Zero for FILETIME timestamps
+	std::int64_t frequency_;
+	std::int64_t counter_;
+	//Unix nanoseconds at counter_
+	std::int64_t base_;
+	//Nanoseconds per tick if the frequency divides a second, as the usual
+	//10 MHz one does, zero otherwise
+	std::int64_t tick_nanoseconds_;
+	std::int64_t max_ticks_;
+	//Whole seconds and the rest of the calibration point
+	std::int64_t counter_seconds_ = 0;
+	std::int64_t counter_remainder_ = 0;
+	std::int64_t base_seconds_ = 0;
+	std::int64_t base_fraction_ = 0;
+};
+} //namespace event_tracing
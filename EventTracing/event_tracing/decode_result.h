@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+namespace event_tracing
+{
+enum class decode_error : std::uint8_t
+{
+	none,
+	schema_not_found,
+	string_only_event,
+	property_not_found,
+	structure_expected,
+	struct_property_expected,
+	single_value_expected,
+	single_value_member_expected,
+	plain_value_expected,
+	index_out_of_bounds,
+	property_size_failed,
+	property_read_failed,
+	incorrect_property_type,
+	invalid_value_size,
+	invalid_filetime,
+	unsupported_type,
+	payload_truncated,
+	invalid_schema,
+	map_not_found
+};
+
+const char* get_decode_error_text(decode_error error) noexcept;
+
+struct decode_failure
+{
+	decode_error error;
+	//Win32 or TDH status, if the failure comes from a system call
+	std::uint32_t status_code;
+};
+
+[[noreturn]] void throw_decode_error(const decode_failure& failure);
+
+//Value or the reason it could not be decoded. Decoding functions return it
+//instead of throwing, so malformed and mismatched events cost no exception
+//unwinding; value() throws event_trace_error for callers which want it.
+template<typename T>
+class decode_result
+{
+public:
+	using value_type = T;
+
+	decode_result(const T& value)
+		: value_(value)
+	{
+	}
+
+	decode_result(T&& value)
+		: value_(std::move(value))
+	{
+	}
+
+	decode_result(decode_error error) noexcept
+		: failure_{ error, 0u }
+	{
+	}
+
+	decode_result(const decode_failure& failure) noexcept
+		: failure_(failure)
+	{
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return has_value();
+	}
+
+	bool has_value() const noexcept
+	{
+		return !!value_;
+	}
+
+	const T& value() const &
+	{
+		if (!value_)
+			throw_decode_error(failure_);
+
+		return *value_;
+	}
+
+	T&& value() &&
+	{
+		if (!value_)
+			throw_decode_error(failure_);
+
+		return std::move(*value_);
+	}
+
+	template<typename Default>
+	T value_or(Default&& default_value) const
+	{
+		return value_ ? *value_ : static_cast<T>(std::forward<Default>(default_value));
+	}
+
+	const T& operator*() const noexcept
+	{
+		return *value_;
+	}
+
+	T& operator*() noexcept
+	{
+		return *value_;
+	}
+
+	const T* operator->() const noexcept
+	{
+		return &*value_;
+	}
+
+	decode_error get_error() const noexcept
+	{
+		return failure_.error;
+	}
+
+	const decode_failure& get_failure() const noexcept
+	{
+		return failure_;
+	}
+
+private:
+	boost::optional<T> value_;
+	decode_failure failure_{ decode_error::none, 0u };
+};
+} //namespace event_tracing
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include <boost/optional.hpp>
+
+#include "event_tracing/decode_result.h"
+#include "event_tracing/event_property.h"
+#include "event_tracing/event_schema.h"
+
+namespace event_tracing
+{
+//Decodes the same top-level properties of many events sharing one schema
+//into columns. Offsets of properties in the fixed-size payload prefix are
+//computed once per schema, the other properties are located by a single
+//payload walk per event, which ends at the last of them.
+class event_batch_decoder
+{
+public:
+	static constexpr const std::uint32_t no_offset = 0xffffffffu;
+
+	//Throws event_trace_error if a field is not a top-level single-value property
+	event_batch_decoder(std::shared_ptr<const event_schema> schema,
+		const std::vector<std::wstring>& field_names);
+
+	std::size_t get_field_count() const noexcept
+	{
+		return fields_.size();
+	}
+
+	bool has_fixed_offset(std::size_t field) const noexcept
+	{
+		return fields_[field].fixed;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return records_.size();
+	}
+
+	//All events must have the decoder schema. Records must stay valid
+	//until the fields are decoded.
+	void load(const EVENT_RECORD* const* records, std::size_t count);
+
+	//Writes the field value of every loaded event to values, valid is zero
+	//for events without a decodable value. Returns the number of valid values.
+	template<typename PropertyType>
+	std::size_t decode(std::size_t field, std::vector<converter_value_t<PropertyType>>& values,
+		std::vector<std::uint8_t>& valid) const
+	{
+		using value_type = converter_value_t<PropertyType>;
+		const auto& info = fields_[field];
+		values.assign(records_.size(), value_type());
+		valid.assign(records_.size(), 0u);
+		if (info.fixed)
+		{
+			auto valid_count = try_gather<PropertyType>(info, values, valid,
+				std::is_arithmetic<value_type>());
+			if (valid_count)
+				return *valid_count;
+		}
+
+		std::size_t valid_count = 0;
+		for (std::size_t i = 0; i != records_.size(); ++i)
+		{
+			auto offset = info.fixed ? info.offset : info.offsets[i];
+			auto size = info.fixed ? info.size : info.sizes[i];
+			const auto& record = *records_[i];
+			if (offset == no_offset || record.UserDataLength < offset + size)
+				continue;
+
+			auto value = event_property_converter<PropertyType>::try_convert(event_property_view(
+				info.in_type, info.out_type, !(record.EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER),
+				static_cast<const std::uint8_t*>(record.UserData) + offset, size, info.name));
+			if (value)
+			{
+				values[i] = std::move(*value);
+				valid[i] = 1u;
+				++valid_count;
+			}
+		}
+
+		return valid_count;
+	}
+
+private:
+	struct field_info
+	{
+		const wchar_t* name;
+		USHORT in_type;
+		USHORT out_type;
+		bool fixed;
+		//Location of fixed-offset fields
+		std::uint32_t offset;
+		std::uint32_t size;
+		//Per-event locations of the other fields, no_offset if not found
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint32_t> sizes;
+	};
+
+	class field_locator;
+
+private:
+	//Plain loads for numeric values, used when the converter accepts the field type
+	template<typename PropertyType, typename Value>
+	boost::optional<std::size_t> try_gather(const field_info& info, std::vector<Value>& values,
+		std::vector<std::uint8_t>& valid, std::true_type) const
+	{
+		std::uint8_t probe[sizeof(std::uint64_t)]{};
+		if (info.size > sizeof(probe) || !event_property_converter<PropertyType>::try_convert(
+			event_property_view(info.in_type, info.out_type, true, probe, info.size, info.name)))
+		{
+			return boost::none;
+		}
+
+		switch (info.in_type)
+		{
+		case TDH_INTYPE_INT8:
+			return gather<std::int8_t>(info, values, valid);
+
+		case TDH_INTYPE_UINT8:
+			return gather<std::uint8_t>(info, values, valid);
+
+		case TDH_INTYPE_INT16:
+			return gather<std::int16_t>(info, values, valid);
+
+		case TDH_INTYPE_UINT16:
+			return gather<std::uint16_t>(info, values, valid);
+
+		case TDH_INTYPE_INT32:
+		case TDH_INTYPE_HEXINT32:
+			return gather<std::int32_t>(info, values, valid);
+
+		case TDH_INTYPE_UINT32:
+		case TDH_INTYPE_BOOLEAN:
+			return gather<std::uint32_t>(info, values, valid);
+
+		case TDH_INTYPE_INT64:
+		case TDH_INTYPE_HEXINT64:
+			return gather<std::int64_t>(info, values, valid);
+
+		case TDH_INTYPE_UINT64:
+			return gather<std::uint64_t>(info, values, valid);
+
+		case TDH_INTYPE_FLOAT:
+			return gather<FLOAT>(info, values, valid);
+
+		case TDH_INTYPE_DOUBLE:
+			return gather<DOUBLE>(info, values, valid);
+
+		case TDH_INTYPE_UNICODECHAR:
+			return gather<WCHAR>(info, values, valid);
+
+		case TDH_INTYPE_ANSICHAR:
+			return gather<CHAR>(info, values, valid);
+
+		default:
+			break;
+		}
+
+		return boost::none;
+	}
+
+	template<typename PropertyType, typename Value>
+	boost::optional<std::size_t> try_gather(const field_info&, std::vector<Value>&,
+		std::vector<std::uint8_t>&, std::false_type) const
+	{
+		return boost::none;
+	}
+
+	template<typename Source, typename Value>
+	std::size_t gather(const field_info& info, std::vector<Value>& values,
+		std::vector<std::uint8_t>& valid) const
+	{
+		if (info.size != sizeof(Source))
+			return 0;
+
+		std::size_t valid_count = 0;
+		auto end = info.offset + sizeof(Source);
+		for (std::size_t i = 0; i != records_.size(); ++i)
+		{
+			const auto& record = *records_[i];
+			if (record.UserDataLength < end)
+				continue;
+
+			//Payload values are not aligned
+			Source value;
+			std::memcpy(&value, static_cast<const std::uint8_t*>(record.UserData) + info.offset,
+				sizeof(value));
+			values[i] = static_cast<Value>(value);
+			valid[i] = 1u;
+			++valid_count;
+		}
+
+		return valid_count;
+	}
+
+private:
+	std::shared_ptr<const event_schema> schema_;
+	std::vector<field_info> fields_;
+	//Top-level properties to walk to reach all variable-offset fields
+	ULONG walk_property_count_ = 0;
+	std::vector<const EVENT_RECORD*> records_;
+};
+} //namespace event_tracing
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_schema.h"
+
+namespace event_tracing
+{
+//Receives batches from event_forwarder instances and passes their records
+//to the handler together with the schemas sent by the same host, so events
+//can be decoded with event_info without the providers installed locally.
+//Batches are acknowledged after all of their records have been handled;
+//batches resent after a reconnection are handled once.
+//The handler is called on the collector thread.
+class event_collector
+{
+public:
+	using event_handler = std::function<void(const std::string& host_id, PEVENT_RECORD record,
+		event_schema_cache& schemas)>;
+
+public:
+	//Throws event_trace_error if the port can not be opened
+	event_collector(const std::string& address, unsigned short port, event_handler handler);
+	~event_collector();
+
+	event_collector(const event_collector&) = delete;
+	event_collector& operator=(const event_collector&) = delete;
+
+	unsigned short get_port() const noexcept;
+
+	void run();
+	void run_async();
+	void stop();
+
+	std::uint64_t get_received_count() const noexcept;
+	//Batches received again after a reconnection and skipped
+	std::uint64_t get_duplicate_batch_count() const noexcept;
+
+private:
+	class server;
+
+private:
+	std::unique_ptr<server> server_;
+	std::thread server_thread_;
+};
+} //namespace event_tracing
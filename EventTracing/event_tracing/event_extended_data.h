@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include <boost/optional.hpp>
+
+namespace event_tracing
+{
+//View of a stack trace extended data item, frames go from the innermost
+//(the one which logged the event) to the outermost
+class event_stack_trace
+{
+public:
+	event_stack_trace(std::uint64_t match_id, const void* frames,
+		std::size_t frame_count, bool is_64_bit) noexcept;
+
+	std::uint64_t get_match_id() const noexcept
+	{
+		return match_id_;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return frame_count_;
+	}
+
+	bool empty() const noexcept
+	{
+		return !frame_count_;
+	}
+
+	bool is_64_bit() const noexcept
+	{
+		return is_64_bit_;
+	}
+
+	std::uint64_t operator[](std::size_t index) const noexcept;
+
+private:
+	std::uint64_t match_id_;
+	const void* frames_;
+	std::size_t frame_count_;
+	bool is_64_bit_;
+};
+
+//Typed accessors for EVENT_RECORD::ExtendedData items.
+//Items with unexpected size are treated as missing.
+class event_extended_data
+{
+public:
+	explicit event_extended_data(const EVENT_RECORD& record) noexcept;
+
+	std::size_t size() const noexcept
+	{
+		return count_;
+	}
+
+	bool empty() const noexcept
+	{
+		return !count_;
+	}
+
+	const EVENT_HEADER_EXTENDED_DATA_ITEM& operator[](std::size_t index) const noexcept
+	{
+		return items_[index];
+	}
+
+	const EVENT_HEADER_EXTENDED_DATA_ITEM* find(USHORT ext_type) const noexcept;
+
+	boost::optional<GUID> get_related_activity_id() const noexcept;
+	boost::optional<ULONG> get_terminal_session_id() const noexcept;
+	boost::optional<std::uint64_t> get_process_start_key() const noexcept;
+	boost::optional<std::uint64_t> get_event_key() const noexcept;
+	boost::optional<event_stack_trace> get_stack_trace() const noexcept;
+	//Session-wide sequence number, none if the SDK does not define the item
+	boost::optional<std::uint64_t> get_sequence_number() const noexcept;
+
+	//Returns nullptr when the event does not carry a user SID
+	const SID* get_user_sid() const noexcept;
+
+private:
+	template<typename Value>
+	boost::optional<Value> get_value(USHORT ext_type) const noexcept;
+
+private:
+	const EVENT_HEADER_EXTENDED_DATA_ITEM* items_;
+	std::size_t count_;
+};
+} //namespace event_tracing
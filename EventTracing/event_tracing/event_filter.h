@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/guid_helpers.h"
+
+namespace event_tracing
+{
+//Filter expression compiled into a predicate program.
+//Grammar:
+//  expression := term { ("or" | "||") term }
+//  term       := factor { ("and" | "&&") factor }
+//  factor     := ("not" | "!") factor | "(" expression ")" | predicate
+//  predicate  := field compare number
+//              | field "in" "(" number { "," number } ")"
+//              | field "has" number                     (any bit of mask set)
+//              | "provider" ("==" | "!=") "{guid}"
+//              | $property compare number
+//              | $property string_compare "string"
+//  field      := pid | tid | level | opcode | id | version | task | channel | keyword
+//  compare    := "==" | "!=" | "<" | "<=" | ">" | ">="
+//  string_compare := "==" | "!=" | "contains" | "starts_with" | "ends_with"
+//Header fields are tested without decoding the event; $property predicates
+//decode only the referenced properties and only when the header fields do not
+//decide the result. Operands of "and" and "or" are evaluated lazily, header
+//only operands first, so a property is not decoded once the result is known.
+//String comparisons are case-insensitive. Numbers are compared by value
+//whatever the signedness of the property, numbers out of the 64-bit range
+//and negative numbers for header fields are rejected.
+//Example: pid in (4, 1234) and level <= 4 and $ImageName ends_with ".exe"
+class event_filter
+{
+public:
+	enum class header_match : std::uint8_t
+	{
+		no = 0,
+		maybe = 1,
+		yes = 2
+	};
+
+public:
+	explicit event_filter(const std::wstring& expression);
+
+	bool matches(PEVENT_RECORD record) const;
+	void matches(const PEVENT_RECORD* records, std::size_t count, bool* results) const;
+
+	//Evaluates the expression on header fields only, property predicates are unknown
+	header_match match_header(const EVENT_RECORD& record) const noexcept;
+	void match_headers(const PEVENT_RECORD* records, std::size_t count, header_match* results) const;
+
+	bool references_properties() const noexcept
+	{
+		return !property_names_.empty();
+	}
+
+	const std::wstring& get_expression() const noexcept
+	{
+		return expression_;
+	}
+
+private:
+	enum class header_field : std::uint8_t
+	{
+		pid,
+		tid,
+		level,
+		opcode,
+		id,
+		version,
+		task,
+		channel,
+		keyword
+	};
+
+	enum class compare_operation : std::uint8_t
+	{
+		equal,
+		not_equal,
+		less,
+		less_equal,
+		greater,
+		greater_equal,
+		contains,
+		starts_with,
+		ends_with
+	};
+
+	enum class operation : std::uint8_t
+	{
+		header_compare,
+		header_in,
+		header_mask,
+		provider_compare,
+		property_compare,
+		property_string_compare,
+		logical_and,
+		logical_or,
+		logical_not
+	};
+
+	struct instruction
+	{
+		operation op;
+		header_field field;
+		compare_operation compare;
+		//Magnitude of the number, or index of the string
+		std::uint64_t value;
+		bool negative;
+		std::size_t index;
+		//Program indexes of the last instructions of the operands of
+		//"and" and "or", in evaluation order
+		std::size_t first_operand;
+		std::size_t second_operand;
+		bool has_properties;
+	};
+
+	class parser;
+	struct property_cache;
+
+private:
+	static std::uint64_t get_header_field(const EVENT_HEADER& header, header_field field) noexcept;
+	static bool compare_values(std::uint64_t left, compare_operation compare,
+		std::uint64_t right) noexcept;
+	//Numbers given as a sign and a magnitude
+	static bool compare_numbers(bool left_negative, std::uint64_t left, compare_operation compare,
+		bool right_negative, std::uint64_t right) noexcept;
+	static bool compare_strings(const std::wstring& left, compare_operation compare,
+		const std::wstring& right);
+	std::uint8_t evaluate_header_instruction(const instruction& instr,
+		const EVENT_RECORD& record) const noexcept;
+	bool evaluate_property_instruction(const instruction& instr,
+		property_cache& cache) const;
+	std::uint8_t evaluate_header(std::size_t index, const EVENT_RECORD& record) const noexcept;
+	bool evaluate(std::size_t index, const EVENT_RECORD& record, property_cache& cache) const;
+	void link_operands() noexcept;
+
+private:
+	std::wstring expression_;
+	std::vector<instruction> program_;
+	std::vector<std::vector<std::uint64_t>> value_sets_;
+	std::vector<ms_guid> guids_;
+	std::vector<std::wstring> strings_;
+	std::vector<std::wstring> property_names_;
+	std::size_t max_stack_depth_ = 0;
+};
+} //namespace event_tracing
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_schema.h"
+#include "event_tracing/forward_queue.h"
+
+namespace event_tracing
+{
+struct event_forwarder_options
+{
+	//Batches are sealed at this raw size or after this delay
+	std::size_t max_batch_size = 256 * 1024;
+	std::chrono::milliseconds max_batch_delay{ 100 };
+	//Batches sent before the collector has to acknowledge them
+	std::size_t max_unacknowledged_batches = 8;
+	//Compressed batches kept in memory while unacknowledged, and the same
+	//again for sealed batches waiting for compression
+	std::size_t max_memory_size = 16 * 1024 * 1024;
+	//Batches beyond the memory limit are spilled to this file if it is set,
+	//otherwise they are dropped. Sealed batches beyond the limit are then
+	//compressed by forward() itself.
+	std::string spill_file_name;
+	std::uint64_t max_spill_size = 1024ull * 1024 * 1024;
+	std::chrono::milliseconds min_reconnect_delay{ 100 };
+	std::chrono::milliseconds max_reconnect_delay{ 5000 };
+};
+
+//Sends raw event records with the schemas they need to an event_collector.
+//Records are batched into compressed frames which the collector acknowledges
+//after processing. Unacknowledged batches are queued in memory and spilled to
+//disk while the collector is slow or unavailable, and are resent after
+//reconnection; the collector discards batches it has already processed.
+class event_forwarder
+{
+public:
+	//The host id identifies the forwarder to the collector across reconnections
+	event_forwarder(const std::string& host_id, const std::string& collector_host,
+		unsigned short collector_port, const event_forwarder_options& options = event_forwarder_options());
+	~event_forwarder();
+
+	event_forwarder(const event_forwarder&) = delete;
+	event_forwarder& operator=(const event_forwarder&) = delete;
+
+	//Never waits for the network. Must not be called from several threads at once.
+	void forward(PEVENT_RECORD record);
+
+	//Seals the current batch
+	void flush();
+
+	void run_async();
+	//Sends what has been forwarded and acknowledged within the timeout
+	void stop(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+	std::uint64_t get_forwarded_count() const noexcept
+	{
+		return forwarded_count_;
+	}
+
+	std::uint64_t get_acknowledged_count() const noexcept
+	{
+		return acknowledged_count_;
+	}
+
+	//Records of batches dropped because the memory and spill limits were
+	//reached, or because a batch could not be encoded
+	std::uint64_t get_dropped_count() const noexcept
+	{
+		return dropped_count_;
+	}
+
+	std::uint64_t get_connection_count() const noexcept
+	{
+		return connection_count_;
+	}
+
+	std::size_t get_queued_batch_count() const
+	{
+		return queue_.size();
+	}
+
+private:
+	class connection;
+
+	struct schema_key
+	{
+		GUID provider_id;
+		USHORT id;
+		UCHAR version;
+		UCHAR opcode;
+	};
+
+	struct sealed_batch
+	{
+		std::vector<std::uint8_t> data;
+		std::uint64_t record_count;
+	};
+
+private:
+	//Called with the batch mutex locked
+	void seal_batch();
+	void add_schema(PEVENT_RECORD record);
+
+	//Called by the connection thread
+	void seal_expired_batch();
+	//Compresses sealed batches into the queue, called by the connection
+	//thread and by forward() when sealed batches reach the memory limit
+	void encode_batches();
+	std::size_t acknowledge(std::uint64_t sequence);
+
+private:
+	event_forwarder_options options_;
+	forward_queue queue_;
+	event_schema_cache schemas_;
+	std::unique_ptr<connection> connection_;
+	std::thread connection_thread_;
+
+	std::mutex batch_mutex_;
+	std::vector<std::uint8_t> batch_;
+	std::uint64_t batch_record_count_ = 0;
+	std::chrono::steady_clock::time_point batch_started_at_;
+	std::vector<schema_key> batch_schemas_;
+	std::vector<sealed_batch> sealed_batches_;
+	//Raw size of sealed batches not yet in the queue
+	std::size_t unencoded_size_ = 0;
+	//Sealed batches not yet in the queue
+	std::atomic<std::size_t> unencoded_batch_count_{ 0 };
+
+	//Held while batches are encoded into the queue, so they keep their order
+	std::mutex encode_mutex_;
+	std::uint64_t next_sequence_ = 1;
+	//Record counts of queued batches by sequence number
+	std::deque<std::pair<std::uint64_t, std::uint64_t>> queued_record_counts_;
+
+	std::atomic<std::uint64_t> forwarded_count_{ 0 };
+	std::atomic<std::uint64_t> acknowledged_count_{ 0 };
+	std::atomic<std::uint64_t> dropped_count_{ 0 };
+	std::atomic<std::uint64_t> connection_count_{ 0 };
+};
+} //namespace event_tracing
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <ostream>
 #include <vector>
 
@@ -8,7 +10,11 @@
 #include <Evntrace.h>
 #include <tdh.h>
 
+#include "event_tracing/clock_domain.h"
+#include "event_tracing/decode_result.h"
+#include "event_tracing/event_extended_data.h"
 #include "event_tracing/event_property.h"
+#include "event_tracing/event_schema.h"
 #include "event_tracing/event_trace_error.h"
 
 namespace event_tracing
@@ -46,19 +52,21 @@ private:
 	ULONG top_level_index_;
 };
 
+//Header fields are read from the event record directly, the event schema
+//is requested from TDH (or the schema cache, if given) on the first access
+//to properties or other schema data. With the schema cache, property values
+//are decoded from the payload with the cached schema, without TDH, and value
+//maps of properties are resolved. try_ members report decoding failures in
+//the result, the others throw event_trace_error.
 class event_info
 {
 public:
-	explicit event_info(PEVENT_RECORD record);
+	explicit event_info(PEVENT_RECORD record) noexcept;
+	event_info(PEVENT_RECORD record, event_schema_cache& schema_cache) noexcept;
 
-	operator PTRACE_EVENT_INFO() noexcept
+	operator const TRACE_EVENT_INFO*() const
 	{
-		return reinterpret_cast<PTRACE_EVENT_INFO>(data_.data());
-	}
-
-	operator const TRACE_EVENT_INFO*() const noexcept
-	{
-		return reinterpret_cast<const TRACE_EVENT_INFO*>(data_.data());
+		return get_schema().get_info();
 	}
 
 	operator PEVENT_RECORD() noexcept
@@ -75,16 +83,115 @@ public:
 	event_property get_event_string() const;
 
 	const wchar_t* get_property_name(ULONG top_level_index) const;
-	const wchar_t* get_event_message() const noexcept;
+	const wchar_t* get_event_message() const;
+
+	event_extended_data get_extended_data() const noexcept
+	{
+		return event_extended_data(*record_);
+	}
+
+	const EVENT_DESCRIPTOR& get_event_descriptor() const noexcept
+	{
+		return record_->EventHeader.EventDescriptor;
+	}
+
+	USHORT get_event_id() const noexcept
+	{
+		return record_->EventHeader.EventDescriptor.Id;
+	}
+
+	const GUID& get_provider_id() const noexcept
+	{
+		return record_->EventHeader.ProviderId;
+	}
+
+	ULONG get_process_id() const noexcept
+	{
+		return record_->EventHeader.ProcessId;
+	}
+
+	ULONG get_thread_id() const noexcept
+	{
+		return record_->EventHeader.ThreadId;
+	}
+
+	std::int64_t get_timestamp() const noexcept
+	{
+		return record_->EventHeader.TimeStamp.QuadPart;
+	}
+
+	//Timestamps are FILETIME unless the trace delivers raw ones
+	std::int64_t get_unix_timestamp(const clock_domain& clock = clock_domain::system_time()) const noexcept
+	{
+		return clock.to_unix_nanoseconds(get_timestamp());
+	}
+
+	bool is_schema_loaded() const noexcept
+	{
+		return !!schema_;
+	}
 
-	const EVENT_DESCRIPTOR& get_event_descriptor() const noexcept;
-	USHORT get_event_id() const noexcept;
+	decode_result<const event_schema*> try_get_schema() const;
+	const event_schema& get_schema() const
+	{
+		return *try_get_schema().value();
+	}
 
-	ULONG get_top_level_property_count() const noexcept;
+	ULONG get_top_level_property_count() const;
 
+	decode_result<bool> try_is_property_struct(ULONG top_level_index) const;
+	decode_result<event_info_structure> try_get_structure(ULONG top_level_index) const;
 	bool is_property_struct(ULONG top_level_index) const;
 	event_info_structure get_structure(ULONG top_level_index) const;
 
+	decode_result<ULONG> try_find_property_index(const std::wstring& name) const;
+	decode_result<ULONG> try_get_array_property_size(ULONG top_level_index) const;
+	decode_result<event_property> try_get_plain_property_value(ULONG top_level_index) const;
+	decode_result<event_property> try_get_array_property_value(ULONG top_level_index,
+		ULONG element_index) const;
+
+	decode_result<ULONG> try_find_property_index(const event_info_structure& structure,
+		const std::wstring& name) const;
+	decode_result<ULONG> try_get_array_property_size(const event_info_structure& structure,
+		ULONG struct_member_index) const;
+	decode_result<event_property> try_get_plain_property_value(const event_info_structure& structure,
+		ULONG struct_member_index) const;
+	decode_result<event_property> try_get_plain_property_value(const event_info_structure& structure,
+		ULONG struct_index, ULONG struct_member_index) const;
+	decode_result<event_property> try_get_array_property_value(const event_info_structure& structure,
+		ULONG struct_index, ULONG struct_member_index, ULONG struct_element_index) const;
+
+	template<typename PropertyType>
+	converter_result_t<PropertyType> try_get_plain_property_value(const std::wstring& name) const
+	{
+		auto top_level_index = try_find_property_index(name);
+		if (!top_level_index)
+			return top_level_index.get_failure();
+
+		return try_get_plain_property_value<PropertyType>(*top_level_index);
+	}
+
+	template<typename PropertyType>
+	converter_result_t<PropertyType> try_get_plain_property_value(ULONG top_level_index) const
+	{
+		auto prop = try_get_plain_property_value(top_level_index);
+		if (!prop)
+			return prop.get_failure();
+
+		return event_property_converter<PropertyType>::try_convert(*prop);
+	}
+
+	template<typename PropertyType>
+	converter_result_t<PropertyType> try_get_array_property_value(ULONG top_level_index,
+		ULONG element_index) const
+	{
+		auto prop = try_get_array_property_value(top_level_index, element_index);
+		if (!prop)
+			return prop.get_failure();
+
+		return event_property_converter<PropertyType>::try_convert(*prop);
+	}
+
 	bool find_property_index(const std::wstring& name, ULONG& top_level_index) const;
 	ULONG get_array_property_size(ULONG top_level_index) const;
 	event_property get_plain_property_value(ULONG top_level_index) const;
@@ -108,31 +215,26 @@ public:
 		if (!find_property_index(name, top_level_index))
 			return false;
 
-		value = event_property_converter<PropertyType>::convert(get_plain_property_value(top_level_index));
+		value = try_get_plain_property_value<PropertyType>(top_level_index).value();
 		return true;
 	}
 
 	template<typename PropertyType>
 	auto get_plain_property_value(const std::wstring& name) const
 	{
-		ULONG top_level_index = 0u;
-		if (!find_property_index(name, top_level_index))
-			throw event_trace_error("Property was not found in event");
-
-		return event_property_converter<PropertyType>::convert(get_plain_property_value(top_level_index));
+		return try_get_plain_property_value<PropertyType>(name).value();
 	}
 
 	template<typename PropertyType>
 	auto get_plain_property_value(ULONG top_level_index) const
 	{
-		return event_property_converter<PropertyType>::convert(get_plain_property_value(top_level_index));
+		return try_get_plain_property_value<PropertyType>(top_level_index).value();
 	}
 
 	template<typename PropertyType>
 	auto get_array_property_value(ULONG top_level_index, ULONG element_index) const
 	{
-		return event_property_converter<PropertyType>::convert(
-			get_array_property_value(top_level_index, element_index));
+		return try_get_array_property_value<PropertyType>(top_level_index, element_index).value();
 	}
 
 	template<typename PropertyType>
@@ -160,19 +262,25 @@ public:
 	}
 
 private:
-	event_property get_array_property_value(ULONG top_level_index,
+	decode_result<event_property> try_get_property_value(ULONG top_level_index,
 		ULONG element_index, bool is_array) const;
-	event_property get_array_property_value(const event_info_structure& structure,
+	decode_result<event_property> try_get_property_value(const event_info_structure& structure,
 		ULONG struct_index, ULONG struct_member_index, ULONG struct_element_index,
 		bool is_array, bool is_struct_member_array) const;
-	event_property get_array_property_value(ULONG top_level_index,
+	decode_result<event_property> try_get_property_value(ULONG top_level_index,
 		ULONG element_index, ULONG struct_member_index, bool is_array, bool is_struct_member_array,
 		PROPERTY_DATA_DESCRIPTOR* data_descriptors, ULONG descriptor_count) const;
+	//Walks the payload with the cached schema up to the property
+	decode_result<event_property> try_decode_property_value(ULONG top_level_index,
+		ULONG element_index, ULONG struct_member_index, ULONG struct_element_index, bool is_array,
+		bool is_struct_member, bool is_struct_member_array) const;
 
-	void check_if_has_properties() const;
+	decode_result<const TRACE_EVENT_INFO*> try_get_property_schema() const;
 
 private:
-	std::vector<uint8_t> data_;
+	mutable std::shared_ptr<const event_schema> schema_;
+	mutable decode_failure schema_failure_{ decode_error::none, 0u };
+	event_schema_cache* schema_cache_ = nullptr;
 	PEVENT_RECORD record_;
 };
 
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/decode_result.h"
+
+namespace event_tracing
+{
+//Value map or bitmap of a provider compiled into a flat lookup table.
+//Small value ranges are looked up in a dense table, the others are
+//binary searched; bitmap values are decomposed bit by bit.
+class event_value_map
+{
+public:
+	using entry = std::pair<std::uint32_t, std::wstring>;
+
+	static decode_result<std::shared_ptr<const event_value_map>> load(PEVENT_RECORD record,
+		const wchar_t* map_name);
+	//info points to the TdhGetEventMapInformation output of the given size
+	static decode_result<std::shared_ptr<const event_value_map>> compile(const EVENT_MAP_INFO* info,
+		std::size_t size);
+
+	//Bitmap entry values are bit masks
+	event_value_map(std::vector<entry> entries, bool is_bitmap);
+
+	bool is_bitmap() const noexcept
+	{
+		return is_bitmap_;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return name_offsets_.size();
+	}
+
+	//Name of the value map entry, nullptr if the value is not mapped or this is a bitmap
+	const wchar_t* find(std::uint32_t value) const noexcept;
+
+	//Appends names of the value, bitmap names are separated with '|'.
+	//Values and bits without names are appended as numbers.
+	void format(std::uint32_t value, std::wstring& result) const;
+	std::wstring format(std::uint32_t value) const
+	{
+		std::wstring result;
+		format(value, result);
+		return result;
+	}
+
+private:
+	const wchar_t* get_name(std::uint32_t name_index) const noexcept
+	{
+		return names_.c_str() + name_offsets_[name_index];
+	}
+
+private:
+	bool is_bitmap_;
+	//Null-separated entry names
+	std::wstring names_;
+	std::vector<std::uint32_t> name_offsets_;
+
+	//Value maps: name index + 1 by value - dense_base_, or (value, name index) sorted by value
+	std::uint32_t dense_base_ = 0;
+	std::vector<std::uint32_t> dense_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> sorted_;
+
+	//Bitmaps: name index + 1 of single bits, (mask, name index) of multi-bit masks
+	std::uint32_t bits_[32]{};
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> masks_;
+	std::uint32_t zero_name_ = 0;
+};
+
+//Maps by provider and map name. Not thread-safe.
+class event_map_cache
+{
+public:
+	decode_result<std::shared_ptr<const event_value_map>> get(PEVENT_RECORD record,
+		const wchar_t* map_name);
+
+	std::size_t size() const noexcept
+	{
+		return maps_.size();
+	}
+
+	void clear() noexcept
+	{
+		maps_.clear();
+	}
+
+private:
+	struct key
+	{
+		GUID provider_id;
+		std::wstring map_name;
+
+		bool operator==(const key& other) const noexcept;
+	};
+
+	struct key_hash
+	{
+		std::size_t operator()(const key& value) const noexcept;
+	};
+
+	struct entry
+	{
+		std::shared_ptr<const event_value_map> map;
+		decode_failure failure;
+	};
+
+private:
+	std::unordered_map<key, entry, key_hash> maps_;
+};
+} //namespace event_tracing
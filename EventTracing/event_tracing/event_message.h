@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/decode_result.h"
+
+namespace event_tracing
+{
+class event_info;
+class event_schema;
+
+//Event message with FormatMessage-style inserts (%1, %2!x!, %n, %%),
+//split once into literal and top-level property tokens
+class event_message_template
+{
+public:
+	static constexpr const ULONG no_argument = 0xffffffffu;
+
+	struct token
+	{
+		//Literal text range, or the property index for inserts
+		std::uint32_t offset;
+		std::uint32_t length;
+		ULONG argument;
+	};
+
+	explicit event_message_template(const wchar_t* message);
+
+	bool empty() const noexcept
+	{
+		return tokens_.empty();
+	}
+
+	//Number of top-level properties needed to render the message
+	ULONG get_argument_count() const noexcept
+	{
+		return argument_count_;
+	}
+
+	const std::vector<token>& get_tokens() const noexcept
+	{
+		return tokens_;
+	}
+
+	const wchar_t* get_literal(const token& value) const noexcept
+	{
+		return text_.c_str() + value.offset;
+	}
+
+private:
+	std::wstring text_;
+	std::vector<token> tokens_;
+	ULONG argument_count_ = 0;
+};
+
+//Renders event messages, reusing its buffers between events. Not thread-safe.
+class event_message_renderer
+{
+public:
+	//Appends the event message with inserts replaced with property values.
+	//Mapped values are replaced with their names.
+	//Returns the number of characters appended.
+	decode_result<std::size_t> render(const event_info& info, std::wstring& result);
+	decode_result<std::size_t> render(const event_schema& schema, const EVENT_RECORD& record,
+		std::wstring& result);
+
+private:
+	class argument_collector;
+
+private:
+	//Text of inserts and (offset, length) of each argument in it
+	std::wstring values_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges_;
+};
+} //namespace event_tracing
@@ -1,21 +1,100 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "event_tracing/decode_result.h"
 #include "event_tracing/guid_helpers.h"
 
 namespace event_tracing
 {
+class event_value_map;
+
+//Non-owning property value, points into the event payload or an event_property
+class event_property_view
+{
+public:
+	event_property_view(std::uint16_t in_type, std::uint16_t out_type, bool wide_pointer,
+		const std::uint8_t* data, std::size_t size, const wchar_t* name,
+		const event_value_map* map = nullptr) noexcept
+		: in_type_(in_type)
+		, out_type_(out_type)
+		, wide_pointer_(wide_pointer)
+		, data_(data)
+		, size_(size)
+		, name_(name)
+		, map_(map)
+	{
+	}
+
+	std::uint16_t get_in_type() const noexcept
+	{
+		return in_type_;
+	}
+
+	std::uint16_t get_out_type() const noexcept
+	{
+		return out_type_;
+	}
+
+	const wchar_t* get_name() const noexcept
+	{
+		return name_;
+	}
+
+	const std::uint8_t* get_data() const noexcept
+	{
+		return data_;
+	}
+
+	std::size_t get_size() const noexcept
+	{
+		return size_;
+	}
+
+	bool is_wide_pointer() const noexcept
+	{
+		return wide_pointer_;
+	}
+
+	//Value map or bitmap of the property, nullptr if it has none
+	const event_value_map* get_map() const noexcept
+	{
+		return map_;
+	}
+
+	decode_result<std::wstring> try_to_wstring() const;
+	std::wstring to_wstring() const
+	{
+		return try_to_wstring().value();
+	}
+
+	//Appends the value alone, without type and name.
+	//Returns the number of characters appended.
+	decode_result<std::size_t> try_append_value(std::wstring& result) const;
+
+private:
+	std::uint16_t in_type_;
+	std::uint16_t out_type_;
+	bool wide_pointer_;
+	const std::uint8_t* data_;
+	std::size_t size_;
+	const wchar_t* name_;
+	const event_value_map* map_;
+};
+
 class event_property
 {
 public:
 	using raw_value_type = std::vector<std::uint8_t>;
 
+	//The map, if any, belongs to the event schema and must outlive the property
 	event_property(std::uint16_t in_type, std::uint16_t out_type, bool wide_pointer,
-		raw_value_type&& value, std::wstring&& name) noexcept;
+		raw_value_type&& value, std::wstring&& name, const event_value_map* map = nullptr) noexcept;
 
 	std::uint16_t get_in_type() const noexcept
 	{
@@ -42,7 +121,21 @@ public:
 		return wide_pointer_;
 	}
 
-	std::wstring to_wstring() const;
+	operator event_property_view() const noexcept
+	{
+		return event_property_view(in_type_, out_type_, wide_pointer_,
+			value_.data(), value_.size(), name_.c_str(), map_);
+	}
+
+	decode_result<std::wstring> try_to_wstring() const
+	{
+		return event_property_view(*this).try_to_wstring();
+	}
+
+	std::wstring to_wstring() const
+	{
+		return try_to_wstring().value();
+	}
 
 private:
 	std::uint16_t in_type_;
@@ -50,8 +143,16 @@ private:
 	bool wide_pointer_;
 	raw_value_type value_;
 	std::wstring name_;
+	const event_value_map* map_;
 };
 
+template<typename Stream>
+Stream& operator<<(Stream& stream, const event_property_view& prop)
+{
+	stream << prop.to_wstring();
+	return stream;
+}
+
 template<typename Stream>
 Stream& operator<<(Stream& stream, const event_property& prop)
 {
@@ -68,135 +169,244 @@ template<>
 class event_property_converter<bool>
 {
 public:
-	static bool convert(const event_property& prop);
+	static decode_result<bool> try_convert(const event_property_view& prop);
+	static bool convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::uint64_t>
 {
 public:
-	static std::uint64_t convert(const event_property& prop);
+	static decode_result<std::uint64_t> try_convert(const event_property_view& prop);
+	static std::uint64_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::uint32_t>
 {
 public:
-	static std::uint32_t convert(const event_property& prop);
+	static decode_result<std::uint32_t> try_convert(const event_property_view& prop);
+	static std::uint32_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::uint16_t>
 {
 public:
-	static std::uint16_t convert(const event_property& prop);
+	static decode_result<std::uint16_t> try_convert(const event_property_view& prop);
+	static std::uint16_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::uint8_t>
 {
 public:
-	static std::uint8_t convert(const event_property& prop);
+	static decode_result<std::uint8_t> try_convert(const event_property_view& prop);
+	static std::uint8_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::int64_t>
 {
 public:
-	static std::int64_t convert(const event_property& prop);
+	static decode_result<std::int64_t> try_convert(const event_property_view& prop);
+	static std::int64_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::int32_t>
 {
 public:
-	static std::int32_t convert(const event_property& prop);
+	static decode_result<std::int32_t> try_convert(const event_property_view& prop);
+	static std::int32_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::int16_t>
 {
 public:
-	static std::int16_t convert(const event_property& prop);
+	static decode_result<std::int16_t> try_convert(const event_property_view& prop);
+	static std::int16_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::int8_t>
 {
 public:
-	static std::int8_t convert(const event_property& prop);
+	static decode_result<std::int8_t> try_convert(const event_property_view& prop);
+	static std::int8_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<float>
 {
 public:
-	static float convert(const event_property& prop);
+	static decode_result<float> try_convert(const event_property_view& prop);
+	static float convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<double>
 {
 public:
-	static double convert(const event_property& prop);
+	static decode_result<double> try_convert(const event_property_view& prop);
+	static double convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 struct event_type_size_t {};
 struct event_type_pointer {};
+//FILETIME or SYSTEMTIME value as nanoseconds since the Unix epoch
+struct event_type_unix_nanoseconds {};
+//Value map entry name, or bitmap names separated with '|'
+struct event_type_map_name {};
 
 template<>
 class event_property_converter<event_type_size_t>
 {
 public:
-	static std::uint64_t convert(const event_property& prop);
+	static decode_result<std::uint64_t> try_convert(const event_property_view& prop);
+	static std::uint64_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<event_type_pointer>
 {
 public:
-	static std::uint64_t convert(const event_property& prop);
+	static decode_result<std::uint64_t> try_convert(const event_property_view& prop);
+	static std::uint64_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
+};
+
+template<>
+class event_property_converter<event_type_map_name>
+{
+public:
+	static decode_result<std::wstring> try_convert(const event_property_view& prop);
+	static std::wstring convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<wchar_t>
 {
 public:
-	static wchar_t convert(const event_property& prop);
+	static decode_result<wchar_t> try_convert(const event_property_view& prop);
+	static wchar_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<char>
 {
 public:
-	static char convert(const event_property& prop);
+	static decode_result<char> try_convert(const event_property_view& prop);
+	static char convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::wstring>
 {
 public:
-	static std::wstring convert(const event_property& prop);
+	static decode_result<std::wstring> try_convert(const event_property_view& prop);
+	static std::wstring convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::string>
 {
 public:
-	static std::string convert(const event_property& prop);
+	static decode_result<std::string> try_convert(const event_property_view& prop);
+	static std::string convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
+};
+
+template<>
+class event_property_converter<event_type_unix_nanoseconds>
+{
+public:
+	static decode_result<std::int64_t> try_convert(const event_property_view& prop);
+	static std::int64_t convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<std::chrono::system_clock::time_point>
 {
 public:
-	static std::chrono::system_clock::time_point convert(const event_property& prop);
+	static decode_result<std::chrono::system_clock::time_point> try_convert(const event_property_view& prop);
+	static std::chrono::system_clock::time_point convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
 
 template<>
 class event_property_converter<ms_guid>
 {
 public:
-	static ms_guid convert(const event_property& prop);
+	static decode_result<ms_guid> try_convert(const event_property_view& prop);
+	static ms_guid convert(const event_property_view& prop)
+	{
+		return try_convert(prop).value();
+	}
 };
+
+template<typename T>
+using converter_result_t = decltype(event_property_converter<T>::try_convert(
+	std::declval<const event_property_view&>()));
+
+template<typename T>
+using converter_value_t = typename converter_result_t<T>::value_type;
 } //namespace event_tracing
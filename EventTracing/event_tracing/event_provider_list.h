@@ -12,7 +12,11 @@ class event_provider_list
 public:
 	event_provider_list();
 
+	//Throws for providers which are not registered on the machine
 	const ms_guid& get_guid(const std::wstring& name) const;
+	//EventSource and TraceLogging providers are not registered and
+	//have their GUIDs derived from their names
+	static ms_guid get_event_source_guid(const std::wstring& name);
 	const std::wstring& get_name(const ms_guid& guid) const;
 	bool has_name(const std::wstring& name) const;
 	bool has_guid(const ms_guid& guid) const;
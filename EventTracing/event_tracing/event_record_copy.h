@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+namespace event_tracing
+{
+class event_record_copy
+{
+public:
+	event_record_copy() noexcept;
+	explicit event_record_copy(const EVENT_RECORD& record);
+
+	event_record_copy(const event_record_copy& other);
+	event_record_copy& operator=(const event_record_copy& other);
+	event_record_copy(event_record_copy&& other) noexcept = default;
+	event_record_copy& operator=(event_record_copy&& other) noexcept = default;
+
+	//Reuses already allocated storage when possible
+	void assign(const EVENT_RECORD& record);
+
+	//Serialized records have no pointers, so they can be passed to another process
+	static std::size_t get_serialized_size(const EVENT_RECORD& record) noexcept;
+	static void serialize(const EVENT_RECORD& record, std::uint8_t* data) noexcept;
+
+	//Checks the sizes of a serialized record
+	static bool is_serialized(const std::uint8_t* data, std::size_t size) noexcept;
+	//Returns false if the data is not a serialized record
+	bool assign_serialized(const std::uint8_t* data, std::size_t size);
+
+	PEVENT_RECORD get() noexcept
+	{
+		return &record_;
+	}
+
+	const EVENT_RECORD* get() const noexcept
+	{
+		return &record_;
+	}
+
+	std::int64_t get_timestamp() const noexcept
+	{
+		return record_.EventHeader.TimeStamp.QuadPart;
+	}
+
+private:
+	//Points the record to the data
+	void update_pointers() noexcept;
+
+private:
+	EVENT_RECORD record_;
+	std::vector<std::uint8_t> data_;
+};
+} //namespace event_tracing
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/decode_result.h"
+#include "event_tracing/event_map.h"
+#include "event_tracing/event_message.h"
+
+namespace event_tracing
+{
+class schema_pack;
+
+//Size of a value of the type which does not depend on the payload or
+//pointer size, zero otherwise
+std::size_t get_fixed_type_size(USHORT in_type) noexcept;
+
+//Count property index of an array with PropertyParamCount whose UINT16
+//element count is right before its elements in the payload, as TraceLogging
+//variable arrays have. TDH never refers to this index.
+constexpr const USHORT payload_count_index = 0xffffu;
+
+//Property description unpacked from EVENT_PROPERTY_INFO
+struct event_schema_property
+{
+	const wchar_t* name;
+	const wchar_t* map_name;
+	ULONG flags;
+	USHORT in_type;
+	USHORT out_type;
+	//Fixed count, or index of the property holding it if PropertyParamCount is set
+	USHORT count;
+	//Fixed length, or index of the property holding it if PropertyParamLength is set
+	USHORT length;
+	USHORT struct_start_index;
+	USHORT struct_member_count;
+
+	bool is_struct() const noexcept
+	{
+		return (flags & PropertyStruct) == PropertyStruct;
+	}
+
+	bool has_count_property() const noexcept
+	{
+		return (flags & PropertyParamCount) == PropertyParamCount;
+	}
+
+	bool has_length_property() const noexcept
+	{
+		return (flags & PropertyParamLength) == PropertyParamLength;
+	}
+
+	bool has_payload_count() const noexcept
+	{
+		return has_count_property() && count == payload_count_index;
+	}
+
+	bool is_array() const noexcept
+	{
+		return has_count_property() || (flags & PropertyParamFixedCount) == PropertyParamFixedCount
+			|| count != 1;
+	}
+};
+
+//TRACE_EVENT_INFO of an event, shared by all events of the same kind
+class event_schema
+{
+public:
+	//Value maps of the properties are resolved only if the map cache is given
+	static decode_result<std::shared_ptr<const event_schema>> load(PEVENT_RECORD record,
+		event_map_cache* maps = nullptr);
+
+	explicit event_schema(std::vector<std::uint8_t>&& data);
+	//Value maps by property index, empty if no property has a map
+	event_schema(std::vector<std::uint8_t>&& data,
+		std::vector<std::shared_ptr<const event_value_map>>&& maps);
+
+	//Checks that strings and property indices of a TRACE_EVENT_INFO
+	//obtained elsewhere than TDH stay within its data
+	static bool is_valid(const std::vector<std::uint8_t>& data) noexcept;
+
+	const TRACE_EVENT_INFO* get_info() const noexcept
+	{
+		return reinterpret_cast<const TRACE_EVENT_INFO*>(data_.data());
+	}
+
+	//Size of the TRACE_EVENT_INFO with its strings
+	std::size_t get_info_size() const noexcept
+	{
+		return data_.size();
+	}
+
+	ULONG get_top_level_property_count() const noexcept
+	{
+		return get_info()->TopLevelPropertyCount;
+	}
+
+	std::size_t get_property_count() const noexcept
+	{
+		return properties_.size();
+	}
+
+	const event_schema_property& get_property(std::size_t index) const noexcept
+	{
+		return properties_[index];
+	}
+
+	const event_value_map* get_property_map(std::size_t index) const noexcept
+	{
+		return maps_.empty() ? nullptr : maps_[index].get();
+	}
+
+	const wchar_t* get_event_message() const noexcept
+	{
+		return get_string(get_info()->EventMessageOffset);
+	}
+
+	const event_message_template& get_message_template() const noexcept
+	{
+		return message_;
+	}
+
+	const wchar_t* get_string(ULONG offset) const noexcept
+	{
+		return offset ? reinterpret_cast<const wchar_t*>(data_.data() + offset) : nullptr;
+	}
+
+private:
+	void resolve_maps(PEVENT_RECORD record, event_map_cache& maps);
+
+private:
+	std::vector<std::uint8_t> data_;
+	std::vector<event_schema_property> properties_;
+	std::vector<std::shared_ptr<const event_value_map>> maps_;
+	event_message_template message_;
+};
+
+//Schemas by provider and event descriptor, with value maps of their properties.
+//Schemas are looked up in the schema pack, if set, before TDH.
+//TraceLogging events carry their own layout, so their schemas are parsed
+//from it and cached by provider and metadata bytes instead. Schemas of WPP
+//events are never cached. Not thread-safe.
+class event_schema_cache
+{
+public:
+	decode_result<std::shared_ptr<const event_schema>> get(PEVENT_RECORD record);
+
+	//Adds a schema obtained elsewhere, e.g. forwarded from another host
+	void add(const GUID& provider_id, const EVENT_DESCRIPTOR& descriptor,
+		std::shared_ptr<const event_schema> schema);
+
+	void set_schema_pack(std::shared_ptr<const schema_pack> pack) noexcept
+	{
+		pack_ = std::move(pack);
+	}
+
+	//TraceLogging and WPP events are not cached by their descriptor
+	static bool is_cacheable(const EVENT_RECORD& record) noexcept;
+
+	std::size_t size() const noexcept
+	{
+		return schemas_.size() + tracelogging_schemas_.size();
+	}
+
+	event_map_cache& get_map_cache() noexcept
+	{
+		return maps_;
+	}
+
+	void clear() noexcept
+	{
+		schemas_.clear();
+		tracelogging_schemas_.clear();
+		maps_.clear();
+	}
+
+private:
+	struct key
+	{
+		GUID provider_id;
+		USHORT id;
+		UCHAR version;
+		UCHAR opcode;
+
+		bool operator==(const key& other) const noexcept;
+	};
+
+	struct key_hash
+	{
+		std::size_t operator()(const key& value) const noexcept;
+	};
+
+	struct entry
+	{
+		std::shared_ptr<const event_schema> schema;
+		//Failed lookups are remembered too
+		decode_failure failure;
+	};
+
+	//Events sharing the metadata share the schema, whose descriptor is
+	//the one of the first of them
+	struct tracelogging_entry
+	{
+		GUID provider_id;
+		std::vector<std::uint8_t> metadata;
+		std::shared_ptr<const event_schema> schema;
+		decode_failure failure;
+	};
+
+private:
+	decode_result<std::shared_ptr<const event_schema>> get_tracelogging(const EVENT_RECORD& record,
+		const EVENT_HEADER_EXTENDED_DATA_ITEM& metadata);
+
+private:
+	std::unordered_map<key, entry, key_hash> schemas_;
+	//By hash of the provider and the metadata, entries are compared on lookup
+	std::unordered_multimap<std::uint64_t, tracelogging_entry> tracelogging_schemas_;
+	event_map_cache maps_;
+	std::shared_ptr<const schema_pack> pack_;
+};
+} //namespace event_tracing
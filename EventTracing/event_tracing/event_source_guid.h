@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <Windows.h>
+
+#include "event_tracing/guid_helpers.h"
+
+namespace event_tracing
+{
+namespace detail
+{
+class constexpr_sha1
+{
+public:
+	constexpr constexpr_sha1() noexcept
+		: state_{ 0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u }
+		, block_{}
+		, block_size_(0)
+		, total_size_(0)
+	{
+	}
+
+	constexpr void append(std::uint8_t value) noexcept
+	{
+		block_[block_size_++] = value;
+		++total_size_;
+		if (block_size_ == sizeof(block_))
+			process_block();
+	}
+
+	constexpr void finish(std::uint8_t(&digest)[20]) noexcept
+	{
+		std::uint64_t bit_size = total_size_ * 8u;
+		block_[block_size_++] = 0x80u;
+		if (block_size_ > sizeof(block_) - 8u)
+		{
+			while (block_size_ != sizeof(block_))
+				block_[block_size_++] = 0u;
+
+			process_block();
+		}
+
+		while (block_size_ != sizeof(block_) - 8u)
+			block_[block_size_++] = 0u;
+
+		for (int shift = 56; shift >= 0; shift -= 8)
+			block_[block_size_++] = static_cast<std::uint8_t>(bit_size >> shift);
+
+		process_block();
+		for (std::size_t i = 0; i != 20u; ++i)
+			digest[i] = static_cast<std::uint8_t>(state_[i / 4u] >> (24u - (i % 4u) * 8u));
+	}
+
+private:
+	static constexpr std::uint32_t rotate_left(std::uint32_t value, unsigned int bits) noexcept
+	{
+		return (value << bits) | (value >> (32u - bits));
+	}
+
+	constexpr void process_block() noexcept
+	{
+		std::uint32_t w[80]{};
+		for (std::size_t i = 0; i != 16u; ++i)
+		{
+			w[i] = (static_cast<std::uint32_t>(block_[i * 4u]) << 24u)
+				| (static_cast<std::uint32_t>(block_[i * 4u + 1u]) << 16u)
+				| (static_cast<std::uint32_t>(block_[i * 4u + 2u]) << 8u)
+				| static_cast<std::uint32_t>(block_[i * 4u + 3u]);
+		}
+
+		for (std::size_t i = 16u; i != 80u; ++i)
+			w[i] = rotate_left(w[i - 3u] ^ w[i - 8u] ^ w[i - 14u] ^ w[i - 16u], 1u);
+
+		std::uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3], e = state_[4];
+		for (std::size_t i = 0; i != 80u; ++i)
+		{
+			std::uint32_t f = 0u, k = 0u;
+			if (i < 20u)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5A827999u;
+			}
+			else if (i < 40u)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1u;
+			}
+			else if (i < 60u)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDCu;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6u;
+			}
+
+			std::uint32_t temp = rotate_left(a, 5u) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = rotate_left(b, 30u);
+			b = a;
+			a = temp;
+		}
+
+		state_[0] += a;
+		state_[1] += b;
+		state_[2] += c;
+		state_[3] += d;
+		state_[4] += e;
+		block_size_ = 0;
+	}
+
+private:
+	std::uint32_t state_[5];
+	std::uint8_t block_[64];
+	std::size_t block_size_;
+	std::uint64_t total_size_;
+};
+
+constexpr wchar_t to_upper_ascii(wchar_t value) noexcept
+{
+	return value >= L'a' && value <= L'z' ? static_cast<wchar_t>(value - (L'a' - L'A')) : value;
+}
+
+//Uppercases ASCII characters of the name if uppercase_ascii is set, otherwise
+//hashes it as it is, already uppercased by the caller
+constexpr GUID make_event_source_guid(const wchar_t* name, std::size_t length, bool uppercase_ascii) noexcept
+{
+	constexpr_sha1 hash;
+	constexpr std::uint8_t event_source_namespace[16] = { 0x48, 0x2C, 0x2D, 0xB2, 0xC3, 0x90, 0x47, 0xC8,
+		0x87, 0xF8, 0x1A, 0x15, 0xBF, 0xC1, 0x30, 0xFB };
+	for (auto value : event_source_namespace)
+		hash.append(value);
+
+	for (std::size_t i = 0; i != length; ++i)
+	{
+		auto value = static_cast<std::uint16_t>(uppercase_ascii ? to_upper_ascii(name[i]) : name[i]);
+		hash.append(static_cast<std::uint8_t>(value >> 8u));
+		hash.append(static_cast<std::uint8_t>(value));
+	}
+
+	std::uint8_t digest[20]{};
+	hash.finish(digest);
+	digest[7] = static_cast<std::uint8_t>((digest[7] & 0x0Fu) | 0x50u);
+
+	GUID result{};
+	result.Data1 = static_cast<unsigned long>(digest[0]) | (static_cast<unsigned long>(digest[1]) << 8u)
+		| (static_cast<unsigned long>(digest[2]) << 16u) | (static_cast<unsigned long>(digest[3]) << 24u);
+	result.Data2 = static_cast<unsigned short>(digest[4] | (digest[5] << 8u));
+	result.Data3 = static_cast<unsigned short>(digest[6] | (digest[7] << 8u));
+	for (std::size_t i = 0; i != 8u; ++i)
+		result.Data4[i] = digest[8u + i];
+
+	return result;
+}
+} //namespace detail
+
+//GUID of EventSource and TraceLogging providers which do not specify one explicitly.
+//Constant expression version only uppercases ASCII characters.
+template<std::size_t Size>
+constexpr GUID make_event_source_guid(const wchar_t(&name)[Size]) noexcept
+{
+	return detail::make_event_source_guid(name, Size - 1u, true);
+}
+
+ms_guid get_event_source_guid(const std::wstring& name);
+} //namespace event_tracing
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <boost/optional.hpp>
 #include <boost/signals2.hpp>
@@ -16,11 +23,68 @@
 #include <Evntrace.h>
 
 #include "event_tracing/guid_helpers.h"
+#include "event_tracing/event_filter.h"
+#include "event_tracing/event_record_copy.h"
 #include "event_tracing/event_trace_handle.h"
+#include "event_tracing/loss_tracker.h"
+#include "event_tracing/metrics_registry.h"
+#include "event_tracing/overload_controller.h"
+#include "event_tracing/priority_lanes.h"
+#include "event_tracing/reorder_buffer.h"
+#include "event_tracing/shared_ring_event_source.h"
+#include "event_tracing/timestamp_merger.h"
 
 namespace event_tracing
 {
 class event_trace_session;
+
+class event_trace_input
+{
+public:
+	static event_trace_input real_time_session(const event_trace_session& session);
+	static event_trace_input real_time_session(const std::wstring& session_name);
+	static event_trace_input log_file(const std::wstring& file_name);
+	//Events published by shared_ring_publisher in another process.
+	//Can not be combined with session and log file inputs.
+	static event_trace_input shared_ring(const std::string& ring_name);
+
+	const std::wstring& get_name() const noexcept
+	{
+		return name_;
+	}
+
+	const std::string& get_ring_name() const noexcept
+	{
+		return ring_name_;
+	}
+
+	bool is_real_time() const noexcept
+	{
+		return real_time_;
+	}
+
+	bool is_shared_ring() const noexcept
+	{
+		return !ring_name_.empty();
+	}
+
+private:
+	event_trace_input(const std::wstring& name, bool real_time);
+	explicit event_trace_input(const std::string& ring_name);
+
+	std::wstring name_;
+	bool real_time_;
+	std::string ring_name_;
+};
+
+//Dispatch lane of events when priority dispatch is enabled
+enum class event_priority
+{
+	high,
+	normal,
+	bulk
+};
+
 class event_trace
 {
 public:
@@ -30,10 +94,34 @@ public:
 	using error_processor_signal = boost::signals2::signal<error_processor>;
 	using stop_processor = void();
 	using stop_processor_signal = boost::signals2::signal<stop_processor>;
+	using late_event_processor = void(PEVENT_RECORD record);
+	using late_event_processor_signal = boost::signals2::signal<late_event_processor>;
+	using shed_event_processor = void(const ms_guid& trace_provider, USHORT event_id,
+		std::uint64_t seen_count, std::uint64_t admitted_count);
+	using shed_event_processor_signal = boost::signals2::signal<shed_event_processor>;
+	using shed_record_processor = void(PEVENT_RECORD record);
+	using shed_record_processor_signal = boost::signals2::signal<shed_record_processor>;
+
+	//One second in event timestamp units
+	static constexpr const std::int64_t default_merge_lookahead = 10000000;
+	static constexpr const std::chrono::milliseconds::rep default_merge_idle_timeout = 1000;
+	static constexpr const std::size_t default_merge_stream_capacity = 65536;
+	static constexpr const std::size_t default_max_bypass_count = 256;
+	static constexpr const std::chrono::milliseconds::rep default_reorder_max_delay = 100;
 
 public:
 	explicit event_trace(const event_trace_session& session);
 
+	//Events of several inputs are delivered as a single stream ordered by timestamp.
+	//An input which has delivered nothing for merge_idle_timeout does not hold
+	//back the others; such events are dispatched on a timer thread, but never
+	//concurrently with other events. When an input has merge_stream_capacity
+	//events queued, events are released early to make room.
+	explicit event_trace(const std::vector<event_trace_input>& inputs,
+		std::int64_t merge_lookahead = default_merge_lookahead,
+		std::chrono::milliseconds merge_idle_timeout = std::chrono::milliseconds(default_merge_idle_timeout),
+		std::size_t merge_stream_capacity = default_merge_stream_capacity);
+
 	event_trace(const event_trace&) = delete;
 	event_trace& operator=(const event_trace&) = delete;
 
@@ -64,12 +152,95 @@ public:
 		return on_provider_event_[{ trace_provider, event_id }].connect(std::forward<Handler>(handler));
 	}
 
+	//Events of the provider are dispatched at least with the given priority
+	template<typename Handler>
+	boost::signals2::connection on_trace_event(const ms_guid& trace_provider,
+		event_priority priority, Handler&& handler)
+	{
+		set_priority(trace_provider, priority);
+		return on_trace_event(trace_provider, std::forward<Handler>(handler));
+	}
+
+	template<typename Handler>
+	boost::signals2::connection on_trace_event(const ms_guid& trace_provider,
+		USHORT event_id, event_priority priority, Handler&& handler)
+	{
+		set_priority(trace_provider, event_id, priority);
+		return on_trace_event(trace_provider, event_id, std::forward<Handler>(handler));
+	}
+
+	template<typename Handler>
+	boost::signals2::connection on_trace_event(const event_filter& filter, Handler&& handler)
+	{
+		on_filtered_event_.emplace_back(filter);
+		return on_filtered_event_.back().signal.connect(std::forward<Handler>(handler));
+	}
+
 	template<typename Handler>
 	boost::signals2::connection on_stop_trace(Handler&& handler)
 	{
 		return on_stop_trace_.connect(std::forward<Handler>(handler));
 	}
 
+	//Called for events which arrived after a later event had already been
+	//dispatched; such events are still dispatched right after this signal
+	template<typename Handler>
+	boost::signals2::connection on_late_event(Handler&& handler)
+	{
+		return on_late_event_.connect(std::forward<Handler>(handler));
+	}
+
+	//Called with exact event counts of every class which had events shed,
+	//when the overload ends and when the trace stops
+	template<typename Handler>
+	boost::signals2::connection on_events_shed(Handler&& handler)
+	{
+		return on_events_shed_.connect(std::forward<Handler>(handler));
+	}
+
+	//Called with every shed event before it is dropped, on the trace thread,
+	//concurrently with the dispatched event handlers
+	template<typename Handler>
+	boost::signals2::connection on_shed_event(Handler&& handler)
+	{
+		return on_shed_event_.connect(std::forward<Handler>(handler));
+	}
+
+	//Events are delayed by up to time_window (in event timestamp units)
+	//or max_event_count events and dispatched in timestamp order. No event
+	//is held much longer than max_delay, events held that long are released
+	//on a timer thread when the trace is quiet, never concurrently with
+	//other events. Must be called before the trace is run.
+	void enable_reordering(std::int64_t time_window, std::size_t max_event_count,
+		std::chrono::milliseconds max_delay = std::chrono::milliseconds(default_reorder_max_delay));
+
+	//Events are queued in per-priority lanes of lane_capacity events and
+	//dispatched on a separate thread, higher priorities first. After
+	//max_bypass_count events dispatched ahead of the oldest queued one,
+	//the oldest one is dispatched. Events of the same process are always
+	//dispatched in order. Events without declared priority are normal.
+	//Late event and error handlers are still called on the trace thread.
+	//Must be called before the trace is run.
+	void enable_priority_dispatch(std::size_t lane_capacity,
+		std::size_t max_bypass_count = default_max_bypass_count);
+
+	//Samples sheddable events when the priority dispatch queue depth or
+	//dispatch lag reaches the policy limits. Has no effect without priority
+	//dispatch. High priority events are never shed.
+	//Must be called before the trace is run.
+	void enable_overload_control(const overload_policy& policy);
+	void set_sheddable(const ms_guid& trace_provider, USHORT event_id);
+
+	//Registers event rate, queue and error metrics of the trace.
+	//The registry must outlive the trace. Must be called before the trace is run.
+	void enable_metrics(metrics_registry& registry);
+
+	//Events of every input, including lost event notifications and log file
+	//headers, are counted in the tracker as they arrive, pending sequence
+	//gaps are counted as lost when the trace stops. The tracker must outlive
+	//the trace. Must be called before the trace is run.
+	void enable_loss_accounting(loss_tracker& tracker);
+
 	void run_async();
 	void run();
 	void stop();
@@ -77,11 +248,61 @@ public:
 private:
 	void open_trace();
 	void start_monitoring(bool throw_error);
+	ULONG read_shared_rings() noexcept;
 
 	static void __stdcall static_process_trace_event(PEVENT_RECORD record);
-	void process_trace_event(PEVENT_RECORD record, std::uint32_t error) noexcept;
+	void process_trace_event(std::size_t input_index, PEVENT_RECORD record) noexcept;
+	void process_trace_error(std::uint32_t error) noexcept;
+	void schedule_event(PEVENT_RECORD record) noexcept;
+	void dispatch_event(PEVENT_RECORD record) noexcept;
+	void run_dispatcher() noexcept;
+	void stop_dispatcher() noexcept;
+	bool admit_event(const EVENT_RECORD& record, event_priority priority) noexcept;
+	void report_shed_events() noexcept;
+	void observe_loss(std::size_t input_index, const EVENT_RECORD& record) noexcept;
+	void flush_loss_accounting() noexcept;
+	void reorder_event(event_record_copy& record) noexcept;
+	void dispatch_ordered_event(event_record_copy& record, bool is_late) noexcept;
+	void flush_buffered_events() noexcept;
+	void set_release_period(std::chrono::milliseconds hold_time) noexcept;
+	void release_held_events() noexcept;
+	void run_release_timer() noexcept;
+	void stop_release_timer() noexcept;
+
+	event_record_copy acquire_record(const EVENT_RECORD& record);
+	void release_record(event_record_copy&& record) noexcept;
+
+	void set_priority(const ms_guid& trace_provider, event_priority priority);
+	void set_priority(const ms_guid& trace_provider, USHORT event_id, event_priority priority);
+	event_priority get_priority(const EVENT_RECORD& record) const noexcept;
 
 private:
+	struct queued_event
+	{
+		event_record_copy record;
+		event_priority priority;
+		std::chrono::steady_clock::time_point queued_at;
+	};
+
+	struct trace_metrics
+	{
+		metric_counter* received;
+		metric_counter* dispatched;
+		metric_counter* late;
+		metric_counter* shed;
+		metric_counter* lost;
+		metric_counter* handler_errors;
+		metric_gauge* queue_depth;
+		//Queueing time in microseconds by priority
+		metric_histogram* queue_time[static_cast<std::size_t>(event_priority::bulk) + 1u];
+	};
+
+	struct input_context
+	{
+		event_trace* trace;
+		std::size_t index;
+	};
+
 	struct event_key
 	{
 		event_key(const ms_guid& guid)
@@ -105,12 +326,56 @@ private:
 		boost::optional<USHORT> event_id;
 	};
 
-	std::wstring session_name_;
+	struct filtered_event_processor
+	{
+		explicit filtered_event_processor(const event_filter& filter)
+			: filter(filter)
+		{
+		}
+
+		event_filter filter;
+		event_processor_signal signal;
+	};
+
+	std::vector<event_trace_input> inputs_;
+	std::vector<input_context> input_contexts_;
 	event_processor_signal on_event_;
 	error_processor_signal on_error_;
 	stop_processor_signal on_stop_trace_;
+	late_event_processor_signal on_late_event_;
+	shed_event_processor_signal on_events_shed_;
+	shed_record_processor_signal on_shed_event_;
 	std::map<event_key, event_processor_signal> on_provider_event_;
-	event_trace_handle trace_handle_;
+	std::list<filtered_event_processor> on_filtered_event_;
+	std::vector<event_trace_handle> trace_handles_;
+	std::vector<std::unique_ptr<shared_ring_event_source>> ring_sources_;
+	std::atomic<bool> rings_stopped_{ false };
+	//Lost counts of shared rings already reported, by ring
+	std::vector<std::uint64_t> ring_lost_counts_;
+	std::unique_ptr<timestamp_merger<event_record_copy>> merger_;
+	std::unique_ptr<reorder_buffer<event_record_copy>> reorder_buffer_;
+	std::vector<event_record_copy> free_records_;
+	//Held events are released on the trace thread as events arrive and on the
+	//release timer thread when inputs go quiet
+	std::mutex buffers_mutex_;
+	std::condition_variable release_timer_changed_;
+	std::chrono::milliseconds release_period_{ 0 };
+	bool release_timer_stopped_ = false;
+	std::thread release_timer_;
+	std::map<event_key, event_priority> priorities_;
+	std::unique_ptr<priority_lanes<queued_event>> lanes_;
+	std::mutex lanes_mutex_;
+	std::condition_variable lanes_changed_;
+	//Time the last dispatched event has been queued for, in nanoseconds
+	std::atomic<std::int64_t> dispatch_lag_{ 0 };
+	std::unique_ptr<overload_controller> overload_;
+	std::map<event_key, std::size_t> shed_classes_;
+	std::vector<event_key> shed_class_keys_;
+	std::vector<std::uint64_t> reported_shed_counts_;
+	std::unique_ptr<trace_metrics> metrics_;
+	loss_tracker* loss_ = nullptr;
+	bool dispatcher_stopped_ = false;
+	std::thread dispatcher_;
 	std::thread event_processor_;
 	std::atomic_flag started_ = ATOMIC_FLAG_INIT;
 };
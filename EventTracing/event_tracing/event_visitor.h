@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "event_tracing/decode_result.h"
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_property.h"
+#include "event_tracing/event_schema.h"
+
+namespace event_tracing
+{
+//Receives event properties in payload order. Every array element of a struct
+//array is reported as a separate begin_struct()/end_struct() pair.
+//Views passed to value() are valid only during the call.
+class event_visitor
+{
+public:
+	virtual ~event_visitor() = default;
+
+	virtual void begin_struct(const wchar_t* /*name*/)
+	{
+	}
+
+	virtual void end_struct()
+	{
+	}
+
+	virtual void begin_array(const wchar_t* /*name*/, ULONG /*size*/)
+	{
+	}
+
+	virtual void end_array()
+	{
+	}
+
+	virtual void value(const event_property_view& /*prop*/)
+	{
+	}
+};
+
+//Walks the whole event payload once, without per-property TDH calls.
+//Returns the number of payload bytes consumed. String-only events are
+//reported as a single string value.
+decode_result<ULONG> visit_event(const event_info& info, event_visitor& visitor);
+
+//Same for a non string-only event with an already known schema
+decode_result<ULONG> visit_event(const event_schema& schema, const EVENT_RECORD& record,
+	event_visitor& visitor);
+
+//Stops after the first top_level_property_count top-level properties
+decode_result<ULONG> visit_event(const event_schema& schema, const EVENT_RECORD& record,
+	event_visitor& visitor, ULONG top_level_property_count);
+} //namespace event_tracing
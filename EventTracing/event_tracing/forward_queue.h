@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace event_tracing
+{
+//FIFO of encoded batches waiting for acknowledgement. Batches are kept in
+//memory up to a limit and written to a circular spill file beyond it; once
+//a batch is spilled, later batches are spilled too until the file is drained,
+//so the order is kept. The spill file is emptied when the queue is created.
+//Thread-safe.
+class forward_queue
+{
+public:
+	//No batches are spilled if the file name is empty
+	forward_queue(std::size_t max_memory_size, const std::string& spill_file_name,
+		std::uint64_t max_spill_size);
+
+	forward_queue(const forward_queue&) = delete;
+	forward_queue& operator=(const forward_queue&) = delete;
+
+	//Sequence numbers must increase. Returns false if the batch is dropped
+	//because both limits are reached.
+	bool push(std::uint64_t sequence, std::vector<std::uint8_t>&& batch);
+
+	//Copies the batch at the index from the front, returns false if there is none
+	bool get(std::size_t index, std::vector<std::uint8_t>& batch);
+
+	//Removes batches up to the sequence number, returns the number removed
+	std::size_t acknowledge(std::uint64_t sequence);
+
+	std::size_t size() const;
+	std::size_t get_memory_size() const;
+	std::uint64_t get_spill_size() const;
+
+private:
+	struct spilled_batch
+	{
+		std::uint64_t sequence;
+		//Position in the spill file is the offset modulo the maximum spill size
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+private:
+	void open_spill_file();
+	bool write_spill(std::uint64_t offset, const std::uint8_t* data, std::uint64_t size);
+	bool read_spill(std::uint64_t offset, std::uint8_t* data, std::uint64_t size);
+
+private:
+	mutable std::mutex mutex_;
+	std::size_t max_memory_size_;
+	std::string spill_file_name_;
+	std::uint64_t max_spill_size_;
+	std::deque<std::pair<std::uint64_t, std::vector<std::uint8_t>>> memory_batches_;
+	std::size_t memory_size_ = 0;
+	std::deque<spilled_batch> spilled_batches_;
+	std::fstream spill_file_;
+	std::uint64_t spill_end_ = 0;
+};
+} //namespace event_tracing
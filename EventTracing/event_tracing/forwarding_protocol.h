@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace event_tracing
+{
+//Frames of the event forwarding protocol. Every frame starts with a header,
+//followed by the payload, which may be compressed. Integers are little endian.
+enum class forward_frame_type : std::uint8_t
+{
+	//Forwarder to collector, the payload is the host id of the forwarder
+	hello = 1,
+	//Forwarder to collector, the payload is a sequence of batch entries
+	batch = 2,
+	//Collector to forwarder, all batches up to the sequence number are processed.
+	//Also the reply to hello with the last batch received from the host.
+	ack = 3
+};
+
+struct forward_frame_header
+{
+	std::uint32_t magic;
+	std::uint8_t type;
+	std::uint8_t flags;
+	std::uint16_t reserved;
+	//Size of the payload in the frame
+	std::uint32_t size;
+	//Size of the payload after decompression
+	std::uint32_t raw_size;
+	//Batch sequence number, starting with 1
+	std::uint64_t sequence;
+};
+
+//Batch entries are a type byte and a 32-bit data size followed by the data
+enum class forward_entry_type : std::uint8_t
+{
+	//Provider GUID, EVENT_DESCRIPTOR and TRACE_EVENT_INFO of the following records
+	schema = 1,
+	//Serialized event record
+	record = 2
+};
+
+constexpr const std::uint32_t forward_frame_magic = 0x46575445u;
+constexpr const std::uint8_t forward_frame_compressed = 1;
+constexpr const std::size_t max_forward_frame_size = 64 * 1024 * 1024;
+constexpr const std::size_t forward_entry_header_size = 5;
+
+//Appends a frame; the payload is compressed if that makes it smaller
+void append_forward_frame(std::vector<std::uint8_t>& frame, forward_frame_type type,
+	std::uint64_t sequence, const std::uint8_t* payload, std::size_t size, bool compress);
+
+bool is_valid_forward_frame(const forward_frame_header& header) noexcept;
+
+//Throws event_trace_error if the payload can not be decompressed
+void get_forward_frame_payload(const forward_frame_header& header, const std::uint8_t* data,
+	std::vector<std::uint8_t>& payload);
+
+//Appends the header of a batch entry with the data size
+void append_forward_entry(std::vector<std::uint8_t>& batch, forward_entry_type type,
+	std::size_t size);
+} //namespace event_tracing
@@ -13,11 +13,20 @@ public:
 	static constexpr const std::size_t size = sizeof(GUID);
 
 public:
+	//Null GUID
+	constexpr ms_guid() noexcept
+		: guid_{}
+	{
+	}
+
 	ms_guid(const std::wstring& str);
 	ms_guid(const wchar_t* str);
-	ms_guid(const GUID& guid) noexcept;
+	constexpr ms_guid(const GUID& guid) noexcept
+		: guid_(guid)
+	{
+	}
 
-	const GUID& native() const noexcept
+	constexpr const GUID& native() const noexcept
 	{
 		return guid_;
 	}
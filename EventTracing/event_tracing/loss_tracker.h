@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/guid_helpers.h"
+#include "event_tracing/metrics_registry.h"
+
+namespace event_tracing
+{
+//Loss indications of a trace input
+struct loss_counters
+{
+	std::uint64_t received = 0;
+	//Sequence numbers not seen within the reorder window
+	std::uint64_t sequence_gap_events = 0;
+	//Sequence numbers seen after later ones, but within the reorder window
+	std::uint64_t reordered_events = 0;
+	std::uint64_t duplicate_events = 0;
+	//Sequence numbers far behind the last seen ones, e.g. of a restarted session
+	std::uint64_t sequence_restarts = 0;
+	//RTLostEvent, RTLostBuffer and RTLostFile notifications of real-time sessions
+	std::uint64_t lost_event_notifications = 0;
+	std::uint64_t lost_buffer_notifications = 0;
+	std::uint64_t lost_file_notifications = 0;
+	//Reported by the log file header event
+	std::uint64_t header_events_lost = 0;
+	std::uint64_t header_buffers_lost = 0;
+	//Overwritten in shared rings before they were read
+	std::uint64_t ring_events_lost = 0;
+
+	//Sum of the events known to be lost, notifications do not tell how many
+	std::uint64_t get_lost_count() const noexcept
+	{
+		return sequence_gap_events + header_events_lost + ring_events_lost;
+	}
+
+	bool has_loss() const noexcept
+	{
+		return get_lost_count() || lost_event_notifications || lost_buffer_notifications
+			|| lost_file_notifications || header_buffers_lost;
+	}
+
+	loss_counters& operator+=(const loss_counters& other) noexcept;
+};
+
+struct provider_loss_counters
+{
+	std::uint64_t received = 0;
+	//Events referring to state whose start has not been seen, e.g. threads
+	//of processes whose start event was lost
+	std::uint64_t orphaned_events = 0;
+};
+
+struct loss_report
+{
+	//Timestamps of the first and the last event of the interval, zero if there were none
+	std::int64_t begin_timestamp = 0;
+	std::int64_t end_timestamp = 0;
+	//By input index
+	std::vector<loss_counters> inputs;
+	std::map<ms_guid, provider_loss_counters> providers;
+
+	loss_counters get_total() const noexcept;
+	std::uint64_t get_orphaned_count() const noexcept;
+
+	bool has_loss() const noexcept
+	{
+		return get_total().has_loss() || get_orphaned_count();
+	}
+};
+
+std::wostream& operator<<(std::wostream& stream, const loss_report& report);
+
+//Counts lost, reordered and orphaned events of trace inputs, cumulatively
+//and per report interval. Sequence numbers are session-wide, so they are
+//tracked per input. Real-time sessions deliver events of different
+//processors out of order, a sequence number is counted as lost only when
+//reorder_window later ones have been seen or on flush. Thread-safe.
+class loss_tracker
+{
+public:
+	static constexpr const std::uint64_t default_reorder_window = 65536;
+	//Older gaps are counted as lost once there are more pending ones
+	static constexpr const std::size_t max_pending_gap_count = 4096;
+
+public:
+	explicit loss_tracker(std::uint64_t reorder_window = default_reorder_window);
+
+	loss_tracker(const loss_tracker&) = delete;
+	loss_tracker& operator=(const loss_tracker&) = delete;
+
+	//Counts the event, its sequence number if it has one, lost event
+	//notifications and log file header statistics
+	void observe(std::size_t input_index, const EVENT_RECORD& record);
+	void observe_sequence(std::size_t input_index, std::uint64_t sequence_number);
+
+	void add_lost_events(std::size_t input_index, std::uint64_t count);
+	void add_orphaned_event(const EVENT_RECORD& record);
+	//Totals reported by a log file header, of which only the increase is counted
+	void set_header_losses(std::size_t input_index, std::uint64_t events_lost,
+		std::uint64_t buffers_lost);
+
+	//Counts all pending gaps as lost, e.g. when the trace stops
+	void flush();
+
+	//Counts since the previous report, the next interval starts
+	loss_report take_report();
+	loss_report get_totals() const;
+
+	//Registers loss counters. The registry must outlive the tracker.
+	void enable_metrics(metrics_registry& registry);
+
+private:
+	struct sequence_state
+	{
+		bool started = false;
+		//Numbers below the first seen one are reordered until the window passes
+		std::uint64_t lowest = 0;
+		std::uint64_t highest = 0;
+		//Missing sequence number ranges by their first number, with their last one
+		std::map<std::uint64_t, std::uint64_t> gaps;
+	};
+
+	struct tracker_metrics
+	{
+		metric_counter* sequence_gap_events;
+		metric_counter* reordered_events;
+		metric_counter* lost_notifications[3];
+		metric_counter* header_events_lost;
+		metric_counter* header_buffers_lost;
+		metric_counter* orphaned_events;
+	};
+
+private:
+	template<typename Update>
+	void update_input(std::size_t input_index, Update&& update);
+	template<typename Update>
+	void update_provider(const GUID& provider_id, Update&& update);
+
+	void observe_sequence_locked(std::size_t input_index, std::uint64_t sequence_number);
+	void observe_header(std::size_t input_index, const EVENT_RECORD& record);
+	void set_header_losses_locked(std::size_t input_index, std::uint64_t events_lost,
+		std::uint64_t buffers_lost);
+	void expire_gaps(std::size_t input_index, sequence_state& state, bool all);
+	void add_gap_events(std::size_t input_index, std::uint64_t count);
+	void add_timestamp(std::int64_t timestamp) noexcept;
+
+private:
+	std::uint64_t reorder_window_;
+	mutable std::mutex mutex_;
+	std::vector<sequence_state> sequences_;
+	//Last totals reported by log file headers, by input index
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> header_losses_;
+	loss_report interval_;
+	loss_report totals_;
+	std::unique_ptr<tracker_metrics> metrics_;
+};
+} //namespace event_tracing
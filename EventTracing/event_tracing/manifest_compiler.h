@@ -0,0 +1,40 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "event_tracing/schema_pack.h"
+
+namespace event_tracing
+{
+//Compiles instrumentation manifests into the TRACE_EVENT_INFO and
+//EVENT_MAP_INFO layouts TDH returns for registered providers, so events can
+//be decoded where the manifests are not installed. Messages are taken from
+//the en-US resources of the manifest, or the first ones if there are none.
+class manifest_compiler
+{
+public:
+	//Throws event_trace_error if the manifest can not be parsed or refers
+	//to undefined templates, maps, strings or event attributes
+	void add_manifest(std::istream& stream);
+	void add_manifest_file(const std::string& file_name);
+
+	const std::vector<schema_pack_event>& get_events() const noexcept
+	{
+		return events_;
+	}
+
+	const std::vector<schema_pack_map>& get_maps() const noexcept
+	{
+		return maps_;
+	}
+
+	//Throws event_trace_error if the file can not be written
+	void write_schema_pack(const std::string& file_name) const;
+
+private:
+	std::vector<schema_pack_event> events_;
+	std::vector<schema_pack_map> maps_;
+};
+} //namespace event_tracing
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+
+#include "event_tracing/metrics_registry.h"
+
+namespace event_tracing
+{
+//Serves GET /metrics of the registry in the Prometheus text format over
+//HTTP on the loopback interface
+class metrics_endpoint
+{
+public:
+	//Throws event_trace_error if the port can not be opened
+	metrics_endpoint(const metrics_registry& registry, unsigned short port);
+	~metrics_endpoint();
+
+	metrics_endpoint(const metrics_endpoint&) = delete;
+	metrics_endpoint& operator=(const metrics_endpoint&) = delete;
+
+	unsigned short get_port() const noexcept;
+
+	void run_async();
+	void stop();
+
+private:
+	class server;
+
+private:
+	std::unique_ptr<server> server_;
+	std::thread server_thread_;
+};
+} //namespace event_tracing
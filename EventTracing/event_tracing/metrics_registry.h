@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace event_tracing
+{
+//Metric values are split into shards, each thread updates its own shard,
+//so increments from different threads do not contend for a cache line
+//as long as there are no more threads than shards
+constexpr const std::size_t metric_shard_count = 32;
+
+inline std::size_t get_metric_shard() noexcept
+{
+	static std::atomic<std::size_t> next_shard{ 0 };
+	thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed)
+		% metric_shard_count;
+	return shard;
+}
+
+class metric_counter
+{
+public:
+	metric_counter();
+
+	metric_counter(const metric_counter&) = delete;
+	metric_counter& operator=(const metric_counter&) = delete;
+
+	void increment(std::uint64_t value = 1) noexcept
+	{
+		cells_[get_metric_shard() * cell_stride].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	//Sum of all shards
+	std::uint64_t get_value() const noexcept;
+
+private:
+	//Shards are two cache lines apart
+	static constexpr const std::size_t cell_stride = 16;
+
+	std::unique_ptr<std::atomic<std::uint64_t>[]> cells_;
+};
+
+class metric_gauge
+{
+public:
+	void set(std::int64_t value) noexcept
+	{
+		value_.store(value, std::memory_order_relaxed);
+	}
+
+	void add(std::int64_t value) noexcept
+	{
+		value_.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	std::int64_t get_value() const noexcept
+	{
+		return value_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<std::int64_t> value_{ 0 };
+};
+
+class metric_histogram
+{
+public:
+	struct snapshot
+	{
+		//Cumulative counts of values not greater than each bound, then all values
+		std::vector<std::uint64_t> bucket_counts;
+		std::uint64_t sum = 0;
+	};
+
+public:
+	//Bounds must be ascending
+	explicit metric_histogram(const std::vector<std::uint64_t>& bounds);
+
+	metric_histogram(const metric_histogram&) = delete;
+	metric_histogram& operator=(const metric_histogram&) = delete;
+
+	void observe(std::uint64_t value) noexcept
+	{
+		std::size_t bucket = 0;
+		while (bucket != bounds_.size() && value > bounds_[bucket])
+			++bucket;
+
+		auto shard = cells_.get() + get_metric_shard() * stride_;
+		shard[bucket].fetch_add(1, std::memory_order_relaxed);
+		shard[bounds_.size() + 1u].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	const std::vector<std::uint64_t>& get_bounds() const noexcept
+	{
+		return bounds_;
+	}
+
+	snapshot get_snapshot() const;
+
+private:
+	std::vector<std::uint64_t> bounds_;
+	//Bucket counts and the sum of each shard
+	std::size_t stride_;
+	std::unique_ptr<std::atomic<std::uint64_t>[]> cells_;
+};
+
+//Named metrics, aggregated when read. Metrics are registered once and
+//live as long as the registry; registration and reading are thread-safe.
+class metrics_registry
+{
+public:
+	//Labels are written as is, e.g. lane="high"
+	metric_counter& add_counter(const std::string& name, const std::string& help,
+		const std::string& labels = std::string());
+	metric_gauge& add_gauge(const std::string& name, const std::string& help,
+		const std::string& labels = std::string());
+	metric_histogram& add_histogram(const std::string& name, const std::string& help,
+		const std::vector<std::uint64_t>& bounds, const std::string& labels = std::string());
+
+	//Appends all metrics in the Prometheus text exposition format
+	void write_text(std::string& result) const;
+	std::string get_text() const
+	{
+		std::string result;
+		write_text(result);
+		return result;
+	}
+
+private:
+	enum class metric_type
+	{
+		counter,
+		gauge,
+		histogram
+	};
+
+	struct metric
+	{
+		metric_type type;
+		std::string name;
+		std::string help;
+		std::string labels;
+		std::unique_ptr<metric_counter> counter;
+		std::unique_ptr<metric_gauge> gauge;
+		std::unique_ptr<metric_histogram> histogram;
+	};
+
+private:
+	metric& add_metric(metric_type type, const std::string& name, const std::string& help,
+		const std::string& labels);
+
+	static const char* get_type_name(metric_type type) noexcept;
+
+private:
+	mutable std::mutex mutex_;
+	std::vector<std::unique_ptr<metric>> metrics_;
+};
+} //namespace event_tracing
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace event_tracing
+{
+struct overload_policy
+{
+	//Shedding steps up while either high mark is reached
+	//and steps down while both loads are at or below the low marks
+	std::size_t queue_depth_high = 8192;
+	std::size_t queue_depth_low = 1024;
+	std::chrono::nanoseconds lag_high = std::chrono::milliseconds(500);
+	std::chrono::nanoseconds lag_low = std::chrono::milliseconds(100);
+	//At level n one of 2^n events of each sheddable class is admitted
+	unsigned max_level = 6;
+	//Events observed between level changes
+	std::size_t level_interval = 1024;
+};
+
+//Decides which events of sheddable classes are admitted under overload.
+//Events of a class are sampled deterministically, every 2^level-th one
+//is admitted, and all of them are counted exactly. The controller has no
+//clock, the load is passed in with every observed event.
+class overload_controller
+{
+public:
+	struct class_counters
+	{
+		std::uint64_t seen = 0;
+		std::uint64_t admitted = 0;
+	};
+
+public:
+	explicit overload_controller(const overload_policy& policy);
+
+	//Returns the index of a new sheddable event class
+	std::size_t add_class();
+
+	std::size_t get_class_count() const noexcept
+	{
+		return counters_.size();
+	}
+
+	const class_counters& get_counters(std::size_t event_class) const noexcept
+	{
+		return counters_[event_class];
+	}
+
+	unsigned get_level() const noexcept
+	{
+		return level_;
+	}
+
+	//Number of events seen per one admitted at the current level
+	std::uint64_t get_sampling_rate() const noexcept
+	{
+		return std::uint64_t(1) << level_;
+	}
+
+	//Called for every event, returns true if the level has changed
+	bool observe(std::size_t queue_depth, std::chrono::nanoseconds lag) noexcept;
+
+	//Counts an event of a sheddable class and returns whether it is admitted
+	bool admit(std::size_t event_class) noexcept;
+
+private:
+	overload_policy policy_;
+	std::vector<class_counters> counters_;
+	unsigned level_ = 0;
+	std::size_t events_since_change_;
+};
+} //namespace event_tracing
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace event_tracing
+{
+//Bounded FIFO lanes of events, lane 0 having the highest priority.
+//The front event of the highest-priority non-empty lane is released first,
+//but once max_bypass_count events in a row were released ahead of the oldest
+//queued event, the oldest one is released, so lower lanes are not starved.
+//Events with the same key are released in push order: if an older event with
+//the key of the selected one is still queued in any lane, it is released instead.
+//Event storage is allocated upfront and reused.
+template<typename Event>
+class priority_lanes
+{
+public:
+	using slot_type = std::size_t;
+
+	static constexpr const slot_type no_slot = (std::numeric_limits<slot_type>::max)();
+
+public:
+	priority_lanes(std::size_t lane_count, std::size_t lane_capacity, std::size_t max_bypass_count)
+		: lane_capacity_(lane_capacity)
+		, max_bypass_count_(max_bypass_count)
+		, lanes_(lane_count)
+		//One more slot for the event being dispatched
+		, slots_(lane_count * lane_capacity + 1u)
+	{
+		if (!lane_count || !lane_capacity)
+			throw std::invalid_argument("Priority lane count and capacity must not be zero");
+
+		free_slots_.reserve(slots_.size());
+		for (std::size_t i = slots_.size(); i != 0; --i)
+			free_slots_.push_back(i - 1u);
+
+		keys_.reserve(slots_.size());
+	}
+
+	priority_lanes(const priority_lanes&) = delete;
+	priority_lanes& operator=(const priority_lanes&) = delete;
+
+	std::size_t get_lane_count() const noexcept
+	{
+		return lanes_.size();
+	}
+
+	bool full(std::size_t lane) const noexcept
+	{
+		return lanes_[lane].size == lane_capacity_;
+	}
+
+	bool empty() const noexcept
+	{
+		return !size_;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	std::size_t size(std::size_t lane) const noexcept
+	{
+		return lanes_[lane].size;
+	}
+
+	//Events released ahead of their priority to prevent starvation
+	std::uint64_t get_aged_count() const noexcept
+	{
+		return aged_count_;
+	}
+
+	//Events released ahead of their priority to keep the order of their key
+	std::uint64_t get_key_ordered_count() const noexcept
+	{
+		return key_ordered_count_;
+	}
+
+	//Queues an event and returns its slot, which must be filled before
+	//the next pop. The lane must not be full.
+	slot_type push(std::size_t lane, std::uint64_t key)
+	{
+		auto it = keys_.find(key);
+		if (it == keys_.end())
+			it = keys_.emplace(key, key_chain{ no_slot, no_slot }).first;
+
+		auto slot = free_slots_.back();
+		free_slots_.pop_back();
+		auto& entry = slots_[slot];
+		entry.lane = lane;
+		entry.key = key;
+		entry.sequence = sequence_++;
+		entry.next_with_key = no_slot;
+
+		auto& target = lanes_[lane];
+		entry.previous = target.tail;
+		entry.next = no_slot;
+		if (target.tail == no_slot)
+			target.head = slot;
+		else
+			slots_[target.tail].next = slot;
+
+		target.tail = slot;
+		++target.size;
+
+		if (it->second.tail == no_slot)
+			it->second.head = slot;
+		else
+			slots_[it->second.tail].next_with_key = slot;
+
+		it->second.tail = slot;
+		++size_;
+		return slot;
+	}
+
+	Event& get(slot_type slot) noexcept
+	{
+		return slots_[slot].event;
+	}
+
+	//Dequeues the next event, the lanes must not be empty.
+	//The slot must be released once the event is handled.
+	slot_type pop()
+	{
+		auto selected = no_slot;
+		auto oldest = no_slot;
+		for (const auto& lane : lanes_)
+		{
+			if (lane.head == no_slot)
+				continue;
+
+			if (selected == no_slot)
+				selected = lane.head;
+
+			if (oldest == no_slot || slots_[lane.head].sequence < slots_[oldest].sequence)
+				oldest = lane.head;
+		}
+
+		if (selected != oldest && bypass_count_ >= max_bypass_count_)
+		{
+			selected = oldest;
+			++aged_count_;
+		}
+
+		auto key = keys_.find(slots_[selected].key);
+		if (key->second.head != selected)
+		{
+			selected = key->second.head;
+			++key_ordered_count_;
+		}
+
+		if (selected == oldest)
+			bypass_count_ = 0;
+		else
+			++bypass_count_;
+
+		auto& entry = slots_[selected];
+		key->second.head = entry.next_with_key;
+		if (key->second.head == no_slot)
+			keys_.erase(key);
+
+		auto& lane = lanes_[entry.lane];
+		if (entry.previous == no_slot)
+			lane.head = entry.next;
+		else
+			slots_[entry.previous].next = entry.next;
+
+		if (entry.next == no_slot)
+			lane.tail = entry.previous;
+		else
+			slots_[entry.next].previous = entry.previous;
+
+		--lane.size;
+		--size_;
+		return selected;
+	}
+
+	void release(slot_type slot) noexcept
+	{
+		//Capacity is reserved in the constructor
+		free_slots_.push_back(slot);
+	}
+
+private:
+	struct slot_entry
+	{
+		Event event;
+		std::size_t lane;
+		std::uint64_t key;
+		std::uint64_t sequence;
+		slot_type previous;
+		slot_type next;
+		slot_type next_with_key;
+	};
+
+	struct lane_list
+	{
+		slot_type head = no_slot;
+		slot_type tail = no_slot;
+		std::size_t size = 0;
+	};
+
+	struct key_chain
+	{
+		slot_type head;
+		slot_type tail;
+	};
+
+private:
+	std::size_t lane_capacity_;
+	std::size_t max_bypass_count_;
+	std::vector<lane_list> lanes_;
+	std::vector<slot_entry> slots_;
+	std::vector<slot_type> free_slots_;
+	//Queued events of each key in push order
+	std::unordered_map<std::uint64_t, key_chain> keys_;
+	std::uint64_t sequence_ = 0;
+	std::size_t size_ = 0;
+	std::size_t bypass_count_ = 0;
+	std::uint64_t aged_count_ = 0;
+	std::uint64_t key_ordered_count_ = 0;
+};
+
+template<typename Event>
+constexpr const typename priority_lanes<Event>::slot_type priority_lanes<Event>::no_slot;
+} //namespace event_tracing
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace event_tracing
+{
+//Holds events for a bounded window and releases them in timestamp order.
+//An event is released once it is older than the newest seen timestamp by
+//the time window, when the buffer holds more than max_size events, or when
+//some event has been held for max_delay of Clock time, so that the last
+//events of a quiet stream are not held indefinitely.
+//Events older than the last released one can not be put in order any more,
+//they are passed through immediately and reported as late.
+//All storage is allocated upfront, so pushing does not allocate.
+template<typename Event, typename Clock = std::chrono::steady_clock>
+class reorder_buffer
+{
+public:
+	using timestamp_type = std::int64_t;
+	using clock_type = Clock;
+
+public:
+	reorder_buffer(timestamp_type time_window, std::size_t max_size,
+		typename Clock::duration max_delay)
+		: time_window_(time_window)
+		, max_size_(max_size)
+		, max_delay_(max_delay)
+		, slots_(max_size + 1u)
+	{
+		if (!max_size)
+			throw std::invalid_argument("Reorder buffer size must not be zero");
+
+		heap_.reserve(slots_.size());
+		free_slots_.reserve(slots_.size());
+		for (std::size_t i = slots_.size(); i != 0; --i)
+			free_slots_.push_back(i - 1u);
+	}
+
+	reorder_buffer(const reorder_buffer&) = delete;
+	reorder_buffer& operator=(const reorder_buffer&) = delete;
+
+	//Handler is called as handler(Event& event, bool is_late)
+	template<typename Handler>
+	void push(timestamp_type timestamp, Event&& event, Handler&& handler)
+	{
+		if (has_released_ && timestamp < last_released_timestamp_)
+		{
+			++late_count_;
+			handler(event, true);
+			return;
+		}
+
+		auto now = Clock::now();
+		auto slot = free_slots_.back();
+		free_slots_.pop_back();
+		auto& pushed = slots_[slot];
+		pushed.event = std::move(event);
+		pushed.arrival = now;
+		link_newest(slot);
+		heap_.push_back({ timestamp, sequence_++, slot });
+		std::push_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+		newest_timestamp_ = (std::max)(newest_timestamp_, timestamp);
+
+		while (!heap_.empty() && (heap_.size() > max_size_
+			|| newest_timestamp_ - heap_.front().timestamp >= time_window_
+			|| is_expired(now)))
+		{
+			pop(handler);
+		}
+	}
+
+	//Releases events in timestamp order until none has been held for max_delay
+	template<typename Handler>
+	void release_expired(Handler&& handler)
+	{
+		auto now = Clock::now();
+		while (!heap_.empty() && is_expired(now))
+			pop(handler);
+	}
+
+	template<typename Handler>
+	void flush(Handler&& handler)
+	{
+		while (!heap_.empty())
+			pop(handler);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return heap_.size();
+	}
+
+	bool empty() const noexcept
+	{
+		return heap_.empty();
+	}
+
+	std::uint64_t get_late_count() const noexcept
+	{
+		return late_count_;
+	}
+
+private:
+	struct heap_entry
+	{
+		timestamp_type timestamp;
+		std::uint64_t sequence;
+		std::size_t slot;
+
+		friend bool operator>(const heap_entry& left, const heap_entry& right) noexcept
+		{
+			return left.timestamp > right.timestamp
+				|| (left.timestamp == right.timestamp && left.sequence > right.sequence);
+		}
+	};
+
+	//Held events are also linked in arrival order, oldest first
+	struct held_event
+	{
+		Event event;
+		typename Clock::time_point arrival;
+		std::size_t older = no_slot;
+		std::size_t newer = no_slot;
+	};
+
+	static constexpr const std::size_t no_slot = (std::numeric_limits<std::size_t>::max)();
+
+private:
+	bool is_expired(typename Clock::time_point now) const noexcept
+	{
+		return oldest_ != no_slot && now - slots_[oldest_].arrival >= max_delay_;
+	}
+
+	void link_newest(std::size_t index) noexcept
+	{
+		auto& linked = slots_[index];
+		linked.older = newest_;
+		linked.newer = no_slot;
+		if (newest_ != no_slot)
+			slots_[newest_].newer = index;
+		else
+			oldest_ = index;
+
+		newest_ = index;
+	}
+
+	void unlink(std::size_t index) noexcept
+	{
+		auto& linked = slots_[index];
+		if (linked.older != no_slot)
+			slots_[linked.older].newer = linked.newer;
+		else
+			oldest_ = linked.newer;
+
+		if (linked.newer != no_slot)
+			slots_[linked.newer].older = linked.older;
+		else
+			newest_ = linked.older;
+	}
+
+	template<typename Handler>
+	void pop(Handler& handler)
+	{
+		std::pop_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+		auto entry = heap_.back();
+		heap_.pop_back();
+		unlink(entry.slot);
+		free_slots_.push_back(entry.slot);
+
+		has_released_ = true;
+		last_released_timestamp_ = entry.timestamp;
+		handler(slots_[entry.slot].event, false);
+	}
+
+private:
+	timestamp_type time_window_;
+	std::size_t max_size_;
+	typename Clock::duration max_delay_;
+	std::vector<held_event> slots_;
+	std::size_t oldest_ = no_slot;
+	std::size_t newest_ = no_slot;
+	std::vector<std::size_t> free_slots_;
+	std::vector<heap_entry> heap_;
+	std::uint64_t sequence_ = 0;
+	std::uint64_t late_count_ = 0;
+	timestamp_type newest_timestamp_ = (std::numeric_limits<timestamp_type>::min)();
+	timestamp_type last_released_timestamp_ = 0;
+	bool has_released_ = false;
+};
+} //namespace event_tracing
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/decode_result.h"
+#include "event_tracing/event_map.h"
+#include "event_tracing/event_schema.h"
+
+namespace event_tracing
+{
+//Schema pack file: the header, the event index sorted by provider and
+//event descriptor, the map index sorted by provider and map name, then
+//TRACE_EVENT_INFO, EVENT_MAP_INFO and map name data aligned to 8 bytes.
+//Offsets are from the start of the file. Strings are wchar_t of the
+//platform which wrote the pack.
+struct schema_pack_header
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t event_count;
+	std::uint32_t map_count;
+	std::uint64_t events_offset;
+	std::uint64_t maps_offset;
+	std::uint64_t size;
+};
+
+struct schema_pack_event_entry
+{
+	GUID provider_id;
+	USHORT id;
+	UCHAR version;
+	UCHAR opcode;
+	std::uint32_t info_size;
+	std::uint64_t info_offset;
+};
+
+struct schema_pack_map_entry
+{
+	GUID provider_id;
+	//Length of the name in characters, without the terminating zero
+	std::uint32_t name_length;
+	std::uint32_t info_size;
+	std::uint64_t name_offset;
+	std::uint64_t info_offset;
+};
+
+constexpr const std::uint32_t schema_pack_magic = 0x50534554u;
+constexpr const std::uint32_t schema_pack_version = 1;
+
+//TRACE_EVENT_INFO of an event as TDH returns it
+struct schema_pack_event
+{
+	GUID provider_id;
+	EVENT_DESCRIPTOR descriptor;
+	std::vector<std::uint8_t> info;
+};
+
+//EVENT_MAP_INFO of a map as TDH returns it
+struct schema_pack_map
+{
+	GUID provider_id;
+	std::wstring name;
+	std::vector<std::uint8_t> info;
+};
+
+//Throws event_trace_error if the stream can not be written or an event
+//or a map is defined twice
+void write_schema_pack(std::vector<schema_pack_event> events,
+	std::vector<schema_pack_map> maps, std::ostream& stream);
+
+//Memory-mapped schema pack. Opening it only validates the header, schemas
+//and maps are unpacked on lookup. Thread-safe.
+class schema_pack
+{
+public:
+	//Throws event_trace_error if the file can not be mapped or is not a schema pack
+	explicit schema_pack(const std::string& file_name);
+	~schema_pack();
+
+	schema_pack(const schema_pack&) = delete;
+	schema_pack& operator=(const schema_pack&) = delete;
+
+	std::size_t get_event_count() const noexcept
+	{
+		return header_->event_count;
+	}
+
+	std::size_t get_map_count() const noexcept
+	{
+		return header_->map_count;
+	}
+
+	//Value maps of the properties are resolved from the pack
+	decode_result<std::shared_ptr<const event_schema>> get_schema(const GUID& provider_id,
+		const EVENT_DESCRIPTOR& descriptor) const;
+	decode_result<std::shared_ptr<const event_value_map>> get_map(const GUID& provider_id,
+		const wchar_t* map_name) const;
+
+private:
+	class mapping;
+
+private:
+	bool is_valid_range(std::uint64_t offset, std::uint64_t size) const noexcept;
+
+private:
+	std::unique_ptr<mapping> mapping_;
+	const std::uint8_t* data_;
+	const schema_pack_header* header_;
+	const schema_pack_event_entry* events_;
+	const schema_pack_map_entry* maps_;
+};
+} //namespace event_tracing
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+//Scoped timing probes, compiled in only when EVENT_TRACING_PROFILING is defined:
+//	EVENT_TRACING_PROFILE_SCOPE("event_trace::dispatch_event");
+//Times are accumulated per call path of each thread in CPU cycles.
+#ifdef EVENT_TRACING_PROFILING
+#define EVENT_TRACING_PROFILE_JOIN_IMPL(left, right) left##right
+#define EVENT_TRACING_PROFILE_JOIN(left, right) EVENT_TRACING_PROFILE_JOIN_IMPL(left, right)
+#define EVENT_TRACING_PROFILE_SCOPE(name) \
+	static const ::event_tracing::profile_probe EVENT_TRACING_PROFILE_JOIN(profile_probe_, __LINE__)(name); \
+	const ::event_tracing::profile_scope EVENT_TRACING_PROFILE_JOIN(profile_scope_, __LINE__)( \
+		EVENT_TRACING_PROFILE_JOIN(profile_probe_, __LINE__))
+#else
+#define EVENT_TRACING_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+namespace event_tracing
+{
+inline std::uint64_t read_cycle_counter() noexcept
+{
+	return __rdtsc();
+}
+
+//Registered once per probe site, name must be a literal
+class profile_probe
+{
+public:
+	explicit profile_probe(const char* name);
+
+	std::uint32_t get_id() const noexcept
+	{
+		return id_;
+	}
+
+private:
+	std::uint32_t id_;
+};
+
+//Call tree of one thread. It is only changed by its thread, counters are
+//atomic so the tree can be read from other threads without locks.
+class profile_thread_data
+{
+public:
+	static constexpr const std::uint32_t max_node_count = 1024;
+	static constexpr const std::uint32_t no_node = 0xffffffffu;
+
+	struct node
+	{
+		std::uint32_t parent;
+		std::uint32_t probe;
+		std::atomic<std::uint64_t> calls;
+		std::atomic<std::uint64_t> cycles;
+		std::atomic<std::uint64_t> child_cycles;
+	};
+
+public:
+	profile_thread_data() noexcept;
+
+	profile_thread_data(const profile_thread_data&) = delete;
+	profile_thread_data& operator=(const profile_thread_data&) = delete;
+
+	static profile_thread_data& get_current();
+
+	//Returns no_node if the tree is full
+	std::uint32_t enter(std::uint32_t probe) noexcept;
+	void leave(std::uint32_t node_index, std::uint64_t cycles) noexcept;
+
+	//Nodes below the returned count are complete
+	std::uint32_t get_node_count() const noexcept
+	{
+		return node_count_.load(std::memory_order_acquire);
+	}
+
+	const node& get_node(std::uint32_t index) const noexcept
+	{
+		return nodes_[index];
+	}
+
+private:
+	static constexpr const std::uint32_t table_size = max_node_count * 2;
+
+	node nodes_[max_node_count];
+	std::atomic<std::uint32_t> node_count_{ 0 };
+	std::uint32_t current_ = no_node;
+	//Node index + 1 by (parent, probe), used by the owner thread only
+	std::uint32_t table_[table_size];
+};
+
+class profile_scope
+{
+public:
+	explicit profile_scope(const profile_probe& probe)
+		: thread_(profile_thread_data::get_current())
+		, node_(thread_.enter(probe.get_id()))
+		, start_(read_cycle_counter())
+	{
+	}
+
+	~profile_scope()
+	{
+		if (node_ != profile_thread_data::no_node)
+			thread_.leave(node_, read_cycle_counter() - start_);
+	}
+
+	profile_scope(const profile_scope&) = delete;
+	profile_scope& operator=(const profile_scope&) = delete;
+
+private:
+	profile_thread_data& thread_;
+	std::uint32_t node_;
+	std::uint64_t start_;
+};
+
+struct profile_probe_statistics
+{
+	std::string name;
+	std::uint64_t calls = 0;
+	//Nested calls of the same probe are counted in total cycles once
+	std::uint64_t total_cycles = 0;
+	std::uint64_t self_cycles = 0;
+};
+
+//Aggregated over all threads, ordered by self cycles
+std::vector<profile_probe_statistics> get_profile_statistics();
+
+//Appends one "outer;inner self_cycles" line per call path, which is the
+//folded stack format of flame graph tools
+void write_folded_stacks(std::string& result);
+
+//Measured once over a short interval
+double get_cycles_per_second();
+} //namespace event_tracing
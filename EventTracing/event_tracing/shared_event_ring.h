@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace event_tracing
+{
+namespace detail
+{
+struct shared_ring_header;
+struct shared_ring_reader_slot;
+class shared_ring_memory;
+} //namespace detail
+
+//Single producer, multiple reader ring of variable size records in named
+//shared memory. The producer never waits for readers: a reader which falls
+//more than the ring capacity behind finds its records overwritten, skips
+//forward to the newest record and counts the records it has lost.
+class shared_event_ring_writer
+{
+public:
+	static constexpr const std::size_t default_max_readers = 8;
+
+	struct reader_state
+	{
+		//Bytes written but not yet read
+		std::uint64_t lag;
+		std::uint64_t lost_count;
+	};
+
+public:
+	//Capacity is rounded up to a power of two. Only one writer of a name
+	//may exist at a time. Throws event_trace_error if the ring can not be
+	//created: on Windows a ring lives while any reader has it open, so a
+	//new writer fails until all readers of the previous ring have closed.
+	//POSIX rings left by a writer which has not exited normally are
+	//replaced, readers still attached to them are not notified.
+	shared_event_ring_writer(const std::string& name, std::size_t capacity,
+		std::size_t max_readers = default_max_readers);
+
+	shared_event_ring_writer(const shared_event_ring_writer&) = delete;
+	shared_event_ring_writer& operator=(const shared_event_ring_writer&) = delete;
+
+	//Readers see the end of the stream once they have read all records
+	~shared_event_ring_writer();
+
+	//Calls fill(std::uint8_t* data) to write a record of size bytes in place.
+	//Returns false if the record can not fit into the ring.
+	template<typename Fill>
+	bool write(std::size_t size, Fill&& fill)
+	{
+		auto data = begin_write(size);
+		if (!data)
+			return false;
+
+		fill(data);
+		end_write();
+		return true;
+	}
+
+	bool write(const void* data, std::size_t size);
+
+	std::uint64_t get_written_count() const noexcept
+	{
+		return next_sequence_;
+	}
+
+	//States of attached readers
+	std::vector<reader_state> get_readers() const;
+
+private:
+	std::uint8_t* begin_write(std::size_t size) noexcept;
+	void end_write() noexcept;
+
+private:
+	std::string name_;
+	std::unique_ptr<detail::shared_ring_memory> memory_;
+	detail::shared_ring_header* header_;
+	std::uint8_t* data_;
+	std::uint64_t position_ = 0;
+	std::uint64_t next_position_ = 0;
+	std::uint64_t next_sequence_ = 0;
+};
+
+class shared_event_ring_reader
+{
+public:
+	enum class read_result
+	{
+		record,
+		empty,
+		//The writer has closed the ring and all records have been read
+		finished
+	};
+
+public:
+	//Starts reading from the newest record.
+	//Throws if the ring does not exist or all reader slots are taken.
+	explicit shared_event_ring_reader(const std::string& name);
+
+	shared_event_ring_reader(const shared_event_ring_reader&) = delete;
+	shared_event_ring_reader& operator=(const shared_event_ring_reader&) = delete;
+
+	~shared_event_ring_reader();
+
+	//Copies the next record to the buffer, resized to the record size
+	read_result read(std::vector<std::uint8_t>& record);
+
+	//Records overwritten before they were read
+	std::uint64_t get_lost_count() const noexcept
+	{
+		return lost_count_;
+	}
+
+private:
+	void skip_forward() noexcept;
+
+private:
+	std::unique_ptr<detail::shared_ring_memory> memory_;
+	detail::shared_ring_header* header_;
+	detail::shared_ring_reader_slot* slot_;
+	const std::uint8_t* data_;
+	std::uint64_t capacity_;
+	std::uint64_t position_;
+	//Sequence number the next record should have, known after the first record
+	std::uint64_t next_sequence_ = 0;
+	bool has_sequence_ = false;
+	std::uint64_t lost_count_ = 0;
+};
+} //namespace event_tracing
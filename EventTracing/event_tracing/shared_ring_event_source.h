@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_record_copy.h"
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/shared_event_ring.h"
+
+namespace event_tracing
+{
+//Consumer side of the shared memory fan-out, reads records published
+//by shared_ring_publisher in another process. Records overwritten before
+//they are read are skipped and counted as lost.
+class shared_ring_event_source
+{
+public:
+	//Starts with the newest record
+	explicit shared_ring_event_source(const std::string& ring_name)
+		: ring_(ring_name)
+	{
+	}
+
+	//Calls handler(PEVENT_RECORD) for up to max_count available records
+	//and returns the number of records read
+	template<typename Handler>
+	std::size_t poll(Handler&& handler, std::size_t max_count)
+	{
+		std::size_t count = 0;
+		while (count != max_count)
+		{
+			auto result = ring_.read(buffer_);
+			if (result != shared_event_ring_reader::read_result::record)
+			{
+				finished_ = result == shared_event_ring_reader::read_result::finished;
+				break;
+			}
+
+			if (!record_.assign_serialized(buffer_.data(), buffer_.size()))
+				throw event_trace_error("Shared ring contains an invalid event record");
+
+			++count;
+			handler(record_.get());
+		}
+
+		return count;
+	}
+
+	//The publisher has stopped and all records have been read
+	bool is_finished() const noexcept
+	{
+		return finished_;
+	}
+
+	std::uint64_t get_lost_count() const noexcept
+	{
+		return ring_.get_lost_count();
+	}
+
+private:
+	shared_event_ring_reader ring_;
+	std::vector<std::uint8_t> buffer_;
+	event_record_copy record_;
+	bool finished_ = false;
+};
+} //namespace event_tracing
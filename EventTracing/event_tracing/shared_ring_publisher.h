@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_record_copy.h"
+#include "event_tracing/shared_event_ring.h"
+
+namespace event_tracing
+{
+//Producer side of the shared memory fan-out: records of one trace are
+//published to a ring which other processes read with shared_ring_event_source,
+//so they do not need trace sessions of their own
+class shared_ring_publisher
+{
+public:
+	using reader_state = shared_event_ring_writer::reader_state;
+
+public:
+	shared_ring_publisher(const std::string& ring_name, std::size_t capacity,
+		std::size_t max_readers = shared_event_ring_writer::default_max_readers)
+		: ring_(ring_name, capacity, max_readers)
+	{
+	}
+
+	//Never waits for readers. Returns false if the record is too large for the ring.
+	bool publish(const EVENT_RECORD& record) noexcept
+	{
+		return ring_.write(event_record_copy::get_serialized_size(record), [&record](std::uint8_t* data)
+		{
+			event_record_copy::serialize(record, data);
+		});
+	}
+
+	std::uint64_t get_published_count() const noexcept
+	{
+		return ring_.get_written_count();
+	}
+
+	std::vector<reader_state> get_readers() const
+	{
+		return ring_.get_readers();
+	}
+
+private:
+	shared_event_ring_writer ring_;
+};
+} //namespace event_tracing
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "event_tracing/event_extended_data.h"
+
+namespace event_tracing
+{
+//Interns stack traces into a prefix trie shared by all stacks.
+//Each node is a (parent node, frame) pair, nodes are hash-consed, so a
+//repeated stack costs nothing and stacks with a common outer part share
+//its nodes. A stack is identified by the id of its innermost node.
+class stack_store
+{
+public:
+	using stack_id = std::uint32_t;
+	static const stack_id empty_stack = 0;
+
+public:
+	stack_store();
+
+	//Frames go from the innermost to the outermost as in ETW stack traces
+	stack_id add(const std::uint64_t* frames, std::size_t frame_count);
+	stack_id add(const event_stack_trace& stack);
+
+	std::uint64_t get_frame(stack_id id) const noexcept;
+	stack_id get_parent(stack_id id) const noexcept;
+	std::size_t get_depth(stack_id id) const noexcept;
+
+	//Fills frames from the innermost to the outermost
+	void get_frames(stack_id id, std::vector<std::uint64_t>& frames) const;
+	std::vector<std::uint64_t> get_frames(stack_id id) const;
+
+	std::size_t get_node_count() const noexcept
+	{
+		return nodes_.size() - 1u;
+	}
+
+	std::size_t get_memory_usage() const noexcept;
+
+	void clear();
+
+private:
+	struct node
+	{
+		std::uint64_t frame;
+		stack_id parent;
+		std::uint32_t depth;
+	};
+
+private:
+	stack_id add_node(stack_id parent, std::uint64_t frame);
+	std::size_t find_slot(stack_id parent, std::uint64_t frame) const noexcept;
+	void grow_table();
+
+	static std::size_t get_hash(stack_id parent, std::uint64_t frame) noexcept;
+
+private:
+	std::vector<node> nodes_;
+	std::vector<stack_id> table_;
+};
+} //namespace event_tracing
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace event_tracing
+{
+//What timestamp_merger does with an event pushed to a full stream
+enum class merge_overflow
+{
+	//Queued events are released in timestamp order until the stream has room
+	release,
+	//The pushed event is dropped
+	drop
+};
+
+//K-way merge of several individually ordered event streams into one
+//stream ordered by timestamp. An event is released when every stream has
+//something queued (so nothing earlier can arrive), or when it is older than
+//the newest seen timestamp by at least the lookahead. A stream which has had
+//nothing pushed for idle_timeout of Clock time does not hold back the others
+//any more, events it delivers later may then be out of order.
+template<typename Event, typename Clock = std::chrono::steady_clock>
+class timestamp_merger
+{
+public:
+	using timestamp_type = std::int64_t;
+	using clock_type = Clock;
+
+public:
+	timestamp_merger(std::size_t stream_count, timestamp_type lookahead,
+		typename Clock::duration idle_timeout, std::size_t stream_capacity,
+		merge_overflow overflow = merge_overflow::release)
+		: streams_(stream_count)
+		, empty_stream_count_(stream_count)
+		, lookahead_(lookahead)
+		, idle_timeout_(idle_timeout)
+		, stream_capacity_(stream_capacity)
+		, overflow_(overflow)
+	{
+		if (!stream_capacity)
+			throw std::invalid_argument("Merge stream capacity must not be zero");
+
+		heap_.reserve(stream_count);
+	}
+
+	//Queues the event and releases the ones which are ready. Handler is
+	//called as handler(std::size_t stream_index, Event& event). Returns
+	//false if the stream is full and the event has been dropped.
+	template<typename Handler>
+	bool push(std::size_t stream_index, timestamp_type timestamp, Event&& event, Handler&& handler)
+	{
+		assert(stream_index < streams_.size());
+		auto& stream = streams_[stream_index];
+		if (stream.events.size() >= stream_capacity_)
+		{
+			++overflow_count_;
+			if (overflow_ == merge_overflow::drop)
+				return false;
+
+			while (stream.events.size() >= stream_capacity_)
+				pop(handler);
+		}
+
+		if (stream.events.empty())
+		{
+			--empty_stream_count_;
+			heap_.emplace_back(timestamp, stream_index);
+			std::push_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+		}
+
+		stream.events.emplace_back(timestamp, std::move(event));
+		stream.last_push = Clock::now();
+		newest_timestamp_ = (std::max)(newest_timestamp_, timestamp);
+		++size_;
+
+		while (!heap_.empty() && is_ready(heap_.front().first))
+			pop(handler);
+
+		return true;
+	}
+
+	//Releases events held back only by streams idle for idle_timeout
+	template<typename Handler>
+	void release_idle(Handler&& handler)
+	{
+		if (heap_.empty() || !empty_stream_count_)
+			return;
+
+		auto idle_since = Clock::now() - idle_timeout_;
+		auto is_blocking = [idle_since](const stream_state& stream)
+		{
+			return stream.events.empty() && stream.last_push > idle_since;
+		};
+
+		auto blocking_count = std::count_if(streams_.cbegin(), streams_.cend(), is_blocking);
+		while (!blocking_count && !heap_.empty())
+		{
+			auto stream_index = pop(handler);
+			if (is_blocking(streams_[stream_index]))
+				++blocking_count;
+		}
+	}
+
+	template<typename Handler>
+	void flush(Handler&& handler)
+	{
+		while (!heap_.empty())
+			pop(handler);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	bool empty() const noexcept
+	{
+		return !size_;
+	}
+
+	std::size_t get_stream_count() const noexcept
+	{
+		return streams_.size();
+	}
+
+	//Events pushed to full streams, released early or dropped
+	std::uint64_t get_overflow_count() const noexcept
+	{
+		return overflow_count_;
+	}
+
+private:
+	using heap_entry = std::pair<timestamp_type, std::size_t>;
+
+	struct stream_state
+	{
+		std::deque<std::pair<timestamp_type, Event>> events;
+		typename Clock::time_point last_push = Clock::now();
+	};
+
+private:
+	bool is_ready(timestamp_type timestamp) const noexcept
+	{
+		return !empty_stream_count_ || newest_timestamp_ - timestamp >= lookahead_;
+	}
+
+	template<typename Handler>
+	std::size_t pop(Handler& handler)
+	{
+		std::pop_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+		auto stream_index = heap_.back().second;
+		auto& events = streams_[stream_index].events;
+		auto event = std::move(events.front().second);
+		events.pop_front();
+		--size_;
+
+		if (events.empty())
+		{
+			heap_.pop_back();
+			++empty_stream_count_;
+		}
+		else
+		{
+			heap_.back().first = events.front().first;
+			std::push_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+		}
+
+		handler(stream_index, event);
+		return stream_index;
+	}
+
+private:
+	std::vector<stream_state> streams_;
+	std::vector<heap_entry> heap_;
+	std::size_t empty_stream_count_;
+	std::size_t size_ = 0;
+	timestamp_type lookahead_;
+	typename Clock::duration idle_timeout_;
+	std::size_t stream_capacity_;
+	merge_overflow overflow_;
+	std::uint64_t overflow_count_ = 0;
+	timestamp_type newest_timestamp_ = (std::numeric_limits<timestamp_type>::min)();
+};
+} //namespace event_tracing
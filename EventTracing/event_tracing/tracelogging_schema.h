@@ -0,0 +1,18 @@
+#pragma once
+
+#include <memory>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/decode_result.h"
+#include "event_tracing/event_schema.h"
+
+namespace event_tracing
+{
+//Builds the schema of a TraceLogging event from the metadata it carries in
+//its EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL item, in the TRACE_EVENT_INFO
+//layout TDH returns. The event name is also the task name, the provider
+//name is taken from the EVENT_HEADER_EXT_TYPE_PROV_TRAITS item if present.
+decode_result<std::shared_ptr<const event_schema>> parse_tracelogging_schema(const EVENT_RECORD& record);
+} //namespace event_tracing
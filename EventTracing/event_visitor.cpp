@@ -0,0 +1,303 @@
+#include "event_tracing/event_visitor.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include <boost/container/small_vector.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include "event_tracing/event_schema.h"
+
+namespace event_tracing
+{
+namespace
+{
+class payload_walker
+{
+public:
+	payload_walker(const event_schema& schema, const EVENT_RECORD& record,
+		event_visitor& visitor)
+		: schema_(schema)
+		, visitor_(visitor)
+		, begin_(static_cast<const std::uint8_t*>(record.UserData))
+		, position_(begin_)
+		, end_(begin_ + record.UserDataLength)
+		, wide_pointer_(!(record.EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER))
+		, integers_(schema.get_property_count())
+	{
+	}
+
+	decode_result<ULONG> walk(ULONG top_level_property_count)
+	{
+		if (top_level_property_count > schema_.get_top_level_property_count())
+			return decode_error::index_out_of_bounds;
+
+		auto result = visit_properties(0u, top_level_property_count, 0u);
+		if (result != decode_error::none)
+			return result;
+
+		return static_cast<ULONG>(position_ - begin_);
+	}
+
+private:
+	decode_error visit_properties(ULONG first, ULONG count, ULONG min_index)
+	{
+		if (first < min_index || first + count > schema_.get_property_count())
+			return decode_error::invalid_schema;
+
+		for (ULONG index = first; index != first + count; ++index)
+		{
+			auto result = visit_property(index);
+			if (result != decode_error::none)
+				return result;
+		}
+
+		return decode_error::none;
+	}
+
+	decode_error visit_property(ULONG index)
+	{
+		const auto& prop = schema_.get_property(index);
+		ULONG size = prop.count;
+		if (prop.has_payload_count())
+		{
+			std::uint16_t count = 0;
+			if (static_cast<std::size_t>(end_ - position_) < sizeof(count))
+				return decode_error::payload_truncated;
+
+			std::memcpy(&count, position_, sizeof(count));
+			position_ += sizeof(count);
+			size = count;
+		}
+		else if (prop.has_count_property())
+		{
+			//Count and length properties always precede the ones they describe
+			if (prop.count >= index)
+				return decode_error::invalid_schema;
+
+			size = static_cast<ULONG>(integers_[prop.count]);
+		}
+
+		bool is_array = prop.is_array();
+		if (is_array)
+			visitor_.begin_array(prop.name, size);
+
+		for (ULONG element_index = 0; element_index != size; ++element_index)
+		{
+			decode_error result;
+			if (prop.is_struct())
+			{
+				visitor_.begin_struct(prop.name);
+				//Members follow their struct, so recursion always terminates
+				result = visit_properties(prop.struct_start_index, prop.struct_member_count, index + 1);
+				if (result == decode_error::none)
+					visitor_.end_struct();
+			}
+			else
+			{
+				result = visit_value(index, prop);
+			}
+
+			if (result != decode_error::none)
+				return result;
+		}
+
+		if (is_array)
+			visitor_.end_array();
+
+		return decode_error::none;
+	}
+
+	decode_error visit_value(ULONG index, const event_schema_property& prop)
+	{
+		ULONG length = prop.length;
+		if (prop.has_length_property())
+		{
+			if (prop.length >= index)
+				return decode_error::invalid_schema;
+
+			length = static_cast<ULONG>(integers_[prop.length]);
+		}
+
+		std::size_t size = 0;
+		auto result = get_value_size(prop, length, size);
+		if (result != decode_error::none)
+			return result;
+
+		if (size > static_cast<std::size_t>(end_ - position_))
+			return decode_error::payload_truncated;
+
+		if (size <= sizeof(std::uint64_t))
+		{
+			std::uint64_t value = 0;
+			std::memcpy(&value, position_, size);
+			integers_[index] = value;
+		}
+
+		visitor_.value(event_property_view(prop.in_type, prop.out_type, wide_pointer_,
+			position_, size, prop.name, schema_.get_property_map(index)));
+		position_ += size;
+		return decode_error::none;
+	}
+
+	decode_error get_value_size(const event_schema_property& prop, ULONG length,
+		std::size_t& size) const noexcept
+	{
+		auto available = static_cast<std::size_t>(end_ - position_);
+		auto pointer_size = wide_pointer_ ? sizeof(std::uint64_t) : sizeof(std::uint32_t);
+		size = get_fixed_type_size(prop.in_type);
+		if (size)
+			return decode_error::none;
+
+		switch (prop.in_type)
+		{
+		case TDH_INTYPE_NULL:
+			break;
+
+		case TDH_INTYPE_POINTER:
+		case TDH_INTYPE_SIZET:
+			size = pointer_size;
+			break;
+
+		case TDH_INTYPE_UNICODESTRING:
+			size = prop.has_length_property() || length
+				? length * sizeof(wchar_t) : get_terminated_size<wchar_t>();
+			break;
+
+		case TDH_INTYPE_ANSISTRING:
+			size = prop.has_length_property() || length
+				? length : get_terminated_size<std::uint8_t>();
+			break;
+
+		case TDH_INTYPE_NONNULLTERMINATEDSTRING:
+			size = prop.has_length_property() || length ? length * sizeof(wchar_t) : available;
+			break;
+
+		case TDH_INTYPE_NONNULLTERMINATEDANSISTRING:
+			size = prop.has_length_property() || length ? length : available;
+			break;
+
+		case TDH_INTYPE_COUNTEDSTRING:
+		case TDH_INTYPE_COUNTEDANSISTRING:
+		case TDH_INTYPE_REVERSEDCOUNTEDSTRING:
+		case TDH_INTYPE_REVERSEDCOUNTEDANSISTRING:
+		case TDH_INTYPE_MANIFEST_COUNTEDBINARY:
+			{
+				//Byte count prefix
+				std::uint16_t count = 0;
+				if (available < sizeof(count))
+					return decode_error::payload_truncated;
+
+				std::memcpy(&count, position_, sizeof(count));
+				if (prop.in_type == TDH_INTYPE_REVERSEDCOUNTEDSTRING
+					|| prop.in_type == TDH_INTYPE_REVERSEDCOUNTEDANSISTRING)
+				{
+					boost::endian::big_to_native_inplace(count);
+				}
+
+				size = sizeof(count) + count;
+			}
+			break;
+
+		case TDH_INTYPE_BINARY:
+			size = length;
+			break;
+
+		case TDH_INTYPE_HEXDUMP:
+			{
+				std::uint32_t count = 0;
+				if (available < sizeof(count))
+					return decode_error::payload_truncated;
+
+				std::memcpy(&count, position_, sizeof(count));
+				size = sizeof(count) + count;
+			}
+			break;
+
+		case TDH_INTYPE_SID:
+			return get_sid_size(0u, size);
+
+		case TDH_INTYPE_WBEMSID:
+			//TOKEN_USER followed by the SID
+			return get_sid_size(2 * pointer_size, size);
+
+		default:
+			return decode_error::unsupported_type;
+		}
+
+		return decode_error::none;
+	}
+
+	decode_error get_sid_size(std::size_t offset, std::size_t& size) const noexcept
+	{
+		//Revision, sub-authority count, 6-byte authority, sub-authorities
+		static constexpr const std::size_t sid_header_size = 8;
+		auto available = static_cast<std::size_t>(end_ - position_);
+		if (available < offset + sid_header_size)
+			return decode_error::payload_truncated;
+
+		size = offset + sid_header_size + position_[offset + 1] * sizeof(std::uint32_t);
+		return decode_error::none;
+	}
+
+	//Size including the terminator, or up to the payload end if there is none
+	template<typename Char>
+	std::size_t get_terminated_size() const noexcept
+	{
+		auto available = static_cast<std::size_t>(end_ - position_) / sizeof(Char) * sizeof(Char);
+		for (std::size_t offset = 0; offset != available; offset += sizeof(Char))
+		{
+			Char value;
+			std::memcpy(&value, position_ + offset, sizeof(value));
+			if (!value)
+				return offset + sizeof(Char);
+		}
+
+		return available;
+	}
+
+private:
+	const event_schema& schema_;
+	event_visitor& visitor_;
+	const std::uint8_t* begin_;
+	const std::uint8_t* position_;
+	const std::uint8_t* end_;
+	bool wide_pointer_;
+	//Last integer value of each property, for count and length references
+	boost::container::small_vector<std::uint64_t, 32> integers_;
+};
+} //namespace
+
+decode_result<ULONG> visit_event(const event_info& info, event_visitor& visitor)
+{
+	const auto& record = *static_cast<const EVENT_RECORD*>(info);
+	if (info.has_string_only())
+	{
+		visitor.value(event_property_view(TDH_INTYPE_UNICODESTRING, TDH_INTYPE_UNICODESTRING,
+			false, static_cast<const std::uint8_t*>(record.UserData), record.UserDataLength,
+			L"<Unnamed String Only>"));
+		return static_cast<ULONG>(record.UserDataLength);
+	}
+
+	auto schema = info.try_get_schema();
+	if (!schema)
+		return schema.get_failure();
+
+	return visit_event(**schema, record, visitor);
+}
+
+decode_result<ULONG> visit_event(const event_schema& schema, const EVENT_RECORD& record,
+	event_visitor& visitor)
+{
+	return visit_event(schema, record, visitor, schema.get_top_level_property_count());
+}
+
+decode_result<ULONG> visit_event(const event_schema& schema, const EVENT_RECORD& record,
+	event_visitor& visitor, ULONG top_level_property_count)
+{
+	return payload_walker(schema, record, visitor).walk(top_level_property_count);
+}
+} //namespace event_tracing
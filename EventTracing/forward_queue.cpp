@@ -0,0 +1,146 @@
+#include "event_tracing/forward_queue.h"
+
+#include <algorithm>
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+forward_queue::forward_queue(std::size_t max_memory_size, const std::string& spill_file_name,
+	std::uint64_t max_spill_size)
+	: max_memory_size_(max_memory_size)
+	, spill_file_name_(spill_file_name)
+	, max_spill_size_(max_spill_size)
+{
+	if (!spill_file_name_.empty())
+	{
+		if (!max_spill_size_)
+			throw event_trace_error("Forwarding spill file size is not set");
+
+		open_spill_file();
+	}
+}
+
+bool forward_queue::push(std::uint64_t sequence, std::vector<std::uint8_t>&& batch)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (spilled_batches_.empty() && memory_size_ + batch.size() <= max_memory_size_)
+	{
+		memory_size_ += batch.size();
+		memory_batches_.emplace_back(sequence, std::move(batch));
+		return true;
+	}
+
+	auto spill_size = spilled_batches_.empty() ? 0 : spill_end_ - spilled_batches_.front().offset;
+	if (spill_file_name_.empty() || spill_size + batch.size() > max_spill_size_)
+		return false;
+
+	if (!write_spill(spill_end_, batch.data(), batch.size()))
+		return false;
+
+	spilled_batches_.push_back({ sequence, spill_end_, batch.size() });
+	spill_end_ += batch.size();
+	return true;
+}
+
+bool forward_queue::get(std::size_t index, std::vector<std::uint8_t>& batch)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (index < memory_batches_.size())
+	{
+		batch = memory_batches_[index].second;
+		return true;
+	}
+
+	index -= memory_batches_.size();
+	if (index >= spilled_batches_.size())
+		return false;
+
+	const auto& spilled = spilled_batches_[index];
+	batch.resize(static_cast<std::size_t>(spilled.size));
+	if (!read_spill(spilled.offset, batch.data(), spilled.size))
+		throw event_trace_error("Unable to read forwarding spill file");
+
+	return true;
+}
+
+std::size_t forward_queue::acknowledge(std::uint64_t sequence)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::size_t result = 0;
+	while (!memory_batches_.empty() && memory_batches_.front().first <= sequence)
+	{
+		memory_size_ -= memory_batches_.front().second.size();
+		memory_batches_.pop_front();
+		++result;
+	}
+
+	while (!spilled_batches_.empty() && spilled_batches_.front().sequence <= sequence)
+	{
+		spilled_batches_.pop_front();
+		++result;
+	}
+
+	return result;
+}
+
+std::size_t forward_queue::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return memory_batches_.size() + spilled_batches_.size();
+}
+
+std::size_t forward_queue::get_memory_size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return memory_size_;
+}
+
+std::uint64_t forward_queue::get_spill_size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return spilled_batches_.empty() ? 0 : spill_end_ - spilled_batches_.front().offset;
+}
+
+void forward_queue::open_spill_file()
+{
+	spill_file_.open(spill_file_name_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!spill_file_)
+		throw event_trace_error("Unable to create forwarding spill file");
+}
+
+bool forward_queue::write_spill(std::uint64_t offset, const std::uint8_t* data, std::uint64_t size)
+{
+	spill_file_.clear();
+	while (size)
+	{
+		auto position = offset % max_spill_size_;
+		auto part_size = (std::min)(size, max_spill_size_ - position);
+		spill_file_.seekp(static_cast<std::streamoff>(position));
+		spill_file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(part_size));
+		offset += part_size;
+		data += part_size;
+		size -= part_size;
+	}
+
+	return !spill_file_.fail();
+}
+
+bool forward_queue::read_spill(std::uint64_t offset, std::uint8_t* data, std::uint64_t size)
+{
+	spill_file_.clear();
+	spill_file_.flush();
+	while (size)
+	{
+		auto position = offset % max_spill_size_;
+		auto part_size = (std::min)(size, max_spill_size_ - position);
+		spill_file_.seekg(static_cast<std::streamoff>(position));
+		spill_file_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(part_size));
+		offset += part_size;
+		data += part_size;
+		size -= part_size;
+	}
+
+	return !spill_file_.fail();
+}
+} //namespace event_tracing
@@ -0,0 +1,106 @@
+#include "event_tracing/forwarding_protocol.h"
+
+#include <cstring>
+#include <string>
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace
+{
+void write_header(std::uint8_t* data, forward_frame_type type, std::uint8_t flags,
+	std::uint64_t sequence, std::size_t size, std::size_t raw_size) noexcept
+{
+	forward_frame_header header{};
+	header.magic = forward_frame_magic;
+	header.type = static_cast<std::uint8_t>(type);
+	header.flags = flags;
+	header.size = static_cast<std::uint32_t>(size);
+	header.raw_size = static_cast<std::uint32_t>(raw_size);
+	header.sequence = sequence;
+	std::memcpy(data, &header, sizeof(header));
+}
+} //namespace
+
+void append_forward_frame(std::vector<std::uint8_t>& frame, forward_frame_type type,
+	std::uint64_t sequence, const std::uint8_t* payload, std::size_t size, bool compress)
+{
+	if (size > max_forward_frame_size)
+		throw event_trace_error("Forwarded frame is too large");
+
+	auto header_offset = frame.size();
+	frame.resize(header_offset + sizeof(forward_frame_header));
+	if (compress && size)
+	{
+		std::string compressed;
+		{
+			boost::iostreams::filtering_ostream stream;
+			stream.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::best_speed));
+			stream.push(boost::iostreams::back_inserter(compressed));
+			stream.write(reinterpret_cast<const char*>(payload), static_cast<std::streamsize>(size));
+		}
+
+		if (compressed.size() < size)
+		{
+			write_header(frame.data() + header_offset, type, forward_frame_compressed, sequence,
+				compressed.size(), size);
+			frame.insert(frame.end(), compressed.cbegin(), compressed.cend());
+			return;
+		}
+	}
+
+	write_header(frame.data() + header_offset, type, 0, sequence, size, size);
+	frame.insert(frame.end(), payload, payload + size);
+}
+
+bool is_valid_forward_frame(const forward_frame_header& header) noexcept
+{
+	return header.magic == forward_frame_magic
+		&& header.type >= static_cast<std::uint8_t>(forward_frame_type::hello)
+		&& header.type <= static_cast<std::uint8_t>(forward_frame_type::ack)
+		&& header.size <= max_forward_frame_size && header.raw_size <= max_forward_frame_size
+		&& ((header.flags & forward_frame_compressed) || header.size == header.raw_size);
+}
+
+void get_forward_frame_payload(const forward_frame_header& header, const std::uint8_t* data,
+	std::vector<std::uint8_t>& payload)
+{
+	payload.resize(header.raw_size);
+	if (!(header.flags & forward_frame_compressed))
+	{
+		std::memcpy(payload.data(), data, header.size);
+		return;
+	}
+
+	try
+	{
+		boost::iostreams::filtering_istream stream;
+		stream.push(boost::iostreams::zlib_decompressor());
+		stream.push(boost::iostreams::array_source(reinterpret_cast<const char*>(data), header.size));
+		stream.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+		if (static_cast<std::size_t>(stream.gcount()) != payload.size() || stream.get() != std::char_traits<char>::eof())
+			throw event_trace_error("Forwarded frame has invalid size");
+	}
+	catch (const boost::iostreams::zlib_error& e)
+	{
+		throw event_trace_error("Unable to decompress forwarded frame", static_cast<std::uint32_t>(e.error()));
+	}
+}
+
+void append_forward_entry(std::vector<std::uint8_t>& batch, forward_entry_type type,
+	std::size_t size)
+{
+	std::uint8_t header[forward_entry_header_size];
+	header[0] = static_cast<std::uint8_t>(type);
+	auto entry_size = static_cast<std::uint32_t>(size);
+	std::memcpy(header + 1, &entry_size, sizeof(entry_size));
+	batch.insert(batch.end(), header, header + sizeof(header));
+}
+} //namespace event_tracing
@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <memory>
+#include <stdexcept>
 
 namespace event_tracing
 {
@@ -17,11 +18,6 @@ ms_guid::ms_guid(const wchar_t* str)
 		throw std::runtime_error("Invalid GUID string");
 }
 
-ms_guid::ms_guid(const GUID& guid) noexcept
-	: guid_(guid)
-{
-}
-
 std::wstring ms_guid::to_wstring() const
 {
 	OLECHAR* str = nullptr;
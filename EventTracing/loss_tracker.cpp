@@ -0,0 +1,426 @@
+#include "event_tracing/loss_tracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+
+#include <Evntrace.h>
+
+#include "event_tracing/event_extended_data.h"
+
+namespace event_tracing
+{
+namespace
+{
+//Sender of the log file header event, {68fdd900-4a3e-11d1-84f4-0000f80464e3}
+constexpr const GUID event_trace_guid{ 0x68fdd900, 0x4a3e, 0x11d1,
+	{ 0x84, 0xf4, 0x00, 0x00, 0xf8, 0x04, 0x64, 0xe3 } };
+//Sender of real-time lost event notifications, {6a399ae0-4bc6-4de9-870b-3657f8947e7e}
+constexpr const GUID rt_lost_event_guid{ 0x6a399ae0, 0x4bc6, 0x4de9,
+	{ 0x87, 0x0b, 0x36, 0x57, 0xf8, 0x94, 0x7e, 0x7e } };
+
+//Opcodes of the real-time lost event notifications
+constexpr const UCHAR opcode_rt_lost_event = 32;
+constexpr const UCHAR opcode_rt_lost_buffer = 33;
+constexpr const UCHAR opcode_rt_lost_file = 34;
+
+//TRACE_LOGFILE_HEADER fields, the header is laid out with the pointer size of the logger
+constexpr const std::size_t header_pointer_size_offset = 44;
+constexpr const std::size_t header_events_lost_offset = 48;
+constexpr const std::size_t header_buffers_lost_offset_64 = 276;
+constexpr const std::size_t header_buffers_lost_offset_32 = 268;
+
+ULONG read_header_field(const EVENT_RECORD& record, std::size_t offset) noexcept
+{
+	ULONG value = 0;
+	std::memcpy(&value, static_cast<const std::uint8_t*>(record.UserData) + offset, sizeof(value));
+	return value;
+}
+} //namespace
+
+loss_counters& loss_counters::operator+=(const loss_counters& other) noexcept
+{
+	received += other.received;
+	sequence_gap_events += other.sequence_gap_events;
+	reordered_events += other.reordered_events;
+	duplicate_events += other.duplicate_events;
+	sequence_restarts += other.sequence_restarts;
+	lost_event_notifications += other.lost_event_notifications;
+	lost_buffer_notifications += other.lost_buffer_notifications;
+	lost_file_notifications += other.lost_file_notifications;
+	header_events_lost += other.header_events_lost;
+	header_buffers_lost += other.header_buffers_lost;
+	ring_events_lost += other.ring_events_lost;
+	return *this;
+}
+
+loss_counters loss_report::get_total() const noexcept
+{
+	loss_counters result;
+	for (const auto& counters : inputs)
+		result += counters;
+
+	return result;
+}
+
+std::uint64_t loss_report::get_orphaned_count() const noexcept
+{
+	std::uint64_t result = 0;
+	for (const auto& pair : providers)
+		result += pair.second.orphaned_events;
+
+	return result;
+}
+
+std::wostream& operator<<(std::wostream& stream, const loss_report& report)
+{
+	stream << L"Loss report from " << report.begin_timestamp << L" to " << report.end_timestamp;
+	for (std::size_t i = 0; i != report.inputs.size(); ++i)
+	{
+		const auto& counters = report.inputs[i];
+		stream << L"\nInput " << i << L": received " << counters.received
+			<< L", sequence gaps " << counters.sequence_gap_events
+			<< L", reordered " << counters.reordered_events
+			<< L", duplicates " << counters.duplicate_events
+			<< L", restarts " << counters.sequence_restarts
+			<< L", lost event notifications " << counters.lost_event_notifications
+			<< L", lost buffer notifications " << counters.lost_buffer_notifications
+			<< L", lost file notifications " << counters.lost_file_notifications
+			<< L", header events lost " << counters.header_events_lost
+			<< L", header buffers lost " << counters.header_buffers_lost
+			<< L", ring events lost " << counters.ring_events_lost;
+	}
+
+	for (const auto& pair : report.providers)
+	{
+		stream << L"\nProvider " << pair.first.to_wstring() << L": received " << pair.second.received
+			<< L", orphaned " << pair.second.orphaned_events;
+	}
+
+	return stream;
+}
+
+loss_tracker::loss_tracker(std::uint64_t reorder_window)
+	: reorder_window_(reorder_window)
+{
+}
+
+void loss_tracker::enable_metrics(metrics_registry& registry)
+{
+	auto result = std::make_unique<tracker_metrics>();
+	result->sequence_gap_events = &registry.add_counter("etw_sequence_gap_events_total",
+		"Events missing from the event sequence");
+	result->reordered_events = &registry.add_counter("etw_sequence_reordered_events_total",
+		"Events which arrived after later ones of the sequence");
+	const char* kinds[] = { "kind=\"event\"", "kind=\"buffer\"", "kind=\"file\"" };
+	for (std::size_t i = 0; i != sizeof(kinds) / sizeof(kinds[0]); ++i)
+	{
+		result->lost_notifications[i] = &registry.add_counter("etw_lost_notifications_total",
+			"Lost event notifications of real-time sessions", kinds[i]);
+	}
+	result->header_events_lost = &registry.add_counter("etw_header_events_lost_total",
+		"Events lost according to log file headers");
+	result->header_buffers_lost = &registry.add_counter("etw_header_buffers_lost_total",
+		"Buffers lost according to log file headers");
+	result->orphaned_events = &registry.add_counter("etw_orphaned_events_total",
+		"Events referring to state whose start has not been seen");
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	metrics_ = std::move(result);
+}
+
+void loss_tracker::observe(std::size_t input_index, const EVENT_RECORD& record)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	update_input(input_index, [](loss_counters& counters)
+	{
+		++counters.received;
+	});
+	update_provider(record.EventHeader.ProviderId, [](provider_loss_counters& counters)
+	{
+		++counters.received;
+	});
+	add_timestamp(record.EventHeader.TimeStamp.QuadPart);
+
+	auto sequence_number = event_extended_data(record).get_sequence_number();
+	if (sequence_number)
+		observe_sequence_locked(input_index, *sequence_number);
+
+	if (record.EventHeader.ProviderId == rt_lost_event_guid)
+	{
+		std::size_t kind = 0;
+		switch (record.EventHeader.EventDescriptor.Opcode)
+		{
+		case opcode_rt_lost_event:
+			update_input(input_index, [](loss_counters& counters)
+			{
+				++counters.lost_event_notifications;
+			});
+			break;
+
+		case opcode_rt_lost_buffer:
+			update_input(input_index, [](loss_counters& counters)
+			{
+				++counters.lost_buffer_notifications;
+			});
+			kind = 1;
+			break;
+
+		case opcode_rt_lost_file:
+			update_input(input_index, [](loss_counters& counters)
+			{
+				++counters.lost_file_notifications;
+			});
+			kind = 2;
+			break;
+
+		default:
+			return;
+		}
+
+		if (metrics_)
+			metrics_->lost_notifications[kind]->increment();
+	}
+	else if (record.EventHeader.ProviderId == event_trace_guid
+		&& record.EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_INFO)
+	{
+		observe_header(input_index, record);
+	}
+}
+
+void loss_tracker::observe_sequence(std::size_t input_index, std::uint64_t sequence_number)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	observe_sequence_locked(input_index, sequence_number);
+}
+
+void loss_tracker::add_lost_events(std::size_t input_index, std::uint64_t count)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	update_input(input_index, [count](loss_counters& counters)
+	{
+		counters.ring_events_lost += count;
+	});
+}
+
+void loss_tracker::add_orphaned_event(const EVENT_RECORD& record)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	update_provider(record.EventHeader.ProviderId, [](provider_loss_counters& counters)
+	{
+		++counters.orphaned_events;
+	});
+
+	if (metrics_)
+		metrics_->orphaned_events->increment();
+}
+
+void loss_tracker::set_header_losses(std::size_t input_index, std::uint64_t events_lost,
+	std::uint64_t buffers_lost)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	set_header_losses_locked(input_index, events_lost, buffers_lost);
+}
+
+void loss_tracker::flush()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (std::size_t i = 0; i != sequences_.size(); ++i)
+		expire_gaps(i, sequences_[i], true);
+}
+
+loss_report loss_tracker::take_report()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto result = std::move(interval_);
+	interval_ = loss_report();
+	return result;
+}
+
+loss_report loss_tracker::get_totals() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return totals_;
+}
+
+template<typename Update>
+void loss_tracker::update_input(std::size_t input_index, Update&& update)
+{
+	for (auto report : { &interval_, &totals_ })
+	{
+		if (report->inputs.size() <= input_index)
+			report->inputs.resize(input_index + 1u);
+
+		update(report->inputs[input_index]);
+	}
+}
+
+template<typename Update>
+void loss_tracker::update_provider(const GUID& provider_id, Update&& update)
+{
+	for (auto report : { &interval_, &totals_ })
+		update(report->providers[provider_id]);
+}
+
+void loss_tracker::observe_sequence_locked(std::size_t input_index, std::uint64_t sequence_number)
+{
+	if (sequences_.size() <= input_index)
+		sequences_.resize(input_index + 1u);
+
+	auto& state = sequences_[input_index];
+	if (!state.started || sequence_number > state.highest)
+	{
+		if (state.started && sequence_number - state.highest > 1u)
+			state.gaps.emplace(state.highest + 1u, sequence_number - 1u);
+		if (!state.started)
+			state.lowest = sequence_number;
+
+		state.started = true;
+		state.highest = sequence_number;
+		expire_gaps(input_index, state, false);
+		return;
+	}
+
+	//Behind the highest one: fills a gap, precedes the first seen one,
+	//repeats a number or starts over
+	bool reordered = false;
+	auto it = state.gaps.upper_bound(sequence_number);
+	if (it != state.gaps.begin() && sequence_number <= (*--it).second)
+	{
+		auto first = (*it).first;
+		auto last = (*it).second;
+		state.gaps.erase(it);
+		if (first < sequence_number)
+			state.gaps.emplace(first, sequence_number - 1u);
+		if (sequence_number < last)
+			state.gaps.emplace(sequence_number + 1u, last);
+
+		reordered = true;
+	}
+	else if (state.highest - sequence_number <= reorder_window_ && sequence_number < state.lowest)
+	{
+		//Numbers between it and the first seen one may still come
+		if (state.lowest - sequence_number > 1u)
+			state.gaps.emplace(sequence_number + 1u, state.lowest - 1u);
+
+		state.lowest = sequence_number;
+		reordered = true;
+	}
+
+	if (reordered)
+	{
+		update_input(input_index, [](loss_counters& counters)
+		{
+			++counters.reordered_events;
+		});
+
+		if (metrics_)
+			metrics_->reordered_events->increment();
+
+		return;
+	}
+
+	if (state.highest - sequence_number <= reorder_window_)
+	{
+		update_input(input_index, [](loss_counters& counters)
+		{
+			++counters.duplicate_events;
+		});
+		return;
+	}
+
+	//Gaps of the previous sequence will not be filled anymore
+	expire_gaps(input_index, state, true);
+	state.lowest = sequence_number;
+	state.highest = sequence_number;
+	update_input(input_index, [](loss_counters& counters)
+	{
+		++counters.sequence_restarts;
+	});
+}
+
+void loss_tracker::observe_header(std::size_t input_index, const EVENT_RECORD& record)
+{
+	if (!record.UserData || record.UserDataLength < header_events_lost_offset + sizeof(ULONG))
+		return;
+
+	auto buffers_lost_offset = read_header_field(record, header_pointer_size_offset) == 4u
+		? header_buffers_lost_offset_32 : header_buffers_lost_offset_64;
+	std::uint64_t buffers_lost = 0;
+	if (record.UserDataLength >= buffers_lost_offset + sizeof(ULONG))
+		buffers_lost = read_header_field(record, buffers_lost_offset);
+
+	set_header_losses_locked(input_index, read_header_field(record, header_events_lost_offset),
+		buffers_lost);
+}
+
+void loss_tracker::set_header_losses_locked(std::size_t input_index, std::uint64_t events_lost,
+	std::uint64_t buffers_lost)
+{
+	if (header_losses_.size() <= input_index)
+		header_losses_.resize(input_index + 1u);
+
+	//Every header of a log file carries the totals so far
+	auto& reported = header_losses_[input_index];
+	auto new_events_lost = events_lost > reported.first ? events_lost - reported.first : 0u;
+	auto new_buffers_lost = buffers_lost > reported.second ? buffers_lost - reported.second : 0u;
+	reported.first = (std::max)(reported.first, events_lost);
+	reported.second = (std::max)(reported.second, buffers_lost);
+	if (!new_events_lost && !new_buffers_lost)
+		return;
+
+	update_input(input_index, [new_events_lost, new_buffers_lost](loss_counters& counters)
+	{
+		counters.header_events_lost += new_events_lost;
+		counters.header_buffers_lost += new_buffers_lost;
+	});
+
+	if (metrics_)
+	{
+		metrics_->header_events_lost->increment(new_events_lost);
+		metrics_->header_buffers_lost->increment(new_buffers_lost);
+	}
+}
+
+void loss_tracker::expire_gaps(std::size_t input_index, sequence_state& state, bool all)
+{
+	std::uint64_t lost_count = 0;
+	while (!state.gaps.empty())
+	{
+		auto it = state.gaps.begin();
+		if (!all && state.gaps.size() <= max_pending_gap_count
+			&& state.highest - (*it).second <= reorder_window_)
+		{
+			break;
+		}
+
+		lost_count += (*it).second - (*it).first + 1u;
+		state.gaps.erase(it);
+	}
+
+	if (lost_count)
+		add_gap_events(input_index, lost_count);
+}
+
+void loss_tracker::add_gap_events(std::size_t input_index, std::uint64_t count)
+{
+	update_input(input_index, [count](loss_counters& counters)
+	{
+		counters.sequence_gap_events += count;
+	});
+
+	if (metrics_)
+		metrics_->sequence_gap_events->increment(count);
+}
+
+void loss_tracker::add_timestamp(std::int64_t timestamp) noexcept
+{
+	for (auto report : { &interval_, &totals_ })
+	{
+		if (!report->begin_timestamp || timestamp < report->begin_timestamp)
+			report->begin_timestamp = timestamp;
+
+		report->end_timestamp = (std::max)(report->end_timestamp, timestamp);
+	}
+}
+} //namespace event_tracing
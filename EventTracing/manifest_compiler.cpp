@@ -0,0 +1,797 @@
+#include "event_tracing/manifest_compiler.h"
+
+#include <codecvt>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "event_tracing/event_schema.h"
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/guid_helpers.h"
+
+namespace event_tracing
+{
+namespace
+{
+using ptree = boost::property_tree::ptree;
+
+struct named_value
+{
+	std::uint64_t value;
+	std::wstring display_name;
+};
+
+struct type_name
+{
+	const char* name;
+	USHORT type;
+};
+
+//Manifest types without the win: or xs: prefix
+const type_name in_types[] = {
+	{ "UnicodeString", TDH_INTYPE_UNICODESTRING },
+	{ "AnsiString", TDH_INTYPE_ANSISTRING },
+	{ "Int8", TDH_INTYPE_INT8 },
+	{ "UInt8", TDH_INTYPE_UINT8 },
+	{ "Int16", TDH_INTYPE_INT16 },
+	{ "UInt16", TDH_INTYPE_UINT16 },
+	{ "Int32", TDH_INTYPE_INT32 },
+	{ "UInt32", TDH_INTYPE_UINT32 },
+	{ "Int64", TDH_INTYPE_INT64 },
+	{ "UInt64", TDH_INTYPE_UINT64 },
+	{ "Float", TDH_INTYPE_FLOAT },
+	{ "Double", TDH_INTYPE_DOUBLE },
+	{ "Boolean", TDH_INTYPE_BOOLEAN },
+	{ "Binary", TDH_INTYPE_BINARY },
+	{ "GUID", TDH_INTYPE_GUID },
+	{ "Pointer", TDH_INTYPE_POINTER },
+	{ "FILETIME", TDH_INTYPE_FILETIME },
+	{ "SYSTEMTIME", TDH_INTYPE_SYSTEMTIME },
+	{ "SID", TDH_INTYPE_SID },
+	{ "HexInt32", TDH_INTYPE_HEXINT32 },
+	{ "HexInt64", TDH_INTYPE_HEXINT64 },
+	//Same layout as the counted strings of other decoding sources
+	{ "CountedUnicodeString", TDH_INTYPE_COUNTEDSTRING },
+	{ "CountedAnsiString", TDH_INTYPE_COUNTEDANSISTRING },
+	{ "CountedBinary", TDH_INTYPE_MANIFEST_COUNTEDBINARY }
+};
+
+const type_name out_types[] = {
+	{ "string", TDH_OUTTYPE_STRING },
+	{ "dateTime", TDH_OUTTYPE_DATETIME },
+	{ "byte", TDH_OUTTYPE_BYTE },
+	{ "unsignedByte", TDH_OUTTYPE_UNSIGNEDBYTE },
+	{ "short", TDH_OUTTYPE_SHORT },
+	{ "unsignedShort", TDH_OUTTYPE_UNSIGNEDSHORT },
+	{ "int", TDH_OUTTYPE_INT },
+	{ "unsignedInt", TDH_OUTTYPE_UNSIGNEDINT },
+	{ "long", TDH_OUTTYPE_LONG },
+	{ "unsignedLong", TDH_OUTTYPE_UNSIGNEDLONG },
+	{ "float", TDH_OUTTYPE_FLOAT },
+	{ "double", TDH_OUTTYPE_DOUBLE },
+	{ "boolean", TDH_OUTTYPE_BOOLEAN },
+	{ "GUID", TDH_OUTTYPE_GUID },
+	{ "hexBinary", TDH_OUTTYPE_HEXBINARY },
+	{ "HexInt8", TDH_OUTTYPE_HEXINT8 },
+	{ "HexInt16", TDH_OUTTYPE_HEXINT16 },
+	{ "HexInt32", TDH_OUTTYPE_HEXINT32 },
+	{ "HexInt64", TDH_OUTTYPE_HEXINT64 },
+	{ "PID", TDH_OUTTYPE_PID },
+	{ "TID", TDH_OUTTYPE_TID },
+	{ "Port", TDH_OUTTYPE_PORT },
+	{ "IPv4", TDH_OUTTYPE_IPV4 },
+	{ "IPv6", TDH_OUTTYPE_IPV6 },
+	{ "SocketAddress", TDH_OUTTYPE_SOCKETADDRESS },
+	{ "CIMDateTime", TDH_OUTTYPE_CIMDATETIME },
+	{ "ETWTIME", TDH_OUTTYPE_ETWTIME },
+	{ "Xml", TDH_OUTTYPE_XML },
+	{ "ErrorCode", TDH_OUTTYPE_ERRORCODE },
+	{ "Win32Error", TDH_OUTTYPE_WIN32ERROR },
+	{ "NTSTATUS", TDH_OUTTYPE_NTSTATUS },
+	{ "HResult", TDH_OUTTYPE_HRESULT },
+	{ "DateTimeCultureInsensitive", TDH_OUTTYPE_CULTURE_INSENSITIVE_DATETIME },
+	{ "Json", TDH_OUTTYPE_JSON },
+	{ "Utf8", TDH_OUTTYPE_UTF8 },
+	{ "Pkcs7WithTypeInfo", TDH_OUTTYPE_PKCS7_WITH_TYPE_INFO },
+	{ "CodePointer", TDH_OUTTYPE_CODE_POINTER },
+	{ "DateTimeUtc", TDH_OUTTYPE_DATETIME_UTC }
+};
+
+//Names defined in winmeta.xml, which manifests refer to without defining
+const std::map<std::string, named_value> standard_levels = {
+	{ "win:LogAlways", { 0, L"Log Always" } },
+	{ "win:Critical", { 1, L"Critical" } },
+	{ "win:Error", { 2, L"Error" } },
+	{ "win:Warning", { 3, L"Warning" } },
+	{ "win:Informational", { 4, L"Information" } },
+	{ "win:Verbose", { 5, L"Verbose" } }
+};
+
+const std::map<std::string, named_value> standard_opcodes = {
+	{ "win:Info", { 0, L"Info" } },
+	{ "win:Start", { 1, L"Start" } },
+	{ "win:Stop", { 2, L"Stop" } },
+	{ "win:DC_Start", { 3, L"DCStart" } },
+	{ "win:DC_Stop", { 4, L"DCStop" } },
+	{ "win:Extension", { 5, L"Extension" } },
+	{ "win:Reply", { 6, L"Reply" } },
+	{ "win:Resume", { 7, L"Resume" } },
+	{ "win:Suspend", { 8, L"Suspend" } },
+	{ "win:Send", { 9, L"Send" } },
+	{ "win:Receive", { 240, L"Receive" } }
+};
+
+//Channels without a value are numbered from here, as the message compiler does
+constexpr const std::uint64_t first_channel_value = 16;
+
+struct task_definition
+{
+	named_value task;
+	GUID event_guid;
+	std::map<std::string, named_value> opcodes;
+};
+
+struct property_definition
+{
+	std::wstring name;
+	std::wstring map_name;
+	ULONG flags = 0;
+	USHORT in_type = 0;
+	USHORT out_type = 0;
+	USHORT count = 1;
+	USHORT length = 0;
+	USHORT struct_start_index = 0;
+	USHORT struct_member_count = 0;
+};
+
+struct provider_definition
+{
+	GUID id;
+	std::wstring name;
+	std::wstring message;
+	std::map<std::string, named_value> levels;
+	std::map<std::string, named_value> channels;
+	std::map<std::string, named_value> opcodes;
+	std::map<std::string, named_value> keywords;
+	std::map<std::string, task_definition> tasks;
+	std::map<std::string, std::wstring> maps;
+	std::map<std::string, const ptree*> templates;
+};
+
+std::string get_local_name(const std::string& name)
+{
+	auto separator = name.rfind(':');
+	return separator == std::string::npos ? name : name.substr(separator + 1u);
+}
+
+const ptree* find_child(const ptree& node, const char* local_name)
+{
+	for (const auto& child : node)
+	{
+		if (get_local_name(child.first) == local_name)
+			return &child.second;
+	}
+
+	return nullptr;
+}
+
+template<typename Handler>
+void for_each_child(const ptree* node, const char* local_name, Handler&& handler)
+{
+	if (!node)
+		return;
+
+	for (const auto& child : *node)
+	{
+		if (get_local_name(child.first) == local_name)
+			handler(child.second);
+	}
+}
+
+boost::optional<std::string> find_attribute(const ptree& node, const char* name)
+{
+	return node.get_optional<std::string>(std::string("<xmlattr>.") + name);
+}
+
+std::string get_attribute(const ptree& node, const char* name)
+{
+	auto value = find_attribute(node, name);
+	if (!value)
+		throw event_trace_error(std::string("Manifest element lacks the ") + name + " attribute");
+
+	return *value;
+}
+
+std::wstring to_wstring(const std::string& text)
+{
+	try
+	{
+		return std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>>().from_bytes(text);
+	}
+	catch (const std::range_error&)
+	{
+		throw event_trace_error("Manifest text is not UTF-8: " + text);
+	}
+}
+
+std::uint64_t parse_number(const std::string& text)
+{
+	try
+	{
+		std::size_t end = 0;
+		auto is_hex = text.size() > 2u && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+		auto value = std::stoull(text, &end, is_hex ? 16 : 10);
+		if (end == text.size())
+			return value;
+	}
+	catch (const std::logic_error&)
+	{
+	}
+
+	throw event_trace_error("Invalid number in manifest: " + text);
+}
+
+bool is_number(const std::string& text)
+{
+	return !text.empty() && text.find_first_not_of("0123456789") == std::string::npos;
+}
+
+USHORT find_type(const type_name* begin, const type_name* end, const std::string& name)
+{
+	auto local_name = get_local_name(name);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (local_name == it->name)
+			return it->type;
+	}
+
+	throw event_trace_error("Unsupported manifest type: " + name);
+}
+
+const named_value& find_value(const std::map<std::string, named_value>& values,
+	const std::map<std::string, named_value>& standard_values, const std::string& name, const char* kind)
+{
+	auto it = values.find(name);
+	if (it != values.end())
+		return it->second;
+
+	it = standard_values.find(name);
+	if (it != standard_values.end())
+		return it->second;
+
+	throw event_trace_error(std::string("Undefined ") + kind + ": " + name);
+}
+
+class manifest_reader
+{
+public:
+	manifest_reader(std::vector<schema_pack_event>& events, std::vector<schema_pack_map>& maps)
+		: events_(events)
+		, maps_(maps)
+	{
+	}
+
+	void read(const ptree& manifest)
+	{
+		read_strings(manifest);
+		auto instrumentation = find_child(manifest, "instrumentation");
+		for_each_child(instrumentation ? find_child(*instrumentation, "events") : nullptr, "provider",
+			[this](const ptree& provider)
+		{
+			read_provider(provider);
+		});
+	}
+
+private:
+	void read_strings(const ptree& manifest)
+	{
+		const ptree* resources = nullptr;
+		for_each_child(find_child(manifest, "localization"), "resources", [&resources](const ptree& node)
+		{
+			if (!resources || find_attribute(node, "culture").value_or("") == "en-US")
+				resources = &node;
+		});
+
+		if (!resources)
+			return;
+
+		for_each_child(find_child(*resources, "stringTable"), "string", [this](const ptree& node)
+		{
+			strings_[get_attribute(node, "id")] = to_wstring(get_attribute(node, "value"));
+		});
+	}
+
+	//Messages are references to the string table
+	std::wstring get_message(const ptree& node) const
+	{
+		auto message = find_attribute(node, "message");
+		if (!message)
+			return std::wstring();
+
+		static const std::string prefix = "$(string.";
+		if (message->compare(0, prefix.size(), prefix) || message->back() != ')')
+			return to_wstring(*message);
+
+		auto id = message->substr(prefix.size(), message->size() - prefix.size() - 1u);
+		auto it = strings_.find(id);
+		if (it == strings_.end())
+			throw event_trace_error("Undefined string: " + id);
+
+		return it->second;
+	}
+
+	named_value read_value(const ptree& node, const char* value_attribute)
+	{
+		auto message = get_message(node);
+		return { parse_number(get_attribute(node, value_attribute)),
+			message.empty() ? to_wstring(get_attribute(node, "name")) : message };
+	}
+
+	void read_provider(const ptree& node)
+	{
+		provider_definition provider;
+		provider.id = ms_guid(to_wstring(get_attribute(node, "guid"))).native();
+		provider.name = to_wstring(get_attribute(node, "name"));
+		provider.message = get_message(node);
+
+		for_each_child(find_child(node, "levels"), "level", [this, &provider](const ptree& level)
+		{
+			provider.levels[get_attribute(level, "name")] = read_value(level, "value");
+		});
+
+		for_each_child(find_child(node, "opcodes"), "opcode", [this, &provider](const ptree& opcode)
+		{
+			provider.opcodes[get_attribute(opcode, "name")] = read_value(opcode, "value");
+		});
+
+		for_each_child(find_child(node, "keywords"), "keyword", [this, &provider](const ptree& keyword)
+		{
+			provider.keywords[get_attribute(keyword, "name")] = read_value(keyword, "mask");
+		});
+
+		for_each_child(find_child(node, "tasks"), "task", [this, &provider](const ptree& task)
+		{
+			task_definition definition{ read_value(task, "value"), GUID{}, {} };
+			auto event_guid = find_attribute(task, "eventGUID");
+			if (event_guid)
+				definition.event_guid = ms_guid(to_wstring(*event_guid)).native();
+
+			for_each_child(find_child(task, "opcodes"), "opcode", [this, &definition](const ptree& opcode)
+			{
+				definition.opcodes[get_attribute(opcode, "name")] = read_value(opcode, "value");
+			});
+
+			provider.tasks[get_attribute(task, "name")] = std::move(definition);
+		});
+
+		read_channels(node, provider);
+		read_maps(node, provider);
+
+		for_each_child(find_child(node, "templates"), "template", [&provider](const ptree& template_node)
+		{
+			provider.templates[get_attribute(template_node, "tid")] = &template_node;
+		});
+
+		for_each_child(find_child(node, "events"), "event", [this, &provider](const ptree& event)
+		{
+			read_event(event, provider);
+		});
+	}
+
+	void read_channels(const ptree& node, provider_definition& provider)
+	{
+		auto next_value = first_channel_value;
+		auto add_channel = [this, &provider, &next_value](const ptree& channel)
+		{
+			auto value = find_attribute(channel, "value");
+			named_value definition{ value ? parse_number(*value) : next_value, get_message(channel) };
+			next_value = definition.value + 1u;
+			auto name = get_attribute(channel, "name");
+			if (definition.display_name.empty())
+				definition.display_name = to_wstring(name);
+
+			//Events refer to channels by id, or by name if the id is not set
+			provider.channels[find_attribute(channel, "chid").value_or(name)] = definition;
+			provider.channels[name] = definition;
+		};
+
+		auto channels = find_child(node, "channels");
+		for_each_child(channels, "importChannel", add_channel);
+		for_each_child(channels, "channel", add_channel);
+	}
+
+	void read_maps(const ptree& node, provider_definition& provider)
+	{
+		auto maps = find_child(node, "maps");
+		auto read_map = [this, &provider](const ptree& map, MAP_FLAGS flag)
+		{
+			auto name = get_attribute(map, "name");
+			std::vector<std::pair<ULONG, std::wstring>> entries;
+			for_each_child(&map, "map", [this, &entries](const ptree& entry)
+			{
+				auto message = get_message(entry);
+				if (message.empty())
+					throw event_trace_error("Map entry lacks a message");
+
+				entries.emplace_back(static_cast<ULONG>(parse_number(get_attribute(entry, "value"))),
+					std::move(message));
+			});
+
+			schema_pack_map result{ provider.id, to_wstring(name), {} };
+			auto entries_offset = offsetof(EVENT_MAP_INFO, MapEntryArray);
+			result.info.resize(entries_offset + entries.size() * sizeof(EVENT_MAP_ENTRY));
+			auto name_offset = append_string(result.info, result.name);
+			std::vector<ULONG> entry_offsets;
+			for (const auto& entry : entries)
+				entry_offsets.push_back(append_string(result.info, entry.second));
+
+			auto info = reinterpret_cast<EVENT_MAP_INFO*>(result.info.data());
+			info->NameOffset = name_offset;
+			info->Flag = flag;
+			info->EntryCount = static_cast<ULONG>(entries.size());
+			info->MapEntryValueType = EVENTMAP_ENTRY_VALUETYPE_ULONG;
+			for (std::size_t i = 0; i != entries.size(); ++i)
+			{
+				info->MapEntryArray[i].OutputOffset = entry_offsets[i];
+				info->MapEntryArray[i].Value = entries[i].first;
+			}
+
+			provider.maps[name] = result.name;
+			maps_.push_back(std::move(result));
+		};
+
+		for_each_child(maps, "valueMap", [&read_map](const ptree& map)
+		{
+			read_map(map, EVENTMAP_INFO_FLAG_MANIFEST_VALUEMAP);
+		});
+
+		for_each_child(maps, "bitMap", [&read_map](const ptree& map)
+		{
+			read_map(map, EVENTMAP_INFO_FLAG_MANIFEST_BITMAP);
+		});
+	}
+
+	void read_event(const ptree& node, const provider_definition& provider)
+	{
+		schema_pack_event event{ provider.id, EVENT_DESCRIPTOR{}, {} };
+		auto& descriptor = event.descriptor;
+		descriptor.Id = static_cast<USHORT>(parse_number(get_attribute(node, "value")));
+		descriptor.Version = static_cast<UCHAR>(parse_number(find_attribute(node, "version").value_or("0")));
+
+		static const std::map<std::string, named_value> no_values;
+		std::wstring level_name;
+		auto level = find_attribute(node, "level");
+		if (level)
+		{
+			const auto& value = find_value(provider.levels, standard_levels, *level, "level");
+			descriptor.Level = static_cast<UCHAR>(value.value);
+			level_name = value.display_name;
+		}
+
+		std::wstring channel_name;
+		auto channel = find_attribute(node, "channel");
+		if (channel)
+		{
+			const auto& value = find_value(provider.channels, no_values, *channel, "channel");
+			descriptor.Channel = static_cast<UCHAR>(value.value);
+			channel_name = value.display_name;
+		}
+
+		std::wstring task_name;
+		GUID event_guid{};
+		const task_definition* task_info = nullptr;
+		auto task = find_attribute(node, "task");
+		if (task)
+		{
+			auto it = provider.tasks.find(*task);
+			if (it == provider.tasks.end())
+				throw event_trace_error("Undefined task: " + *task);
+
+			task_info = &it->second;
+			descriptor.Task = static_cast<USHORT>(task_info->task.value);
+			task_name = task_info->task.display_name;
+			event_guid = task_info->event_guid;
+		}
+
+		std::wstring opcode_name;
+		auto opcode = find_attribute(node, "opcode");
+		if (opcode)
+		{
+			//Opcodes of the task hide the ones of the provider
+			auto it = task_info ? task_info->opcodes.find(*opcode) : provider.opcodes.end();
+			const auto& value = task_info && it != task_info->opcodes.end()
+				? it->second : find_value(provider.opcodes, standard_opcodes, *opcode, "opcode");
+			descriptor.Opcode = static_cast<UCHAR>(value.value);
+			opcode_name = value.display_name;
+		}
+
+		//Keyword names are a list of strings ending with an empty one
+		std::wstring keyword_names;
+		std::istringstream keywords(find_attribute(node, "keywords").value_or(""));
+		std::string keyword;
+		while (keywords >> keyword)
+		{
+			const auto& value = find_value(provider.keywords, no_values, keyword, "keyword");
+			descriptor.Keyword |= value.value;
+			keyword_names += value.display_name;
+			keyword_names += L'\0';
+		}
+
+		std::vector<property_definition> properties;
+		ULONG top_level_count = 0;
+		auto template_id = find_attribute(node, "template");
+		if (template_id)
+		{
+			auto it = provider.templates.find(*template_id);
+			if (it == provider.templates.end())
+				throw event_trace_error("Undefined template: " + *template_id);
+
+			read_template(*it->second, provider, properties, top_level_count);
+		}
+
+		auto properties_offset = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray);
+		event.info.resize(properties_offset + properties.size() * sizeof(EVENT_PROPERTY_INFO));
+		TRACE_EVENT_INFO header{};
+		header.ProviderGuid = provider.id;
+		header.EventGuid = event_guid;
+		header.EventDescriptor = descriptor;
+		header.DecodingSource = DecodingSourceXMLFile;
+		header.ProviderNameOffset = append_string(event.info, provider.name);
+		header.LevelNameOffset = append_string(event.info, level_name);
+		header.ChannelNameOffset = append_string(event.info, channel_name);
+		if (!keyword_names.empty())
+		{
+			keyword_names += L'\0';
+			header.KeywordsNameOffset = append_string(event.info, keyword_names);
+		}
+
+		header.TaskNameOffset = append_string(event.info, task_name);
+		header.OpcodeNameOffset = append_string(event.info, opcode_name);
+		header.EventMessageOffset = append_string(event.info, get_message(node));
+		header.ProviderMessageOffset = append_string(event.info, provider.message);
+		header.PropertyCount = static_cast<ULONG>(properties.size());
+		header.TopLevelPropertyCount = top_level_count;
+		header.Flags = template_id ? TEMPLATE_EVENT_DATA : static_cast<TEMPLATE_FLAGS>(0);
+
+		std::vector<EVENT_PROPERTY_INFO> property_infos;
+		for (const auto& property : properties)
+		{
+			EVENT_PROPERTY_INFO info{};
+			info.Flags = static_cast<PROPERTY_FLAGS>(property.flags);
+			info.NameOffset = append_string(event.info, property.name);
+			if (property.flags & PropertyStruct)
+			{
+				info.structType.StructStartIndex = property.struct_start_index;
+				info.structType.NumOfStructMembers = property.struct_member_count;
+			}
+			else
+			{
+				info.nonStructType.InType = property.in_type;
+				info.nonStructType.OutType = property.out_type;
+				info.nonStructType.MapNameOffset = append_string(event.info, property.map_name);
+			}
+
+			info.count = property.count;
+			info.length = property.length;
+			property_infos.push_back(info);
+		}
+
+		std::memcpy(event.info.data(), &header, properties_offset);
+		if (!property_infos.empty())
+		{
+			std::memcpy(event.info.data() + properties_offset, property_infos.data(),
+				property_infos.size() * sizeof(EVENT_PROPERTY_INFO));
+		}
+
+		events_.push_back(std::move(event));
+	}
+
+	//Top-level properties come first, members of each struct follow them,
+	//as in the layout TDH returns
+	void read_template(const ptree& node, const provider_definition& provider,
+		std::vector<property_definition>& properties, ULONG& top_level_count)
+	{
+		std::vector<const ptree*> structs;
+		top_level_count_ = 0;
+		for (const auto& child : node)
+		{
+			auto name = get_local_name(child.first);
+			if (name == "data")
+			{
+				properties.push_back(read_data(child.second, provider, properties, 0));
+			}
+			else if (name == "struct")
+			{
+				property_definition property;
+				property.name = to_wstring(get_attribute(child.second, "name"));
+				property.flags = PropertyStruct;
+				read_count(child.second, property, properties, 0);
+				properties.push_back(property);
+				structs.push_back(&child.second);
+			}
+			else if (name != "<xmlattr>" && name != "UserData" && name != "<xmlcomment>")
+			{
+				throw event_trace_error("Unsupported template element: " + name);
+			}
+		}
+
+		top_level_count = static_cast<ULONG>(properties.size());
+		top_level_count_ = properties.size();
+		std::size_t struct_index = 0;
+		for (ULONG i = 0; i != top_level_count; ++i)
+		{
+			if (!(properties[i].flags & PropertyStruct))
+				continue;
+
+			auto start_index = properties.size();
+			for_each_child(structs[struct_index++], "data", [this, &provider, &properties, start_index](const ptree& member)
+			{
+				properties.push_back(read_data(member, provider, properties, start_index));
+			});
+
+			properties[i].struct_start_index = static_cast<USHORT>(start_index);
+			properties[i].struct_member_count = static_cast<USHORT>(properties.size() - start_index);
+		}
+
+		if (properties.size() > 0xffffu)
+			throw event_trace_error("Template has too many properties");
+	}
+
+	//Count and length properties are looked up among the preceding
+	//members of the scope, then among the top-level properties
+	USHORT find_property(const std::vector<property_definition>& properties,
+		std::size_t scope_start, const std::string& name) const
+	{
+		auto wide_name = to_wstring(name);
+		for (auto i = properties.size(); i != scope_start; --i)
+		{
+			if (!(properties[i - 1u].flags & PropertyStruct) && properties[i - 1u].name == wide_name)
+				return static_cast<USHORT>(i - 1u);
+		}
+
+		for (std::size_t i = 0; scope_start && i != top_level_count_; ++i)
+		{
+			if (!(properties[i].flags & PropertyStruct) && properties[i].name == wide_name)
+				return static_cast<USHORT>(i);
+		}
+
+		throw event_trace_error("Undefined count or length property: " + name);
+	}
+
+	void read_count(const ptree& node, property_definition& property,
+		const std::vector<property_definition>& properties, std::size_t scope_start) const
+	{
+		auto count = find_attribute(node, "count");
+		if (!count)
+			return;
+
+		if (is_number(*count))
+		{
+			property.count = static_cast<USHORT>(parse_number(*count));
+			property.flags |= PropertyParamFixedCount;
+		}
+		else
+		{
+			property.count = find_property(properties, scope_start, *count);
+			property.flags |= PropertyParamCount;
+		}
+	}
+
+	property_definition read_data(const ptree& node, const provider_definition& provider,
+		const std::vector<property_definition>& properties, std::size_t scope_start) const
+	{
+		property_definition property;
+		property.name = to_wstring(get_attribute(node, "name"));
+		property.in_type = find_type(std::begin(in_types), std::end(in_types), get_attribute(node, "inType"));
+		auto out_type = find_attribute(node, "outType");
+		if (out_type)
+			property.out_type = find_type(std::begin(out_types), std::end(out_types), *out_type);
+
+		auto map = find_attribute(node, "map");
+		if (map)
+		{
+			auto it = provider.maps.find(*map);
+			if (it == provider.maps.end())
+				throw event_trace_error("Undefined map: " + *map);
+
+			property.map_name = it->second;
+		}
+
+		read_count(node, property, properties, scope_start);
+		property.length = static_cast<USHORT>(get_fixed_type_size(property.in_type));
+		auto length = find_attribute(node, "length");
+		if (length)
+		{
+			if (is_number(*length))
+			{
+				property.length = static_cast<USHORT>(parse_number(*length));
+				property.flags |= PropertyParamFixedLength;
+			}
+			else
+			{
+				property.length = find_property(properties, scope_start, *length);
+				property.flags |= PropertyParamLength;
+			}
+		}
+
+		return property;
+	}
+
+	//Returns the offset of the string, zero for an empty one
+	static ULONG append_string(std::vector<std::uint8_t>& data, const std::wstring& text)
+	{
+		if (text.empty())
+			return 0;
+
+		auto offset = data.size();
+		auto size = (text.size() + 1u) * sizeof(wchar_t);
+		data.resize(offset + size);
+		std::memcpy(data.data() + offset, text.c_str(), size);
+		return static_cast<ULONG>(offset);
+	}
+
+private:
+	std::vector<schema_pack_event>& events_;
+	std::vector<schema_pack_map>& maps_;
+	std::map<std::string, std::wstring> strings_;
+	//Top-level properties of the template being read
+	std::size_t top_level_count_ = 0;
+};
+} //namespace
+
+void manifest_compiler::add_manifest(std::istream& stream)
+{
+	ptree tree;
+	try
+	{
+		boost::property_tree::read_xml(stream, tree, boost::property_tree::xml_parser::no_comments);
+	}
+	catch (const boost::property_tree::xml_parser_error& e)
+	{
+		throw event_trace_error(std::string("Unable to parse manifest: ") + e.what());
+	}
+
+	auto manifest = find_child(tree, "instrumentationManifest");
+	if (!manifest)
+		throw event_trace_error("Not an instrumentation manifest");
+
+	//Nothing is added from a manifest with errors
+	std::vector<schema_pack_event> events;
+	std::vector<schema_pack_map> maps;
+	manifest_reader(events, maps).read(*manifest);
+	events_.insert(events_.end(), std::make_move_iterator(events.begin()), std::make_move_iterator(events.end()));
+	maps_.insert(maps_.end(), std::make_move_iterator(maps.begin()), std::make_move_iterator(maps.end()));
+}
+
+void manifest_compiler::add_manifest_file(const std::string& file_name)
+{
+	std::ifstream file(file_name, std::ios::binary);
+	if (!file)
+		throw event_trace_error("Unable to open manifest: " + file_name);
+
+	add_manifest(file);
+}
+
+void manifest_compiler::write_schema_pack(const std::string& file_name) const
+{
+	std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+	if (!file)
+		throw event_trace_error("Unable to create schema pack: " + file_name);
+
+	event_tracing::write_schema_pack(events_, maps_, file);
+}
+} //namespace event_tracing
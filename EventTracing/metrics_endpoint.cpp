@@ -0,0 +1,172 @@
+#include "event_tracing/metrics_endpoint.h"
+
+#include <cassert>
+#include <istream>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace
+{
+//Requests are only read up to the end of the headers
+constexpr const std::size_t max_request_size = 8192;
+
+class connection : public std::enable_shared_from_this<connection>
+{
+public:
+	connection(boost::asio::ip::tcp::socket&& socket, const metrics_registry& registry)
+		: socket_(std::move(socket))
+		, registry_(registry)
+		, request_(max_request_size)
+	{
+	}
+
+	void start()
+	{
+		auto self = shared_from_this();
+		boost::asio::async_read_until(socket_, request_, "\r\n\r\n",
+			[self](const boost::system::error_code& error, std::size_t)
+		{
+			if (!error)
+				self->respond();
+		});
+	}
+
+private:
+	void respond()
+	{
+		std::string request_line;
+		std::istream request_stream(&request_);
+		std::getline(request_stream, request_line);
+
+		std::string body;
+		const char* status = "404 Not Found";
+		if (request_line.compare(0, 13, "GET /metrics ") == 0)
+		{
+			status = "200 OK";
+			registry_.write_text(body);
+		}
+
+		response_ = std::string("HTTP/1.1 ") + status
+			+ "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+			+ std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+		auto self = shared_from_this();
+		boost::asio::async_write(socket_, boost::asio::buffer(response_),
+			[self](const boost::system::error_code&, std::size_t)
+		{
+			boost::system::error_code ignored;
+			self->socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+		});
+	}
+
+private:
+	boost::asio::ip::tcp::socket socket_;
+	const metrics_registry& registry_;
+	boost::asio::streambuf request_;
+	std::string response_;
+};
+} //namespace
+
+class metrics_endpoint::server
+{
+public:
+	server(const metrics_registry& registry, unsigned short port)
+		: registry_(registry)
+		, acceptor_(io_context_)
+	{
+		boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+		boost::system::error_code error;
+		acceptor_.open(endpoint.protocol(), error);
+		if (!error)
+			acceptor_.bind(endpoint, error);
+		if (!error)
+			acceptor_.listen(boost::asio::socket_base::max_listen_connections, error);
+		if (error)
+			throw event_trace_error("Unable to open metrics endpoint", error.value());
+
+		accept();
+	}
+
+	unsigned short get_port() const noexcept
+	{
+		boost::system::error_code error;
+		return acceptor_.local_endpoint(error).port();
+	}
+
+	void run()
+	{
+		io_context_.run();
+	}
+
+	void stop()
+	{
+		io_context_.stop();
+	}
+
+private:
+	void accept()
+	{
+		acceptor_.async_accept([this](const boost::system::error_code& error,
+			boost::asio::ip::tcp::socket socket)
+		{
+			if (error == boost::asio::error::operation_aborted)
+				return;
+
+			if (!error)
+				std::make_shared<connection>(std::move(socket), registry_)->start();
+
+			accept();
+		});
+	}
+
+private:
+	const metrics_registry& registry_;
+	boost::asio::io_context io_context_;
+	boost::asio::ip::tcp::acceptor acceptor_;
+};
+
+metrics_endpoint::metrics_endpoint(const metrics_registry& registry, unsigned short port)
+	: server_(std::make_unique<server>(registry, port))
+{
+}
+
+metrics_endpoint::~metrics_endpoint()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+		assert(false);
+	}
+}
+
+unsigned short metrics_endpoint::get_port() const noexcept
+{
+	return server_->get_port();
+}
+
+void metrics_endpoint::run_async()
+{
+	if (server_thread_.joinable())
+		return;
+
+	server_thread_ = std::thread([this]
+	{
+		server_->run();
+	});
+}
+
+void metrics_endpoint::stop()
+{
+	server_->stop();
+	if (server_thread_.joinable())
+		server_thread_.join();
+}
+} //namespace event_tracing
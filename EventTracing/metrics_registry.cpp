@@ -0,0 +1,207 @@
+#include "event_tracing/metrics_registry.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace event_tracing
+{
+namespace
+{
+std::unique_ptr<std::atomic<std::uint64_t>[]> make_cells(std::size_t count)
+{
+	std::unique_ptr<std::atomic<std::uint64_t>[]> result(new std::atomic<std::uint64_t>[count]);
+	for (std::size_t i = 0; i != count; ++i)
+		result[i].store(0, std::memory_order_relaxed);
+
+	return result;
+}
+
+void write_sample(std::string& result, const std::string& name, const char* suffix,
+	const std::string& labels, const std::string& extra_label, const std::string& value)
+{
+	result += name;
+	result += suffix;
+	if (!labels.empty() || !extra_label.empty())
+	{
+		result += '{';
+		result += labels;
+		if (!labels.empty() && !extra_label.empty())
+			result += ',';
+
+		result += extra_label;
+		result += '}';
+	}
+
+	result += ' ';
+	result += value;
+	result += '\n';
+}
+} //namespace
+
+const std::size_t metric_counter::cell_stride;
+
+metric_counter::metric_counter()
+	: cells_(make_cells(metric_shard_count * cell_stride))
+{
+}
+
+std::uint64_t metric_counter::get_value() const noexcept
+{
+	std::uint64_t result = 0;
+	for (std::size_t i = 0; i != metric_shard_count; ++i)
+		result += cells_[i * cell_stride].load(std::memory_order_relaxed);
+
+	return result;
+}
+
+metric_histogram::metric_histogram(const std::vector<std::uint64_t>& bounds)
+	: bounds_(bounds)
+	//Shards are at least a cache line apart
+	, stride_((bounds.size() + 2u + 7u) / 8u * 8u + 8u)
+	, cells_(make_cells(metric_shard_count * stride_))
+{
+	if (!std::is_sorted(bounds_.cbegin(), bounds_.cend()))
+		throw std::invalid_argument("Histogram bounds must be ascending");
+}
+
+metric_histogram::snapshot metric_histogram::get_snapshot() const
+{
+	snapshot result;
+	result.bucket_counts.resize(bounds_.size() + 1u);
+	for (std::size_t shard = 0; shard != metric_shard_count; ++shard)
+	{
+		auto cells = cells_.get() + shard * stride_;
+		for (std::size_t i = 0; i != result.bucket_counts.size(); ++i)
+			result.bucket_counts[i] += cells[i].load(std::memory_order_relaxed);
+
+		result.sum += cells[bounds_.size() + 1u].load(std::memory_order_relaxed);
+	}
+
+	for (std::size_t i = 1; i < result.bucket_counts.size(); ++i)
+		result.bucket_counts[i] += result.bucket_counts[i - 1u];
+
+	return result;
+}
+
+metric_counter& metrics_registry::add_counter(const std::string& name, const std::string& help,
+	const std::string& labels)
+{
+	auto counter = std::make_unique<metric_counter>();
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& value = add_metric(metric_type::counter, name, help, labels);
+	value.counter = std::move(counter);
+	return *value.counter;
+}
+
+metric_gauge& metrics_registry::add_gauge(const std::string& name, const std::string& help,
+	const std::string& labels)
+{
+	auto gauge = std::make_unique<metric_gauge>();
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& value = add_metric(metric_type::gauge, name, help, labels);
+	value.gauge = std::move(gauge);
+	return *value.gauge;
+}
+
+metric_histogram& metrics_registry::add_histogram(const std::string& name, const std::string& help,
+	const std::vector<std::uint64_t>& bounds, const std::string& labels)
+{
+	auto histogram = std::make_unique<metric_histogram>(bounds);
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& value = add_metric(metric_type::histogram, name, help, labels);
+	value.histogram = std::move(histogram);
+	return *value.histogram;
+}
+
+metrics_registry::metric& metrics_registry::add_metric(metric_type type, const std::string& name,
+	const std::string& help, const std::string& labels)
+{
+	metrics_.push_back(std::make_unique<metric>());
+	auto& result = *metrics_.back();
+	result.type = type;
+	result.name = name;
+	result.help = help;
+	result.labels = labels;
+	return result;
+}
+
+const char* metrics_registry::get_type_name(metric_type type) noexcept
+{
+	switch (type)
+	{
+	case metric_type::counter:
+		return "counter";
+
+	case metric_type::gauge:
+		return "gauge";
+
+	default:
+		break;
+	}
+
+	return "histogram";
+}
+
+void metrics_registry::write_text(std::string& result) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	//Samples of one metric name must be written together
+	std::vector<const metric*> sorted;
+	sorted.reserve(metrics_.size());
+	for (const auto& value : metrics_)
+		sorted.push_back(value.get());
+
+	std::stable_sort(sorted.begin(), sorted.end(), [](const metric* left, const metric* right)
+	{
+		return left->name < right->name;
+	});
+
+	const std::string no_label;
+	const std::string* previous_name = nullptr;
+	for (auto value : sorted)
+	{
+		if (!previous_name || *previous_name != value->name)
+		{
+			result += "# HELP " + value->name + ' ' + value->help + '\n';
+			result += "# TYPE " + value->name + ' ';
+			result += get_type_name(value->type);
+			result += '\n';
+			previous_name = &value->name;
+		}
+
+		switch (value->type)
+		{
+		case metric_type::counter:
+			write_sample(result, value->name, "", value->labels, no_label,
+				std::to_string(value->counter->get_value()));
+			break;
+
+		case metric_type::gauge:
+			write_sample(result, value->name, "", value->labels, no_label,
+				std::to_string(value->gauge->get_value()));
+			break;
+
+		case metric_type::histogram:
+			{
+				auto snapshot = value->histogram->get_snapshot();
+				const auto& bounds = value->histogram->get_bounds();
+				for (std::size_t i = 0; i != snapshot.bucket_counts.size(); ++i)
+				{
+					auto bound = i == bounds.size() ? std::string("+Inf") : std::to_string(bounds[i]);
+					write_sample(result, value->name, "_bucket", value->labels, "le=\"" + bound + '"',
+						std::to_string(snapshot.bucket_counts[i]));
+				}
+
+				write_sample(result, value->name, "_sum", value->labels, no_label,
+					std::to_string(snapshot.sum));
+				write_sample(result, value->name, "_count", value->labels, no_label,
+					std::to_string(snapshot.bucket_counts.back()));
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+} //namespace event_tracing
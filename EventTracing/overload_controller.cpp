@@ -0,0 +1,63 @@
+#include "event_tracing/overload_controller.h"
+
+#include <algorithm>
+
+namespace event_tracing
+{
+overload_controller::overload_controller(const overload_policy& policy)
+	: policy_(policy)
+	//The first overloaded event raises the level right away
+	, events_since_change_(policy.level_interval)
+{
+	//Sampling rate must fit the counters
+	policy_.max_level = (std::min)(policy_.max_level, 63u);
+}
+
+std::size_t overload_controller::add_class()
+{
+	counters_.emplace_back();
+	return counters_.size() - 1u;
+}
+
+bool overload_controller::observe(std::size_t queue_depth, std::chrono::nanoseconds lag) noexcept
+{
+	if (events_since_change_ < policy_.level_interval)
+		++events_since_change_;
+
+	if (events_since_change_ < policy_.level_interval)
+		return false;
+
+	if (queue_depth >= policy_.queue_depth_high || lag >= policy_.lag_high)
+	{
+		if (level_ == policy_.max_level)
+			return false;
+
+		++level_;
+	}
+	else if (queue_depth <= policy_.queue_depth_low && lag <= policy_.lag_low)
+	{
+		if (!level_)
+			return false;
+
+		--level_;
+	}
+	else
+	{
+		return false;
+	}
+
+	events_since_change_ = 0;
+	return true;
+}
+
+bool overload_controller::admit(std::size_t event_class) noexcept
+{
+	auto& counters = counters_[event_class];
+	auto index = counters.seen++;
+	if (index & (get_sampling_rate() - 1u))
+		return false;
+
+	++counters.admitted;
+	return true;
+}
+} //namespace event_tracing
@@ -0,0 +1,315 @@
+#include "event_tracing/schema_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace
+{
+constexpr const std::uint64_t data_alignment = 8;
+
+constexpr std::uint64_t align_offset(std::uint64_t offset) noexcept
+{
+	return (offset + data_alignment - 1u) & ~(data_alignment - 1u);
+}
+
+int compare_guids(const GUID& left, const GUID& right) noexcept
+{
+	return std::memcmp(&left, &right, sizeof(GUID));
+}
+
+std::tuple<USHORT, UCHAR, UCHAR> get_descriptor_key(USHORT id, UCHAR version, UCHAR opcode) noexcept
+{
+	return std::make_tuple(id, version, opcode);
+}
+
+int compare_names(const wchar_t* left, std::size_t left_length,
+	const wchar_t* right, std::size_t right_length) noexcept
+{
+	auto result = std::char_traits<wchar_t>::compare(left, right, (std::min)(left_length, right_length));
+	if (result)
+		return result;
+
+	return left_length < right_length ? -1 : (left_length > right_length ? 1 : 0);
+}
+
+void write_data(std::ostream& stream, const void* data, std::size_t size, std::uint64_t& offset)
+{
+	stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	offset += size;
+}
+
+void write_padding(std::ostream& stream, std::uint64_t& offset)
+{
+	static const char zeros[data_alignment] = {};
+	write_data(stream, zeros, static_cast<std::size_t>(align_offset(offset) - offset), offset);
+}
+} //namespace
+
+void write_schema_pack(std::vector<schema_pack_event> events,
+	std::vector<schema_pack_map> maps, std::ostream& stream)
+{
+	std::sort(events.begin(), events.end(), [](const schema_pack_event& left, const schema_pack_event& right)
+	{
+		auto result = compare_guids(left.provider_id, right.provider_id);
+		if (result)
+			return result < 0;
+
+		return get_descriptor_key(left.descriptor.Id, left.descriptor.Version, left.descriptor.Opcode)
+			< get_descriptor_key(right.descriptor.Id, right.descriptor.Version, right.descriptor.Opcode);
+	});
+
+	std::sort(maps.begin(), maps.end(), [](const schema_pack_map& left, const schema_pack_map& right)
+	{
+		auto result = compare_guids(left.provider_id, right.provider_id);
+		if (result)
+			return result < 0;
+
+		return left.name < right.name;
+	});
+
+	for (std::size_t i = 1; i < events.size(); ++i)
+	{
+		const auto& left = events[i - 1u];
+		const auto& right = events[i];
+		if (!compare_guids(left.provider_id, right.provider_id) && left.descriptor.Id == right.descriptor.Id
+			&& left.descriptor.Version == right.descriptor.Version
+			&& left.descriptor.Opcode == right.descriptor.Opcode)
+		{
+			throw event_trace_error("Event " + std::to_string(right.descriptor.Id)
+				+ " version " + std::to_string(right.descriptor.Version) + " is defined twice");
+		}
+	}
+
+	for (std::size_t i = 1; i < maps.size(); ++i)
+	{
+		if (!compare_guids(maps[i - 1u].provider_id, maps[i].provider_id) && maps[i - 1u].name == maps[i].name)
+			throw event_trace_error("Map is defined twice");
+	}
+
+	schema_pack_header header{};
+	header.magic = schema_pack_magic;
+	header.version = schema_pack_version;
+	header.event_count = static_cast<std::uint32_t>(events.size());
+	header.map_count = static_cast<std::uint32_t>(maps.size());
+	header.events_offset = align_offset(sizeof(header));
+	header.maps_offset = align_offset(header.events_offset + events.size() * sizeof(schema_pack_event_entry));
+
+	auto offset = align_offset(header.maps_offset + maps.size() * sizeof(schema_pack_map_entry));
+	std::vector<schema_pack_event_entry> event_entries;
+	event_entries.reserve(events.size());
+	for (const auto& event : events)
+	{
+		schema_pack_event_entry entry{};
+		entry.provider_id = event.provider_id;
+		entry.id = event.descriptor.Id;
+		entry.version = event.descriptor.Version;
+		entry.opcode = event.descriptor.Opcode;
+		entry.info_size = static_cast<std::uint32_t>(event.info.size());
+		entry.info_offset = offset;
+		event_entries.push_back(entry);
+		offset = align_offset(offset + event.info.size());
+	}
+
+	std::vector<schema_pack_map_entry> map_entries;
+	map_entries.reserve(maps.size());
+	for (const auto& map : maps)
+	{
+		schema_pack_map_entry entry{};
+		entry.provider_id = map.provider_id;
+		entry.name_length = static_cast<std::uint32_t>(map.name.size());
+		entry.info_size = static_cast<std::uint32_t>(map.info.size());
+		entry.info_offset = offset;
+		offset = align_offset(offset + map.info.size());
+		entry.name_offset = offset;
+		offset = align_offset(offset + (map.name.size() + 1u) * sizeof(wchar_t));
+		map_entries.push_back(entry);
+	}
+
+	header.size = offset;
+
+	std::uint64_t written = 0;
+	write_data(stream, &header, sizeof(header), written);
+	write_padding(stream, written);
+	if (!event_entries.empty())
+		write_data(stream, event_entries.data(), event_entries.size() * sizeof(schema_pack_event_entry), written);
+	write_padding(stream, written);
+	if (!map_entries.empty())
+		write_data(stream, map_entries.data(), map_entries.size() * sizeof(schema_pack_map_entry), written);
+	write_padding(stream, written);
+
+	for (const auto& event : events)
+	{
+		write_data(stream, event.info.data(), event.info.size(), written);
+		write_padding(stream, written);
+	}
+
+	for (const auto& map : maps)
+	{
+		write_data(stream, map.info.data(), map.info.size(), written);
+		write_padding(stream, written);
+		write_data(stream, map.name.c_str(), (map.name.size() + 1u) * sizeof(wchar_t), written);
+		write_padding(stream, written);
+	}
+
+	if (!stream)
+		throw event_trace_error("Unable to write schema pack");
+}
+
+class schema_pack::mapping
+{
+public:
+	explicit mapping(const std::string& file_name)
+	try
+		: file_(file_name.c_str(), boost::interprocess::read_only)
+		, region_(file_, boost::interprocess::read_only)
+	{
+	}
+	catch (const boost::interprocess::interprocess_exception& e)
+	{
+		throw event_trace_error(std::string("Unable to map schema pack: ") + e.what(),
+			static_cast<std::uint32_t>(e.get_native_error()));
+	}
+
+	const std::uint8_t* get_address() const noexcept
+	{
+		return static_cast<const std::uint8_t*>(region_.get_address());
+	}
+
+	std::size_t get_size() const noexcept
+	{
+		return region_.get_size();
+	}
+
+private:
+	boost::interprocess::file_mapping file_;
+	boost::interprocess::mapped_region region_;
+};
+
+schema_pack::schema_pack(const std::string& file_name)
+	: mapping_(std::make_unique<mapping>(file_name))
+	, data_(mapping_->get_address())
+	, header_(reinterpret_cast<const schema_pack_header*>(data_))
+{
+	if (mapping_->get_size() < sizeof(schema_pack_header) || header_->magic != schema_pack_magic)
+		throw event_trace_error("Not a schema pack: " + file_name);
+
+	if (header_->version != schema_pack_version || header_->size != mapping_->get_size()
+		|| header_->events_offset % data_alignment || header_->maps_offset % data_alignment
+		|| !is_valid_range(header_->events_offset,
+			static_cast<std::uint64_t>(header_->event_count) * sizeof(schema_pack_event_entry))
+		|| !is_valid_range(header_->maps_offset,
+			static_cast<std::uint64_t>(header_->map_count) * sizeof(schema_pack_map_entry)))
+	{
+		throw event_trace_error("Schema pack is damaged or of another version: " + file_name);
+	}
+
+	events_ = reinterpret_cast<const schema_pack_event_entry*>(data_ + header_->events_offset);
+	maps_ = reinterpret_cast<const schema_pack_map_entry*>(data_ + header_->maps_offset);
+}
+
+schema_pack::~schema_pack() = default;
+
+decode_result<std::shared_ptr<const event_schema>> schema_pack::get_schema(const GUID& provider_id,
+	const EVENT_DESCRIPTOR& descriptor) const
+{
+	auto key = get_descriptor_key(descriptor.Id, descriptor.Version, descriptor.Opcode);
+	auto end = events_ + header_->event_count;
+	auto it = std::lower_bound(events_, end, provider_id,
+		[&key](const schema_pack_event_entry& entry, const GUID& provider_id)
+	{
+		auto result = compare_guids(entry.provider_id, provider_id);
+		if (result)
+			return result < 0;
+
+		return get_descriptor_key(entry.id, entry.version, entry.opcode) < key;
+	});
+
+	if (it == end || compare_guids(it->provider_id, provider_id)
+		|| get_descriptor_key(it->id, it->version, it->opcode) != key)
+	{
+		return decode_error::schema_not_found;
+	}
+
+	if (!is_valid_range(it->info_offset, it->info_size))
+		return decode_error::invalid_schema;
+
+	std::vector<std::uint8_t> data(data_ + it->info_offset, data_ + it->info_offset + it->info_size);
+	if (!event_schema::is_valid(data))
+		return decode_error::invalid_schema;
+
+	//Properties whose map is not in the pack are printed as plain numbers
+	std::vector<std::shared_ptr<const event_value_map>> maps;
+	auto info = reinterpret_cast<const TRACE_EVENT_INFO*>(data.data());
+	for (ULONG i = 0; i != info->PropertyCount; ++i)
+	{
+		const auto& property_info = info->EventPropertyInfoArray[i];
+		if ((property_info.Flags & PropertyStruct) == PropertyStruct || !property_info.nonStructType.MapNameOffset)
+			continue;
+
+		auto map = get_map(provider_id, reinterpret_cast<const wchar_t*>(
+			data.data() + property_info.nonStructType.MapNameOffset));
+		if (!map)
+			continue;
+
+		if (maps.empty())
+			maps.resize(info->PropertyCount);
+
+		maps[i] = std::move(*map);
+	}
+
+	return std::shared_ptr<const event_schema>(std::make_shared<event_schema>(std::move(data), std::move(maps)));
+}
+
+decode_result<std::shared_ptr<const event_value_map>> schema_pack::get_map(const GUID& provider_id,
+	const wchar_t* map_name) const
+{
+	auto name_length = std::char_traits<wchar_t>::length(map_name);
+	auto compare = [this, &provider_id, map_name, name_length](const schema_pack_map_entry& entry)
+	{
+		auto result = compare_guids(entry.provider_id, provider_id);
+		if (result)
+			return result;
+
+		//Entries with damaged names are ordered first and never match
+		if (entry.name_offset % sizeof(wchar_t) || !is_valid_range(entry.name_offset,
+			static_cast<std::uint64_t>(entry.name_length) * sizeof(wchar_t)))
+		{
+			return -1;
+		}
+
+		return compare_names(reinterpret_cast<const wchar_t*>(data_ + entry.name_offset), entry.name_length,
+			map_name, name_length);
+	};
+
+	auto end = maps_ + header_->map_count;
+	auto it = std::lower_bound(maps_, end, 0, [&compare](const schema_pack_map_entry& entry, int)
+	{
+		return compare(entry) < 0;
+	});
+
+	if (it == end || compare(*it))
+		return decode_error::map_not_found;
+
+	if (it->info_offset % data_alignment || !is_valid_range(it->info_offset, it->info_size))
+		return decode_error::invalid_schema;
+
+	return event_value_map::compile(reinterpret_cast<const EVENT_MAP_INFO*>(data_ + it->info_offset),
+		it->info_size);
+}
+
+bool schema_pack::is_valid_range(std::uint64_t offset, std::uint64_t size) const noexcept
+{
+	return offset <= header_->size && size <= header_->size - offset;
+}
+} //namespace event_tracing
@@ -0,0 +1,233 @@
+#include "event_tracing/self_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace event_tracing
+{
+namespace
+{
+class profile_registry
+{
+public:
+	static profile_registry& get()
+	{
+		static profile_registry instance;
+		return instance;
+	}
+
+	std::uint32_t add_probe(const char* name)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		probe_names_.push_back(name);
+		return static_cast<std::uint32_t>(probe_names_.size() - 1u);
+	}
+
+	profile_thread_data& add_thread()
+	{
+		auto data = std::make_unique<profile_thread_data>();
+		std::lock_guard<std::mutex> lock(mutex_);
+		//Kept after the thread exits, so its times are still reported
+		threads_.push_back(std::move(data));
+		return *threads_.back();
+	}
+
+	template<typename Visitor>
+	void visit(Visitor&& visitor) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const auto& thread : threads_)
+			visitor(*thread, probe_names_);
+	}
+
+private:
+	mutable std::mutex mutex_;
+	std::vector<const char*> probe_names_;
+	std::vector<std::unique_ptr<profile_thread_data>> threads_;
+};
+
+std::uint64_t get_self_cycles(const profile_thread_data::node& value) noexcept
+{
+	auto cycles = value.cycles.load(std::memory_order_relaxed);
+	auto child_cycles = value.child_cycles.load(std::memory_order_relaxed);
+	//Counters of a running scope are read without a lock
+	return cycles > child_cycles ? cycles - child_cycles : 0;
+}
+
+void add_relaxed(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept
+{
+	//Only the owner thread writes
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+} //namespace
+
+const std::uint32_t profile_thread_data::max_node_count;
+const std::uint32_t profile_thread_data::no_node;
+const std::uint32_t profile_thread_data::table_size;
+
+profile_probe::profile_probe(const char* name)
+	: id_(profile_registry::get().add_probe(name))
+{
+}
+
+profile_thread_data::profile_thread_data() noexcept
+{
+	for (auto& value : nodes_)
+	{
+		value.parent = no_node;
+		value.probe = 0;
+		value.calls.store(0, std::memory_order_relaxed);
+		value.cycles.store(0, std::memory_order_relaxed);
+		value.child_cycles.store(0, std::memory_order_relaxed);
+	}
+
+	std::fill(std::begin(table_), std::end(table_), 0u);
+}
+
+profile_thread_data& profile_thread_data::get_current()
+{
+	thread_local profile_thread_data& current = profile_registry::get().add_thread();
+	return current;
+}
+
+std::uint32_t profile_thread_data::enter(std::uint32_t probe) noexcept
+{
+	auto slot = (current_ * 0x9e3779b1u ^ probe * 0x85ebca6bu) % table_size;
+	while (table_[slot])
+	{
+		auto index = table_[slot] - 1u;
+		if (nodes_[index].parent == current_ && nodes_[index].probe == probe)
+		{
+			current_ = index;
+			return index;
+		}
+
+		slot = (slot + 1u) % table_size;
+	}
+
+	auto index = node_count_.load(std::memory_order_relaxed);
+	if (index == max_node_count)
+		return no_node;
+
+	nodes_[index].parent = current_;
+	nodes_[index].probe = probe;
+	node_count_.store(index + 1u, std::memory_order_release);
+	table_[slot] = index + 1u;
+	current_ = index;
+	return index;
+}
+
+void profile_thread_data::leave(std::uint32_t node_index, std::uint64_t cycles) noexcept
+{
+	auto& value = nodes_[node_index];
+	add_relaxed(value.calls, 1);
+	add_relaxed(value.cycles, cycles);
+	if (value.parent != no_node)
+		add_relaxed(nodes_[value.parent].child_cycles, cycles);
+
+	current_ = value.parent;
+}
+
+std::vector<profile_probe_statistics> get_profile_statistics()
+{
+	std::vector<profile_probe_statistics> result;
+	profile_registry::get().visit([&result](const profile_thread_data& thread,
+		const std::vector<const char*>& probe_names)
+	{
+		if (result.size() < probe_names.size())
+			result.resize(probe_names.size());
+
+		auto node_count = thread.get_node_count();
+		for (std::uint32_t i = 0; i != node_count; ++i)
+		{
+			const auto& value = thread.get_node(i);
+			auto& statistics = result[value.probe];
+			statistics.calls += value.calls.load(std::memory_order_relaxed);
+			statistics.self_cycles += get_self_cycles(value);
+
+			auto parent = value.parent;
+			while (parent != profile_thread_data::no_node && thread.get_node(parent).probe != value.probe)
+				parent = thread.get_node(parent).parent;
+
+			//Nested calls of the same probe are already in the outer total
+			if (parent == profile_thread_data::no_node)
+				statistics.total_cycles += value.cycles.load(std::memory_order_relaxed);
+		}
+
+		for (std::size_t i = 0; i != probe_names.size(); ++i)
+			result[i].name = probe_names[i];
+	});
+
+	result.erase(std::remove_if(result.begin(), result.end(), [](const profile_probe_statistics& value)
+	{
+		return !value.calls;
+	}), result.end());
+
+	std::stable_sort(result.begin(), result.end(), [](const profile_probe_statistics& left,
+		const profile_probe_statistics& right)
+	{
+		return left.self_cycles > right.self_cycles;
+	});
+
+	return result;
+}
+
+void write_folded_stacks(std::string& result)
+{
+	std::map<std::string, std::uint64_t> stacks;
+	profile_registry::get().visit([&stacks](const profile_thread_data& thread,
+		const std::vector<const char*>& probe_names)
+	{
+		std::vector<std::uint32_t> path;
+		auto node_count = thread.get_node_count();
+		for (std::uint32_t i = 0; i != node_count; ++i)
+		{
+			const auto& value = thread.get_node(i);
+			if (!value.calls.load(std::memory_order_relaxed))
+				continue;
+
+			path.clear();
+			for (auto index = i; index != profile_thread_data::no_node; index = thread.get_node(index).parent)
+				path.push_back(thread.get_node(index).probe);
+
+			std::string stack;
+			for (auto it = path.crbegin(); it != path.crend(); ++it)
+			{
+				if (!stack.empty())
+					stack += ';';
+
+				stack += probe_names[*it];
+			}
+
+			stacks[stack] += get_self_cycles(value);
+		}
+	});
+
+	for (const auto& stack : stacks)
+	{
+		result += stack.first;
+		result += ' ';
+		result += std::to_string(stack.second);
+		result += '\n';
+	}
+}
+
+double get_cycles_per_second()
+{
+	static const double cycles_per_second = []
+	{
+		auto start_time = std::chrono::steady_clock::now();
+		auto start_cycles = read_cycle_counter();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		auto cycles = read_cycle_counter() - start_cycles;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+		return static_cast<double>(cycles) / elapsed.count();
+	}();
+
+	return cycles_per_second;
+}
+} //namespace event_tracing
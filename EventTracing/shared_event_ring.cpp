@@ -0,0 +1,383 @@
+#include "event_tracing/shared_event_ring.h"
+
+#include <cstring>
+#include <new>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#ifdef _WIN32
+#include <boost/interprocess/windows_shared_memory.hpp>
+#else
+#include <boost/interprocess/shared_memory_object.hpp>
+#endif
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace detail
+{
+struct shared_ring_header
+{
+	//Written last by the writer
+	std::atomic<std::uint32_t> magic;
+	std::uint32_t version;
+	std::uint64_t capacity;
+	std::uint64_t max_readers;
+	//Records before this position are complete
+	alignas(64) std::atomic<std::uint64_t> write_position;
+	//Records before the write position
+	std::atomic<std::uint64_t> record_count;
+	//Records before this position minus the capacity may be overwritten
+	alignas(64) std::atomic<std::uint64_t> reserve_position;
+	std::atomic<std::uint32_t> closed;
+};
+
+struct alignas(64) shared_ring_reader_slot
+{
+	std::atomic<std::uint32_t> in_use;
+	std::atomic<std::uint64_t> position;
+	std::atomic<std::uint64_t> lost_count;
+};
+
+//Windows shared memory is destroyed with its last handle,
+//POSIX shared memory is removed by the writer
+class shared_ring_memory
+{
+public:
+	shared_ring_memory(const std::string& name, std::size_t size)
+	try
+#ifdef _WIN32
+		: memory_(boost::interprocess::create_only, name.c_str(),
+			boost::interprocess::read_write, size)
+#else
+		: memory_(create_memory(name, size))
+#endif
+		, region_(memory_, boost::interprocess::read_write)
+	{
+	}
+	catch (const boost::interprocess::interprocess_exception& e)
+	{
+		throw event_trace_error(std::string("Unable to create shared ring: ") + e.what(),
+			static_cast<std::uint32_t>(e.get_native_error()));
+	}
+
+	explicit shared_ring_memory(const std::string& name)
+	try
+		: memory_(boost::interprocess::open_only, name.c_str(), boost::interprocess::read_write)
+		, region_(memory_, boost::interprocess::read_write)
+	{
+	}
+	catch (const boost::interprocess::interprocess_exception& e)
+	{
+		throw event_trace_error(std::string("Unable to open shared ring: ") + e.what(),
+			static_cast<std::uint32_t>(e.get_native_error()));
+	}
+
+	void* get_address() const noexcept
+	{
+		return region_.get_address();
+	}
+
+	std::size_t get_size() const noexcept
+	{
+		return region_.get_size();
+	}
+
+	static void remove(const std::string& name) noexcept
+	{
+#ifndef _WIN32
+		boost::interprocess::shared_memory_object::remove(name.c_str());
+#endif
+	}
+
+private:
+#ifdef _WIN32
+	boost::interprocess::windows_shared_memory memory_;
+#else
+	static boost::interprocess::shared_memory_object create_memory(const std::string& name, std::size_t size)
+	{
+		//Left by a writer which has not exited normally
+		boost::interprocess::shared_memory_object::remove(name.c_str());
+		boost::interprocess::shared_memory_object result(boost::interprocess::create_only,
+			name.c_str(), boost::interprocess::read_write);
+		result.truncate(static_cast<boost::interprocess::offset_t>(size));
+		return result;
+	}
+
+	boost::interprocess::shared_memory_object memory_;
+#endif
+	boost::interprocess::mapped_region region_;
+};
+} //namespace detail
+
+namespace
+{
+constexpr const std::uint32_t ring_magic = 0x474e5245u;
+constexpr const std::uint32_t ring_version = 1;
+constexpr const std::uint32_t padding_marker = 0xffffffffu;
+
+//Records start at multiples of the header size, so a padding record always fits
+struct record_header
+{
+	//Including the header and the alignment
+	std::uint32_t size;
+	//Size of the record data or padding_marker
+	std::uint32_t data_size;
+	std::uint64_t sequence;
+};
+
+constexpr std::uint64_t align_record_size(std::uint64_t size) noexcept
+{
+	return (size + sizeof(record_header) - 1u) & ~static_cast<std::uint64_t>(sizeof(record_header) - 1u);
+}
+
+constexpr std::size_t align_block_size(std::size_t size) noexcept
+{
+	return (size + 63u) & ~static_cast<std::size_t>(63u);
+}
+
+std::size_t get_data_offset(std::size_t max_readers) noexcept
+{
+	return align_block_size(sizeof(detail::shared_ring_header))
+		+ max_readers * sizeof(detail::shared_ring_reader_slot);
+}
+
+detail::shared_ring_reader_slot* get_slots(detail::shared_ring_header* header) noexcept
+{
+	return reinterpret_cast<detail::shared_ring_reader_slot*>(reinterpret_cast<std::uint8_t*>(header)
+		+ align_block_size(sizeof(detail::shared_ring_header)));
+}
+} //namespace
+
+const std::size_t shared_event_ring_writer::default_max_readers;
+
+shared_event_ring_writer::shared_event_ring_writer(const std::string& name, std::size_t capacity,
+	std::size_t max_readers)
+	: name_(name)
+{
+	if (!max_readers)
+		throw event_trace_error("Shared ring must allow at least one reader");
+
+	std::uint64_t ring_capacity = 4096;
+	while (ring_capacity < capacity)
+		ring_capacity <<= 1;
+
+	auto data_offset = get_data_offset(max_readers);
+	memory_ = std::make_unique<detail::shared_ring_memory>(name,
+		data_offset + static_cast<std::size_t>(ring_capacity));
+
+	auto address = static_cast<std::uint8_t*>(memory_->get_address());
+	header_ = new (address) detail::shared_ring_header;
+	header_->version = ring_version;
+	header_->capacity = ring_capacity;
+	header_->max_readers = max_readers;
+	header_->write_position.store(0, std::memory_order_relaxed);
+	header_->record_count.store(0, std::memory_order_relaxed);
+	header_->reserve_position.store(0, std::memory_order_relaxed);
+	header_->closed.store(0, std::memory_order_relaxed);
+
+	auto slots = get_slots(header_);
+	for (std::size_t i = 0; i != max_readers; ++i)
+	{
+		auto slot = new (slots + i) detail::shared_ring_reader_slot;
+		slot->in_use.store(0, std::memory_order_relaxed);
+		slot->position.store(0, std::memory_order_relaxed);
+		slot->lost_count.store(0, std::memory_order_relaxed);
+	}
+
+	data_ = address + data_offset;
+	//Readers attach only after the header is complete
+	header_->magic.store(ring_magic, std::memory_order_release);
+}
+
+shared_event_ring_writer::~shared_event_ring_writer()
+{
+	header_->closed.store(1, std::memory_order_release);
+	detail::shared_ring_memory::remove(name_);
+}
+
+bool shared_event_ring_writer::write(const void* data, std::size_t size)
+{
+	return write(size, [data, size](std::uint8_t* destination)
+	{
+		std::memcpy(destination, data, size);
+	});
+}
+
+std::vector<shared_event_ring_writer::reader_state> shared_event_ring_writer::get_readers() const
+{
+	std::vector<reader_state> result;
+	auto slots = get_slots(header_);
+	for (std::uint64_t i = 0; i != header_->max_readers; ++i)
+	{
+		if (!slots[i].in_use.load(std::memory_order_acquire))
+			continue;
+
+		auto position = slots[i].position.load(std::memory_order_relaxed);
+		result.push_back({ position_ > position ? position_ - position : 0,
+			slots[i].lost_count.load(std::memory_order_relaxed) });
+	}
+
+	return result;
+}
+
+std::uint8_t* shared_event_ring_writer::begin_write(std::size_t size) noexcept
+{
+	auto capacity = header_->capacity;
+	auto record_size = align_record_size(sizeof(record_header) + static_cast<std::uint64_t>(size));
+	//Leaves room for padding and for readers to copy the record before it is overwritten
+	if (record_size > capacity / 2u)
+		return nullptr;
+
+	auto offset = position_ & (capacity - 1u);
+	auto padding_size = offset + record_size > capacity ? capacity - offset : 0;
+	next_position_ = position_ + padding_size + record_size;
+
+	//Readers check the reserved position after copying a record,
+	//so it is published before any byte is overwritten
+	header_->reserve_position.store(next_position_, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (padding_size)
+	{
+		record_header padding{ static_cast<std::uint32_t>(padding_size), padding_marker, 0 };
+		std::memcpy(data_ + offset, &padding, sizeof(padding));
+		offset = 0;
+	}
+
+	record_header header{ static_cast<std::uint32_t>(record_size),
+		static_cast<std::uint32_t>(size), next_sequence_ };
+	std::memcpy(data_ + offset, &header, sizeof(header));
+	return data_ + offset + sizeof(header);
+}
+
+void shared_event_ring_writer::end_write() noexcept
+{
+	header_->record_count.store(next_sequence_ + 1u, std::memory_order_relaxed);
+	header_->write_position.store(next_position_, std::memory_order_release);
+	position_ = next_position_;
+	++next_sequence_;
+}
+
+shared_event_ring_reader::shared_event_ring_reader(const std::string& name)
+	: memory_(std::make_unique<detail::shared_ring_memory>(name))
+	, header_(static_cast<detail::shared_ring_header*>(memory_->get_address()))
+	, slot_(nullptr)
+{
+	if (memory_->get_size() < sizeof(detail::shared_ring_header)
+		|| header_->magic.load(std::memory_order_acquire) != ring_magic
+		|| header_->version != ring_version)
+	{
+		throw event_trace_error("Shared ring is not initialized or has unsupported version");
+	}
+
+	capacity_ = header_->capacity;
+	auto data_offset = get_data_offset(static_cast<std::size_t>(header_->max_readers));
+	if (memory_->get_size() < data_offset + capacity_)
+		throw event_trace_error("Shared ring is truncated");
+
+	data_ = static_cast<const std::uint8_t*>(memory_->get_address()) + data_offset;
+
+	auto slots = get_slots(header_);
+	for (std::uint64_t i = 0; i != header_->max_readers && !slot_; ++i)
+	{
+		std::uint32_t free_slot = 0;
+		if (slots[i].in_use.compare_exchange_strong(free_slot, 1, std::memory_order_acq_rel))
+			slot_ = slots + i;
+	}
+
+	if (!slot_)
+		throw event_trace_error("All shared ring reader slots are taken");
+
+	position_ = header_->write_position.load(std::memory_order_acquire);
+	slot_->position.store(position_, std::memory_order_relaxed);
+	slot_->lost_count.store(0, std::memory_order_relaxed);
+}
+
+shared_event_ring_reader::~shared_event_ring_reader()
+{
+	slot_->in_use.store(0, std::memory_order_release);
+}
+
+shared_event_ring_reader::read_result shared_event_ring_reader::read(std::vector<std::uint8_t>& record)
+{
+	while (true)
+	{
+		auto write_position = header_->write_position.load(std::memory_order_acquire);
+		if (position_ == write_position)
+		{
+			//The last record is written before the ring is closed
+			if (header_->closed.load(std::memory_order_acquire)
+				&& position_ == header_->write_position.load(std::memory_order_acquire))
+			{
+				//Records skipped at the end are not followed by a record to count them
+				auto record_count = header_->record_count.load(std::memory_order_relaxed);
+				if (has_sequence_ && record_count > next_sequence_)
+				{
+					lost_count_ += record_count - next_sequence_;
+					next_sequence_ = record_count;
+					slot_->lost_count.store(lost_count_, std::memory_order_relaxed);
+				}
+
+				return read_result::finished;
+			}
+
+			return read_result::empty;
+		}
+
+		if (write_position - position_ > capacity_)
+		{
+			skip_forward();
+			continue;
+		}
+
+		auto offset = position_ & (capacity_ - 1u);
+		record_header header;
+		std::memcpy(&header, data_ + offset, sizeof(header));
+		bool is_padding = header.data_size == padding_marker;
+		bool is_valid = header.size >= sizeof(header) && header.size % sizeof(header) == 0
+			&& offset + header.size <= capacity_
+			&& (is_padding || header.data_size <= header.size - sizeof(header));
+		if (is_valid && !is_padding)
+		{
+			record.resize(header.data_size);
+			std::memcpy(record.data(), data_ + offset + sizeof(header), header.data_size);
+		}
+
+		//The copy is valid only if the writer has not started to overwrite it meanwhile
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (header_->reserve_position.load(std::memory_order_relaxed) - position_ > capacity_)
+		{
+			skip_forward();
+			continue;
+		}
+
+		if (!is_valid)
+			throw event_trace_error("Shared ring is corrupted");
+
+		position_ += header.size;
+		slot_->position.store(position_, std::memory_order_relaxed);
+		if (is_padding)
+			continue;
+
+		if (has_sequence_ && header.sequence != next_sequence_)
+		{
+			lost_count_ += header.sequence - next_sequence_;
+			slot_->lost_count.store(lost_count_, std::memory_order_relaxed);
+		}
+
+		has_sequence_ = true;
+		next_sequence_ = header.sequence + 1u;
+		return read_result::record;
+	}
+}
+
+void shared_event_ring_reader::skip_forward() noexcept
+{
+	//Always at a record boundary; lost records are counted by the sequence
+	//number of the next record read or by the record count at the end
+	position_ = header_->write_position.load(std::memory_order_acquire);
+	slot_->position.store(position_, std::memory_order_relaxed);
+}
+} //namespace event_tracing
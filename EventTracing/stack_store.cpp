@@ -0,0 +1,137 @@
+#include "event_tracing/stack_store.h"
+
+#include <cassert>
+#include <limits>
+
+#include "event_tracing/event_trace_error.h"
+
+namespace event_tracing
+{
+namespace
+{
+const std::size_t initial_table_size = 1024u;
+} //namespace
+
+const stack_store::stack_id stack_store::empty_stack;
+
+stack_store::stack_store()
+{
+	clear();
+}
+
+stack_store::stack_id stack_store::add(const std::uint64_t* frames, std::size_t frame_count)
+{
+	auto id = empty_stack;
+	for (std::size_t i = frame_count; i != 0; --i)
+		id = add_node(id, frames[i - 1u]);
+
+	return id;
+}
+
+stack_store::stack_id stack_store::add(const event_stack_trace& stack)
+{
+	auto id = empty_stack;
+	for (std::size_t i = stack.size(); i != 0; --i)
+		id = add_node(id, stack[i - 1u]);
+
+	return id;
+}
+
+std::uint64_t stack_store::get_frame(stack_id id) const noexcept
+{
+	assert(id < nodes_.size());
+	return nodes_[id].frame;
+}
+
+stack_store::stack_id stack_store::get_parent(stack_id id) const noexcept
+{
+	assert(id < nodes_.size());
+	return nodes_[id].parent;
+}
+
+std::size_t stack_store::get_depth(stack_id id) const noexcept
+{
+	assert(id < nodes_.size());
+	return nodes_[id].depth;
+}
+
+void stack_store::get_frames(stack_id id, std::vector<std::uint64_t>& frames) const
+{
+	assert(id < nodes_.size());
+	frames.clear();
+	frames.reserve(nodes_[id].depth);
+	for (; id != empty_stack; id = nodes_[id].parent)
+		frames.push_back(nodes_[id].frame);
+}
+
+std::vector<std::uint64_t> stack_store::get_frames(stack_id id) const
+{
+	std::vector<std::uint64_t> frames;
+	get_frames(id, frames);
+	return frames;
+}
+
+std::size_t stack_store::get_memory_usage() const noexcept
+{
+	return nodes_.capacity() * sizeof(node) + table_.capacity() * sizeof(stack_id);
+}
+
+void stack_store::clear()
+{
+	nodes_.clear();
+	nodes_.push_back({ 0u, empty_stack, 0u });
+	table_.assign(initial_table_size, empty_stack);
+}
+
+stack_store::stack_id stack_store::add_node(stack_id parent, std::uint64_t frame)
+{
+	auto slot = find_slot(parent, frame);
+	if (table_[slot] != empty_stack)
+		return table_[slot];
+
+	if (nodes_.size() > (std::numeric_limits<stack_id>::max)())
+		throw event_trace_error("Stack store is full");
+
+	auto id = static_cast<stack_id>(nodes_.size());
+	nodes_.push_back({ frame, parent, nodes_[parent].depth + 1u });
+	table_[slot] = id;
+
+	//Keep the load factor below one half
+	if (nodes_.size() * 2u > table_.size())
+		grow_table();
+
+	return id;
+}
+
+std::size_t stack_store::find_slot(stack_id parent, std::uint64_t frame) const noexcept
+{
+	auto mask = table_.size() - 1u;
+	auto slot = get_hash(parent, frame) & mask;
+	while (table_[slot] != empty_stack)
+	{
+		const auto& entry = nodes_[table_[slot]];
+		if (entry.parent == parent && entry.frame == frame)
+			break;
+
+		slot = (slot + 1u) & mask;
+	}
+
+	return slot;
+}
+
+void stack_store::grow_table()
+{
+	table_.assign(table_.size() * 2u, empty_stack);
+	for (std::size_t id = 1; id != nodes_.size(); ++id)
+	{
+		auto slot = find_slot(nodes_[id].parent, nodes_[id].frame);
+		table_[slot] = static_cast<stack_id>(id);
+	}
+}
+
+std::size_t stack_store::get_hash(stack_id parent, std::uint64_t frame) noexcept
+{
+	auto hash = (frame ^ (static_cast<std::uint64_t>(parent) << 32 | parent)) * 0x9E3779B97F4A7C15ull;
+	return static_cast<std::size_t>(hash ^ (hash >> 29));
+}
+} //namespace event_tracing
@@ -0,0 +1,483 @@
+#include "event_tracing/tracelogging_schema.h"
+
+#include <codecvt>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <locale>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tdh.h>
+
+#include "event_tracing/event_extended_data.h"
+
+namespace event_tracing
+{
+namespace
+{
+//Field types as TraceLoggingProvider.h encodes them: the type is in the low
+//5 bits of the in-type, the array kind in the next two, and the high bit of
+//the in-type and the out-type tells that another byte follows
+constexpr const std::uint8_t tlg_type_mask = 0x1f;
+constexpr const std::uint8_t tlg_count_mask = 0x60;
+constexpr const std::uint8_t tlg_constant_count = 0x20;
+constexpr const std::uint8_t tlg_variable_count = 0x40;
+constexpr const std::uint8_t tlg_custom = 0x60;
+constexpr const std::uint8_t tlg_chain = 0x80;
+constexpr const std::uint8_t tlg_out_type_mask = 0x7f;
+
+//Nesting deeper than this is treated as damaged metadata
+constexpr const unsigned max_struct_depth = 32;
+
+enum tlg_in_type : std::uint8_t
+{
+	tlg_in_null = 0,
+	tlg_in_binary = 14,
+	tlg_in_counted_string = 22,
+	tlg_in_counted_ansi_string = 23,
+	tlg_in_struct = 24,
+	tlg_in_counted_binary = 25
+};
+
+enum tlg_out_type : std::uint8_t
+{
+	tlg_out_default = 0,
+	tlg_out_noprint = 1,
+	tlg_out_string = 2,
+	tlg_out_boolean = 3,
+	tlg_out_hex = 4,
+	tlg_out_pid = 5,
+	tlg_out_tid = 6,
+	tlg_out_port = 7,
+	tlg_out_ipv4 = 8,
+	tlg_out_ipv6 = 9,
+	tlg_out_socket_address = 10,
+	tlg_out_xml = 11,
+	tlg_out_json = 12,
+	tlg_out_win32_error = 13,
+	tlg_out_ntstatus = 14,
+	tlg_out_hresult = 15,
+	tlg_out_filetime = 16,
+	tlg_out_signed = 17,
+	tlg_out_unsigned = 18,
+	tlg_out_utf8 = 35,
+	tlg_out_pkcs7 = 36,
+	tlg_out_code_pointer = 37,
+	tlg_out_datetime_utc = 38
+};
+
+struct tlg_field
+{
+	std::string name;
+	USHORT in_type;
+	USHORT out_type;
+	ULONG flags;
+	USHORT count;
+	std::vector<tlg_field> members;
+};
+
+class metadata_reader
+{
+public:
+	metadata_reader(const std::uint8_t* begin, const std::uint8_t* end) noexcept
+		: position_(begin)
+		, end_(end)
+	{
+	}
+
+	bool at_end() const noexcept
+	{
+		return position_ == end_;
+	}
+
+	bool read_byte(std::uint8_t& value) noexcept
+	{
+		if (position_ == end_)
+			return false;
+
+		value = *position_++;
+		return true;
+	}
+
+	bool read_uint16(std::uint16_t& value) noexcept
+	{
+		if (end_ - position_ < static_cast<std::ptrdiff_t>(sizeof(value)))
+			return false;
+
+		std::memcpy(&value, position_, sizeof(value));
+		position_ += sizeof(value);
+		return true;
+	}
+
+	bool read_string(std::string& value)
+	{
+		auto terminator = static_cast<const std::uint8_t*>(std::memchr(position_, 0,
+			static_cast<std::size_t>(end_ - position_)));
+		if (!terminator)
+			return false;
+
+		value.assign(reinterpret_cast<const char*>(position_), terminator - position_);
+		position_ = terminator + 1;
+		return true;
+	}
+
+	bool skip(std::size_t size) noexcept
+	{
+		if (static_cast<std::size_t>(end_ - position_) < size)
+			return false;
+
+		position_ += size;
+		return true;
+	}
+
+	//Tag bytes continue while their high bit is set
+	bool skip_tags() noexcept
+	{
+		std::uint8_t value = tlg_chain;
+		while (value & tlg_chain)
+		{
+			if (!read_byte(value))
+				return false;
+		}
+
+		return true;
+	}
+
+private:
+	const std::uint8_t* position_;
+	const std::uint8_t* end_;
+};
+
+USHORT get_in_type(std::uint8_t in_type) noexcept
+{
+	if ((in_type & tlg_count_mask) == tlg_custom)
+		return TDH_INTYPE_MANIFEST_COUNTEDBINARY;
+
+	switch (in_type & tlg_type_mask)
+	{
+	//Binary values have a UINT16 size prefix, unlike TDH_INTYPE_BINARY
+	case tlg_in_binary:
+	case tlg_in_counted_binary:
+		return TDH_INTYPE_MANIFEST_COUNTEDBINARY;
+
+	case tlg_in_counted_string:
+		return TDH_INTYPE_COUNTEDSTRING;
+
+	case tlg_in_counted_ansi_string:
+		return TDH_INTYPE_COUNTEDANSISTRING;
+
+	default:
+		break;
+	}
+
+	//The other types up to HEXINT64 have the values of TDH ones, BOOL32 included
+	return static_cast<USHORT>(in_type & tlg_type_mask);
+}
+
+USHORT get_out_type(std::uint8_t out_type, USHORT in_type) noexcept
+{
+	auto size = get_fixed_type_size(in_type);
+	switch (out_type)
+	{
+	case tlg_out_string:
+		return TDH_OUTTYPE_STRING;
+	case tlg_out_boolean:
+		return TDH_OUTTYPE_BOOLEAN;
+	case tlg_out_hex:
+		switch (size)
+		{
+		case 1:
+			return TDH_OUTTYPE_HEXINT8;
+		case 2:
+			return TDH_OUTTYPE_HEXINT16;
+		case 4:
+			return TDH_OUTTYPE_HEXINT32;
+		case 8:
+			return TDH_OUTTYPE_HEXINT64;
+		default:
+			return in_type == TDH_INTYPE_MANIFEST_COUNTEDBINARY ? TDH_OUTTYPE_HEXBINARY : TDH_OUTTYPE_NULL;
+		}
+	case tlg_out_pid:
+		return TDH_OUTTYPE_PID;
+	case tlg_out_tid:
+		return TDH_OUTTYPE_TID;
+	case tlg_out_port:
+		return TDH_OUTTYPE_PORT;
+	case tlg_out_ipv4:
+		return TDH_OUTTYPE_IPV4;
+	case tlg_out_ipv6:
+		return TDH_OUTTYPE_IPV6;
+	case tlg_out_socket_address:
+		return TDH_OUTTYPE_SOCKETADDRESS;
+	case tlg_out_xml:
+		return TDH_OUTTYPE_XML;
+	case tlg_out_json:
+		return TDH_OUTTYPE_JSON;
+	case tlg_out_win32_error:
+		return TDH_OUTTYPE_WIN32ERROR;
+	case tlg_out_ntstatus:
+		return TDH_OUTTYPE_NTSTATUS;
+	case tlg_out_hresult:
+		return TDH_OUTTYPE_HRESULT;
+	case tlg_out_filetime:
+		return TDH_OUTTYPE_DATETIME;
+	case tlg_out_signed:
+		switch (size)
+		{
+		case 1:
+			return TDH_OUTTYPE_BYTE;
+		case 2:
+			return TDH_OUTTYPE_SHORT;
+		case 4:
+			return TDH_OUTTYPE_INT;
+		case 8:
+			return TDH_OUTTYPE_LONG;
+		default:
+			return TDH_OUTTYPE_NULL;
+		}
+	case tlg_out_unsigned:
+		switch (size)
+		{
+		case 1:
+			return TDH_OUTTYPE_UNSIGNEDBYTE;
+		case 2:
+			return TDH_OUTTYPE_UNSIGNEDSHORT;
+		case 4:
+			return TDH_OUTTYPE_UNSIGNEDINT;
+		case 8:
+			return TDH_OUTTYPE_UNSIGNEDLONG;
+		default:
+			return TDH_OUTTYPE_NULL;
+		}
+	case tlg_out_utf8:
+		return TDH_OUTTYPE_UTF8;
+	case tlg_out_pkcs7:
+		return TDH_OUTTYPE_PKCS7_WITH_TYPE_INFO;
+	case tlg_out_code_pointer:
+		return TDH_OUTTYPE_CODE_POINTER;
+	case tlg_out_datetime_utc:
+		return TDH_OUTTYPE_DATETIME_UTC;
+	default:
+		break;
+	}
+
+	return TDH_OUTTYPE_NULL;
+}
+
+decode_error read_fields(metadata_reader& reader, std::size_t count, unsigned depth,
+	std::vector<tlg_field>& fields, std::size_t& total_count)
+{
+	if (depth > max_struct_depth)
+		return decode_error::invalid_schema;
+
+	//Top-level fields go up to the end of the metadata
+	while (depth ? fields.size() != count : !reader.at_end())
+	{
+		tlg_field field{};
+		std::uint8_t in_type = 0;
+		if (!reader.read_string(field.name) || !reader.read_byte(in_type))
+			return decode_error::invalid_schema;
+
+		std::uint8_t out_type = 0;
+		if ((in_type & tlg_chain) && !reader.read_byte(out_type))
+			return decode_error::invalid_schema;
+
+		if ((out_type & tlg_chain) && !reader.skip_tags())
+			return decode_error::invalid_schema;
+
+		field.count = 1;
+		auto array_kind = in_type & tlg_count_mask;
+		if (array_kind == tlg_constant_count)
+		{
+			if (!reader.read_uint16(field.count))
+				return decode_error::invalid_schema;
+
+			field.flags |= PropertyParamFixedCount;
+		}
+		else if (array_kind == tlg_variable_count)
+		{
+			//The element count precedes the elements in the payload
+			field.count = payload_count_index;
+			field.flags |= PropertyParamCount;
+		}
+		else if (array_kind == tlg_custom)
+		{
+			//Type information of the custom serializer is not needed to read the value
+			std::uint16_t type_info_size = 0;
+			if (!reader.read_uint16(type_info_size) || !reader.skip(type_info_size))
+				return decode_error::invalid_schema;
+		}
+
+		++total_count;
+		if ((in_type & tlg_type_mask) == tlg_in_struct && array_kind != tlg_custom)
+		{
+			field.flags |= PropertyStruct;
+			auto result = read_fields(reader, out_type & tlg_out_type_mask, depth + 1u,
+				field.members, total_count);
+			if (result != decode_error::none)
+				return result;
+		}
+		else
+		{
+			auto type = in_type & tlg_type_mask;
+			if (array_kind != tlg_custom && (type == tlg_in_null || type > tlg_in_counted_binary))
+				return decode_error::unsupported_type;
+
+			field.in_type = get_in_type(in_type);
+			field.out_type = get_out_type(out_type & tlg_out_type_mask, field.in_type);
+		}
+
+		fields.push_back(std::move(field));
+	}
+
+	return decode_error::none;
+}
+
+bool to_wstring(const std::string& text, std::wstring& result)
+{
+	try
+	{
+		result = std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>>().from_bytes(text);
+	}
+	catch (const std::range_error&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+//Returns the offset of the string, zero for an empty one
+ULONG append_string(std::vector<std::uint8_t>& data, const std::wstring& text)
+{
+	if (text.empty())
+		return 0;
+
+	auto offset = data.size();
+	auto size = (text.size() + 1u) * sizeof(wchar_t);
+	data.resize(offset + size);
+	std::memcpy(data.data() + offset, text.c_str(), size);
+	return static_cast<ULONG>(offset);
+}
+
+//Provider traits start with their UINT16 size and the UTF-8 provider name
+std::string get_provider_name(const EVENT_HEADER_EXTENDED_DATA_ITEM* traits)
+{
+	std::string name;
+	if (!traits || traits->DataSize <= sizeof(std::uint16_t))
+		return name;
+
+	auto data = reinterpret_cast<const std::uint8_t*>(traits->DataPtr);
+	metadata_reader reader(data + sizeof(std::uint16_t), data + traits->DataSize);
+	reader.read_string(name);
+	return name;
+}
+} //namespace
+
+decode_result<std::shared_ptr<const event_schema>> parse_tracelogging_schema(const EVENT_RECORD& record)
+{
+	event_extended_data extended_data(record);
+	auto metadata = extended_data.find(EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL);
+	if (!metadata)
+		return decode_error::schema_not_found;
+
+	//UINT16 size including itself, tags, UTF-8 event name, then the fields
+	auto begin = reinterpret_cast<const std::uint8_t*>(metadata->DataPtr);
+	std::uint16_t size = 0;
+	if (metadata->DataSize < sizeof(size))
+		return decode_error::invalid_schema;
+
+	std::memcpy(&size, begin, sizeof(size));
+	if (size < sizeof(size) || size > metadata->DataSize)
+		return decode_error::invalid_schema;
+
+	metadata_reader reader(begin + sizeof(size), begin + size);
+	std::string event_name;
+	if (!reader.skip_tags() || !reader.read_string(event_name))
+		return decode_error::invalid_schema;
+
+	std::vector<tlg_field> fields;
+	std::size_t property_count = 0;
+	auto result = read_fields(reader, 0u, 0u, fields, property_count);
+	if (result != decode_error::none)
+		return result;
+
+	if (property_count >= payload_count_index)
+		return decode_error::invalid_schema;
+
+	//Top-level properties come first, members of each struct follow all
+	//properties placed before it, as in the layout TDH returns
+	std::vector<const tlg_field*> properties;
+	std::vector<std::size_t> struct_starts;
+	properties.reserve(property_count);
+	struct_starts.reserve(property_count);
+	for (const auto& field : fields)
+		properties.push_back(&field);
+
+	for (std::size_t i = 0; i != properties.size(); ++i)
+	{
+		struct_starts.push_back(properties.size());
+		for (const auto& member : properties[i]->members)
+			properties.push_back(&member);
+	}
+
+	std::wstring wide_event_name;
+	std::wstring provider_name;
+	if (!to_wstring(event_name, wide_event_name) || !to_wstring(get_provider_name(
+		extended_data.find(EVENT_HEADER_EXT_TYPE_PROV_TRAITS)), provider_name))
+	{
+		return decode_error::invalid_schema;
+	}
+
+	auto properties_offset = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray);
+	std::vector<std::uint8_t> data(properties_offset + properties.size() * sizeof(EVENT_PROPERTY_INFO));
+	TRACE_EVENT_INFO header{};
+	header.ProviderGuid = record.EventHeader.ProviderId;
+	header.EventDescriptor = record.EventHeader.EventDescriptor;
+	header.DecodingSource = DecodingSourceTlg;
+	header.ProviderNameOffset = append_string(data, provider_name);
+	header.TaskNameOffset = append_string(data, wide_event_name);
+	header.PropertyCount = static_cast<ULONG>(properties.size());
+	header.TopLevelPropertyCount = static_cast<ULONG>(fields.size());
+
+	std::vector<EVENT_PROPERTY_INFO> property_infos;
+	property_infos.reserve(properties.size());
+	for (std::size_t i = 0; i != properties.size(); ++i)
+	{
+		const auto& field = *properties[i];
+		std::wstring name;
+		if (!to_wstring(field.name, name))
+			return decode_error::invalid_schema;
+
+		EVENT_PROPERTY_INFO info{};
+		info.Flags = static_cast<PROPERTY_FLAGS>(field.flags);
+		info.NameOffset = append_string(data, name);
+		if (field.flags & PropertyStruct)
+		{
+			info.structType.StructStartIndex = static_cast<USHORT>(struct_starts[i]);
+			info.structType.NumOfStructMembers = static_cast<USHORT>(field.members.size());
+		}
+		else
+		{
+			info.nonStructType.InType = field.in_type;
+			info.nonStructType.OutType = field.out_type;
+			info.length = static_cast<USHORT>(get_fixed_type_size(field.in_type));
+		}
+
+		info.count = field.count;
+		property_infos.push_back(info);
+	}
+
+	std::memcpy(data.data(), &header, properties_offset);
+	if (!property_infos.empty())
+	{
+		std::memcpy(data.data() + properties_offset, property_infos.data(),
+			property_infos.size() * sizeof(EVENT_PROPERTY_INFO));
+	}
+
+	return std::shared_ptr<const event_schema>(std::make_shared<event_schema>(std::move(data)));
+}
+} //namespace event_tracing
@@ -0,0 +1,293 @@
+#include "checkpoint_file.h"
+
+#include <cassert>
+
+namespace
+{
+class file_handle
+{
+public:
+	explicit file_handle(HANDLE handle) noexcept
+		: handle_(handle)
+	{
+	}
+
+	~file_handle()
+	{
+		if (is_valid())
+			::CloseHandle(handle_);
+	}
+
+	file_handle(const file_handle&) = delete;
+	file_handle& operator=(const file_handle&) = delete;
+
+	HANDLE get() const noexcept
+	{
+		return handle_;
+	}
+
+	bool is_valid() const noexcept
+	{
+		return handle_ != INVALID_HANDLE_VALUE;
+	}
+
+private:
+	HANDLE handle_;
+};
+
+void write_data(HANDLE file, const std::uint8_t* data, std::size_t size)
+{
+	DWORD written = 0;
+	if (!::WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) || written != size)
+	{
+		throw checkpoint_error("Unable to write checkpoint file", ::GetLastError());
+	}
+}
+} //namespace
+
+std::vector<std::uint8_t> read_checkpoint_file(const std::wstring& file_name)
+{
+	std::vector<std::uint8_t> data;
+	file_handle file(::CreateFileW(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!file.is_valid())
+	{
+		auto error = ::GetLastError();
+		if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+			return data;
+
+		throw checkpoint_error("Unable to open checkpoint file", error);
+	}
+
+	LARGE_INTEGER size{};
+	if (!::GetFileSizeEx(file.get(), &size))
+		throw checkpoint_error("Unable to get checkpoint file size", ::GetLastError());
+
+	data.resize(static_cast<std::size_t>(size.QuadPart));
+	DWORD read = 0;
+	if (!::ReadFile(file.get(), data.data(), static_cast<DWORD>(data.size()), &read, nullptr))
+		throw checkpoint_error("Unable to read checkpoint file", ::GetLastError());
+
+	data.resize(read);
+	return data;
+}
+
+void replace_checkpoint_file(const std::wstring& file_name, const std::vector<std::uint8_t>& data)
+{
+	auto temp_file_name = file_name + L".tmp";
+	{
+		file_handle file(::CreateFileW(temp_file_name.c_str(), GENERIC_WRITE, 0,
+			nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!file.is_valid())
+			throw checkpoint_error("Unable to create checkpoint file", ::GetLastError());
+
+		write_data(file.get(), data.data(), data.size());
+		if (!::FlushFileBuffers(file.get()))
+			throw checkpoint_error("Unable to flush checkpoint file", ::GetLastError());
+	}
+
+	if (!::MoveFileExW(temp_file_name.c_str(), file_name.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		throw checkpoint_error("Unable to replace checkpoint file", ::GetLastError());
+	}
+}
+
+journal_file::~journal_file()
+{
+	close();
+}
+
+void journal_file::open(const std::wstring& file_name, std::uint64_t generation)
+{
+	close();
+	file_ = ::CreateFileW(file_name.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+		nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!is_open())
+		throw checkpoint_error("Unable to create journal file", ::GetLastError());
+
+	checkpoint_writer header;
+	write_journal_header(header, generation);
+	append(header);
+}
+
+void journal_file::append(const checkpoint_writer& records)
+{
+	append(records.get_data());
+}
+
+void journal_file::append(const std::vector<std::uint8_t>& records)
+{
+	assert(is_open());
+	write_data(file_, records.data(), records.size());
+}
+
+void journal_file::close() noexcept
+{
+	if (is_open())
+	{
+		::CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+	}
+}
+
+checkpoint_saver::checkpoint_saver(const std::wstring& file_name,
+	std::chrono::milliseconds flush_interval, error_handler on_error)
+	: file_name_(file_name)
+	, flush_interval_(flush_interval)
+	, on_error_(std::move(on_error))
+{
+	thread_ = std::thread([this]
+	{
+		run();
+	});
+}
+
+checkpoint_saver::~checkpoint_saver()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopped_ = true;
+	}
+
+	changed_.notify_all();
+	thread_.join();
+}
+
+void checkpoint_saver::append(const checkpoint_writer& records)
+{
+	const auto& data = records.get_data();
+	std::lock_guard<std::mutex> lock(mutex_);
+	records_.insert(records_.end(), data.cbegin(), data.cend());
+}
+
+void checkpoint_saver::reset(std::uint64_t generation, std::vector<restored_process>&& processes)
+{
+	queue_checkpoint(generation, true, std::move(processes));
+}
+
+void checkpoint_saver::save(std::uint64_t generation)
+{
+	queue_checkpoint(generation, false, std::vector<restored_process>());
+}
+
+void checkpoint_saver::queue_checkpoint(std::uint64_t generation, bool reset,
+	std::vector<restored_process>&& processes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (checkpoint_)
+		{
+			//Records queued since the superseded checkpoint are covered by the new one
+			auto& pending = *checkpoint_;
+			pending.records_after.insert(pending.records_after.end(), records_.cbegin(), records_.cend());
+			pending.generation = generation;
+			if (reset)
+			{
+				pending.records_before.insert(pending.records_before.end(),
+					pending.records_after.cbegin(), pending.records_after.cend());
+				pending.records_after.clear();
+				pending.reset = true;
+				pending.processes = std::move(processes);
+			}
+		}
+		else
+		{
+			checkpoint_ = pending_checkpoint{ std::move(records_), std::vector<std::uint8_t>(),
+				generation, reset, std::move(processes) };
+		}
+
+		records_.clear();
+	}
+
+	changed_.notify_all();
+}
+
+void checkpoint_saver::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	flush_requested_ = true;
+	changed_.notify_all();
+	changed_.wait(lock, [this]
+	{
+		return !flush_requested_;
+	});
+}
+
+void checkpoint_saver::run() noexcept
+{
+	boost::optional<pending_checkpoint> checkpoint;
+	std::vector<std::uint8_t> records;
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		changed_.wait_for(lock, flush_interval_, [this]
+		{
+			return stopped_ || flush_requested_ || checkpoint_;
+		});
+
+		if (!checkpoint_ && records_.empty())
+		{
+			flush_requested_ = false;
+			changed_.notify_all();
+			if (stopped_)
+				return;
+
+			continue;
+		}
+
+		checkpoint.swap(checkpoint_);
+		records.swap(records_);
+		lock.unlock();
+		write(checkpoint, records);
+		checkpoint = boost::none;
+		records.clear();
+		lock.lock();
+	}
+}
+
+void checkpoint_saver::write(boost::optional<pending_checkpoint>& checkpoint,
+	const std::vector<std::uint8_t>& records) noexcept
+{
+	if (failed_)
+		return;
+
+	try
+	{
+		if (checkpoint)
+		{
+			//Records of superseded checkpoints still go to the current journal,
+			//which is valid until the new checkpoint replaces the file
+			if (journal_.is_open())
+			{
+				journal_.append(checkpoint->records_before);
+				journal_.append(checkpoint->records_after);
+			}
+
+			if (checkpoint->reset)
+				state_.reset(std::move(checkpoint->processes));
+			else
+				state_.apply(checkpoint->records_before.data(), checkpoint->records_before.size());
+
+			state_.apply(checkpoint->records_after.data(), checkpoint->records_after.size());
+			replace_checkpoint_file(file_name_, state_.save(checkpoint->generation));
+			journal_.open(file_name_ + L".journal", checkpoint->generation);
+		}
+
+		state_.apply(records.data(), records.size());
+		if (journal_.is_open())
+			journal_.append(records);
+	}
+	catch (const checkpoint_error& error)
+	{
+		failed_ = true;
+		journal_.close();
+		on_error_(error);
+	}
+	catch (const std::exception&)
+	{
+		failed_ = true;
+		journal_.close();
+		on_error_(checkpoint_error("Unable to save checkpoint", ERROR_NOT_ENOUGH_MEMORY));
+	}
+}
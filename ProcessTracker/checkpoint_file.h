@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Windows.h>
+
+#include <boost/optional.hpp>
+
+#include "process_checkpoint.h"
+
+//Returns empty data when the file does not exist
+std::vector<std::uint8_t> read_checkpoint_file(const std::wstring& file_name);
+
+//Writes a temporary file and moves it over the old one, so a crash leaves
+//either the old or the new checkpoint
+void replace_checkpoint_file(const std::wstring& file_name, const std::vector<std::uint8_t>& data);
+
+class journal_file
+{
+public:
+	journal_file() = default;
+	~journal_file();
+
+	journal_file(const journal_file&) = delete;
+	journal_file& operator=(const journal_file&) = delete;
+
+	//Truncates the file and writes the journal header
+	void open(const std::wstring& file_name, std::uint64_t generation);
+	void append(const checkpoint_writer& records);
+	void append(const std::vector<std::uint8_t>& records);
+	void close() noexcept;
+
+	bool is_open() const noexcept
+	{
+		return file_ != INVALID_HANDLE_VALUE;
+	}
+
+private:
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+};
+
+//Writes the journal and checkpoints on a background thread, so event
+//handling does not wait for the disk. Journal records are buffered and
+//written every flush_interval, a crash loses at most the records of that
+//interval. The saver keeps its own process state, updated from the journal
+//records, and encodes checkpoints from it. Only the latest checkpoint not
+//yet started is kept, an earlier one is superseded. After a failure nothing
+//more is written, and the error is passed once to the error handler on the
+//background thread.
+class checkpoint_saver
+{
+public:
+	using error_handler = std::function<void(const checkpoint_error&)>;
+
+public:
+	checkpoint_saver(const std::wstring& file_name, std::chrono::milliseconds flush_interval,
+		error_handler on_error);
+	~checkpoint_saver();
+
+	checkpoint_saver(const checkpoint_saver&) = delete;
+	checkpoint_saver& operator=(const checkpoint_saver&) = delete;
+
+	void append(const checkpoint_writer& records);
+	//Replaces the process state and saves a checkpoint of it
+	void reset(std::uint64_t generation, std::vector<restored_process>&& processes);
+	//Saves a checkpoint of the state the records appended so far lead to,
+	//the records appended afterwards go to a new journal of the generation
+	void save(std::uint64_t generation);
+	//Waits until everything queued so far has been written
+	void flush();
+
+	bool has_failed() const noexcept
+	{
+		return failed_;
+	}
+
+private:
+	struct pending_checkpoint
+	{
+		std::vector<std::uint8_t> records_before;
+		//Queued after superseded checkpoints, applied over the reset state
+		std::vector<std::uint8_t> records_after;
+		std::uint64_t generation;
+		bool reset;
+		std::vector<restored_process> processes;
+	};
+
+private:
+	void run() noexcept;
+	void write(boost::optional<pending_checkpoint>& checkpoint, const std::vector<std::uint8_t>& records) noexcept;
+	void queue_checkpoint(std::uint64_t generation, bool reset, std::vector<restored_process>&& processes);
+
+private:
+	std::wstring file_name_;
+	std::chrono::milliseconds flush_interval_;
+	error_handler on_error_;
+	journal_file journal_;
+	//Used by the background thread only
+	checkpoint_state state_;
+	std::atomic<bool> failed_{ false };
+	std::mutex mutex_;
+	std::condition_variable changed_;
+	std::vector<std::uint8_t> records_;
+	boost::optional<pending_checkpoint> checkpoint_;
+	bool flush_requested_ = false;
+	bool stopped_ = false;
+	std::thread thread_;
+};
@@ -0,0 +1,89 @@
+#include "command_line.h"
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <Windows.h>
+#include <shellapi.h>
+
+namespace
+{
+constexpr const unsigned short default_metrics_port = 9464;
+
+std::uint32_t parse_number(const std::wstring& value, const char* switch_name)
+{
+	std::size_t end = 0;
+	unsigned long result = 0;
+	try
+	{
+		result = std::stoul(value, &end);
+	}
+	catch (const std::exception&)
+	{
+		end = 0;
+	}
+
+	if (!end || end != value.size() || value[0] == L'-'
+		|| result > (std::numeric_limits<std::uint32_t>::max)())
+	{
+		throw std::invalid_argument(std::string("Invalid value of the ")
+			+ switch_name + " command line switch");
+	}
+
+	return static_cast<std::uint32_t>(result);
+}
+} //namespace
+
+command_line::command_line()
+{
+	int count = 0;
+	std::unique_ptr<LPWSTR, HLOCAL(WINAPI*)(HLOCAL)> args(
+		::CommandLineToArgvW(::GetCommandLineW(), &count), ::LocalFree);
+	if (!args)
+		throw std::runtime_error("Unable to parse the command line");
+
+	//First argument is the program path
+	for (int i = 1; i < count; ++i)
+	{
+		std::wstring arg(args.get()[i]);
+		if (arg.size() < 2 || (arg[0] != L'/' && arg[0] != L'-'))
+			throw std::invalid_argument("Unknown command line argument");
+
+		auto separator = arg.find(L':');
+		auto name = arg.substr(1, separator == std::wstring::npos ? std::wstring::npos : separator - 1);
+		auto value = separator == std::wstring::npos ? std::wstring() : arg.substr(separator + 1);
+		if (name == L"history")
+		{
+			history_minutes_ = parse_number(value, "/history");
+		}
+		else if (name == L"metrics")
+		{
+			auto port = separator == std::wstring::npos ? default_metrics_port : parse_number(value, "/metrics");
+			if (!port || port > (std::numeric_limits<unsigned short>::max)())
+				throw std::invalid_argument("Invalid value of the /metrics command line switch");
+
+			metrics_port_ = static_cast<unsigned short>(port);
+		}
+		else if (name == L"checkpoint")
+		{
+			if (separator != std::wstring::npos && value.empty())
+				throw std::invalid_argument("Invalid value of the /checkpoint command line switch");
+
+			checkpoints_enabled_ = true;
+			checkpoint_file_ = value;
+		}
+		else if (name == L"shed")
+		{
+			if (separator != std::wstring::npos)
+				throw std::invalid_argument("Invalid value of the /shed command line switch");
+
+			shedding_enabled_ = true;
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown command line switch");
+		}
+	}
+}
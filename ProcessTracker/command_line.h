@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//Switches the application is started with:
+//  /history:<minutes>    keep process history for the given number of minutes,
+//                        history is not kept by default
+//  /metrics[:<port>]     serve metrics on the loopback interface, on port 9464
+//                        unless given; metrics are not served by default
+//  /checkpoint[:<file>]  write checkpoints of tracked processes to the file,
+//                        ProcessTracker.checkpoint in the temporary directory
+//                        unless given; checkpoints are not written by default
+//  /shed                 sample image load events when event handling falls
+//                        behind instead of stalling the trace; processes
+//                        which had loads dropped are marked as having
+//                        incomplete modules; events are not dropped by default
+class command_line
+{
+public:
+	//Parses the command line of the current process. Throws std::invalid_argument
+	//on unknown switches and bad switch values.
+	command_line();
+
+	std::uint32_t get_history_minutes() const noexcept
+	{
+		return history_minutes_;
+	}
+
+	//Zero unless metrics are served
+	unsigned short get_metrics_port() const noexcept
+	{
+		return metrics_port_;
+	}
+
+	bool get_checkpoints_enabled() const noexcept
+	{
+		return checkpoints_enabled_;
+	}
+
+	bool get_shedding_enabled() const noexcept
+	{
+		return shedding_enabled_;
+	}
+
+	//Empty for the default checkpoint file
+	const std::wstring& get_checkpoint_file() const noexcept
+	{
+		return checkpoint_file_;
+	}
+
+private:
+	std::uint32_t history_minutes_ = 0;
+	unsigned short metrics_port_ = 0;
+	bool checkpoints_enabled_ = false;
+	std::wstring checkpoint_file_;
+	bool shedding_enabled_ = false;
+};
@@ -0,0 +1,303 @@
+#include "exited_process_store.h"
+
+#include <cassert>
+#include <cwctype>
+#include <utility>
+
+namespace
+{
+//Approximate, node based containers are counted by element size plus two pointers
+constexpr const std::size_t node_overhead = 2u * sizeof(void*);
+
+std::size_t get_string_size(const std::wstring& value) noexcept
+{
+	return value.capacity() * sizeof(wchar_t);
+}
+
+std::size_t get_item_size(const process_thread&) noexcept
+{
+	return sizeof(process_thread);
+}
+
+std::size_t get_item_size(const process_module& module) noexcept
+{
+	return sizeof(process_module) + get_string_size(module.get_image_name());
+}
+
+std::size_t get_key_size(const std::wstring& key) noexcept
+{
+	return get_string_size(key);
+}
+
+std::size_t get_key_size(const process_key&) noexcept
+{
+	return 0;
+}
+
+template<typename Item>
+void push_limited(std::vector<Item>& items, const Item& item, std::size_t max_count,
+	std::size_t& memory_usage)
+{
+	//The latest ones are kept
+	if (items.size() == max_count)
+	{
+		memory_usage -= get_item_size(items.front());
+		items.erase(items.begin());
+	}
+
+	items.push_back(item);
+	memory_usage += get_item_size(item);
+}
+} //namespace
+
+exited_process_store::exited_process_store(std::size_t memory_budget, timestamp_type max_age,
+	std::size_t max_ended_items)
+	: memory_budget_(memory_budget)
+	, max_age_(max_age)
+	, max_ended_items_(max_ended_items)
+{
+}
+
+void exited_process_store::add_ended_thread(const process_key& owner, const process_thread& thread)
+{
+	if (!max_ended_items_)
+		return;
+
+	push_limited(get_ended(owner).threads, thread, max_ended_items_, ended_memory_usage_);
+	evict();
+}
+
+void exited_process_store::add_ended_module(const process_key& owner, const process_module& module)
+{
+	if (!max_ended_items_)
+		return;
+
+	push_limited(get_ended(owner).modules, module, max_ended_items_, ended_memory_usage_);
+	evict();
+}
+
+void exited_process_store::discard_ended(const process_key& owner)
+{
+	auto it = ended_.find(owner);
+	if (it != ended_.end())
+		take_ended(it);
+}
+
+void exited_process_store::add(process&& value, const boost::optional<process_key>& parent,
+	std::uint32_t exit_code, timestamp_type exit_time)
+{
+	auto key = value.get_key();
+	auto ended_it = ended_.find(key);
+	if (ended_it != ended_.end())
+	{
+		auto items = take_ended(ended_it);
+
+		//Threads and modules still present win, then the latest ended ones
+		//if a TID or an image base was reused
+		for (auto it = items.threads.rbegin(); it != items.threads.rend(); ++it)
+			value.add_thread(std::move(*it));
+		for (auto it = items.modules.rbegin(); it != items.modules.rend(); ++it)
+			value.add_module(std::move(*it));
+	}
+
+	if (by_key_.count(key))
+		return;
+
+	if (exit_time > last_exit_time_)
+		last_exit_time_ = exit_time;
+
+	auto it = records_.emplace(std::make_pair(exit_time, next_sequence_++),
+		record{ { std::move(value), parent, exit_code, exit_time }, 0u,
+		nullptr, nullptr, nullptr, nullptr }).first;
+	auto& new_record = (*it).second;
+	new_record.size = get_record_size(new_record.data);
+	memory_usage_ += new_record.size;
+
+	by_key_.emplace(key, it);
+	link(by_image_name_, get_image_name(new_record.data.value.get_path()), new_record,
+		&record::previous_same_image, &record::next_same_image);
+	if (parent)
+		link(by_parent_, *parent, new_record, &record::previous_same_parent, &record::next_same_parent);
+
+	evict();
+}
+
+const exited_process_store::exited_process* exited_process_store::find(const process_key& key) const
+{
+	auto it = by_key_.find(key);
+	if (it == by_key_.cend())
+		return nullptr;
+
+	return &(*(*it).second).second.data;
+}
+
+void exited_process_store::find_by_image_name(const std::wstring& image_name,
+	std::vector<const exited_process*>& result) const
+{
+	result.clear();
+	auto it = by_image_name_.find(get_image_name(image_name));
+	if (it == by_image_name_.cend())
+		return;
+
+	for (auto item = (*it).second.first; item; item = item->next_same_image)
+		result.push_back(&item->data);
+}
+
+void exited_process_store::find_by_parent(const process_key& parent,
+	std::vector<const exited_process*>& result) const
+{
+	result.clear();
+	auto it = by_parent_.find(parent);
+	if (it == by_parent_.cend())
+		return;
+
+	for (auto item = (*it).second.first; item; item = item->next_same_parent)
+		result.push_back(&item->data);
+}
+
+void exited_process_store::evict()
+{
+	while (ended_memory_usage_ > memory_budget_ / 2)
+		take_ended(ended_.find(ended_order_.front()));
+
+	//Records are ordered by exit time, so the earliest exited one is always first
+	while (!records_.empty() && (get_memory_usage() > memory_budget_
+		|| last_exit_time_ - (*records_.begin()).first.first > max_age_))
+	{
+		remove_oldest();
+	}
+}
+
+void exited_process_store::remove_oldest()
+{
+	auto it = records_.begin();
+	auto& oldest = (*it).second;
+	unlink(by_image_name_, get_image_name(oldest.data.value.get_path()), oldest,
+		&record::previous_same_image, &record::next_same_image);
+	if (oldest.data.parent)
+	{
+		unlink(by_parent_, *oldest.data.parent, oldest,
+			&record::previous_same_parent, &record::next_same_parent);
+	}
+
+	by_key_.erase(oldest.data.value.get_key());
+	memory_usage_ -= oldest.size;
+	records_.erase(it);
+}
+
+exited_process_store::ended_items& exited_process_store::get_ended(const process_key& owner)
+{
+	auto result = ended_.emplace(owner, ended_items());
+	auto& items = (*result.first).second;
+	if (result.second)
+	{
+		ended_memory_usage_ += get_ended_size(items);
+		items.order = ended_order_.insert(ended_order_.end(), owner);
+	}
+	else
+	{
+		ended_order_.splice(ended_order_.end(), ended_order_, items.order);
+	}
+
+	return items;
+}
+
+exited_process_store::ended_items exited_process_store::take_ended(ended_map::iterator it)
+{
+	auto items = std::move((*it).second);
+	ended_memory_usage_ -= get_ended_size(items);
+	ended_order_.erase(items.order);
+	ended_.erase(it);
+	return items;
+}
+
+template<typename Index, typename Key>
+void exited_process_store::link(Index& index, const Key& key, record& item,
+	record* record::* previous, record* record::* next)
+{
+	auto result = index.emplace(key, index_chain{ &item, &item });
+	if (result.second)
+	{
+		memory_usage_ += sizeof(typename Index::value_type) + node_overhead + get_key_size(key);
+		return;
+	}
+
+	//Stop events mostly come in exit order, a late record is put after the
+	//last one which did not exit later
+	auto& chain = (*result.first).second;
+	auto after = chain.last;
+	while (after && after->data.exit_time > item.data.exit_time)
+		after = after->*previous;
+
+	item.*previous = after;
+	item.*next = after ? after->*next : chain.first;
+	if (after)
+		after->*next = &item;
+	else
+		chain.first = &item;
+
+	if (item.*next)
+		(item.*next)->*previous = &item;
+	else
+		chain.last = &item;
+}
+
+template<typename Index, typename Key>
+void exited_process_store::unlink(Index& index, const Key& key, record& item,
+	record* record::* previous, record* record::* next)
+{
+	auto it = index.find(key);
+	assert(it != index.end());
+	auto& chain = (*it).second;
+	if (item.*previous)
+		(item.*previous)->*next = item.*next;
+	else
+		chain.first = item.*next;
+
+	if (item.*next)
+		(item.*next)->*previous = item.*previous;
+	else
+		chain.last = item.*previous;
+
+	if (!chain.first)
+	{
+		memory_usage_ -= sizeof(typename Index::value_type) + node_overhead + get_key_size((*it).first);
+		index.erase(it);
+	}
+}
+
+std::wstring exited_process_store::get_image_name(const std::wstring& path)
+{
+	auto position = path.find_last_of(L"\\/");
+	auto name = position == std::wstring::npos ? path : path.substr(position + 1);
+	for (auto& symbol : name)
+		symbol = static_cast<wchar_t>(std::towlower(symbol));
+
+	return name;
+}
+
+std::size_t exited_process_store::get_ended_size(const ended_items& items) noexcept
+{
+	std::size_t result = sizeof(ended_map::value_type) + sizeof(process_key) + 2u * node_overhead;
+	for (const auto& thread : items.threads)
+		result += get_item_size(thread);
+	for (const auto& module : items.modules)
+		result += get_item_size(module);
+
+	return result;
+}
+
+std::size_t exited_process_store::get_record_size(const exited_process& value) noexcept
+{
+	std::size_t result = sizeof(record_map::value_type) + sizeof(decltype(by_key_)::value_type)
+		+ 2u * node_overhead + get_string_size(value.value.get_path());
+	for (const auto& thread : value.value.get_threads())
+		result += sizeof(thread.second) + 2u * node_overhead;
+	for (const auto& module : value.value.get_modules())
+	{
+		result += sizeof(module.second) + 2u * node_overhead
+			+ get_string_size(module.second.get_image_name());
+	}
+
+	return result;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "process.h"
+#include "process_key.h"
+#include "process_module.h"
+#include "process_thread.h"
+
+//Processes which have exited, kept for post-mortem queries. Records are
+//evicted earliest exited first when the memory budget is exceeded or they
+//get older than max_age, so memory stays bounded however fast processes come
+//and go. Stop events may arrive out of exit time order, late records are put
+//in their place. Ended threads and modules of running processes may take up
+//to half of the budget, beyond it the ones of the processes which ended
+//something least recently are dropped.
+class exited_process_store
+{
+public:
+	using timestamp_type = std::int64_t;
+
+	struct exited_process
+	{
+		//Threads and modules are the ones the process had before it exited
+		process value;
+		boost::optional<process_key> parent;
+		std::uint32_t exit_code;
+		timestamp_type exit_time;
+	};
+
+public:
+	//max_ended_items limits ended threads and modules kept per running process
+	exited_process_store(std::size_t memory_budget, timestamp_type max_age,
+		std::size_t max_ended_items);
+
+	//Threads and modules are usually all gone before the process stop event,
+	//so the ones ended while the process runs are kept until it exits
+	void add_ended_thread(const process_key& owner, const process_thread& thread);
+	void add_ended_module(const process_key& owner, const process_module& module);
+	void discard_ended(const process_key& owner);
+
+	void add(process&& value, const boost::optional<process_key>& parent,
+		std::uint32_t exit_code, timestamp_type exit_time);
+
+	const exited_process* find(const process_key& key) const;
+	//Image name is the file name of the process image, compared case-insensitively.
+	//Results are ordered from the earliest exited.
+	void find_by_image_name(const std::wstring& image_name, std::vector<const exited_process*>& result) const;
+	void find_by_parent(const process_key& parent, std::vector<const exited_process*>& result) const;
+
+	std::size_t size() const noexcept
+	{
+		return records_.size();
+	}
+
+	std::size_t get_memory_usage() const noexcept
+	{
+		return memory_usage_ + ended_memory_usage_;
+	}
+
+private:
+	using sequence = std::uint64_t;
+
+	struct record
+	{
+		exited_process data;
+		std::size_t size;
+		//Records of the same index key are chained in exit order
+		record* previous_same_image;
+		record* next_same_image;
+		record* previous_same_parent;
+		record* next_same_parent;
+	};
+
+	struct index_chain
+	{
+		record* first;
+		record* last;
+	};
+
+	struct ended_items
+	{
+		std::vector<process_thread> threads;
+		std::vector<process_module> modules;
+		std::list<process_key>::iterator order;
+	};
+
+	//Exit time, then the order records were added in
+	using record_map = std::map<std::pair<timestamp_type, sequence>, record>;
+	using ended_map = std::unordered_map<process_key, ended_items, process_key_hash>;
+
+private:
+	void evict();
+	void remove_oldest();
+	ended_items& get_ended(const process_key& owner);
+	ended_items take_ended(ended_map::iterator it);
+
+	template<typename Index, typename Key>
+	void link(Index& index, const Key& key, record& item,
+		record* record::* previous, record* record::* next);
+	template<typename Index, typename Key>
+	void unlink(Index& index, const Key& key, record& item,
+		record* record::* previous, record* record::* next);
+
+	static std::wstring get_image_name(const std::wstring& path);
+	static std::size_t get_ended_size(const ended_items& items) noexcept;
+	static std::size_t get_record_size(const exited_process& value) noexcept;
+
+private:
+	std::size_t memory_budget_;
+	timestamp_type max_age_;
+	std::size_t max_ended_items_;
+	std::size_t memory_usage_ = 0;
+	std::size_t ended_memory_usage_ = 0;
+	timestamp_type last_exit_time_ = (std::numeric_limits<timestamp_type>::min)();
+	sequence next_sequence_ = 0;
+	record_map records_;
+	std::unordered_map<process_key, record_map::iterator, process_key_hash> by_key_;
+	std::unordered_map<std::wstring, index_chain> by_image_name_;
+	std::unordered_map<process_key, index_chain, process_key_hash> by_parent_;
+	ended_map ended_;
+	//Owners of ended items, the one which ended something least recently first
+	std::list<process_key> ended_order_;
+};
@@ -1,9 +1,13 @@
+#include <fstream>
 #include <stdexcept>
+#include <string>
 
 #include <Windows.h>
 
 #include "event_tracing/elevated_check.h"
+#include "event_tracing/self_profiler.h"
 
+#include "command_line.h"
 #include "common_controls.h"
 #include "main_window.h"
 
@@ -14,9 +18,18 @@ int CALLBACK wWinMain(HINSTANCE instance, HINSTANCE /*prev_instance*/, LPWSTR /*
 		if (!event_tracing::is_running_elevated())
 			throw std::runtime_error("You should run the program with administrative privileges");
 
+		command_line options;
 		common_controls::init();
 
-		return main_window(instance).get_result_code();
+		auto result = main_window(instance, options).get_result_code();
+
+#ifdef EVENT_TRACING_PROFILING
+		std::string stacks;
+		event_tracing::write_folded_stacks(stacks);
+		std::ofstream("profile.folded", std::ios::binary) << stacks;
+#endif
+
+		return result;
 	}
 	catch (const std::exception& e)
 	{
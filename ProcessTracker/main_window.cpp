@@ -1,5 +1,6 @@
 #include "main_window.h"
 
+#include <chrono>
 #include <sstream>
 #include <stdexcept>
 
@@ -22,6 +23,9 @@ constexpr const UINT message_add_module = WM_APP + 6;
 constexpr const UINT message_delete_module = WM_APP + 7;
 constexpr const UINT message_trace_stopped = WM_APP + 8;
 
+constexpr const std::chrono::milliseconds checkpoint_interval = std::chrono::minutes(1);
+constexpr const std::int64_t minute_intervals = 60ll * 10000000;
+
 struct listview_sort_info
 {
 	int column_index;
@@ -49,8 +53,9 @@ std::wstring to_wstring(T t, std::ios_base & (*f)(std::ios_base&))
 }
 } //namespace
 
-main_window::main_window(HINSTANCE instance)
+main_window::main_window(HINSTANCE instance, const command_line& options)
 	: tracker_(std::make_unique<process_list>())
+	, options_(options)
 {
 	on_message_[WM_INITDIALOG] = std::bind(&main_window::on_init_window, this);
 	on_message_[WM_CLOSE] = std::bind(&main_window::on_close_window, this);
@@ -597,6 +602,31 @@ bool main_window::on_init_window()
 		connections_.emplace_back(tracker_->on_stop_trace(
 			std::bind(&main_window::on_stop_trace, this)));
 
+		if (options_.get_checkpoints_enabled())
+		{
+			auto checkpoint_file = options_.get_checkpoint_file();
+			if (checkpoint_file.empty())
+			{
+				std::wstring temp_path(MAX_PATH + 1, L'\0');
+				temp_path.resize(::GetTempPathW(static_cast<DWORD>(temp_path.size()), &temp_path[0]));
+				if (temp_path.empty())
+					throw std::runtime_error("Unable to get the temporary directory for checkpoints");
+
+				checkpoint_file = temp_path + L"ProcessTracker.checkpoint";
+			}
+
+			tracker_->enable_checkpoints(checkpoint_file, checkpoint_interval);
+		}
+
+		if (options_.get_metrics_port())
+			tracker_->enable_metrics_endpoint(options_.get_metrics_port());
+
+		if (options_.get_history_minutes())
+			tracker_->enable_history(options_.get_history_minutes() * minute_intervals);
+
+		if (options_.get_shedding_enabled())
+			tracker_->enable_overload_control();
+
 		tracker_->start_tracking();
 	}
 	catch (const std::exception& e)
@@ -8,12 +8,13 @@
 
 #include <Windows.h>
 
+#include "command_line.h"
 #include "process_list.h"
 
 class main_window
 {
 public:
-	explicit main_window(HINSTANCE instance);
+	main_window(HINSTANCE instance, const command_line& options);
 
 	INT_PTR get_result_code() const noexcept
 	{
@@ -91,4 +92,5 @@ private:
 	bool sort_ascending_ = true;
 	const process* selected_process_ = nullptr;
 	std::unique_ptr<process_list> tracker_;
+	command_line options_;
 };
@@ -7,10 +7,21 @@ process::process(PEVENT_RECORD record)
 	event_tracing::event_info info(record);
 	path_ = info.get_plain_property_value<std::wstring>(L"ImageName");
 	pid_ = info.get_plain_property_value<std::uint32_t>(L"ProcessID");
+	start_time_ = info.get_timestamp();
 	parent_pid_ = info.get_plain_property_value<std::uint32_t>(L"ParentProcessID");
 	session_id_ = info.get_plain_property_value<std::uint32_t>(L"SessionID");
 }
 
+process::process(const std::wstring& path, std::uint32_t pid, std::int64_t start_time,
+	std::uint32_t parent_pid, std::uint32_t session_id)
+	: path_(path)
+	, pid_(pid)
+	, start_time_(start_time)
+	, parent_pid_(parent_pid)
+	, session_id_(session_id)
+{
+}
+
 process_thread& process::add_thread(process_thread&& thread)
 {
 	return (*threads_.emplace(thread.get_tid(), std::move(thread)).first).second;
@@ -3,6 +3,7 @@
 #include <map>
 #include <string>
 
+#include "process_key.h"
 #include "process_module.h"
 #include "process_thread.h"
 
@@ -14,6 +15,8 @@ public:
 
 public:
 	process(PEVENT_RECORD record);
+	process(const std::wstring& path, std::uint32_t pid, std::int64_t start_time,
+		std::uint32_t parent_pid, std::uint32_t session_id);
 
 	const std::wstring& get_path() const noexcept
 	{
@@ -25,6 +28,16 @@ public:
 		return pid_;
 	}
 
+	std::int64_t get_start_time() const noexcept
+	{
+		return start_time_;
+	}
+
+	process_key get_key() const noexcept
+	{
+		return { pid_, start_time_ };
+	}
+
 	std::uint32_t get_parent_pid() const noexcept
 	{
 		return parent_pid_;
@@ -51,11 +64,25 @@ public:
 		return modules_;
 	}
 
+	//Set once image load events of the process have been shed under overload,
+	//its modules may then lack some of the loaded ones
+	bool has_incomplete_modules() const noexcept
+	{
+		return incomplete_modules_;
+	}
+
+	void mark_modules_incomplete() noexcept
+	{
+		incomplete_modules_ = true;
+	}
+
 private:
 	std::wstring path_;
 	std::uint32_t pid_ = 0;
+	std::int64_t start_time_ = 0;
 	std::uint32_t parent_pid_ = 0;
 	std::uint32_t session_id_ = 0;
 	thread_map threads_;
 	module_map modules_;
+	bool incomplete_modules_ = false;
 };
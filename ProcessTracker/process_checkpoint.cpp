@@ -0,0 +1,426 @@
+#include "process_checkpoint.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+constexpr const std::uint32_t checkpoint_signature = 0x4b435450; //PTCK
+constexpr const std::uint32_t journal_signature = 0x4e4a5450; //PTJN
+constexpr const std::uint32_t format_version = 2;
+
+constexpr const std::size_t process_size_estimate = 64;
+constexpr const std::size_t thread_size = 28;
+constexpr const std::size_t module_size = 12;
+
+void check_header(checkpoint_reader& reader, std::uint32_t signature)
+{
+	if (reader.read<std::uint32_t>() != signature)
+		throw checkpoint_error("Invalid checkpoint signature");
+
+	if (reader.read<std::uint32_t>() != format_version)
+		throw checkpoint_error("Unsupported checkpoint version");
+}
+} //namespace
+
+void checkpoint_writer::write(const std::wstring& value)
+{
+	write(static_cast<std::uint32_t>(value.size()));
+	auto bytes = reinterpret_cast<const std::uint8_t*>(value.data());
+	data_.insert(data_.end(), bytes, bytes + value.size() * sizeof(wchar_t));
+}
+
+void checkpoint_writer::write(const process& value)
+{
+	write(value.get_path());
+	write(value.get_pid());
+	write(value.get_start_time());
+	write(value.get_parent_pid());
+	write(value.get_session_id());
+	write(static_cast<std::uint8_t>(value.has_incomplete_modules() ? 1 : 0));
+}
+
+void checkpoint_writer::write(const process_thread& value)
+{
+	write(value.get_pid());
+	write(value.get_tid());
+	write(value.get_ep());
+	write(value.get_user_stack_base());
+	write(value.get_user_stack_limit());
+}
+
+void checkpoint_writer::write(const process_module& value)
+{
+	write(value.get_pid());
+	write(value.get_image_base());
+	write(value.get_image_name());
+}
+
+void checkpoint_writer::write(const boost::optional<process_key>& value)
+{
+	write(static_cast<std::uint8_t>(value ? 1 : 0));
+	if (value)
+	{
+		write(value->pid);
+		write(value->start_time);
+	}
+}
+
+checkpoint_reader::checkpoint_reader(const std::uint8_t* data, std::size_t size) noexcept
+	: current_(data)
+	, end_(data + size)
+{
+}
+
+void checkpoint_reader::read_bytes(void* value, std::size_t size)
+{
+	if (static_cast<std::size_t>(end_ - current_) < size)
+		throw checkpoint_error("Checkpoint data is truncated");
+
+	std::memcpy(value, current_, size);
+	current_ += size;
+}
+
+std::wstring checkpoint_reader::read_string()
+{
+	auto length = read<std::uint32_t>();
+	if (static_cast<std::size_t>(end_ - current_) / sizeof(wchar_t) < length)
+		throw checkpoint_error("Checkpoint data is truncated");
+
+	std::wstring value(length, L'\0');
+	read_bytes(&value[0], length * sizeof(wchar_t));
+	return value;
+}
+
+process checkpoint_reader::read_process()
+{
+	auto path = read_string();
+	auto pid = read<std::uint32_t>();
+	auto start_time = read<std::int64_t>();
+	auto parent_pid = read<std::uint32_t>();
+	auto session_id = read<std::uint32_t>();
+	process value(path, pid, start_time, parent_pid, session_id);
+	if (read<std::uint8_t>())
+		value.mark_modules_incomplete();
+
+	return value;
+}
+
+process_thread checkpoint_reader::read_thread()
+{
+	auto pid = read<std::uint32_t>();
+	auto tid = read<std::uint32_t>();
+	auto ep = read<std::uint64_t>();
+	auto user_stack_base = read<std::uint64_t>();
+	auto user_stack_limit = read<std::uint64_t>();
+	return process_thread(pid, tid, ep, user_stack_base, user_stack_limit);
+}
+
+process_module checkpoint_reader::read_module()
+{
+	auto pid = read<std::uint32_t>();
+	auto image_base = read<std::uint64_t>();
+	auto image_name = read_string();
+	return process_module(pid, image_base, image_name);
+}
+
+boost::optional<process_key> checkpoint_reader::read_parent_key()
+{
+	if (!read<std::uint8_t>())
+		return boost::none;
+
+	auto pid = read<std::uint32_t>();
+	auto start_time = read<std::int64_t>();
+	return process_key{ pid, start_time };
+}
+
+namespace
+{
+//Processes map PIDs to values which get_process and get_parent take
+template<typename Processes, typename GetProcess, typename GetParent>
+std::vector<std::uint8_t> encode_checkpoint(std::uint64_t generation, const Processes& processes,
+	GetProcess get_process, GetParent get_parent)
+{
+	std::unordered_map<std::wstring, std::uint32_t> string_indexes;
+	std::vector<const std::wstring*> strings;
+	std::vector<std::uint32_t> module_name_indexes;
+	std::size_t estimated_size = 0;
+	for (const auto& pair : processes)
+	{
+		const process& value = get_process(pair.second);
+		estimated_size += process_size_estimate
+			+ value.get_path().size() * sizeof(wchar_t)
+			+ value.get_threads().size() * thread_size
+			+ value.get_modules().size() * module_size;
+		for (const auto& module : value.get_modules())
+		{
+			const auto& name = module.second.get_image_name();
+			auto result = string_indexes.emplace(name, static_cast<std::uint32_t>(strings.size()));
+			if (result.second)
+				strings.push_back(&name);
+
+			module_name_indexes.push_back((*result.first).second);
+		}
+	}
+
+	checkpoint_writer writer;
+	writer.reserve(estimated_size);
+	writer.write(checkpoint_signature);
+	writer.write(format_version);
+	writer.write(generation);
+
+	writer.write(static_cast<std::uint32_t>(strings.size()));
+	for (auto name : strings)
+		writer.write(*name);
+
+	auto module_name_index = module_name_indexes.cbegin();
+	writer.write(static_cast<std::uint32_t>(processes.size()));
+	for (const auto& pair : processes)
+	{
+		const process& value = get_process(pair.second);
+		writer.write(value);
+		writer.write(get_parent(pair.second));
+
+		writer.write(static_cast<std::uint32_t>(value.get_threads().size()));
+		for (const auto& thread : value.get_threads())
+		{
+			writer.write(thread.second.get_tid());
+			writer.write(thread.second.get_ep());
+			writer.write(thread.second.get_user_stack_base());
+			writer.write(thread.second.get_user_stack_limit());
+		}
+
+		writer.write(static_cast<std::uint32_t>(value.get_modules().size()));
+		for (const auto& module : value.get_modules())
+		{
+			writer.write(module.second.get_image_base());
+			writer.write(*module_name_index++);
+		}
+	}
+
+	return writer.release();
+}
+} //namespace
+
+std::vector<std::uint8_t> save_checkpoint(std::uint64_t generation,
+	const std::map<std::uint32_t, process>& processes, const process_tree& tree)
+{
+	return encode_checkpoint(generation, processes, [](const process& value) -> const process&
+	{
+		return value;
+	}, [&tree](const process& value)
+	{
+		return tree.get_parent(value.get_key());
+	});
+}
+
+std::vector<restored_process> load_checkpoint(const std::uint8_t* data, std::size_t size,
+	std::uint64_t& generation)
+{
+	checkpoint_reader reader(data, size);
+	check_header(reader, checkpoint_signature);
+	generation = reader.read<std::uint64_t>();
+
+	std::vector<std::wstring> strings(reader.read<std::uint32_t>());
+	for (auto& name : strings)
+		name = reader.read_string();
+
+	std::vector<restored_process> result;
+	auto process_count = reader.read<std::uint32_t>();
+	result.reserve((std::min)(static_cast<std::size_t>(process_count), size / process_size_estimate));
+	for (std::uint32_t i = 0; i != process_count; ++i)
+	{
+		auto value = reader.read_process();
+		auto parent = reader.read_parent_key();
+
+		auto thread_count = reader.read<std::uint32_t>();
+		for (std::uint32_t j = 0; j != thread_count; ++j)
+		{
+			auto tid = reader.read<std::uint32_t>();
+			auto ep = reader.read<std::uint64_t>();
+			auto user_stack_base = reader.read<std::uint64_t>();
+			auto user_stack_limit = reader.read<std::uint64_t>();
+			value.add_thread(process_thread(value.get_pid(), tid, ep, user_stack_base, user_stack_limit));
+		}
+
+		auto module_count = reader.read<std::uint32_t>();
+		for (std::uint32_t j = 0; j != module_count; ++j)
+		{
+			auto image_base = reader.read<std::uint64_t>();
+			auto name_index = reader.read<std::uint32_t>();
+			if (name_index >= strings.size())
+				throw checkpoint_error("Invalid checkpoint module name");
+
+			value.add_module(process_module(value.get_pid(), image_base, strings[name_index]));
+		}
+
+		result.push_back({ std::move(value), parent });
+	}
+
+	return result;
+}
+
+class checkpoint_state::record_visitor
+{
+public:
+	explicit record_visitor(std::map<std::uint32_t, restored_process>& processes) noexcept
+		: processes_(processes)
+	{
+	}
+
+	void process_started(process&& value, const boost::optional<process_key>& parent)
+	{
+		auto it = processes_.find(value.get_pid());
+		if (it != processes_.end())
+		{
+			if ((*it).second.value.get_key() == value.get_key())
+				return;
+
+			//Stop event of the previous process with this PID was lost
+			processes_.erase(it);
+		}
+
+		auto pid = value.get_pid();
+		processes_.emplace(pid, restored_process{ std::move(value), parent });
+	}
+
+	void process_stopped(std::uint32_t pid, std::uint32_t, std::int64_t)
+	{
+		processes_.erase(pid);
+	}
+
+	void thread_started(process_thread&& thread)
+	{
+		auto value = find(thread.get_pid());
+		if (value)
+			value->add_thread(std::move(thread));
+	}
+
+	void thread_stopped(std::uint32_t pid, std::uint32_t tid)
+	{
+		auto value = find(pid);
+		if (value)
+			value->remove_thread(tid);
+	}
+
+	void module_loaded(process_module&& module)
+	{
+		auto value = find(module.get_pid());
+		if (value)
+			value->add_module(std::move(module));
+	}
+
+	void module_unloaded(std::uint32_t pid, std::uint64_t image_base)
+	{
+		auto value = find(pid);
+		if (value)
+			value->remove_module(image_base);
+	}
+
+	void modules_incomplete(std::uint32_t pid)
+	{
+		auto value = find(pid);
+		if (value)
+			value->mark_modules_incomplete();
+	}
+
+private:
+	process* find(std::uint32_t pid)
+	{
+		auto it = processes_.find(pid);
+		return it == processes_.end() ? nullptr : &(*it).second.value;
+	}
+
+private:
+	std::map<std::uint32_t, restored_process>& processes_;
+};
+
+void checkpoint_state::reset(std::vector<restored_process>&& processes)
+{
+	processes_.clear();
+	for (auto& entry : processes)
+	{
+		auto pid = entry.value.get_pid();
+		processes_.emplace(pid, std::move(entry));
+	}
+}
+
+void checkpoint_state::apply(const std::uint8_t* records, std::size_t size)
+{
+	checkpoint_reader reader(records, size);
+	replay_journal(reader, record_visitor(processes_));
+}
+
+std::vector<std::uint8_t> checkpoint_state::save(std::uint64_t generation) const
+{
+	return encode_checkpoint(generation, processes_, [](const restored_process& entry) -> const process&
+	{
+		return entry.value;
+	}, [](const restored_process& entry)
+	{
+		return entry.parent;
+	});
+}
+
+void write_journal_header(checkpoint_writer& writer, std::uint64_t generation)
+{
+	writer.write(journal_signature);
+	writer.write(format_version);
+	writer.write(generation);
+}
+
+void write_process_started(checkpoint_writer& writer, const process& value,
+	const boost::optional<process_key>& parent)
+{
+	writer.write(journal_record_type::process_started);
+	writer.write(value);
+	writer.write(parent);
+}
+
+void write_process_stopped(checkpoint_writer& writer, std::uint32_t pid, std::uint32_t exit_code,
+	std::int64_t exit_time)
+{
+	writer.write(journal_record_type::process_stopped);
+	writer.write(pid);
+	writer.write(exit_code);
+	writer.write(exit_time);
+}
+
+void write_thread_started(checkpoint_writer& writer, const process_thread& value)
+{
+	writer.write(journal_record_type::thread_started);
+	writer.write(value);
+}
+
+void write_thread_stopped(checkpoint_writer& writer, std::uint32_t pid, std::uint32_t tid)
+{
+	writer.write(journal_record_type::thread_stopped);
+	writer.write(pid);
+	writer.write(tid);
+}
+
+void write_module_loaded(checkpoint_writer& writer, const process_module& value)
+{
+	writer.write(journal_record_type::module_loaded);
+	writer.write(value);
+}
+
+void write_module_unloaded(checkpoint_writer& writer, std::uint32_t pid, std::uint64_t image_base)
+{
+	writer.write(journal_record_type::module_unloaded);
+	writer.write(pid);
+	writer.write(image_base);
+}
+
+void write_modules_incomplete(checkpoint_writer& writer, std::uint32_t pid)
+{
+	writer.write(journal_record_type::modules_incomplete);
+	writer.write(pid);
+}
+
+std::uint64_t read_journal_header(checkpoint_reader& reader)
+{
+	check_header(reader, journal_signature);
+	return reader.read<std::uint64_t>();
+}
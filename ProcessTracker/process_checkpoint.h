@@ -0,0 +1,233 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "process.h"
+#include "process_key.h"
+#include "process_module.h"
+#include "process_thread.h"
+#include "process_tree.h"
+
+class checkpoint_error : public std::runtime_error
+{
+public:
+	explicit checkpoint_error(const std::string& text, std::uint32_t error_code = 0u)
+		: std::runtime_error(text)
+		, error_code_(error_code)
+	{
+	}
+
+	std::uint32_t get_error_code() const noexcept
+	{
+		return error_code_;
+	}
+
+private:
+	std::uint32_t error_code_;
+};
+
+class checkpoint_writer
+{
+public:
+	template<typename Value>
+	void write(Value value)
+	{
+		static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable");
+		auto bytes = reinterpret_cast<const std::uint8_t*>(&value);
+		data_.insert(data_.end(), bytes, bytes + sizeof(value));
+	}
+
+	void write(const std::wstring& value);
+	void write(const process& value);
+	void write(const process_thread& value);
+	void write(const process_module& value);
+	void write(const boost::optional<process_key>& value);
+
+	const std::vector<std::uint8_t>& get_data() const noexcept
+	{
+		return data_;
+	}
+
+	void clear() noexcept
+	{
+		data_.clear();
+	}
+
+	std::vector<std::uint8_t> release() noexcept
+	{
+		return std::move(data_);
+	}
+
+	void reserve(std::size_t size)
+	{
+		data_.reserve(size);
+	}
+
+private:
+	std::vector<std::uint8_t> data_;
+};
+
+//Throws checkpoint_error when the data is truncated
+class checkpoint_reader
+{
+public:
+	checkpoint_reader(const std::uint8_t* data, std::size_t size) noexcept;
+
+	template<typename Value>
+	Value read()
+	{
+		static_assert(std::is_trivially_copyable<Value>::value, "Value must be trivially copyable");
+		Value value;
+		read_bytes(&value, sizeof(value));
+		return value;
+	}
+
+	std::wstring read_string();
+	process read_process();
+	process_thread read_thread();
+	process_module read_module();
+	boost::optional<process_key> read_parent_key();
+
+	bool empty() const noexcept
+	{
+		return current_ == end_;
+	}
+
+private:
+	void read_bytes(void* value, std::size_t size);
+
+private:
+	const std::uint8_t* current_;
+	const std::uint8_t* end_;
+};
+
+struct restored_process
+{
+	process value;
+	boost::optional<process_key> parent;
+};
+
+//Checkpoint holds full process, thread and module state, module names are
+//stored once in a string table, as most of them are shared by processes
+std::vector<std::uint8_t> save_checkpoint(std::uint64_t generation,
+	const std::map<std::uint32_t, process>& processes, const process_tree& tree);
+std::vector<restored_process> load_checkpoint(const std::uint8_t* data, std::size_t size,
+	std::uint64_t& generation);
+
+//Process state kept apart from the tracked one and updated from journal
+//records, so checkpoints are encoded from it without copying the tracked
+//state. Records are applied the way they are replayed on restore.
+class checkpoint_state
+{
+public:
+	void reset(std::vector<restored_process>&& processes);
+	void apply(const std::uint8_t* records, std::size_t size);
+	std::vector<std::uint8_t> save(std::uint64_t generation) const;
+
+	std::size_t size() const noexcept
+	{
+		return processes_.size();
+	}
+
+private:
+	class record_visitor;
+
+private:
+	std::map<std::uint32_t, restored_process> processes_;
+};
+
+enum class journal_record_type : std::uint8_t
+{
+	process_started = 1,
+	process_stopped,
+	thread_started,
+	thread_stopped,
+	module_loaded,
+	module_unloaded,
+	modules_incomplete
+};
+
+//Journal holds the changes made after the checkpoint of the same
+//generation was saved, it is replayed over that checkpoint
+void write_journal_header(checkpoint_writer& writer, std::uint64_t generation);
+void write_process_started(checkpoint_writer& writer, const process& value,
+	const boost::optional<process_key>& parent);
+void write_process_stopped(checkpoint_writer& writer, std::uint32_t pid, std::uint32_t exit_code,
+	std::int64_t exit_time);
+void write_thread_started(checkpoint_writer& writer, const process_thread& value);
+void write_thread_stopped(checkpoint_writer& writer, std::uint32_t pid, std::uint32_t tid);
+void write_module_loaded(checkpoint_writer& writer, const process_module& value);
+void write_module_unloaded(checkpoint_writer& writer, std::uint32_t pid, std::uint64_t image_base);
+void write_modules_incomplete(checkpoint_writer& writer, std::uint32_t pid);
+
+std::uint64_t read_journal_header(checkpoint_reader& reader);
+
+//Visitor has process_started(process&&, const boost::optional<process_key>&),
+//process_stopped(pid, exit_code, exit_time), thread_started(process_thread&&),
+//thread_stopped(pid, tid), module_loaded(process_module&&),
+//module_unloaded(pid, image_base) and modules_incomplete(pid) members. The journal may end with a partly
+//written record, replay stops there.
+template<typename Visitor>
+void replay_journal(checkpoint_reader& reader, Visitor&& visitor)
+{
+	try
+	{
+		while (!reader.empty())
+		{
+			switch (static_cast<journal_record_type>(reader.read<std::uint8_t>()))
+			{
+			case journal_record_type::process_started:
+			{
+				auto value = reader.read_process();
+				auto parent = reader.read_parent_key();
+				visitor.process_started(std::move(value), parent);
+				break;
+			}
+			case journal_record_type::process_stopped:
+			{
+				auto pid = reader.read<std::uint32_t>();
+				auto exit_code = reader.read<std::uint32_t>();
+				auto exit_time = reader.read<std::int64_t>();
+				visitor.process_stopped(pid, exit_code, exit_time);
+				break;
+			}
+			case journal_record_type::thread_started:
+				visitor.thread_started(reader.read_thread());
+				break;
+			case journal_record_type::thread_stopped:
+			{
+				auto pid = reader.read<std::uint32_t>();
+				auto tid = reader.read<std::uint32_t>();
+				visitor.thread_stopped(pid, tid);
+				break;
+			}
+			case journal_record_type::module_loaded:
+				visitor.module_loaded(reader.read_module());
+				break;
+			case journal_record_type::module_unloaded:
+			{
+				auto pid = reader.read<std::uint32_t>();
+				auto image_base = reader.read<std::uint64_t>();
+				visitor.module_unloaded(pid, image_base);
+				break;
+			}
+			case journal_record_type::modules_incomplete:
+				visitor.modules_incomplete(reader.read<std::uint32_t>());
+				break;
+			default:
+				return;
+			}
+		}
+	}
+	catch (const checkpoint_error&)
+	{
+	}
+}
@@ -0,0 +1,240 @@
+#include "process_history.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+const process_history::timestamp_type process_history::still_alive;
+
+process_history::process_history(timestamp_type retention, std::size_t snapshot_interval)
+	: retention_(retention)
+	, snapshot_interval_(snapshot_interval)
+{
+	if (!snapshot_interval)
+		throw std::invalid_argument("Snapshot interval must not be zero");
+
+	snapshots_.push_back({ (std::numeric_limits<timestamp_type>::min)(), 0u, {} });
+}
+
+void process_history::add_process(timestamp_type timestamp, const process_key& key,
+	const boost::optional<process_key>& parent, std::uint32_t session_id, const std::wstring& path)
+{
+	add_entry(timestamp, { entry_type::process, key, parent, session_id,
+		&*names_.insert(path).first, timestamp, still_alive, false });
+}
+
+void process_history::remove_process(timestamp_type timestamp, const process_key& key)
+{
+	auto first = live_.lower_bound(make_live_key(entry_type::process, key, 0u));
+	while (first != live_.end() && std::get<0>((*first).first) == key.pid
+		&& std::get<1>((*first).first) == key.start_time)
+	{
+		auto current = first++;
+		end_entry(timestamp, current);
+	}
+}
+
+void process_history::mark_modules_incomplete(const process_key& key)
+{
+	auto it = live_.find(make_live_key(entry_type::process, key, 0u));
+	if (it != live_.end())
+		entries_.at((*it).second).incomplete_modules = true;
+}
+
+void process_history::add_thread(timestamp_type timestamp, const process_key& owner, std::uint32_t tid)
+{
+	add_entry(timestamp, { entry_type::thread, owner, boost::none, tid, nullptr, timestamp, still_alive, false });
+}
+
+void process_history::remove_thread(timestamp_type timestamp, const process_key& owner, std::uint32_t tid)
+{
+	remove_entry(timestamp, entry_type::thread, owner, tid);
+}
+
+void process_history::add_module(timestamp_type timestamp, const process_key& owner,
+	std::uint64_t image_base, const std::wstring& image_name)
+{
+	add_entry(timestamp, { entry_type::module, owner, boost::none, image_base,
+		&*names_.insert(image_name).first, timestamp, still_alive, false });
+}
+
+void process_history::remove_module(timestamp_type timestamp, const process_key& owner,
+	std::uint64_t image_base)
+{
+	remove_entry(timestamp, entry_type::module, owner, image_base);
+}
+
+bool process_history::get_state(timestamp_type time, std::vector<const entry*>& result) const
+{
+	result.clear();
+	if (time < get_oldest_time())
+		return false;
+
+	auto snapshot_it = std::upper_bound(snapshots_.cbegin(), snapshots_.cend(), time,
+		[](timestamp_type value, const snapshot& item)
+	{
+		return value < item.timestamp;
+	});
+	const auto& base = *(snapshot_it - 1);
+
+	std::vector<entry_id> added;
+	std::vector<entry_id> removed;
+	for (auto it = deltas_.cbegin() + (base.delta_index - dropped_delta_count_);
+		it != deltas_.cend() && (*it).timestamp <= time; ++it)
+	{
+		if ((*it).added)
+			added.push_back((*it).id);
+		else
+			removed.push_back((*it).id);
+	}
+
+	std::sort(removed.begin(), removed.end());
+	auto is_removed = [&removed](entry_id id)
+	{
+		return std::binary_search(removed.cbegin(), removed.cend(), id);
+	};
+
+	result.reserve(base.live.size() + added.size());
+	for (auto id : base.live)
+	{
+		if (!is_removed(id))
+			result.push_back(&entries_.at(id));
+	}
+
+	for (auto id : added)
+	{
+		if (!is_removed(id))
+			result.push_back(&entries_.at(id));
+	}
+
+	return true;
+}
+
+bool process_history::get_state(timestamp_type from, timestamp_type to,
+	std::vector<const entry*>& result) const
+{
+	if (!get_state(from, result))
+		return false;
+
+	auto first = std::upper_bound(deltas_.cbegin(), deltas_.cend(), from,
+		[](timestamp_type value, const delta& item)
+	{
+		return value < item.timestamp;
+	});
+
+	for (auto it = first; it != deltas_.cend() && (*it).timestamp <= to; ++it)
+	{
+		if ((*it).added)
+			result.push_back(&entries_.at((*it).id));
+	}
+
+	return true;
+}
+
+std::size_t process_history::get_memory_usage() const noexcept
+{
+	//Approximate, node based containers are counted by element size plus two pointers
+	static const std::size_t node_overhead = 2u * sizeof(void*);
+	std::size_t result = entries_.size() * (sizeof(entry) + sizeof(entry_id) + node_overhead)
+		+ live_.size() * (sizeof(live_key) + sizeof(entry_id) + 2u * node_overhead)
+		+ deltas_.size() * sizeof(delta);
+	for (const auto& item : snapshots_)
+		result += sizeof(snapshot) + item.live.capacity() * sizeof(entry_id);
+	for (const auto& name : names_)
+		result += sizeof(name) + name.capacity() * sizeof(wchar_t) + node_overhead;
+
+	return result;
+}
+
+void process_history::add_entry(timestamp_type timestamp, entry&& new_entry)
+{
+	auto key = make_live_key(new_entry.type, new_entry.owner, new_entry.value);
+	auto it = live_.find(key);
+	if (it != live_.end())
+		end_entry(timestamp, it);
+
+	auto id = next_id_++;
+	timestamp = (std::max)(timestamp, last_timestamp_);
+	new_entry.start_time = timestamp;
+	entries_.emplace(id, std::move(new_entry));
+	live_.emplace(key, id);
+	add_delta(timestamp, id, true);
+}
+
+void process_history::remove_entry(timestamp_type timestamp, entry_type type,
+	const process_key& owner, std::uint64_t value)
+{
+	auto it = live_.find(make_live_key(type, owner, value));
+	if (it != live_.end())
+		end_entry(timestamp, it);
+}
+
+void process_history::end_entry(timestamp_type timestamp, std::map<live_key, entry_id>::iterator it)
+{
+	timestamp = (std::max)(timestamp, last_timestamp_);
+	auto id = (*it).second;
+	entries_.at(id).end_time = timestamp;
+	live_.erase(it);
+	add_delta(timestamp, id, false);
+}
+
+void process_history::add_delta(timestamp_type timestamp, entry_id id, bool added)
+{
+	//Events may come slightly out of order, the log is kept sorted by
+	//moving late ones to the newest seen time
+	last_timestamp_ = timestamp;
+	deltas_.push_back({ timestamp, id, added });
+	if (dropped_delta_count_ + deltas_.size() - snapshots_.back().delta_index >= snapshot_interval_)
+		take_snapshot();
+}
+
+void process_history::take_snapshot()
+{
+	snapshot item{ last_timestamp_, dropped_delta_count_ + deltas_.size(), {} };
+	item.live.reserve(live_.size());
+	for (const auto& pair : live_)
+		item.live.push_back(pair.second);
+
+	std::sort(item.live.begin(), item.live.end());
+	snapshots_.push_back(std::move(item));
+	drop_expired();
+}
+
+void process_history::drop_expired()
+{
+	if (last_timestamp_ < (std::numeric_limits<timestamp_type>::min)() + retention_)
+		return;
+
+	auto horizon = last_timestamp_ - retention_;
+	auto snapshot_it = std::upper_bound(snapshots_.cbegin(), snapshots_.cend(), horizon,
+		[](timestamp_type value, const snapshot& item)
+	{
+		return value < item.timestamp;
+	});
+	if (snapshot_it == snapshots_.cbegin() || snapshot_it - 1 == snapshots_.cbegin())
+		return;
+
+	auto first_kept = (snapshot_it - 1) - snapshots_.cbegin();
+	auto delta_count = snapshots_[first_kept].delta_index - dropped_delta_count_;
+	for (std::size_t i = 0; i != delta_count; ++i)
+	{
+		//Entry which ended before the oldest kept snapshot is not referenced any more
+		if (!deltas_.front().added)
+			entries_.erase(deltas_.front().id);
+
+		deltas_.pop_front();
+	}
+
+	dropped_delta_count_ += delta_count;
+	snapshots_.erase(snapshots_.begin(), snapshots_.begin() + first_kept);
+}
+
+process_history::live_key process_history::make_live_key(entry_type type,
+	const process_key& owner, std::uint64_t value) noexcept
+{
+	//Process entry itself sorts before its threads and modules
+	if (type == entry_type::process)
+		value = 0u;
+
+	return live_key(owner.pid, owner.start_time, type, value);
+}
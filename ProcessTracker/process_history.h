@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "process_key.h"
+
+//Versioned process, thread and module state. Changes are kept as a log of
+//deltas with a snapshot of the live set taken every snapshot_interval
+//deltas, so the state at a point in time is the nearest earlier snapshot
+//(found by binary search) with at most snapshot_interval deltas applied.
+//History older than the retention horizon is dropped.
+class process_history
+{
+public:
+	using timestamp_type = std::int64_t;
+	using entry_id = std::uint32_t;
+
+	enum class entry_type : std::uint8_t
+	{
+		process,
+		thread,
+		module
+	};
+
+	struct entry
+	{
+		entry_type type;
+		//Process itself or the process owning the thread or module
+		process_key owner;
+		boost::optional<process_key> parent;
+		//Session ID for processes, TID for threads, image base for modules
+		std::uint64_t value;
+		//Image path for processes, image name for modules
+		const std::wstring* name;
+		timestamp_type start_time;
+		timestamp_type end_time;
+		//Set for processes which had image loads shed, their module
+		//entries may lack some of the loaded modules
+		bool incomplete_modules;
+	};
+
+	static const timestamp_type still_alive = (std::numeric_limits<timestamp_type>::max)();
+
+public:
+	process_history(timestamp_type retention, std::size_t snapshot_interval);
+
+	void add_process(timestamp_type timestamp, const process_key& key,
+		const boost::optional<process_key>& parent, std::uint32_t session_id, const std::wstring& path);
+	//Also ends threads and modules of the process which are still alive
+	void remove_process(timestamp_type timestamp, const process_key& key);
+	//Marks the live process entry
+	void mark_modules_incomplete(const process_key& key);
+	void add_thread(timestamp_type timestamp, const process_key& owner, std::uint32_t tid);
+	void remove_thread(timestamp_type timestamp, const process_key& owner, std::uint32_t tid);
+	void add_module(timestamp_type timestamp, const process_key& owner,
+		std::uint64_t image_base, const std::wstring& image_name);
+	void remove_module(timestamp_type timestamp, const process_key& owner, std::uint64_t image_base);
+
+	//Entries alive at the time. Returns false when the time is out of the retained history.
+	bool get_state(timestamp_type time, std::vector<const entry*>& result) const;
+	//Entries alive at any moment of [from, to]
+	bool get_state(timestamp_type from, timestamp_type to, std::vector<const entry*>& result) const;
+
+	timestamp_type get_oldest_time() const noexcept
+	{
+		return snapshots_.front().timestamp;
+	}
+
+	std::size_t get_entry_count() const noexcept
+	{
+		return entries_.size();
+	}
+
+	std::size_t get_memory_usage() const noexcept;
+
+private:
+	struct delta
+	{
+		timestamp_type timestamp;
+		entry_id id;
+		bool added;
+	};
+
+	struct snapshot
+	{
+		timestamp_type timestamp;
+		std::size_t delta_index;
+		std::vector<entry_id> live;
+	};
+
+	//Ordered by owner first, so live threads and modules of a process are adjacent
+	using live_key = std::tuple<std::uint32_t, timestamp_type, entry_type, std::uint64_t>;
+
+private:
+	void add_entry(timestamp_type timestamp, entry&& new_entry);
+	void remove_entry(timestamp_type timestamp, entry_type type,
+		const process_key& owner, std::uint64_t value);
+	void end_entry(timestamp_type timestamp, std::map<live_key, entry_id>::iterator it);
+	void add_delta(timestamp_type timestamp, entry_id id, bool added);
+	void take_snapshot();
+	void drop_expired();
+
+	static live_key make_live_key(entry_type type, const process_key& owner, std::uint64_t value) noexcept;
+
+private:
+	timestamp_type retention_;
+	std::size_t snapshot_interval_;
+	timestamp_type last_timestamp_ = (std::numeric_limits<timestamp_type>::min)();
+	entry_id next_id_ = 0;
+	std::unordered_map<entry_id, entry> entries_;
+	std::map<live_key, entry_id> live_;
+	std::deque<delta> deltas_;
+	std::size_t dropped_delta_count_ = 0;
+	std::deque<snapshot> snapshots_;
+	std::unordered_set<std::wstring> names_;
+};
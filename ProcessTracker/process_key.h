@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+//Identifies a process generation, PIDs are reused, so the process start
+//timestamp tells apart processes which had the same PID at different times
+struct process_key
+{
+	std::uint32_t pid;
+	std::int64_t start_time;
+
+	friend bool operator==(const process_key& left, const process_key& right) noexcept
+	{
+		return left.pid == right.pid && left.start_time == right.start_time;
+	}
+
+	friend bool operator!=(const process_key& left, const process_key& right) noexcept
+	{
+		return !(left == right);
+	}
+
+	friend bool operator<(const process_key& left, const process_key& right) noexcept
+	{
+		return left.pid < right.pid || (left.pid == right.pid && left.start_time < right.start_time);
+	}
+};
+
+struct process_key_hash
+{
+	std::size_t operator()(const process_key& key) const noexcept
+	{
+		return std::hash<std::uint64_t>()(static_cast<std::uint64_t>(key.start_time) * 31u + key.pid);
+	}
+};
@@ -1,12 +1,152 @@
 #include "process_list.h"
 
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include <TlHelp32.h>
+
 #include "event_tracing/event_info.h"
 #include "event_tracing/event_provider_list.h"
+#include "event_tracing/self_profiler.h"
+
+namespace
+{
+//Exit code reported for processes whose stop event was never seen
+constexpr const std::uint32_t unknown_exit_code = 0;
+
+constexpr const std::size_t history_snapshot_interval = 4096;
+
+constexpr const std::size_t exited_memory_budget = 64u * 1024 * 1024;
+constexpr const exited_process_store::timestamp_type exited_max_age = 24ll * 60 * 60 * 10000000;
+constexpr const std::size_t exited_max_ended_items = 64;
+
+constexpr const std::chrono::milliseconds::rep journal_flush_interval = 1000;
+
+std::int64_t get_current_time() noexcept
+{
+	FILETIME time{};
+	::GetSystemTimeAsFileTime(&time);
+	return static_cast<std::int64_t>(
+		(static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+}
+
+bool is_process_running(const process& target) noexcept
+{
+	auto handle = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, target.get_pid());
+	if (!handle)
+		return ::GetLastError() == ERROR_ACCESS_DENIED;
+
+	std::unique_ptr<void, BOOL(WINAPI*)(HANDLE)> handle_holder(handle, ::CloseHandle);
+	DWORD exit_code = 0;
+	if (!::GetExitCodeProcess(handle, &exit_code) || exit_code != STILL_ACTIVE)
+		return false;
+
+	//Process with the same PID created after the recorded one is a different process
+	FILETIME creation_time{}, exit_time{}, kernel_time{}, user_time{};
+	if (!::GetProcessTimes(handle, &creation_time, &exit_time, &kernel_time, &user_time))
+		return true;
+
+	auto created = static_cast<std::int64_t>(
+		(static_cast<std::uint64_t>(creation_time.dwHighDateTime) << 32) | creation_time.dwLowDateTime);
+	return created <= target.get_start_time();
+}
+
+std::uint32_t get_checkpoint_error_code(const checkpoint_error& error) noexcept
+{
+	return error.get_error_code() ? error.get_error_code() : ERROR_FILE_CORRUPT;
+}
+} //namespace
+
+class process_list::journal_visitor
+{
+public:
+	explicit journal_visitor(process_list& list) noexcept
+		: list_(list)
+	{
+	}
+
+	void process_started(process&& new_process, const boost::optional<process_key>& parent_key)
+	{
+		list_.add_process(std::move(new_process), parent_key);
+	}
+
+	void process_stopped(std::uint32_t pid, std::uint32_t exit_code, std::int64_t exit_time)
+	{
+		list_.remove_process(pid, exit_code, exit_time);
+	}
+
+	void thread_started(process_thread&& thread)
+	{
+		list_.add_thread(std::move(thread));
+	}
+
+	void thread_stopped(std::uint32_t pid, std::uint32_t tid)
+	{
+		list_.remove_thread(pid, tid);
+	}
+
+	void module_loaded(process_module&& module)
+	{
+		list_.add_module(std::move(module));
+	}
+
+	void module_unloaded(std::uint32_t pid, std::uint64_t image_base)
+	{
+		list_.remove_module(pid, image_base);
+	}
+
+	void modules_incomplete(std::uint32_t pid)
+	{
+		list_.mark_modules_incomplete(pid);
+	}
+
+private:
+	process_list& list_;
+};
+
+process_list::process_list()
+	: exited_(exited_memory_budget, exited_max_age, exited_max_ended_items)
+{
+}
+
+void process_list::enable_checkpoints(const std::wstring& file_name, std::chrono::milliseconds checkpoint_interval)
+{
+	checkpoint_file_name_ = file_name;
+	checkpoint_interval_ = checkpoint_interval;
+}
+
+void process_list::enable_metrics_endpoint(unsigned short port)
+{
+	metrics_port_ = port;
+}
+
+void process_list::enable_history(process_history::timestamp_type retention)
+{
+	history_ = std::make_unique<process_history>(retention, history_snapshot_interval);
+}
+
+void process_list::enable_overload_control()
+{
+	overload_control_ = true;
+}
 
 void process_list::start_tracking()
 {
 	using namespace event_tracing;
 
+	register_metrics();
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_saver_ = std::make_unique<checkpoint_saver>(checkpoint_file_name_,
+			std::chrono::milliseconds(journal_flush_interval), [this](const checkpoint_error& error)
+		{
+			on_error_(get_checkpoint_error_code(error));
+		});
+		restore_checkpoint();
+	}
+
 	auto process_provider_guid = event_provider_list().get_guid(L"Microsoft-Windows-Kernel-Process");
 	sess_ = std::make_unique<event_trace_session>(L"Kaimi.io test session");
 	static constexpr const std::uint64_t keyword_process = 0x10;
@@ -14,7 +154,25 @@ void process_list::start_tracking()
 	static constexpr const std::uint64_t keyword_image = 0x40;
 	sess_->enable_trace(process_provider_guid, event_trace_session::trace_level::verbose,
 		keyword_process | keyword_thread | keyword_image);
+	snapshot_running_processes();
 	trace_ = std::make_unique<event_trace>(*sess_);
+	trace_->enable_metrics(metrics_);
+	losses_.enable_metrics(metrics_);
+	trace_->enable_loss_accounting(losses_);
+
+	//Real-time events come in per-processor buffers, so a thread may be
+	//reported before its process; put them back in order before handling.
+	//Events are not held longer than max delay, so the view stays current
+	//when the system is quiet.
+	static constexpr const std::int64_t reorder_time_window = 10000000;
+	static constexpr const std::size_t reorder_max_event_count = 65536;
+	static constexpr const std::chrono::milliseconds::rep reorder_max_delay = 100;
+	trace_->enable_reordering(reorder_time_window, reorder_max_event_count,
+		std::chrono::milliseconds(reorder_max_delay));
+
+	//Process start and stop handling must not wait behind image load bursts
+	static constexpr const std::size_t dispatch_lane_capacity = 16384;
+	trace_->enable_priority_dispatch(dispatch_lane_capacity);
 
 	static constexpr const USHORT event_process_started = 1;
 	static constexpr const USHORT event_process_stopped = 2;
@@ -22,11 +180,11 @@ void process_list::start_tracking()
 	static constexpr const USHORT event_thread_stopped = 4;
 	static constexpr const USHORT image_loaded = 5;
 	static constexpr const USHORT image_unloaded = 6;
-	trace_->on_trace_event(process_provider_guid, event_process_started, [this](auto event_record)
+	trace_->on_trace_event(process_provider_guid, event_process_started, event_priority::high, [this](auto event_record)
 	{
 		on_process_started(event_record);
 	});
-	trace_->on_trace_event(process_provider_guid, event_process_stopped, [this](auto event_record)
+	trace_->on_trace_event(process_provider_guid, event_process_stopped, event_priority::high, [this](auto event_record)
 	{
 		on_process_stopped(event_record);
 	});
@@ -38,88 +196,546 @@ void process_list::start_tracking()
 	{
 		on_thread_stopped(event_record);
 	});
-	trace_->on_trace_event(process_provider_guid, image_loaded, [this](auto event_record)
+	trace_->on_trace_event(process_provider_guid, image_loaded, event_priority::bulk, [this](auto event_record)
 	{
 		on_image_loaded(event_record);
 	});
-	trace_->on_trace_event(process_provider_guid, image_unloaded, [this](auto event_record)
+	trace_->on_trace_event(process_provider_guid, image_unloaded, event_priority::bulk, [this](auto event_record)
 	{
 		on_image_unloaded(event_record);
 	});
+
+	//Image load storms are sampled instead of stalling the trace. Unloads are
+	//not shed, a lost one would leave the module loaded for good.
+	if (overload_control_)
+	{
+		trace_->enable_overload_control(overload_policy());
+		trace_->set_sheddable(process_provider_guid, image_loaded);
+		trace_->on_shed_event([this](auto event_record)
+		{
+			std::lock_guard<std::mutex> lock(shed_loads_mutex_);
+			auto& timestamp = shed_loads_[event_record->EventHeader.ProcessId];
+			timestamp = (std::max<std::int64_t>)(timestamp, event_record->EventHeader.TimeStamp.QuadPart);
+			has_shed_loads_.store(true, std::memory_order_release);
+		});
+	}
+
 	trace_->on_error([this](std::uint32_t error)
 	{
 		on_error_(error);
 	});
 	trace_->on_stop_trace([this]()
 	{
+		mark_shed_modules();
+		if (!checkpoint_file_name_.empty())
+		{
+			save_checkpoint();
+			if (checkpoint_saver_)
+				checkpoint_saver_->flush();
+		}
+
 		on_stop_trace_();
 	});
 
+	if (metrics_port_)
+	{
+		metrics_endpoint_ = std::make_unique<metrics_endpoint>(metrics_, metrics_port_);
+		metrics_endpoint_->run_async();
+	}
+
 	trace_->run_async();
 }
 
 void process_list::on_process_started(PEVENT_RECORD record)
 {
+	EVENT_TRACING_PROFILE_SCOPE("process_list::on_process_started");
 	process new_process(record);
-	auto it = processes_.emplace(new_process.get_pid(), std::move(new_process)).first;
-	on_new_process_((*it).second);
+	preexisting_pids_.erase(new_process.get_pid());
+	auto parent_key = find_parent(new_process);
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_writer records;
+		write_process_started(records, new_process, parent_key);
+		write_journal(records);
+	}
+
+	if (history_)
+	{
+		history_->add_process(new_process.get_start_time(), new_process.get_key(), parent_key,
+			new_process.get_session_id(), new_process.get_path());
+	}
+
+	add_process(std::move(new_process), parent_key);
+	list_metrics_.processes_started->increment();
+	update_metrics();
 }
 
 void process_list::on_process_stopped(PEVENT_RECORD record)
 {
+	EVENT_TRACING_PROFILE_SCOPE("process_list::on_process_stopped");
 	event_tracing::event_info info(record);
 	auto pid = info.get_plain_property_value<std::uint32_t>(L"ProcessID");
 	auto exit_code = info.get_plain_property_value<std::uint32_t>(L"ExitCode");
+	auto exit_time = record->EventHeader.TimeStamp.QuadPart;
+	mark_shed_modules();
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_writer records;
+		write_process_stopped(records, pid, exit_code, exit_time);
+		write_journal(records);
+	}
+
 	auto it = processes_.find(pid);
-	if (it != processes_.cend())
+	if (it == processes_.cend())
 	{
-		on_stopped_process_((*it).second, exit_code);
-		processes_.erase(it);
+		if (!preexisting_pids_.erase(pid))
+			losses_.add_orphaned_event(*record);
+	}
+	else if (history_)
+	{
+		history_->remove_process(exit_time, (*it).second.get_key());
 	}
+
+	remove_process(pid, exit_code, exit_time);
+	list_metrics_.processes_stopped->increment();
+	update_metrics();
 }
 
 void process_list::on_thread_started(PEVENT_RECORD record)
 {
+	EVENT_TRACING_PROFILE_SCOPE("process_list::on_thread_started");
 	auto thread = process_thread(record);
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_writer records;
+		write_thread_started(records, thread);
+		write_journal(records);
+	}
+
 	auto it = processes_.find(thread.get_pid());
-	if (it != processes_.cend())
-		on_new_thread_((*it).second, (*it).second.add_thread(std::move(thread)));
+	if (it == processes_.cend())
+		check_orphaned(thread.get_pid(), *record);
+	else if (history_)
+		history_->add_thread(record->EventHeader.TimeStamp.QuadPart, (*it).second.get_key(), thread.get_tid());
+
+	add_thread(std::move(thread));
+	list_metrics_.threads_started->increment();
+	update_metrics();
 }
 
 void process_list::on_thread_stopped(PEVENT_RECORD record)
 {
+	EVENT_TRACING_PROFILE_SCOPE("process_list::on_thread_stopped");
 	auto thread = process_thread(record);
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_writer records;
+		write_thread_stopped(records, thread.get_pid(), thread.get_tid());
+		write_journal(records);
+	}
+
+	auto it = processes_.find(thread.get_pid());
+	if (it == processes_.cend())
+		check_orphaned(thread.get_pid(), *record);
+	else if (history_)
+		history_->remove_thread(record->EventHeader.TimeStamp.QuadPart, (*it).second.get_key(), thread.get_tid());
+
+	remove_thread(thread.get_pid(), thread.get_tid());
+	list_metrics_.threads_stopped->increment();
+	update_metrics();
+}
+
+void process_list::on_image_loaded(PEVENT_RECORD record)
+{
+	EVENT_TRACING_PROFILE_SCOPE("process_list::on_image_loaded");
+	auto module = process_module(record);
+	mark_shed_modules();
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_writer records;
+		write_module_loaded(records, module);
+		write_journal(records);
+	}
+
+	auto it = processes_.find(module.get_pid());
+	if (it == processes_.cend())
+	{
+		check_orphaned(module.get_pid(), *record);
+	}
+	else if (history_)
+	{
+		history_->add_module(record->EventHeader.TimeStamp.QuadPart, (*it).second.get_key(),
+			module.get_image_base(), module.get_image_name());
+	}
+
+	add_module(std::move(module));
+	list_metrics_.modules_loaded->increment();
+	update_metrics();
+}
+
+void process_list::on_image_unloaded(PEVENT_RECORD record)
+{
+	EVENT_TRACING_PROFILE_SCOPE("process_list::on_image_unloaded");
+	auto module = process_module(record);
+	mark_shed_modules();
+	if (!checkpoint_file_name_.empty())
+	{
+		checkpoint_writer records;
+		write_module_unloaded(records, module.get_pid(), module.get_image_base());
+		write_journal(records);
+	}
+
+	auto it = processes_.find(module.get_pid());
+	if (it == processes_.cend())
+	{
+		check_orphaned(module.get_pid(), *record);
+	}
+	else if (history_)
+	{
+		history_->remove_module(record->EventHeader.TimeStamp.QuadPart, (*it).second.get_key(),
+			module.get_image_base());
+	}
+
+	remove_module(module.get_pid(), module.get_image_base());
+	list_metrics_.modules_unloaded->increment();
+	update_metrics();
+}
+
+boost::optional<process_key> process_list::find_parent(const process& child) const
+{
+	auto it = processes_.find(child.get_parent_pid());
+	if (it == processes_.cend() || (*it).second.get_start_time() > child.get_start_time())
+		return boost::none;
+
+	return (*it).second.get_key();
+}
+
+void process_list::add_process(process&& new_process, const boost::optional<process_key>& parent_key)
+{
+	auto it = processes_.find(new_process.get_pid());
+	if (it != processes_.cend())
+	{
+		if ((*it).second.get_key() == new_process.get_key())
+			return;
+
+		//Stop event of the previous process with this PID was lost
+		if (history_)
+			history_->remove_process(new_process.get_start_time(), (*it).second.get_key());
+		remove_process(new_process.get_pid(), unknown_exit_code, new_process.get_start_time());
+	}
+
+	tree_.add(new_process.get_key(), parent_key);
+	it = processes_.emplace(new_process.get_pid(), std::move(new_process)).first;
+	on_new_process_((*it).second);
+}
+
+void process_list::remove_process(std::uint32_t pid, std::uint32_t exit_code, std::int64_t exit_time)
+{
+	auto it = processes_.find(pid);
+	if (it != processes_.cend())
+	{
+		on_stopped_process_((*it).second, exit_code);
+		auto key = (*it).second.get_key();
+		auto parent_key = tree_.get_parent(key);
+		tree_.mark_exited(key);
+		exited_.add(std::move((*it).second), parent_key, exit_code, exit_time);
+		processes_.erase(it);
+	}
+}
+
+void process_list::add_thread(process_thread&& thread)
+{
 	auto it = processes_.find(thread.get_pid());
+	if (it != processes_.cend())
+		on_new_thread_((*it).second, (*it).second.add_thread(std::move(thread)));
+}
+
+void process_list::remove_thread(std::uint32_t pid, std::uint32_t tid)
+{
+	auto it = processes_.find(pid);
 	if (it != processes_.cend())
 	{
-		auto thread_ptr = (*it).second.get_thread(thread.get_tid());
+		auto thread_ptr = (*it).second.get_thread(tid);
 		if (thread_ptr)
 		{
 			on_stopped_thread_((*it).second, *thread_ptr);
-			(*it).second.remove_thread(thread.get_tid());
+			exited_.add_ended_thread((*it).second.get_key(), *thread_ptr);
+			(*it).second.remove_thread(tid);
 		}
 	}
 }
 
-void process_list::on_image_loaded(PEVENT_RECORD record)
+void process_list::add_module(process_module&& module)
 {
-	auto module = process_module(record);
 	auto it = processes_.find(module.get_pid());
 	if (it != processes_.cend())
 		on_loaded_module_((*it).second, (*it).second.add_module(std::move(module)));
 }
 
-void process_list::on_image_unloaded(PEVENT_RECORD record)
+void process_list::remove_module(std::uint32_t pid, std::uint64_t image_base)
 {
-	auto module = process_module(record);
-	auto it = processes_.find(module.get_pid());
+	auto it = processes_.find(pid);
 	if (it != processes_.cend())
 	{
-		auto module_ptr = (*it).second.get_module(module.get_image_base());
+		auto module_ptr = (*it).second.get_module(image_base);
 		if (module_ptr)
 		{
 			on_unloaded_module_((*it).second, *module_ptr);
-			(*it).second.remove_module(module.get_image_base());
+			exited_.add_ended_module((*it).second.get_key(), *module_ptr);
+			(*it).second.remove_module(image_base);
+		}
+	}
+}
+
+void process_list::mark_modules_incomplete(std::uint32_t pid)
+{
+	auto it = processes_.find(pid);
+	if (it != processes_.cend())
+	{
+		(*it).second.mark_modules_incomplete();
+		if (history_)
+			history_->mark_modules_incomplete((*it).second.get_key());
+	}
+}
+
+void process_list::mark_shed_modules()
+{
+	if (!has_shed_loads_.load(std::memory_order_acquire))
+		return;
+
+	std::unordered_map<std::uint32_t, std::int64_t> shed_loads;
+	{
+		std::lock_guard<std::mutex> lock(shed_loads_mutex_);
+		shed_loads.swap(shed_loads_);
+		has_shed_loads_.store(false, std::memory_order_relaxed);
+	}
+
+	for (const auto& pair : shed_loads)
+	{
+		//Loads shed before the process started were of an earlier one with the same PID
+		auto it = processes_.find(pair.first);
+		if (it == processes_.cend() || (*it).second.has_incomplete_modules()
+			|| (*it).second.get_start_time() > pair.second)
+		{
+			continue;
+		}
+
+		mark_modules_incomplete(pair.first);
+		if (!checkpoint_file_name_.empty())
+		{
+			checkpoint_writer records;
+			write_modules_incomplete(records, pair.first);
+			write_journal(records);
 		}
 	}
 }
+
+void process_list::snapshot_running_processes()
+{
+	//Taken after the session is enabled, so that processes started in between
+	//are reported by their start events
+	preexisting_pids_.clear();
+	auto snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE)
+		return;
+
+	std::unique_ptr<void, BOOL(WINAPI*)(HANDLE)> snapshot_holder(snapshot, ::CloseHandle);
+	PROCESSENTRY32W entry{};
+	entry.dwSize = sizeof(entry);
+	for (auto found = ::Process32FirstW(snapshot, &entry); found; found = ::Process32NextW(snapshot, &entry))
+	{
+		if (processes_.find(entry.th32ProcessID) == processes_.cend())
+			preexisting_pids_.insert(entry.th32ProcessID);
+	}
+}
+
+void process_list::check_orphaned(std::uint32_t pid, const EVENT_RECORD& record)
+{
+	//Start event of the process has been lost
+	if (preexisting_pids_.find(pid) == preexisting_pids_.cend())
+		losses_.add_orphaned_event(record);
+}
+
+void process_list::register_metrics()
+{
+	list_metrics_.processes_started = &metrics_.add_counter("process_tracker_processes_started_total",
+		"Process start events handled");
+	list_metrics_.processes_stopped = &metrics_.add_counter("process_tracker_processes_stopped_total",
+		"Process stop events handled");
+	list_metrics_.threads_started = &metrics_.add_counter("process_tracker_threads_started_total",
+		"Thread start events handled");
+	list_metrics_.threads_stopped = &metrics_.add_counter("process_tracker_threads_stopped_total",
+		"Thread stop events handled");
+	list_metrics_.modules_loaded = &metrics_.add_counter("process_tracker_modules_loaded_total",
+		"Image load events handled");
+	list_metrics_.modules_unloaded = &metrics_.add_counter("process_tracker_modules_unloaded_total",
+		"Image unload events handled");
+	list_metrics_.processes = &metrics_.add_gauge("process_tracker_processes",
+		"Running processes tracked");
+	list_metrics_.exited_processes = &metrics_.add_gauge("process_tracker_exited_processes",
+		"Exited processes kept");
+	list_metrics_.exited_memory = &metrics_.add_gauge("process_tracker_exited_memory_bytes",
+		"Memory used by exited processes");
+	list_metrics_.history_entries = &metrics_.add_gauge("process_tracker_history_entries",
+		"Process history entries kept");
+}
+
+void process_list::update_metrics() noexcept
+{
+	list_metrics_.processes->set(static_cast<std::int64_t>(processes_.size()));
+	list_metrics_.exited_processes->set(static_cast<std::int64_t>(exited_.size()));
+	list_metrics_.exited_memory->set(static_cast<std::int64_t>(exited_.get_memory_usage()));
+	if (history_)
+		list_metrics_.history_entries->set(static_cast<std::int64_t>(history_->get_entry_count()));
+}
+
+void process_list::restore_checkpoint()
+{
+	try
+	{
+		auto data = read_checkpoint_file(checkpoint_file_name_);
+		if (!data.empty())
+		{
+			auto restored = load_checkpoint(data.data(), data.size(), checkpoint_generation_);
+			std::sort(restored.begin(), restored.end(), [](const auto& left, const auto& right)
+			{
+				return left.value.get_start_time() < right.value.get_start_time();
+			});
+
+			for (auto& entry : restored)
+			{
+				auto threads = entry.value.get_threads();
+				auto modules = entry.value.get_modules();
+				add_process(process(entry.value.get_path(), entry.value.get_pid(),
+					entry.value.get_start_time(), entry.value.get_parent_pid(),
+					entry.value.get_session_id()), entry.parent);
+				for (auto& thread : threads)
+					add_thread(std::move(thread.second));
+				for (auto& module : modules)
+					add_module(std::move(module.second));
+				if (entry.value.has_incomplete_modules())
+					mark_modules_incomplete(entry.value.get_pid());
+			}
+
+			auto journal = read_checkpoint_file(checkpoint_file_name_ + L".journal");
+			if (!journal.empty())
+			{
+				checkpoint_reader reader(journal.data(), journal.size());
+				if (read_journal_header(reader) == checkpoint_generation_)
+					replay_journal(reader, journal_visitor(*this));
+			}
+		}
+	}
+	catch (const checkpoint_error& error)
+	{
+		//Damaged checkpoint is dropped, tracking starts from scratch
+		for (const auto& pair : processes_)
+		{
+			on_stopped_process_(pair.second, unknown_exit_code);
+			exited_.discard_ended(pair.second.get_key());
+		}
+		processes_.clear();
+		tree_ = process_tree();
+		on_error_(get_checkpoint_error_code(error));
+	}
+
+	remove_exited_processes();
+	if (history_)
+		record_restored_history();
+	reset_checkpoint_state();
+}
+
+void process_list::record_restored_history()
+{
+	//Exact thread and module times are not kept in checkpoints, history of
+	//restored processes starts at the process start time
+	std::vector<const process*> restored;
+	for (const auto& pair : processes_)
+		restored.push_back(&pair.second);
+
+	std::sort(restored.begin(), restored.end(), [](const process* left, const process* right)
+	{
+		return left->get_start_time() < right->get_start_time();
+	});
+
+	for (auto value : restored)
+	{
+		auto key = value->get_key();
+		history_->add_process(key.start_time, key, tree_.get_parent(key),
+			value->get_session_id(), value->get_path());
+		for (const auto& thread : value->get_threads())
+			history_->add_thread(key.start_time, key, thread.second.get_tid());
+		for (const auto& module : value->get_modules())
+		{
+			history_->add_module(key.start_time, key, module.second.get_image_base(),
+				module.second.get_image_name());
+		}
+
+		if (value->has_incomplete_modules())
+			history_->mark_modules_incomplete(key);
+	}
+}
+
+void process_list::remove_exited_processes()
+{
+	std::vector<std::uint32_t> exited;
+	for (const auto& pair : processes_)
+	{
+		if (!is_process_running(pair.second))
+			exited.push_back(pair.first);
+	}
+
+	//Exit time is not known, the process is taken as exited now
+	auto exit_time = get_current_time();
+	for (auto pid : exited)
+		remove_process(pid, unknown_exit_code, exit_time);
+}
+
+void process_list::reset_checkpoint_state()
+{
+	if (!check_checkpoint_saver())
+		return;
+
+	//State is copied once, later checkpoints are encoded from journal records
+	std::vector<restored_process> state;
+	state.reserve(processes_.size());
+	for (const auto& pair : processes_)
+		state.push_back({ pair.second, tree_.get_parent(pair.second.get_key()) });
+
+	++checkpoint_generation_;
+	checkpoint_saver_->reset(checkpoint_generation_, std::move(state));
+	checkpoint_time_ = std::chrono::steady_clock::now();
+}
+
+void process_list::save_checkpoint()
+{
+	if (!check_checkpoint_saver())
+		return;
+
+	++checkpoint_generation_;
+	checkpoint_saver_->save(checkpoint_generation_);
+	checkpoint_time_ = std::chrono::steady_clock::now();
+}
+
+void process_list::write_journal(const checkpoint_writer& records)
+{
+	EVENT_TRACING_PROFILE_SCOPE("process_list::write_journal");
+	if (!check_checkpoint_saver())
+		return;
+
+	checkpoint_saver_->append(records);
+	if (std::chrono::steady_clock::now() - checkpoint_time_ >= checkpoint_interval_)
+		save_checkpoint();
+}
+
+bool process_list::check_checkpoint_saver() noexcept
+{
+	if (!checkpoint_saver_->has_failed())
+		return true;
+
+	//Checkpoints are disabled after a failure, which the saver has reported,
+	//tracking goes on without them
+	checkpoint_file_name_.clear();
+	checkpoint_saver_.reset();
+	return false;
+}
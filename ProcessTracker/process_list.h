@@ -1,19 +1,35 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <Windows.h>
 #include <CommCtrl.h>
 
+#include <boost/optional.hpp>
 #include <boost/signals2.hpp>
 
 #include "event_tracing/event_trace.h"
 #include "event_tracing/event_trace_session.h"
+#include "event_tracing/loss_tracker.h"
+#include "event_tracing/metrics_endpoint.h"
+#include "event_tracing/metrics_registry.h"
 
+#include "checkpoint_file.h"
+#include "exited_process_store.h"
 #include "process.h"
+#include "process_checkpoint.h"
+#include "process_history.h"
 #include "process_module.h"
 #include "process_thread.h"
+#include "process_tree.h"
 
 class process_list
 {
@@ -37,6 +53,24 @@ public:
 	using stop_signal = boost::signals2::signal<stop_handler>;
 
 public:
+	process_list();
+
+	//State is restored from the checkpoint file when tracking starts and saved
+	//to it once checkpoint_interval has passed while events come and when the
+	//trace stops. Changes made in between are written to a journal, which is
+	//replayed on restore. Both are written on a background thread, the journal
+	//once a second, checkpoints are encoded there from the journal records.
+	void enable_checkpoints(const std::wstring& file_name, std::chrono::milliseconds checkpoint_interval);
+	//Metrics are served on the loopback interface when tracking starts
+	void enable_metrics_endpoint(unsigned short port);
+	//Process, thread and module history is kept for the retention period
+	//(in 100-nanosecond intervals). History is not kept unless enabled.
+	void enable_history(process_history::timestamp_type retention);
+	//Image loads are sampled instead of stalling the trace when event handling
+	//falls behind. Processes which had loads shed are marked as having
+	//incomplete modules. Image unloads, process and thread events are never
+	//shed. Events are not shed unless enabled.
+	void enable_overload_control();
 	void start_tracking();
 
 	template<typename Handler>
@@ -87,6 +121,53 @@ public:
 		return on_stop_trace_.connect(std::forward<Handler>(handler));
 	}
 
+	//Tree, history and exited processes may be used in the handlers only,
+	//which are called on the event dispatch thread
+	const process_tree& get_process_tree() const noexcept
+	{
+		return tree_;
+	}
+
+	//Null when history is not enabled
+	const process_history* get_history() const noexcept
+	{
+		return history_.get();
+	}
+
+	const exited_process_store& get_exited_processes() const noexcept
+	{
+		return exited_;
+	}
+
+	const event_tracing::metrics_registry& get_metrics() const noexcept
+	{
+		return metrics_;
+	}
+
+	//Thread and image events of processes which were neither running when
+	//tracking started nor reported started are counted as orphaned
+	event_tracing::loss_tracker& get_loss_tracker() noexcept
+	{
+		return losses_;
+	}
+
+private:
+	class journal_visitor;
+
+	struct list_metrics
+	{
+		event_tracing::metric_counter* processes_started;
+		event_tracing::metric_counter* processes_stopped;
+		event_tracing::metric_counter* threads_started;
+		event_tracing::metric_counter* threads_stopped;
+		event_tracing::metric_counter* modules_loaded;
+		event_tracing::metric_counter* modules_unloaded;
+		event_tracing::metric_gauge* processes;
+		event_tracing::metric_gauge* exited_processes;
+		event_tracing::metric_gauge* exited_memory;
+		event_tracing::metric_gauge* history_entries;
+	};
+
 private:
 	void on_process_started(PEVENT_RECORD record);
 	void on_process_stopped(PEVENT_RECORD record);
@@ -95,8 +176,34 @@ private:
 	void on_image_loaded(PEVENT_RECORD record);
 	void on_image_unloaded(PEVENT_RECORD record);
 
+	boost::optional<process_key> find_parent(const process& child) const;
+	void add_process(process&& new_process, const boost::optional<process_key>& parent_key);
+	void remove_process(std::uint32_t pid, std::uint32_t exit_code, std::int64_t exit_time);
+	void add_thread(process_thread&& thread);
+	void remove_thread(std::uint32_t pid, std::uint32_t tid);
+	void add_module(process_module&& module);
+	void remove_module(std::uint32_t pid, std::uint64_t image_base);
+	void mark_modules_incomplete(std::uint32_t pid);
+	void mark_shed_modules();
+	void snapshot_running_processes();
+	void check_orphaned(std::uint32_t pid, const EVENT_RECORD& record);
+
+	void register_metrics();
+	void update_metrics() noexcept;
+
+	void restore_checkpoint();
+	void remove_exited_processes();
+	void record_restored_history();
+	void reset_checkpoint_state();
+	void save_checkpoint();
+	void write_journal(const checkpoint_writer& records);
+	bool check_checkpoint_saver() noexcept;
+
 private:
 	std::map<std::uint32_t, process> processes_;
+	process_tree tree_;
+	std::unique_ptr<process_history> history_;
+	exited_process_store exited_;
 	new_process_signal on_new_process_;
 	stopped_process_signal on_stopped_process_;
 	new_thread_signal on_new_thread_;
@@ -105,6 +212,23 @@ private:
 	unloaded_module_signal on_unloaded_module_;
 	error_signal on_error_;
 	stop_signal on_stop_trace_;
+	std::wstring checkpoint_file_name_;
+	std::chrono::milliseconds checkpoint_interval_{ 0 };
+	std::chrono::steady_clock::time_point checkpoint_time_;
+	std::uint64_t checkpoint_generation_ = 0;
+	std::unique_ptr<checkpoint_saver> checkpoint_saver_;
+	event_tracing::metrics_registry metrics_;
+	list_metrics list_metrics_{};
+	unsigned short metrics_port_ = 0;
+	std::unique_ptr<event_tracing::metrics_endpoint> metrics_endpoint_;
+	bool overload_control_ = false;
+	//Latest timestamps of shed image loads by PID, collected on the trace thread
+	std::mutex shed_loads_mutex_;
+	std::unordered_map<std::uint32_t, std::int64_t> shed_loads_;
+	std::atomic<bool> has_shed_loads_{ false };
+	event_tracing::loss_tracker losses_;
+	//Processes running before tracking started which have not been reported since
+	std::unordered_set<std::uint32_t> preexisting_pids_;
 	std::unique_ptr<event_tracing::event_trace_session> sess_;
 	std::unique_ptr<event_tracing::event_trace> trace_;
 };
@@ -9,3 +9,11 @@ process_module::process_module(PEVENT_RECORD record)
 	image_base_ = info.get_plain_property_value<event_tracing::event_type_pointer>(L"ImageBase");
 	image_name_ = info.get_plain_property_value<std::wstring>(L"ImageName");
 }
+
+process_module::process_module(std::uint32_t pid, std::uint64_t image_base,
+	const std::wstring& image_name)
+	: pid_(pid)
+	, image_base_(image_base)
+	, image_name_(image_name)
+{
+}
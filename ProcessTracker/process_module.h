@@ -9,6 +9,7 @@ class process_module
 {
 public:
 	explicit process_module(PEVENT_RECORD record);
+	process_module(std::uint32_t pid, std::uint64_t image_base, const std::wstring& image_name);
 
 	std::uint32_t get_pid() const noexcept
 	{
@@ -12,3 +12,13 @@ process_thread::process_thread(PEVENT_RECORD record)
 	user_stack_base_ = info.get_plain_property_value<event_tracing::event_type_pointer>(L"UserStackBase");
 	user_stack_limit_ = info.get_plain_property_value<event_tracing::event_type_pointer>(L"UserStackLimit");
 }
+
+process_thread::process_thread(std::uint32_t pid, std::uint32_t tid, std::uint64_t ep,
+	std::uint64_t user_stack_base, std::uint64_t user_stack_limit) noexcept
+	: pid_(pid)
+	, tid_(tid)
+	, ep_(ep)
+	, user_stack_base_(user_stack_base)
+	, user_stack_limit_(user_stack_limit)
+{
+}
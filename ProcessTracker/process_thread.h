@@ -8,6 +8,8 @@ class process_thread
 {
 public:
 	explicit process_thread(PEVENT_RECORD record);
+	process_thread(std::uint32_t pid, std::uint32_t tid, std::uint64_t ep,
+		std::uint64_t user_stack_base, std::uint64_t user_stack_limit) noexcept;
 
 	std::uint32_t get_tid() const noexcept
 	{
@@ -26,7 +28,7 @@ public:
 
 	std::uint64_t get_user_stack_base() const noexcept
 	{
-		return pid_;
+		return user_stack_base_;
 	}
 
 	std::uint64_t get_user_stack_limit() const noexcept
@@ -0,0 +1,216 @@
+#include "process_tree.h"
+
+#include <limits>
+#include <utility>
+
+namespace
+{
+constexpr const std::uint32_t head_tag = 0;
+constexpr const std::uint32_t tail_tag = 1;
+constexpr const std::uint32_t root_node = 0;
+} //namespace
+
+process_tree::process_tree()
+{
+	tags_.push_back({ 0u, head_tag, tail_tag });
+	tags_.push_back({ (std::numeric_limits<std::uint64_t>::max)(), head_tag, tail_tag });
+	nodes_.push_back({ process_key{ 0u, 0 }, root_node, 0u, head_tag, tail_tag, {}, false });
+}
+
+void process_tree::add(const process_key& key, const boost::optional<process_key>& parent)
+{
+	if (index_.count(key))
+		return;
+
+	auto parent_index = root_node;
+	if (parent)
+	{
+		auto it = index_.find(*parent);
+		if (it != index_.cend())
+			parent_index = (*it).second;
+	}
+
+	//Insert the new subtree right before the parent exit tag
+	auto enter_tag = insert_tag_after(tags_[nodes_[parent_index].exit_tag].prev);
+	auto exit_tag = insert_tag_after(enter_tag);
+
+	auto child_index = static_cast<std::uint32_t>(nodes_[parent_index].children.size());
+	node new_node{ key, parent_index, child_index, enter_tag, exit_tag, {}, false };
+	std::uint32_t index;
+	if (free_nodes_.empty())
+	{
+		index = static_cast<std::uint32_t>(nodes_.size());
+		nodes_.push_back(std::move(new_node));
+	}
+	else
+	{
+		index = free_nodes_.back();
+		free_nodes_.pop_back();
+		nodes_[index] = std::move(new_node);
+	}
+
+	nodes_[parent_index].children.push_back(index);
+	index_.emplace(key, index);
+}
+
+void process_tree::mark_exited(const process_key& key)
+{
+	auto it = index_.find(key);
+	if (it == index_.cend())
+		return;
+
+	auto index = (*it).second;
+	nodes_[index].exited = true;
+	if (nodes_[index].children.empty())
+		remove_node(index);
+}
+
+bool process_tree::contains(const process_key& key) const
+{
+	return index_.count(key) != 0;
+}
+
+boost::optional<process_key> process_tree::get_parent(const process_key& key) const
+{
+	auto it = index_.find(key);
+	if (it == index_.cend())
+		return boost::none;
+
+	auto parent_index = nodes_[(*it).second].parent;
+	if (parent_index == root_node)
+		return boost::none;
+
+	return nodes_[parent_index].key;
+}
+
+std::vector<process_key> process_tree::get_children(const process_key& key) const
+{
+	std::vector<process_key> result;
+	auto it = index_.find(key);
+	if (it == index_.cend())
+		return result;
+
+	const auto& children = nodes_[(*it).second].children;
+	result.reserve(children.size());
+	for (auto child : children)
+		result.push_back(nodes_[child].key);
+
+	return result;
+}
+
+bool process_tree::is_descendant(const process_key& descendant, const process_key& ancestor) const
+{
+	auto descendant_it = index_.find(descendant);
+	auto ancestor_it = index_.find(ancestor);
+	if (descendant_it == index_.cend() || ancestor_it == index_.cend())
+		return false;
+
+	const auto& descendant_node = nodes_[(*descendant_it).second];
+	const auto& ancestor_node = nodes_[(*ancestor_it).second];
+	return tags_[ancestor_node.enter_tag].label < tags_[descendant_node.enter_tag].label
+		&& tags_[descendant_node.exit_tag].label < tags_[ancestor_node.exit_tag].label;
+}
+
+std::vector<process_key> process_tree::get_descendants(const process_key& key) const
+{
+	std::vector<process_key> result;
+	for_each_descendant(key, [&result](const process_key& descendant)
+	{
+		result.push_back(descendant);
+	});
+	return result;
+}
+
+std::uint32_t process_tree::insert_tag_after(std::uint32_t position)
+{
+	if (tags_[tags_[position].next].label - tags_[position].label < 2u)
+		relabel(position);
+
+	auto next = tags_[position].next;
+	auto label = tags_[position].label + (tags_[next].label - tags_[position].label) / 2u;
+
+	std::uint32_t index;
+	if (free_tags_.empty())
+	{
+		index = static_cast<std::uint32_t>(tags_.size());
+		tags_.push_back({ label, position, next });
+	}
+	else
+	{
+		index = free_tags_.back();
+		free_tags_.pop_back();
+		tags_[index] = { label, position, next };
+	}
+
+	tags_[position].next = index;
+	tags_[next].prev = index;
+	return index;
+}
+
+void process_tree::remove_tag(std::uint32_t position) noexcept
+{
+	tags_[tags_[position].prev].next = tags_[position].next;
+	tags_[tags_[position].next].prev = tags_[position].prev;
+	free_tags_.push_back(position);
+}
+
+//Makes room for a new tag after the position: widens the range around it
+//until the tags are sparse enough there and spreads them evenly in it
+void process_tree::relabel(std::uint32_t position) noexcept
+{
+	auto first = position;
+	auto last = tags_[position].next;
+	std::uint64_t count = 1;
+	while (first != head_tag || last != tail_tag)
+	{
+		auto slot_count = count + 1u;
+		if ((tags_[last].label - tags_[first].label) / slot_count > slot_count)
+			break;
+
+		if (first != head_tag)
+		{
+			first = tags_[first].prev;
+			++count;
+		}
+
+		if (last != tail_tag)
+		{
+			last = tags_[last].next;
+			++count;
+		}
+	}
+
+	auto base = tags_[first].label;
+	auto gap = (tags_[last].label - base) / (count + 1u);
+	std::uint64_t slot = first == position ? 2u : 1u;
+	for (auto current = tags_[first].next; current != last; current = tags_[current].next)
+	{
+		tags_[current].label = base + gap * slot++;
+		if (current == position)
+			++slot;
+	}
+}
+
+void process_tree::remove_node(std::uint32_t index)
+{
+	while (index != root_node)
+	{
+		auto& current = nodes_[index];
+		auto parent_index = current.parent;
+		auto& siblings = nodes_[parent_index].children;
+		siblings[current.child_index] = siblings.back();
+		nodes_[siblings.back()].child_index = current.child_index;
+		siblings.pop_back();
+
+		remove_tag(current.enter_tag);
+		remove_tag(current.exit_tag);
+		index_.erase(current.key);
+		current.children.clear();
+		free_nodes_.push_back(index);
+
+		if (!nodes_[parent_index].exited || !siblings.empty())
+			break;
+
+		index = parent_index;
+	}
+}
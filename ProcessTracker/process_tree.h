@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "process_key.h"
+
+//Process ancestry index. Every process gets an enter and an exit tag in
+//an Euler tour of the tree, the tags are kept in an order-maintenance list
+//with integer labels, so a process is a descendant of another one exactly
+//when its tags lie between the tags of the other one, which is tested in
+//O(1). Exited processes are kept while they have descendants, so ancestry
+//survives the exit of intermediate processes.
+class process_tree
+{
+public:
+	process_tree();
+
+	//Parent which is not in the tree is ignored, the process becomes a root
+	void add(const process_key& key, const boost::optional<process_key>& parent);
+	void mark_exited(const process_key& key);
+
+	bool contains(const process_key& key) const;
+	std::size_t size() const noexcept
+	{
+		return index_.size();
+	}
+
+	boost::optional<process_key> get_parent(const process_key& key) const;
+	std::vector<process_key> get_children(const process_key& key) const;
+
+	//Strict descendant test, a process is not its own descendant
+	bool is_descendant(const process_key& descendant, const process_key& ancestor) const;
+
+	//Calls handler(const process_key&) for every descendant, depth first
+	template<typename Handler>
+	void for_each_descendant(const process_key& key, Handler&& handler) const
+	{
+		auto it = index_.find(key);
+		if (it == index_.cend())
+			return;
+
+		std::vector<std::uint32_t> pending(nodes_[(*it).second].children);
+		while (!pending.empty())
+		{
+			auto& current = nodes_[pending.back()];
+			pending.pop_back();
+			handler(static_cast<const process_key&>(current.key));
+			pending.insert(pending.end(), current.children.cbegin(), current.children.cend());
+		}
+	}
+
+	std::vector<process_key> get_descendants(const process_key& key) const;
+
+private:
+	struct tag
+	{
+		std::uint64_t label;
+		std::uint32_t prev;
+		std::uint32_t next;
+	};
+
+	struct node
+	{
+		process_key key;
+		std::uint32_t parent;
+		std::uint32_t child_index;
+		std::uint32_t enter_tag;
+		std::uint32_t exit_tag;
+		std::vector<std::uint32_t> children;
+		bool exited;
+	};
+
+private:
+	std::uint32_t insert_tag_after(std::uint32_t position);
+	void remove_tag(std::uint32_t position) noexcept;
+	void relabel(std::uint32_t position) noexcept;
+	void remove_node(std::uint32_t index);
+
+private:
+	std::vector<tag> tags_;
+	std::vector<std::uint32_t> free_tags_;
+	std::vector<node> nodes_;
+	std::vector<std::uint32_t> free_nodes_;
+	std::unordered_map<process_key, std::uint32_t, process_key_hash> index_;
+};
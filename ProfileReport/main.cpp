@@ -0,0 +1,131 @@
+/* Process Tracker (c) DX, kaimi.io */
+
+//Summarizes folded stacks written by builds with EVENT_TRACING_PROFILING:
+//	ProfileReport profile.folded [more.folded...]
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct frame_statistics
+{
+	std::uint64_t self_cycles = 0;
+	std::uint64_t total_cycles = 0;
+};
+
+using frame_map = std::map<std::string, frame_statistics>;
+
+bool read_folded_stacks(const char* file_name, frame_map& frames, std::uint64_t& total_cycles)
+{
+	std::ifstream file(file_name);
+	if (!file)
+		return false;
+
+	std::string line;
+	std::vector<std::string> stack;
+	std::set<std::string> counted;
+	while (std::getline(file, line))
+	{
+		auto separator = line.rfind(' ');
+		if (separator == std::string::npos)
+			continue;
+
+		auto cycles = std::stoull(line.substr(separator + 1u));
+		stack.clear();
+		std::size_t start = 0;
+		while (start <= separator)
+		{
+			auto end = (std::min)(line.find(';', start), separator);
+			stack.push_back(line.substr(start, end - start));
+			start = end + 1u;
+		}
+
+		frames[stack.back()].self_cycles += cycles;
+		//A frame nested in itself is counted once per stack
+		counted.clear();
+		for (const auto& frame : stack)
+		{
+			if (counted.insert(frame).second)
+				frames[frame].total_cycles += cycles;
+		}
+
+		total_cycles += cycles;
+	}
+
+	return true;
+}
+
+void print_frames(const frame_map& frames, std::uint64_t total_cycles,
+	std::uint64_t frame_statistics::*sort_field, const char* title)
+{
+	std::vector<frame_map::const_iterator> sorted;
+	for (auto it = frames.cbegin(); it != frames.cend(); ++it)
+		sorted.push_back(it);
+
+	std::stable_sort(sorted.begin(), sorted.end(), [sort_field](frame_map::const_iterator left,
+		frame_map::const_iterator right)
+	{
+		return (*left).second.*sort_field > (*right).second.*sort_field;
+	});
+
+	std::cout << title << std::endl;
+	std::cout << std::setw(8) << "self %" << std::setw(8) << "total %"
+		<< std::setw(16) << "self cycles" << "  frame" << std::endl;
+	for (auto it : sorted)
+	{
+		const auto& statistics = (*it).second;
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(8) << 100.0 * statistics.self_cycles / total_cycles
+			<< std::setw(8) << 100.0 * statistics.total_cycles / total_cycles
+			<< std::setw(16) << statistics.self_cycles << "  " << (*it).first << std::endl;
+	}
+
+	std::cout << std::endl;
+}
+} //namespace
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: ProfileReport <folded stacks file>..." << std::endl;
+		return -1;
+	}
+
+	frame_map frames;
+	std::uint64_t total_cycles = 0;
+	try
+	{
+		for (int i = 1; i != argc; ++i)
+		{
+			if (!read_folded_stacks(argv[i], frames, total_cycles))
+			{
+				std::cout << "Unable to open " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Error: " << e.what() << std::endl;
+		return -1;
+	}
+
+	if (!total_cycles)
+	{
+		std::cout << "No samples" << std::endl;
+		return 0;
+	}
+
+	print_frames(frames, total_cycles, &frame_statistics::self_cycles, "By self time");
+	print_frames(frames, total_cycles, &frame_statistics::total_cycles, "By total time");
+	return 0;
+}
@@ -0,0 +1,47 @@
+/* Process Tracker (c) DX, kaimi.io */
+
+//Compiles instrumentation manifests into a schema pack, which event_schema_cache
+//uses to decode events of providers not installed on the machine:
+//	SchemaCompiler schemas.pack provider.man [more.man...]
+
+#include <iostream>
+#include <string>
+
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/manifest_compiler.h"
+#include "event_tracing/schema_pack.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: SchemaCompiler <schema pack> <manifest>..." << std::endl;
+		return -1;
+	}
+
+	using namespace event_tracing;
+
+	try
+	{
+		manifest_compiler compiler;
+		for (int i = 2; i != argc; ++i)
+			compiler.add_manifest_file(argv[i]);
+
+		compiler.write_schema_pack(argv[1]);
+
+		schema_pack pack(argv[1]);
+		std::cout << "Events: " << pack.get_event_count() << ", maps: " << pack.get_map_count() << std::endl;
+	}
+	catch (const event_trace_error& e)
+	{
+		std::cout << "Error: " << e.what() << std::endl;
+		return -1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Error: " << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
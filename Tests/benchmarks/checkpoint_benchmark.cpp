@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "checkpoint_file.h"
+#include "process_checkpoint.h"
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+double get_milliseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(benchmark_clock::now() - start).count();
+}
+} //namespace
+
+//Checkpoint of 100k processes with 6 threads and 12 modules each, the cost
+//of keeping the saver state from journal records, and of journalling an
+//event and requesting a checkpoint on the event thread
+int main()
+{
+	std::map<std::uint32_t, process> processes;
+	process_tree tree;
+	std::vector<std::wstring> names;
+	for (int i = 0; i != 300; ++i)
+		names.push_back(L"\\Device\\HarddiskVolume3\\Windows\\System32\\module_" + std::to_wstring(i) + L".dll");
+
+	for (std::uint32_t pid = 4; pid != 4 + 100000 * 4; pid += 4)
+	{
+		process value(L"\\Device\\HarddiskVolume3\\Program Files\\App\\app_" + std::to_wstring(pid % 500) + L".exe",
+			pid, pid * 10, pid > 4 ? pid - 4 : 0, 1);
+		for (std::uint32_t tid = 0; tid != 6; ++tid)
+			value.add_thread(process_thread(pid, pid * 100 + tid, 0x7ff000 + tid, 0x1000 * tid, 0x2000 * tid));
+		for (std::uint32_t module = 0; module != 12; ++module)
+			value.add_module(process_module(pid, 0x7ff00000 + module * 0x10000, names[(pid + module * 7) % names.size()]));
+
+		boost::optional<process_key> parent;
+		if (pid > 4)
+			parent = process_key{ pid - 4, static_cast<std::int64_t>(pid - 4) * 10 };
+
+		tree.add(value.get_key(), parent);
+		processes.emplace(pid, std::move(value));
+	}
+
+	auto start = benchmark_clock::now();
+	auto data = save_checkpoint(7, processes, tree);
+	std::printf("encode: %.0f ms, %.1f MB\n", get_milliseconds(start), data.size() / 1048576.0);
+
+	start = benchmark_clock::now();
+	std::uint64_t generation = 0;
+	auto restored = load_checkpoint(data.data(), data.size(), generation);
+	std::printf("load: %.0f ms, %zu processes\n", get_milliseconds(start), restored.size());
+
+	checkpoint_state state;
+	state.reset(std::move(restored));
+	start = benchmark_clock::now();
+	data = state.save(8);
+	std::printf("encode from journal state (saver thread): %.0f ms\n", get_milliseconds(start));
+
+	constexpr const int event_count = 200000;
+	const std::wstring file_name = L"checkpoint_benchmark.checkpoint";
+	{
+		journal_file journal;
+		journal.open(file_name + L".journal", 1);
+		start = benchmark_clock::now();
+		for (int i = 0; i != event_count; ++i)
+		{
+			checkpoint_writer records;
+			write_thread_stopped(records, i, i + 1);
+			journal.append(records);
+		}
+
+		std::printf("journal write per event: %.0f ns\n", get_milliseconds(start) * 1e6 / event_count);
+	}
+
+	{
+		checkpoint_writer records;
+		for (int i = 0; i != event_count; ++i)
+		{
+			auto pid = 4 + 4 * static_cast<std::uint32_t>(i % 100000);
+			write_thread_started(records, process_thread(pid, 1000000000u + i, 0x7ff000, 0x1000, 0x2000));
+			write_thread_stopped(records, pid, 1000000000u + i);
+		}
+
+		start = benchmark_clock::now();
+		state.apply(records.get_data().data(), records.get_data().size());
+		std::printf("journal state per event (saver thread): %.0f ns\n", get_milliseconds(start) * 1e6 / (2 * event_count));
+	}
+
+	{
+		checkpoint_saver saver(file_name, std::chrono::seconds(1), [](const checkpoint_error& error)
+		{
+			std::printf("error: %s\n", error.what());
+		});
+
+		saver.reset(1, {});
+		start = benchmark_clock::now();
+		for (int i = 0; i != event_count; ++i)
+		{
+			checkpoint_writer records;
+			write_thread_stopped(records, i, i + 1);
+			saver.append(records);
+		}
+
+		std::printf("buffered journal per event: %.0f ns\n", get_milliseconds(start) * 1e6 / event_count);
+
+		//What the event thread pays for a checkpoint while the saver thread is idle
+		constexpr const int checkpoint_count = 5;
+		double total = 0;
+		for (int i = 0; i != checkpoint_count; ++i)
+		{
+			saver.flush();
+			start = benchmark_clock::now();
+			saver.save(2 + i);
+			total += get_milliseconds(start);
+		}
+
+		std::printf("checkpoint request (event thread): %.3f ms\n", total / checkpoint_count);
+	}
+
+	std::remove("checkpoint_benchmark.checkpoint");
+	std::remove("checkpoint_benchmark.checkpoint.journal");
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "event_tracing/clock_domain.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr const std::size_t timestamp_count = 1000000;
+
+double get_nanoseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count() / timestamp_count;
+}
+
+void to_utc(std::time_t time, std::tm& result)
+{
+#ifdef _WIN32
+	::gmtime_s(&result, &time);
+#else
+	::gmtime_r(&time, &result);
+#endif
+}
+
+std::time_t from_utc(std::tm& time)
+{
+#ifdef _WIN32
+	return ::_mkgmtime64(&time);
+#else
+	return ::timegm(&time);
+#endif
+}
+
+//The former FILETIME property path: FileTimeToSystemTime, a std::tm of its
+//fields, _mkgmtime64 to a system_clock time point, then std::put_time
+std::size_t format_previous(std::uint64_t filetime)
+{
+	std::tm system_time{};
+	to_utc(static_cast<std::time_t>((filetime - unix_epoch_filetime) / 10000000u), system_time);
+	std::tm tm_value{};
+	tm_value.tm_year = system_time.tm_year;
+	tm_value.tm_mon = system_time.tm_mon;
+	tm_value.tm_mday = system_time.tm_mday;
+	tm_value.tm_hour = system_time.tm_hour;
+	tm_value.tm_min = system_time.tm_min;
+	tm_value.tm_sec = system_time.tm_sec;
+	auto time_point = std::chrono::system_clock::from_time_t(from_utc(tm_value));
+
+	auto value = std::chrono::system_clock::to_time_t(time_point);
+	std::tm printed{};
+	to_utc(value, printed);
+	std::wostringstream stream;
+	stream << std::put_time(&printed, L"%F %T UTC");
+	return stream.str().size();
+}
+} //namespace
+
+//FILETIME timestamps of 2020-2023 converted and printed through the former
+//std::tm path and with clock_domain, and raw counter ticks converted with
+//a frequency dividing a second and with one which does not
+int main()
+{
+	std::mt19937_64 random(1);
+	std::vector<std::uint64_t> filetimes(timestamp_count);
+	for (auto& filetime : filetimes)
+		filetime = unix_epoch_filetime + 10000000ull * (1580000000ull + random() % 100000000ull) + random() % 10000000ull;
+
+	std::size_t checksum = 0;
+	auto start = benchmark_clock::now();
+	for (auto filetime : filetimes)
+		checksum += format_previous(filetime);
+	std::printf("std::tm path: %.1f ns/timestamp, whole seconds\n", get_nanoseconds(start));
+
+	std::wstring text;
+	start = benchmark_clock::now();
+	for (auto filetime : filetimes)
+	{
+		text.clear();
+		append_iso8601(*filetime_to_unix_nanoseconds(filetime), 7, text);
+		checksum += text.size();
+	}
+
+	std::printf("clock_domain: %.1f ns/timestamp, 100 ns precision\n", get_nanoseconds(start));
+
+	for (std::int64_t frequency : { 10000000ll, 3579545ll })
+	{
+		auto clock = clock_domain::query_performance_counter(frequency, 123456789,
+			unix_epoch_filetime + 16000000000000000ll);
+		start = benchmark_clock::now();
+		for (auto filetime : filetimes)
+			checksum += static_cast<std::size_t>(clock.to_unix_nanoseconds(static_cast<std::int64_t>(filetime >> 8)));
+		std::printf("%lld Hz ticks: %.2f ns/timestamp\n", static_cast<long long>(frequency), get_nanoseconds(start));
+	}
+
+	std::printf("checksum %zu\n", checksum);
+}
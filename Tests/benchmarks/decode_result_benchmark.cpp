@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <tdh.h>
+
+#include "event_tracing/event_property.h"
+#include "event_tracing/event_trace_error.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+double get_milliseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(benchmark_clock::now() - start).count();
+}
+} //namespace
+
+//1M uint32 conversions of which 10% have a mismatched type, with exceptions
+//and with decode_result
+int main()
+{
+	std::vector<event_property> properties;
+	for (int i = 0; i != 1000000; ++i)
+	{
+		std::vector<std::uint8_t> raw(4, static_cast<std::uint8_t>(i));
+		properties.emplace_back(i % 10 ? TDH_INTYPE_UINT32 : TDH_INTYPE_UNICODESTRING, 0, true,
+			std::move(raw), std::wstring(L"ProcessID"));
+	}
+
+	std::uint64_t throwing_sum = 0;
+	std::size_t throwing_errors = 0;
+	auto start = benchmark_clock::now();
+	for (const auto& prop : properties)
+	{
+		try
+		{
+			throwing_sum += event_property_converter<std::uint32_t>::convert(prop);
+		}
+		catch (const event_trace_error&)
+		{
+			++throwing_errors;
+		}
+	}
+
+	std::printf("throwing convert: %.1f ms, %zu errors\n", get_milliseconds(start), throwing_errors);
+
+	std::uint64_t result_sum = 0;
+	std::size_t result_errors = 0;
+	start = benchmark_clock::now();
+	for (const auto& prop : properties)
+	{
+		auto value = event_property_converter<std::uint32_t>::try_convert(prop);
+		if (value)
+			result_sum += *value;
+		else
+			++result_errors;
+	}
+
+	std::printf("try_convert: %.1f ms, %zu errors, same sum %d\n", get_milliseconds(start),
+		result_errors, throwing_sum == result_sum ? 1 : 0);
+}
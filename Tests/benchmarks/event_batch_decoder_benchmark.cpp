@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#include "event_tracing/event_batch_decoder.h"
+#include "event_tracing/event_visitor.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+double get_nanoseconds(benchmark_clock::time_point start, std::size_t count)
+{
+	return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count() / count;
+}
+
+class sum_visitor : public event_visitor
+{
+public:
+	void value(const event_property_view& prop) override
+	{
+		if (prop.get_in_type() != TDH_INTYPE_UNICODESTRING && std::wcscmp(prop.get_name(), L"Tid"))
+			sum += event_property_converter<std::uint64_t>::try_convert(prop).value_or(0u);
+	}
+
+	std::uint64_t sum = 0;
+};
+} //namespace
+
+//1M events { Pid, Tid, Timestamp, Flags, Name, Size } decoded in batches of 4096
+int main()
+{
+	auto schema = make_schema({ make_property(L"Pid", TDH_INTYPE_UINT32), make_property(L"Tid", TDH_INTYPE_UINT32),
+		make_property(L"Timestamp", TDH_INTYPE_UINT64), make_property(L"Flags", TDH_INTYPE_UINT16),
+		make_property(L"Name", TDH_INTYPE_UNICODESTRING), make_property(L"Size", TDH_INTYPE_UINT64) }, 6);
+
+	const std::size_t count = 1000000;
+	std::vector<std::vector<std::uint8_t>> payloads;
+	std::vector<EVENT_RECORD> records;
+	std::vector<const EVENT_RECORD*> pointers;
+	payloads.reserve(count);
+	records.reserve(count);
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		payload_builder payload;
+		payload.add(static_cast<std::uint32_t>(4 + i % 1000)).add(static_cast<std::uint32_t>(8 + i))
+			.add<std::uint64_t>(132000000000000000ull + i).add(static_cast<std::uint16_t>(i & 0xff))
+			.add_string(L"process_" + std::to_wstring(i % 37)).add<std::uint64_t>(i * 4096);
+		payloads.push_back(std::move(payload.get_data()));
+		records.push_back(make_record(payloads.back(), 1));
+		pointers.push_back(&records.back());
+	}
+
+	const std::size_t batch_size = 4096;
+	std::vector<std::uint32_t> pids;
+	std::vector<std::uint64_t> timestamps, sizes;
+	std::vector<std::uint16_t> flags;
+	std::vector<std::uint8_t> valid;
+	for (bool variable : { false, true })
+	{
+		std::vector<std::wstring> fields{ L"Pid", L"Timestamp", L"Flags" };
+		if (variable)
+			fields.push_back(L"Size");
+
+		std::uint64_t sum = 0;
+		event_batch_decoder decoder(schema, fields);
+		auto start = benchmark_clock::now();
+		for (std::size_t first = 0; first < count; first += batch_size)
+		{
+			auto size = (std::min)(batch_size, count - first);
+			decoder.load(pointers.data() + first, size);
+			decoder.decode<std::uint32_t>(0, pids, valid);
+			decoder.decode<std::uint64_t>(1, timestamps, valid);
+			decoder.decode<std::uint16_t>(2, flags, valid);
+			if (variable)
+				decoder.decode<std::uint64_t>(3, sizes, valid);
+
+			for (std::size_t i = 0; i != size; ++i)
+				sum += pids[i] + timestamps[i] + flags[i] + (variable ? sizes[i] : 0u);
+		}
+
+		std::printf("batch, 3 fixed%s: %.0f ns/event (checksum %llu)\n", variable ? " + 1 variable" : "",
+			get_nanoseconds(start, count), static_cast<unsigned long long>(sum));
+	}
+
+	sum_visitor visitor;
+	auto start = benchmark_clock::now();
+	for (const auto& record : records)
+		visit_event(*schema, record, visitor);
+
+	std::printf("visit_event per record: %.0f ns/event (checksum %llu)\n", get_nanoseconds(start, count),
+		static_cast<unsigned long long>(visitor.sum));
+}
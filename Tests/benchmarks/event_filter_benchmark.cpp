@@ -0,0 +1,51 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_filter.h"
+
+using namespace event_tracing;
+
+//Filter throughput on synthetic headers, batched and one event at a time
+int main()
+{
+	std::vector<EVENT_RECORD> records(1000000);
+	std::vector<PEVENT_RECORD> pointers;
+	for (std::size_t i = 0; i != records.size(); ++i)
+	{
+		auto& record = records[i];
+		record.EventHeader.ProcessId = static_cast<ULONG>(i % 5000);
+		record.EventHeader.ThreadId = static_cast<ULONG>(i);
+		record.EventHeader.EventDescriptor.Level = static_cast<UCHAR>(i % 6);
+		record.EventHeader.EventDescriptor.Keyword = 1ull << (i % 8);
+		record.EventHeader.EventDescriptor.Id = static_cast<USHORT>(i % 7);
+		record.EventHeader.ProviderId.Data1 = static_cast<unsigned long>(i % 2);
+		pointers.push_back(&record);
+	}
+
+	for (auto expression : { L"pid in (4, 1234) and level <= 4", L"not (keyword has 0x10) && id == 3",
+		L"pid == 4 or $ImageName ends_with \".exe\"",
+		L"provider == {00000001-0000-0000-0000-000000000000} and !(pid < 100)",
+		L"level >= 2 and $ExitCode == -1" })
+	{
+		event_filter filter(expression);
+		std::unique_ptr<bool[]> results(new bool[pointers.size()]);
+		auto start = std::chrono::steady_clock::now();
+		filter.matches(pointers.data(), pointers.size(), results.get());
+		std::chrono::duration<double> batch_time = std::chrono::steady_clock::now() - start;
+
+		std::size_t match_count = 0;
+		start = std::chrono::steady_clock::now();
+		for (auto record : pointers)
+			match_count += filter.matches(record);
+
+		std::chrono::duration<double> single_time = std::chrono::steady_clock::now() - start;
+		std::printf("%ls: %zu matches, batch %.1f M events/s, single %.1f M events/s\n", expression, match_count,
+			pointers.size() / batch_time.count() / 1e6, pointers.size() / single_time.count() / 1e6);
+	}
+}
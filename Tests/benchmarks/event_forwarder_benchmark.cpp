@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/event_collector.h"
+#include "event_tracing/event_forwarder.h"
+
+#include "test_events.h"
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+
+namespace
+{
+void make_record(std::uint32_t index, EVENT_RECORD& record, std::uint8_t* user_data)
+{
+	record = EVENT_RECORD{};
+	record.EventHeader.ProcessId = index;
+	record.EventHeader.TimeStamp.QuadPart = 1000 + index;
+	record.EventHeader.EventDescriptor.Id = static_cast<USHORT>(index % 7);
+	record.EventHeader.ProviderId.Data1 = 0x1234;
+	record.UserDataLength = static_cast<USHORT>(index % 120);
+	for (USHORT i = 0; i != record.UserDataLength; ++i)
+		user_data[i] = static_cast<std::uint8_t>((index >> (i % 3)) + i);
+
+	record.UserData = user_data;
+}
+} //namespace
+
+//1M records of 7 event kinds forwarded to a collector over loopback
+int main()
+{
+#ifdef WINDOWS_STUBS
+	windows_stubs::set_event_information(test_events::make_schema_data({
+		test_events::make_property(L"Count", TDH_INTYPE_UINT32),
+		test_events::make_property(L"Name", TDH_INTYPE_UNICODESTRING) }, 2));
+#endif
+
+	const std::uint32_t record_count = 1000000;
+	std::uint64_t with_schema = 0;
+	event_collector collector("127.0.0.1", 0,
+		[&with_schema](const std::string&, PEVENT_RECORD record, event_schema_cache& schemas)
+	{
+		with_schema += static_cast<bool>(schemas.get(record));
+	});
+
+	collector.run_async();
+	//The producer is faster than the connection, batches beyond the memory limit are spilled
+	event_forwarder_options options;
+	options.spill_file_name = "event_forwarder_benchmark.spill";
+	event_forwarder forwarder("host", "127.0.0.1", collector.get_port(), options);
+	forwarder.run_async();
+
+	std::uint8_t user_data[256];
+	auto start = std::chrono::steady_clock::now();
+	for (std::uint32_t index = 0; index != record_count; ++index)
+	{
+		EVENT_RECORD record;
+		make_record(index, record, user_data);
+		forwarder.forward(&record);
+	}
+
+	auto forwarded = std::chrono::steady_clock::now();
+	forwarder.stop(std::chrono::seconds(60));
+	auto acknowledged = std::chrono::steady_clock::now();
+	collector.stop();
+	std::remove(options.spill_file_name.c_str());
+
+	std::printf("forward: %.0f records/s, end to end: %.0f records/s\n",
+		record_count / std::chrono::duration<double>(forwarded - start).count(),
+		record_count / std::chrono::duration<double>(acknowledged - start).count());
+	std::printf("%llu received, %llu with schemas, %llu acknowledged, %llu dropped\n",
+		static_cast<unsigned long long>(collector.get_received_count()),
+		static_cast<unsigned long long>(with_schema),
+		static_cast<unsigned long long>(forwarder.get_acknowledged_count()),
+		static_cast<unsigned long long>(forwarder.get_dropped_count()));
+}
@@ -0,0 +1,38 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_info.h"
+
+using namespace event_tracing;
+
+//Handlers which read header fields only, the schema is never loaded
+int main()
+{
+	std::vector<EVENT_RECORD> records(1000000);
+	for (std::size_t i = 0; i != records.size(); ++i)
+	{
+		records[i].EventHeader.ProcessId = static_cast<ULONG>(i % 977);
+		records[i].EventHeader.ThreadId = static_cast<ULONG>(i);
+		records[i].EventHeader.TimeStamp.QuadPart = static_cast<LONGLONG>(i * 10);
+	}
+
+	std::uint64_t sum = 0;
+	std::size_t loaded = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto& record : records)
+	{
+		event_info info(&record);
+		sum += info.get_process_id() + info.get_thread_id() + info.get_timestamp() + info.get_event_id();
+		if (info.is_schema_loaded())
+			++loaded;
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	std::printf("1M header-only handlers: %.1f ms, %zu schemas loaded (checksum %llu)\n",
+		elapsed.count(), loaded, static_cast<unsigned long long>(sum));
+}
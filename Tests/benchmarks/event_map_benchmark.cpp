@@ -0,0 +1,58 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "event_tracing/event_map.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr const std::uint32_t lookup_count = 10000000;
+
+double get_nanoseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count() / lookup_count;
+}
+} //namespace
+
+//Lookups in 200-entry value maps with a dense and a sparse value range,
+//and formatting of a 3-bit bitmap
+int main()
+{
+	std::vector<event_value_map::entry> entries;
+	for (std::uint32_t i = 0; i != 200; ++i)
+		entries.emplace_back(i * 3, L"value_" + std::to_wstring(i));
+
+	event_value_map dense(entries, false);
+	for (auto& value : entries)
+		value.first *= 100000;
+	event_value_map sparse(entries, false);
+	event_value_map bitmap({ { 1, L"Read" }, { 2, L"Write" }, { 4, L"Execute" } }, true);
+
+	std::size_t hits = 0;
+	auto start = benchmark_clock::now();
+	for (std::uint32_t i = 0; i != lookup_count; ++i)
+		hits += dense.find(i % 600) != nullptr;
+	std::printf("dense: %.1f ns/lookup\n", get_nanoseconds(start));
+
+	start = benchmark_clock::now();
+	for (std::uint32_t i = 0; i != lookup_count; ++i)
+		hits += sparse.find((i % 200) * 300000) != nullptr;
+	std::printf("sorted: %.1f ns/lookup\n", get_nanoseconds(start));
+
+	std::wstring text;
+	start = benchmark_clock::now();
+	for (std::uint32_t i = 0; i != lookup_count; ++i)
+	{
+		text.clear();
+		bitmap.format(i & 7, text);
+		hits += text.size();
+	}
+
+	std::printf("bitmap format: %.1f ns/value (checksum %zu)\n", get_nanoseconds(start), hits);
+}
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "event_tracing/event_message.h"
+#include "event_tracing/event_visitor.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+const wchar_t* const message = L"Process %1 started at time %2 by parent %3 running in session %4 with name %6. ";
+
+double get_nanoseconds(benchmark_clock::time_point start, std::size_t count)
+{
+	return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count() / count;
+}
+
+//Parses the template and formats every property on each event
+void render_naive(const event_schema& schema, const EVENT_RECORD& record, std::wstring& result)
+{
+	class value_collector : public event_visitor
+	{
+	public:
+		void value(const event_property_view& prop) override
+		{
+			values.emplace_back();
+			prop.try_append_value(values.back());
+		}
+
+		std::vector<std::wstring> values;
+	} collector;
+
+	visit_event(schema, record, collector);
+	for (auto position = message; *position; ++position)
+	{
+		if (*position == L'%' && position[1] >= L'1' && position[1] <= L'9')
+		{
+			std::size_t argument = *++position - L'1';
+			if (argument < collector.values.size())
+				result += collector.values[argument];
+		}
+		else
+		{
+			result += *position;
+		}
+	}
+}
+} //namespace
+
+//200k ProcessStart-like events with 7 properties and 5 inserts
+int main()
+{
+	auto schema = make_schema({ make_property(L"ProcessID", TDH_INTYPE_UINT32),
+		make_property(L"CreateTime", TDH_INTYPE_UINT64), make_property(L"ParentProcessID", TDH_INTYPE_UINT32),
+		make_property(L"SessionID", TDH_INTYPE_UINT32), make_property(L"Flags", TDH_INTYPE_UINT32),
+		make_property(L"ImageName", TDH_INTYPE_UNICODESTRING), make_property(L"ImageCheckSum", TDH_INTYPE_UINT32) },
+		7, message);
+
+	const std::size_t count = 200000;
+	std::vector<std::vector<std::uint8_t>> payloads;
+	std::vector<EVENT_RECORD> records;
+	payloads.reserve(count);
+	for (std::size_t i = 0; i != count; ++i)
+	{
+		payload_builder payload;
+		payload.add(static_cast<std::uint32_t>(4 + i % 1000)).add<std::uint64_t>(132000000000000000ull + i)
+			.add(static_cast<std::uint32_t>(4 + i % 17)).add<std::uint32_t>(1).add<std::uint32_t>(0)
+			.add_string(L"\\Device\\HarddiskVolume3\\Windows\\System32\\process_" + std::to_wstring(i % 37) + L".exe")
+			.add<std::uint32_t>(0x1234);
+		payloads.push_back(std::move(payload.get_data()));
+		records.push_back(make_record(payloads.back(), 1));
+	}
+
+	event_message_renderer renderer;
+	std::wstring compiled, naive;
+	renderer.render(*schema, records[5], compiled);
+	render_naive(*schema, records[5], naive);
+	std::printf("same output as naive: %d\n", compiled == naive ? 1 : 0);
+
+	std::size_t total = 0;
+	auto start = benchmark_clock::now();
+	for (const auto& record : records)
+	{
+		compiled.clear();
+		renderer.render(*schema, record, compiled);
+		total += compiled.size();
+	}
+
+	std::printf("compiled template: %.0f ns/event\n", get_nanoseconds(start, count));
+
+	start = benchmark_clock::now();
+	for (const auto& record : records)
+	{
+		naive.clear();
+		render_naive(*schema, record, naive);
+		total += naive.size();
+	}
+
+	std::printf("template parsed per event: %.0f ns/event (checksum %zu)\n", get_nanoseconds(start, count), total);
+}
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_visitor.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+double get_microseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(benchmark_clock::now() - start).count();
+}
+
+class counting_visitor : public event_visitor
+{
+public:
+	void value(const event_property_view& prop) override
+	{
+		size += prop.get_size();
+	}
+
+	std::size_t size = 0;
+};
+} //namespace
+
+//Events with a struct array of N items { UINT64, string, UINT16[3] },
+//walked with visit_event and printed
+int main()
+{
+	auto schema = make_schema({ make_property(L"Count", TDH_INTYPE_UINT32), make_struct_array(L"Items", 2, 3, 0),
+		make_property(L"Id", TDH_INTYPE_UINT64), make_property(L"Name", TDH_INTYPE_UNICODESTRING),
+		make_array(L"Flags", TDH_INTYPE_UINT16, 3, true) }, 2);
+
+	for (std::uint32_t count : { 10u, 100u, 400u })
+	{
+		payload_builder payload;
+		payload.add(count);
+		for (std::uint32_t i = 0; i != count; ++i)
+		{
+			payload.add<std::uint64_t>(i).add_string(L"item_" + std::to_wstring(i))
+				.add<std::uint16_t>(1).add<std::uint16_t>(2).add<std::uint16_t>(3);
+		}
+
+		auto record = make_record(payload.get_data(), 1);
+		event_schema_cache cache;
+		cache.add(record.EventHeader.ProviderId, record.EventHeader.EventDescriptor, schema);
+
+		const int iterations = 200;
+		counting_visitor visitor;
+		auto start = benchmark_clock::now();
+		for (int i = 0; i != iterations; ++i)
+			visit_event(*schema, record, visitor);
+		auto visit_time = get_microseconds(start) / iterations;
+
+		start = benchmark_clock::now();
+		std::size_t printed = 0;
+		for (int i = 0; i != iterations; ++i)
+		{
+			std::wostringstream stream;
+			stream << event_info(&record, cache);
+			printed += stream.str().size();
+		}
+
+		std::printf("N=%u: visit %.1f us, print %.1f us (%zu characters)\n", count, visit_time,
+			get_microseconds(start) / iterations, printed / iterations);
+	}
+}
@@ -0,0 +1,73 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "event_tracing/metrics_registry.h"
+
+using namespace event_tracing;
+
+namespace
+{
+//Runs the update on each thread and returns the wall time per update of one thread
+template<typename Update>
+double run(std::size_t thread_count, std::size_t updates_per_thread, Update update)
+{
+	std::atomic<std::size_t> ready{ 0 };
+	std::atomic<bool> started{ false };
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i != thread_count; ++i)
+	{
+		threads.emplace_back([&]
+		{
+			++ready;
+			while (!started)
+			{
+			}
+
+			for (std::size_t update_index = 0; update_index != updates_per_thread; ++update_index)
+				update(update_index);
+		});
+	}
+
+	while (ready != thread_count)
+	{
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	started = true;
+	for (auto& thread : threads)
+		thread.join();
+
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+		/ updates_per_thread;
+}
+} //namespace
+
+//Cost of sharded counter and histogram updates against a single shared atomic
+int main()
+{
+	metrics_registry registry;
+	auto& counter = registry.add_counter("benchmark_events_total", "Benchmark events");
+	auto& histogram = registry.add_histogram("benchmark_latency_us", "Benchmark latency",
+		{ 10, 100, 1000, 10000 });
+	std::atomic<std::uint64_t> shared{ 0 };
+	const std::size_t update_count = 20000000;
+
+	std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+	for (std::size_t thread_count : { 1, 4, 16 })
+	{
+		auto per_thread = update_count / thread_count;
+		auto shared_time = run(thread_count, per_thread,
+			[&shared](std::size_t) { shared.fetch_add(1, std::memory_order_relaxed); });
+		auto counter_time = run(thread_count, per_thread, [&counter](std::size_t) { counter.increment(); });
+		auto histogram_time = run(thread_count, per_thread,
+			[&histogram](std::size_t value) { histogram.observe(value & 2047); });
+		std::printf("%2zu threads: shared atomic %.2f ns, sharded counter %.2f ns, sharded histogram %.2f ns\n",
+			thread_count, shared_time, counter_time, histogram_time);
+	}
+
+	std::printf("counts %s\n", counter.get_value() == shared.load() ? "exact" : "wrong");
+}
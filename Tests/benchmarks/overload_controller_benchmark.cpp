@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+
+#include "event_tracing/overload_controller.h"
+
+using namespace event_tracing;
+
+namespace
+{
+struct simulation_result
+{
+	double shed_share;
+	std::size_t max_depth;
+	double max_lag_ms;
+	//Largest relative error of per-process counts estimated from scaled samples
+	double estimate_error;
+	bool exact_counts;
+};
+
+//Discrete simulation in 1 us ticks of 2 s: events arrive following the load curve
+//and the handler takes 1 us per event. 1 in 1000 events is a lifecycle event,
+//which is never shed; the rest are image loads of 97 processes.
+simulation_result simulate(double (*load)(double), bool controlled)
+{
+	overload_controller controller{ overload_policy() };
+	auto image_loads = controller.add_class();
+	std::deque<double> queue;
+	double handler_budget = 0, arrivals = 0, max_lag = 0;
+	std::uint64_t events = 0, image_load_count = 0, admitted_count = 0;
+	std::size_t max_depth = 0;
+	std::map<int, std::uint64_t> actual;
+	std::map<int, double> estimated;
+	for (double time = 0; time < 2000000; time += 1)
+	{
+		for (arrivals += load(time / 1e6); arrivals >= 1; arrivals -= 1)
+		{
+			bool lifecycle = ++events % 1000 == 0;
+			auto admitted = true;
+			double weight = 1;
+			if (controlled)
+			{
+				auto lag = queue.empty() ? 0 : time - queue.front();
+				controller.observe(queue.size(), std::chrono::nanoseconds(static_cast<long long>(lag * 1000)));
+				if (!lifecycle)
+				{
+					weight = static_cast<double>(controller.get_sampling_rate());
+					admitted = controller.admit(image_loads);
+				}
+			}
+
+			if (!lifecycle)
+			{
+				auto process = static_cast<int>(events * 2654435761u % 97);
+				++image_load_count;
+				++actual[process];
+				if (admitted)
+				{
+					++admitted_count;
+					estimated[process] += weight;
+				}
+			}
+
+			if (admitted)
+				queue.push_back(time);
+		}
+
+		for (handler_budget += 1; handler_budget >= 1 && !queue.empty(); handler_budget -= 1)
+		{
+			max_lag = (std::max)(max_lag, time - queue.front());
+			queue.pop_front();
+		}
+
+		if (queue.empty())
+			handler_budget = (std::min)(handler_budget, 1.0);
+
+		max_depth = (std::max)(max_depth, queue.size());
+	}
+
+	double error = 0;
+	for (const auto& count : actual)
+		error = (std::max)(error, std::fabs(estimated[count.first] - count.second) / count.second);
+
+	const auto& counters = controller.get_counters(image_loads);
+	auto exact = !controlled || (counters.seen == image_load_count && counters.admitted == admitted_count);
+	return { 1.0 - static_cast<double>(admitted_count) / image_load_count, max_depth, max_lag / 1000, error, exact };
+}
+
+double steady(double)
+{
+	return 0.3;
+}
+
+double storm(double seconds)
+{
+	return seconds > 0.5 && seconds < 1.0 ? 3.0 : 0.3;
+}
+
+double ramp(double seconds)
+{
+	return 0.1 + 2.0 * seconds;
+}
+
+double spikes(double seconds)
+{
+	return std::fmod(seconds, 0.2) < 0.02 ? 8.0 : 0.2;
+}
+} //namespace
+
+//Work saved and accuracy of the default policy under simulated load curves
+int main()
+{
+	struct
+	{
+		const char* name;
+		double (*load)(double);
+	} curves[] = { { "steady 0.3/us", steady }, { "storm 3/us for 0.5 s", storm },
+		{ "ramp 0.1..4.1/us", ramp }, { "spikes 8/us 10%", spikes } };
+
+	std::printf("%-22s %-8s %7s %10s %10s %9s %s\n", "curve", "mode", "shed", "max depth", "max lag",
+		"estimate", "counts");
+	for (const auto& curve : curves)
+	{
+		for (auto controlled : { false, true })
+		{
+			auto result = simulate(curve.load, controlled);
+			std::printf("%-22s %-8s %6.1f%% %10zu %8.1fms %8.1f%% %s\n", curve.name,
+				controlled ? "sampled" : "off", result.shed_share * 100, result.max_depth, result.max_lag_ms,
+				result.estimate_error * 100, result.exact_counts ? "exact" : "wrong");
+		}
+	}
+}
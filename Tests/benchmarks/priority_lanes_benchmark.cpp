@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "event_tracing/priority_lanes.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+struct burst_event
+{
+	std::size_t lane;
+	std::uint32_t process_id;
+	std::uint64_t sequence;
+	benchmark_clock::time_point pushed;
+};
+
+void spin(std::chrono::nanoseconds duration)
+{
+	auto end = benchmark_clock::now() + duration;
+	while (benchmark_clock::now() < end)
+	{
+	}
+}
+
+//A dispatcher thread handles events while the producer queues a burst of image loads
+//from 50 processes, produced faster than handled, with a process start every 500 events,
+//thread events every 50 and a stop of a loading process every 2000
+void run(std::size_t lane_count, std::size_t lane_capacity, std::size_t max_bypass_count, const char* title)
+{
+	priority_lanes<burst_event> lanes(lane_count, lane_capacity, max_bypass_count);
+	std::mutex lock;
+	std::condition_variable changed;
+	bool stopped = false;
+	std::vector<std::vector<double>> latencies(3);
+	std::map<std::uint32_t, std::uint64_t> last_sequences;
+	std::size_t order_errors = 0;
+	std::thread dispatcher([&]
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		while (true)
+		{
+			changed.wait(guard, [&] { return !lanes.empty() || stopped; });
+			if (lanes.empty())
+				break;
+
+			auto slot = lanes.pop();
+			guard.unlock();
+			changed.notify_all();
+			const auto& event = lanes.get(slot);
+			latencies[event.lane].push_back(
+				std::chrono::duration<double, std::milli>(benchmark_clock::now() - event.pushed).count());
+			auto& last = last_sequences[event.process_id];
+			order_errors += event.sequence < last;
+			last = event.sequence;
+			spin(std::chrono::microseconds(event.lane == 2 ? 2 : 5));
+			guard.lock();
+			lanes.release(slot);
+		}
+	});
+
+	std::uint64_t sequence = 1;
+	for (int i = 0; i != 200000; ++i)
+	{
+		std::size_t lane = 2;
+		std::uint32_t process_id = 100 + i % 50;
+		if (i % 500 == 0)
+		{
+			lane = 0;
+			process_id = 4;
+		}
+		else if (i % 2000 == 1)
+		{
+			lane = 0;
+		}
+		else if (i % 50 == 0)
+		{
+			lane = 1;
+		}
+
+		auto target = lane_count == 1 ? 0 : lane;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			changed.wait(guard, [&] { return !lanes.full(target); });
+			lanes.get(lanes.push(target, process_id)) = { lane, process_id, sequence++, benchmark_clock::now() };
+		}
+
+		changed.notify_all();
+		spin(std::chrono::microseconds(1));
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopped = true;
+	}
+
+	changed.notify_all();
+	dispatcher.join();
+
+	std::printf("%s: %llu aged, %llu key-ordered, %zu order errors\n", title,
+		static_cast<unsigned long long>(lanes.get_aged_count()),
+		static_cast<unsigned long long>(lanes.get_key_ordered_count()), order_errors);
+	const char* names[] = { "high", "normal", "bulk" };
+	for (std::size_t lane = 0; lane != latencies.size(); ++lane)
+	{
+		auto& values = latencies[lane];
+		std::sort(values.begin(), values.end());
+		auto percentile = [&values](double fraction)
+		{
+			return values[(std::min)(values.size() - 1, static_cast<std::size_t>(fraction * values.size()))];
+		};
+
+		std::printf("  %-6s %6zu events: p50 %7.2f ms, p99 %7.2f ms, p99.9 %7.2f ms, max %7.2f ms\n",
+			names[lane], values.size(), percentile(0.5), percentile(0.99), percentile(0.999), values.back());
+	}
+}
+} //namespace
+
+int main()
+{
+	run(1, 16384 * 3, 0, "single FIFO");
+	run(3, 16384, 256, "priority lanes");
+}
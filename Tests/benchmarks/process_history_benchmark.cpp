@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "process_history.h"
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+using timestamp_type = process_history::timestamp_type;
+
+constexpr const timestamp_type second = 10000000;
+constexpr const timestamp_type day = 24 * 60 * 60 * second;
+
+double get_microseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(benchmark_clock::now() - start).count();
+}
+
+struct short_lived_process
+{
+	process_key key;
+	timestamp_type end_time;
+};
+
+struct long_lived_thread
+{
+	timestamp_type end_time;
+	process_key owner;
+	std::uint32_t tid;
+};
+
+//A day of a busy machine: 100 services with 60 modules and 20 threads each,
+//a process with 30 modules and 5 threads started every 2 seconds on average
+//and living up to 10 minutes, and a short-lived service thread every 100 ms
+void run(timestamp_type retention)
+{
+	process_history history(retention, 4096);
+	std::mt19937_64 random(3);
+	std::vector<std::wstring> names;
+	for (int i = 0; i != 400; ++i)
+		names.push_back(L"C:\\Windows\\System32\\module_" + std::to_wstring(i) + L".dll");
+
+	const timestamp_type first_time = 1000 * second;
+	std::uint32_t next_pid = 1000;
+	std::vector<process_key> services;
+	for (std::uint32_t i = 0; i != 100; ++i)
+	{
+		process_key key{ next_pid += 4, first_time };
+		services.push_back(key);
+		history.add_process(first_time, key, boost::none, 0, L"C:\\service_" + std::to_wstring(i) + L".exe");
+		for (std::uint32_t module = 0; module != 60; ++module)
+			history.add_module(first_time, key, 0x7ff000000000ull + module * 0x100000, names[(i * 7 + module) % names.size()]);
+		for (std::uint32_t tid = 0; tid != 20; ++tid)
+			history.add_thread(first_time, key, key.pid * 100 + tid);
+	}
+
+	std::vector<short_lived_process> processes;
+	std::deque<long_lived_thread> threads;
+	std::uint32_t next_tid = 1;
+	auto start = benchmark_clock::now();
+	for (auto time = first_time; time < first_time + day; time += second / 10)
+	{
+		if (random() % 20 == 0)
+		{
+			process_key key{ next_pid += 4, time };
+			history.add_process(time, key, services[random() % services.size()], 1,
+				L"C:\\Program Files\\app_" + std::to_wstring(random() % 50) + L".exe");
+			for (std::uint32_t module = 0; module != 30; ++module)
+				history.add_module(time, key, 0x400000 + module * 0x10000, names[random() % names.size()]);
+			for (std::uint32_t tid = 0; tid != 5; ++tid)
+				history.add_thread(time, key, tid);
+
+			processes.push_back({ key, time + static_cast<timestamp_type>(30 + random() % 600) * second });
+		}
+
+		for (std::size_t i = 0; i != processes.size();)
+		{
+			if (processes[i].end_time > time)
+			{
+				++i;
+				continue;
+			}
+
+			history.remove_process(time, processes[i].key);
+			processes[i] = processes.back();
+			processes.pop_back();
+		}
+
+		const auto& owner = services[random() % services.size()];
+		history.add_thread(time, owner, 900000 + next_tid);
+		threads.push_back({ time + second * static_cast<timestamp_type>(1 + random() % 5), owner, next_tid++ });
+		while (!threads.empty() && threads.front().end_time <= time)
+		{
+			history.remove_thread(time, threads.front().owner, 900000 + threads.front().tid);
+			threads.pop_front();
+		}
+	}
+
+	std::printf("retention %lld s: recording a day %.2f s, %zu entries, %.1f MB\n",
+		static_cast<long long>(retention / second), get_microseconds(start) / 1e6,
+		history.get_entry_count(), history.get_memory_usage() / 1048576.0);
+
+	std::vector<const process_history::entry*> result;
+	double total = 0, worst = 0;
+	const int query_count = 2000;
+	for (int i = 0; i != query_count; ++i)
+	{
+		auto time = first_time + day - 1 - static_cast<timestamp_type>(random() % static_cast<std::uint64_t>(retention));
+		start = benchmark_clock::now();
+		history.get_state(time, result);
+		auto elapsed = get_microseconds(start);
+		total += elapsed;
+		worst = (std::max)(worst, elapsed);
+	}
+
+	std::printf("  point query: %.1f us average, %.1f us worst\n", total / query_count, worst);
+}
+} //namespace
+
+int main()
+{
+	run(day);
+	run(60 * 60 * second);
+	run(10 * 60 * second);
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+#include "event_tracing/reorder_buffer.h"
+
+using namespace event_tracing;
+
+//Reordering cost of a stream whose timestamps are jittered by up to the given amount
+int main()
+{
+	constexpr const std::int64_t event_count = 2000000;
+	std::mt19937 random(5);
+	for (std::int64_t jitter : { 0, 100, 1000, 5000 })
+	{
+		reorder_buffer<std::int64_t> buffer(2000, 100000, std::chrono::milliseconds(100));
+		std::int64_t last = -1;
+		std::size_t inversions = 0, late = 0;
+		auto handler = [&](std::int64_t& event, bool is_late)
+		{
+			if (is_late)
+			{
+				++late;
+				return;
+			}
+
+			inversions += event < last;
+			last = event;
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		for (std::int64_t i = 0; i != event_count; ++i)
+		{
+			std::int64_t timestamp = i * 10 + random() % (jitter + 1);
+			buffer.push(timestamp, std::int64_t(timestamp), handler);
+		}
+
+		buffer.flush(handler);
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		std::printf("jitter %lld: %.1f ns per event, %zu inversions, %zu late\n",
+			static_cast<long long>(jitter), elapsed.count() / event_count, inversions, late);
+	}
+}
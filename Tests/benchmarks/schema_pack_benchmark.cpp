@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/manifest_compiler.h"
+#include "event_tracing/schema_pack.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr const int provider_count = 50;
+constexpr const int event_count = 100;
+constexpr const int open_count = 2000;
+const char* const pack_file_name = "schema_pack_benchmark.pack";
+
+double get_milliseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(benchmark_clock::now() - start).count();
+}
+
+std::string make_provider_guid(int provider)
+{
+	char guid[40];
+	std::snprintf(guid, sizeof(guid), "{%08X-0E7B-422B-A0C7-2FAD1FD0E716}", provider + 1);
+	return guid;
+}
+
+//Providers with a value map and events of 6-property templates, one of them an array
+std::string make_manifest()
+{
+	std::ostringstream manifest, strings;
+	manifest << "<instrumentationManifest xmlns=\"http://schemas.microsoft.com/win/2004/08/events\">"
+		"<instrumentation><events>";
+	for (int provider = 0; provider != provider_count; ++provider)
+	{
+		manifest << "<provider name=\"Benchmark-Provider-" << provider << "\" guid=\""
+			<< make_provider_guid(provider) << "\" symbol=\"P" << provider << "\"><events>";
+		for (int event = 0; event != event_count; ++event)
+		{
+			manifest << "<event value=\"" << event << "\" level=\"win:Informational\" template=\"T" << event
+				<< "\" message=\"$(string.P" << provider << "E" << event << ")\"/>";
+			strings << "<string id=\"P" << provider << "E" << event << "\" value=\"Event " << event
+				<< " of process %1 with %2 items\"/>";
+		}
+
+		manifest << "</events><maps><valueMap name=\"Kind\"><map value=\"0\" message=\"$(string.Kind0)\"/>"
+			"<map value=\"1\" message=\"$(string.Kind1)\"/></valueMap></maps><templates>";
+		for (int event = 0; event != event_count; ++event)
+		{
+			manifest << "<template tid=\"T" << event << "\">"
+				"<data name=\"ProcessID\" inType=\"win:UInt32\"/>"
+				"<data name=\"Count\" inType=\"win:UInt16\"/>"
+				"<data name=\"Items\" inType=\"win:UInt64\" count=\"Count\"/>"
+				"<data name=\"Kind\" inType=\"win:UInt32\" map=\"Kind\"/>"
+				"<data name=\"Name\" inType=\"win:UnicodeString\"/>"
+				"<data name=\"Flags\" inType=\"win:UInt32\" outType=\"win:HexInt32\"/>"
+				"</template>";
+		}
+
+		manifest << "</templates></provider>";
+	}
+
+	manifest << "</events></instrumentation><localization><resources culture=\"en-US\"><stringTable>"
+		<< strings.str() << "<string id=\"Kind0\" value=\"Normal\"/><string id=\"Kind1\" value=\"Crash\"/>"
+		"</stringTable></resources></localization></instrumentationManifest>";
+	return manifest.str();
+}
+} //namespace
+
+//Compiling a 5000-event manifest, opening its schema pack and unpacking schemas
+int main()
+{
+	std::istringstream manifest(make_manifest());
+	manifest_compiler compiler;
+	auto start = benchmark_clock::now();
+	compiler.add_manifest(manifest);
+	std::printf("compile: %.1f ms for %zu events\n", get_milliseconds(start), compiler.get_events().size());
+
+	start = benchmark_clock::now();
+	compiler.write_schema_pack(pack_file_name);
+	std::printf("write pack: %.1f ms\n", get_milliseconds(start));
+
+	std::size_t checksum = 0;
+	start = benchmark_clock::now();
+	for (int i = 0; i != open_count; ++i)
+	{
+		schema_pack pack(pack_file_name);
+		checksum += pack.get_event_count();
+	}
+
+	std::printf("open: %.2f us/pack\n", get_milliseconds(start) * 1000.0 / open_count);
+
+	{
+		schema_pack pack(pack_file_name);
+		start = benchmark_clock::now();
+		for (const auto& event : compiler.get_events())
+			checksum += pack.get_schema(event.provider_id, event.descriptor) ? 1u : 0u;
+		std::printf("get_schema: %.2f us/event\n",
+			get_milliseconds(start) * 1000.0 / compiler.get_events().size());
+
+		start = benchmark_clock::now();
+		for (const auto& map : compiler.get_maps())
+			checksum += pack.get_map(map.provider_id, map.name.c_str()) ? 1u : 0u;
+		std::printf("get_map: %.2f us/map (checksum %zu)\n",
+			get_milliseconds(start) * 1000.0 / compiler.get_maps().size(), checksum);
+	}
+
+	std::remove(pack_file_name);
+}
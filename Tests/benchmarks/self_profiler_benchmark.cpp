@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "event_tracing/self_profiler.h"
+
+using namespace event_tracing;
+
+namespace
+{
+volatile unsigned sink;
+
+const profile_probe leaf_probe("leaf");
+const profile_probe outer_probe("outer");
+
+#ifdef _MSC_VER
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+//Disabled probes, as compiled without EVENT_TRACING_PROFILING
+BENCHMARK_NOINLINE void leaf(unsigned value)
+{
+	EVENT_TRACING_PROFILE_SCOPE("leaf");
+	sink = value * 3;
+}
+
+BENCHMARK_NOINLINE void outer(unsigned value)
+{
+	EVENT_TRACING_PROFILE_SCOPE("outer");
+	leaf(value);
+	leaf(value + 1);
+}
+
+//The scopes the macro places when profiling is enabled
+BENCHMARK_NOINLINE void profiled_leaf(unsigned value)
+{
+	const profile_scope scope(leaf_probe);
+	sink = value * 3;
+}
+
+BENCHMARK_NOINLINE void profiled_outer(unsigned value)
+{
+	const profile_scope scope(outer_probe);
+	profiled_leaf(value);
+	profiled_leaf(value + 1);
+}
+
+template<typename Call>
+double measure(Call call, unsigned count)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i != count; ++i)
+		call(i);
+
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+} //namespace
+
+//Cost of an outer call with 3 probe scopes, disabled and enabled
+int main()
+{
+	const unsigned count = 20000000;
+	auto disabled = measure(outer, count);
+	auto enabled = measure(profiled_outer, count);
+
+	const unsigned read_count = 10000000;
+	std::uint64_t cycles = 0;
+	auto read_time = measure([&cycles](unsigned) { cycles += read_cycle_counter(); }, read_count);
+
+	std::printf("disabled: %.2f ns per call\n", disabled);
+	std::printf("enabled:  %.2f ns per call, %.2f ns per scope\n", enabled, (enabled - disabled) / 3);
+	std::printf("cycle counter read: %.2f ns (checksum %llu)\n", read_time,
+		static_cast<unsigned long long>(cycles & 1));
+}
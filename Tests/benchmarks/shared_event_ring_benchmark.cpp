@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_tracing/shared_event_ring.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+struct reader_result
+{
+	std::uint64_t received = 0;
+	std::uint64_t lost = 0;
+	std::uint64_t invalid = 0;
+};
+
+void read_ring(const std::string& name, std::uint64_t pause_interval, reader_result& result)
+{
+	shared_event_ring_reader reader(name);
+	std::vector<std::uint8_t> record;
+	std::uint64_t last_sequence = 0;
+	while (true)
+	{
+		auto read = reader.read(record);
+		if (read == shared_event_ring_reader::read_result::finished)
+			break;
+
+		if (read == shared_event_ring_reader::read_result::empty)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::uint64_t sequence = 0;
+		std::memcpy(&sequence, record.data(), sizeof(sequence));
+		if (record.size() != 64 + sequence % 400 || record.back() != static_cast<std::uint8_t>(sequence)
+			|| (result.received && sequence <= last_sequence))
+		{
+			++result.invalid;
+		}
+
+		last_sequence = sequence;
+		++result.received;
+		if (pause_interval && result.received % pause_interval == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	result.lost = reader.get_lost_count();
+}
+
+//Records of 64-463 bytes written to the ring while reader threads read them
+void run(const char* title, std::size_t capacity, std::uint64_t record_count, int fast_readers, int slow_readers)
+{
+	const std::string name = "event_tracing_ring_benchmark";
+	auto writer = std::make_unique<shared_event_ring_writer>(name, capacity);
+	std::vector<reader_result> results(fast_readers + slow_readers);
+	std::vector<std::thread> readers;
+	for (int i = 0; i != fast_readers + slow_readers; ++i)
+		readers.emplace_back(read_ring, name, i < fast_readers ? 0 : 1000, std::ref(results[i]));
+
+	while (writer->get_readers().size() != results.size())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	std::uint64_t bytes = 0;
+	auto start = benchmark_clock::now();
+	for (std::uint64_t sequence = 0; sequence != record_count; ++sequence)
+	{
+		std::size_t size = 64 + sequence % 400;
+		writer->write(size, [sequence, size](std::uint8_t* data)
+		{
+			std::memcpy(data, &sequence, sizeof(sequence));
+			std::memset(data + sizeof(sequence), static_cast<std::uint8_t>(sequence), size - sizeof(sequence));
+		});
+
+		bytes += size;
+	}
+
+	std::chrono::duration<double> elapsed = benchmark_clock::now() - start;
+	writer.reset();
+	for (auto& reader : readers)
+		reader.join();
+
+	std::printf("%s: writer %.2fM records/s, %.0f MB/s\n", title, record_count / elapsed.count() / 1e6,
+		bytes / elapsed.count() / 1e6);
+	for (std::size_t i = 0; i != results.size(); ++i)
+	{
+		std::printf("  %s reader: %llu received, %llu lost, %llu invalid\n",
+			i < static_cast<std::size_t>(fast_readers) ? "fast" : "slow",
+			static_cast<unsigned long long>(results[i].received),
+			static_cast<unsigned long long>(results[i].lost),
+			static_cast<unsigned long long>(results[i].invalid));
+	}
+}
+} //namespace
+
+int main()
+{
+	run("one reader", 64 << 20, 2000000, 1, 0);
+	run("two fast readers, one throttled", 64 << 20, 2000000, 2, 1);
+}
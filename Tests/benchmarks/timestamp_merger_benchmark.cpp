@@ -0,0 +1,41 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "event_tracing/timestamp_merger.h"
+
+using namespace event_tracing;
+
+//Merge throughput of k inputs sharing one clock, each event goes to a random input
+int main()
+{
+	constexpr const int event_count = 2000000;
+	std::mt19937 random(1);
+	for (std::size_t stream_count : { 1, 3, 8, 64 })
+	{
+		timestamp_merger<std::int64_t> merger(stream_count, 1000,
+			std::chrono::seconds(1), 65536);
+		std::int64_t timestamp = 0, last = -1;
+		std::size_t released = 0, out_of_order = 0;
+		auto handler = [&](std::size_t, std::int64_t& event)
+		{
+			out_of_order += event < last;
+			last = event;
+			++released;
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i != event_count; ++i)
+		{
+			timestamp += random() % 50;
+			merger.push(random() % stream_count, timestamp, std::int64_t(timestamp), handler);
+		}
+
+		merger.flush(handler);
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		std::printf("%zu inputs: %.1f ns per event, %zu released, %zu out of order\n",
+			stream_count, elapsed.count() / event_count, released, out_of_order);
+	}
+}
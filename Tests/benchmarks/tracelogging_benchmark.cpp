@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_visitor.h"
+#include "event_tracing/tracelogging_schema.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr const int event_count = 1000000;
+
+double get_nanoseconds(benchmark_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count() / event_count;
+}
+
+class counting_visitor : public event_visitor
+{
+public:
+	void value(const event_property_view& prop) override
+	{
+		size += prop.get_size();
+	}
+
+	std::size_t size = 0;
+};
+
+void add_name(std::vector<std::uint8_t>& metadata, const char* name)
+{
+	metadata.insert(metadata.end(), name, name + std::strlen(name) + 1);
+}
+
+//ProcessStarted { Pid, ParentPid, Image, Args[], Flags, Start }
+std::vector<std::uint8_t> make_metadata()
+{
+	std::vector<std::uint8_t> metadata{ 0, 0, 0 };
+	add_name(metadata, "ProcessStarted");
+	add_name(metadata, "Pid");
+	metadata.push_back(TDH_INTYPE_UINT32);
+	add_name(metadata, "ParentPid");
+	metadata.push_back(TDH_INTYPE_UINT32);
+	add_name(metadata, "Image");
+	metadata.push_back(TDH_INTYPE_UNICODESTRING);
+	add_name(metadata, "Args");
+	//Variable count
+	metadata.push_back(TDH_INTYPE_UNICODESTRING | 0x40);
+	add_name(metadata, "Flags");
+	metadata.push_back(TDH_INTYPE_UINT32);
+	add_name(metadata, "Start");
+	metadata.push_back(TDH_INTYPE_UINT64);
+	auto size = static_cast<std::uint16_t>(metadata.size());
+	std::memcpy(metadata.data(), &size, sizeof(size));
+	return metadata;
+}
+} //namespace
+
+//Decoding a 6-field TraceLogging event: parsing its metadata for every
+//event, walking it with the cached schema, and reading two properties
+//through event_info with the schema cache
+int main()
+{
+	auto metadata = make_metadata();
+	test_events::payload_builder payload;
+	payload.add<std::uint32_t>(4242).add<std::uint32_t>(4).add_string(L"C:\\Windows\\System32\\svchost.exe")
+		.add<std::uint16_t>(2).add_string(L"-k").add_string(L"netsvcs").add<std::uint32_t>(1)
+		.add<std::uint64_t>(132000000000000000ull);
+	auto record = test_events::make_record(payload.get_data(), 0);
+	EVENT_HEADER_EXTENDED_DATA_ITEM item{};
+	item.ExtType = EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL;
+	item.DataSize = static_cast<USHORT>(metadata.size());
+	item.DataPtr = reinterpret_cast<ULONGLONG>(metadata.data());
+	record.EventHeader.Flags |= EVENT_HEADER_FLAG_EXTENDED_INFO;
+	record.ExtendedDataCount = 1;
+	record.ExtendedData = &item;
+
+	counting_visitor visitor;
+	auto start = benchmark_clock::now();
+	for (int i = 0; i != event_count; ++i)
+	{
+		auto schema = parse_tracelogging_schema(record);
+		visit_event(**schema, record, visitor);
+	}
+
+	std::printf("parse and visit: %.0f ns/event\n", get_nanoseconds(start));
+
+	event_schema_cache cache;
+	start = benchmark_clock::now();
+	for (int i = 0; i != event_count; ++i)
+		visit_event(**cache.get(&record), record, visitor);
+	std::printf("cached visit: %.0f ns/event\n", get_nanoseconds(start));
+
+	std::uint64_t checksum = 0;
+	start = benchmark_clock::now();
+	for (int i = 0; i != event_count; ++i)
+	{
+		event_info info(&record, cache);
+		checksum += info.get_plain_property_value<std::uint32_t>(0)
+			+ info.get_plain_property_value<std::uint32_t>(1);
+	}
+
+	std::printf("event_info reads: %.0f ns/event (checksum %zu)\n", get_nanoseconds(start),
+		static_cast<std::size_t>(checksum + visitor.size));
+}
@@ -0,0 +1,250 @@
+#define BOOST_TEST_MODULE checkpoint_file
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "checkpoint_file.h"
+
+namespace
+{
+const std::wstring file_name = L"checkpoint_file_tests.checkpoint";
+const std::wstring journal_name = file_name + L".journal";
+
+struct file_cleanup
+{
+	file_cleanup()
+	{
+		remove_files();
+	}
+
+	~file_cleanup()
+	{
+		remove_files();
+	}
+
+	static void remove_files()
+	{
+		std::remove("checkpoint_file_tests.checkpoint");
+		std::remove("checkpoint_file_tests.checkpoint.journal");
+	}
+};
+
+checkpoint_writer make_records(std::uint32_t first_pid, std::uint32_t count)
+{
+	checkpoint_writer records;
+	for (auto pid = first_pid; pid != first_pid + count; ++pid)
+		write_thread_stopped(records, pid, pid + 1u);
+
+	return records;
+}
+
+std::vector<std::uint32_t> read_journal(std::uint64_t& generation)
+{
+	struct pid_visitor
+	{
+		void process_started(process&&, const boost::optional<process_key>&) {}
+		void process_stopped(std::uint32_t, std::uint32_t, std::int64_t) {}
+		void thread_started(process_thread&&) {}
+		void module_loaded(process_module&&) {}
+		void module_unloaded(std::uint32_t, std::uint64_t) {}
+		void modules_incomplete(std::uint32_t) {}
+
+		void thread_stopped(std::uint32_t pid, std::uint32_t)
+		{
+			pids.push_back(pid);
+		}
+
+		std::vector<std::uint32_t> pids;
+	} visitor;
+
+	auto data = read_checkpoint_file(journal_name);
+	checkpoint_reader reader(data.data(), data.size());
+	generation = read_journal_header(reader);
+	replay_journal(reader, visitor);
+	return visitor.pids;
+}
+
+std::vector<restored_process> make_state(std::uint32_t pid)
+{
+	std::vector<restored_process> processes;
+	processes.push_back({ process(L"a.exe", pid, pid * 10, 0, 1), boost::none });
+	return processes;
+}
+
+//PIDs of the checkpoint processes, by PID
+std::vector<std::uint32_t> read_checkpoint(std::uint64_t& generation)
+{
+	auto data = read_checkpoint_file(file_name);
+	std::vector<std::uint32_t> pids;
+	for (const auto& entry : load_checkpoint(data.data(), data.size(), generation))
+		pids.push_back(entry.value.get_pid());
+
+	std::sort(pids.begin(), pids.end());
+	return pids;
+}
+} //namespace
+
+BOOST_FIXTURE_TEST_SUITE(checkpoint_file, file_cleanup)
+
+BOOST_AUTO_TEST_CASE(reads_missing_file_as_empty)
+{
+	BOOST_CHECK(read_checkpoint_file(file_name).empty());
+}
+
+BOOST_AUTO_TEST_CASE(replaces_checkpoint)
+{
+	replace_checkpoint_file(file_name, { 1, 2, 3 });
+	replace_checkpoint_file(file_name, { 4, 5 });
+	BOOST_CHECK((read_checkpoint_file(file_name) == std::vector<std::uint8_t>{ 4, 5 }));
+}
+
+BOOST_AUTO_TEST_CASE(saver_writes_in_queue_order)
+{
+	std::size_t error_count = 0;
+	checkpoint_saver saver(file_name, std::chrono::hours(1), [&error_count](const checkpoint_error&)
+	{
+		++error_count;
+	});
+
+	saver.reset(1, make_state(4));
+	saver.append(make_records(10, 3));
+	saver.save(2);
+	saver.append(make_records(20, 2));
+	saver.flush();
+
+	//Records queued before the second checkpoint went to the first journal
+	std::uint64_t generation = 0;
+	BOOST_CHECK((read_journal(generation) == std::vector<std::uint32_t>{ 20, 21 }));
+	BOOST_CHECK_EQUAL(generation, 2u);
+	BOOST_CHECK((read_checkpoint(generation) == std::vector<std::uint32_t>{ 4 }));
+	BOOST_CHECK_EQUAL(generation, 2u);
+	BOOST_CHECK_EQUAL(error_count, 0u);
+	BOOST_CHECK(!saver.has_failed());
+}
+
+BOOST_AUTO_TEST_CASE(saver_encodes_state_of_journal_records)
+{
+	checkpoint_saver saver(file_name, std::chrono::hours(1), [](const checkpoint_error&)
+	{
+	});
+
+	saver.reset(1, make_state(4));
+	checkpoint_writer records;
+	write_process_started(records, process(L"b.exe", 8, 80, 4, 1), process_key{ 4, 40 });
+	write_thread_started(records, process_thread(8, 9, 1, 2, 3));
+	write_module_loaded(records, process_module(8, 0x1000, L"b.dll"));
+	write_modules_incomplete(records, 8);
+	write_process_started(records, process(L"c.exe", 12, 120, 8, 1), process_key{ 8, 80 });
+	write_process_stopped(records, 4, 0, 100);
+	saver.append(records);
+	saver.save(2);
+	saver.flush();
+
+	auto data = read_checkpoint_file(file_name);
+	std::uint64_t generation = 0;
+	auto restored = load_checkpoint(data.data(), data.size(), generation);
+	BOOST_CHECK_EQUAL(generation, 2u);
+	BOOST_REQUIRE_EQUAL(restored.size(), 2u);
+	const auto& value = restored[0].value;
+	BOOST_CHECK_EQUAL(value.get_pid(), 8u);
+	BOOST_CHECK(restored[0].parent == (process_key{ 4, 40 }));
+	BOOST_CHECK_EQUAL(value.get_threads().size(), 1u);
+	BOOST_REQUIRE_EQUAL(value.get_modules().size(), 1u);
+	BOOST_CHECK(value.get_modules().at(0x1000).get_image_name() == L"b.dll");
+	BOOST_CHECK(value.has_incomplete_modules());
+	BOOST_CHECK(restored[1].parent == (process_key{ 8, 80 }));
+}
+
+//Each checkpoint supersedes the one not yet started, the state and journal
+//cover every record whichever of them were written
+BOOST_AUTO_TEST_CASE(saver_supersedes_pending_checkpoints)
+{
+	checkpoint_saver saver(file_name, std::chrono::hours(1), [](const checkpoint_error&)
+	{
+	});
+
+	saver.reset(1, make_state(4));
+	for (std::uint32_t pid = 8; pid != 808; pid += 4)
+	{
+		checkpoint_writer records;
+		write_process_started(records, process(L"b.exe", pid, pid * 10, 4, 1), process_key{ 4, 40 });
+		saver.append(records);
+		saver.save(pid);
+		if (pid == 400)
+			saver.reset(pid, make_state(2));
+	}
+
+	saver.append(make_records(30, 2));
+	saver.flush();
+
+	std::uint64_t generation = 0;
+	BOOST_CHECK((read_journal(generation) == std::vector<std::uint32_t>{ 30, 31 }));
+	BOOST_CHECK_EQUAL(generation, 804u);
+	auto pids = read_checkpoint(generation);
+	BOOST_CHECK_EQUAL(generation, 804u);
+	BOOST_REQUIRE_EQUAL(pids.size(), 102u);
+	BOOST_CHECK_EQUAL(pids.front(), 2u);
+	BOOST_CHECK_EQUAL(pids[1], 404u);
+	BOOST_CHECK_EQUAL(pids.back(), 804u);
+}
+
+BOOST_AUTO_TEST_CASE(saver_writes_journal_periodically)
+{
+	checkpoint_saver saver(file_name, std::chrono::milliseconds(10), [](const checkpoint_error&)
+	{
+	});
+
+	saver.reset(3, make_state(4));
+	saver.flush();
+	saver.append(make_records(1, 4));
+
+	std::vector<std::uint32_t> pids;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	std::uint64_t generation = 0;
+	while (pids.size() != 4u && std::chrono::steady_clock::now() < deadline)
+		pids = read_journal(generation);
+
+	BOOST_CHECK((pids == std::vector<std::uint32_t>{ 1, 2, 3, 4 }));
+	BOOST_CHECK_EQUAL(generation, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(saver_writes_everything_when_destroyed)
+{
+	{
+		checkpoint_saver saver(file_name, std::chrono::hours(1), [](const checkpoint_error&)
+		{
+		});
+
+		saver.reset(4, make_state(4));
+		saver.append(make_records(7, 2));
+	}
+
+	std::uint64_t generation = 0;
+	BOOST_CHECK((read_journal(generation) == std::vector<std::uint32_t>{ 7, 8 }));
+}
+
+BOOST_AUTO_TEST_CASE(saver_stops_after_failure)
+{
+	std::size_t error_count = 0;
+	checkpoint_saver saver(L"missing_directory/file.checkpoint", std::chrono::hours(1),
+		[&error_count](const checkpoint_error& error)
+	{
+		BOOST_CHECK_NE(error.get_error_code(), 0u);
+		++error_count;
+	});
+
+	saver.reset(1, make_state(4));
+	saver.flush();
+	BOOST_CHECK(saver.has_failed());
+	saver.append(make_records(1, 1));
+	saver.save(2);
+	saver.flush();
+	BOOST_CHECK_EQUAL(error_count, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,307 @@
+#define BOOST_TEST_MODULE clock_domain
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <tdh.h>
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "event_tracing/clock_domain.h"
+#include "event_tracing/event_property.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using wide_int = boost::multiprecision::int128_t;
+
+constexpr const std::int64_t nanoseconds_per_second = 1000000000ll;
+constexpr const std::int64_t seconds_per_day = 86400;
+const wide_int max_nanoseconds = (std::numeric_limits<std::int64_t>::max)();
+const wide_int min_nanoseconds = (std::numeric_limits<std::int64_t>::min)();
+
+struct civil_date
+{
+	std::int64_t year;
+	unsigned month;
+	unsigned day;
+};
+
+//Days since 1970-01-01 of a proleptic Gregorian date
+std::int64_t days_from_civil(std::int64_t year, unsigned month, unsigned day)
+{
+	year -= month <= 2;
+	auto era = (year >= 0 ? year : year - 399) / 400;
+	auto year_of_era = year - era * 400;
+	auto day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	auto day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+	return era * 146097 + day_of_era - 719468;
+}
+
+civil_date civil_from_days(std::int64_t days)
+{
+	days += 719468;
+	auto era = (days >= 0 ? days : days - 146096) / 146097;
+	auto day_of_era = days - era * 146097;
+	auto year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	auto day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	auto month_index = (5 * day_of_year + 2) / 153;
+	auto month = static_cast<unsigned>(month_index < 10 ? month_index + 3 : month_index - 9);
+	return { year_of_era + era * 400 + (month <= 2), month,
+		static_cast<unsigned>(day_of_year - (153 * month_index + 2) / 5 + 1) };
+}
+
+bool is_leap_year(std::int64_t year)
+{
+	return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+unsigned get_month_days(std::int64_t year, unsigned month)
+{
+	static const unsigned days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	return month == 2 && is_leap_year(year) ? 29u : days[month - 1];
+}
+
+std::wstring format_reference(std::int64_t unix_nanoseconds, unsigned fraction_digits)
+{
+	auto seconds = unix_nanoseconds / nanoseconds_per_second;
+	auto fraction = unix_nanoseconds % nanoseconds_per_second;
+	if (fraction < 0)
+	{
+		fraction += nanoseconds_per_second;
+		--seconds;
+	}
+
+	auto days = seconds / seconds_per_day;
+	auto day_seconds = seconds % seconds_per_day;
+	if (day_seconds < 0)
+	{
+		day_seconds += seconds_per_day;
+		--days;
+	}
+
+	auto date = civil_from_days(days);
+	char text[64];
+	std::snprintf(text, sizeof(text), "%04lld-%02u-%02uT%02lld:%02lld:%02lld",
+		static_cast<long long>(date.year), date.month, date.day, static_cast<long long>(day_seconds / 3600),
+		static_cast<long long>(day_seconds / 60 % 60), static_cast<long long>(day_seconds % 60));
+	std::string result = text;
+	if (fraction_digits)
+	{
+		std::snprintf(text, sizeof(text), "%09lld", static_cast<long long>(fraction));
+		result += '.';
+		result.append(text, fraction_digits);
+	}
+
+	result += 'Z';
+	return std::wstring(result.begin(), result.end());
+}
+
+std::int64_t clamp_nanoseconds(wide_int value)
+{
+	if (value > max_nanoseconds)
+		value = max_nanoseconds;
+	else if (value < min_nanoseconds)
+		value = min_nanoseconds;
+
+	return static_cast<std::int64_t>(value);
+}
+
+template<typename T>
+event_property make_property(std::uint16_t in_type, const T& value)
+{
+	std::vector<std::uint8_t> raw(sizeof(value));
+	std::memcpy(raw.data(), &value, sizeof(value));
+	return event_property(in_type, 0, true, std::move(raw), L"Time");
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(converts_filetime_exactly)
+{
+	BOOST_CHECK_EQUAL(*filetime_to_unix_nanoseconds(unix_epoch_filetime), 0);
+	BOOST_CHECK_EQUAL(*filetime_to_unix_nanoseconds(unix_epoch_filetime + 1), 100);
+	//1601 and the largest values are out of the nanosecond range
+	BOOST_CHECK(!filetime_to_unix_nanoseconds(0));
+	BOOST_CHECK(!filetime_to_unix_nanoseconds(~0ull));
+
+	std::mt19937_64 random(42);
+	for (int i = 0; i != 100000; ++i)
+	{
+		auto filetime = random() % 0x7fffffffffffffffull;
+		auto expected = (wide_int(filetime) - unix_epoch_filetime) * 100;
+		auto value = filetime_to_unix_nanoseconds(filetime);
+		BOOST_REQUIRE_EQUAL(static_cast<bool>(value), expected >= min_nanoseconds && expected <= max_nanoseconds);
+		if (value)
+			BOOST_REQUIRE_EQUAL(*value, static_cast<std::int64_t>(expected));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(converts_systemtime_exactly)
+{
+	std::mt19937_64 random(42);
+	for (int i = 0; i != 100000; ++i)
+	{
+		SYSTEMTIME time{};
+		time.wYear = static_cast<WORD>(1601 + random() % 800);
+		time.wMonth = static_cast<WORD>(1 + random() % 12);
+		time.wDay = static_cast<WORD>(1 + random() % 31);
+		time.wHour = static_cast<WORD>(random() % 24);
+		time.wMinute = static_cast<WORD>(random() % 60);
+		time.wSecond = static_cast<WORD>(random() % 60);
+		time.wMilliseconds = static_cast<WORD>(random() % 1000);
+
+		auto seconds = days_from_civil(time.wYear, time.wMonth, time.wDay) * seconds_per_day
+			+ time.wHour * 3600 + time.wMinute * 60 + time.wSecond;
+		auto expected = wide_int(seconds) * nanoseconds_per_second + wide_int(time.wMilliseconds) * 1000000;
+		bool is_valid = time.wDay <= get_month_days(time.wYear, time.wMonth)
+			&& expected >= min_nanoseconds && expected <= max_nanoseconds;
+		auto value = systemtime_to_unix_nanoseconds(time);
+		BOOST_REQUIRE_EQUAL(static_cast<bool>(value), is_valid);
+		if (value)
+			BOOST_REQUIRE_EQUAL(*value, static_cast<std::int64_t>(expected));
+	}
+
+	SYSTEMTIME time{};
+	time.wYear = 2000;
+	time.wMonth = 2;
+	time.wDay = 29;
+	BOOST_CHECK(systemtime_to_unix_nanoseconds(time));
+	time.wYear = 1900;
+	BOOST_CHECK(!systemtime_to_unix_nanoseconds(time));
+	time.wMonth = 13;
+	time.wDay = 1;
+	BOOST_CHECK(!systemtime_to_unix_nanoseconds(time));
+	time.wMonth = 1;
+	time.wMilliseconds = 1000;
+	BOOST_CHECK(!systemtime_to_unix_nanoseconds(time));
+}
+
+BOOST_AUTO_TEST_CASE(formats_iso8601)
+{
+	wchar_t buffer[iso8601_max_length];
+	for (std::int64_t value : { (std::numeric_limits<std::int64_t>::min)(), (std::numeric_limits<std::int64_t>::max)(),
+		std::int64_t(0), std::int64_t(-1), std::int64_t(951782400123456789ll) })
+	{
+		for (unsigned digits = 0; digits <= 10; ++digits)
+		{
+			auto length = format_iso8601(value, digits, buffer);
+			BOOST_REQUIRE(length <= iso8601_max_length);
+			BOOST_CHECK(std::wstring(buffer, length) == format_reference(value, digits > 9 ? 9 : digits));
+		}
+	}
+
+	BOOST_CHECK(std::wstring(buffer, format_iso8601(951782400123456789ll, 7, buffer))
+		== L"2000-02-29T00:00:00.1234567Z");
+
+	std::mt19937_64 random(42);
+	for (int i = 0; i != 100000; ++i)
+	{
+		auto value = static_cast<std::int64_t>(random());
+		auto digits = static_cast<unsigned>(random() % 10);
+		BOOST_REQUIRE(std::wstring(buffer, format_iso8601(value, digits, buffer)) == format_reference(value, digits));
+	}
+
+	std::wstring text = L"at ";
+	append_iso8601(0, 3, text);
+	BOOST_CHECK(text == L"at 1970-01-01T00:00:00.000Z");
+}
+
+BOOST_AUTO_TEST_CASE(converts_counter_ticks_exactly)
+{
+	std::mt19937_64 random(42);
+	for (std::int64_t frequency : { 10000000ll, 3579545ll, 2800000000ll, 1000000000ll, 1000ll, 1001ll,
+		9223372036ll, 24000000ll, 14318180ll })
+	{
+		auto system_time = unix_epoch_filetime + 17000000000000000ll + static_cast<std::int64_t>(random() % 1000000000);
+		auto counter = static_cast<std::int64_t>(random() >> 4);
+		auto clock = clock_domain::query_performance_counter(frequency, counter, system_time);
+		BOOST_CHECK(!clock.is_system_time());
+		BOOST_CHECK_EQUAL(clock.get_frequency(), frequency);
+
+		auto base = (wide_int(system_time) - unix_epoch_filetime) * 100;
+		for (int i = 0; i != 40000; ++i)
+		{
+			std::int64_t timestamp;
+			switch (i % 4)
+			{
+			case 0:
+				timestamp = static_cast<std::int64_t>(random());
+				break;
+			case 1:
+				timestamp = counter + static_cast<std::int64_t>(random() % 1000000000000ll) - 500000000000ll;
+				break;
+			case 2:
+				timestamp = counter + static_cast<std::int64_t>(random() % (1ull << 40));
+				break;
+			default:
+				timestamp = i % 8 == 3
+					? (std::numeric_limits<std::int64_t>::min)() + static_cast<std::int64_t>(random() % 1000)
+					: (std::numeric_limits<std::int64_t>::max)() - static_cast<std::int64_t>(random() % 1000);
+				break;
+			}
+
+			//Rounded down
+			auto scaled = (wide_int(timestamp) - counter) * nanoseconds_per_second;
+			auto ticks = scaled / frequency;
+			if (scaled % frequency != 0 && scaled < 0)
+				--ticks;
+
+			BOOST_REQUIRE_EQUAL(clock.to_unix_nanoseconds(timestamp), clamp_nanoseconds(base + ticks));
+		}
+	}
+
+	BOOST_CHECK_THROW(clock_domain::query_performance_counter(0, 0, unix_epoch_filetime), std::exception);
+	BOOST_CHECK_THROW(clock_domain::query_performance_counter(999, 0, unix_epoch_filetime), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(converts_system_time_timestamps)
+{
+	auto clock = clock_domain::system_time();
+	BOOST_CHECK(clock.is_system_time());
+	BOOST_CHECK_EQUAL(clock.to_unix_nanoseconds(unix_epoch_filetime + 5), 500);
+	BOOST_CHECK_EQUAL(clock.to_unix_nanoseconds((std::numeric_limits<std::int64_t>::max)()),
+		(std::numeric_limits<std::int64_t>::max)());
+	BOOST_CHECK_EQUAL(clock.to_unix_nanoseconds((std::numeric_limits<std::int64_t>::min)()),
+		(std::numeric_limits<std::int64_t>::min)());
+
+	//Calibrated against the current time
+	auto counter = clock_domain::query_performance_counter();
+	LARGE_INTEGER now;
+	::QueryPerformanceCounter(&now);
+	auto system_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	auto difference = counter.to_unix_nanoseconds(now.QuadPart) - system_now;
+	BOOST_CHECK(difference > -nanoseconds_per_second && difference < nanoseconds_per_second);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_property_time_precision)
+{
+	//2000-02-29T00:00:00.1234567Z
+	std::uint64_t filetime = unix_epoch_filetime + 9517824001234567ull;
+	auto prop = make_property(TDH_INTYPE_FILETIME, filetime);
+	auto nanoseconds = event_property_converter<event_type_unix_nanoseconds>::convert(prop);
+	BOOST_CHECK_EQUAL(nanoseconds, 951782400123456700ll);
+	auto time = event_property_converter<std::chrono::system_clock::time_point>::convert(prop);
+	BOOST_CHECK_EQUAL(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()
+		% nanoseconds_per_second, 123456700ll);
+	BOOST_CHECK(prop.to_wstring().find(L"Time = 2000-02-29T00:00:00.1234567Z") != std::wstring::npos);
+
+	SYSTEMTIME system_time{};
+	system_time.wYear = 2000;
+	system_time.wMonth = 2;
+	system_time.wDay = 29;
+	system_time.wMilliseconds = 123;
+	prop = make_property(TDH_INTYPE_SYSTEMTIME, system_time);
+	BOOST_CHECK_EQUAL(event_property_converter<event_type_unix_nanoseconds>::convert(prop), 951782400123000000ll);
+	BOOST_CHECK(prop.to_wstring().find(L"Time = 2000-02-29T00:00:00.123Z") != std::wstring::npos);
+}
@@ -0,0 +1,112 @@
+#define BOOST_TEST_MODULE event_batch_decoder
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "event_tracing/event_batch_decoder.h"
+#include "event_tracing/event_trace_error.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+std::shared_ptr<const event_schema> make_process_schema()
+{
+	return make_schema({ make_property(L"Pid", TDH_INTYPE_UINT32), make_property(L"Timestamp", TDH_INTYPE_UINT64),
+		make_property(L"Flags", TDH_INTYPE_UINT16), make_property(L"Name", TDH_INTYPE_UNICODESTRING),
+		make_property(L"Size", TDH_INTYPE_UINT64), make_array(L"Values", TDH_INTYPE_UINT32, 2, true) }, 6);
+}
+
+struct event_batch
+{
+	explicit event_batch(std::size_t count)
+	{
+		for (std::size_t i = 0; i != count; ++i)
+		{
+			payload_builder payload;
+			payload.add(static_cast<std::uint32_t>(4 + i)).add<std::uint64_t>(1000 + i)
+				.add(static_cast<std::uint16_t>(i)).add_string(std::wstring(i % 5, L'x'))
+				.add<std::uint64_t>(i * 4096).add<std::uint32_t>(1).add<std::uint32_t>(2);
+			payloads.push_back(std::move(payload.get_data()));
+		}
+
+		for (auto& payload : payloads)
+			records.push_back(make_record(payload, 1));
+		for (const auto& record : records)
+			pointers.push_back(&record);
+	}
+
+	std::vector<std::vector<std::uint8_t>> payloads;
+	std::vector<EVENT_RECORD> records;
+	std::vector<const EVENT_RECORD*> pointers;
+};
+} //namespace
+
+BOOST_AUTO_TEST_CASE(decodes_fixed_and_variable_offset_fields)
+{
+	event_batch batch(10);
+	event_batch_decoder decoder(make_process_schema(), { L"Timestamp", L"Size", L"Pid" });
+	BOOST_CHECK(decoder.has_fixed_offset(0));
+	BOOST_CHECK(!decoder.has_fixed_offset(1));
+	BOOST_CHECK(decoder.has_fixed_offset(2));
+
+	decoder.load(batch.pointers.data(), batch.pointers.size());
+	std::vector<std::uint64_t> timestamps, sizes;
+	std::vector<std::uint32_t> pids;
+	std::vector<std::uint8_t> valid;
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint64_t>(0, timestamps, valid), 10u);
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint64_t>(1, sizes, valid), 10u);
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint32_t>(2, pids, valid), 10u);
+	for (std::size_t i = 0; i != 10; ++i)
+	{
+		BOOST_CHECK_EQUAL(timestamps[i], 1000u + i);
+		BOOST_CHECK_EQUAL(sizes[i], i * 4096);
+		BOOST_CHECK_EQUAL(pids[i], 4u + i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(marks_truncated_events_invalid)
+{
+	event_batch batch(3);
+	batch.records[1].UserDataLength = 6;
+	event_batch_decoder decoder(make_process_schema(), { L"Pid", L"Timestamp", L"Size" });
+	decoder.load(batch.pointers.data(), batch.pointers.size());
+
+	std::vector<std::uint32_t> pids;
+	std::vector<std::uint64_t> values;
+	std::vector<std::uint8_t> valid;
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint32_t>(0, pids, valid), 3u);
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint64_t>(1, values, valid), 2u);
+	BOOST_CHECK(valid == std::vector<std::uint8_t>({ 1, 0, 1 }));
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint64_t>(2, values, valid), 2u);
+	BOOST_CHECK(valid == std::vector<std::uint8_t>({ 1, 0, 1 }));
+}
+
+BOOST_AUTO_TEST_CASE(converts_through_property_converters)
+{
+	event_batch batch(2);
+	event_batch_decoder decoder(make_process_schema(), { L"Name", L"Flags" });
+	decoder.load(batch.pointers.data(), batch.pointers.size());
+
+	std::vector<std::wstring> names;
+	std::vector<std::uint8_t> valid;
+	BOOST_CHECK_EQUAL(decoder.decode<std::wstring>(0, names, valid), 2u);
+	BOOST_CHECK(names == std::vector<std::wstring>({ L"", L"x" }));
+
+	//Same widening the converters do, and no value of a mismatched type
+	std::vector<std::uint32_t> values;
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint32_t>(1, values, valid), 2u);
+	BOOST_CHECK(values == std::vector<std::uint32_t>({ 0, 1 }));
+	BOOST_CHECK_EQUAL(decoder.decode<std::uint32_t>(0, values, valid), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(rejects_unknown_and_array_fields)
+{
+	BOOST_CHECK_THROW(event_batch_decoder(make_process_schema(), { L"Missing" }), event_trace_error);
+	BOOST_CHECK_THROW(event_batch_decoder(make_process_schema(), { L"Values" }), event_trace_error);
+}
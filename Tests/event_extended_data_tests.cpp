@@ -0,0 +1,131 @@
+#define BOOST_TEST_MODULE event_extended_data
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_extended_data.h"
+
+using namespace event_tracing;
+
+namespace
+{
+//Synthetic extended data of an event, items point into the owned buffers
+struct extended_data_fixture
+{
+	template<typename Value>
+	void add_value(USHORT ext_type, const Value& value)
+	{
+		std::vector<std::uint8_t> data(sizeof(value));
+		std::memcpy(data.data(), &value, sizeof(value));
+		add(ext_type, std::move(data));
+	}
+
+	void add(USHORT ext_type, std::vector<std::uint8_t> data)
+	{
+		buffers.push_back(std::move(data));
+		items.clear();
+		for (std::size_t i = 0; i != buffers.size(); ++i)
+		{
+			EVENT_HEADER_EXTENDED_DATA_ITEM item{};
+			item.ExtType = i + 1u == buffers.size() ? ext_type : types[i];
+			item.DataSize = static_cast<USHORT>(buffers[i].size());
+			item.DataPtr = reinterpret_cast<ULONGLONG>(buffers[i].data());
+			items.push_back(item);
+		}
+
+		types.push_back(ext_type);
+		record.ExtendedData = items.data();
+		record.ExtendedDataCount = static_cast<USHORT>(items.size());
+		record.EventHeader.Flags |= EVENT_HEADER_FLAG_EXTENDED_INFO;
+	}
+
+	std::vector<std::vector<std::uint8_t>> buffers;
+	std::vector<USHORT> types;
+	std::vector<EVENT_HEADER_EXTENDED_DATA_ITEM> items;
+	EVENT_RECORD record{};
+};
+
+std::vector<std::uint8_t> make_stack64(std::uint64_t match_id, const std::vector<std::uint64_t>& frames)
+{
+	std::vector<std::uint8_t> data(sizeof(match_id) + frames.size() * sizeof(std::uint64_t));
+	std::memcpy(data.data(), &match_id, sizeof(match_id));
+	std::memcpy(data.data() + sizeof(match_id), frames.data(), frames.size() * sizeof(std::uint64_t));
+	return data;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(reads_typed_items)
+{
+	extended_data_fixture fixture;
+	fixture.add(EVENT_HEADER_EXT_TYPE_STACK_TRACE64, make_stack64(42, { 0x100, 0x200, 0x300 }));
+	fixture.add_value<ULONG>(EVENT_HEADER_EXT_TYPE_TS_ID, 3);
+	fixture.add_value<std::uint64_t>(EVENT_HEADER_EXT_TYPE_PROCESS_START_KEY, 777);
+	GUID activity_id{ 1, 2, 3, { 4, 5, 6, 7, 8, 9, 10, 11 } };
+	fixture.add_value(EVENT_HEADER_EXT_TYPE_RELATED_ACTIVITYID, activity_id);
+
+	event_extended_data data(fixture.record);
+	BOOST_CHECK_EQUAL(data.size(), 4u);
+	auto stack = data.get_stack_trace();
+	BOOST_REQUIRE(stack);
+	BOOST_CHECK(stack->is_64_bit());
+	BOOST_CHECK_EQUAL(stack->get_match_id(), 42u);
+	BOOST_REQUIRE_EQUAL(stack->size(), 3u);
+	BOOST_CHECK_EQUAL((*stack)[0], 0x100u);
+	BOOST_CHECK_EQUAL((*stack)[2], 0x300u);
+	BOOST_CHECK_EQUAL(*data.get_terminal_session_id(), 3u);
+	BOOST_CHECK_EQUAL(*data.get_process_start_key(), 777u);
+	BOOST_CHECK_EQUAL(data.get_related_activity_id()->Data1, 1u);
+	BOOST_CHECK(!data.get_event_key());
+	BOOST_CHECK(!data.get_user_sid());
+}
+
+BOOST_AUTO_TEST_CASE(reads_32_bit_stacks)
+{
+	std::uint64_t match_id = 7;
+	std::uint32_t frames[] = { 0x10, 0x20 };
+	std::vector<std::uint8_t> stack(sizeof(match_id) + sizeof(frames));
+	std::memcpy(stack.data(), &match_id, sizeof(match_id));
+	std::memcpy(stack.data() + sizeof(match_id), frames, sizeof(frames));
+
+	extended_data_fixture fixture;
+	fixture.add(EVENT_HEADER_EXT_TYPE_STACK_TRACE32, stack);
+	auto trace = event_extended_data(fixture.record).get_stack_trace();
+	BOOST_REQUIRE(trace);
+	BOOST_CHECK(!trace->is_64_bit());
+	BOOST_REQUIRE_EQUAL(trace->size(), 2u);
+	BOOST_CHECK_EQUAL((*trace)[1], 0x20u);
+}
+
+BOOST_AUTO_TEST_CASE(reports_truncated_items_as_missing)
+{
+	extended_data_fixture fixture;
+	fixture.add(EVENT_HEADER_EXT_TYPE_TS_ID, { 1, 2 });
+	fixture.add(EVENT_HEADER_EXT_TYPE_STACK_TRACE64, { 1, 2, 3 });
+	std::vector<std::uint8_t> sid(8);
+	sid[1] = 2;
+	fixture.add(EVENT_HEADER_EXT_TYPE_SID, sid);
+
+	event_extended_data data(fixture.record);
+	BOOST_CHECK(!data.get_terminal_session_id());
+	BOOST_CHECK(!data.get_stack_trace());
+	BOOST_CHECK(!data.get_user_sid());
+
+	extended_data_fixture complete;
+	sid.resize(16);
+	complete.add(EVENT_HEADER_EXT_TYPE_SID, sid);
+	BOOST_CHECK(event_extended_data(complete.record).get_user_sid());
+}
+
+BOOST_AUTO_TEST_CASE(handles_events_without_extended_data)
+{
+	EVENT_RECORD record{};
+	event_extended_data data(record);
+	BOOST_CHECK(data.empty());
+	BOOST_CHECK(!data.find(EVENT_HEADER_EXT_TYPE_STACK_TRACE64));
+	BOOST_CHECK(!data.get_stack_trace());
+}
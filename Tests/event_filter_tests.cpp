@@ -0,0 +1,137 @@
+#define BOOST_TEST_MODULE event_filter
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/event_filter.h"
+#include "event_tracing/event_trace_error.h"
+
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+
+namespace
+{
+EVENT_RECORD make_record(ULONG process_id, UCHAR level, USHORT id, ULONGLONG keyword = 0)
+{
+	EVENT_RECORD record{};
+	record.EventHeader.ProcessId = process_id;
+	record.EventHeader.ThreadId = process_id + 1u;
+	record.EventHeader.EventDescriptor.Level = level;
+	record.EventHeader.EventDescriptor.Id = id;
+	record.EventHeader.EventDescriptor.Keyword = keyword;
+	return record;
+}
+
+bool matches(const wchar_t* expression, EVENT_RECORD record)
+{
+	return event_filter(expression).matches(&record);
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(matches_header_predicates)
+{
+	auto record = make_record(1234, 4, 7, 0x30);
+	BOOST_CHECK(matches(L"pid == 1234", record));
+	BOOST_CHECK(!matches(L"pid != 1234", record));
+	BOOST_CHECK(matches(L"pid in (4, 1234) and level <= 4", record));
+	BOOST_CHECK(!matches(L"pid in (4, 5)", record));
+	BOOST_CHECK(matches(L"keyword has 0x10 && id >= 7", record));
+	BOOST_CHECK(!matches(L"keyword has 0x40", record));
+	BOOST_CHECK(matches(L"not (level > 4) or id == 1", record));
+	BOOST_CHECK(matches(L"!(tid == 1)", record));
+	BOOST_CHECK(matches(L"provider == {00000000-0000-0000-0000-000000000000}", record));
+}
+
+BOOST_AUTO_TEST_CASE(rejects_invalid_expressions)
+{
+	for (auto expression : { L"pid ==", L"foo == 1", L"$X < \"a\"", L"(pid == 1", L"pid == 1 extra",
+		L"provider == {bad}", L"pid contains 1" })
+	{
+		BOOST_CHECK_THROW(event_filter filter(expression), event_trace_error);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(rejects_numbers_out_of_range)
+{
+	for (auto expression : { L"pid == 0x10000000000000000", L"pid == 18446744073709551616",
+		L"$X == -9223372036854775809", L"$X == -0x8000000000000001", L"pid == -1", L"keyword has -1",
+		L"id in (1, -2)" })
+	{
+		BOOST_CHECK_THROW(event_filter filter(expression), event_trace_error);
+	}
+
+	for (auto expression : { L"$X == 18446744073709551615", L"$X == 0xFFFFFFFFFFFFFFFF",
+		L"$X == -9223372036854775808", L"$X > -0" })
+	{
+		BOOST_CHECK_NO_THROW(event_filter filter(expression));
+	}
+
+	auto record = make_record(1, 4, 7, ~0ull);
+	BOOST_CHECK(matches(L"keyword == 0xFFFFFFFFFFFFFFFF", record));
+	BOOST_CHECK(matches(L"keyword == 18446744073709551615", record));
+	BOOST_CHECK(!matches(L"keyword < 0xFFFFFFFFFFFFFFFF", record));
+}
+
+#ifdef WINDOWS_STUBS
+BOOST_AUTO_TEST_CASE(decides_on_headers_without_decoding)
+{
+	auto record = make_record(4, 2, 1);
+	windows_stubs::reset_tdh_call_count();
+	BOOST_CHECK(matches(L"pid == 4 or $ImageName ends_with \".exe\"", record));
+	BOOST_CHECK(!matches(L"$ExitCode == 1 and level > 3", record));
+	BOOST_CHECK(!matches(L"($A == 1 or $B == 2) and not (pid == 4)", record));
+	BOOST_CHECK(matches(L"$A == 1 or ($B == 2 or id == 1)", record));
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 0u);
+
+	event_filter filter(L"pid == 5 or $ImageName ends_with \".exe\"");
+	BOOST_CHECK(filter.match_header(record) == event_filter::header_match::maybe);
+	BOOST_CHECK(!filter.matches(&record));
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 1u);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(undecodable_properties_do_not_match)
+{
+	auto record = make_record(4, 2, 1);
+	BOOST_CHECK(!matches(L"$A == 1", record));
+	BOOST_CHECK(!matches(L"$A != 1", record));
+	BOOST_CHECK(matches(L"not $A == 1", record));
+	BOOST_CHECK(matches(L"$A == 1 or level == 2", record));
+	BOOST_CHECK(!matches(L"level == 2 and $A == 1", record));
+}
+
+BOOST_AUTO_TEST_CASE(batches_match_single_events)
+{
+	std::vector<EVENT_RECORD> records;
+	std::mt19937 random(3);
+	for (int i = 0; i != 2000; ++i)
+	{
+		records.push_back(make_record(random() % 50, static_cast<UCHAR>(random() % 6),
+			static_cast<USHORT>(random() % 7), 1ull << (random() % 8)));
+	}
+
+	std::vector<PEVENT_RECORD> pointers;
+	for (auto& record : records)
+		pointers.push_back(&record);
+
+	for (auto expression : { L"pid in (4, 12) and level <= 4", L"not (keyword has 0x10) && id == 3",
+		L"pid == 4 or $ImageName ends_with \".exe\"", L"level >= 2 and ($ExitCode == -1 or id < 3)",
+		L"!(pid < 10) or not (level == 1 and id != 2)" })
+	{
+		event_filter filter(expression);
+		std::unique_ptr<bool[]> results(new bool[pointers.size()]);
+		filter.matches(pointers.data(), pointers.size(), results.get());
+		for (std::size_t i = 0; i != pointers.size(); ++i)
+			BOOST_CHECK_EQUAL(results[i], filter.matches(pointers[i]));
+	}
+}
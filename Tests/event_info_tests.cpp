@@ -0,0 +1,157 @@
+#define BOOST_TEST_MODULE event_info
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_trace_error.h"
+
+#include "test_events.h"
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+
+namespace
+{
+EVENT_RECORD make_record(ULONG process_id, USHORT id, std::int64_t timestamp)
+{
+	EVENT_RECORD record{};
+	record.EventHeader.ProcessId = process_id;
+	record.EventHeader.ThreadId = process_id + 1u;
+	record.EventHeader.EventDescriptor.Id = id;
+	record.EventHeader.TimeStamp.QuadPart = timestamp;
+	record.EventHeader.ProviderId.Data1 = 0x1234;
+	return record;
+}
+
+//Count, Values[Count], Name, Items[Count]{ Id, Parts[2] }, Header{ Major, Minor }, Tail
+std::shared_ptr<const event_schema> make_mixed_schema()
+{
+	using namespace test_events;
+	return make_schema({ make_property(L"Count", TDH_INTYPE_UINT32), make_array(L"Values", TDH_INTYPE_UINT16, 0),
+		make_property(L"Name", TDH_INTYPE_UNICODESTRING), make_struct_array(L"Items", 6, 2, 0),
+		make_struct(L"Header", 8, 2), make_property(L"Tail", TDH_INTYPE_UINT64),
+		make_property(L"Id", TDH_INTYPE_UINT32), make_array(L"Parts", TDH_INTYPE_UINT8, 2, true),
+		make_property(L"Major", TDH_INTYPE_UINT16), make_property(L"Minor", TDH_INTYPE_UINT16) }, 6);
+}
+
+std::vector<std::uint8_t> make_mixed_payload()
+{
+	test_events::payload_builder payload;
+	payload.add<std::uint32_t>(2).add<std::uint16_t>(10).add<std::uint16_t>(20).add_string(L"app.exe")
+		.add<std::uint32_t>(100).add<std::uint8_t>(1).add<std::uint8_t>(2)
+		.add<std::uint32_t>(200).add<std::uint8_t>(3).add<std::uint8_t>(4)
+		.add<std::uint16_t>(5).add<std::uint16_t>(6).add<std::uint64_t>(0x1122334455667788ull);
+	return payload.get_data();
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(reads_header_fields_from_record)
+{
+	auto record = make_record(42, 7, 123456789);
+	event_info info(&record);
+	BOOST_CHECK_EQUAL(info.get_process_id(), 42u);
+	BOOST_CHECK_EQUAL(info.get_thread_id(), 43u);
+	BOOST_CHECK_EQUAL(info.get_event_id(), 7u);
+	BOOST_CHECK_EQUAL(info.get_timestamp(), 123456789);
+	BOOST_CHECK_EQUAL(info.get_provider_id().Data1, 0x1234u);
+	BOOST_CHECK(!info.is_schema_loaded());
+}
+
+#ifdef WINDOWS_STUBS
+BOOST_AUTO_TEST_CASE(loads_schema_on_first_property_access)
+{
+	auto record = make_record(42, 7, 1);
+	windows_stubs::reset_tdh_call_count();
+	event_info info(&record);
+	info.get_process_id();
+	info.get_event_descriptor();
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 0u);
+
+	//The stubs know no schemas, a failed lookup is reported and not repeated
+	BOOST_CHECK_THROW(info.get_top_level_property_count(), event_trace_error);
+	auto result = info.try_find_property_index(L"ProcessID");
+	BOOST_REQUIRE(!result);
+	BOOST_CHECK(result.get_error() == decode_error::schema_not_found);
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 1u);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(reads_properties_from_cached_schema)
+{
+	auto payload = make_mixed_payload();
+	auto record = test_events::make_record(payload, 1);
+	event_schema_cache cache;
+	cache.add(record.EventHeader.ProviderId, record.EventHeader.EventDescriptor, make_mixed_schema());
+#ifdef WINDOWS_STUBS
+	windows_stubs::reset_tdh_call_count();
+#endif
+
+	event_info info(&record, cache);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint32_t>(L"Count"), 2u);
+	BOOST_CHECK_EQUAL(info.get_array_property_size(1), 2u);
+	BOOST_CHECK_EQUAL(info.get_array_property_value<std::uint16_t>(1, 0), 10u);
+	BOOST_CHECK_EQUAL(info.get_array_property_value<std::uint16_t>(1, 1), 20u);
+	BOOST_CHECK(info.get_plain_property_value<std::wstring>(L"Name") == L"app.exe");
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint64_t>(L"Tail"), 0x1122334455667788ull);
+
+	auto property = info.get_plain_property_value(2);
+	BOOST_CHECK(property.get_name() == L"Name");
+	BOOST_CHECK_EQUAL(property.get_in_type(), TDH_INTYPE_UNICODESTRING);
+
+	auto items = info.get_structure(3);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint32_t>(items, 0, 0), 100u);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint32_t>(items, 1, 0), 200u);
+	BOOST_CHECK_EQUAL(info.get_array_property_value<std::uint8_t>(items, 0, 1, 1), 2u);
+	BOOST_CHECK_EQUAL(info.get_array_property_value<std::uint8_t>(items, 1, 1, 0), 3u);
+
+	auto header = info.get_structure(4);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint16_t>(header, 0), 5u);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint16_t>(header, 1), 6u);
+
+#ifdef WINDOWS_STUBS
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 0u);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(reports_cached_schema_decoding_failures)
+{
+	auto payload = make_mixed_payload();
+	auto record = test_events::make_record(payload, 1);
+	event_schema_cache cache;
+	cache.add(record.EventHeader.ProviderId, record.EventHeader.EventDescriptor, make_mixed_schema());
+	event_info info(&record, cache);
+
+	auto check_error = [](const decode_result<event_property>& result, decode_error error)
+	{
+		BOOST_REQUIRE(!result);
+		BOOST_CHECK(result.get_error() == error);
+	};
+
+	check_error(info.try_get_plain_property_value(1), decode_error::single_value_expected);
+	check_error(info.try_get_array_property_value(1, 2), decode_error::index_out_of_bounds);
+	check_error(info.try_get_plain_property_value(3), decode_error::plain_value_expected);
+	check_error(info.try_get_plain_property_value(6), decode_error::index_out_of_bounds);
+
+	auto items = info.get_structure(3);
+	check_error(info.try_get_plain_property_value(items, 0), decode_error::single_value_expected);
+	check_error(info.try_get_plain_property_value(items, 0, 1), decode_error::single_value_member_expected);
+	check_error(info.try_get_plain_property_value(items, 2, 0), decode_error::index_out_of_bounds);
+	check_error(info.try_get_array_property_value(items, 0, 1, 2), decode_error::index_out_of_bounds);
+	check_error(info.try_get_plain_property_value(items, 0, 2), decode_error::index_out_of_bounds);
+
+	//The tail is cut off
+	payload.resize(payload.size() - 4);
+	record = test_events::make_record(payload, 1);
+	event_info truncated(&record, cache);
+	BOOST_CHECK_EQUAL(truncated.get_plain_property_value<std::uint32_t>(L"Count"), 2u);
+	check_error(truncated.try_get_plain_property_value(5), decode_error::payload_truncated);
+}
@@ -0,0 +1,151 @@
+#define BOOST_TEST_MODULE event_map
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_map.h"
+#include "event_tracing/event_visitor.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+//Map buffer in the TdhGetEventMapInformation layout
+std::vector<std::uint8_t> make_map_data(MAP_FLAGS flag, const std::vector<event_value_map::entry>& entries)
+{
+	std::vector<std::uint8_t> data(offsetof(EVENT_MAP_INFO, MapEntryArray) + entries.size() * sizeof(EVENT_MAP_ENTRY));
+	std::vector<ULONG> offsets;
+	for (const auto& value : entries)
+	{
+		offsets.push_back(static_cast<ULONG>(data.size()));
+		auto size = (value.second.size() + 1) * sizeof(wchar_t);
+		data.resize(data.size() + size);
+		std::memcpy(data.data() + offsets.back(), value.second.c_str(), size);
+	}
+
+	auto info = reinterpret_cast<EVENT_MAP_INFO*>(data.data());
+	info->Flag = flag;
+	info->EntryCount = static_cast<ULONG>(entries.size());
+	info->MapEntryValueType = EVENTMAP_ENTRY_VALUETYPE_ULONG;
+	for (std::size_t i = 0; i != entries.size(); ++i)
+	{
+		info->MapEntryArray[i].Value = entries[i].first;
+		info->MapEntryArray[i].OutputOffset = offsets[i];
+	}
+
+	return data;
+}
+
+std::shared_ptr<const event_value_map> compile(const std::vector<std::uint8_t>& data)
+{
+	auto result = event_value_map::compile(reinterpret_cast<const EVENT_MAP_INFO*>(data.data()), data.size());
+	BOOST_REQUIRE(result);
+	return *result;
+}
+
+bool has_name(const event_value_map& map, std::uint32_t value, const wchar_t* name)
+{
+	auto found = map.find(value);
+	return found && !std::wcscmp(found, name);
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(looks_up_dense_value_maps)
+{
+	event_value_map map({ { 0, L"Zero " }, { 1, L"One" }, { 5, L"Five" }, { 1, L"Duplicate" } }, false);
+	BOOST_CHECK(!map.is_bitmap());
+	BOOST_CHECK(has_name(map, 0, L"Zero"));
+	BOOST_CHECK(has_name(map, 1, L"One"));
+	BOOST_CHECK(!map.find(2));
+	BOOST_CHECK(!map.find(6));
+	BOOST_CHECK(!map.find(0xffffffffu));
+	BOOST_CHECK(map.format(5) == L"Five");
+	BOOST_CHECK(map.format(7) == L"7");
+}
+
+BOOST_AUTO_TEST_CASE(looks_up_sparse_value_maps)
+{
+	event_value_map map({ { 10, L"Ten" }, { 100000, L"Big" }, { 0xffffffffu, L"Max" } }, false);
+	BOOST_CHECK(has_name(map, 100000, L"Big"));
+	BOOST_CHECK(has_name(map, 0xffffffffu, L"Max"));
+	BOOST_CHECK(!map.find(11));
+}
+
+BOOST_AUTO_TEST_CASE(decomposes_bitmaps)
+{
+	event_value_map map({ { 0, L"None" }, { 1, L"Read" }, { 2, L"Write" }, { 4, L"Execute" },
+		{ 6, L"WriteExecute" } }, true);
+	BOOST_CHECK(map.is_bitmap());
+	BOOST_CHECK(!map.find(1));
+	BOOST_CHECK(map.format(0) == L"None");
+	BOOST_CHECK(map.format(1) == L"Read");
+	BOOST_CHECK(map.format(3) == L"Read|Write");
+	BOOST_CHECK(map.format(7) == L"WriteExecute|Read");
+	BOOST_CHECK(map.format(0x11) == L"Read|0x10");
+	BOOST_CHECK(map.format(0x30) == L"0x30");
+}
+
+BOOST_AUTO_TEST_CASE(compiles_tdh_map_layout)
+{
+	auto manifest = compile(make_map_data(EVENTMAP_INFO_FLAG_MANIFEST_BITMAP, { { 1, L"Read " }, { 2, L"Write " } }));
+	BOOST_CHECK(manifest->is_bitmap());
+	BOOST_CHECK(manifest->format(3) == L"Read|Write");
+
+	//MOF bitmaps hold bit numbers instead of masks
+	auto wbem = compile(make_map_data(EVENTMAP_INFO_FLAG_WBEM_BITMAP, { { 0, L"A" }, { 3, L"D" } }));
+	BOOST_CHECK(wbem->format(9) == L"A|D");
+
+	auto value_map = compile(make_map_data(EVENTMAP_INFO_FLAG_MANIFEST_VALUEMAP, { { 2, L"Two" } }));
+	BOOST_CHECK(has_name(*value_map, 2, L"Two"));
+
+	auto data = make_map_data(EVENTMAP_INFO_FLAG_MANIFEST_BITMAP, { { 1, L"Read " }, { 2, L"Write " } });
+	auto truncated = event_value_map::compile(reinterpret_cast<const EVENT_MAP_INFO*>(data.data()), 20);
+	BOOST_REQUIRE(!truncated);
+	BOOST_CHECK(truncated.get_error() == decode_error::invalid_schema);
+}
+
+BOOST_AUTO_TEST_CASE(prints_and_converts_mapped_properties)
+{
+	auto access = compile(make_map_data(EVENTMAP_INFO_FLAG_MANIFEST_BITMAP, { { 1, L"Read " }, { 2, L"Write " } }));
+	auto schema = std::make_shared<event_schema>(make_schema_data({
+		make_property(L"Access", TDH_INTYPE_UINT32, 0, L"AccessMap"), make_property(L"Plain", TDH_INTYPE_UINT32) }, 2),
+		std::vector<std::shared_ptr<const event_value_map>>{ access, nullptr });
+
+	payload_builder payload;
+	payload.add<std::uint32_t>(3).add<std::uint32_t>(3);
+	auto record = make_record(payload.get_data(), 1);
+	event_schema_cache cache;
+	cache.add(record.EventHeader.ProviderId, record.EventHeader.EventDescriptor, schema);
+
+	std::wostringstream stream;
+	stream << event_info(&record, cache);
+	BOOST_CHECK(stream.str().find(L"Access = 3 (Read|Write)") != std::wstring::npos);
+	BOOST_CHECK(stream.str().find(L"Plain = 3\n") != std::wstring::npos);
+
+	class name_visitor : public event_visitor
+	{
+	public:
+		void value(const event_property_view& prop) override
+		{
+			auto name = event_property_converter<event_type_map_name>::try_convert(prop);
+			names += name ? *name : L"<none>";
+			names += L";";
+		}
+
+		std::wstring names;
+	} visitor;
+
+	BOOST_REQUIRE(visit_event(event_info(&record, cache), visitor));
+	BOOST_CHECK(visitor.names == L"Read|Write;<none>;");
+}
@@ -0,0 +1,74 @@
+#define BOOST_TEST_MODULE event_message
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include "event_tracing/event_message.h"
+#include "event_tracing/event_schema.h"
+
+#include "test_events.h"
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+//Literals in brackets, inserts as {argument}, control characters as letters
+std::wstring describe(const wchar_t* message)
+{
+	event_message_template value(message);
+	std::wstring result;
+	for (const auto& token : value.get_tokens())
+	{
+		if (token.argument != event_message_template::no_argument)
+		{
+			result += L"{" + std::to_wstring(token.argument) + L"}";
+			continue;
+		}
+
+		result += L"[";
+		for (auto symbol : std::wstring(value.get_literal(token), token.length))
+			result += symbol == L'\r' ? L'R' : symbol == L'\n' ? L'N' : symbol == L'\t' ? L'T' : symbol;
+		result += L"]";
+	}
+
+	return result + L" n=" + std::to_wstring(value.get_argument_count());
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(splits_template_into_tokens)
+{
+	BOOST_CHECK(describe(L"a %% b") == L"[a % b] n=0");
+	BOOST_CHECK(describe(L"x%ny%tz") == L"[xRNyTz] n=0");
+	BOOST_CHECK(describe(L"v=%1!x!.") == L"[v=]{0}[.] n=1");
+	BOOST_CHECK(describe(L"%10 and %2%0 tail") == L"{9}[ and ]{1} n=10");
+	BOOST_CHECK(describe(L"end %0") == L"[end ] n=0");
+	BOOST_CHECK(describe(L"%1%2") == L"{0}{1} n=2");
+	BOOST_CHECK(describe(L"100%") == L"[100%] n=0");
+	BOOST_CHECK(event_message_template(L"").empty());
+}
+
+BOOST_AUTO_TEST_CASE(renders_message_with_property_values)
+{
+	auto schema = make_schema({ make_property(L"ProcessID", TDH_INTYPE_UINT32),
+		make_property(L"ImageName", TDH_INTYPE_UNICODESTRING), make_array(L"Values", TDH_INTYPE_UINT16, 3, true) }, 3,
+		L"Process %1 (%2) values %3.%n");
+
+	payload_builder payload;
+	payload.add<std::uint32_t>(1234).add_string(L"app.exe")
+		.add<std::uint16_t>(1).add<std::uint16_t>(2).add<std::uint16_t>(3);
+	auto record = make_record(payload.get_data(), 1);
+
+	event_message_renderer renderer;
+	std::wstring text = L"> ";
+	auto appended = renderer.render(*schema, record, text);
+	BOOST_REQUIRE(appended);
+	BOOST_CHECK(text == L"> Process 1234 (app.exe) values 1, 2, 3.\r\n");
+	BOOST_CHECK_EQUAL(*appended, text.size() - 2);
+
+	payload.get_data().resize(6);
+	record = make_record(payload.get_data(), 1);
+	text.clear();
+	BOOST_CHECK(!renderer.render(*schema, record, text));
+}
@@ -0,0 +1,82 @@
+#define BOOST_TEST_MODULE event_property
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <tdh.h>
+
+#include "event_tracing/event_property.h"
+#include "event_tracing/event_trace_error.h"
+
+using namespace event_tracing;
+
+namespace
+{
+template<typename T>
+event_property make_property(std::uint16_t in_type, T value)
+{
+	std::vector<std::uint8_t> raw(sizeof(value));
+	std::memcpy(raw.data(), &value, sizeof(value));
+	return event_property(in_type, 0, true, std::move(raw), L"Value");
+}
+
+event_property make_string_property(const std::wstring& value)
+{
+	std::vector<std::uint8_t> raw((value.size() + 1) * sizeof(wchar_t));
+	std::memcpy(raw.data(), value.c_str(), raw.size());
+	return event_property(TDH_INTYPE_UNICODESTRING, 0, true, std::move(raw), L"Value");
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(converts_matching_types)
+{
+	auto value = event_property_converter<std::uint32_t>::try_convert(
+		make_property<std::uint32_t>(TDH_INTYPE_UINT32, 1234));
+	BOOST_REQUIRE(value);
+	BOOST_CHECK_EQUAL(*value, 1234u);
+	BOOST_CHECK_EQUAL(event_property_converter<std::int64_t>::convert(
+		make_property<std::int64_t>(TDH_INTYPE_INT64, -5)), -5);
+	BOOST_CHECK(event_property_converter<std::wstring>::convert(make_string_property(L"app.exe")) == L"app.exe");
+}
+
+BOOST_AUTO_TEST_CASE(reports_mismatches_without_throwing)
+{
+	auto wrong_type = event_property_converter<std::uint32_t>::try_convert(make_string_property(L"1"));
+	BOOST_REQUIRE(!wrong_type);
+	BOOST_CHECK(wrong_type.get_error() == decode_error::incorrect_property_type);
+	BOOST_CHECK_EQUAL(wrong_type.value_or(7u), 7u);
+
+	auto wrong_size = event_property_converter<std::uint32_t>::try_convert(
+		make_property<std::uint16_t>(TDH_INTYPE_UINT32, 1));
+	BOOST_REQUIRE(!wrong_size);
+	BOOST_CHECK(wrong_size.get_error() == decode_error::invalid_value_size);
+}
+
+BOOST_AUTO_TEST_CASE(throwing_accessors_keep_error_text)
+{
+	try
+	{
+		event_property_converter<std::uint32_t>::convert(make_string_property(L"1"));
+		BOOST_ERROR("No exception thrown");
+	}
+	catch (const event_trace_error& e)
+	{
+		BOOST_CHECK_EQUAL(std::string(e.what()),
+			get_decode_error_text(decode_error::incorrect_property_type));
+	}
+
+	decode_result<int> result(decode_failure{ decode_error::property_read_failed, 87u });
+	try
+	{
+		result.value();
+		BOOST_ERROR("No exception thrown");
+	}
+	catch (const event_trace_error& e)
+	{
+		BOOST_CHECK_EQUAL(e.get_error_code(), 87u);
+	}
+}
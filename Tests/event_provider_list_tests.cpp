@@ -0,0 +1,21 @@
+#define BOOST_TEST_MODULE event_provider_list
+#include <boost/test/unit_test.hpp>
+
+#include "event_tracing/event_provider_list.h"
+#include "event_tracing/event_source_guid.h"
+#include "event_tracing/event_trace_error.h"
+
+using namespace event_tracing;
+
+BOOST_AUTO_TEST_CASE(unknown_provider_names_are_errors)
+{
+	event_provider_list providers;
+	BOOST_CHECK(!providers.has_name(L"Microsoft-Windows-Kernel-Proces"));
+	BOOST_CHECK_THROW(providers.get_guid(L"Microsoft-Windows-Kernel-Proces"), event_trace_error);
+}
+
+BOOST_AUTO_TEST_CASE(event_source_guids_are_derived_explicitly)
+{
+	BOOST_CHECK(event_provider_list::get_event_source_guid(L"Microsoft-Extensions-Logging")
+		== ms_guid(L"{3AC73B97-AF73-50E9-0822-5DA4367920D0}"));
+}
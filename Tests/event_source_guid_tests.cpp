@@ -0,0 +1,41 @@
+#define BOOST_TEST_MODULE event_source_guid
+#include <boost/test/unit_test.hpp>
+
+#include "event_tracing/event_source_guid.h"
+
+using namespace event_tracing;
+
+BOOST_AUTO_TEST_CASE(derives_known_provider_guids)
+{
+	BOOST_CHECK(ms_guid(make_event_source_guid(L"Microsoft-Extensions-Logging"))
+		== ms_guid(L"{3AC73B97-AF73-50E9-0822-5DA4367920D0}"));
+	BOOST_CHECK(ms_guid(make_event_source_guid(L"Microsoft-Diagnostics-DiagnosticSource"))
+		== ms_guid(L"{ADB401E1-5296-51F8-C125-5FDA75826144}"));
+	BOOST_CHECK(ms_guid(make_event_source_guid(L"Microsoft-AspNetCore-Hosting"))
+		== ms_guid(L"{9E620D2A-55D4-5ADE-DEB7-C26046D245A8}"));
+	BOOST_CHECK(ms_guid(make_event_source_guid(L"System.Runtime"))
+		== ms_guid(L"{49592C0F-5A05-516D-AA4B-A64E02026C89}"));
+}
+
+BOOST_AUTO_TEST_CASE(derives_guids_in_constant_expressions)
+{
+	constexpr ms_guid guid(make_event_source_guid(L"Microsoft-Extensions-Logging"));
+	static_assert(guid.native().Data1 == 0x3AC73B97u, "Derived GUID differs");
+	static_assert(make_event_source_guid(L"microsoft-aspnetcore-hosting").Data1 == 0x9E620D2Au,
+		"Derivation is not case insensitive");
+}
+
+BOOST_AUTO_TEST_CASE(runtime_derivation_matches_compile_time_one)
+{
+	BOOST_CHECK(get_event_source_guid(L"microsoft-extensions-logging")
+		== ms_guid(make_event_source_guid(L"Microsoft-Extensions-Logging")));
+	BOOST_CHECK(get_event_source_guid(L"System.Runtime") == ms_guid(make_event_source_guid(L"SYSTEM.RUNTIME")));
+	BOOST_CHECK(get_event_source_guid(L"") == ms_guid(make_event_source_guid(L"")));
+	BOOST_CHECK(get_event_source_guid(L"System.Runtime") != get_event_source_guid(L"System.Runtime2"));
+}
+
+BOOST_AUTO_TEST_CASE(derives_version_5_guids)
+{
+	auto guid = make_event_source_guid(L"Microsoft-Windows-Example");
+	BOOST_CHECK_EQUAL(guid.Data3 >> 12, 5);
+}
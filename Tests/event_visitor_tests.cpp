@@ -0,0 +1,133 @@
+#define BOOST_TEST_MODULE event_visitor
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_visitor.h"
+
+#include "test_events.h"
+
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+using namespace test_events;
+
+namespace
+{
+class recording_visitor : public event_visitor
+{
+public:
+	void begin_struct(const wchar_t* name) override
+	{
+		calls.push_back(L"struct " + std::wstring(name));
+	}
+
+	void end_struct() override
+	{
+		calls.push_back(L"end struct");
+	}
+
+	void begin_array(const wchar_t* name, ULONG size) override
+	{
+		calls.push_back(L"array " + std::wstring(name) + L" " + std::to_wstring(size));
+	}
+
+	void end_array() override
+	{
+		calls.push_back(L"end array");
+	}
+
+	void value(const event_property_view& prop) override
+	{
+		auto call = std::wstring(prop.get_name()) + L"=";
+		prop.try_append_value(call).value();
+		calls.push_back(call);
+	}
+
+	std::vector<std::wstring> calls;
+};
+
+//Count, then Count items of { UINT64 Id, string Name, UINT16 Flags[2] }
+std::shared_ptr<const event_schema> make_items_schema()
+{
+	return make_schema({ make_property(L"Count", TDH_INTYPE_UINT32), make_struct_array(L"Items", 2, 3, 0),
+		make_property(L"Id", TDH_INTYPE_UINT64), make_property(L"Name", TDH_INTYPE_UNICODESTRING),
+		make_array(L"Flags", TDH_INTYPE_UINT16, 2, true) }, 2);
+}
+
+payload_builder make_items_payload(std::uint32_t count)
+{
+	payload_builder payload;
+	payload.add(count);
+	for (std::uint32_t i = 0; i != count; ++i)
+	{
+		payload.add<std::uint64_t>(10 + i).add_string(L"item" + std::to_wstring(i))
+			.add<std::uint16_t>(1).add<std::uint16_t>(2);
+	}
+
+	return payload;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(visits_payload_in_schema_order)
+{
+	auto payload = make_items_payload(2);
+	auto record = make_record(payload.get_data(), 5);
+	recording_visitor visitor;
+	auto visited = visit_event(*make_items_schema(), record, visitor);
+	BOOST_REQUIRE(visited);
+	BOOST_CHECK_EQUAL(*visited, payload.get_data().size());
+
+	std::vector<std::wstring> expected{ L"Count=2", L"array Items 2",
+		L"struct Items", L"Id=10", L"Name=item0", L"array Flags 2", L"Flags=1", L"Flags=2", L"end array", L"end struct",
+		L"struct Items", L"Id=11", L"Name=item1", L"array Flags 2", L"Flags=1", L"Flags=2", L"end array", L"end struct",
+		L"end array" };
+	BOOST_CHECK(visitor.calls == expected);
+}
+
+BOOST_AUTO_TEST_CASE(stops_after_top_level_property_limit)
+{
+	auto payload = make_items_payload(3);
+	auto record = make_record(payload.get_data(), 5);
+	recording_visitor visitor;
+	BOOST_REQUIRE(visit_event(*make_items_schema(), record, visitor, 1));
+	BOOST_CHECK(visitor.calls == std::vector<std::wstring>({ L"Count=3" }));
+}
+
+BOOST_AUTO_TEST_CASE(reports_truncated_payload)
+{
+	auto payload = make_items_payload(2);
+	payload.get_data().resize(payload.get_data().size() - 3);
+	auto record = make_record(payload.get_data(), 5);
+	recording_visitor visitor;
+	auto visited = visit_event(*make_items_schema(), record, visitor);
+	BOOST_REQUIRE(!visited);
+	BOOST_CHECK(visited.get_error() == decode_error::payload_truncated);
+}
+
+BOOST_AUTO_TEST_CASE(prints_cached_schema_without_tdh)
+{
+	auto payload = make_items_payload(1);
+	auto record = make_record(payload.get_data(), 5);
+	event_schema_cache cache;
+	cache.add(record.EventHeader.ProviderId, record.EventHeader.EventDescriptor, make_items_schema());
+
+#ifdef WINDOWS_STUBS
+	windows_stubs::reset_tdh_call_count();
+#endif
+	std::wostringstream stream;
+	stream << event_info(&record, cache);
+	auto text = stream.str();
+	BOOST_CHECK(text.find(L"Count = 1") != std::wstring::npos);
+	BOOST_CHECK(text.find(L"Name = item0") != std::wstring::npos);
+	BOOST_CHECK(text.find(L"Flags = 2") != std::wstring::npos);
+#ifdef WINDOWS_STUBS
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 0u);
+#endif
+}
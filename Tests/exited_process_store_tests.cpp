@@ -0,0 +1,152 @@
+#define BOOST_TEST_MODULE exited_process_store
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "exited_process_store.h"
+
+namespace
+{
+using timestamp_type = exited_process_store::timestamp_type;
+
+constexpr const timestamp_type second = 10000000;
+constexpr const std::size_t large_budget = 1024u * 1024 * 1024;
+
+process make_process(std::uint32_t pid, timestamp_type start_time, const std::wstring& name = L"app.exe")
+{
+	return process(L"C:\\Program Files\\" + name, pid, start_time, 0, 1);
+}
+
+std::vector<std::uint32_t> get_pids(const std::vector<const exited_process_store::exited_process*>& records)
+{
+	std::vector<std::uint32_t> result;
+	for (auto value : records)
+		result.push_back(value->value.get_pid());
+
+	return result;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(keeps_ended_threads_and_modules_of_exited_process)
+{
+	exited_process_store store(large_budget, 3600 * second, 4);
+	auto value = make_process(8, 10);
+	auto key = value.get_key();
+	for (std::uint32_t tid = 0; tid != 6; ++tid)
+		store.add_ended_thread(key, process_thread(8, tid, 0, 0, 0));
+	store.add_ended_module(key, process_module(8, 0x400000, L"app.exe"));
+	store.add(std::move(value), boost::none, 3, 20);
+
+	auto found = store.find(key);
+	BOOST_REQUIRE(found);
+	BOOST_CHECK_EQUAL(found->exit_code, 3u);
+	BOOST_CHECK_EQUAL(found->value.get_threads().size(), 4u);
+	BOOST_CHECK_EQUAL(found->value.get_modules().size(), 1u);
+}
+
+//Stop events reordered by priority or replayed from a checkpoint arrive out of exit order
+BOOST_AUTO_TEST_CASE(orders_late_records_by_exit_time)
+{
+	exited_process_store store(large_budget, 3600 * second, 4);
+	auto parent = make_process(4, 0).get_key();
+	store.add(make_process(8, 1), parent, 0, 30 * second);
+	store.add(make_process(12, 1), parent, 0, 10 * second);
+	store.add(make_process(16, 1), parent, 0, 40 * second);
+	store.add(make_process(20, 1), parent, 0, 20 * second);
+
+	std::vector<const exited_process_store::exited_process*> result;
+	store.find_by_image_name(L"APP.EXE", result);
+	BOOST_CHECK(get_pids(result) == std::vector<std::uint32_t>({ 12, 20, 8, 16 }));
+	store.find_by_parent(parent, result);
+	BOOST_CHECK(get_pids(result) == std::vector<std::uint32_t>({ 12, 20, 8, 16 }));
+}
+
+BOOST_AUTO_TEST_CASE(evicts_by_exit_time)
+{
+	exited_process_store store(large_budget, 100 * second, 4);
+	store.add(make_process(8, 1), boost::none, 0, 50 * second);
+	//Exited earlier but stopped later, it is evicted first however
+	store.add(make_process(12, 1), boost::none, 0, 5 * second);
+	store.add(make_process(16, 1), boost::none, 0, 60 * second);
+	store.add(make_process(20, 1), boost::none, 0, 120 * second);
+
+	BOOST_CHECK(!store.find({ 12, 1 }));
+	BOOST_CHECK(store.find({ 8, 1 }));
+	BOOST_CHECK(store.find({ 16, 1 }));
+
+	store.add(make_process(24, 1), boost::none, 0, 155 * second);
+	BOOST_CHECK(!store.find({ 8, 1 }));
+	BOOST_CHECK(store.find({ 16, 1 }));
+
+	std::vector<const exited_process_store::exited_process*> result;
+	store.find_by_image_name(L"app.exe", result);
+	BOOST_CHECK(get_pids(result) == std::vector<std::uint32_t>({ 16, 20, 24 }));
+}
+
+//Running processes which never exit must not grow the store past its budget
+BOOST_AUTO_TEST_CASE(bounds_ended_items_of_running_processes)
+{
+	const std::size_t budget = 1024u * 1024;
+	exited_process_store store(budget, 3600 * second, 64);
+	for (std::uint32_t pid = 4; pid != 4 + 100000 * 4; pid += 4)
+	{
+		process_key owner{ pid, 1 };
+		store.add_ended_thread(owner, process_thread(pid, pid + 1, 0, 0, 0));
+		store.add_ended_module(owner, process_module(pid, 0x400000, L"module.dll"));
+		BOOST_REQUIRE_LE(store.get_memory_usage(), budget);
+	}
+
+	//The ones which ended something most recently are kept
+	auto value = make_process(4 + 99999 * 4, 1);
+	store.add(std::move(value), boost::none, 0, 10);
+	auto found = store.find({ 4 + 99999 * 4, 1 });
+	BOOST_REQUIRE(found);
+	BOOST_CHECK_EQUAL(found->value.get_threads().size(), 1u);
+
+	store.add(make_process(4, 1), boost::none, 0, 10);
+	found = store.find({ 4, 1 });
+	BOOST_REQUIRE(found);
+	BOOST_CHECK(found->value.get_threads().empty());
+}
+
+BOOST_AUTO_TEST_CASE(stays_within_budget_under_process_churn)
+{
+	const std::size_t budget = 8u * 1024 * 1024;
+	exited_process_store store(budget, 3600 * second, 64);
+	std::vector<process_key> parents;
+	std::vector<const exited_process_store::exited_process*> result;
+	timestamp_type time = 1000 * second;
+	for (std::uint32_t i = 0; i != 1000000; ++i)
+	{
+		time += 100;
+		auto pid = (i * 4) % 65536;
+		auto value = make_process(pid, time, L"fork" + std::to_wstring(i % 3) + L".exe");
+		auto key = value.get_key();
+		for (std::uint32_t tid = 0; tid != 3; ++tid)
+			store.add_ended_thread(key, process_thread(pid, i * 4 + tid, 0, 0, 0));
+		store.add_ended_module(key, process_module(pid, 0x400000, L"fork.exe"));
+
+		boost::optional<process_key> parent;
+		if (!parents.empty())
+			parent = parents[i % parents.size()];
+
+		//Every tenth stop event is delayed behind the next one
+		store.add(std::move(value), parent, i, i % 10 ? time + 50 : time - 150);
+		if (parents.size() < 16)
+			parents.push_back(key);
+
+		BOOST_REQUIRE_LE(store.get_memory_usage(), budget);
+	}
+
+	auto found = store.find({ (999999u * 4) % 65536, time });
+	BOOST_REQUIRE(found);
+	BOOST_CHECK_EQUAL(found->value.get_threads().size(), 3u);
+	BOOST_CHECK_EQUAL(found->exit_code, 999999u);
+
+	store.find_by_image_name(L"fork0.exe", result);
+	BOOST_CHECK(!result.empty());
+	for (std::size_t i = 1; i < result.size(); ++i)
+		BOOST_CHECK_LE(result[i - 1]->exit_time, result[i]->exit_time);
+}
@@ -0,0 +1,150 @@
+#define BOOST_TEST_MODULE forward_queue
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/forward_queue.h"
+
+using namespace event_tracing;
+
+namespace
+{
+const char* const spill_file_name = "forward_queue_tests.spill";
+
+struct spill_file_fixture
+{
+	spill_file_fixture()
+	{
+		std::remove(spill_file_name);
+	}
+
+	~spill_file_fixture()
+	{
+		std::remove(spill_file_name);
+	}
+};
+
+std::vector<std::uint8_t> make_batch(std::uint64_t sequence, std::size_t size)
+{
+	std::vector<std::uint8_t> result(size);
+	for (std::size_t i = 0; i != size; ++i)
+		result[i] = static_cast<std::uint8_t>(sequence * 31 + i);
+
+	return result;
+}
+
+//Checks that the queue holds the batches of the sequence numbers in order
+void check_batches(forward_queue& queue, std::uint64_t first, std::uint64_t last, std::size_t size)
+{
+	BOOST_REQUIRE_EQUAL(queue.size(), last - first + 1u);
+	std::vector<std::uint8_t> batch;
+	for (auto sequence = first; sequence <= last; ++sequence)
+	{
+		BOOST_REQUIRE(queue.get(static_cast<std::size_t>(sequence - first), batch));
+		BOOST_REQUIRE(batch == make_batch(sequence, size));
+	}
+
+	BOOST_CHECK(!queue.get(queue.size(), batch));
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(keeps_batches_in_memory_until_acknowledged)
+{
+	forward_queue queue(1000, std::string(), 0);
+	for (std::uint64_t sequence = 1; sequence != 6; ++sequence)
+		BOOST_CHECK(queue.push(sequence, make_batch(sequence, 100)));
+
+	BOOST_CHECK_EQUAL(queue.get_memory_size(), 500u);
+	check_batches(queue, 1, 5, 100);
+
+	BOOST_CHECK_EQUAL(queue.acknowledge(3), 3u);
+	BOOST_CHECK_EQUAL(queue.acknowledge(3), 0u);
+	BOOST_CHECK_EQUAL(queue.get_memory_size(), 200u);
+	check_batches(queue, 4, 5, 100);
+}
+
+BOOST_AUTO_TEST_CASE(drops_batches_beyond_memory_without_spill_file)
+{
+	forward_queue queue(250, std::string(), 0);
+	BOOST_CHECK(queue.push(1, make_batch(1, 100)));
+	BOOST_CHECK(queue.push(2, make_batch(2, 100)));
+	BOOST_CHECK(!queue.push(3, make_batch(3, 100)));
+	BOOST_CHECK_EQUAL(queue.size(), 2u);
+}
+
+BOOST_FIXTURE_TEST_CASE(spills_in_order_until_drained, spill_file_fixture)
+{
+	forward_queue queue(250, spill_file_name, 10000);
+	for (std::uint64_t sequence = 1; sequence != 6; ++sequence)
+		BOOST_CHECK(queue.push(sequence, make_batch(sequence, 100)));
+
+	BOOST_CHECK_EQUAL(queue.get_memory_size(), 200u);
+	BOOST_CHECK_EQUAL(queue.get_spill_size(), 300u);
+	check_batches(queue, 1, 5, 100);
+
+	//Memory is free again, but later batches follow the spilled ones
+	queue.acknowledge(2);
+	BOOST_CHECK(queue.push(6, make_batch(6, 100)));
+	BOOST_CHECK_EQUAL(queue.get_memory_size(), 0u);
+	BOOST_CHECK_EQUAL(queue.get_spill_size(), 400u);
+	check_batches(queue, 3, 6, 100);
+
+	queue.acknowledge(6);
+	BOOST_CHECK_EQUAL(queue.get_spill_size(), 0u);
+	BOOST_CHECK(queue.push(7, make_batch(7, 100)));
+	BOOST_CHECK_EQUAL(queue.get_memory_size(), 100u);
+}
+
+BOOST_FIXTURE_TEST_CASE(wraps_around_spill_file, spill_file_fixture)
+{
+	//Batch size is not a divisor of the file size, so batches are split at its end
+	forward_queue queue(0, spill_file_name, 1000);
+	std::uint64_t acknowledged = 0;
+	for (std::uint64_t sequence = 1; sequence != 200; ++sequence)
+	{
+		BOOST_REQUIRE(queue.push(sequence, make_batch(sequence, 300)));
+		if (queue.size() == 3)
+		{
+			check_batches(queue, acknowledged + 1, sequence, 300);
+			acknowledged += 2;
+			queue.acknowledge(acknowledged);
+		}
+	}
+
+	BOOST_CHECK_LE(queue.get_spill_size(), 1000u);
+	std::ifstream file(spill_file_name, std::ios::binary | std::ios::ate);
+	BOOST_CHECK_EQUAL(static_cast<std::uint64_t>(file.tellg()), 1000u);
+}
+
+BOOST_FIXTURE_TEST_CASE(drops_batches_beyond_both_limits, spill_file_fixture)
+{
+	forward_queue queue(100, spill_file_name, 250);
+	BOOST_CHECK(queue.push(1, make_batch(1, 100)));
+	BOOST_CHECK(queue.push(2, make_batch(2, 100)));
+	BOOST_CHECK(queue.push(3, make_batch(3, 100)));
+	BOOST_CHECK(!queue.push(4, make_batch(4, 100)));
+	check_batches(queue, 1, 3, 100);
+
+	queue.acknowledge(2);
+	BOOST_CHECK(queue.push(5, make_batch(5, 100)));
+	BOOST_CHECK_EQUAL(queue.size(), 2u);
+}
+
+BOOST_FIXTURE_TEST_CASE(empties_spill_file_on_creation, spill_file_fixture)
+{
+	{
+		std::ofstream file(spill_file_name, std::ios::binary);
+		file << "left by a previous run";
+	}
+
+	forward_queue queue(0, spill_file_name, 1000);
+	BOOST_CHECK_EQUAL(queue.size(), 0u);
+	std::ifstream file(spill_file_name, std::ios::binary | std::ios::ate);
+	BOOST_CHECK_EQUAL(static_cast<std::uint64_t>(file.tellg()), 0u);
+
+	BOOST_CHECK_THROW(forward_queue(0, spill_file_name, 0), event_trace_error);
+}
@@ -0,0 +1,430 @@
+#define BOOST_TEST_MODULE forwarding_protocol
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include <boost/asio.hpp>
+
+#include "event_tracing/event_collector.h"
+#include "event_tracing/event_forwarder.h"
+#include "event_tracing/event_record_copy.h"
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/forwarding_protocol.h"
+
+#include "test_events.h"
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+
+namespace
+{
+forward_frame_header read_header(const std::vector<std::uint8_t>& frame)
+{
+	forward_frame_header header;
+	std::memcpy(&header, frame.data(), sizeof(header));
+	return header;
+}
+
+std::vector<std::uint8_t> get_payload(const std::vector<std::uint8_t>& frame)
+{
+	auto header = read_header(frame);
+	BOOST_REQUIRE(is_valid_forward_frame(header));
+	BOOST_REQUIRE_EQUAL(frame.size(), sizeof(header) + header.size);
+	std::vector<std::uint8_t> payload;
+	get_forward_frame_payload(header, frame.data() + sizeof(header), payload);
+	return payload;
+}
+
+//Records of 7 event kinds, each with user data derived from its index
+void make_record(std::uint32_t index, EVENT_RECORD& record, std::uint8_t* user_data)
+{
+	record = EVENT_RECORD{};
+	record.EventHeader.ProcessId = index;
+	record.EventHeader.TimeStamp.QuadPart = 1000 + index;
+	record.EventHeader.EventDescriptor.Id = static_cast<USHORT>(index % 7);
+	record.EventHeader.ProviderId.Data1 = 0x1234;
+	record.UserDataLength = static_cast<USHORT>(index % 120);
+	for (USHORT i = 0; i != record.UserDataLength; ++i)
+		user_data[i] = static_cast<std::uint8_t>((index >> (i % 3)) + i);
+
+	record.UserData = user_data;
+}
+
+//Marks the records received by one collector
+class record_sink
+{
+public:
+	explicit record_sink(std::uint32_t record_count)
+		: received_(record_count)
+	{
+	}
+
+	void operator()(const std::string& host_id, PEVENT_RECORD record, event_schema_cache& schemas)
+	{
+		std::uint8_t user_data[256];
+		EVENT_RECORD expected;
+		auto index = record->EventHeader.ProcessId;
+		make_record(index, expected, user_data);
+		auto schema = schemas.get(record);
+		auto is_valid = host_id == "host" && index < received_.size()
+			&& !std::memcmp(&expected.EventHeader, &record->EventHeader, sizeof(EVENT_HEADER))
+			&& expected.UserDataLength == record->UserDataLength
+			&& !std::memcmp(expected.UserData, record->UserData, expected.UserDataLength)
+			&& schema && (*schema)->get_info()->PropertyCount == 2;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!is_valid)
+		{
+			++invalid_count_;
+			return;
+		}
+
+		duplicate_count_ += received_[index];
+		received_[index] = true;
+	}
+
+	bool is_received(std::uint32_t index) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return received_[index];
+	}
+
+	std::size_t get_invalid_count() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return invalid_count_;
+	}
+
+	std::size_t get_duplicate_count() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return duplicate_count_;
+	}
+
+private:
+	mutable std::mutex mutex_;
+	std::vector<bool> received_;
+	std::size_t invalid_count_ = 0;
+	std::size_t duplicate_count_ = 0;
+};
+
+//TdhGetEventInformation returns the schema while the fixture exists, so the
+//forwarder reads it there and the collector can only know it from batches
+struct forwarded_schema_fixture
+{
+	forwarded_schema_fixture()
+	{
+#ifdef WINDOWS_STUBS
+		windows_stubs::set_event_information(test_events::make_schema_data({
+			test_events::make_property(L"Count", TDH_INTYPE_UINT32),
+			test_events::make_property(L"Name", TDH_INTYPE_UNICODESTRING) }, 2));
+#endif
+		std::remove(spill_file_name);
+	}
+
+	~forwarded_schema_fixture()
+	{
+		clear_schema();
+		std::remove(spill_file_name);
+	}
+
+	static void clear_schema()
+	{
+#ifdef WINDOWS_STUBS
+		windows_stubs::set_event_information({});
+#endif
+	}
+
+	static constexpr const char* spill_file_name = "forwarding_protocol_tests.spill";
+};
+
+constexpr const char* forwarded_schema_fixture::spill_file_name;
+
+void forward_records(event_forwarder& forwarder, std::uint32_t first, std::uint32_t last)
+{
+	std::uint8_t user_data[256];
+	for (auto index = first; index != last; ++index)
+	{
+		EVENT_RECORD record;
+		make_record(index, record, user_data);
+		forwarder.forward(&record);
+	}
+}
+
+template<typename Condition>
+bool wait_for(Condition condition)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+	while (!condition())
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	return true;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(compresses_frames_when_smaller)
+{
+	std::vector<std::uint8_t> payload(10000);
+	for (std::size_t i = 0; i != payload.size(); ++i)
+		payload[i] = static_cast<std::uint8_t>(i % 10);
+
+	std::vector<std::uint8_t> frame;
+	append_forward_frame(frame, forward_frame_type::batch, 7, payload.data(), payload.size(), true);
+	auto header = read_header(frame);
+	BOOST_CHECK_EQUAL(header.type, static_cast<std::uint8_t>(forward_frame_type::batch));
+	BOOST_CHECK_EQUAL(header.sequence, 7u);
+	BOOST_CHECK(header.flags & forward_frame_compressed);
+	BOOST_CHECK_LT(header.size, payload.size());
+	BOOST_CHECK_EQUAL(header.raw_size, payload.size());
+	BOOST_CHECK(get_payload(frame) == payload);
+
+	//Random data does not compress
+	std::mt19937 random(3);
+	for (auto& value : payload)
+		value = static_cast<std::uint8_t>(random());
+
+	frame.clear();
+	append_forward_frame(frame, forward_frame_type::batch, 8, payload.data(), payload.size(), true);
+	BOOST_CHECK(!(read_header(frame).flags & forward_frame_compressed));
+	BOOST_CHECK(get_payload(frame) == payload);
+
+	frame.clear();
+	append_forward_frame(frame, forward_frame_type::ack, 9, nullptr, 0, true);
+	BOOST_CHECK_EQUAL(frame.size(), sizeof(forward_frame_header));
+	BOOST_CHECK(get_payload(frame).empty());
+}
+
+BOOST_AUTO_TEST_CASE(rejects_invalid_frames)
+{
+	std::vector<std::uint8_t> payload(1000, 5);
+	std::vector<std::uint8_t> frame;
+	append_forward_frame(frame, forward_frame_type::hello, 0, payload.data(), payload.size(), false);
+	auto header = read_header(frame);
+	BOOST_CHECK(is_valid_forward_frame(header));
+
+	auto invalid = header;
+	invalid.magic = 0;
+	BOOST_CHECK(!is_valid_forward_frame(invalid));
+	invalid = header;
+	invalid.type = 4;
+	BOOST_CHECK(!is_valid_forward_frame(invalid));
+	invalid = header;
+	invalid.raw_size = header.size + 1;
+	BOOST_CHECK(!is_valid_forward_frame(invalid));
+	invalid = header;
+	invalid.size = invalid.raw_size = static_cast<std::uint32_t>(max_forward_frame_size + 1);
+	BOOST_CHECK(!is_valid_forward_frame(invalid));
+
+	frame.clear();
+	append_forward_frame(frame, forward_frame_type::batch, 1, payload.data(), payload.size(), true);
+	header = read_header(frame);
+	BOOST_REQUIRE(header.flags & forward_frame_compressed);
+	frame[sizeof(header)] ^= 0xff;
+	std::vector<std::uint8_t> decompressed;
+	BOOST_CHECK_THROW(get_forward_frame_payload(header, frame.data() + sizeof(header), decompressed),
+		event_trace_error);
+
+	//The decompressed size must match the header
+	frame.clear();
+	append_forward_frame(frame, forward_frame_type::batch, 1, payload.data(), payload.size(), true);
+	header = read_header(frame);
+	header.raw_size -= 1;
+	BOOST_CHECK_THROW(get_forward_frame_payload(header, frame.data() + sizeof(header), decompressed),
+		event_trace_error);
+}
+
+BOOST_AUTO_TEST_CASE(appends_entry_headers)
+{
+	std::vector<std::uint8_t> batch{ 1 };
+	append_forward_entry(batch, forward_entry_type::record, 0x01020304);
+	BOOST_CHECK((batch == std::vector<std::uint8_t>{ 1, 2, 4, 3, 2, 1 }));
+}
+
+//A batch with an invalid entry after a valid record is rejected as a whole
+//and not acknowledged, so when it is resent the record is handled once
+BOOST_AUTO_TEST_CASE(rejects_whole_batch_with_invalid_entry)
+{
+	event_collector collector("127.0.0.1", 0, [](const std::string&, PEVENT_RECORD, event_schema_cache&) {});
+	collector.run_async();
+
+	std::uint8_t user_data[256];
+	EVENT_RECORD record;
+	make_record(1, record, user_data);
+	std::vector<std::uint8_t> batch;
+	auto size = event_record_copy::get_serialized_size(record);
+	append_forward_entry(batch, forward_entry_type::record, size);
+	batch.resize(batch.size() + size);
+	event_record_copy::serialize(record, batch.data() + batch.size() - size);
+	auto invalid_batch = batch;
+	append_forward_entry(invalid_batch, forward_entry_type::record, 3);
+	invalid_batch.insert(invalid_batch.end(), 3, 0);
+
+	//Returns whether the batch is acknowledged
+	auto send = [&collector](const std::vector<std::uint8_t>& payload)
+	{
+		const std::string host_id = "host";
+		std::vector<std::uint8_t> frames;
+		append_forward_frame(frames, forward_frame_type::hello, 5,
+			reinterpret_cast<const std::uint8_t*>(host_id.data()), host_id.size(), false);
+		append_forward_frame(frames, forward_frame_type::batch, 1, payload.data(), payload.size(), true);
+
+		boost::asio::io_context io_context;
+		boost::asio::ip::tcp::socket socket(io_context);
+		socket.connect({ boost::asio::ip::make_address("127.0.0.1"), collector.get_port() });
+		boost::asio::write(socket, boost::asio::buffer(frames));
+		forward_frame_header ack{};
+		boost::system::error_code error;
+		for (int i = 0; i != 2 && !error; ++i)
+			boost::asio::read(socket, boost::asio::buffer(&ack, sizeof(ack)), error);
+
+		return !error && ack.sequence == 1u;
+	};
+
+	BOOST_CHECK(!send(invalid_batch));
+	BOOST_CHECK_EQUAL(collector.get_received_count(), 0u);
+	BOOST_CHECK(send(batch));
+	BOOST_CHECK_EQUAL(collector.get_received_count(), 1u);
+	BOOST_CHECK(send(batch));
+	collector.stop();
+	BOOST_CHECK_EQUAL(collector.get_received_count(), 1u);
+	BOOST_CHECK_EQUAL(collector.get_duplicate_batch_count(), 1u);
+}
+
+#ifdef WINDOWS_STUBS
+BOOST_FIXTURE_TEST_CASE(forwards_records_with_schemas, forwarded_schema_fixture)
+{
+	const std::uint32_t record_count = 20000;
+	record_sink sink(record_count);
+	event_collector collector("127.0.0.1", 0, std::ref(sink));
+	collector.run_async();
+
+	event_forwarder_options options;
+	options.max_batch_size = 16 * 1024;
+	event_forwarder forwarder("host", "127.0.0.1", collector.get_port(), options);
+	//Batches are sealed with their schemas before they are sent
+	forward_records(forwarder, 0, record_count);
+	forwarder.flush();
+	clear_schema();
+	forwarder.run_async();
+	forwarder.stop(std::chrono::seconds(30));
+	collector.stop();
+
+	BOOST_CHECK_EQUAL(forwarder.get_forwarded_count(), record_count);
+	BOOST_CHECK_EQUAL(forwarder.get_acknowledged_count(), record_count);
+	BOOST_CHECK_EQUAL(forwarder.get_dropped_count(), 0u);
+	BOOST_CHECK_EQUAL(collector.get_received_count(), record_count);
+	BOOST_CHECK_EQUAL(sink.get_invalid_count(), 0u);
+	BOOST_CHECK_EQUAL(sink.get_duplicate_count(), 0u);
+	for (std::uint32_t index = 0; index != record_count; ++index)
+		BOOST_REQUIRE(sink.is_received(index));
+}
+
+//Without a spill file, batches sealed beyond the memory limit before the
+//connection thread runs are dropped, and the rest are delivered
+BOOST_FIXTURE_TEST_CASE(drops_sealed_batches_beyond_memory_limit, forwarded_schema_fixture)
+{
+	const std::uint32_t record_count = 20000;
+	record_sink sink(record_count);
+	event_collector collector("127.0.0.1", 0, std::ref(sink));
+	collector.run_async();
+
+	event_forwarder_options options;
+	options.max_batch_size = 16 * 1024;
+	options.max_memory_size = 64 * 1024;
+	event_forwarder forwarder("host", "127.0.0.1", collector.get_port(), options);
+	forward_records(forwarder, 0, record_count);
+	forwarder.flush();
+	clear_schema();
+	BOOST_CHECK_EQUAL(forwarder.get_queued_batch_count(), 0u);
+	auto dropped_count = forwarder.get_dropped_count();
+	BOOST_CHECK_GT(dropped_count, 0u);
+	BOOST_CHECK_LT(dropped_count, record_count);
+
+	forwarder.run_async();
+	forwarder.stop(std::chrono::seconds(30));
+	collector.stop();
+
+	BOOST_CHECK_EQUAL(forwarder.get_dropped_count(), dropped_count);
+	BOOST_CHECK_EQUAL(forwarder.get_acknowledged_count() + dropped_count, record_count);
+	BOOST_CHECK_EQUAL(collector.get_received_count() + dropped_count, record_count);
+	BOOST_CHECK_EQUAL(sink.get_invalid_count(), 0u);
+	BOOST_CHECK_EQUAL(sink.get_duplicate_count(), 0u);
+}
+
+//The forwarder starts before its collector and spills, then the collector restarts mid-stream
+BOOST_FIXTURE_TEST_CASE(resends_batches_after_reconnection, forwarded_schema_fixture)
+{
+	const std::uint32_t record_count = 40000;
+	unsigned short port = 0;
+	{
+		event_collector unused("127.0.0.1", 0, [](const std::string&, PEVENT_RECORD, event_schema_cache&) {});
+		port = unused.get_port();
+	}
+
+	event_forwarder_options options;
+	options.max_batch_size = 16 * 1024;
+	options.max_memory_size = 64 * 1024;
+	options.spill_file_name = spill_file_name;
+	options.min_reconnect_delay = std::chrono::milliseconds(10);
+	options.max_reconnect_delay = std::chrono::milliseconds(50);
+	event_forwarder forwarder("host", "127.0.0.1", port, options);
+	forward_records(forwarder, 0, record_count / 2);
+	//Schemas of all event kinds are cached by the forwarder by now
+	clear_schema();
+	forwarder.flush();
+	forwarder.run_async();
+	BOOST_REQUIRE(wait_for([&forwarder] { return forwarder.get_queued_batch_count() > 4; }));
+
+	record_sink first_sink(record_count);
+	{
+		event_collector collector("127.0.0.1", port, std::ref(first_sink));
+		collector.run_async();
+		forward_records(forwarder, record_count / 2, record_count * 3 / 4);
+		BOOST_REQUIRE(wait_for([&forwarder, record_count]
+		{
+			return forwarder.get_acknowledged_count() >= record_count / 2;
+		}));
+
+		collector.stop();
+	}
+
+	forward_records(forwarder, record_count * 3 / 4, record_count);
+	record_sink second_sink(record_count);
+	{
+		event_collector collector("127.0.0.1", port, std::ref(second_sink));
+		collector.run_async();
+		forwarder.stop(std::chrono::seconds(30));
+		collector.stop();
+	}
+
+	BOOST_CHECK_EQUAL(forwarder.get_acknowledged_count(), record_count);
+	BOOST_CHECK_EQUAL(forwarder.get_dropped_count(), 0u);
+	BOOST_CHECK_GE(forwarder.get_connection_count(), 2u);
+	BOOST_CHECK_EQUAL(first_sink.get_invalid_count() + second_sink.get_invalid_count(), 0u);
+	//Each collector handles a batch once. Batches the first collector handled
+	//but did not acknowledge before it stopped may be handled by both.
+	BOOST_CHECK_EQUAL(first_sink.get_duplicate_count() + second_sink.get_duplicate_count(), 0u);
+	for (std::uint32_t index = 0; index != record_count; ++index)
+		BOOST_REQUIRE(first_sink.is_received(index) || second_sink.is_received(index));
+}
+#endif
@@ -0,0 +1,223 @@
+#define BOOST_TEST_MODULE loss_tracker
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+
+#include "event_tracing/loss_tracker.h"
+#include "event_tracing/metrics_registry.h"
+
+using namespace event_tracing;
+
+namespace
+{
+const GUID event_trace_guid{ 0x68fdd900, 0x4a3e, 0x11d1, { 0x84, 0xf4, 0x00, 0x00, 0xf8, 0x04, 0x64, 0xe3 } };
+const GUID rt_lost_event_guid{ 0x6a399ae0, 0x4bc6, 0x4de9, { 0x87, 0x0b, 0x36, 0x57, 0xf8, 0x94, 0x7e, 0x7e } };
+const GUID provider_id{ 1, 2, 3, { 4 } };
+
+EVENT_RECORD make_record(const GUID& provider, UCHAR opcode, std::int64_t timestamp,
+	std::vector<std::uint8_t>* payload = nullptr)
+{
+	EVENT_RECORD record{};
+	record.EventHeader.ProviderId = provider;
+	record.EventHeader.EventDescriptor.Opcode = opcode;
+	record.EventHeader.TimeStamp.QuadPart = timestamp;
+	if (payload)
+	{
+		record.UserData = payload->data();
+		record.UserDataLength = static_cast<USHORT>(payload->size());
+	}
+
+	return record;
+}
+
+//TRACE_LOGFILE_HEADER as laid out by a logger of the pointer size
+std::vector<std::uint8_t> make_header(ULONG pointer_size, ULONG events_lost, ULONG buffers_lost)
+{
+	std::vector<std::uint8_t> header(pointer_size == 4u ? 272u : 280u);
+	auto write = [&header](std::size_t offset, ULONG value)
+	{
+		std::memcpy(&header[offset], &value, sizeof(value));
+	};
+
+	write(44, pointer_size);
+	write(48, events_lost);
+	write(pointer_size == 4u ? 268u : 276u, buffers_lost);
+	return header;
+}
+
+//Sequence numbers 0..count-1 shuffled within blocks, without the dropped ones
+std::vector<std::uint64_t> make_stream(std::uint64_t count, std::size_t block_size,
+	const std::vector<bool>& dropped, std::mt19937& random)
+{
+	std::vector<std::uint64_t> sequence;
+	for (std::uint64_t i = 0; i != count; ++i)
+		sequence.push_back(i);
+
+	for (std::size_t i = 0; i + block_size <= sequence.size(); i += block_size)
+		std::shuffle(sequence.begin() + i, sequence.begin() + i + block_size, random);
+
+	std::vector<std::uint64_t> result;
+	for (auto number : sequence)
+	{
+		if (!dropped[number])
+			result.push_back(number);
+	}
+
+	return result;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(counts_gaps_once_reorder_window_passes)
+{
+	loss_tracker tracker(16);
+	for (std::uint64_t sequence : { 1, 2, 3, 7, 8, 9, 10 })
+		tracker.observe_sequence(0, sequence);
+	BOOST_CHECK_EQUAL(tracker.get_totals().get_total().sequence_gap_events, 0u);
+
+	for (std::uint64_t sequence = 11; sequence <= 30; ++sequence)
+		tracker.observe_sequence(0, sequence);
+	BOOST_CHECK_EQUAL(tracker.get_totals().get_total().sequence_gap_events, 3u);
+
+	auto report = tracker.take_report();
+	BOOST_CHECK_EQUAL(report.get_total().sequence_gap_events, 3u);
+	BOOST_CHECK_EQUAL(report.get_total().received, 0u);
+	BOOST_CHECK(report.has_loss());
+	BOOST_CHECK_EQUAL(tracker.take_report().get_total().sequence_gap_events, 0u);
+	BOOST_CHECK_EQUAL(tracker.get_totals().get_total().sequence_gap_events, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(counts_injected_gaps_of_reordered_stream)
+{
+	std::mt19937 random(1);
+	for (int round = 0; round != 10; ++round)
+	{
+		const std::uint64_t count = 10000;
+		std::vector<bool> dropped(count);
+		std::uint64_t dropped_count = 0;
+		for (int i = 0; i != 40; ++i)
+		{
+			auto number = 500u + random() % 9000u;
+			if (!dropped[number])
+			{
+				dropped[number] = true;
+				++dropped_count;
+			}
+		}
+
+		loss_tracker tracker(100);
+		for (auto number : make_stream(count, 50, dropped, random))
+			tracker.observe_sequence(1, number);
+		tracker.flush();
+
+		auto totals = tracker.get_totals();
+		BOOST_REQUIRE_EQUAL(totals.inputs.size(), 2u);
+		BOOST_CHECK_EQUAL(totals.inputs[1].sequence_gap_events, dropped_count);
+		BOOST_CHECK(totals.inputs[1].reordered_events > 0u);
+		BOOST_CHECK_EQUAL(totals.inputs[1].duplicate_events, 0u);
+		BOOST_CHECK_EQUAL(totals.inputs[1].sequence_restarts, 0u);
+		BOOST_CHECK(!totals.inputs[0].has_loss());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(counts_duplicates_and_restarts)
+{
+	loss_tracker tracker(10);
+	for (std::uint64_t sequence : { 100, 101, 102, 101, 102 })
+		tracker.observe_sequence(0, sequence);
+	BOOST_CHECK_EQUAL(tracker.get_totals().inputs[0].duplicate_events, 2u);
+
+	//103 and 104 are pending, then the session restarts
+	tracker.observe_sequence(0, 105);
+	tracker.observe_sequence(0, 1);
+	auto counters = tracker.get_totals().inputs[0];
+	BOOST_CHECK_EQUAL(counters.sequence_restarts, 1u);
+	BOOST_CHECK_EQUAL(counters.sequence_gap_events, 2u);
+
+	tracker.observe_sequence(0, 2);
+	tracker.flush();
+	BOOST_CHECK_EQUAL(tracker.get_totals().inputs[0].sequence_gap_events, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(limits_pending_gaps)
+{
+	loss_tracker tracker(1ull << 40);
+	const auto gap_count = loss_tracker::max_pending_gap_count + 10u;
+	for (std::uint64_t sequence = 0; sequence <= 2u * gap_count; sequence += 2)
+		tracker.observe_sequence(0, sequence);
+	BOOST_CHECK_EQUAL(tracker.get_totals().inputs[0].sequence_gap_events, 10u);
+
+	tracker.flush();
+	BOOST_CHECK_EQUAL(tracker.get_totals().inputs[0].sequence_gap_events, gap_count);
+}
+
+BOOST_AUTO_TEST_CASE(counts_notifications_headers_and_orphans)
+{
+	metrics_registry registry;
+	loss_tracker tracker;
+	tracker.enable_metrics(registry);
+
+	auto record = make_record(provider_id, 1, 500);
+	tracker.observe(0, record);
+	record = make_record(rt_lost_event_guid, 32, 600);
+	tracker.observe(0, record);
+	record = make_record(rt_lost_event_guid, 33, 700);
+	tracker.observe(0, record);
+	record = make_record(rt_lost_event_guid, 34, 800);
+	tracker.observe(1, record);
+
+	//Only the increase of the header totals is counted
+	auto header = make_header(8, 5, 2);
+	record = make_record(event_trace_guid, 0, 400, &header);
+	tracker.observe(1, record);
+	header = make_header(8, 7, 2);
+	record = make_record(event_trace_guid, 0, 900, &header);
+	tracker.observe(1, record);
+	header = make_header(4, 3, 9);
+	record = make_record(event_trace_guid, 0, 950, &header);
+	tracker.observe(2, record);
+	//Too short to be a header
+	std::vector<std::uint8_t> short_header(10);
+	record = make_record(event_trace_guid, 0, 960, &short_header);
+	tracker.observe(2, record);
+
+	record = make_record(provider_id, 3, 1000);
+	tracker.add_orphaned_event(record);
+	tracker.add_orphaned_event(record);
+	tracker.add_lost_events(0, 11);
+
+	auto report = tracker.take_report();
+	BOOST_CHECK_EQUAL(report.begin_timestamp, 400);
+	BOOST_CHECK_EQUAL(report.end_timestamp, 960);
+	BOOST_REQUIRE_EQUAL(report.inputs.size(), 3u);
+	BOOST_CHECK_EQUAL(report.inputs[0].received, 3u);
+	BOOST_CHECK_EQUAL(report.inputs[0].lost_event_notifications, 1u);
+	BOOST_CHECK_EQUAL(report.inputs[0].lost_buffer_notifications, 1u);
+	BOOST_CHECK_EQUAL(report.inputs[0].ring_events_lost, 11u);
+	BOOST_CHECK_EQUAL(report.inputs[1].lost_file_notifications, 1u);
+	BOOST_CHECK_EQUAL(report.inputs[1].header_events_lost, 7u);
+	BOOST_CHECK_EQUAL(report.inputs[1].header_buffers_lost, 2u);
+	BOOST_CHECK_EQUAL(report.inputs[2].header_events_lost, 3u);
+	BOOST_CHECK_EQUAL(report.inputs[2].header_buffers_lost, 9u);
+	BOOST_CHECK_EQUAL(report.providers[provider_id].received, 1u);
+	BOOST_CHECK_EQUAL(report.providers[provider_id].orphaned_events, 2u);
+	BOOST_CHECK_EQUAL(report.get_orphaned_count(), 2u);
+	BOOST_CHECK_EQUAL(report.get_total().get_lost_count(), 7u + 3u + 11u);
+
+	auto next = tracker.take_report();
+	BOOST_CHECK(!next.has_loss());
+	BOOST_CHECK_EQUAL(next.begin_timestamp, 0);
+	BOOST_CHECK_EQUAL(tracker.get_totals().get_orphaned_count(), 2u);
+
+	auto text = registry.get_text();
+	BOOST_CHECK(text.find("etw_orphaned_events_total 2") != std::string::npos);
+	BOOST_CHECK(text.find("etw_header_events_lost_total 10") != std::string::npos);
+	BOOST_CHECK(text.find("etw_lost_notifications_total{kind=\"buffer\"} 1") != std::string::npos);
+}
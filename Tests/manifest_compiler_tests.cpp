@@ -0,0 +1,215 @@
+#define BOOST_TEST_MODULE manifest_compiler
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/manifest_compiler.h"
+#include "event_tracing/schema_pack.h"
+
+#include "test_events.h"
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+
+namespace
+{
+const char* const manifest_file_name = TEST_FIXTURES_DIR "/test_provider.man";
+const char* const pack_file_name = "manifest_compiler_tests.pack";
+
+//{22FB2CD6-0E7B-422B-A0C7-2FAD1FD0E716} of the test provider
+const GUID provider_id = { 0x22FB2CD6, 0x0E7B, 0x422B, { 0xA0, 0xC7, 0x2F, 0xAD, 0x1F, 0xD0, 0xE7, 0x16 } };
+
+struct pack_fixture
+{
+	pack_fixture()
+	{
+		compiler.add_manifest_file(manifest_file_name);
+		compiler.write_schema_pack(pack_file_name);
+		pack = std::make_shared<schema_pack>(pack_file_name);
+		cache.set_schema_pack(pack);
+	}
+
+	~pack_fixture()
+	{
+		pack.reset();
+		std::remove(pack_file_name);
+	}
+
+	manifest_compiler compiler;
+	std::shared_ptr<schema_pack> pack;
+	event_schema_cache cache;
+};
+
+EVENT_DESCRIPTOR make_descriptor(USHORT id, UCHAR version, UCHAR opcode)
+{
+	EVENT_DESCRIPTOR descriptor{};
+	descriptor.Id = id;
+	descriptor.Version = version;
+	descriptor.Opcode = opcode;
+	return descriptor;
+}
+
+EVENT_RECORD make_record(std::vector<std::uint8_t>& payload, USHORT id, UCHAR version, UCHAR opcode)
+{
+	auto record = test_events::make_record(payload, id);
+	record.EventHeader.ProviderId = provider_id;
+	record.EventHeader.EventDescriptor = make_descriptor(id, version, opcode);
+	return record;
+}
+
+std::wstring get_string(const event_schema& schema, ULONG offset)
+{
+	return offset ? schema.get_string(offset) : L"";
+}
+
+std::wstring to_wstring(const event_info& info)
+{
+	std::wostringstream stream;
+	stream << info;
+	return stream.str();
+}
+
+void check_compile_error(const char* manifest)
+{
+	manifest_compiler compiler;
+	std::istringstream stream(manifest);
+	BOOST_CHECK_THROW(compiler.add_manifest(stream), event_trace_error);
+}
+} //namespace
+
+BOOST_FIXTURE_TEST_CASE(compiles_events_and_maps, pack_fixture)
+{
+	BOOST_CHECK_EQUAL(compiler.get_events().size(), 4u);
+	BOOST_CHECK_EQUAL(compiler.get_maps().size(), 2u);
+	BOOST_CHECK_EQUAL(pack->get_event_count(), 4u);
+	BOOST_CHECK_EQUAL(pack->get_map_count(), 2u);
+
+	auto schema = pack->get_schema(provider_id, make_descriptor(1, 2, 1));
+	BOOST_REQUIRE(schema);
+	const auto& start = **schema;
+	auto info = start.get_info();
+	BOOST_CHECK_EQUAL(info->PropertyCount, 6u);
+	BOOST_CHECK_EQUAL(info->TopLevelPropertyCount, 6u);
+	BOOST_CHECK_EQUAL(info->EventDescriptor.Keyword, 0x10u);
+	BOOST_CHECK_EQUAL(info->EventGuid.Data1, 0x9E814AADu);
+	BOOST_CHECK(get_string(start, info->ProviderNameOffset) == L"Kaimi-Test-Process");
+	BOOST_CHECK(get_string(start, info->ProviderMessageOffset) == L"Kaimi test process provider");
+	BOOST_CHECK(get_string(start, info->LevelNameOffset) == L"Information");
+	BOOST_CHECK(get_string(start, info->ChannelNameOffset) == L"Kaimi-Test-Process/Operational");
+	BOOST_CHECK(get_string(start, info->TaskNameOffset) == L"Process start");
+	BOOST_CHECK(get_string(start, info->OpcodeNameOffset) == L"Start");
+	BOOST_CHECK(get_string(start, info->KeywordsNameOffset) == L"Process keyword");
+
+	//Level, opcode and keywords defined by the provider
+	schema = pack->get_schema(provider_id, make_descriptor(3, 0, 10));
+	BOOST_REQUIRE(schema);
+	const auto& image = **schema;
+	info = image.get_info();
+	BOOST_CHECK_EQUAL(info->EventDescriptor.Level, 16u);
+	BOOST_CHECK_EQUAL(info->EventDescriptor.Keyword, 0x50u);
+	BOOST_CHECK(get_string(image, info->LevelNameOffset) == L"Tracing");
+	BOOST_CHECK(get_string(image, info->OpcodeNameOffset) == L"Image load");
+
+	BOOST_CHECK(!pack->get_schema(provider_id, make_descriptor(1, 0, 1)));
+	BOOST_CHECK(pack->get_map(provider_id, L"ExitKind"));
+	BOOST_CHECK(!pack->get_map(provider_id, L"Missing"));
+}
+
+BOOST_FIXTURE_TEST_CASE(decodes_events_from_pack, pack_fixture)
+{
+#ifdef WINDOWS_STUBS
+	windows_stubs::reset_tdh_call_count();
+#endif
+
+	test_events::payload_builder start;
+	start.add<std::uint32_t>(4242).add_string(L"C:\\app.exe").add<std::uint16_t>(2)
+		.add_string(L"-a").add_string(L"--bee").add<std::uint32_t>(0x04030201u)
+		.add<std::uint8_t>(1).add<std::uint8_t>(7);
+	auto record = make_record(start.get_data(), 1, 2, 1);
+	event_info start_info(&record, cache);
+	BOOST_CHECK_EQUAL(start_info.get_plain_property_value<std::uint32_t>(L"ProcessID"), 4242u);
+	BOOST_CHECK(start_info.get_plain_property_value<std::wstring>(L"ImageName") == L"C:\\app.exe");
+	BOOST_CHECK_EQUAL(start_info.get_array_property_size(3), 2u);
+	BOOST_CHECK(start_info.get_array_property_value<std::wstring>(3, 1) == L"--bee");
+	BOOST_CHECK_EQUAL(start_info.get_array_property_value<std::uint8_t>(5, 1), 7u);
+	BOOST_CHECK(to_wstring(start_info).find(L"Process 4242 started from C:\\app.exe with 2 arguments.")
+		!= std::wstring::npos);
+
+	test_events::payload_builder stop;
+	stop.add<std::uint32_t>(4242).add<std::uint32_t>(1).add<std::uint32_t>(2)
+		.add<std::uint64_t>(0x7ff000).add<std::uint16_t>(3).add<char>('a').add<char>('b').add<char>('c')
+		.add<std::uint64_t>(0x7ff800).add<std::uint16_t>(2).add<char>('x').add<char>('y');
+	record = make_record(stop.get_data(), 2, 0, 2);
+	event_info stop_info(&record, cache);
+	//The value map is resolved from the pack
+	BOOST_CHECK(stop_info.get_plain_property_value<event_type_map_name>(1) == L"Crash");
+	auto modules = stop_info.get_structure(3);
+	BOOST_CHECK_EQUAL(stop_info.get_plain_property_value<std::uint16_t>(modules, 1, 1), 2u);
+	BOOST_CHECK(to_wstring(stop_info).find(L"Process 4242 exited: Crash.") != std::wstring::npos);
+
+	std::vector<std::uint8_t> empty;
+	record = make_record(empty, 4, 0, 0);
+	event_info no_template(&record, cache);
+	BOOST_CHECK(std::wcscmp(no_template.get_event_message(), L"Nothing to see") == 0);
+
+#ifdef WINDOWS_STUBS
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 0u);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(rejects_invalid_manifests)
+{
+	check_compile_error("<instrumentationManifest><instrumentation><events>"
+		"<provider name='x' guid='{22FB2CD6-0E7B-422B-A0C7-2FAD1FD0E716}'>"
+		"<events><event value='1' template='Missing'/></events>"
+		"</provider></events></instrumentation></instrumentationManifest>");
+	check_compile_error("<instrumentationManifest><instrumentation><events>"
+		"<provider name='x' guid='{22FB2CD6-0E7B-422B-A0C7-2FAD1FD0E716}'>"
+		"<events><event value='1' message='$(string.Missing)'/></events>"
+		"</provider></events></instrumentation></instrumentationManifest>");
+	check_compile_error("<broken");
+
+	//Events defined twice are detected when the pack is written
+	manifest_compiler compiler;
+	std::istringstream stream("<instrumentationManifest><instrumentation><events>"
+		"<provider name='x' guid='{22FB2CD6-0E7B-422B-A0C7-2FAD1FD0E716}'>"
+		"<events><event value='1'/><event value='1'/></events>"
+		"</provider></events></instrumentation></instrumentationManifest>");
+	compiler.add_manifest(stream);
+	std::ostringstream pack;
+	BOOST_CHECK_THROW(write_schema_pack(compiler.get_events(), compiler.get_maps(), pack), event_trace_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(rejects_invalid_packs, pack_fixture)
+{
+	std::string data;
+	{
+		std::ifstream file(pack_file_name, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	const char* const invalid_file_name = "manifest_compiler_tests.invalid.pack";
+	std::ofstream(invalid_file_name, std::ios::binary) << "not a schema pack";
+	BOOST_CHECK_THROW(schema_pack invalid(invalid_file_name), event_trace_error);
+
+	data.resize(data.size() - 8);
+	std::ofstream(invalid_file_name, std::ios::binary | std::ios::trunc) << data;
+	BOOST_CHECK_THROW(schema_pack truncated(invalid_file_name), event_trace_error);
+	std::remove(invalid_file_name);
+}
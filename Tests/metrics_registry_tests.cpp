@@ -0,0 +1,111 @@
+#define BOOST_TEST_MODULE metrics_registry
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "event_tracing/metrics_endpoint.h"
+#include "event_tracing/metrics_registry.h"
+
+using namespace event_tracing;
+
+namespace
+{
+//Sends a request to the loopback endpoint and returns the whole response
+std::string get(unsigned short port, const std::string& path)
+{
+	boost::asio::io_context context;
+	boost::asio::ip::tcp::socket socket(context);
+	socket.connect({ boost::asio::ip::address_v4::loopback(), port });
+	std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	boost::asio::write(socket, boost::asio::buffer(request));
+
+	std::string response;
+	boost::system::error_code error;
+	boost::asio::read(socket, boost::asio::dynamic_buffer(response), error);
+	BOOST_CHECK(error == boost::asio::error::eof);
+	return response;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(counts_exactly_from_many_threads)
+{
+	metrics_registry registry;
+	auto& counter = registry.add_counter("events_total", "Events");
+	auto& histogram = registry.add_histogram("latency_us", "Latency", { 10, 100 });
+	std::vector<std::thread> threads;
+	//More threads than shards, so some of them share a shard
+	for (std::size_t i = 0; i != metric_shard_count + 8; ++i)
+	{
+		threads.emplace_back([&counter, &histogram]
+		{
+			for (std::uint64_t value = 0; value != 10000; ++value)
+			{
+				counter.increment();
+				histogram.observe(value % 200);
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	const std::uint64_t total = (metric_shard_count + 8) * 10000;
+	BOOST_CHECK_EQUAL(counter.get_value(), total);
+	auto snapshot = histogram.get_snapshot();
+	BOOST_REQUIRE_EQUAL(snapshot.bucket_counts.size(), 3u);
+	BOOST_CHECK_EQUAL(snapshot.bucket_counts[0], total / 200 * 11);
+	BOOST_CHECK_EQUAL(snapshot.bucket_counts[1], total / 200 * 101);
+	BOOST_CHECK_EQUAL(snapshot.bucket_counts[2], total);
+	BOOST_CHECK_EQUAL(snapshot.sum, total / 200 * (199 * 200 / 2));
+}
+
+BOOST_AUTO_TEST_CASE(writes_text_exposition_format)
+{
+	metrics_registry registry;
+	registry.add_histogram("queue_time_us", "Queueing time", { 10, 100 }, "lane=\"high\"").observe(50);
+	registry.add_counter("events_total", "Events").increment(3);
+	registry.add_gauge("depth", "Queue depth").set(-2);
+	registry.add_histogram("queue_time_us", "Queueing time", { 10, 100 }, "lane=\"bulk\"").observe(500);
+
+	BOOST_CHECK_EQUAL(registry.get_text(),
+		"# HELP depth Queue depth\n"
+		"# TYPE depth gauge\n"
+		"depth -2\n"
+		"# HELP events_total Events\n"
+		"# TYPE events_total counter\n"
+		"events_total 3\n"
+		"# HELP queue_time_us Queueing time\n"
+		"# TYPE queue_time_us histogram\n"
+		"queue_time_us_bucket{lane=\"high\",le=\"10\"} 0\n"
+		"queue_time_us_bucket{lane=\"high\",le=\"100\"} 1\n"
+		"queue_time_us_bucket{lane=\"high\",le=\"+Inf\"} 1\n"
+		"queue_time_us_sum{lane=\"high\"} 50\n"
+		"queue_time_us_count{lane=\"high\"} 1\n"
+		"queue_time_us_bucket{lane=\"bulk\",le=\"10\"} 0\n"
+		"queue_time_us_bucket{lane=\"bulk\",le=\"100\"} 0\n"
+		"queue_time_us_bucket{lane=\"bulk\",le=\"+Inf\"} 1\n"
+		"queue_time_us_sum{lane=\"bulk\"} 500\n"
+		"queue_time_us_count{lane=\"bulk\"} 1\n");
+}
+
+BOOST_AUTO_TEST_CASE(serves_metrics_on_loopback)
+{
+	metrics_registry registry;
+	registry.add_counter("events_total", "Events").increment(7);
+	metrics_endpoint endpoint(registry, 0);
+	BOOST_REQUIRE_NE(endpoint.get_port(), 0u);
+	endpoint.run_async();
+
+	auto response = get(endpoint.get_port(), "/metrics");
+	BOOST_CHECK_EQUAL(response.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+	BOOST_CHECK_NE(response.find("\r\n\r\n" + registry.get_text()), std::string::npos);
+
+	response = get(endpoint.get_port(), "/other");
+	BOOST_CHECK_EQUAL(response.compare(0, 24, "HTTP/1.1 404 Not Found\r\n"), 0);
+	endpoint.stop();
+}
@@ -0,0 +1,128 @@
+#define BOOST_TEST_MODULE overload_controller
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "event_tracing/overload_controller.h"
+
+using namespace event_tracing;
+
+namespace
+{
+const std::chrono::nanoseconds no_lag(0);
+
+overload_policy make_policy()
+{
+	overload_policy policy;
+	policy.queue_depth_high = 100;
+	policy.queue_depth_low = 10;
+	policy.lag_high = std::chrono::milliseconds(50);
+	policy.lag_low = std::chrono::milliseconds(10);
+	policy.max_level = 3;
+	policy.level_interval = 4;
+	return policy;
+}
+
+//Observes the load the given number of times and returns the level changes
+std::size_t observe(overload_controller& controller, std::size_t count, std::size_t queue_depth,
+	std::chrono::nanoseconds lag = no_lag)
+{
+	std::size_t changes = 0;
+	for (std::size_t i = 0; i != count; ++i)
+		changes += controller.observe(queue_depth, lag);
+
+	return changes;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(raises_level_on_first_overloaded_event)
+{
+	overload_controller controller(make_policy());
+	BOOST_CHECK_EQUAL(controller.get_level(), 0u);
+	BOOST_CHECK(!controller.observe(50, no_lag));
+	BOOST_CHECK(controller.observe(100, no_lag));
+	BOOST_CHECK_EQUAL(controller.get_level(), 1u);
+	BOOST_CHECK_EQUAL(controller.get_sampling_rate(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(changes_level_at_most_once_per_interval)
+{
+	overload_controller controller(make_policy());
+	BOOST_CHECK_EQUAL(observe(controller, 4, 1000), 1u);
+	BOOST_CHECK_EQUAL(controller.get_level(), 1u);
+	BOOST_CHECK_EQUAL(observe(controller, 100, 1000), 2u);
+	BOOST_CHECK_EQUAL(controller.get_level(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(reacts_to_lag)
+{
+	overload_controller controller(make_policy());
+	BOOST_CHECK(controller.observe(0, std::chrono::milliseconds(50)));
+	BOOST_CHECK_EQUAL(controller.get_level(), 1u);
+
+	//Lag between the marks holds the level
+	BOOST_CHECK_EQUAL(observe(controller, 20, 0, std::chrono::milliseconds(20)), 0u);
+	BOOST_CHECK_EQUAL(observe(controller, 20, 0, std::chrono::milliseconds(10)), 1u);
+	BOOST_CHECK_EQUAL(controller.get_level(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(steps_down_only_below_both_low_marks)
+{
+	overload_controller controller(make_policy());
+	observe(controller, 100, 1000);
+	BOOST_REQUIRE_EQUAL(controller.get_level(), 3u);
+
+	BOOST_CHECK_EQUAL(observe(controller, 20, 50), 0u);
+	BOOST_CHECK_EQUAL(observe(controller, 20, 5, std::chrono::milliseconds(20)), 0u);
+	//The interval has passed, so the first event below the marks steps down
+	BOOST_CHECK_EQUAL(observe(controller, 5, 10), 2u);
+	BOOST_CHECK_EQUAL(controller.get_level(), 1u);
+	BOOST_CHECK_EQUAL(observe(controller, 100, 10), 1u);
+	BOOST_CHECK_EQUAL(controller.get_level(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(samples_every_class_deterministically)
+{
+	overload_controller controller(make_policy());
+	auto first = controller.add_class();
+	auto second = controller.add_class();
+	BOOST_CHECK_EQUAL(controller.get_class_count(), 2u);
+
+	std::vector<bool> admitted;
+	for (int i = 0; i != 4; ++i)
+		admitted.push_back(controller.admit(first));
+
+	BOOST_CHECK((admitted == std::vector<bool>{ true, true, true, true }));
+
+	observe(controller, 9, 1000);
+	BOOST_REQUIRE_EQUAL(controller.get_level(), 3u);
+	admitted.clear();
+	for (int i = 0; i != 20; ++i)
+		admitted.push_back(controller.admit(first));
+
+	//Every 8th event of the class, counted from its first one
+	for (std::size_t i = 0; i != admitted.size(); ++i)
+		BOOST_CHECK_EQUAL(admitted[i], (i + 4) % 8 == 0);
+
+	BOOST_CHECK(controller.admit(second));
+	BOOST_CHECK(!controller.admit(second));
+
+	BOOST_CHECK_EQUAL(controller.get_counters(first).seen, 24u);
+	BOOST_CHECK_EQUAL(controller.get_counters(first).admitted, 6u);
+	BOOST_CHECK_EQUAL(controller.get_counters(second).seen, 2u);
+	BOOST_CHECK_EQUAL(controller.get_counters(second).admitted, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(limits_max_level)
+{
+	auto policy = make_policy();
+	policy.max_level = 100;
+	policy.level_interval = 0;
+	overload_controller controller(policy);
+	observe(controller, 200, 1000);
+	BOOST_CHECK_EQUAL(controller.get_level(), 63u);
+	BOOST_CHECK_EQUAL(controller.get_sampling_rate(), std::uint64_t(1) << 63);
+}
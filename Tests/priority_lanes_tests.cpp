@@ -0,0 +1,123 @@
+#define BOOST_TEST_MODULE priority_lanes
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "event_tracing/priority_lanes.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using lanes = priority_lanes<int>;
+
+void push(lanes& queued, std::size_t lane, std::uint64_t key, int event)
+{
+	queued.get(queued.push(lane, key)) = event;
+}
+
+int pop(lanes& queued)
+{
+	auto slot = queued.pop();
+	auto event = queued.get(slot);
+	queued.release(slot);
+	return event;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(rejects_empty_lanes)
+{
+	BOOST_CHECK_THROW(lanes(0, 4, 2), std::invalid_argument);
+	BOOST_CHECK_THROW(lanes(3, 0, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(releases_higher_lanes_first)
+{
+	lanes queued(3, 4, 100);
+	push(queued, 2, 1, 20);
+	push(queued, 1, 2, 10);
+	push(queued, 0, 3, 0);
+	push(queued, 2, 4, 21);
+
+	BOOST_CHECK_EQUAL(queued.size(), 4u);
+	BOOST_CHECK_EQUAL(queued.size(2), 2u);
+	std::vector<int> released;
+	while (!queued.empty())
+		released.push_back(pop(queued));
+
+	BOOST_CHECK((released == std::vector<int>{ 0, 10, 20, 21 }));
+	BOOST_CHECK_EQUAL(queued.get_aged_count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_push_order_of_same_key)
+{
+	lanes queued(3, 4, 2);
+	push(queued, 2, 1, 10);
+	push(queued, 2, 2, 11);
+	push(queued, 0, 3, 20);
+	push(queued, 0, 1, 21);
+
+	//21 must wait for 10, which has the same key
+	std::vector<int> released;
+	while (!queued.empty())
+		released.push_back(pop(queued));
+
+	BOOST_CHECK((released == std::vector<int>{ 20, 10, 21, 11 }));
+	BOOST_CHECK_EQUAL(queued.get_key_ordered_count(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(ages_bypassed_events)
+{
+	lanes queued(3, 4, 2);
+	push(queued, 2, 9, 1);
+	for (int i = 0; i != 4; ++i)
+		push(queued, 0, 10 + i, 100 + i);
+
+	BOOST_CHECK(queued.full(0));
+	BOOST_CHECK_EQUAL(pop(queued), 100);
+	BOOST_CHECK_EQUAL(pop(queued), 101);
+	BOOST_CHECK_EQUAL(pop(queued), 1);
+	BOOST_CHECK_EQUAL(queued.get_aged_count(), 1u);
+	BOOST_CHECK(!queued.full(0));
+	BOOST_CHECK_EQUAL(queued.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(bounds_bypass_in_random_workload)
+{
+	const std::size_t max_bypass_count = 8;
+	lanes queued(3, 64, max_bypass_count);
+	std::mt19937 random(7);
+	std::map<std::uint64_t, int> last_by_key;
+	std::map<int, std::pair<std::uint64_t, std::size_t>> pushed;
+	std::size_t released_count = 0;
+	int next = 0;
+	for (int round = 0; round != 100000; ++round)
+	{
+		std::size_t lane = random() % 3;
+		if (!queued.full(lane) && random() % 2)
+		{
+			std::uint64_t key = random() % 10;
+			pushed[next] = { key, released_count };
+			push(queued, lane, key, next++);
+		}
+		else if (!queued.empty())
+		{
+			auto event = pop(queued);
+			auto& origin = pushed[event];
+			auto last = last_by_key.find(origin.first);
+			BOOST_REQUIRE(last == last_by_key.end() || last->second < event);
+			last_by_key[origin.first] = event;
+			//Every queued event is released within a bounded number of pops
+			BOOST_REQUIRE_LE(released_count - origin.second, 3 * 64 * (max_bypass_count + 1));
+			pushed.erase(event);
+			++released_count;
+		}
+	}
+
+	BOOST_CHECK_GT(queued.get_aged_count(), 0u);
+}
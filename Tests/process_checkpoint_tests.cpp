@@ -0,0 +1,147 @@
+#define BOOST_TEST_MODULE process_checkpoint
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "process_checkpoint.h"
+
+namespace
+{
+struct journal_counter
+{
+	void process_started(process&& value, const boost::optional<process_key>& parent)
+	{
+		started.push_back(value.get_pid());
+		parents.push_back(parent);
+	}
+
+	void process_stopped(std::uint32_t pid, std::uint32_t exit_code, std::int64_t)
+	{
+		stopped.push_back(pid);
+		exit_codes.push_back(exit_code);
+	}
+
+	void thread_started(process_thread&& value)
+	{
+		threads.push_back(value.get_tid());
+	}
+
+	void thread_stopped(std::uint32_t, std::uint32_t tid)
+	{
+		stopped_threads.push_back(tid);
+	}
+
+	void module_loaded(process_module&& value)
+	{
+		modules.push_back(value.get_image_name());
+	}
+
+	void module_unloaded(std::uint32_t, std::uint64_t image_base)
+	{
+		unloaded_modules.push_back(image_base);
+	}
+
+	void modules_incomplete(std::uint32_t pid)
+	{
+		incomplete.push_back(pid);
+	}
+
+	std::vector<std::uint32_t> started;
+	std::vector<boost::optional<process_key>> parents;
+	std::vector<std::uint32_t> stopped;
+	std::vector<std::uint32_t> exit_codes;
+	std::vector<std::uint32_t> threads;
+	std::vector<std::uint32_t> stopped_threads;
+	std::vector<std::wstring> modules;
+	std::vector<std::uint64_t> unloaded_modules;
+	std::vector<std::uint32_t> incomplete;
+};
+} //namespace
+
+BOOST_AUTO_TEST_CASE(restores_saved_state)
+{
+	std::map<std::uint32_t, process> processes;
+	process_tree tree;
+	for (std::uint32_t pid = 4; pid != 44; pid += 4)
+	{
+		process value(L"C:\\app_" + std::to_wstring(pid) + L".exe", pid, pid * 10, pid - 4u, 1);
+		for (std::uint32_t tid = 0; tid != 3; ++tid)
+			value.add_thread(process_thread(pid, pid * 100 + tid, 0x7ff000 + tid, 0x1000 * tid, 0x2000 * tid));
+		for (std::uint64_t module = 0; module != 4; ++module)
+			value.add_module(process_module(pid, 0x10000 * (module + 1), L"module_" + std::to_wstring(module) + L".dll"));
+
+		boost::optional<process_key> parent;
+		if (pid != 4)
+			parent = process_key{ pid - 4u, (pid - 4) * 10 };
+
+		if (pid % 8u == 0u)
+			value.mark_modules_incomplete();
+
+		tree.add(value.get_key(), parent);
+		processes.emplace(pid, std::move(value));
+	}
+
+	auto data = save_checkpoint(7, processes, tree);
+	std::uint64_t generation = 0;
+	auto restored = load_checkpoint(data.data(), data.size(), generation);
+	BOOST_CHECK_EQUAL(generation, 7u);
+	BOOST_REQUIRE_EQUAL(restored.size(), processes.size());
+	for (const auto& entry : restored)
+	{
+		const auto& original = processes.at(entry.value.get_pid());
+		BOOST_CHECK(entry.value.get_path() == original.get_path());
+		BOOST_CHECK_EQUAL(entry.value.get_start_time(), original.get_start_time());
+		BOOST_CHECK_EQUAL(entry.value.get_threads().size(), 3u);
+		BOOST_CHECK_EQUAL(entry.value.get_modules().size(), 4u);
+		BOOST_CHECK_EQUAL(entry.value.has_incomplete_modules(), original.has_incomplete_modules());
+		BOOST_CHECK(entry.parent == tree.get_parent(original.get_key()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(rejects_damaged_checkpoints)
+{
+	std::map<std::uint32_t, process> processes;
+	processes.emplace(4, process(L"C:\\a.exe", 4, 40, 0, 1));
+	auto data = save_checkpoint(1, processes, process_tree());
+	std::uint64_t generation = 0;
+	for (auto size : { std::size_t(0), std::size_t(3), data.size() - 1u })
+		BOOST_CHECK_THROW(load_checkpoint(data.data(), size, generation), checkpoint_error);
+}
+
+BOOST_AUTO_TEST_CASE(replays_journal_up_to_torn_record)
+{
+	checkpoint_writer journal;
+	write_journal_header(journal, 7);
+	write_process_started(journal, process(L"x.exe", 9, 99, 4, 1), process_key{ 4, 40 });
+	write_thread_started(journal, process_thread(9, 10, 1, 2, 3));
+	write_module_loaded(journal, process_module(9, 0x1000, L"a.dll"));
+	write_module_unloaded(journal, 9, 0x1000);
+	write_modules_incomplete(journal, 9);
+	write_thread_stopped(journal, 9, 10);
+	write_process_stopped(journal, 9, 5, 100);
+
+	auto data = journal.get_data();
+	checkpoint_reader reader(data.data(), data.size());
+	BOOST_CHECK_EQUAL(read_journal_header(reader), 7u);
+	journal_counter complete;
+	replay_journal(reader, complete);
+	BOOST_CHECK((complete.started == std::vector<std::uint32_t>{ 9 }));
+	BOOST_CHECK(complete.parents[0] == (process_key{ 4, 40 }));
+	BOOST_CHECK((complete.threads == std::vector<std::uint32_t>{ 10 }));
+	BOOST_CHECK((complete.modules == std::vector<std::wstring>{ L"a.dll" }));
+	BOOST_CHECK((complete.unloaded_modules == std::vector<std::uint64_t>{ 0x1000 }));
+	BOOST_CHECK((complete.incomplete == std::vector<std::uint32_t>{ 9 }));
+	BOOST_CHECK((complete.stopped_threads == std::vector<std::uint32_t>{ 10 }));
+	BOOST_CHECK((complete.exit_codes == std::vector<std::uint32_t>{ 5 }));
+
+	data.resize(data.size() - 3u);
+	checkpoint_reader torn_reader(data.data(), data.size());
+	read_journal_header(torn_reader);
+	journal_counter torn;
+	replay_journal(torn_reader, torn);
+	BOOST_CHECK_EQUAL(torn.stopped_threads.size(), 1u);
+	BOOST_CHECK(torn.stopped.empty());
+}
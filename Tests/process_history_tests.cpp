@@ -0,0 +1,179 @@
+#define BOOST_TEST_MODULE process_history
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "process_history.h"
+
+namespace
+{
+using entry_type = process_history::entry_type;
+using entry_set = std::set<std::tuple<entry_type, std::uint32_t, std::uint64_t>>;
+
+constexpr const process_history::timestamp_type second = 10000000;
+
+process_key make_key(std::uint32_t pid, std::int64_t start_time)
+{
+	return { pid, start_time };
+}
+
+entry_set get_state(const process_history& history, process_history::timestamp_type time)
+{
+	std::vector<const process_history::entry*> result;
+	BOOST_REQUIRE(history.get_state(time, result));
+
+	entry_set state;
+	for (auto value : result)
+		state.emplace(value->type, value->owner.pid, value->value);
+
+	BOOST_REQUIRE_EQUAL(state.size(), result.size());
+	return state;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(returns_state_at_point_in_time)
+{
+	process_history history(3600 * second, 4);
+	auto key = make_key(8, 10);
+	history.add_process(10, key, boost::none, 1, L"app.exe");
+	history.add_thread(20, key, 100);
+	history.add_module(30, key, 0x400000, L"app.exe");
+	history.remove_thread(40, key, 100);
+
+	BOOST_CHECK(get_state(history, 15) == entry_set({ { entry_type::process, 8, 1 } }));
+	BOOST_CHECK(get_state(history, 35) == entry_set({ { entry_type::process, 8, 1 },
+		{ entry_type::thread, 8, 100 }, { entry_type::module, 8, 0x400000 } }));
+	BOOST_CHECK(get_state(history, 40) == entry_set({ { entry_type::process, 8, 1 },
+		{ entry_type::module, 8, 0x400000 } }));
+
+	std::vector<const process_history::entry*> result;
+	BOOST_REQUIRE(history.get_state(15, 45, result));
+	BOOST_CHECK_EQUAL(result.size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(process_removal_ends_its_threads_and_modules)
+{
+	process_history history(3600 * second, 4);
+	auto key = make_key(8, 10);
+	history.add_process(10, key, boost::none, 1, L"app.exe");
+	history.add_thread(10, key, 100);
+	history.add_module(10, key, 0x400000, L"app.exe");
+	history.add_process(10, make_key(12, 10), key, 1, L"child.exe");
+	history.remove_process(50, key);
+
+	BOOST_CHECK(get_state(history, 50) == entry_set({ { entry_type::process, 12, 1 } }));
+
+	std::vector<const process_history::entry*> result;
+	BOOST_REQUIRE(history.get_state(49, result));
+	for (auto value : result)
+	{
+		if (value->owner.pid == 8)
+			BOOST_CHECK_EQUAL(value->end_time, 50);
+		else
+			BOOST_CHECK(*value->parent == key);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(marks_live_process_modules_incomplete)
+{
+	process_history history(3600 * second, 4);
+	auto key = make_key(8, 10);
+	history.add_process(10, key, boost::none, 1, L"app.exe");
+	history.add_module(20, key, 0x400000, L"app.exe");
+	history.mark_modules_incomplete(key);
+	history.mark_modules_incomplete(make_key(8, 5));
+	history.mark_modules_incomplete(make_key(9, 10));
+
+	std::vector<const process_history::entry*> result;
+	BOOST_REQUIRE(history.get_state(30, result));
+	BOOST_REQUIRE_EQUAL(result.size(), 2u);
+	for (auto value : result)
+		BOOST_CHECK_EQUAL(value->incomplete_modules, value->type == entry_type::process);
+}
+
+BOOST_AUTO_TEST_CASE(drops_history_older_than_retention)
+{
+	process_history history(100 * second, 16);
+	for (std::uint32_t i = 0; i != 1000; ++i)
+	{
+		auto key = make_key(4 + i * 4, i * second);
+		history.add_process(key.start_time, key, boost::none, 1, L"app.exe");
+		history.remove_process(key.start_time + second / 2, key);
+	}
+
+	auto newest = 999 * second;
+	BOOST_CHECK_LE(history.get_oldest_time(), newest - 100 * second);
+	BOOST_CHECK_GE(history.get_oldest_time(), newest - 100 * second - 16 * second);
+	BOOST_CHECK_LT(history.get_entry_count(), 200u);
+
+	std::vector<const process_history::entry*> result;
+	BOOST_CHECK(!history.get_state(10 * second, result));
+	BOOST_CHECK(result.empty());
+	BOOST_CHECK(get_state(history, newest) == entry_set({ { entry_type::process, 4 + 999 * 4, 1 } }));
+}
+
+//Random churn is checked against a brute force replay of the events
+BOOST_AUTO_TEST_CASE(matches_replay_of_random_events)
+{
+	process_history history(1000000 * second, 32);
+	std::mt19937 random(7);
+	std::map<std::uint32_t, process_key> live_processes;
+	std::set<std::pair<std::uint32_t, std::uint32_t>> live_threads;
+	std::vector<std::pair<process_history::timestamp_type, entry_set>> expected;
+	std::uint32_t next_pid = 4;
+	for (process_history::timestamp_type time = 1; time != 5000; ++time)
+	{
+		auto action = random() % 4;
+		if (action == 0 || live_processes.empty())
+		{
+			auto key = make_key(next_pid, time);
+			next_pid += 4;
+			history.add_process(time, key, boost::none, 1, L"app.exe");
+			live_processes.emplace(key.pid, key);
+		}
+		else
+		{
+			auto it = live_processes.begin();
+			std::advance(it, random() % live_processes.size());
+			auto key = (*it).second;
+			auto tid = static_cast<std::uint32_t>(random() % 4);
+			if (action == 1)
+			{
+				history.remove_process(time, key);
+				live_processes.erase(it);
+				for (std::uint32_t thread = 0; thread != 4; ++thread)
+					live_threads.erase({ key.pid, thread });
+			}
+			else if (action == 2)
+			{
+				history.add_thread(time, key, tid);
+				live_threads.insert({ key.pid, tid });
+			}
+			else
+			{
+				history.remove_thread(time, key, tid);
+				live_threads.erase({ key.pid, tid });
+			}
+		}
+
+		if (time % 97 == 0)
+		{
+			entry_set state;
+			for (const auto& pair : live_processes)
+				state.emplace(entry_type::process, pair.first, 1);
+			for (const auto& thread : live_threads)
+				state.emplace(entry_type::thread, thread.first, thread.second);
+
+			expected.emplace_back(time, std::move(state));
+		}
+	}
+
+	for (const auto& pair : expected)
+		BOOST_CHECK(get_state(history, pair.first) == pair.second);
+}
@@ -0,0 +1,144 @@
+#define BOOST_TEST_MODULE process_tree
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "process_tree.h"
+
+namespace
+{
+process_key make_key(std::uint32_t pid, std::int64_t start_time)
+{
+	return { pid, start_time };
+}
+
+bool has_ancestor(const std::map<process_key, boost::optional<process_key>>& parents,
+	process_key key, const process_key& ancestor)
+{
+	for (auto parent = parents.at(key); parent; parent = parents.at(*parent))
+	{
+		if (*parent == ancestor)
+			return true;
+	}
+
+	return false;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(answers_descendant_queries)
+{
+	process_tree tree;
+	tree.add(make_key(1, 0), boost::none);
+	tree.add(make_key(2, 1), make_key(1, 0));
+	tree.add(make_key(3, 2), make_key(2, 1));
+	tree.add(make_key(4, 3), make_key(1, 0));
+
+	BOOST_CHECK(tree.is_descendant(make_key(3, 2), make_key(1, 0)));
+	BOOST_CHECK(tree.is_descendant(make_key(3, 2), make_key(2, 1)));
+	BOOST_CHECK(!tree.is_descendant(make_key(3, 2), make_key(4, 3)));
+	BOOST_CHECK(!tree.is_descendant(make_key(1, 0), make_key(1, 0)));
+	BOOST_CHECK(*tree.get_parent(make_key(4, 3)) == make_key(1, 0));
+	BOOST_CHECK_EQUAL(tree.get_children(make_key(1, 0)).size(), 2u);
+	BOOST_CHECK_EQUAL(tree.get_descendants(make_key(1, 0)).size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(tells_pid_generations_apart)
+{
+	process_tree tree;
+	tree.add(make_key(10, 0), boost::none);
+	tree.add(make_key(11, 1), make_key(10, 0));
+	tree.mark_exited(make_key(11, 1));
+	tree.add(make_key(11, 5), boost::none);
+
+	BOOST_CHECK(!tree.contains(make_key(11, 1)));
+	BOOST_CHECK(tree.contains(make_key(11, 5)));
+	BOOST_CHECK(!tree.is_descendant(make_key(11, 5), make_key(10, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(keeps_exited_ancestors_of_live_processes)
+{
+	process_tree tree;
+	tree.add(make_key(1, 0), boost::none);
+	tree.add(make_key(2, 1), make_key(1, 0));
+	tree.add(make_key(3, 2), make_key(2, 1));
+	tree.mark_exited(make_key(2, 1));
+
+	BOOST_CHECK(tree.contains(make_key(2, 1)));
+	BOOST_CHECK(tree.is_descendant(make_key(3, 2), make_key(1, 0)));
+
+	tree.mark_exited(make_key(3, 2));
+	BOOST_CHECK(!tree.contains(make_key(3, 2)));
+	BOOST_CHECK(!tree.contains(make_key(2, 1)));
+	BOOST_CHECK_EQUAL(tree.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(handles_deep_trees)
+{
+	constexpr const std::uint32_t depth = 200000;
+	process_tree tree;
+	tree.add(make_key(0, 0), boost::none);
+	for (std::uint32_t i = 1; i != depth; ++i)
+		tree.add(make_key(i, i), make_key(i - 1u, i - 1));
+
+	BOOST_CHECK(tree.is_descendant(make_key(depth - 1u, depth - 1), make_key(0, 0)));
+	BOOST_CHECK(!tree.is_descendant(make_key(0, 0), make_key(depth - 1u, depth - 1)));
+	BOOST_CHECK(tree.is_descendant(make_key(depth / 2, depth / 2), make_key(depth / 3, depth / 3)));
+	BOOST_CHECK_EQUAL(tree.get_descendants(make_key(0, 0)).size(), depth - 1u);
+}
+
+BOOST_AUTO_TEST_CASE(handles_wide_trees)
+{
+	constexpr const std::uint32_t width = 1000000;
+	process_tree tree;
+	tree.add(make_key(0, 0), boost::none);
+	for (std::uint32_t i = 1; i != width; ++i)
+		tree.add(make_key(i, i), make_key(0, 0));
+
+	BOOST_CHECK(tree.is_descendant(make_key(5, 5), make_key(0, 0)));
+	BOOST_CHECK(!tree.is_descendant(make_key(5, 5), make_key(6, 6)));
+	BOOST_CHECK_EQUAL(tree.get_children(make_key(0, 0)).size(), width - 1u);
+}
+
+BOOST_AUTO_TEST_CASE(matches_parent_walks_on_random_trees)
+{
+	std::mt19937 random(7);
+	process_tree tree;
+	std::map<process_key, boost::optional<process_key>> parents;
+	std::vector<process_key> live;
+	for (std::int64_t step = 0; step != 100000; ++step)
+	{
+		if (random() % 10 < 6 || live.empty())
+		{
+			auto key = make_key(random() % 500, step);
+			boost::optional<process_key> parent;
+			if (!live.empty() && random() % 5)
+				parent = live[random() % live.size()];
+
+			tree.add(key, parent);
+			parents[key] = parent;
+			live.push_back(key);
+		}
+		else
+		{
+			auto index = random() % live.size();
+			tree.mark_exited(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (step % 50 == 0 && live.size() > 2)
+		{
+			for (int i = 0; i != 20; ++i)
+			{
+				auto descendant = live[random() % live.size()];
+				auto ancestor = live[random() % live.size()];
+				BOOST_CHECK_EQUAL(tree.is_descendant(descendant, ancestor),
+					has_ancestor(parents, descendant, ancestor));
+			}
+		}
+	}
+}
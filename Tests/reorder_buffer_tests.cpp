@@ -0,0 +1,143 @@
+#define BOOST_TEST_MODULE reorder_buffer
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "event_tracing/reorder_buffer.h"
+
+#include "test_clock.h"
+
+using namespace event_tracing;
+
+test_clock::time_point test_clock::current;
+
+namespace
+{
+using buffer = reorder_buffer<std::int64_t, test_clock>;
+const test_clock::duration max_delay = std::chrono::milliseconds(100);
+
+struct collector
+{
+	void operator()(std::int64_t& event, bool is_late)
+	{
+		(is_late ? late : ordered).push_back(event);
+	}
+
+	std::vector<std::int64_t> ordered;
+	std::vector<std::int64_t> late;
+};
+} //namespace
+
+BOOST_AUTO_TEST_CASE(orders_events_jittered_within_window)
+{
+	std::mt19937 random(5);
+	for (std::int64_t jitter : { 0, 100, 1000, 1999 })
+	{
+		buffer events(2000, 100000, max_delay);
+		collector released;
+		for (std::int64_t i = 0; i != 100000; ++i)
+		{
+			std::int64_t timestamp = i * 10 + random() % (jitter + 1);
+			events.push(timestamp, std::int64_t(timestamp), released);
+		}
+
+		events.flush(released);
+		BOOST_CHECK_EQUAL(released.ordered.size(), 100000u);
+		BOOST_CHECK(released.late.empty());
+		BOOST_CHECK(std::is_sorted(released.ordered.cbegin(), released.ordered.cend()));
+		BOOST_CHECK(events.empty());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(reports_events_beyond_window_as_late)
+{
+	buffer events(100, 1000, max_delay);
+	collector released;
+	for (std::int64_t timestamp : { 0, 50, 100, 150, 20, 200 })
+		events.push(timestamp, std::int64_t(timestamp), released);
+
+	BOOST_CHECK((released.ordered == std::vector<std::int64_t>{ 0, 50, 100 }));
+	BOOST_CHECK((released.late == std::vector<std::int64_t>{ 20 }));
+	BOOST_CHECK_EQUAL(events.get_late_count(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(releases_when_full)
+{
+	buffer events(1000000, 3, max_delay);
+	collector released;
+	for (std::int64_t timestamp : { 40, 10, 30, 20, 50 })
+		events.push(timestamp, std::int64_t(timestamp), released);
+
+	BOOST_CHECK((released.ordered == std::vector<std::int64_t>{ 10, 20 }));
+	BOOST_CHECK_EQUAL(events.size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_equal_timestamps_in_arrival_order)
+{
+	buffer events(10, 100, max_delay);
+	collector released;
+	for (std::int64_t event = 0; event != 5; ++event)
+		events.push(7, std::int64_t(event), released);
+
+	events.flush(released);
+	BOOST_CHECK((released.ordered == std::vector<std::int64_t>{ 0, 1, 2, 3, 4 }));
+}
+
+BOOST_AUTO_TEST_CASE(releases_events_held_for_max_delay)
+{
+	buffer events(1000000, 1000, max_delay);
+	collector released;
+	events.push(30, 30, released);
+	test_clock::advance(max_delay / 2);
+	events.push(10, 10, released);
+	events.push(20, 20, released);
+
+	events.release_expired(released);
+	BOOST_CHECK(released.ordered.empty());
+
+	//The oldest arrival is released with everything ordered before it
+	test_clock::advance(max_delay / 2);
+	events.release_expired(released);
+	BOOST_CHECK((released.ordered == std::vector<std::int64_t>{ 10, 20, 30 }));
+	BOOST_CHECK(events.empty());
+}
+
+BOOST_AUTO_TEST_CASE(releases_expired_events_on_push)
+{
+	buffer events(1000000, 1000, max_delay);
+	collector released;
+	events.push(10, 10, released);
+	events.push(20, 20, released);
+	test_clock::advance(max_delay);
+	events.push(15, 15, released);
+
+	BOOST_CHECK((released.ordered == std::vector<std::int64_t>{ 10, 15, 20 }));
+}
+
+BOOST_AUTO_TEST_CASE(expiry_follows_arrival_order)
+{
+	buffer events(1000000, 1000, max_delay);
+	collector released;
+	events.push(50, 50, released);
+	test_clock::advance(max_delay / 4);
+	events.push(10, 10, released);
+	test_clock::advance(max_delay / 4);
+	events.push(40, 40, released);
+	events.push(5, 5, released);
+	test_clock::advance(max_delay / 2);
+
+	//Releasing 5 and 10 leaves 50, the oldest arrival, held past max delay
+	events.release_expired(released);
+	BOOST_CHECK((released.ordered == std::vector<std::int64_t>{ 5, 10, 40, 50 }));
+
+	events.push(60, 60, released);
+	test_clock::advance(max_delay / 2);
+	events.release_expired(released);
+	BOOST_CHECK_EQUAL(events.size(), 1u);
+	test_clock::advance(max_delay / 2);
+	events.release_expired(released);
+	BOOST_CHECK(events.empty());
+}
@@ -0,0 +1,99 @@
+#define BOOST_TEST_MODULE self_profiler
+#include <boost/test/unit_test.hpp>
+
+#define EVENT_TRACING_PROFILING
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_tracing/self_profiler.h"
+
+using namespace event_tracing;
+
+namespace
+{
+//Probes are global, so each test case uses probes of its own names
+void leaf()
+{
+	EVENT_TRACING_PROFILE_SCOPE("leaf");
+}
+
+void outer()
+{
+	EVENT_TRACING_PROFILE_SCOPE("outer");
+	leaf();
+	leaf();
+}
+
+void recursive(int depth)
+{
+	EVENT_TRACING_PROFILE_SCOPE("recursive");
+	if (depth)
+		recursive(depth - 1);
+}
+
+const profile_probe_statistics* find(const std::vector<profile_probe_statistics>& statistics,
+	const std::string& name)
+{
+	for (const auto& probe : statistics)
+	{
+		if (probe.name == name)
+			return &probe;
+	}
+
+	return nullptr;
+}
+
+std::vector<std::string> get_folded_paths()
+{
+	std::string folded;
+	write_folded_stacks(folded);
+	std::vector<std::string> paths;
+	for (std::size_t start = 0, end; (end = folded.find('\n', start)) != std::string::npos; start = end + 1)
+	{
+		auto line = folded.substr(start, end - start);
+		paths.push_back(line.substr(0, line.rfind(' ')));
+	}
+
+	return paths;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(aggregates_call_paths_over_threads)
+{
+	for (int i = 0; i != 100; ++i)
+		outer();
+
+	std::thread([] { for (int i = 0; i != 50; ++i) outer(); leaf(); }).join();
+
+	auto statistics = get_profile_statistics();
+	auto outer_probe = find(statistics, "outer");
+	auto leaf_probe = find(statistics, "leaf");
+	BOOST_REQUIRE(outer_probe && leaf_probe);
+	BOOST_CHECK_EQUAL(outer_probe->calls, 150u);
+	BOOST_CHECK_EQUAL(leaf_probe->calls, 301u);
+	BOOST_CHECK_GE(outer_probe->total_cycles, leaf_probe->total_cycles - leaf_probe->self_cycles);
+	BOOST_CHECK_LE(outer_probe->self_cycles, outer_probe->total_cycles);
+
+	auto paths = get_folded_paths();
+	BOOST_CHECK(std::find(paths.cbegin(), paths.cend(), "outer;leaf") != paths.cend());
+	BOOST_CHECK(std::find(paths.cbegin(), paths.cend(), "leaf") != paths.cend());
+}
+
+BOOST_AUTO_TEST_CASE(counts_recursion_once_in_total)
+{
+	recursive(4);
+
+	auto statistics = get_profile_statistics();
+	auto probe = find(statistics, "recursive");
+	BOOST_REQUIRE(probe);
+	BOOST_CHECK_EQUAL(probe->calls, 5u);
+	//All cycles are spent in the probe itself, the outermost call covers the rest
+	BOOST_CHECK_EQUAL(probe->self_cycles, probe->total_cycles);
+
+	auto paths = get_folded_paths();
+	BOOST_CHECK(std::find(paths.cbegin(), paths.cend(),
+		"recursive;recursive;recursive;recursive;recursive") != paths.cend());
+}
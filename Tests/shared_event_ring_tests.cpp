@@ -0,0 +1,244 @@
+#define BOOST_TEST_MODULE shared_event_ring
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "event_tracing/event_trace_error.h"
+#include "event_tracing/shared_event_ring.h"
+
+using namespace event_tracing;
+
+namespace
+{
+using read_result = shared_event_ring_reader::read_result;
+
+//Unique per test process, so parallel test runs do not share rings
+std::string get_ring_name(const char* test_name)
+{
+#ifdef _WIN32
+	auto process_id = ::GetCurrentProcessId();
+#else
+	auto process_id = ::getpid();
+#endif
+	return std::string("event_tracing_tests_") + test_name + '_' + std::to_string(process_id);
+}
+
+//Records start with their sequence number followed by bytes derived from it
+std::size_t get_record_size(std::uint64_t sequence)
+{
+	return 64 + sequence % 400;
+}
+
+void write_record(shared_event_ring_writer& writer, std::uint64_t sequence)
+{
+	auto size = get_record_size(sequence);
+	BOOST_REQUIRE(writer.write(size, [sequence, size](std::uint8_t* data)
+	{
+		std::memcpy(data, &sequence, sizeof(sequence));
+		for (auto i = sizeof(sequence); i < size; ++i)
+			data[i] = static_cast<std::uint8_t>(sequence + i);
+	}));
+}
+
+bool is_valid_record(const std::vector<std::uint8_t>& record, std::uint64_t& sequence)
+{
+	if (record.size() < sizeof(sequence))
+		return false;
+
+	std::memcpy(&sequence, record.data(), sizeof(sequence));
+	if (record.size() != get_record_size(sequence))
+		return false;
+
+	for (auto i = sizeof(sequence); i < record.size(); ++i)
+	{
+		if (record[i] != static_cast<std::uint8_t>(sequence + i))
+			return false;
+	}
+
+	return true;
+}
+
+struct read_summary
+{
+	std::uint64_t received = 0;
+	std::uint64_t first_sequence = 0;
+	//Torn, reordered or repeated records
+	std::uint64_t invalid = 0;
+};
+
+//Reads until the writer closes the ring, optionally pausing every pause_interval records
+read_summary read_all(shared_event_ring_reader& reader, std::uint64_t pause_interval = 0)
+{
+	read_summary summary;
+	std::vector<std::uint8_t> record;
+	std::uint64_t last_sequence = 0;
+	while (true)
+	{
+		auto result = reader.read(record);
+		if (result == read_result::finished)
+			break;
+
+		if (result == read_result::empty)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::uint64_t sequence = 0;
+		if (!is_valid_record(record, sequence) || (summary.received && sequence <= last_sequence))
+			++summary.invalid;
+
+		if (!summary.received)
+			summary.first_sequence = sequence;
+
+		last_sequence = sequence;
+		++summary.received;
+		if (pause_interval && summary.received % pause_interval == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	return summary;
+}
+} //namespace
+
+BOOST_AUTO_TEST_CASE(reads_records_in_order_across_wrap)
+{
+	auto name = get_ring_name("order");
+	auto writer = std::make_unique<shared_event_ring_writer>(name, 4096);
+	shared_event_ring_reader reader(name);
+	std::vector<std::uint8_t> record;
+	BOOST_CHECK(reader.read(record) == read_result::empty);
+
+	//Several passes over the ring, read as they are written
+	for (std::uint64_t sequence = 0; sequence != 200; ++sequence)
+	{
+		write_record(*writer, sequence);
+		BOOST_REQUIRE(reader.read(record) == read_result::record);
+		std::uint64_t read_sequence = 0;
+		BOOST_REQUIRE(is_valid_record(record, read_sequence));
+		BOOST_CHECK_EQUAL(read_sequence, sequence);
+	}
+
+	BOOST_CHECK_EQUAL(writer->get_written_count(), 200u);
+	BOOST_REQUIRE_EQUAL(writer->get_readers().size(), 1u);
+	BOOST_CHECK_EQUAL(writer->get_readers()[0].lag, 0u);
+
+	write_record(*writer, 200);
+	writer.reset();
+	BOOST_CHECK(reader.read(record) == read_result::record);
+	BOOST_CHECK(reader.read(record) == read_result::finished);
+	BOOST_CHECK_EQUAL(reader.get_lost_count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(rejects_records_larger_than_half_the_ring)
+{
+	auto name = get_ring_name("large");
+	shared_event_ring_writer writer(name, 4096);
+	std::vector<std::uint8_t> record(2048);
+	BOOST_CHECK(!writer.write(record.data(), record.size()));
+	BOOST_CHECK(writer.write(record.data(), 1024));
+}
+
+BOOST_AUTO_TEST_CASE(counts_overwritten_records_exactly)
+{
+	auto name = get_ring_name("lost");
+	auto writer = std::make_unique<shared_event_ring_writer>(name, 65536);
+	shared_event_ring_reader reader(name);
+	std::vector<std::uint8_t> record;
+
+	write_record(*writer, 0);
+	BOOST_REQUIRE(reader.read(record) == read_result::record);
+	//Overwrites the unread records several times
+	for (std::uint64_t sequence = 1; sequence != 5000; ++sequence)
+		write_record(*writer, sequence);
+
+	BOOST_CHECK_GT(writer->get_readers()[0].lag, 65536u);
+	writer.reset();
+	auto summary = read_all(reader);
+	BOOST_CHECK_EQUAL(summary.invalid, 0u);
+	BOOST_CHECK_GT(reader.get_lost_count(), 0u);
+	BOOST_CHECK_EQUAL(summary.received + reader.get_lost_count(), 4999u);
+}
+
+BOOST_AUTO_TEST_CASE(limits_reader_count)
+{
+	auto name = get_ring_name("readers");
+	BOOST_CHECK_THROW(shared_event_ring_reader reader(name), event_trace_error);
+
+	shared_event_ring_writer writer(name, 4096, 2);
+	auto first = std::make_unique<shared_event_ring_reader>(name);
+	shared_event_ring_reader second(name);
+	BOOST_CHECK_THROW(shared_event_ring_reader third(name), event_trace_error);
+	BOOST_CHECK_EQUAL(writer.get_readers().size(), 2u);
+
+	//A closed reader frees its slot
+	first.reset();
+	BOOST_CHECK_EQUAL(writer.get_readers().size(), 1u);
+	shared_event_ring_reader third(name);
+	BOOST_CHECK_EQUAL(writer.get_readers().size(), 2u);
+}
+
+#ifndef _WIN32
+//Two reader processes keep up with the writer, the third one pauses and falls behind
+BOOST_AUTO_TEST_CASE(fans_out_to_reader_processes)
+{
+	const std::uint64_t record_count = 200000;
+	const int reader_count = 3;
+	auto name = get_ring_name("processes");
+	auto writer = std::make_unique<shared_event_ring_writer>(name, 1 << 20);
+
+	std::vector<pid_t> readers;
+	for (int i = 0; i != reader_count; ++i)
+	{
+		auto process_id = ::fork();
+		BOOST_REQUIRE_NE(process_id, -1);
+		if (!process_id)
+		{
+			//Boost.Test state is not used in the reader processes, the result is the exit code
+			int result = 1;
+			try
+			{
+				shared_event_ring_reader reader(name);
+				auto summary = read_all(reader, i == reader_count - 1 ? 1000 : 0);
+				auto expected = summary.received ? record_count - summary.first_sequence : 0;
+				result = summary.invalid || summary.received + reader.get_lost_count() != expected;
+			}
+			catch (...)
+			{
+			}
+
+			::_exit(result);
+		}
+
+		readers.push_back(process_id);
+	}
+
+	while (writer->get_readers().size() != reader_count)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	for (std::uint64_t sequence = 0; sequence != record_count; ++sequence)
+		write_record(*writer, sequence);
+
+	writer.reset();
+	for (auto process_id : readers)
+	{
+		int status = 0;
+		BOOST_REQUIRE_EQUAL(::waitpid(process_id, &status, 0), process_id);
+		BOOST_CHECK(WIFEXITED(status));
+		BOOST_CHECK_EQUAL(WEXITSTATUS(status), 0);
+	}
+}
+#endif
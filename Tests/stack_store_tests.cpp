@@ -0,0 +1,74 @@
+#define BOOST_TEST_MODULE stack_store
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "event_tracing/stack_store.h"
+
+using namespace event_tracing;
+
+BOOST_AUTO_TEST_CASE(interns_stacks)
+{
+	stack_store store;
+	std::vector<std::uint64_t> frames{ 0x100, 0x200, 0x300 };
+	auto id = store.add(frames.data(), frames.size());
+	BOOST_CHECK_NE(id, stack_store::empty_stack);
+	BOOST_CHECK_EQUAL(store.get_depth(id), 3u);
+	BOOST_CHECK_EQUAL(store.get_frame(id), 0x100u);
+	BOOST_CHECK((store.get_frames(id) == frames));
+	BOOST_CHECK_EQUAL(store.get_node_count(), 3u);
+
+	BOOST_CHECK_EQUAL(store.add(frames.data(), frames.size()), id);
+	BOOST_CHECK_EQUAL(store.get_node_count(), 3u);
+	BOOST_CHECK_EQUAL(store.add(nullptr, 0), stack_store::empty_stack);
+}
+
+BOOST_AUTO_TEST_CASE(shares_outer_frames)
+{
+	stack_store store;
+	std::vector<std::uint64_t> first{ 0x1, 0x200, 0x300 };
+	std::vector<std::uint64_t> second{ 0x2, 0x200, 0x300 };
+	auto first_id = store.add(first.data(), first.size());
+	auto second_id = store.add(second.data(), second.size());
+	BOOST_CHECK_NE(first_id, second_id);
+	BOOST_CHECK_EQUAL(store.get_parent(first_id), store.get_parent(second_id));
+	BOOST_CHECK_EQUAL(store.get_node_count(), 4u);
+	BOOST_CHECK((store.get_frames(second_id) == second));
+
+	std::vector<std::uint64_t> outer{ 0x200, 0x300 };
+	BOOST_CHECK_EQUAL(store.add(outer.data(), outer.size()), store.get_parent(first_id));
+}
+
+BOOST_AUTO_TEST_CASE(repeated_stacks_stay_small)
+{
+	//A million events drawn from 2000 distinct 30 frame stacks with common outer frames
+	stack_store store;
+	std::mt19937_64 random(1);
+	std::vector<std::vector<std::uint64_t>> stacks(2000);
+	for (auto& stack : stacks)
+	{
+		for (std::size_t i = 0; i != 30; ++i)
+			stack.push_back(i >= 20 ? 0x7ff000 + i : random() % 5000);
+	}
+
+	std::vector<stack_store::stack_id> ids(stacks.size());
+	for (int i = 0; i != 1000000; ++i)
+	{
+		auto index = random() % stacks.size();
+		ids[index] = store.add(stacks[index].data(), stacks[index].size());
+	}
+
+	for (std::size_t i = 0; i != stacks.size(); ++i)
+	{
+		if (ids[i] != stack_store::empty_stack)
+			BOOST_CHECK((store.get_frames(ids[i]) == stacks[i]));
+	}
+
+	BOOST_CHECK_LE(store.get_node_count(), stacks.size() * 20 + 10);
+	BOOST_CHECK_LT(store.get_memory_usage(), 4u * 1024 * 1024);
+
+	store.clear();
+	BOOST_CHECK_EQUAL(store.get_node_count(), 0u);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+
+//Clock which only advances when told to, for components taking a Clock parameter
+struct test_clock
+{
+	using duration = std::chrono::nanoseconds;
+	using rep = duration::rep;
+	using period = duration::period;
+	using time_point = std::chrono::time_point<test_clock>;
+	static constexpr const bool is_steady = true;
+
+	static time_point now() noexcept
+	{
+		return current;
+	}
+
+	static void advance(duration time) noexcept
+	{
+		current += time;
+	}
+
+	static time_point current;
+};
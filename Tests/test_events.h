@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/event_schema.h"
+
+//Builders of TRACE_EVENT_INFO schemas and event payloads, so that events
+//can be decoded without TDH knowing their providers
+namespace test_events
+{
+struct schema_property
+{
+	const wchar_t* name;
+	USHORT in_type;
+	USHORT out_type;
+	ULONG flags;
+	//Fixed count, or index of the count property with PropertyParamCount
+	USHORT count;
+	//Fixed length, or index of the length property with PropertyParamLength
+	USHORT length;
+	USHORT struct_start_index;
+	USHORT struct_member_count;
+	const wchar_t* map_name;
+};
+
+inline schema_property make_property(const wchar_t* name, USHORT in_type, USHORT out_type = 0,
+	const wchar_t* map_name = nullptr)
+{
+	return { name, in_type, out_type, 0, 1, 0, 0, 0, map_name };
+}
+
+//Array of count_index property elements, or of a fixed count
+inline schema_property make_array(const wchar_t* name, USHORT in_type, USHORT count,
+	bool fixed_count = false)
+{
+	return { name, in_type, 0, static_cast<ULONG>(fixed_count ? PropertyParamFixedCount : PropertyParamCount),
+		count, 0, 0, 0, nullptr };
+}
+
+inline schema_property make_struct(const wchar_t* name, USHORT start_index, USHORT member_count)
+{
+	return { name, 0, 0, PropertyStruct, 1, 0, start_index, member_count, nullptr };
+}
+
+inline schema_property make_struct_array(const wchar_t* name, USHORT start_index, USHORT member_count,
+	USHORT count_index)
+{
+	return { name, 0, 0, static_cast<ULONG>(PropertyStruct | PropertyParamCount), count_index, 0,
+		start_index, member_count, nullptr };
+}
+
+//Top-level properties go first, struct members after them
+inline std::vector<std::uint8_t> make_schema_data(const std::vector<schema_property>& properties,
+	ULONG top_level_count, const wchar_t* event_message = nullptr)
+{
+	std::vector<std::uint8_t> data(offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray)
+		+ properties.size() * sizeof(EVENT_PROPERTY_INFO));
+	auto add_string = [&data](const wchar_t* value) -> ULONG
+	{
+		if (!value)
+			return 0;
+
+		auto offset = data.size();
+		auto size = (std::wcslen(value) + 1) * sizeof(wchar_t);
+		data.resize(offset + size);
+		std::memcpy(data.data() + offset, value, size);
+		return static_cast<ULONG>(offset);
+	};
+
+	std::vector<ULONG> name_offsets, map_offsets;
+	for (const auto& prop : properties)
+	{
+		name_offsets.push_back(add_string(prop.name));
+		map_offsets.push_back(add_string(prop.map_name));
+	}
+
+	auto message_offset = add_string(event_message);
+	if (!event_message)
+		add_string(L"");
+
+	auto info = reinterpret_cast<TRACE_EVENT_INFO*>(data.data());
+	info->DecodingSource = DecodingSourceXMLFile;
+	info->EventMessageOffset = message_offset;
+	info->PropertyCount = static_cast<ULONG>(properties.size());
+	info->TopLevelPropertyCount = top_level_count;
+	for (std::size_t i = 0; i != properties.size(); ++i)
+	{
+		const auto& prop = properties[i];
+		auto& property_info = info->EventPropertyInfoArray[i];
+		property_info.Flags = static_cast<PROPERTY_FLAGS>(prop.flags);
+		property_info.NameOffset = name_offsets[i];
+		if (prop.flags & PropertyStruct)
+		{
+			property_info.structType.StructStartIndex = prop.struct_start_index;
+			property_info.structType.NumOfStructMembers = prop.struct_member_count;
+		}
+		else
+		{
+			property_info.nonStructType.InType = prop.in_type;
+			property_info.nonStructType.OutType = prop.out_type;
+			property_info.nonStructType.MapNameOffset = map_offsets[i];
+		}
+
+		property_info.count = prop.count;
+		property_info.length = prop.length;
+	}
+
+	return data;
+}
+
+inline std::shared_ptr<const event_tracing::event_schema> make_schema(
+	const std::vector<schema_property>& properties, ULONG top_level_count,
+	const wchar_t* event_message = nullptr)
+{
+	return std::make_shared<event_tracing::event_schema>(
+		make_schema_data(properties, top_level_count, event_message));
+}
+
+class payload_builder
+{
+public:
+	template<typename T>
+	payload_builder& add(T value)
+	{
+		auto offset = data_.size();
+		data_.resize(offset + sizeof(value));
+		std::memcpy(data_.data() + offset, &value, sizeof(value));
+		return *this;
+	}
+
+	payload_builder& add_string(const std::wstring& value)
+	{
+		auto offset = data_.size();
+		auto size = (value.size() + 1) * sizeof(wchar_t);
+		data_.resize(offset + size);
+		std::memcpy(data_.data() + offset, value.c_str(), size);
+		return *this;
+	}
+
+	std::vector<std::uint8_t>& get_data() noexcept
+	{
+		return data_;
+	}
+
+private:
+	std::vector<std::uint8_t> data_;
+};
+
+//The record points into the payload, which must outlive it
+inline EVENT_RECORD make_record(std::vector<std::uint8_t>& payload, USHORT id, ULONG provider = 1)
+{
+	EVENT_RECORD record{};
+	record.EventHeader.Flags = EVENT_HEADER_FLAG_64_BIT_HEADER;
+	record.EventHeader.ProviderId.Data1 = provider;
+	record.EventHeader.EventDescriptor.Id = id;
+	record.EventHeader.ProcessId = 4;
+	record.EventHeader.ThreadId = 8;
+	record.UserData = payload.data();
+	record.UserDataLength = static_cast<USHORT>(payload.size());
+	return record;
+}
+} //namespace test_events
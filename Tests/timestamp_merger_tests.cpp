@@ -0,0 +1,155 @@
+#define BOOST_TEST_MODULE timestamp_merger
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "event_tracing/timestamp_merger.h"
+
+#include "test_clock.h"
+
+using namespace event_tracing;
+
+test_clock::time_point test_clock::current;
+
+namespace
+{
+using merger = timestamp_merger<std::int64_t, test_clock>;
+constexpr const std::int64_t no_lookahead = (std::numeric_limits<std::int64_t>::max)();
+const test_clock::duration idle_timeout = std::chrono::milliseconds(100);
+
+struct collector
+{
+	void operator()(std::size_t stream_index, std::int64_t& event)
+	{
+		streams.push_back(stream_index);
+		events.push_back(event);
+	}
+
+	std::vector<std::size_t> streams;
+	std::vector<std::int64_t> events;
+};
+} //namespace
+
+BOOST_AUTO_TEST_CASE(merges_ordered_streams_in_timestamp_order)
+{
+	std::mt19937 random(1);
+	for (std::size_t stream_count : { 1, 3, 8 })
+	{
+		merger events(stream_count, no_lookahead, idle_timeout, 100000);
+		collector released;
+		std::vector<std::int64_t> timestamps(stream_count, 0);
+		for (int i = 0; i != 10000; ++i)
+		{
+			auto stream_index = random() % stream_count;
+			timestamps[stream_index] += random() % 50;
+			auto timestamp = timestamps[stream_index];
+			BOOST_REQUIRE(events.push(stream_index, timestamp, std::int64_t(timestamp), released));
+		}
+
+		events.flush(released);
+		BOOST_CHECK_EQUAL(released.events.size(), 10000u);
+		BOOST_CHECK(std::is_sorted(released.events.cbegin(), released.events.cend()));
+		BOOST_CHECK(events.empty());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(releases_when_every_stream_has_events)
+{
+	merger events(2, no_lookahead, idle_timeout, 16);
+	collector released;
+	events.push(0, 10, 10, released);
+	events.push(0, 20, 20, released);
+	BOOST_CHECK(released.events.empty());
+
+	events.push(1, 15, 15, released);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 10, 15 }));
+	BOOST_CHECK_EQUAL(events.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(releases_events_older_than_lookahead)
+{
+	merger events(2, 100, idle_timeout, 16);
+	collector released;
+	events.push(0, 10, 10, released);
+	events.push(0, 109, 109, released);
+	BOOST_CHECK(released.events.empty());
+
+	events.push(0, 110, 110, released);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 10 }));
+}
+
+BOOST_AUTO_TEST_CASE(idle_streams_do_not_hold_back_others)
+{
+	merger events(2, no_lookahead, idle_timeout, 16);
+	collector released;
+	events.push(0, 10, 10, released);
+	events.push(0, 20, 20, released);
+
+	test_clock::advance(idle_timeout / 2);
+	events.release_idle(released);
+	BOOST_CHECK(released.events.empty());
+
+	test_clock::advance(idle_timeout);
+	events.release_idle(released);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 10, 20 }));
+	BOOST_CHECK(events.empty());
+}
+
+BOOST_AUTO_TEST_CASE(active_empty_streams_hold_back_others)
+{
+	merger events(3, no_lookahead, idle_timeout, 16);
+	collector released;
+	test_clock::advance(idle_timeout * 2);
+
+	//Stream 1 has just delivered an event, stream 2 has been idle
+	events.push(1, 5, 5, released);
+	events.push(0, 10, 10, released);
+	events.push(0, 20, 20, released);
+	BOOST_CHECK(released.events.empty());
+
+	//Stream 1 drains after its event and is still active, so the rest waits
+	events.release_idle(released);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 5 }));
+
+	test_clock::advance(idle_timeout / 2);
+	events.push(0, 30, 30, released);
+	events.release_idle(released);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 5 }));
+
+	test_clock::advance(idle_timeout);
+	events.release_idle(released);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 5, 10, 20, 30 }));
+}
+
+BOOST_AUTO_TEST_CASE(full_streams_release_events_early)
+{
+	merger events(2, no_lookahead, idle_timeout, 4);
+	collector released;
+	for (std::int64_t timestamp = 0; timestamp != 10; ++timestamp)
+		BOOST_CHECK(events.push(0, timestamp, std::int64_t(timestamp), released));
+
+	BOOST_CHECK_EQUAL(events.size(), 4u);
+	BOOST_CHECK_EQUAL(events.get_overflow_count(), 6u);
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 0, 1, 2, 3, 4, 5 }));
+}
+
+BOOST_AUTO_TEST_CASE(full_streams_drop_events)
+{
+	merger events(2, no_lookahead, idle_timeout, 4, merge_overflow::drop);
+	collector released;
+	for (std::int64_t timestamp = 0; timestamp != 10; ++timestamp)
+		BOOST_CHECK_EQUAL(events.push(0, timestamp, std::int64_t(timestamp), released), timestamp < 4);
+
+	BOOST_CHECK_EQUAL(events.size(), 4u);
+	BOOST_CHECK_EQUAL(events.get_overflow_count(), 6u);
+	BOOST_CHECK(released.events.empty());
+
+	//Other streams still have room
+	BOOST_CHECK(events.push(1, 2, 2, released));
+	BOOST_CHECK((released.events == std::vector<std::int64_t>{ 0, 1, 2, 2 }));
+	BOOST_CHECK((released.streams == std::vector<std::size_t>{ 0, 0, 0, 1 }));
+}
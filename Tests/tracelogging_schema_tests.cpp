@@ -0,0 +1,287 @@
+#define BOOST_TEST_MODULE tracelogging_schema
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <Evntcons.h>
+#include <tdh.h>
+
+#include "event_tracing/event_info.h"
+#include "event_tracing/event_visitor.h"
+#include "event_tracing/tracelogging_schema.h"
+
+#include "test_events.h"
+#ifdef WINDOWS_STUBS
+#include "windows_stubs.h"
+#endif
+
+using namespace event_tracing;
+
+namespace
+{
+//TraceLogging field types and flags of the metadata
+constexpr const std::uint8_t tl_chain = 0x80;
+constexpr const std::uint8_t tl_fixed_count = 0x20;
+constexpr const std::uint8_t tl_variable_count = 0x40;
+constexpr const std::uint8_t tl_custom = 0x60;
+constexpr const std::uint8_t tl_in_binary = 14;
+constexpr const std::uint8_t tl_in_struct = 24;
+constexpr const std::uint8_t tl_out_hex = 4;
+constexpr const std::uint8_t tl_out_pid = 5;
+
+class metadata_builder
+{
+public:
+	metadata_builder& add_byte(std::uint8_t value)
+	{
+		data_.push_back(value);
+		return *this;
+	}
+
+	metadata_builder& add_ushort(std::uint16_t value)
+	{
+		data_.push_back(static_cast<std::uint8_t>(value));
+		data_.push_back(static_cast<std::uint8_t>(value >> 8));
+		return *this;
+	}
+
+	metadata_builder& add_name(const char* value)
+	{
+		data_.insert(data_.end(), value, value + std::strlen(value) + 1);
+		return *this;
+	}
+
+	//Prepends the size, which the metadata starts with
+	std::vector<std::uint8_t> get_data() const
+	{
+		metadata_builder result;
+		result.add_ushort(static_cast<std::uint16_t>(data_.size() + 2u));
+		result.data_.insert(result.data_.end(), data_.begin(), data_.end());
+		return result.data_;
+	}
+
+private:
+	std::vector<std::uint8_t> data_;
+};
+
+//Event metadata and provider traits in the extended data of a record
+struct tracelogging_event
+{
+	tracelogging_event(std::vector<std::uint8_t> event_metadata, std::vector<std::uint8_t> event_payload,
+		bool has_traits = true)
+		: metadata(std::move(event_metadata))
+		, payload(std::move(event_payload))
+	{
+		metadata_builder traits_data;
+		traits_data.add_name("Contoso.Tracker").add_ushort(3).add_byte(1);
+		traits = traits_data.get_data();
+
+		record = test_events::make_record(payload, 0);
+		record.EventHeader.Flags |= EVENT_HEADER_FLAG_EXTENDED_INFO;
+		items[0].ExtType = EVENT_HEADER_EXT_TYPE_EVENT_SCHEMA_TL;
+		items[0].DataSize = static_cast<USHORT>(metadata.size());
+		items[0].DataPtr = reinterpret_cast<ULONGLONG>(metadata.data());
+		items[1].ExtType = EVENT_HEADER_EXT_TYPE_PROV_TRAITS;
+		items[1].DataSize = static_cast<USHORT>(traits.size());
+		items[1].DataPtr = reinterpret_cast<ULONGLONG>(traits.data());
+		record.ExtendedDataCount = has_traits ? 2 : 1;
+		record.ExtendedData = items;
+	}
+
+	tracelogging_event(const tracelogging_event&) = delete;
+	tracelogging_event& operator=(const tracelogging_event&) = delete;
+
+	std::vector<std::uint8_t> metadata;
+	std::vector<std::uint8_t> traits;
+	std::vector<std::uint8_t> payload;
+	EVENT_HEADER_EXTENDED_DATA_ITEM items[2]{};
+	EVENT_RECORD record;
+};
+
+//ProcessStarted { Pid, Image, Args[], Flags[3], Blob, Inner { A, Nested { B } }, Points[] { X, Y }, Custom, After }
+std::vector<std::uint8_t> make_metadata()
+{
+	metadata_builder metadata;
+	metadata.add_byte(0x81).add_byte(0x02).add_name("ProcessStarted")
+		.add_name("Pid").add_byte(TDH_INTYPE_UINT32 | tl_chain).add_byte(tl_out_pid)
+		.add_name("Image").add_byte(TDH_INTYPE_UNICODESTRING)
+		.add_name("Args").add_byte(TDH_INTYPE_ANSISTRING | tl_variable_count)
+		.add_name("Flags").add_byte(TDH_INTYPE_UINT16 | tl_fixed_count | tl_chain).add_byte(tl_out_hex).add_ushort(3)
+		.add_name("Blob").add_byte(tl_in_binary)
+		.add_name("Inner").add_byte(tl_in_struct | tl_chain).add_byte(2)
+		.add_name("A").add_byte(TDH_INTYPE_INT32)
+		.add_name("Nested").add_byte(tl_in_struct | tl_chain).add_byte(1)
+		.add_name("B").add_byte(TDH_INTYPE_UINT8)
+		.add_name("Points").add_byte(tl_in_struct | tl_variable_count | tl_chain).add_byte(2)
+		.add_name("X").add_byte(TDH_INTYPE_INT16)
+		.add_name("Y").add_byte(TDH_INTYPE_INT16)
+		.add_name("Custom").add_byte(tl_custom | TDH_INTYPE_UINT8).add_ushort(3).add_byte('x').add_byte('y').add_byte('z')
+		.add_name("After").add_byte(TDH_INTYPE_UINT64);
+	return metadata.get_data();
+}
+
+std::vector<std::uint8_t> make_payload()
+{
+	test_events::payload_builder payload;
+	payload.add<std::uint32_t>(4242).add_string(L"C:\\app.exe")
+		.add<std::uint16_t>(2).add<char>('-').add<char>('a').add<char>(0)
+		.add<char>('-').add<char>('b').add<char>(0)
+		.add<std::uint16_t>(1).add<std::uint16_t>(2).add<std::uint16_t>(3)
+		.add<std::uint16_t>(3).add<std::uint8_t>(1).add<std::uint8_t>(2).add<std::uint8_t>(3)
+		.add<std::int32_t>(-5).add<std::uint8_t>(9)
+		.add<std::uint16_t>(2).add<std::int16_t>(1).add<std::int16_t>(2).add<std::int16_t>(3).add<std::int16_t>(4)
+		.add<std::uint16_t>(2).add<char>('z').add<char>('z')
+		.add<std::uint64_t>(77);
+	return payload.get_data();
+}
+
+struct counting_visitor : event_visitor
+{
+	void value(const event_property_view&) override
+	{
+		++count;
+	}
+
+	std::size_t count = 0;
+};
+} //namespace
+
+BOOST_AUTO_TEST_CASE(parses_metadata_into_schema)
+{
+	tracelogging_event event(make_metadata(), make_payload());
+	auto schema = parse_tracelogging_schema(event.record);
+	BOOST_REQUIRE(schema);
+	const auto& parsed = **schema;
+	auto info = parsed.get_info();
+	BOOST_CHECK(std::wcscmp(parsed.get_string(info->ProviderNameOffset), L"Contoso.Tracker") == 0);
+	BOOST_CHECK(std::wcscmp(parsed.get_string(info->TaskNameOffset), L"ProcessStarted") == 0);
+	BOOST_CHECK_EQUAL(info->DecodingSource, DecodingSourceTlg);
+	BOOST_CHECK_EQUAL(info->TopLevelPropertyCount, 9u);
+	BOOST_REQUIRE_EQUAL(parsed.get_property_count(), 14u);
+
+	const auto& pid = parsed.get_property(0);
+	BOOST_CHECK(std::wcscmp(pid.name, L"Pid") == 0);
+	BOOST_CHECK_EQUAL(pid.in_type, TDH_INTYPE_UINT32);
+	BOOST_CHECK_EQUAL(pid.out_type, TDH_OUTTYPE_PID);
+	BOOST_CHECK(parsed.get_property(2).has_payload_count());
+	BOOST_CHECK_EQUAL(parsed.get_property(3).count, 3u);
+	BOOST_CHECK_EQUAL(parsed.get_property(3).out_type, TDH_OUTTYPE_HEXINT16);
+	BOOST_CHECK(!parsed.get_property(3).has_count_property());
+
+	//Struct members go after the top-level properties
+	const auto& inner = parsed.get_property(5);
+	BOOST_CHECK(inner.is_struct());
+	BOOST_CHECK_EQUAL(inner.struct_start_index, 9u);
+	BOOST_CHECK_EQUAL(inner.struct_member_count, 2u);
+	const auto& points = parsed.get_property(6);
+	BOOST_CHECK(points.is_struct() && points.has_payload_count());
+	BOOST_CHECK(std::wcscmp(parsed.get_property(points.struct_start_index).name, L"X") == 0);
+
+	tracelogging_event no_traits(make_metadata(), make_payload(), false);
+	schema = parse_tracelogging_schema(no_traits.record);
+	BOOST_REQUIRE(schema);
+	BOOST_CHECK_EQUAL((*schema)->get_info()->ProviderNameOffset, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(reads_properties_without_tdh)
+{
+	tracelogging_event event(make_metadata(), make_payload());
+	event_schema_cache cache;
+#ifdef WINDOWS_STUBS
+	windows_stubs::reset_tdh_call_count();
+#endif
+
+	event_info info(&event.record, cache);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint32_t>(L"Pid"), 4242u);
+	BOOST_CHECK(info.get_plain_property_value<std::wstring>(L"Image") == L"C:\\app.exe");
+	BOOST_CHECK_EQUAL(info.get_array_property_size(2), 2u);
+	BOOST_CHECK(info.get_array_property_value(2, 1).to_wstring() == L"[ASTR]   Args = -b");
+	BOOST_CHECK_EQUAL(info.get_array_property_size(3), 3u);
+	BOOST_CHECK_EQUAL(info.get_array_property_value<std::uint16_t>(3, 2), 3u);
+
+	auto inner = info.get_structure(5);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::int32_t>(inner, 0), -5);
+	auto points = info.get_structure(6);
+	BOOST_CHECK_EQUAL(info.get_array_property_size(6), 2u);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::int16_t>(points, 1, 1), 4);
+	BOOST_CHECK_EQUAL(info.get_plain_property_value<std::uint64_t>(L"After"), 77u);
+
+#ifdef WINDOWS_STUBS
+	BOOST_CHECK_EQUAL(windows_stubs::get_tdh_call_count(), 0u);
+#endif
+
+	counting_visitor visitor;
+	auto consumed = visit_event(info.get_schema(), event.record, visitor);
+	BOOST_REQUIRE(consumed);
+	BOOST_CHECK_EQUAL(*consumed, event.record.UserDataLength);
+	BOOST_CHECK_EQUAL(visitor.count, 16u);
+}
+
+BOOST_AUTO_TEST_CASE(caches_schemas_by_metadata)
+{
+	tracelogging_event first(make_metadata(), make_payload());
+	tracelogging_event second(make_metadata(), make_payload());
+	auto changed_metadata = make_metadata();
+	changed_metadata[6] = 'Q';
+	tracelogging_event changed(std::move(changed_metadata), make_payload());
+
+	event_schema_cache cache;
+	auto first_schema = cache.get(&first.record);
+	auto second_schema = cache.get(&second.record);
+	BOOST_REQUIRE(first_schema && second_schema);
+	BOOST_CHECK(first_schema->get() == second_schema->get());
+	BOOST_CHECK_EQUAL(cache.size(), 1u);
+
+	auto changed_schema = cache.get(&changed.record);
+	BOOST_REQUIRE(changed_schema);
+	BOOST_CHECK(changed_schema->get() != first_schema->get());
+	BOOST_CHECK_EQUAL(cache.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(rejects_damaged_metadata)
+{
+	auto metadata = make_metadata();
+	for (std::size_t size = 0; size < metadata.size(); ++size)
+	{
+		tracelogging_event event(std::vector<std::uint8_t>(metadata.begin(), metadata.begin() + size),
+			make_payload());
+		auto schema = parse_tracelogging_schema(event.record);
+		if (schema)
+		{
+			counting_visitor visitor;
+			visit_event(**schema, event.record, visitor);
+		}
+	}
+
+	//Damaged metadata must either fail to parse or produce a schema which decodes within the payload
+	std::mt19937 random(1);
+	for (int i = 0; i != 20000; ++i)
+	{
+		auto damaged = metadata;
+		for (int j = 0; j != 3; ++j)
+			damaged[2u + random() % (damaged.size() - 2u)] = static_cast<std::uint8_t>(random());
+
+		tracelogging_event event(std::move(damaged), make_payload());
+		auto schema = parse_tracelogging_schema(event.record);
+		if (schema)
+		{
+			counting_visitor visitor;
+			auto consumed = visit_event(**schema, event.record, visitor);
+			BOOST_CHECK(!consumed || *consumed <= event.record.UserDataLength);
+		}
+	}
+
+	metadata_builder deep;
+	deep.add_byte(0).add_name("Deep");
+	for (int i = 0; i != 40; ++i)
+		deep.add_name("S").add_byte(tl_in_struct | tl_chain).add_byte(1);
+	deep.add_name("V").add_byte(TDH_INTYPE_UINT32);
+	tracelogging_event nested(deep.get_data(), std::vector<std::uint8_t>(4));
+	BOOST_CHECK(!parse_tracelogging_schema(nested.record));
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+//Common controls are used by the user interface only, which is not built here
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Windows.h"
+
+typedef ULONG64 TRACEHANDLE, *PTRACEHANDLE;
+#define INVALID_PROCESSTRACE_HANDLE ((TRACEHANDLE)~0ull)
+
+#define TRACE_LEVEL_NONE 0
+#define TRACE_LEVEL_CRITICAL 1
+#define TRACE_LEVEL_FATAL 1
+#define TRACE_LEVEL_ERROR 2
+#define TRACE_LEVEL_WARNING 3
+#define TRACE_LEVEL_INFORMATION 4
+#define TRACE_LEVEL_VERBOSE 5
+
+#define PROCESS_TRACE_MODE_REAL_TIME 0x00000100
+#define PROCESS_TRACE_MODE_RAW_TIMESTAMP 0x00001000
+#define PROCESS_TRACE_MODE_EVENT_RECORD 0x10000000
+#define EVENT_TRACE_REAL_TIME_MODE 0x100
+#define EVENT_TRACE_CONTROL_STOP 1
+#define EVENT_CONTROL_CODE_ENABLE_PROVIDER 1
+#define ENABLE_TRACE_PARAMETERS_VERSION_2 2
+#define EVENT_ENABLE_PROPERTY_SID 0x1
+#define EVENT_ENABLE_PROPERTY_TS_ID 0x2
+#define EVENT_ENABLE_PROPERTY_STACK_TRACE 0x4
+#define EVENT_ENABLE_PROPERTY_PROCESS_START_KEY 0x80
+#define EVENT_ENABLE_PROPERTY_EVENT_KEY 0x100
+#define EVENT_TRACE_TYPE_INFO 0x00
+
+extern const GUID EventTraceGuid;
+
+typedef struct _WNODE_HEADER
+{
+	ULONG BufferSize;
+	ULONG ProviderId;
+	ULONG64 HistoricalContext;
+	LARGE_INTEGER TimeStamp;
+	GUID Guid;
+	ULONG ClientContext;
+	ULONG Flags;
+} WNODE_HEADER;
+
+typedef struct _EVENT_TRACE_PROPERTIES
+{
+	WNODE_HEADER Wnode;
+	ULONG BufferSize;
+	ULONG MinimumBuffers;
+	ULONG MaximumBuffers;
+	ULONG MaximumFileSize;
+	ULONG LogFileMode;
+	ULONG FlushTimer;
+	ULONG EnableFlags;
+	LONG AgeLimit;
+	ULONG NumberOfBuffers;
+	ULONG FreeBuffers;
+	ULONG EventsLost;
+	ULONG BuffersWritten;
+	ULONG LogBuffersLost;
+	ULONG RealTimeBuffersLost;
+	HANDLE LoggerThreadId;
+	ULONG LogFileNameOffset;
+	ULONG LoggerNameOffset;
+} EVENT_TRACE_PROPERTIES, *PEVENT_TRACE_PROPERTIES;
+
+typedef struct _EVENT_FILTER_DESCRIPTOR
+{
+	ULONGLONG Ptr;
+	ULONG Size;
+	ULONG Type;
+} EVENT_FILTER_DESCRIPTOR;
+
+typedef struct _ENABLE_TRACE_PARAMETERS
+{
+	ULONG Version;
+	ULONG EnableProperty;
+	ULONG ControlFlags;
+	GUID SourceId;
+	EVENT_FILTER_DESCRIPTOR* EnableFilterDesc;
+	ULONG FilterDescCount;
+} ENABLE_TRACE_PARAMETERS;
+
+typedef struct _EVENT_DESCRIPTOR
+{
+	USHORT Id;
+	UCHAR Version;
+	UCHAR Channel;
+	UCHAR Level;
+	UCHAR Opcode;
+	USHORT Task;
+	ULONGLONG Keyword;
+} EVENT_DESCRIPTOR, *PEVENT_DESCRIPTOR;
+
+typedef struct _TIME_ZONE_INFORMATION
+{
+	LONG Bias;
+	WCHAR StandardName[32];
+	SYSTEMTIME StandardDate;
+	LONG StandardBias;
+	WCHAR DaylightName[32];
+	SYSTEMTIME DaylightDate;
+	LONG DaylightBias;
+} TIME_ZONE_INFORMATION;
+
+typedef struct _TRACE_LOGFILE_HEADER
+{
+	ULONG BufferSize;
+	ULONG Version;
+	ULONG ProviderVersion;
+	ULONG NumberOfProcessors;
+	LARGE_INTEGER EndTime;
+	ULONG TimerResolution;
+	ULONG MaximumFileSize;
+	ULONG LogFileMode;
+	ULONG BuffersWritten;
+	GUID LogInstanceGuid;
+	ULONG PointerSize;
+	ULONG EventsLost;
+	ULONG CpuSpeedInMHz;
+	LPWSTR LoggerName;
+	LPWSTR LogFileName;
+	TIME_ZONE_INFORMATION TimeZone;
+	LARGE_INTEGER BootTime;
+	LARGE_INTEGER PerfFreq;
+	LARGE_INTEGER StartTime;
+	ULONG ReservedFlags;
+	ULONG BuffersLost;
+} TRACE_LOGFILE_HEADER;
+
+struct _EVENT_RECORD;
+struct _EVENT_TRACE_LOGFILEW;
+typedef void (*PEVENT_RECORD_CALLBACK)(struct _EVENT_RECORD*);
+typedef ULONG (*PEVENT_TRACE_BUFFER_CALLBACKW)(struct _EVENT_TRACE_LOGFILEW*);
+
+typedef struct _EVENT_TRACE_HEADER
+{
+	USHORT Size;
+	USHORT FieldTypeFlags;
+	ULONG Version;
+	ULONG ThreadId;
+	ULONG ProcessId;
+	LARGE_INTEGER TimeStamp;
+	GUID Guid;
+	ULONG ClientContext;
+	ULONG Flags;
+} EVENT_TRACE_HEADER;
+
+typedef struct _EVENT_TRACE
+{
+	EVENT_TRACE_HEADER Header;
+	ULONG InstanceId;
+	ULONG ParentInstanceId;
+	GUID ParentGuid;
+	PVOID MofData;
+	ULONG MofLength;
+	ULONG ClientContext;
+} EVENT_TRACE;
+
+typedef struct _EVENT_TRACE_LOGFILEW
+{
+	LPWSTR LogFileName;
+	LPWSTR LoggerName;
+	LONGLONG CurrentTime;
+	ULONG BuffersRead;
+	ULONG ProcessTraceMode;
+	EVENT_TRACE CurrentEvent;
+	TRACE_LOGFILE_HEADER LogfileHeader;
+	PEVENT_TRACE_BUFFER_CALLBACKW BufferCallback;
+	ULONG BufferSize;
+	ULONG Filled;
+	ULONG EventsLost;
+	PEVENT_RECORD_CALLBACK EventRecordCallback;
+	ULONG IsKernelTrace;
+	PVOID Context;
+} EVENT_TRACE_LOGFILEW, *PEVENT_TRACE_LOGFILEW;
+
+ULONG StartTraceW(TRACEHANDLE* session, LPCWSTR session_name, PEVENT_TRACE_PROPERTIES properties);
+ULONG ControlTraceW(TRACEHANDLE session, LPCWSTR session_name, PEVENT_TRACE_PROPERTIES properties,
+	ULONG control_code);
+ULONG EnableTraceEx2(TRACEHANDLE session, const GUID* provider, ULONG control_code, UCHAR level,
+	ULONGLONG match_any_keyword, ULONGLONG match_all_keyword, ULONG timeout,
+	ENABLE_TRACE_PARAMETERS* parameters);
+TRACEHANDLE OpenTraceW(PEVENT_TRACE_LOGFILEW log_file);
+ULONG ProcessTrace(PTRACEHANDLE handles, ULONG handle_count, LPFILETIME start_time, LPFILETIME end_time);
+ULONG CloseTrace(TRACEHANDLE handle);
+
+#include "Evntcons.h"
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Windows.h"
+
+#define TH32CS_SNAPPROCESS 0x2
+
+typedef struct tagPROCESSENTRY32W
+{
+	DWORD dwSize;
+	DWORD cntUsage;
+	DWORD th32ProcessID;
+	ULONG_PTR th32DefaultHeapID;
+	DWORD th32ModuleID;
+	DWORD cntThreads;
+	DWORD th32ParentProcessID;
+	LONG pcPriClassBase;
+	DWORD dwFlags;
+	WCHAR szExeFile[260];
+} PROCESSENTRY32W;
+
+HANDLE CreateToolhelp32Snapshot(DWORD flags, DWORD pid);
+BOOL Process32FirstW(HANDLE snapshot, PROCESSENTRY32W* entry);
+BOOL Process32NextW(HANDLE snapshot, PROCESSENTRY32W* entry);
@@ -0,0 +1,166 @@
+#pragma once
+
+//Minimal declarations of the Windows API used by the library, so that it can be
+//built and unit tested on other platforms. Functions are defined in windows_stubs.cpp.
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <ctime>
+
+#define __stdcall
+#define WINAPI
+#define CALLBACK
+
+typedef unsigned char BYTE, UCHAR, *PUCHAR, BOOLEAN;
+typedef char CHAR;
+typedef unsigned short USHORT, WORD;
+typedef short SHORT;
+typedef unsigned int ULONG, DWORD, UINT;
+typedef int LONG, BOOL, INT;
+typedef unsigned long long ULONGLONG, ULONG64, DWORD64;
+typedef long long LONGLONG, LONG64;
+typedef wchar_t WCHAR, OLECHAR;
+typedef const wchar_t* LPCWSTR;
+typedef wchar_t* LPWSTR, *PWSTR;
+typedef void* PVOID, *HANDLE, *LPVOID;
+typedef float FLOAT;
+typedef double DOUBLE;
+typedef long HRESULT;
+typedef std::uintptr_t ULONG_PTR;
+typedef std::intptr_t INT_PTR, LONG_PTR;
+typedef ULONG* PULONG;
+
+#define TRUE 1
+#define FALSE 0
+#define FAILED(x) ((x) < 0)
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_PATH_NOT_FOUND 3L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_INVALID_DATA 13L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_ALREADY_EXISTS 183L
+#define ERROR_NOT_FOUND 1168L
+#define ERROR_CANCELLED 1223L
+#define ERROR_FILE_CORRUPT 1392L
+#define ERROR_WMI_INSTANCE_NOT_FOUND 4201L
+#define ERROR_CTX_CLOSE_PENDING 7007L
+#define ERROR_EVT_INVALID_EVENT_DATA 15005L
+#define STILL_ACTIVE 259
+
+typedef union _LARGE_INTEGER
+{
+	struct
+	{
+		DWORD LowPart;
+		LONG HighPart;
+	} u;
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct _GUID
+{
+	unsigned int Data1;
+	unsigned short Data2;
+	unsigned short Data3;
+	unsigned char Data4[8];
+} GUID, *LPGUID;
+typedef const GUID& REFGUID;
+
+inline bool operator==(const GUID& left, const GUID& right)
+{
+	return std::memcmp(&left, &right, sizeof(GUID)) == 0;
+}
+
+inline bool operator!=(const GUID& left, const GUID& right)
+{
+	return !(left == right);
+}
+
+typedef struct _FILETIME
+{
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+} FILETIME, *LPFILETIME;
+
+typedef struct _SYSTEMTIME
+{
+	WORD wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds;
+} SYSTEMTIME;
+
+typedef struct _SID_IDENTIFIER_AUTHORITY
+{
+	BYTE Value[6];
+} SID_IDENTIFIER_AUTHORITY;
+
+typedef struct _SID
+{
+	BYTE Revision;
+	BYTE SubAuthorityCount;
+	SID_IDENTIFIER_AUTHORITY IdentifierAuthority;
+	DWORD SubAuthority[1];
+} SID;
+typedef void* PSID;
+
+DWORD GetLastError();
+void SetLastError(DWORD error);
+
+void GetSystemTimeAsFileTime(LPFILETIME file_time);
+void GetSystemTimePreciseAsFileTime(LPFILETIME file_time);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+
+HRESULT CLSIDFromString(LPCWSTR text, GUID* guid);
+HRESULT StringFromCLSID(const GUID& guid, OLECHAR** text);
+void CoTaskMemFree(void* memory);
+
+#define LOCALE_NAME_INVARIANT L""
+#define LCMAP_UPPERCASE 0x200
+int LCMapStringEx(LPCWSTR locale, DWORD flags, LPCWSTR source, int source_length, LPWSTR destination,
+	int destination_length, void* version, void* reserved, LONG_PTR sort_handle);
+
+HANDLE GetCurrentProcess();
+BOOL CloseHandle(HANDLE handle);
+
+#define TOKEN_QUERY 8
+struct TOKEN_ELEVATION
+{
+	DWORD TokenIsElevated;
+};
+enum
+{
+	TokenElevation = 20
+};
+BOOL OpenProcessToken(HANDLE process, DWORD access, HANDLE* token);
+BOOL GetTokenInformation(HANDLE token, int information_class, void* information, DWORD length,
+	DWORD* return_length);
+
+#define PROCESS_QUERY_LIMITED_INFORMATION 0x1000
+HANDLE OpenProcess(DWORD access, BOOL inherit_handle, DWORD pid);
+BOOL GetProcessTimes(HANDLE process, LPFILETIME creation_time, LPFILETIME exit_time, LPFILETIME kernel_time,
+	LPFILETIME user_time);
+BOOL GetExitCodeProcess(HANDLE process, DWORD* exit_code);
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define MOVEFILE_REPLACE_EXISTING 1
+#define MOVEFILE_WRITE_THROUGH 8
+typedef struct _SECURITY_ATTRIBUTES* LPSECURITY_ATTRIBUTES;
+typedef struct _OVERLAPPED* LPOVERLAPPED;
+HANDLE CreateFileW(LPCWSTR file_name, DWORD access, DWORD share_mode, LPSECURITY_ATTRIBUTES security,
+	DWORD disposition, DWORD flags, HANDLE template_file);
+BOOL WriteFile(HANDLE file, const void* buffer, DWORD size, DWORD* written, LPOVERLAPPED overlapped);
+BOOL ReadFile(HANDLE file, void* buffer, DWORD size, DWORD* read, LPOVERLAPPED overlapped);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+BOOL FlushFileBuffers(HANDLE file);
+BOOL MoveFileExW(LPCWSTR existing_name, LPCWSTR new_name, DWORD flags);
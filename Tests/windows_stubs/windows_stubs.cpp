@@ -0,0 +1,392 @@
+#include "windows_stubs.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <Windows.h>
+#include <Evntrace.h>
+#include <TlHelp32.h>
+#include <tdh.h>
+
+const GUID EventTraceGuid{ 0x68fdd900, 0x4a3e, 0x11d1, { 0x84, 0xf4, 0x00, 0x00, 0xf8, 0x04, 0x64, 0xe3 } };
+
+namespace
+{
+thread_local DWORD last_error = ERROR_SUCCESS;
+std::atomic<std::size_t> tdh_call_count{ 0 };
+std::mutex event_information_mutex;
+std::vector<std::uint8_t> event_information;
+
+//Windows epoch is 1601-01-01, 100 ns units
+constexpr const std::int64_t unix_epoch_filetime = 116444736000000000ll;
+
+void to_file_time(std::int64_t value, FILETIME& file_time) noexcept
+{
+	file_time.dwLowDateTime = static_cast<DWORD>(value);
+	file_time.dwHighDateTime = static_cast<DWORD>(static_cast<std::uint64_t>(value) >> 32);
+}
+
+std::int64_t get_clock_ticks(clockid_t clock) noexcept
+{
+	timespec now{};
+	::clock_gettime(clock, &now);
+	return static_cast<std::int64_t>(now.tv_sec) * 10000000 + now.tv_nsec / 100;
+}
+
+//File names used by tests are ASCII
+std::string to_path(LPCWSTR file_name)
+{
+	std::string result;
+	for (; *file_name; ++file_name)
+		result.push_back(static_cast<char>(*file_name));
+
+	return result;
+}
+
+HANDLE to_handle(int descriptor) noexcept
+{
+	return reinterpret_cast<HANDLE>(static_cast<std::intptr_t>(descriptor) + 1);
+}
+
+int to_descriptor(HANDLE handle) noexcept
+{
+	return static_cast<int>(reinterpret_cast<std::intptr_t>(handle) - 1);
+}
+
+DWORD to_error(int error) noexcept
+{
+	switch (error)
+	{
+	case ENOENT:
+		return ERROR_FILE_NOT_FOUND;
+	case ENOTDIR:
+		return ERROR_PATH_NOT_FOUND;
+	case EACCES:
+	case EPERM:
+		return ERROR_ACCESS_DENIED;
+	default:
+		return ERROR_INVALID_PARAMETER;
+	}
+}
+
+BOOL fail(DWORD error) noexcept
+{
+	last_error = error;
+	return FALSE;
+}
+} //namespace
+
+namespace windows_stubs
+{
+std::size_t get_tdh_call_count() noexcept
+{
+	return tdh_call_count;
+}
+
+void reset_tdh_call_count() noexcept
+{
+	tdh_call_count = 0;
+}
+
+void set_event_information(const std::vector<std::uint8_t>& info)
+{
+	std::lock_guard<std::mutex> lock(event_information_mutex);
+	event_information = info;
+}
+} //namespace windows_stubs
+
+DWORD GetLastError()
+{
+	return last_error;
+}
+
+void SetLastError(DWORD error)
+{
+	last_error = error;
+}
+
+void GetSystemTimeAsFileTime(LPFILETIME file_time)
+{
+	to_file_time(get_clock_ticks(CLOCK_REALTIME) + unix_epoch_filetime, *file_time);
+}
+
+void GetSystemTimePreciseAsFileTime(LPFILETIME file_time)
+{
+	GetSystemTimeAsFileTime(file_time);
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	counter->QuadPart = get_clock_ticks(CLOCK_MONOTONIC);
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 10000000;
+	return TRUE;
+}
+
+HRESULT CLSIDFromString(LPCWSTR text, GUID* guid)
+{
+	unsigned int data[11] = {};
+	wchar_t end = 0;
+	if (std::swscanf(text, L"{%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x%lc", &data[0], &data[1], &data[2],
+		&data[3], &data[4], &data[5], &data[6], &data[7], &data[8], &data[9], &data[10], &end) != 12 || end != L'}')
+	{
+		return -1;
+	}
+
+	guid->Data1 = data[0];
+	guid->Data2 = static_cast<unsigned short>(data[1]);
+	guid->Data3 = static_cast<unsigned short>(data[2]);
+	for (int i = 0; i != 8; ++i)
+		guid->Data4[i] = static_cast<unsigned char>(data[3 + i]);
+
+	return 0;
+}
+
+HRESULT StringFromCLSID(const GUID& guid, OLECHAR** text)
+{
+	constexpr const std::size_t length = 39;
+	auto result = static_cast<OLECHAR*>(std::malloc(length * sizeof(OLECHAR)));
+	if (!result)
+		return -1;
+
+	std::swprintf(result, length, L"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}", guid.Data1,
+		guid.Data2, guid.Data3, guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3], guid.Data4[4],
+		guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+	*text = result;
+	return 0;
+}
+
+void CoTaskMemFree(void* memory)
+{
+	std::free(memory);
+}
+
+int LCMapStringEx(LPCWSTR, DWORD flags, LPCWSTR source, int source_length, LPWSTR destination,
+	int destination_length, void*, void*, LONG_PTR)
+{
+	if (source_length < 0)
+		source_length = static_cast<int>(std::wcslen(source)) + 1;
+	if (!destination_length)
+		return source_length;
+	if (destination_length < source_length)
+		return fail(ERROR_INSUFFICIENT_BUFFER);
+
+	for (int i = 0; i != source_length; ++i)
+	{
+		destination[i] = flags & LCMAP_UPPERCASE
+			? static_cast<wchar_t>(std::towupper(source[i])) : source[i];
+	}
+
+	return source_length;
+}
+
+HANDLE GetCurrentProcess()
+{
+	return reinterpret_cast<HANDLE>(static_cast<LONG_PTR>(-1));
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+	if (handle == GetCurrentProcess())
+		return TRUE;
+
+	return ::close(to_descriptor(handle)) == 0 ? TRUE : fail(to_error(errno));
+}
+
+BOOL OpenProcessToken(HANDLE, DWORD, HANDLE*)
+{
+	return fail(ERROR_ACCESS_DENIED);
+}
+
+BOOL GetTokenInformation(HANDLE, int, void*, DWORD, DWORD*)
+{
+	return fail(ERROR_ACCESS_DENIED);
+}
+
+HANDLE OpenProcess(DWORD, BOOL, DWORD)
+{
+	last_error = ERROR_INVALID_PARAMETER;
+	return nullptr;
+}
+
+BOOL GetProcessTimes(HANDLE, LPFILETIME, LPFILETIME, LPFILETIME, LPFILETIME)
+{
+	return fail(ERROR_INVALID_PARAMETER);
+}
+
+BOOL GetExitCodeProcess(HANDLE, DWORD*)
+{
+	return fail(ERROR_INVALID_PARAMETER);
+}
+
+HANDLE CreateFileW(LPCWSTR file_name, DWORD access, DWORD, LPSECURITY_ATTRIBUTES, DWORD disposition,
+	DWORD, HANDLE)
+{
+	int flags = (access & GENERIC_READ) && (access & GENERIC_WRITE) ? O_RDWR
+		: access & GENERIC_WRITE ? O_WRONLY : O_RDONLY;
+	if (disposition == CREATE_ALWAYS)
+		flags |= O_CREAT | O_TRUNC;
+
+	auto descriptor = ::open(to_path(file_name).c_str(), flags | O_CLOEXEC, 0644);
+	if (descriptor < 0)
+	{
+		last_error = to_error(errno);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	return to_handle(descriptor);
+}
+
+BOOL WriteFile(HANDLE file, const void* buffer, DWORD size, DWORD* written, LPOVERLAPPED)
+{
+	auto result = ::write(to_descriptor(file), buffer, size);
+	if (result < 0)
+		return fail(to_error(errno));
+
+	*written = static_cast<DWORD>(result);
+	return TRUE;
+}
+
+BOOL ReadFile(HANDLE file, void* buffer, DWORD size, DWORD* read, LPOVERLAPPED)
+{
+	auto result = ::read(to_descriptor(file), buffer, size);
+	if (result < 0)
+		return fail(to_error(errno));
+
+	*read = static_cast<DWORD>(result);
+	return TRUE;
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+	struct stat status{};
+	if (::fstat(to_descriptor(file), &status))
+		return fail(to_error(errno));
+
+	size->QuadPart = status.st_size;
+	return TRUE;
+}
+
+BOOL FlushFileBuffers(HANDLE file)
+{
+	return ::fsync(to_descriptor(file)) == 0 ? TRUE : fail(to_error(errno));
+}
+
+BOOL MoveFileExW(LPCWSTR existing_name, LPCWSTR new_name, DWORD)
+{
+	return std::rename(to_path(existing_name).c_str(), to_path(new_name).c_str()) == 0
+		? TRUE : fail(to_error(errno));
+}
+
+ULONG StartTraceW(TRACEHANDLE*, LPCWSTR, PEVENT_TRACE_PROPERTIES)
+{
+	return ERROR_NOT_SUPPORTED;
+}
+
+ULONG ControlTraceW(TRACEHANDLE, LPCWSTR, PEVENT_TRACE_PROPERTIES, ULONG)
+{
+	return ERROR_NOT_SUPPORTED;
+}
+
+ULONG EnableTraceEx2(TRACEHANDLE, const GUID*, ULONG, UCHAR, ULONGLONG, ULONGLONG, ULONG,
+	ENABLE_TRACE_PARAMETERS*)
+{
+	return ERROR_NOT_SUPPORTED;
+}
+
+TRACEHANDLE OpenTraceW(PEVENT_TRACE_LOGFILEW)
+{
+	last_error = ERROR_NOT_SUPPORTED;
+	return INVALID_PROCESSTRACE_HANDLE;
+}
+
+ULONG ProcessTrace(PTRACEHANDLE, ULONG, LPFILETIME, LPFILETIME)
+{
+	return ERROR_NOT_SUPPORTED;
+}
+
+ULONG CloseTrace(TRACEHANDLE)
+{
+	return ERROR_SUCCESS;
+}
+
+HANDLE CreateToolhelp32Snapshot(DWORD, DWORD)
+{
+	last_error = ERROR_NOT_SUPPORTED;
+	return INVALID_HANDLE_VALUE;
+}
+
+BOOL Process32FirstW(HANDLE, PROCESSENTRY32W*)
+{
+	return fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL Process32NextW(HANDLE, PROCESSENTRY32W*)
+{
+	return fail(ERROR_NOT_SUPPORTED);
+}
+
+TDHSTATUS TdhEnumerateProviders(PPROVIDER_ENUMERATION_INFO buffer, ULONG* size)
+{
+	constexpr const ULONG required = sizeof(PROVIDER_ENUMERATION_INFO);
+	if (!buffer || *size < required)
+	{
+		*size = required;
+		return ERROR_INSUFFICIENT_BUFFER;
+	}
+
+	buffer->NumberOfProviders = 0;
+	return ERROR_SUCCESS;
+}
+
+TDHSTATUS TdhGetEventInformation(PEVENT_RECORD, ULONG, PTDH_CONTEXT, PTRACE_EVENT_INFO buffer, ULONG* size)
+{
+	++tdh_call_count;
+	std::lock_guard<std::mutex> lock(event_information_mutex);
+	if (event_information.empty())
+		return ERROR_NOT_FOUND;
+
+	auto required = static_cast<ULONG>(event_information.size());
+	if (!buffer || *size < required)
+	{
+		*size = required;
+		return ERROR_INSUFFICIENT_BUFFER;
+	}
+
+	std::memcpy(buffer, event_information.data(), event_information.size());
+	*size = required;
+	return ERROR_SUCCESS;
+}
+
+TDHSTATUS TdhGetEventMapInformation(PEVENT_RECORD, PWSTR, PEVENT_MAP_INFO, ULONG*)
+{
+	return ERROR_NOT_FOUND;
+}
+
+TDHSTATUS TdhGetPropertySize(PEVENT_RECORD, ULONG, PTDH_CONTEXT, ULONG, PROPERTY_DATA_DESCRIPTOR*, ULONG*)
+{
+	++tdh_call_count;
+	return ERROR_NOT_FOUND;
+}
+
+TDHSTATUS TdhGetProperty(PEVENT_RECORD, ULONG, PTDH_CONTEXT, ULONG, PROPERTY_DATA_DESCRIPTOR*, ULONG, BYTE*)
+{
+	++tdh_call_count;
+	return ERROR_NOT_FOUND;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Test controls of the Windows API stubs
+namespace windows_stubs
+{
+//Calls of TdhGetEventInformation, TdhGetPropertySize and TdhGetProperty. The stubs
+//know no schemas unless one is set, so events are decoded only from schemas
+//supplied by the library.
+std::size_t get_tdh_call_count() noexcept;
+void reset_tdh_call_count() noexcept;
+
+//TRACE_EVENT_INFO returned by TdhGetEventInformation for every event,
+//none if it is empty
+void set_event_information(const std::vector<std::uint8_t>& info);
+} //namespace windows_stubs